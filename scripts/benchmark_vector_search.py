@@ -9,6 +9,7 @@ import time
 import json
 import argparse
 import statistics
+import struct
 from pathlib import Path
 from typing import List, Dict, Tuple
 import numpy as np
@@ -22,6 +23,17 @@ import logging
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
 
+def read_index(index_path: Path) -> faiss.Index:
+    """Read a plain FAISS file or a checksummed index file (NRIX header, then the FAISS payload)."""
+    with open(index_path, 'rb') as f:
+        header = f.read(72)
+    if header[:4] != b'NRIX':
+        return faiss.read_index(str(index_path))
+    header_bytes = struct.unpack_from('<I', header, 8)[0]
+    payload_bytes = struct.unpack_from('<Q', header, 64)[0]
+    payload = np.fromfile(index_path, dtype=np.uint8, count=payload_bytes, offset=header_bytes)
+    return faiss.deserialize_index(payload)
+
 class VectorSearchBenchmark:
     def __init__(self, index_path: str, config_path: str):
         """Initialize benchmark with FAISS index and configuration."""
@@ -33,7 +45,7 @@ class VectorSearchBenchmark:
             self.config = json.load(f)
         
         # Load FAISS index
-        self.index = faiss.read_index(str(self.index_path))
+        self.index = read_index(self.index_path)
         logger.info(f"Loaded index with {self.index.ntotal} vectors")
         
         # Initialize embedding model
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+Text Encoder Export for NeuroRAG
+Writes a sentence-transformers BERT-style model (e.g. all-MiniLM-L6-v2)
+as the model file the vector service's in-process encoder loads
+(EMBEDDING_BACKEND=local:<file>)
+"""
+
+import argparse
+import logging
+import struct
+from pathlib import Path
+from typing import List
+
+import numpy as np
+
+# Configure logging
+logging.basicConfig(level=logging.INFO)
+logger = logging.getLogger(__name__)
+
+MAGIC = 0x4554524E  # "NRTE"
+VERSION = 1
+FLAG_LOWERCASE = 1 << 0
+FLAG_NORMALIZE = 1 << 1
+
+
+def crc32c(data: bytes) -> int:
+    """CRC-32C (Castagnoli), as the service's checksum.h computes it."""
+    try:
+        import google_crc32c
+        return google_crc32c.value(data)
+    except ImportError:
+        pass
+    try:
+        import crc32c as crc32c_module
+        return crc32c_module.crc32c(data)
+    except ImportError:
+        pass
+
+    logger.info("No crc32c module installed, computing the checksum in Python (slow)")
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x82F63B78 if crc & 1 else crc >> 1
+        table.append(crc)
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
+def layer_tensors(state, prefix: str) -> List[np.ndarray]:
+    names = [
+        "attention.self.query.weight", "attention.self.query.bias",
+        "attention.self.key.weight", "attention.self.key.bias",
+        "attention.self.value.weight", "attention.self.value.bias",
+        "attention.output.dense.weight", "attention.output.dense.bias",
+        "attention.output.LayerNorm.weight", "attention.output.LayerNorm.bias",
+        "intermediate.dense.weight", "intermediate.dense.bias",
+        "output.dense.weight", "output.dense.bias",
+        "output.LayerNorm.weight", "output.LayerNorm.bias",
+    ]
+    return [state[f"{prefix}.{name}"] for name in names]
+
+
+def export(model_name: str, output: Path, max_sequence_length: int) -> None:
+    from sentence_transformers import SentenceTransformer
+    from sentence_transformers.models import Normalize, Pooling
+
+    model = SentenceTransformer(model_name, device="cpu")
+    transformer = model[0]
+    bert = transformer.auto_model
+    config = bert.config
+    tokenizer = transformer.tokenizer
+
+    if config.model_type not in ("bert",):
+        raise ValueError(f"Only BERT-style encoders are supported, not {config.model_type}")
+    if config.hidden_act != "gelu":
+        raise ValueError(f"Unsupported activation {config.hidden_act}")
+    pooling = [module for module in model if isinstance(module, Pooling)]
+    if not pooling or not pooling[0].pooling_mode_mean_tokens:
+        raise ValueError("Only mean pooling is supported")
+    normalize = any(isinstance(module, Normalize) for module in model)
+    lowercase = bool(getattr(tokenizer, "do_lower_case", True))
+
+    vocab = sorted(tokenizer.get_vocab().items(), key=lambda item: item[1])
+    if [index for _, index in vocab] != list(range(len(vocab))):
+        raise ValueError("Vocabulary ids are not contiguous")
+    vocab_bytes = "".join(token + "\n" for token, _ in vocab).encode("utf-8")
+
+    sequence_length = min(max_sequence_length or model.max_seq_length, config.max_position_embeddings)
+    state = {name: tensor.detach().cpu().numpy().astype(np.float32) for name, tensor in bert.state_dict().items()}
+    tensors = [
+        state["embeddings.word_embeddings.weight"],
+        state["embeddings.position_embeddings.weight"],
+        state["embeddings.token_type_embeddings.weight"],
+        state["embeddings.LayerNorm.weight"],
+        state["embeddings.LayerNorm.bias"],
+    ]
+    for layer in range(config.num_hidden_layers):
+        tensors.extend(layer_tensors(state, f"encoder.layer.{layer}"))
+
+    flags = (FLAG_LOWERCASE if lowercase else 0) | (FLAG_NORMALIZE if normalize else 0)
+    header = struct.pack(
+        "<11IfII", MAGIC, VERSION, flags, len(vocab), config.hidden_size, config.num_hidden_layers,
+        config.num_attention_heads, config.intermediate_size, config.max_position_embeddings,
+        config.type_vocab_size, sequence_length, config.layer_norm_eps, len(vocab_bytes), 0)
+    payload = header + vocab_bytes + b"".join(np.ascontiguousarray(t).tobytes() for t in tensors)
+
+    temp_path = output.with_name(output.name + ".tmp")
+    with open(temp_path, "wb") as out:
+        out.write(payload)
+        out.write(struct.pack("<I", crc32c(payload)))
+    temp_path.replace(output)
+
+    logger.info(f"Wrote {output}: {config.num_hidden_layers} layers, {config.hidden_size} dimensions, "
+                f"{len(vocab)} tokens, {sequence_length} tokens per text, "
+                f"{'normalized' if normalize else 'unnormalized'} embeddings")
+
+    # Reference embeddings to compare the service's output against
+    sample = ["What is retrieval-augmented generation?", "Café naïve résumé"]
+    reference = model.encode(sample)
+    for text, embedding in zip(sample, reference):
+        logger.info(f"{text!r}: {np.array2string(embedding[:4], precision=5)} ...")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export a sentence encoder for in-process inference")
+    parser.add_argument("--model", default="sentence-transformers/all-MiniLM-L6-v2",
+                        help="sentence-transformers model name or path")
+    parser.add_argument("--output", required=True, type=Path, help="Model file to write")
+    parser.add_argument("--max-sequence-length", type=int, default=0,
+                        help="Tokens per text (default: the model's max_seq_length)")
+    args = parser.parse_args()
+
+    export(args.model, args.output, args.max_sequence_length)
+
+
+if __name__ == "__main__":
+    main()
@@ -8,6 +8,7 @@ import os
 import json
 import argparse
 import logging
+import subprocess
 from pathlib import Path
 from typing import List, Dict, Any
 import numpy as np
@@ -141,13 +142,36 @@ class FAISSIndexBuilder:
         faiss.write_index(self.index, str(output_path))
         logger.info(f"Index saved to {output_path}")
 
+def build_index_native(builder: str, embeddings: np.ndarray, output_dir: Path,
+                       index_type: str, nlist: int, kmeans: str):
+    """Build the index with the parallel C++ builder (neurorag_index_builder)."""
+    embeddings_path = output_dir / "embeddings.npy"
+    np.save(embeddings_path, np.ascontiguousarray(embeddings, dtype=np.float32))
+
+    index_path = output_dir / "faiss_index.bin"
+    command = [
+        builder,
+        "--input", str(embeddings_path),
+        "--output", str(index_path),
+        "--type", index_type,
+        "--nlist", str(nlist),
+        "--kmeans", kmeans,
+        "--report", str(output_dir / "build_report.json"),
+    ]
+    logger.info(f"Running native index builder: {' '.join(command)}")
+    subprocess.run(command, check=True)
+    return index_path
+
 def main():
     parser = argparse.ArgumentParser(description="Ingest data and build FAISS index for NeuroRAG")
     parser.add_argument("--input", required=True, help="Input data path (file or directory)")
     parser.add_argument("--output", required=True, help="Output directory for index and metadata")
     parser.add_argument("--model", default="all-MiniLM-L6-v2", help="Sentence transformer model")
-    parser.add_argument("--index-type", default="IVF_FLAT", choices=["FLAT", "IVF_FLAT", "HNSW"])
+    parser.add_argument("--index-type", default="IVF_FLAT", choices=["FLAT", "IVF_FLAT", "HNSW", "DISKANN"])
     parser.add_argument("--nlist", type=int, default=1024, help="Number of clusters for IVF index")
+    parser.add_argument("--native-builder", help="Path to neurorag_index_builder; builds the index in C++ on all cores")
+    parser.add_argument("--kmeans", default="minibatch", choices=["minibatch", "hierarchical"],
+                        help="IVF k-means variant for the native builder")
     
     args = parser.parse_args()
 
@@ -163,17 +187,20 @@ def main():
     # Create embeddings
     embeddings = processor.create_embeddings(documents)
     
-    # Build FAISS index
-    index_builder = FAISSIndexBuilder(processor.dimension)
-    index_builder.build_index(embeddings, args.index_type, args.nlist)
-    
-    # Save outputs
     output_dir = Path(args.output)
     output_dir.mkdir(parents=True, exist_ok=True)
     
-    # Save index
-    index_path = output_dir / "faiss_index.bin"
-    index_builder.save_index(index_path)
+    # Build and save the index
+    if args.native_builder:
+        index_path = build_index_native(args.native_builder, embeddings, output_dir,
+                                        args.index_type, args.nlist, args.kmeans)
+    elif args.index_type == "DISKANN":
+        parser.error("--index-type DISKANN requires --native-builder")
+    else:
+        index_builder = FAISSIndexBuilder(processor.dimension)
+        index_builder.build_index(embeddings, args.index_type, args.nlist)
+        index_path = output_dir / "faiss_index.bin"
+        index_builder.save_index(index_path)
     
     # Save document metadata
     metadata_path = output_dir / "documents.json"
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Index Snapshot Sync for NeuroRAG
+Brings a local snapshot directory up to date with a published one,
+downloading only the segments it does not already hold
+"""
+
+import os
+import json
+import argparse
+import logging
+import shutil
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+from typing import Dict, Any, List
+
+# Configure logging
+logging.basicConfig(level=logging.INFO)
+logger = logging.getLogger(__name__)
+
+FORMAT_VERSION = 1
+
+
+def fetch(url: str, destination: Path) -> None:
+    """Download a URL (http(s):// or file://) to a temporary file, then rename it."""
+    temp_path = destination.with_name(destination.name + ".part")
+    with urllib.request.urlopen(url, timeout=60) as response, open(temp_path, "wb") as out:
+        shutil.copyfileobj(response, out, length=4 << 20)
+        out.flush()
+        os.fsync(out.fileno())
+    os.replace(temp_path, destination)
+
+
+def load_manifest(path: Path) -> Dict[str, Any]:
+    with open(path) as f:
+        manifest = json.load(f)
+    if manifest.get("format_version") != FORMAT_VERSION:
+        raise ValueError(f"Unsupported snapshot format {manifest.get('format_version')} in {path}")
+    return manifest
+
+
+def sync_segments(source: str, target: Path, manifest: Dict[str, Any], jobs: int) -> Dict[str, int]:
+    """Download missing or truncated segments in parallel."""
+    missing: List[Dict[str, Any]] = []
+    reused_bytes = 0
+    for segment in manifest["segments"]:
+        path = target / segment["file"]
+        if path.exists() and path.stat().st_size == segment["bytes"]:
+            reused_bytes += segment["bytes"]
+        else:
+            missing.append(segment)
+
+    def download(segment: Dict[str, Any]) -> int:
+        path = target / segment["file"]
+        fetch(f"{source}/{segment['file']}", path)
+        size = path.stat().st_size
+        if size != segment["bytes"]:
+            path.unlink()
+            raise IOError(f"{segment['file']}: expected {segment['bytes']} bytes, got {size}")
+        return size
+
+    (target / "segments").mkdir(parents=True, exist_ok=True)
+    with ThreadPoolExecutor(max_workers=jobs) as pool:
+        downloaded_bytes = sum(pool.map(download, missing))
+
+    return {
+        "segments_downloaded": len(missing),
+        "bytes_downloaded": downloaded_bytes,
+        "segments_reused": len(manifest["segments"]) - len(missing),
+        "bytes_reused": reused_bytes,
+    }
+
+
+def prune(target: Path, keep_versions: int) -> int:
+    """Delete manifests beyond keep_versions and segments none of the kept ones use."""
+    manifests = sorted((target / "manifests").glob("*.json"))
+    for old in manifests[:-keep_versions]:
+        old.unlink()
+    referenced = set()
+    for path in manifests[-keep_versions:]:
+        referenced.update(segment["file"] for segment in load_manifest(path)["segments"])
+
+    removed = 0
+    for path in (target / "segments").glob("*.seg"):
+        if f"segments/{path.name}" not in referenced:
+            path.unlink()
+            removed += 1
+    return removed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sync a NeuroRAG index snapshot directory")
+    parser.add_argument("--source", required=True,
+                        help="Published snapshot base URL (https://..., file:///...)")
+    parser.add_argument("--target", required=True, help="Local snapshot directory (INDEX_SNAPSHOT_DIR)")
+    parser.add_argument("--jobs", type=int, default=8, help="Parallel segment downloads")
+    parser.add_argument("--keep-versions", type=int, default=2, help="Snapshots to keep locally")
+
+    args = parser.parse_args()
+    source = args.source.rstrip("/")
+    target = Path(args.target)
+    (target / "manifests").mkdir(parents=True, exist_ok=True)
+
+    # Fetched beside the live manifest; it only replaces it once every segment is present
+    incoming = target / "manifest.json.incoming"
+    fetch(f"{source}/manifest.json", incoming)
+    manifest = load_manifest(incoming)
+
+    current = target / "manifest.json"
+    if current.exists() and load_manifest(current)["version"] == manifest["version"]:
+        incoming.unlink()
+        logger.info(f"Snapshot {manifest['version']} is already current")
+        return
+
+    stats = sync_segments(source, target, manifest, args.jobs)
+    shutil.copyfile(incoming, target / "manifests" / f"{manifest['version']:012d}.json")
+    os.replace(incoming, current)
+    stats["segments_pruned"] = prune(target, max(args.keep_versions, 1))
+
+    logger.info(f"Synced snapshot {manifest['version']} ({manifest['index_type']}, {manifest['ntotal']} vectors): "
+                f"{stats['segments_downloaded']} segments / {stats['bytes_downloaded'] / 1e6:.1f} MB downloaded, "
+                f"{stats['segments_reused']} segments / {stats['bytes_reused'] / 1e6:.1f} MB reused, "
+                f"{stats['segments_pruned']} pruned")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,131 @@
+/**
+ * @file benchmark_diskann.cpp
+ * @brief QPS, recall and SSD reads per query of the DiskANN index
+ *
+ * Usage: vector_service_diskann_benchmark [index_path] [vectors] [dimension]
+ *        [queries] [cached_nodes]
+ *
+ * Builds a graph over clustered random vectors, computes exact neighbours
+ * by brute force, then sweeps the search list size at a few beam widths.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <faiss/utils/distances.h>
+
+#include "diskann_index.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr int kTopK = 10;
+
+// Gaussian blobs, closer to embedding data than uniform noise
+std::vector<float> make_vectors(size_t n, int d, size_t clusters, std::mt19937_64& rng) {
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> centers(clusters * d);
+    for (auto& value : centers) {
+        value = normal(rng) * 4.0f;
+    }
+    std::vector<float> vectors(n * d);
+    for (size_t i = 0; i < n; ++i) {
+        const float* center = &centers[(rng() % clusters) * d];
+        for (int j = 0; j < d; ++j) {
+            vectors[i * d + j] = center[j] + normal(rng);
+        }
+    }
+    return vectors;
+}
+
+std::vector<faiss::idx_t> exact_neighbours(const std::vector<float>& base, const std::vector<float>& queries, int d) {
+    size_t n = base.size() / d;
+    size_t nq = queries.size() / d;
+    std::vector<faiss::idx_t> truth(nq * kTopK);
+    #pragma omp parallel for
+    for (size_t q = 0; q < nq; ++q) {
+        std::vector<std::pair<float, faiss::idx_t>> distances(n);
+        for (size_t i = 0; i < n; ++i) {
+            distances[i] = {faiss::fvec_L2sqr(&queries[q * d], &base[i * d], d), static_cast<faiss::idx_t>(i)};
+        }
+        std::partial_sort(distances.begin(), distances.begin() + kTopK, distances.end());
+        for (int i = 0; i < kTopK; ++i) {
+            truth[q * kTopK + i] = distances[i].second;
+        }
+    }
+    return truth;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string index_path = argc > 1 ? argv[1] : "/tmp/neurorag_diskann_benchmark.nrda";
+    size_t vectors = argc > 2 ? std::stoul(argv[2]) : 100000;
+    int d = argc > 3 ? std::stoi(argv[3]) : 128;
+    size_t queries = argc > 4 ? std::stoul(argv[4]) : 1000;
+    size_t cached_nodes = argc > 5 ? std::stoul(argv[5]) : vectors / 100;
+
+    std::mt19937_64 rng(42);
+    auto base = make_vectors(vectors, d, 256, rng);
+    auto query_vectors = make_vectors(queries, d, 256, rng);
+    auto truth = exact_neighbours(base, query_vectors, d);
+
+    DiskAnnBuildParams params;
+    auto build_start = Clock::now();
+    if (!DiskAnnIndex::build(vectors, base.data(), nullptr, d, faiss::METRIC_L2, params, index_path)) {
+        return 1;
+    }
+    double build_seconds = std::chrono::duration<double>(Clock::now() - build_start).count();
+
+    auto index = DiskAnnIndex::load(index_path, std::make_shared<AsyncFileReader>(), cached_nodes);
+    if (!index) {
+        return 1;
+    }
+    std::cout << "Vectors: " << vectors << " x " << d << ", build " << build_seconds << " s, "
+              << cached_nodes << " cached nodes, reads via " << index->get_statistics()["reader"]["backend"]
+              << std::endl;
+
+    std::vector<float> distances(queries * kTopK);
+    std::vector<faiss::idx_t> labels(queries * kTopK);
+    for (int beam_width : {2, 4, 8}) {
+        for (int search_list_size : {20, 50, 100, 200}) {
+            DiskAnnSearchParameters search_params;
+            search_params.search_list_size = search_list_size;
+            search_params.beam_width = beam_width;
+
+            auto before = index->get_statistics();
+            auto start = Clock::now();
+            index->search(static_cast<faiss::idx_t>(queries), query_vectors.data(), kTopK,
+                          distances.data(), labels.data(), &search_params);
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            auto after = index->get_statistics();
+
+            size_t hits = 0;
+            for (size_t q = 0; q < queries; ++q) {
+                std::unordered_set<faiss::idx_t> expected(&truth[q * kTopK], &truth[q * kTopK] + kTopK);
+                for (int i = 0; i < kTopK; ++i) {
+                    hits += expected.count(labels[q * kTopK + i]);
+                }
+            }
+            double reads = static_cast<double>(after["ssd_reads"].get<uint64_t>() -
+                                               before["ssd_reads"].get<uint64_t>()) / queries;
+
+            std::cout << "W=" << beam_width << " L=" << search_list_size
+                      << ": QPS " << queries / seconds
+                      << ", recall@" << kTopK << " " << static_cast<double>(hits) / (queries * kTopK)
+                      << ", SSD reads/query " << reads << std::endl;
+        }
+    }
+
+    index.reset();
+    std::remove(index_path.c_str());
+    return 0;
+}
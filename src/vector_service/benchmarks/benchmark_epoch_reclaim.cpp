@@ -0,0 +1,187 @@
+/**
+ * @file benchmark_epoch_reclaim.cpp
+ * @brief Read-side cost of epoch-based reclamation vs shared_ptr atomics, and queue throughput
+ *
+ * Usage: vector_service_epoch_benchmark [threads] [seconds] [items]
+ *
+ * Readers repeatedly load a shared object and read it while one writer
+ * replaces it every 100 us, once protected by an EpochManager pin and
+ * once by std::atomic_load on a shared_ptr. Then producers and consumers
+ * hammer a LockFreeQueue. The correctness checks live in
+ * tests/test_epoch_reclaimer.cpp (vector_service_epoch_tests).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "epoch_reclaimer.h"
+#include "lock_free_queue.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Payload {
+    uint64_t version;
+    uint64_t values[7];
+};
+
+Payload* make_payload(uint64_t version) {
+    Payload* payload = new Payload();
+    payload->version = version;
+    for (uint64_t& value : payload->values) {
+        value = version;
+    }
+    return payload;
+}
+
+// Reads every field, so the pin covers a realistic access
+bool check(const Payload& payload) {
+    return std::all_of(std::begin(payload.values), std::end(payload.values),
+                       [&](uint64_t value) { return value == payload.version; });
+}
+
+template <typename Read, typename Replace>
+double run_reads(int threads, double seconds, Read read, Replace replace) {
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> matched(0);  // keeps the reads from being optimized away
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < threads; ++t) {
+        readers.emplace_back([&]() {
+            uint64_t local = 0;
+            uint64_t local_matched = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    local_matched += read();
+                }
+                local += 256;
+            }
+            reads.fetch_add(local);
+            matched.fetch_add(local_matched);
+        });
+    }
+    std::thread writer([&]() {
+        uint64_t version = 1;
+        while (!stop.load(std::memory_order_relaxed)) {
+            replace(++version);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    writer.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    return reads.load() / elapsed;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::stoi(argv[1]) : 8;
+    double seconds = argc > 2 ? std::stod(argv[2]) : 2.0;
+    size_t items = argc > 3 ? std::stoul(argv[3]) : 1000000;
+
+    // Epoch-protected raw pointer
+    double epoch_rate;
+    {
+        EpochManager epochs;
+        std::atomic<Payload*> current(make_payload(1));
+        epoch_rate = run_reads(threads, seconds,
+            [&]() {
+                EpochManager::Guard guard(epochs);
+                return check(*current.load());
+            },
+            [&](uint64_t version) {
+                epochs.retire(current.exchange(make_payload(version)));
+            });
+        epochs.drain(std::chrono::seconds(1));
+        delete current.load();
+    }
+
+    // shared_ptr with atomic load/store (the usual alternative)
+    double shared_rate;
+    {
+        std::shared_ptr<Payload> current(make_payload(1));
+        shared_rate = run_reads(threads, seconds,
+            [&]() {
+                std::shared_ptr<Payload> pinned = std::atomic_load(&current);
+                return check(*pinned);
+            },
+            [&](uint64_t version) {
+                std::atomic_store(&current, std::shared_ptr<Payload>(make_payload(version)));
+            });
+    }
+
+    std::cout << "Readers: " << threads << ", writer replacing every 100 us" << std::endl;
+    std::cout << "EpochManager pin:        " << epoch_rate / 1e6 << " M reads/s ("
+              << 1e9 * threads / epoch_rate << " ns/read)" << std::endl;
+    std::cout << "atomic_load(shared_ptr): " << shared_rate / 1e6 << " M reads/s ("
+              << 1e9 * threads / shared_rate << " ns/read)" << std::endl;
+    std::cout << "Speedup: " << epoch_rate / shared_rate << "x" << std::endl;
+
+    // Queue stress: half the threads produce, half consume
+    int producers = std::max(1, threads / 2);
+    int consumers = std::max(1, threads - producers);
+    size_t per_producer = items / producers;
+    std::atomic<uint64_t> consumed_count(0);
+    nlohmann::json queue_stats;
+    double queue_seconds;
+    {
+        LockFreeQueue<uint64_t> queue;
+        std::atomic<int> producing(producers);
+        auto start = Clock::now();
+        std::vector<std::thread> workers;
+        for (int p = 0; p < producers; ++p) {
+            workers.emplace_back([&, p]() {
+                for (size_t i = 0; i < per_producer; ++i) {
+                    queue.enqueue(static_cast<uint64_t>(p) * per_producer + i + 1);
+                }
+                producing.fetch_sub(1);
+            });
+        }
+        for (int c = 0; c < consumers; ++c) {
+            workers.emplace_back([&]() {
+                uint64_t value;
+                uint64_t count = 0;
+                for (;;) {
+                    if (queue.dequeue(value)) {
+                        ++count;
+                    } else if (producing.load() == 0 && queue.empty()) {
+                        break;
+                    }
+                }
+                consumed_count.fetch_add(count);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        queue_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        queue_stats = queue.get_statistics();
+    }
+
+    uint64_t moved = consumed_count.load();
+
+    std::cout << "LockFreeQueue: " << producers << " producers, " << consumers << " consumers, "
+              << moved << " items in " << queue_seconds << " s ("
+              << moved / queue_seconds / 1e6 << " M items/s)" << std::endl;
+    std::cout << "  nodes retired " << queue_stats["retired"] << ", reclaimed while running "
+              << queue_stats["reclaimed"] << ", collections " << queue_stats["collections"] << std::endl;
+    return 0;
+}
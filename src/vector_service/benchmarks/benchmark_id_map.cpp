@@ -0,0 +1,202 @@
+/**
+ * @file benchmark_id_map.cpp
+ * @brief Document id lookups: ConcurrentHashMap vs a mutex-guarded unordered_map
+ *
+ * Usage: vector_service_id_map_benchmark [threads] [seconds] [documents]
+ *
+ * Threads look up random document ids, with one in 16 operations an
+ * upsert or erase of a random id, against the ConcurrentHashMap behind
+ * DocumentIdMap and against a std::unordered_map behind a std::mutex.
+ * Then every id is checked to map to its last written value.
+ * Exits non-zero on any mismatch, so a -DNEURORAG_SANITIZE=address or
+ * =thread build doubles as a stress test.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "concurrent_hash_map.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::string document_id(size_t i) {
+    return "doc-" + std::to_string(i);
+}
+
+class ConcurrentIdMap {
+public:
+    explicit ConcurrentIdMap(size_t expected) : map_(expected) {}
+
+    int64_t find(const std::string& external_id) const {
+        int64_t internal_id;
+        return map_.find(external_id, internal_id) ? internal_id : -1;
+    }
+
+    void assign(const std::string& external_id, int64_t internal_id) {
+        map_.upsert(external_id, internal_id);
+    }
+
+    void erase(const std::string& external_id) {
+        map_.erase(external_id);
+    }
+
+    nlohmann::json get_statistics() const { return map_.get_statistics(); }
+
+private:
+    ConcurrentHashMap<std::string, int64_t> map_;
+};
+
+class LockedIdMap {
+public:
+    int64_t find(const std::string& external_id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = forward_.find(external_id);
+        return it == forward_.end() ? -1 : it->second;
+    }
+
+    void assign(const std::string& external_id, int64_t internal_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        forward_[external_id] = internal_id;
+    }
+
+    void erase(const std::string& external_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        forward_.erase(external_id);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, int64_t> forward_;
+};
+
+// Internal id n * documents + i for the n-th write of document i, so the
+// last write per document is recoverable; each thread owns documents
+// t, t + threads, ... for writes, so a final state is well defined
+template <typename Map>
+double run(Map& map, int threads, double seconds, size_t documents,
+           std::vector<std::vector<int64_t>>& last_written, bool& consistent) {
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> operations(0);
+    std::atomic<bool> ok(true);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937_64 rng(t + 1);
+            std::vector<int64_t>& written = last_written[t];
+            uint64_t local = 0;
+            uint64_t generation = 1;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    size_t doc = rng() % documents;
+                    if ((rng() & 15) != 0) {
+                        int64_t internal_id = map.find(document_id(doc));
+                        // Present ids always belong to the document looked up
+                        if (internal_id >= 0 && static_cast<size_t>(internal_id) % documents != doc) {
+                            ok.store(false);
+                        }
+                        continue;
+                    }
+                    size_t owned = (doc / threads) * threads + t;
+                    if (owned >= documents) {
+                        continue;
+                    }
+                    size_t slot = owned / threads;
+                    if ((rng() & 7) == 0) {
+                        map.erase(document_id(owned));
+                        written[slot] = -1;
+                    } else {
+                        int64_t internal_id = static_cast<int64_t>(++generation * documents + owned);
+                        map.assign(document_id(owned), internal_id);
+                        written[slot] = internal_id;
+                    }
+                }
+                local += 256;
+            }
+            operations.fetch_add(local);
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    consistent = consistent && ok.load();
+    return operations.load() / elapsed;
+}
+
+template <typename Map>
+bool check_final(const Map& map, int threads, size_t documents,
+                 const std::vector<std::vector<int64_t>>& last_written) {
+    for (size_t doc = 0; doc < documents; ++doc) {
+        int64_t expected = last_written[doc % threads][doc / threads];
+        if (map.find(document_id(doc)) != expected) {
+            std::cerr << "document " << doc << " maps to " << map.find(document_id(doc))
+                      << ", expected " << expected << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::stoi(argv[1]) : 8;
+    double seconds = argc > 2 ? std::stod(argv[2]) : 2.0;
+    size_t documents = argc > 3 ? std::stoul(argv[3]) : 1000000;
+    bool consistent = true;
+
+    auto initial = [&](std::vector<std::vector<int64_t>>& written, auto& map) {
+        written.assign(threads, std::vector<int64_t>(documents / threads + 1, -1));
+        for (size_t doc = 0; doc < documents; ++doc) {
+            map.assign(document_id(doc), static_cast<int64_t>(documents + doc));
+            written[doc % threads][doc / threads] = static_cast<int64_t>(documents + doc);
+        }
+    };
+
+    // Starts undersized so filling exercises growth
+    ConcurrentIdMap concurrent(documents / 4);
+    std::vector<std::vector<int64_t>> concurrent_written;
+    auto fill_start = Clock::now();
+    initial(concurrent_written, concurrent);
+    double fill_seconds = std::chrono::duration<double>(Clock::now() - fill_start).count();
+    double concurrent_rate = run(concurrent, threads, seconds, documents, concurrent_written, consistent);
+    bool concurrent_ok = check_final(concurrent, threads, documents, concurrent_written);
+    nlohmann::json stats = concurrent.get_statistics();
+
+    LockedIdMap locked;
+    std::vector<std::vector<int64_t>> locked_written;
+    initial(locked_written, locked);
+    double locked_rate = run(locked, threads, seconds, documents, locked_written, consistent);
+    bool locked_ok = check_final(locked, threads, documents, locked_written);
+
+    std::cout << "Threads: " << threads << ", " << documents << " documents, 1 in 16 operations writes" << std::endl;
+    std::cout << "ConcurrentHashMap:     " << concurrent_rate / 1e6 << " M ops/s (filled in "
+              << fill_seconds << " s)" << std::endl;
+    std::cout << "unordered_map + mutex: " << locked_rate / 1e6 << " M ops/s" << std::endl;
+    std::cout << "Speedup: " << concurrent_rate / locked_rate << "x" << std::endl;
+    std::cout << "  table " << stats["capacity"] << " slots, load " << stats["load_factor"]
+              << ", resizes " << stats["resizes"] << ", tombstones " << stats["tombstones"] << std::endl;
+
+    if (!consistent || !concurrent_ok || !locked_ok) {
+        std::cerr << "FAILED: " << (consistent ? "" : "lookup returned another document's id; ")
+                  << (concurrent_ok && locked_ok ? "" : "final mapping differs from the last write") << std::endl;
+        return 1;
+    }
+    return 0;
+}
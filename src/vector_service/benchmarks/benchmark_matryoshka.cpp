@@ -0,0 +1,128 @@
+/**
+ * @file benchmark_matryoshka.cpp
+ * @brief QPS/recall of coarse-to-fine Matryoshka search against full-dimension search
+ *
+ * Usage: vector_service_matryoshka_benchmark [vectors] [dimension] [queries]
+ *
+ * Vectors are clustered and their per-dimension spread decays with the
+ * dimension, as in Matryoshka-trained embeddings, then unit-normalized.
+ * Exact inner-product neighbours come from a full-dimension scan, which
+ * is also the QPS baseline; prefix lengths and candidate multipliers are
+ * swept against it, one query per search call as the service issues them.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+
+#include "matryoshka_index.h"
+#include "simd_kernels.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr int kTopK = 10;
+
+// Clustered, leading dimensions carrying most of the signal, unit length
+std::vector<float> make_vectors(size_t n, int d, size_t clusters, std::mt19937_64& rng) {
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> scales(d);
+    for (int j = 0; j < d; ++j) {
+        scales[j] = 1.0f / std::sqrt(1.0f + j / 32.0f);
+    }
+    std::mt19937_64 center_rng(7);
+    std::vector<float> centers(clusters * d);
+    for (size_t c = 0; c < clusters; ++c) {
+        for (int j = 0; j < d; ++j) {
+            centers[c * d + j] = normal(center_rng) * 2.0f * scales[j];
+        }
+    }
+    std::vector<float> vectors(n * d);
+    for (size_t i = 0; i < n; ++i) {
+        const float* center = &centers[(rng() % clusters) * d];
+        float* row = &vectors[i * d];
+        for (int j = 0; j < d; ++j) {
+            row[j] = center[j] + normal(rng) * scales[j];
+        }
+        simd::scale(row, 1.0f / std::sqrt(simd::norm_sqr(row, d)), d);
+    }
+    return vectors;
+}
+
+// Time one search call per query
+double run_queries(const MatryoshkaIndex& index, const std::vector<float>& queries, int d,
+                   const MatryoshkaSearchParameters& params, std::vector<faiss::idx_t>& labels) {
+    size_t nq = queries.size() / d;
+    labels.resize(nq * kTopK);
+    std::vector<float> distances(kTopK);
+    auto start = Clock::now();
+    for (size_t q = 0; q < nq; ++q) {
+        index.search(1, &queries[q * d], kTopK, distances.data(), &labels[q * kTopK], &params);
+    }
+    return nq / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double recall(const std::vector<faiss::idx_t>& truth, const std::vector<faiss::idx_t>& labels) {
+    size_t nq = truth.size() / kTopK;
+    size_t hits = 0;
+    for (size_t q = 0; q < nq; ++q) {
+        std::unordered_set<faiss::idx_t> expected(&truth[q * kTopK], &truth[q * kTopK] + kTopK);
+        for (int i = 0; i < kTopK; ++i) {
+            hits += expected.count(labels[q * kTopK + i]);
+        }
+    }
+    return static_cast<double>(hits) / truth.size();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t vectors = argc > 1 ? std::stoul(argv[1]) : 200000;
+    int d = argc > 2 ? std::stoi(argv[2]) : 1536;
+    size_t queries = argc > 3 ? std::stoul(argv[3]) : 200;
+
+    std::mt19937_64 rng(42);
+    auto base = make_vectors(vectors, d, 1024, rng);
+    auto query_vectors = make_vectors(queries, d, 1024, rng);
+
+    auto full = std::make_shared<faiss::IndexFlat>(d, faiss::METRIC_INNER_PRODUCT);
+    full->add(static_cast<faiss::idx_t>(vectors), base.data());
+    base = std::vector<float>();
+    std::cout << "Vectors: " << vectors << " x " << d << ", kernels " << simd::instruction_set() << std::endl;
+
+    MatryoshkaSearchParameters exact;
+    exact.prefix_dimension = d;
+    std::vector<faiss::idx_t> truth;
+    double baseline_qps = run_queries(MatryoshkaIndex(full, 1, 1), query_vectors, d, exact, truth);
+    std::cout << "full " << d << "-d scan: QPS " << baseline_qps << ", recall@" << kTopK << " 1" << std::endl;
+
+    // Each prefix length gets its own compact array, as the service stores it
+    std::vector<faiss::idx_t> labels;
+    for (int prefix : {64, 128, 256, 512}) {
+        if (prefix >= d) {
+            continue;
+        }
+        MatryoshkaIndex index(full, prefix, 4);
+        std::cout << "prefix " << prefix << ": array " << index.memory_bytes() / (1024 * 1024) << " MB" << std::endl;
+        for (int multiplier : {1, 2, 4, 8, 16}) {
+            MatryoshkaSearchParameters params;
+            params.prefix_dimension = prefix;
+            params.candidate_multiplier = multiplier;
+            double qps = run_queries(index, query_vectors, d, params, labels);
+            std::cout << "prefix " << prefix << " x" << multiplier
+                      << ": QPS " << qps << " (" << qps / baseline_qps << "x)"
+                      << ", recall@" << kTopK << " " << recall(truth, labels) << std::endl;
+        }
+    }
+    return 0;
+}
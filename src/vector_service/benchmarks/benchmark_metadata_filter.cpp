@@ -0,0 +1,140 @@
+/**
+ * @file benchmark_metadata_filter.cpp
+ * @brief Cost per candidate of compiled metadata filters against parsing metadata
+ *
+ * Usage: vector_service_metadata_filter_benchmark [documents] [candidates]
+ *
+ * Generates documents with a category, language, publication date, score,
+ * pinned flag and path, then evaluates filters of increasing complexity on
+ * random candidate ids three ways: parsing each candidate's JSON and
+ * comparing (what an equality-only post-filter costs), the compiled
+ * program one id at a time (as an IDSelector inside index traversal) and
+ * in batches. Every compiled result is checked against the per-id one.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "metadata_filter.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const char* const kCategories[] = {"news", "blog", "paper", "manual", "faq", "forum", "wiki", "report"};
+const char* const kLanguages[] = {"en", "de", "fr", "es", "it", "ja", "zh", "pt"};
+
+std::vector<std::string> make_documents(size_t count, std::mt19937& rng) {
+    std::vector<std::string> documents;
+    documents.reserve(count);
+    std::uniform_int_distribution<int> category(0, 7);
+    std::uniform_int_distribution<int> day(0, 3 * 365 - 1);
+    std::uniform_real_distribution<double> score(0.0, 1.0);
+    char date[16];
+    for (size_t i = 0; i < count; ++i) {
+        int days = day(rng);
+        std::snprintf(date, sizeof(date), "%04d-%02d-%02d", 2022 + days / 365, 1 + (days % 365) / 31 % 12,
+                      1 + days % 28);
+        nlohmann::json document = {
+            {"id", "doc-" + std::to_string(i)},
+            {"category", kCategories[category(rng)]},
+            {"lang", kLanguages[category(rng)]},
+            {"published", date},
+            {"score", score(rng)},
+            {"pinned", rng() % 16 == 0},
+            {"path", "docs/section" + std::to_string(i % 50) + "/page" + std::to_string(i)},
+            {"text", std::string(300 + i % 200, 'x')},
+        };
+        documents.push_back(document.dump());
+    }
+    return documents;
+}
+
+// The equality-only baseline: parse the candidate's metadata and compare
+double json_filter_ns(const std::vector<std::string>& documents, const std::vector<int64_t>& candidates,
+                      size_t& passed) {
+    passed = 0;
+    auto start = Clock::now();
+    for (int64_t id : candidates) {
+        auto document = nlohmann::json::parse(documents[id], nullptr, false);
+        auto it = document.find("category");
+        passed += it != document.end() && it->is_string() && it->get_ref<const std::string&>() == "paper";
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / candidates.size();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    size_t num_candidates = argc > 2 ? std::stoul(argv[2]) : 200000;
+
+    std::mt19937 rng(42);
+    auto documents = make_documents(count, rng);
+    auto columns = std::make_shared<MetadataColumns>();
+    auto start = Clock::now();
+    columns->set(0, documents);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << count << " documents indexed in " << seconds << " s, "
+              << columns->memory_bytes() / (1024 * 1024) << " MB of columns" << std::endl;
+
+    std::vector<int64_t> candidates(num_candidates);
+    std::uniform_int_distribution<int64_t> pick(0, static_cast<int64_t>(count) - 1);
+    for (auto& id : candidates) {
+        id = pick(rng);
+    }
+
+    size_t baseline_passed;
+    double baseline = json_filter_ns(documents, candidates, baseline_passed);
+    std::cout << "JSON parse + category equality: " << baseline << " ns/candidate" << std::endl;
+
+    const char* filters[] = {
+        "category = \"paper\"",
+        "published >= \"2023-06-01\" AND published < \"2024-01-01\"",
+        "category IN (\"news\", \"blog\", \"wiki\") AND NOT lang IN (\"de\", \"fr\")",
+        "path PREFIX \"docs/section1\" AND score BETWEEN 0.25 AND 0.75",
+        "(category = \"paper\" OR pinned = true) AND published >= \"2023-01-01T00:00:00Z\" "
+        "AND score > 0.5 AND lang != \"ja\" AND id EXISTS",
+    };
+
+    std::vector<uint8_t> batch(candidates.size());
+    for (const char* expression : filters) {
+        std::string error;
+        auto filter = MetadataFilter::compile(expression, {}, columns, error);
+        if (!filter) {
+            std::cerr << "Cannot compile " << expression << ": " << error << std::endl;
+            return 1;
+        }
+
+        size_t passed = 0;
+        start = Clock::now();
+        for (int64_t id : candidates) {
+            passed += filter->is_member(id);
+        }
+        double per_id = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / candidates.size();
+
+        start = Clock::now();
+        size_t batch_passed = filter->evaluate(candidates.data(), candidates.size(), batch.data());
+        double batched = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / candidates.size();
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            mismatches += batch[i] != static_cast<uint8_t>(filter->is_member(candidates[i]));
+        }
+
+        std::cout << expression << std::endl
+                  << "  " << filter->size() << " instructions, selectivity "
+                  << static_cast<double>(passed) / candidates.size() << ", per id " << per_id
+                  << " ns, batched " << batched << " ns per candidate"
+                  << (mismatches || batch_passed != passed ? ", MISMATCH" : "") << std::endl;
+    }
+    return 0;
+}
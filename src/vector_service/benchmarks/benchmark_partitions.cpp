@@ -0,0 +1,204 @@
+/**
+ * @file benchmark_partitions.cpp
+ * @brief Tenant-filtered search: global index with a selector vs per-tenant partitions
+ *
+ * Usage: vector_service_partition_benchmark [vectors] [dimension] [tenants] [queries] [hnsw_threshold]
+ *
+ * Spreads clustered vectors over tenants with Zipf-distributed sizes (a
+ * few large tenants, a long tail of small ones) and searches with
+ * `tenant = "..."` filters on tenants of several sizes, plus an IN-list
+ * over three of them. Each filter runs against a global HNSW index with
+ * the filter as its IDSelector, a global flat index with the same
+ * selector (exact, scanning every vector) and a PartitionedIndex on the
+ * tenant field. Recall is top-k overlap with the exact filtered search;
+ * latency is per query, one query per call.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+
+#include "metadata_filter.h"
+#include "partitioned_index.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr faiss::idx_t kTopK = 10;
+
+std::vector<float> clustered(size_t n, int d, const std::vector<float>& centers, std::mt19937& rng) {
+    size_t clusters = centers.size() / d;
+    std::uniform_int_distribution<size_t> pick(0, clusters - 1);
+    std::normal_distribution<float> noise(0.0f, 0.3f);
+    std::vector<float> x(n * d);
+    for (size_t i = 0; i < n; ++i) {
+        const float* center = &centers[pick(rng) * d];
+        for (int j = 0; j < d; ++j) {
+            x[i * d + j] = center[j] + noise(rng);
+        }
+    }
+    return x;
+}
+
+struct Result {
+    double recall = 0.0;
+    double mean_ms = 0.0;
+    double p99_ms = 0.0;
+};
+
+// One query per call; search fills one query's k results
+template <typename Search>
+Result run(const std::vector<float>& queries, int d, const std::vector<faiss::idx_t>& truth, Search search) {
+    size_t nq = queries.size() / d;
+    std::vector<float> distances(kTopK);
+    std::vector<faiss::idx_t> labels(kTopK);
+    std::vector<double> latencies(nq);
+    size_t found = 0;
+    size_t expected = 0;
+    for (size_t q = 0; q < nq; ++q) {
+        auto start = Clock::now();
+        search(&queries[q * d], distances.data(), labels.data());
+        latencies[q] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::unordered_set<faiss::idx_t> relevant;
+        for (faiss::idx_t i = 0; i < kTopK; ++i) {
+            if (truth[q * kTopK + i] >= 0) {
+                relevant.insert(truth[q * kTopK + i]);
+            }
+        }
+        expected += relevant.size();
+        for (faiss::idx_t label : labels) {
+            found += relevant.count(label);
+        }
+    }
+    Result result;
+    result.recall = expected ? static_cast<double>(found) / expected : 1.0;
+    for (double latency : latencies) {
+        result.mean_ms += latency / nq;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.p99_ms = latencies[std::min(nq - 1, nq * 99 / 100)];
+    return result;
+}
+
+std::string tenant_name(size_t rank) {
+    return "tenant-" + std::to_string(rank);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 500000;
+    int d = argc > 2 ? std::stoi(argv[2]) : 128;
+    size_t tenants = argc > 3 ? std::stoul(argv[3]) : 1000;
+    size_t num_queries = argc > 4 ? std::stoul(argv[4]) : 200;
+    size_t hnsw_threshold = argc > 5 ? std::stoul(argv[5]) : 50000;
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> gaussian;
+    std::vector<float> centers(1000 * d);
+    for (auto& value : centers) {
+        value = gaussian(rng);
+    }
+    auto vectors = clustered(count, d, centers, rng);
+    auto queries = clustered(num_queries, d, centers, rng);
+
+    // Tenant of rank r holds a share proportional to 1 / r
+    std::vector<double> weights(tenants);
+    for (size_t r = 0; r < tenants; ++r) {
+        weights[r] = 1.0 / static_cast<double>(r + 1);
+    }
+    std::discrete_distribution<size_t> tenant(weights.begin(), weights.end());
+    std::vector<std::string> metadata(count);
+    std::vector<std::string> values(count);
+    std::vector<size_t> sizes(tenants, 0);
+    for (size_t i = 0; i < count; ++i) {
+        size_t rank = tenant(rng);
+        sizes[rank]++;
+        values[i] = tenant_name(rank);
+        metadata[i] = "{\"tenant\": \"" + values[i] + "\"}";
+    }
+    auto columns = std::make_shared<MetadataColumns>();
+    columns->set(0, metadata);
+
+    auto start = Clock::now();
+    faiss::IndexHNSWFlat hnsw(d, 32);
+    hnsw.hnsw.efConstruction = 100;
+    hnsw.add(static_cast<faiss::idx_t>(count), vectors.data());
+    std::cout << count << " x " << d << " global HNSW built in "
+              << std::chrono::duration<double>(Clock::now() - start).count() << " s" << std::endl;
+    faiss::IndexFlatL2 flat(d);
+    flat.add(static_cast<faiss::idx_t>(count), vectors.data());
+
+    start = Clock::now();
+    PartitionedIndex partitions("tenant", d, faiss::METRIC_L2, hnsw_threshold);
+    std::vector<faiss::idx_t> rows(count);
+    for (size_t i = 0; i < count; ++i) {
+        rows[i] = static_cast<faiss::idx_t>(i);
+    }
+    partitions.add(rows.data(), count, vectors.data(), values);
+    std::cout << partitions.partition_count() << " partitions built in "
+              << std::chrono::duration<double>(Clock::now() - start).count() << " s ("
+              << partitions.memory_bytes() / (1024 * 1024) << " MB)" << std::endl;
+
+    std::vector<std::pair<std::string, std::string>> filters;
+    for (size_t rank : {0, 9, 99, 999}) {
+        if (rank < tenants) {
+            filters.emplace_back("rank " + std::to_string(rank + 1), "tenant = \"" + tenant_name(rank) + "\"");
+        }
+    }
+    filters.emplace_back("IN x3", "tenant IN (\"" + tenant_name(std::min<size_t>(4, tenants - 1)) + "\", \"" +
+                                      tenant_name(std::min<size_t>(49, tenants - 1)) + "\", \"" +
+                                      tenant_name(std::min<size_t>(499, tenants - 1)) + "\")");
+
+    std::printf("%-8s | %-9s | %-16s | %-16s | %-16s\n", "tenant", "documents", "global HNSW", "global scan",
+                "partitioned");
+    std::printf("%-8s | %-9s | %-16s | %-16s | %-16s\n", "", "", "recall  ms  p99", "recall  ms  p99",
+                "recall  ms  p99");
+    for (const auto& entry : filters) {
+        std::string error;
+        auto filter = MetadataFilter::compile(entry.second, {}, columns, error);
+        if (!filter) {
+            std::cerr << "Cannot compile " << entry.second << ": " << error << std::endl;
+            return 1;
+        }
+        std::vector<uint64_t> bitmap((count + 63) / 64);
+        size_t matches = filter->evaluate_range(0, count, bitmap.data());
+
+        faiss::SearchParameters flat_params;
+        flat_params.sel = filter.get();
+        std::vector<float> truth_distances(num_queries * kTopK);
+        std::vector<faiss::idx_t> truth(num_queries * kTopK);
+        flat.search(static_cast<faiss::idx_t>(num_queries), queries.data(), kTopK, truth_distances.data(),
+                    truth.data(), &flat_params);
+
+        faiss::SearchParametersHNSW hnsw_params;
+        hnsw_params.sel = filter.get();
+        hnsw_params.efSearch = 64;
+        Result global = run(queries, d, truth, [&](const float* query, float* distances, faiss::idx_t* labels) {
+            hnsw.search(1, query, kTopK, distances, labels, &hnsw_params);
+        });
+        Result scan = run(queries, d, truth, [&](const float* query, float* distances, faiss::idx_t* labels) {
+            flat.search(1, query, kTopK, distances, labels, &flat_params);
+        });
+        Result routed = run(queries, d, truth, [&](const float* query, float* distances, faiss::idx_t* labels) {
+            partitions.search(1, query, kTopK, *filter, 64, distances, labels);
+        });
+        std::printf("%-8s | %9zu | %.3f %5.2f %5.2f | %.3f %5.2f %5.2f | %.3f %5.2f %5.2f\n", entry.first.c_str(),
+                    matches, global.recall, global.mean_ms, global.p99_ms, scan.recall, scan.mean_ms, scan.p99_ms,
+                    routed.recall, routed.mean_ms, routed.p99_ms);
+    }
+    std::cout << partitions.get_statistics().dump(2) << std::endl;
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file benchmark_result_codec.cpp
+ * @brief Size and decode cost of cached results: JSON vs binary codec
+ *
+ * Usage: vector_service_codec_benchmark [k] [iterations] [metadata_bytes]
+ *
+ * Results use random ids from a 100k-document store, descending similarity
+ * scores, a 32-list IVF dependency, and metadata strings of the given size.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "result_codec.h"
+#include "vector_search.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[]) {
+    int k = argc > 1 ? std::stoi(argv[1]) : 10;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 100000;
+    size_t metadata_bytes = argc > 3 ? std::stoul(argv[3]) : 256;
+
+    std::vector<std::string> store(100000);
+    for (auto& metadata : store) {
+        metadata.assign(metadata_bytes, 'm');
+    }
+
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> id_dist(0, static_cast<int64_t>(store.size()) - 1);
+    std::uniform_real_distribution<float> score_dist(0.7f, 1.0f);
+
+    SearchResult result;
+    for (int i = 0; i < k; ++i) {
+        int64_t id = id_dist(rng);
+        result.indices.push_back(id);
+        result.scores.push_back(score_dist(rng));
+        result.metadata.push_back(store[id]);
+    }
+    std::sort(result.scores.rbegin(), result.scores.rend());
+    result.latency_ms = 0.0;
+    result.from_cache = false;
+
+    CacheDependency dependency;
+    dependency.epoch = 3;
+    dependency.global_version = 123456;
+    for (int64_t list = 0; list < 32; ++list) {
+        dependency.list_versions.emplace_back(list * 131 % 4096, 1000 + list);
+    }
+
+    // JSON value as previously stored in Redis
+    nlohmann::json json_value = {
+        {"indices", result.indices},
+        {"scores", result.scores},
+        {"metadata", result.metadata},
+        {"dependency", cache_dependency_to_json(dependency)},
+    };
+    std::string json_encoded = json_value.dump();
+
+    std::string binary_fp16 = result_codec::encode(result, &dependency, true,
+                                                   result_codec::MetadataMode::REFERENCE);
+    std::string binary_fp32 = result_codec::encode(result, &dependency, false,
+                                                   result_codec::MetadataMode::REFERENCE);
+
+    result_codec::MetadataResolver resolver = [&](int64_t id, std::string& metadata) {
+        if (id < 0 || static_cast<size_t>(id) >= store.size()) {
+            return false;
+        }
+        metadata = store[id];
+        return true;
+    };
+
+    std::cout << "k=" << k << ", metadata " << metadata_bytes << " bytes" << std::endl;
+    std::cout << "  json:        " << json_encoded.size() << " bytes" << std::endl;
+    std::cout << "  binary fp32: " << binary_fp32.size() << " bytes" << std::endl;
+    std::cout << "  binary fp16: " << binary_fp16.size() << " bytes ("
+              << static_cast<double>(json_encoded.size()) / binary_fp16.size() << "x smaller)" << std::endl;
+
+    size_t checksum = 0;
+
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        auto parsed = nlohmann::json::parse(json_encoded);
+        SearchResult decoded;
+        decoded.indices = parsed["indices"].get<std::vector<int64_t>>();
+        decoded.scores = parsed["scores"].get<std::vector<float>>();
+        decoded.metadata = parsed["metadata"].get<std::vector<std::string>>();
+        CacheDependency decoded_dependency = cache_dependency_from_json(parsed["dependency"]);
+        checksum += decoded.indices.size() + decoded_dependency.list_versions.size();
+    }
+    double json_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        SearchResult decoded;
+        CacheDependency decoded_dependency;
+        if (!result_codec::decode(binary_fp16.data(), binary_fp16.size(), decoded,
+                                  &decoded_dependency, resolver)) {
+            std::cerr << "decode failed" << std::endl;
+            return 1;
+        }
+        checksum += decoded.indices.size() + decoded_dependency.list_versions.size();
+    }
+    double binary_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+
+    std::cout << "  json decode:   " << json_us << " us" << std::endl;
+    std::cout << "  binary decode: " << binary_us << " us (metadata rehydrated)" << std::endl;
+    std::cout << "  (checksum " << checksum << ")" << std::endl;
+    return 0;
+}
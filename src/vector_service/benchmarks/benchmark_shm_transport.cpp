@@ -0,0 +1,140 @@
+/**
+ * @file benchmark_shm_transport.cpp
+ * @brief Round-trip latency of the shared-memory transport vs loopback HTTP
+ *
+ * Usage: vector_service_shm_benchmark [shm_name] [http_port] [queries] [k]
+ *
+ * Both paths hit the same running vector_service; the HTTP path posts
+ * {"query_vector": [...], "k": k} to /search on 127.0.0.1.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+
+#include "shm_transport.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+void report(const std::string& label, std::vector<double>& latencies_us, double elapsed_s) {
+    if (latencies_us.empty()) {
+        std::cout << label << ": no successful queries" << std::endl;
+        return;
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&](double p) {
+        return latencies_us[std::min(latencies_us.size() - 1,
+                                     static_cast<size_t>(p * latencies_us.size()))];
+    };
+    std::cout << label << ": " << latencies_us.size() / elapsed_s << " queries/s"
+              << ", p50 " << percentile(0.50) << " us"
+              << ", p99 " << percentile(0.99) << " us"
+              << ", p999 " << percentile(0.999) << " us" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string shm_name = argc > 1 ? argv[1] : "/neurorag_vector_service";
+    int http_port = argc > 2 ? std::stoi(argv[2]) : 8001;
+    int num_queries = argc > 3 ? std::stoi(argv[3]) : 10000;
+    int k = argc > 4 ? std::stoi(argv[4]) : 10;
+
+    ShmTransportClient client;
+    if (!client.attach(shm_name)) {
+        return 1;
+    }
+    int dimension = client.dimension();
+    std::cout << "Attached to " << shm_name << " (dimension " << dimension
+              << ", ring slots " << client.ring_slots() << ")" << std::endl;
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<std::vector<float>> queries(256, std::vector<float>(dimension));
+    for (auto& query : queries) {
+        for (auto& value : query) {
+            value = dist(rng);
+        }
+    }
+
+    // Shared memory, one query in flight: pure round-trip latency
+    std::vector<double> shm_latencies;
+    shm_latencies.reserve(num_queries);
+    auto start = Clock::now();
+    for (int i = 0; i < num_queries; ++i) {
+        auto sent = Clock::now();
+        float* slot = client.begin_request();
+        const auto& query = queries[i % queries.size()];
+        std::copy(query.begin(), query.end(), slot);
+        client.commit_request(k, 0.0f);
+
+        shm::ResponseView view{};
+        if (!client.wait_response(view, 1000000)) {
+            std::cerr << "Shared-memory response timed out" << std::endl;
+            break;
+        }
+        if (view.status == shm::ResponseStatus::OK) {
+            shm_latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+        }
+        client.release_response();
+    }
+    report("shm (sequential)", shm_latencies, std::chrono::duration<double>(Clock::now() - start).count());
+
+    // Shared memory, ring kept full: throughput with out-of-order completion
+    size_t completed = 0;
+    size_t submitted = 0;
+    start = Clock::now();
+    while (completed < static_cast<size_t>(num_queries)) {
+        while (submitted < static_cast<size_t>(num_queries)) {
+            float* slot = client.begin_request();
+            if (!slot) {
+                break;
+            }
+            const auto& query = queries[submitted % queries.size()];
+            std::copy(query.begin(), query.end(), slot);
+            client.commit_request(k, 0.0f);
+            ++submitted;
+        }
+        shm::ResponseView view{};
+        if (!client.wait_response(view, 1000000)) {
+            std::cerr << "Shared-memory response timed out" << std::endl;
+            break;
+        }
+        client.release_response();
+        ++completed;
+    }
+    double pipelined_s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "shm (pipelined): " << completed / pipelined_s << " queries/s" << std::endl;
+    client.detach();
+
+    // Loopback HTTP/JSON, one query in flight
+    httplib::Client http("127.0.0.1", http_port);
+    http.set_keep_alive(true);
+    std::vector<double> http_latencies;
+    http_latencies.reserve(num_queries);
+    start = Clock::now();
+    for (int i = 0; i < num_queries; ++i) {
+        auto sent = Clock::now();
+        nlohmann::json body;
+        body["query_vector"] = queries[i % queries.size()];
+        body["k"] = k;
+        auto response = http.Post("/search", body.dump(), "application/json");
+        if (response && response->status == 200) {
+            auto parsed = nlohmann::json::parse(response->body, nullptr, false);
+            if (!parsed.is_discarded()) {
+                http_latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+            }
+        }
+    }
+    report("http (sequential)", http_latencies, std::chrono::duration<double>(Clock::now() - start).count());
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file benchmark_stream_rpc.cpp
+ * @brief Throughput and latency benchmark for the streaming search RPC
+ *
+ * Usage: vector_service_rpc_benchmark [host] [port] [dimension] [queries] [window] [k]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "stream_rpc_client.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[]) {
+    std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    int port = argc > 2 ? std::stoi(argv[2]) : 8002;
+    int dimension = argc > 3 ? std::stoi(argv[3]) : 1536;
+    int num_queries = argc > 4 ? std::stoi(argv[4]) : 10000;
+    uint32_t window = argc > 5 ? static_cast<uint32_t>(std::stoul(argv[5])) : 64;
+    int k = argc > 6 ? std::stoi(argv[6]) : 10;
+
+    StreamRpcClient client;
+    if (!client.connect(host, port, window)) {
+        return 1;
+    }
+    std::cout << "Connected to " << host << ":" << port
+              << ", granted window " << client.window() << std::endl;
+
+    // A small pool of random queries keeps generation out of the timed loop
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<std::vector<float>> queries(256, std::vector<float>(dimension));
+    for (auto& query : queries) {
+        for (auto& value : query) {
+            value = dist(rng);
+        }
+    }
+
+    std::vector<Clock::time_point> sent_at(num_queries + 1);
+    std::vector<double> latencies_us;
+    latencies_us.reserve(num_queries);
+    std::mutex latencies_mutex;
+    size_t errors = 0;
+
+    auto start = Clock::now();
+    for (int i = 0; i < num_queries; ++i) {
+        uint64_t slot = static_cast<uint64_t>(i) + 1;
+        sent_at[slot] = Clock::now();
+        uint64_t id = client.submit(queries[i % queries.size()], k, 0.0f,
+            [&, slot](const StreamSearchResult& result) {
+                double us = std::chrono::duration<double, std::micro>(Clock::now() - sent_at[slot]).count();
+                std::lock_guard<std::mutex> lock(latencies_mutex);
+                if (result.error.empty()) {
+                    latencies_us.push_back(us);
+                } else {
+                    ++errors;
+                }
+            });
+        if (id == 0) {
+            std::cerr << "Connection lost after " << i << " queries" << std::endl;
+            break;
+        }
+    }
+    client.drain();
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    client.close();
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&](double p) {
+        if (latencies_us.empty()) {
+            return 0.0;
+        }
+        size_t index = std::min(latencies_us.size() - 1,
+                                static_cast<size_t>(p * latencies_us.size()));
+        return latencies_us[index];
+    };
+
+    std::cout << "Completed: " << latencies_us.size() << " ok, " << errors << " errors" << std::endl;
+    std::cout << "Throughput: " << latencies_us.size() / elapsed_s << " queries/s" << std::endl;
+    std::cout << "Latency p50: " << percentile(0.50) << " us" << std::endl;
+    std::cout << "Latency p99: " << percentile(0.99) << " us" << std::endl;
+    std::cout << "Latency p999: " << percentile(0.999) << " us" << std::endl;
+    return errors == 0 ? 0 : 1;
+}
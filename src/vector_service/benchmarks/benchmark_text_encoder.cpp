@@ -0,0 +1,235 @@
+/**
+ * @file benchmark_text_encoder.cpp
+ * @brief Sentences per second and per-query latency of the in-process text encoder
+ *
+ * Usage: vector_service_text_encoder_benchmark [model.nrte] [texts] [threads]
+ *
+ * Without a model file a randomly initialized all-MiniLM-L6-v2-shaped
+ * encoder (30522 tokens, 6 layers, 384 hidden, 12 heads, 1536
+ * intermediate) is generated, which costs the same to run as the real
+ * one. Queries are 6-20 words. Each precision is timed one query per call
+ * (the latency of an unbatched request) and in batches as QueryEmbedder
+ * forms them under concurrent load; int8 embeddings are compared with
+ * fp32 ones by cosine similarity.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "checksum.h"
+#include "simd_kernels.h"
+#include "text_encoder.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::vector<std::string> synthetic_vocab(size_t size) {
+    std::vector<std::string> vocab = {"[PAD]", "[UNK]", "[CLS]", "[SEP]", "[MASK]"};
+    for (char c : std::string("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~")) {
+        vocab.emplace_back(1, c);
+    }
+    for (char c = 'a'; c <= 'z'; ++c) {
+        vocab.emplace_back(1, c);
+        vocab.push_back(std::string("##") + c);
+    }
+    const char* syllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "ti", "ve", "zo", "pa", "de", "gu", "fi", "ho"};
+    for (size_t i = 0; vocab.size() < size; ++i) {
+        std::string word;
+        for (size_t n = i + 1; n > 0; n /= 14) {
+            word += syllables[n % 14];
+        }
+        vocab.push_back(i % 5 == 4 ? "##" + word : word);
+    }
+    return vocab;
+}
+
+// A model file image with N(0, 0.05) weights and identity LayerNorms
+std::vector<uint8_t> random_model(const TextEncoderHeader& shape, const std::vector<std::string>& vocab) {
+    TextEncoderHeader header = shape;
+    std::string vocab_text;
+    for (const auto& token : vocab) {
+        vocab_text += token + "\n";
+    }
+    header.vocab_bytes = static_cast<uint32_t>(vocab_text.size());
+
+    std::vector<float> tensors;
+    std::mt19937 rng(7);
+    std::normal_distribution<float> normal(0.0f, 0.05f);
+    auto matrix = [&](size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            tensors.push_back(normal(rng));
+        }
+    };
+    auto norm = [&](size_t dimension) {
+        tensors.insert(tensors.end(), dimension, 1.0f);
+        tensors.insert(tensors.end(), dimension, 0.0f);
+    };
+    size_t hidden = header.hidden_size;
+    size_t intermediate = header.intermediate_size;
+    matrix((size_t{header.vocab_size} + header.max_positions + header.type_vocab_size) * hidden);
+    norm(hidden);
+    for (uint32_t layer = 0; layer < header.num_layers; ++layer) {
+        for (int projection = 0; projection < 4; ++projection) {
+            matrix(hidden * hidden + hidden);
+        }
+        norm(hidden);
+        matrix(intermediate * hidden + intermediate);
+        matrix(hidden * intermediate + hidden);
+        norm(hidden);
+    }
+
+    std::vector<uint8_t> image(sizeof(header) + vocab_text.size() + tensors.size() * sizeof(float));
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + sizeof(header), vocab_text.data(), vocab_text.size());
+    std::memcpy(image.data() + sizeof(header) + vocab_text.size(), tensors.data(), tensors.size() * sizeof(float));
+    uint32_t checksum = crc32c(image.data(), image.size());
+    image.resize(image.size() + sizeof(checksum));
+    std::memcpy(image.data() + image.size() - sizeof(checksum), &checksum, sizeof(checksum));
+    return image;
+}
+
+std::vector<std::string> make_queries(size_t count, const std::vector<std::string>& vocab, std::mt19937& rng) {
+    std::vector<std::string> words;
+    for (const auto& token : vocab) {
+        if (token.size() > 1 && token[0] != '[' && token[0] != '#') {
+            words.push_back(token);
+        }
+    }
+    std::uniform_int_distribution<size_t> length(6, 20);
+    std::uniform_int_distribution<size_t> pick(0, words.size() - 1);
+    std::vector<std::string> queries;
+    for (size_t q = 0; q < count; ++q) {
+        std::string text;
+        for (size_t w = length(rng); w > 0; --w) {
+            text += words[pick(rng)];
+            // Occasional punctuation and words split into pieces
+            text += rng() % 8 == 0 ? ", " : rng() % 6 == 0 ? "s " : " ";
+        }
+        text.back() = '?';
+        queries.push_back(std::move(text));
+    }
+    return queries;
+}
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+void run(const TextEncoder& encoder, const std::vector<std::string>& queries) {
+    std::vector<float> embeddings;
+    encoder.encode({queries[0]}, embeddings);   // warm up
+
+    std::vector<double> latencies;
+    auto start = Clock::now();
+    for (const auto& query : queries) {
+        auto query_start = Clock::now();
+        encoder.encode({query}, embeddings);
+        latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - query_start).count());
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  batch 1: " << queries.size() / seconds << " sentences/s, latency p50 "
+              << percentile(latencies, 0.5) << " ms, p99 " << percentile(latencies, 0.99) << " ms" << std::endl;
+
+    for (size_t batch_size : {4, 8, 16, 32}) {
+        size_t batches = 0;
+        start = Clock::now();
+        for (size_t first = 0; first + batch_size <= queries.size(); first += batch_size) {
+            std::vector<std::string> batch(queries.begin() + first, queries.begin() + first + batch_size);
+            encoder.encode(batch, embeddings);
+            ++batches;
+        }
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (batches > 0) {
+            std::cout << "  batch " << batch_size << ": " << batches * batch_size / seconds
+                      << " sentences/s, " << seconds * 1000.0 / batches << " ms per batch" << std::endl;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string model_path = argc > 1 ? argv[1] : "";
+    size_t count = argc > 2 ? std::stoul(argv[2]) : 256;
+    int threads = argc > 3 ? std::stoi(argv[3]) : 0;
+
+    std::vector<uint8_t> image;
+    std::vector<std::string> vocab;
+    if (model_path.empty()) {
+        TextEncoderHeader shape{};
+        shape.magic = TextEncoderHeader::kMagic;
+        shape.version = TextEncoderHeader::kVersion;
+        shape.flags = TextEncoderHeader::kLowercase | TextEncoderHeader::kNormalize;
+        shape.vocab_size = 30522;
+        shape.hidden_size = 384;
+        shape.num_layers = 6;
+        shape.num_heads = 12;
+        shape.intermediate_size = 1536;
+        shape.max_positions = 512;
+        shape.type_vocab_size = 2;
+        shape.max_sequence_length = 256;
+        shape.layer_norm_eps = 1e-12f;
+        vocab = synthetic_vocab(shape.vocab_size);
+        image = random_model(shape, vocab);
+        std::cout << "Random all-MiniLM-L6-v2-shaped model" << std::endl;
+    }
+
+    std::string error;
+    std::unique_ptr<TextEncoder> encoders[2];
+    for (int quantize = 0; quantize < 2; ++quantize) {
+        encoders[quantize] = image.empty()
+            ? TextEncoder::load(model_path, quantize != 0, threads, error)
+            : TextEncoder::deserialize(image.data(), image.size(), quantize != 0, threads, error);
+        if (!encoders[quantize]) {
+            std::cerr << "Cannot load model: " << error << std::endl;
+            return 1;
+        }
+    }
+    if (vocab.empty()) {
+        vocab = synthetic_vocab(1000);
+    }
+
+    std::mt19937 rng(42);
+    auto queries = make_queries(count, vocab, rng);
+    size_t tokens = 0;
+    std::vector<int32_t> ids;
+    for (const auto& query : queries) {
+        encoders[0]->tokenizer().encode(query, encoders[0]->max_sequence_length(), ids);
+        tokens += ids.size();
+    }
+    std::cout << queries.size() << " queries, " << static_cast<double>(tokens) / queries.size()
+              << " tokens on average" << std::endl;
+
+    for (const auto& encoder : encoders) {
+        std::cout << encoder->describe().dump() << std::endl;
+        run(*encoder, queries);
+    }
+
+    // int8 against fp32, text by text
+    std::vector<float> fp32;
+    std::vector<float> int8;
+    encoders[0]->encode(queries, fp32);
+    encoders[1]->encode(queries, int8);
+    int d = encoders[0]->dimension();
+    double sum = 0.0;
+    double worst = 1.0;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const float* a = &fp32[q * d];
+        const float* b = &int8[q * d];
+        double cosine = simd::dot(a, b, d) / std::sqrt(simd::norm_sqr(a, d) * simd::norm_sqr(b, d));
+        sum += cosine;
+        worst = std::min(worst, cosine);
+    }
+    std::cout << "int8 vs fp32 cosine: mean " << sum / queries.size() << ", min " << worst << std::endl;
+    return 0;
+}
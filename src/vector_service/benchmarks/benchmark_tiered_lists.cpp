@@ -0,0 +1,181 @@
+/**
+ * @file benchmark_tiered_lists.cpp
+ * @brief Probe latency of tiered (DRAM + NVMe) inverted lists vs all in memory
+ *
+ * Usage: vector_service_tiered_benchmark [cold_path] [nlist] [vectors]
+ *        [nprobe] [memory_fraction] [queries] [threads]
+ *
+ * Builds IVF-shaped lists of 128-byte codes, picks probed lists with a
+ * Zipf(1) skew like real query traffic, and times prefetching plus scanning
+ * every probed list per query. The tiered store gets memory_fraction of the
+ * lists' size, two thirds for the hot tier and one third for the pool.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <faiss/invlists/InvertedLists.h>
+
+#include "tiered_invlists.h"
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t kCodeSize = 128;
+
+// Stand-in for an SQ8 distance scan over the whole list
+float scan_list(const faiss::InvertedLists& lists, size_t list_no, const uint8_t* query) {
+    size_t n = lists.list_size(list_no);
+    if (n == 0) {
+        return 0.0f;
+    }
+    const uint8_t* codes = lists.get_codes(list_no);
+    const faiss::idx_t* ids = lists.get_ids(list_no);
+    float best = 1e30f;
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* code = codes + i * kCodeSize;
+        float distance = 0.0f;
+        for (size_t j = 0; j < kCodeSize; ++j) {
+            float diff = static_cast<float>(code[j]) - static_cast<float>(query[j]);
+            distance += diff * diff;
+        }
+        best = std::min(best, distance + static_cast<float>(ids[i] & 1));
+    }
+    lists.release_codes(list_no, codes);
+    lists.release_ids(list_no, ids);
+    return best;
+}
+
+std::vector<std::vector<faiss::idx_t>> make_probes(size_t queries, size_t nlist, size_t nprobe, uint64_t seed) {
+    // Zipf(1) over lists in a shuffled order, so hot lists are not adjacent
+    std::vector<double> weights(nlist);
+    for (size_t i = 0; i < nlist; ++i) {
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::vector<faiss::idx_t> order(nlist);
+    for (size_t i = 0; i < nlist; ++i) {
+        order[i] = static_cast<faiss::idx_t>(i);
+    }
+    std::mt19937_64 rng(7);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    std::mt19937_64 query_rng(seed);
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    std::vector<std::vector<faiss::idx_t>> probes(queries);
+    for (auto& probe : probes) {
+        while (probe.size() < nprobe) {
+            faiss::idx_t list_no = order[zipf(query_rng)];
+            if (std::find(probe.begin(), probe.end(), list_no) == probe.end()) {
+                probe.push_back(list_no);
+            }
+        }
+    }
+    return probes;
+}
+
+struct Latency {
+    double p50_ms;
+    double p99_ms;
+};
+
+Latency run(const faiss::InvertedLists& lists, const std::vector<std::vector<faiss::idx_t>>& probes, int threads) {
+    std::vector<double> latencies(probes.size());
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            uint8_t query[kCodeSize];
+            std::fill(query, query + kCodeSize, static_cast<uint8_t>(t * 13));
+            volatile float sink = 0.0f;
+            for (size_t q = t; q < probes.size(); q += threads) {
+                auto start = Clock::now();
+                const auto& probe = probes[q];
+                lists.prefetch_lists(probe.data(), static_cast<int>(probe.size()));
+                for (faiss::idx_t list_no : probe) {
+                    sink = sink + scan_list(lists, list_no, query);
+                }
+                latencies[q] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return {latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string cold_path = argc > 1 ? argv[1] : "/tmp/neurorag_tiered_benchmark.bin";
+    size_t nlist = argc > 2 ? std::stoul(argv[2]) : 4096;
+    size_t vectors = argc > 3 ? std::stoul(argv[3]) : 2000000;
+    size_t nprobe = argc > 4 ? std::stoul(argv[4]) : 32;
+    double memory_fraction = argc > 5 ? std::stod(argv[5]) : 1.0 / 3.0;
+    size_t queries = argc > 6 ? std::stoul(argv[6]) : 20000;
+    int threads = argc > 7 ? std::stoi(argv[7]) : 8;
+
+    // List sizes vary like k-means clusters do
+    faiss::ArrayInvertedLists memory_lists(nlist, kCodeSize);
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> size_dist(0.0, 0.5);
+    std::vector<double> sizes(nlist);
+    double total_weight = 0.0;
+    for (auto& size : sizes) {
+        size = size_dist(rng);
+        total_weight += size;
+    }
+    size_t total_bytes = 0;
+    std::vector<uint8_t> code(kCodeSize);
+    for (size_t list_no = 0; list_no < nlist; ++list_no) {
+        size_t n = static_cast<size_t>(sizes[list_no] / total_weight * vectors);
+        for (size_t i = 0; i < n; ++i) {
+            for (auto& byte : code) {
+                byte = static_cast<uint8_t>(rng());
+            }
+            faiss::idx_t id = static_cast<faiss::idx_t>(list_no * vectors + i);
+            memory_lists.add_entries(list_no, 1, &id, code.data());
+        }
+        total_bytes += n * (kCodeSize + sizeof(faiss::idx_t));
+    }
+
+    if (!TieredInvertedLists::write_cold_file(memory_lists, cold_path)) {
+        return 1;
+    }
+    size_t budget = static_cast<size_t>(total_bytes * memory_fraction);
+    TieredInvertedLists tiered_lists(nlist, kCodeSize, budget * 2 / 3, budget / 3,
+                                     std::make_shared<AsyncFileReader>());
+    if (!tiered_lists.open(cold_path)) {
+        return 1;
+    }
+
+    // Learn the traffic on one query set, measure on another from the same distribution
+    auto warmup = make_probes(queries, nlist, nprobe, 1);
+    auto measured = make_probes(queries, nlist, nprobe, 2);
+    run(tiered_lists, warmup, threads);
+    tiered_lists.rebalance(0.0);
+
+    Latency memory = run(memory_lists, measured, threads);
+    Latency tiered = run(tiered_lists, measured, threads);
+    auto stats = tiered_lists.get_statistics();
+
+    std::cout << "Lists: " << nlist << " (" << total_bytes / (1024 * 1024) << " MB), nprobe " << nprobe
+              << ", " << threads << " threads, reads via " << stats["reader"]["backend"] << std::endl;
+    std::cout << "In memory:            p50 " << memory.p50_ms << " ms, p99 " << memory.p99_ms << " ms" << std::endl;
+    std::cout << "Tiered (" << memory_fraction * 100 << "% memory): p50 " << tiered.p50_ms
+              << " ms, p99 " << tiered.p99_ms << " ms" << std::endl;
+    std::cout << "p99 ratio: " << tiered.p99_ms / memory.p99_ms
+              << ", memory hit rate: " << stats["memory_hit_rate"] << std::endl;
+
+    std::remove(cold_path.c_str());
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file admin_server.h
+ * @brief Operational HTTP endpoints served on a separate port
+ *
+ * Keeps probes and operator endpoints off the search listener, so a
+ * saturated search server still answers its probes and admin routes are
+ * never exposed through the public Service.
+ *
+ *   GET /health  liveness: the engine answers is_healthy()
+ *   GET /ready   readiness: 200 once ReadinessGate::is_ready(), else 503;
+ *                the body carries phase, residency and probe latency
+ *   GET /admin/tiering  hot/cold list tier sizes and hit rates
+ *   GET /admin/delta    delta segment sizes, tombstones and merge counters
+ *   POST /admin/delta/merge  merge the delta index now
+ *   POST /admin/index/snapshot  write a segmented snapshot to INDEX_SNAPSHOT_DIR
+ *   POST /admin/index/reload  {"path": ..., "mmap": false} load a new index
+ *                generation in the background and switch to it (202; 409
+ *                while another reload runs)
+ *   GET /admin/index/generation  serving generation and reload status
+ *   GET /admin/memory   memory budget and per-component usage
+ *   GET /admin/preprocessing  vector transform applied before indexing
+ *   GET /admin/matryoshka  prefix length and first-pass counters
+ *   GET /admin/embeddings  query embedding cache and batching counters
+ *   GET /admin/metadata  filterable metadata fields and filter counters
+ *   POST /admin/metadata/filter  {"filter": ...} compile a filter and
+ *                count the documents it matches (400 if it does not compile)
+ */
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+namespace httplib {
+class Server;
+}
+
+namespace neurorag {
+
+class VectorSearchEngine;
+class ReadinessGate;
+class IndexReloader;
+
+/**
+ * @brief HTTP server for probes and administrative endpoints
+ */
+class AdminServer {
+public:
+    /**
+     * @brief Constructor
+     * @param host Bind address
+     * @param port Bind port
+     * @param engine Search engine (not owned)
+     * @param readiness Readiness gate (not owned)
+     */
+    AdminServer(const std::string& host, int port,
+                VectorSearchEngine* engine, ReadinessGate* readiness);
+    ~AdminServer();
+
+    AdminServer(const AdminServer&) = delete;
+    AdminServer& operator=(const AdminServer&) = delete;
+
+    /**
+     * @brief Bind the port and start serving in the background
+     * @return false if the port cannot be bound
+     */
+    bool start();
+
+    /**
+     * @brief Stop serving and join the listener thread
+     */
+    void stop();
+
+    /**
+     * @brief Serve the reload endpoints; call before start()
+     * @param reloader Reloader (not owned)
+     */
+    void set_index_reloader(IndexReloader* reloader) { reloader_ = reloader; }
+
+private:
+    std::string host_;
+    int port_;
+    VectorSearchEngine* engine_;
+    ReadinessGate* readiness_;
+    IndexReloader* reloader_;
+
+    std::unique_ptr<httplib::Server> server_;
+    std::thread listener_thread_;
+    std::atomic<bool> running_;
+
+    void register_routes();
+};
+
+} // namespace neurorag
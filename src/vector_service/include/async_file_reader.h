@@ -0,0 +1,111 @@
+/**
+ * @file async_file_reader.h
+ * @brief Batched asynchronous positional reads for SSD-resident index data
+ *
+ * Uses io_uring (liburing) when the build found it and a small pread
+ * thread pool otherwise. Callers hand over a batch of reads at once so
+ * that all reads needed by a query are in flight together; each request
+ * completes through its callback on one of the reader's threads.
+ *
+ * Buffers used with O_DIRECT file descriptors must be aligned to
+ * kDirectIoAlignment, as must offsets and lengths.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <sys/types.h>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+constexpr size_t kDirectIoAlignment = 4096;
+
+/**
+ * @brief Allocate a buffer suitable for O_DIRECT reads
+ * @param size Requested size, rounded up to kDirectIoAlignment
+ * @return Buffer to be released with free(), or nullptr
+ */
+void* allocate_direct_io_buffer(size_t size);
+
+/**
+ * @brief Asynchronous positional file reader
+ */
+class AsyncFileReader {
+public:
+    /**
+     * @brief One read; callback receives bytes read or -errno
+     */
+    struct Request {
+        int fd;
+        uint64_t offset;
+        size_t length;
+        void* buffer;
+        std::function<void(ssize_t result)> callback;
+    };
+
+    /**
+     * @brief Constructor
+     * @param queue_depth Maximum reads in flight (io_uring ring size)
+     * @param fallback_threads pread workers used without io_uring
+     */
+    explicit AsyncFileReader(unsigned queue_depth = 256, int fallback_threads = 8);
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    /**
+     * @brief Queue a batch of reads; returns without waiting for them
+     */
+    void submit(std::vector<Request> requests);
+
+    /**
+     * @brief Read synchronously on the calling thread, retrying short reads
+     * @return Bytes read or -errno
+     */
+    static ssize_t read_fully(int fd, uint64_t offset, size_t length, void* buffer);
+
+    /**
+     * @brief "io_uring" or "threads"
+     */
+    const char* backend() const;
+
+    /**
+     * @brief Read counts, bytes and errors
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    struct Ring;
+
+    unsigned queue_depth_;
+    std::unique_ptr<Ring> ring_;
+
+    // pread fallback
+    std::vector<std::thread> workers_;
+    std::deque<Request> queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_condition_;
+    bool stopping_;
+
+    std::atomic<uint64_t> reads_submitted_;
+    std::atomic<uint64_t> reads_completed_;
+    std::atomic<uint64_t> bytes_read_;
+    std::atomic<uint64_t> read_errors_;
+
+    void complete(Request& request, ssize_t result);
+    void worker_loop();
+};
+
+} // namespace neurorag
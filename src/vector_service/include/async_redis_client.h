@@ -0,0 +1,243 @@
+/**
+ * @file async_redis_client.h
+ * @brief Non-blocking, pipelined cache store backends for CacheManager
+ *
+ * CacheStore is the interface CacheManager talks to. AsyncRedisClient
+ * drives a pool of hiredis async connections from dedicated I/O threads:
+ * lookups issued concurrently by request threads are coalesced into one
+ * MGET per connection per loop iteration, writes are pipelined and
+ * fire-and-forget, and a circuit breaker bypasses Redis entirely while it
+ * is failing or slow. InMemoryCacheStore is a local stand-in with the same
+ * semantics, selected with a "memory://" URL, so the service and its tests
+ * run without a Redis server.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+struct redisAsyncContext;
+
+namespace neurorag {
+
+/**
+ * @brief Asynchronous key/value cache backend
+ */
+class CacheStore {
+public:
+    /**
+     * @brief Lookup completion; invoked exactly once, possibly on an I/O thread
+     * @param hit true if the key was found
+     * @param value Stored value (empty on miss)
+     */
+    using GetCallback = std::function<void(bool hit, std::string value)>;
+
+    virtual ~CacheStore() = default;
+
+    /**
+     * @brief Look up a key without blocking the caller
+     */
+    virtual void get_async(const std::string& key, GetCallback callback) = 0;
+
+    /**
+     * @brief Store a value; fire-and-forget
+     */
+    virtual void set_async(const std::string& key, std::string value, int ttl_seconds) = 0;
+
+    /**
+     * @brief Delete keys; fire-and-forget
+     */
+    virtual void delete_async(const std::vector<std::string>& keys) = 0;
+
+    /**
+     * @brief Look up a key, waiting at most timeout for the reply
+     *
+     * A reply arriving after the deadline is discarded and reported as a
+     * miss, so a slow backend never stalls the request thread for longer.
+     */
+    bool get(const std::string& key, std::string& value, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Backend statistics
+     */
+    virtual nlohmann::json get_statistics() const = 0;
+};
+
+/**
+ * @brief Circuit breaker guarding a remote backend
+ *
+ * Errors and replies slower than slow_threshold count as failures. After
+ * failure_threshold consecutive failures the breaker opens and callers
+ * bypass the backend; after cooldown a single probe is let through
+ * (half-open) and its outcome closes or re-opens the breaker.
+ */
+class CircuitBreaker {
+public:
+    enum class State { CLOSED, OPEN, HALF_OPEN };
+
+    CircuitBreaker(int failure_threshold,
+                   std::chrono::microseconds slow_threshold,
+                   std::chrono::milliseconds cooldown);
+
+    /**
+     * @brief Whether a request may be sent to the backend now
+     */
+    bool allow_request();
+
+    /**
+     * @brief Report a completed request and its latency
+     */
+    void record_success(std::chrono::microseconds latency);
+
+    /**
+     * @brief Report a failed or timed-out request
+     */
+    void record_failure();
+
+    State state() const { return state_.load(std::memory_order_acquire); }
+    uint64_t times_opened() const { return times_opened_.load(); }
+
+private:
+    int failure_threshold_;
+    std::chrono::microseconds slow_threshold_;
+    std::chrono::milliseconds cooldown_;
+
+    std::atomic<State> state_;
+    std::atomic<int> consecutive_failures_;
+    std::atomic<int64_t> opened_at_us_;
+    std::atomic<bool> probe_in_flight_;
+    std::atomic<uint64_t> times_opened_;
+
+    void open();
+};
+
+/**
+ * @brief Async Redis client configuration
+ */
+struct AsyncRedisConfig {
+    std::string url = "redis://localhost:6379";
+    int pool_size = 4;
+    size_t max_batch_keys = 256;
+    int breaker_failure_threshold = 5;
+    int breaker_slow_threshold_us = 5000;
+    int breaker_cooldown_ms = 2000;
+    int reconnect_interval_ms = 500;
+};
+
+/**
+ * @brief Pooled, pipelined Redis client on hiredis async
+ */
+class AsyncRedisClient : public CacheStore {
+public:
+    explicit AsyncRedisClient(const AsyncRedisConfig& config);
+    ~AsyncRedisClient() override;
+
+    AsyncRedisClient(const AsyncRedisClient&) = delete;
+    AsyncRedisClient& operator=(const AsyncRedisClient&) = delete;
+
+    /**
+     * @brief Start the I/O threads; connections are (re)established in the background
+     * @return false if the URL cannot be parsed
+     */
+    bool start();
+
+    /**
+     * @brief Stop the I/O threads; outstanding lookups complete as misses
+     */
+    void stop();
+
+    void get_async(const std::string& key, GetCallback callback) override;
+    void set_async(const std::string& key, std::string value, int ttl_seconds) override;
+    void delete_async(const std::vector<std::string>& keys) override;
+    nlohmann::json get_statistics() const override;
+
+private:
+    struct Connection;
+
+    AsyncRedisConfig config_;
+    std::string host_;
+    int port_;
+    std::string password_;
+    int database_;
+
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::atomic<size_t> next_connection_;
+    std::atomic<bool> running_;
+    CircuitBreaker breaker_;
+
+    std::atomic<uint64_t> lookups_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> bypassed_;
+    std::atomic<uint64_t> batches_;
+    std::atomic<uint64_t> writes_;
+    std::atomic<uint64_t> errors_;
+
+    bool parse_url(const std::string& url);
+    Connection& pick_connection();
+    void io_loop(Connection& connection);
+    bool connect(Connection& connection);
+    void disconnect(Connection& connection);
+    void flush_submissions(Connection& connection);
+
+    static void on_mget_reply(redisAsyncContext* context, void* reply, void* privdata);
+    static void on_write_reply(redisAsyncContext* context, void* reply, void* privdata);
+    static void on_connect(const redisAsyncContext* context, int status);
+    static void on_disconnect(const redisAsyncContext* context, int status);
+};
+
+/**
+ * @brief In-process stand-in for Redis with TTL semantics
+ *
+ * Completes callbacks synchronously. An injected latency makes it useful
+ * for exercising timeouts and the circuit breaker offline.
+ */
+class InMemoryCacheStore : public CacheStore {
+public:
+    explicit InMemoryCacheStore(size_t max_entries = 100000);
+
+    void get_async(const std::string& key, GetCallback callback) override;
+    void set_async(const std::string& key, std::string value, int ttl_seconds) override;
+    void delete_async(const std::vector<std::string>& keys) override;
+    nlohmann::json get_statistics() const override;
+
+    /**
+     * @brief Delay every lookup by the given amount (testing aid)
+     */
+    void set_injected_latency(std::chrono::microseconds latency) { injected_latency_us_.store(latency.count()); }
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string value;
+        std::chrono::steady_clock::time_point expires_at;
+    };
+
+    size_t max_entries_;
+    std::unordered_map<std::string, Entry> entries_;
+    mutable std::mutex mutex_;
+    std::atomic<int64_t> injected_latency_us_;
+    std::atomic<uint64_t> lookups_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> evictions_;
+};
+
+/**
+ * @brief Create the cache store selected by the URL scheme
+ * @param config Client configuration; "memory://" selects InMemoryCacheStore
+ * @return Started store, or nullptr if it could not be created
+ */
+std::unique_ptr<CacheStore> create_cache_store(const AsyncRedisConfig& config);
+
+} // namespace neurorag
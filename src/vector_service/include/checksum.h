@@ -0,0 +1,41 @@
+/**
+ * @file checksum.h
+ * @brief CRC32C and xxHash64 checksums for cached and persisted data
+ *
+ * CRC32C uses the SSE4.2 crc32 instruction when the build targets it and
+ * a table-driven implementation otherwise; both produce the standard
+ * Castagnoli CRC, so data written by one build verifies on the other.
+ * Large buffers are split into three interleaved streams whose CRCs are
+ * combined, which hides the instruction's latency (about 3x the
+ * single-stream throughput).
+ *
+ * xxHash64 is the reference XXH64 algorithm; it needs no special
+ * instructions and is the faster of the two on builds without SSE4.2.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace neurorag {
+
+/**
+ * @brief Compute or extend a CRC32C
+ * @param data Bytes to checksum
+ * @param size Number of bytes
+ * @param crc Result of a previous call to continue from, 0 to start
+ * @return CRC32C of the concatenated input
+ */
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+/**
+ * @brief Compute an xxHash64 (XXH64)
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @param seed Hash seed
+ * @return XXH64 of the input
+ */
+uint64_t xxhash64(const void* data, size_t size, uint64_t seed = 0);
+
+} // namespace neurorag
@@ -0,0 +1,561 @@
+/**
+ * @file concurrent_hash_map.h
+ * @brief Open-addressing hash map with lock-free reads and striped write locks
+ *
+ * Swiss-table layout: slots come in groups of 16 with one control byte
+ * each (empty, deleted, or 7 bits of the key's hash). A lookup compares
+ * all 16 control bytes of a group against the hash tag in one SSE2
+ * instruction and only touches the slots that match, then moves on to
+ * the next group (triangular probing) until a group has an empty slot.
+ *
+ * Entries are immutable and heap-allocated; slots hold pointers to them.
+ * Readers take no lock: they pin the map's EpochManager, so an entry or
+ * table that a writer replaces or unlinks stays valid until every reader
+ * that could have loaded it has finished. Writers lock one of 64 stripes
+ * picked by the key's hash, so writers of different keys rarely wait for
+ * each other, and claim free slots with compare-and-swap. Growing takes
+ * every stripe and rehashes into a table twice the size (or the same
+ * size, when deletes left mostly tombstones).
+ *
+ * A control byte is tagged before its slot is published and freed only
+ * after the slot is cleared, so a reader that finds a tag over a null slot
+ * just skips it: the insert has not happened yet, or the erase already has.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <nlohmann/json.hpp>
+
+#include "epoch_reclaimer.h"
+
+namespace neurorag {
+
+/**
+ * @brief Concurrent hash map; values are copied out under a reader pin
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ConcurrentHashMap {
+public:
+    /**
+     * @brief Constructor
+     * @param expected Entries to size the table for without growing
+     */
+    explicit ConcurrentHashMap(size_t expected = 0);
+    ~ConcurrentHashMap();
+
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    /**
+     * @brief Look up a key without locking
+     * @return false if absent
+     */
+    bool find(const K& key, V& value) const;
+
+    bool contains(const K& key) const;
+
+    /**
+     * @brief Insert or replace
+     * @param previous Set to the replaced value, if any
+     * @return true if the key was already present
+     */
+    bool upsert(const K& key, const V& value, V* previous = nullptr);
+
+    /**
+     * @brief Insert unless present
+     * @return false if the key was already present (the map is unchanged)
+     */
+    bool insert(const K& key, const V& value);
+
+    /**
+     * @brief Remove a key
+     * @param previous Set to the removed value, if any
+     * @return false if absent
+     */
+    bool erase(const K& key, V* previous = nullptr);
+
+    /**
+     * @brief Remove a key only while it still maps to value
+     */
+    bool erase_if_equal(const K& key, const V& value);
+
+    void clear();
+
+    /**
+     * @brief Visit every entry of one consistent table
+     *
+     * Concurrent writes may or may not be seen.
+     */
+    void for_each(const std::function<void(const K&, const V&)>& visit) const;
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const;
+
+    /**
+     * @brief Size, capacity, load factor, tombstones and resizes
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    static constexpr size_t kGroupSize = 16;
+    static constexpr size_t kStripes = 64;
+    static constexpr size_t kMinGroups = 64;       // room for kStripes racing inserts
+    static constexpr uint8_t kEmpty = 0x80;
+    static constexpr uint8_t kDeleted = 0xFE;
+
+    struct Entry {
+        uint64_t hash;
+        K key;
+        V value;
+    };
+
+    struct alignas(64) Group {
+        std::atomic<uint64_t> control[2];           // 16 control bytes
+        std::atomic<Entry*> slots[kGroupSize];
+    };
+
+    struct Table {
+        explicit Table(size_t num_groups);
+        size_t num_groups;                          // power of two
+        std::unique_ptr<Group[]> groups;
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+    };
+
+    std::atomic<Table*> table_;
+    std::unique_ptr<Stripe[]> stripes_;
+    std::atomic<size_t> size_;
+    std::atomic<size_t> tombstones_;
+    std::atomic<uint64_t> resizes_;
+    Hash hasher_;
+    mutable EpochManager epochs_;
+
+    uint64_t hash_of(const K& key) const;
+    static uint8_t tag(uint64_t hash) { return static_cast<uint8_t>(hash & 0x7F); }
+    static uint32_t match(const Group& group, uint8_t byte);
+    static uint32_t match_free(const Group& group);
+    static void set_control(Group& group, size_t slot, uint8_t byte);
+
+    // Slot holding key, or false; callers hold the key's stripe or a pin
+    bool locate(const Table& table, uint64_t hash, const K& key, Group*& group, size_t& slot) const;
+    bool claim_slot(Table& table, uint64_t hash, Entry* entry);
+    bool needs_growth(const Table& table) const;
+    void grow();
+    static void place(Table& table, Entry* entry);
+    static void delete_entries(Table* table);
+};
+
+// ---------------------------------------------------------------------------
+// Implementation
+// ---------------------------------------------------------------------------
+
+template <typename K, typename V, typename Hash>
+ConcurrentHashMap<K, V, Hash>::Table::Table(size_t groups_count)
+    : num_groups(groups_count), groups(new Group[groups_count]) {
+    const uint64_t empty_word = 0x8080808080808080ULL;
+    for (size_t g = 0; g < num_groups; ++g) {
+        groups[g].control[0].store(empty_word, std::memory_order_relaxed);
+        groups[g].control[1].store(empty_word, std::memory_order_relaxed);
+        for (auto& slot : groups[g].slots) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash>
+ConcurrentHashMap<K, V, Hash>::ConcurrentHashMap(size_t expected)
+    : stripes_(new Stripe[kStripes]),
+      size_(0),
+      tombstones_(0),
+      resizes_(0),
+      epochs_(1024, 256) {
+    // Grow at 7/8 full
+    size_t groups = kMinGroups;
+    while (groups * kGroupSize * 7 / 8 < expected) {
+        groups *= 2;
+    }
+    table_.store(new Table(groups));
+}
+
+template <typename K, typename V, typename Hash>
+ConcurrentHashMap<K, V, Hash>::~ConcurrentHashMap() {
+    // No reader or writer may still be running; retired tables go with epochs_
+    Table* table = table_.load();
+    delete_entries(table);
+    delete table;
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentHashMap<K, V, Hash>::delete_entries(Table* table) {
+    for (size_t g = 0; g < table->num_groups; ++g) {
+        for (auto& slot : table->groups[g].slots) {
+            delete slot.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash>
+uint64_t ConcurrentHashMap<K, V, Hash>::hash_of(const K& key) const {
+    // std::hash is the identity for integers; mix so tags and groups both vary
+    uint64_t h = static_cast<uint64_t>(hasher_(key));
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template <typename K, typename V, typename Hash>
+uint32_t ConcurrentHashMap<K, V, Hash>::match(const Group& group, uint8_t byte) {
+    uint64_t low = group.control[0].load(std::memory_order_acquire);
+    uint64_t high = group.control[1].load(std::memory_order_acquire);
+#if defined(__SSE2__)
+    __m128i control = _mm_set_epi64x(static_cast<long long>(high), static_cast<long long>(low));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(static_cast<char>(byte)))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupSize; ++i) {
+        uint64_t word = i < 8 ? low : high;
+        if (static_cast<uint8_t>(word >> ((i % 8) * 8)) == byte) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+template <typename K, typename V, typename Hash>
+uint32_t ConcurrentHashMap<K, V, Hash>::match_free(const Group& group) {
+    // Empty and deleted both have the high bit set, tags never do
+    uint64_t low = group.control[0].load(std::memory_order_acquire);
+    uint64_t high = group.control[1].load(std::memory_order_acquire);
+#if defined(__SSE2__)
+    __m128i control = _mm_set_epi64x(static_cast<long long>(high), static_cast<long long>(low));
+    return static_cast<uint32_t>(_mm_movemask_epi8(control));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupSize; ++i) {
+        uint64_t word = i < 8 ? low : high;
+        if ((word >> ((i % 8) * 8)) & 0x80) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentHashMap<K, V, Hash>::set_control(Group& group, size_t slot, uint8_t byte) {
+    std::atomic<uint64_t>& word = group.control[slot / 8];
+    unsigned shift = static_cast<unsigned>((slot % 8) * 8);
+    uint64_t current = word.load(std::memory_order_relaxed);
+    uint64_t updated;
+    do {
+        updated = (current & ~(uint64_t{0xFF} << shift)) | (uint64_t{byte} << shift);
+    } while (!word.compare_exchange_weak(current, updated, std::memory_order_acq_rel));
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::locate(const Table& table, uint64_t hash, const K& key,
+                                           Group*& group, size_t& slot) const {
+    size_t mask = table.num_groups - 1;
+    size_t g = (hash >> 7) & mask;
+    uint8_t wanted = tag(hash);
+    for (size_t step = 1; step <= table.num_groups; ++step) {
+        Group& candidate = table.groups[g];
+        for (uint32_t bits = match(candidate, wanted); bits; bits &= bits - 1) {
+            size_t i = static_cast<size_t>(__builtin_ctz(bits));
+            Entry* entry = candidate.slots[i].load(std::memory_order_acquire);
+            if (entry && entry->hash == hash && entry->key == key) {
+                group = &candidate;
+                slot = i;
+                return true;
+            }
+        }
+        if (match(candidate, kEmpty)) {
+            return false;
+        }
+        g = (g + step) & mask;
+    }
+    return false;
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::claim_slot(Table& table, uint64_t hash, Entry* entry) {
+    size_t mask = table.num_groups - 1;
+    size_t g = (hash >> 7) & mask;
+    for (size_t step = 1; step <= table.num_groups; ++step) {
+        Group& group = table.groups[g];
+        // Writers of other keys race for the same free bytes; a lost race
+        // rescans this group, so an entry never lands past a group that
+        // still had room (lookups stop at the first group with an empty)
+        while (uint32_t bits = match_free(group)) {
+            size_t i = static_cast<size_t>(__builtin_ctz(bits));
+            std::atomic<uint64_t>& word = group.control[i / 8];
+            unsigned shift = static_cast<unsigned>((i % 8) * 8);
+            uint64_t current = word.load(std::memory_order_relaxed);
+            uint8_t previous = static_cast<uint8_t>(current >> shift);
+            if (!(previous & 0x80)) {
+                continue;
+            }
+            uint64_t updated = (current & ~(uint64_t{0xFF} << shift)) | (uint64_t{tag(hash)} << shift);
+            if (!word.compare_exchange_strong(current, updated, std::memory_order_acq_rel)) {
+                continue;
+            }
+            // Tag before pointer: a reader that sees the tag first finds a
+            // null slot and skips it, as if the insert had not happened yet
+            group.slots[i].store(entry, std::memory_order_release);
+            if (previous == kDeleted) {
+                tombstones_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return true;
+        }
+        g = (g + step) & mask;
+    }
+    return false;
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentHashMap<K, V, Hash>::place(Table& table, Entry* entry) {
+    size_t mask = table.num_groups - 1;
+    size_t g = (entry->hash >> 7) & mask;
+    for (size_t step = 1;; ++step) {
+        Group& group = table.groups[g];
+        uint32_t bits = match_free(group);
+        if (bits) {
+            size_t i = static_cast<size_t>(__builtin_ctz(bits));
+            group.slots[i].store(entry, std::memory_order_relaxed);
+            set_control(group, i, tag(entry->hash));
+            return;
+        }
+        g = (g + step) & mask;
+    }
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::needs_growth(const Table& table) const {
+    size_t used = size_.load(std::memory_order_relaxed) + tombstones_.load(std::memory_order_relaxed);
+    return (used + 1) * 8 > table.num_groups * kGroupSize * 7;
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentHashMap<K, V, Hash>::grow() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(kStripes);
+    for (size_t s = 0; s < kStripes; ++s) {
+        locks.emplace_back(stripes_[s].mutex);
+    }
+    Table* old_table = table_.load();
+    if (!needs_growth(*old_table)) {
+        return;  // another writer grew it first
+    }
+
+    // Same size when tombstones, not entries, filled the table
+    size_t groups = old_table->num_groups;
+    if ((size_.load() + 1) * 16 > groups * kGroupSize * 7) {
+        groups *= 2;
+    }
+    Table* new_table = new Table(groups);
+    for (size_t g = 0; g < old_table->num_groups; ++g) {
+        for (auto& slot : old_table->groups[g].slots) {
+            if (Entry* entry = slot.load(std::memory_order_relaxed)) {
+                place(*new_table, entry);
+            }
+        }
+    }
+    table_.store(new_table);
+    tombstones_.store(0);
+    resizes_.fetch_add(1, std::memory_order_relaxed);
+    // Entries moved to the new table; only the old slot arrays go, retired
+    // after the stripes are released since retiring may collect
+    locks.clear();
+    epochs_.retire(old_table);
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::find(const K& key, V& value) const {
+    uint64_t hash = hash_of(key);
+    EpochManager::Guard guard(epochs_);
+    Group* group;
+    size_t slot;
+    if (!locate(*table_.load(), hash, key, group, slot)) {
+        return false;
+    }
+    Entry* entry = group->slots[slot].load(std::memory_order_acquire);
+    if (!entry) {
+        return false;  // erased since located
+    }
+    value = entry->value;
+    return true;
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::contains(const K& key) const {
+    V value;
+    return find(key, value);
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::upsert(const K& key, const V& value, V* previous) {
+    uint64_t hash = hash_of(key);
+    Entry* entry = new Entry{hash, key, value};
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(stripes_[hash % kStripes].mutex);
+            EpochManager::Guard guard(epochs_);
+            Table* table = table_.load();
+            Group* group;
+            size_t slot;
+            if (locate(*table, hash, key, group, slot)) {
+                // Same key, same tag: swap the entry, the control byte stays
+                Entry* old_entry = group->slots[slot].exchange(entry, std::memory_order_acq_rel);
+                if (previous) {
+                    *previous = old_entry->value;
+                }
+                epochs_.retire(old_entry);
+                return true;
+            }
+            if (!needs_growth(*table) && claim_slot(*table, hash, entry)) {
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        grow();
+    }
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::insert(const K& key, const V& value) {
+    uint64_t hash = hash_of(key);
+    std::unique_ptr<Entry> entry;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(stripes_[hash % kStripes].mutex);
+            EpochManager::Guard guard(epochs_);
+            Table* table = table_.load();
+            Group* group;
+            size_t slot;
+            if (locate(*table, hash, key, group, slot)) {
+                return false;
+            }
+            if (!entry) {
+                entry.reset(new Entry{hash, key, value});
+            }
+            if (!needs_growth(*table) && claim_slot(*table, hash, entry.get())) {
+                entry.release();
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        grow();
+    }
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::erase(const K& key, V* previous) {
+    uint64_t hash = hash_of(key);
+    std::lock_guard<std::mutex> lock(stripes_[hash % kStripes].mutex);
+    EpochManager::Guard guard(epochs_);
+    Group* group;
+    size_t slot;
+    if (!locate(*table_.load(), hash, key, group, slot)) {
+        return false;
+    }
+    // Unlink before freeing the byte: claimers only look at control bytes
+    Entry* entry = group->slots[slot].exchange(nullptr, std::memory_order_acq_rel);
+    set_control(*group, slot, kDeleted);
+    tombstones_.fetch_add(1, std::memory_order_relaxed);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    if (previous) {
+        *previous = entry->value;
+    }
+    epochs_.retire(entry);
+    return true;
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentHashMap<K, V, Hash>::erase_if_equal(const K& key, const V& value) {
+    uint64_t hash = hash_of(key);
+    std::lock_guard<std::mutex> lock(stripes_[hash % kStripes].mutex);
+    EpochManager::Guard guard(epochs_);
+    Group* group;
+    size_t slot;
+    if (!locate(*table_.load(), hash, key, group, slot) ||
+        !(group->slots[slot].load(std::memory_order_acquire)->value == value)) {
+        return false;
+    }
+    Entry* entry = group->slots[slot].exchange(nullptr, std::memory_order_acq_rel);
+    set_control(*group, slot, kDeleted);
+    tombstones_.fetch_add(1, std::memory_order_relaxed);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    epochs_.retire(entry);
+    return true;
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentHashMap<K, V, Hash>::clear() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(kStripes);
+    for (size_t s = 0; s < kStripes; ++s) {
+        locks.emplace_back(stripes_[s].mutex);
+    }
+    Table* old_table = table_.exchange(new Table(kMinGroups));
+    size_.store(0);
+    tombstones_.store(0);
+    locks.clear();
+    epochs_.retire([old_table]() {
+        delete_entries(old_table);
+        delete old_table;
+    });
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentHashMap<K, V, Hash>::for_each(const std::function<void(const K&, const V&)>& visit) const {
+    EpochManager::Guard guard(epochs_);
+    const Table* table = table_.load();
+    for (size_t g = 0; g < table->num_groups; ++g) {
+        for (const auto& slot : table->groups[g].slots) {
+            if (const Entry* entry = slot.load(std::memory_order_acquire)) {
+                visit(entry->key, entry->value);
+            }
+        }
+    }
+}
+
+template <typename K, typename V, typename Hash>
+size_t ConcurrentHashMap<K, V, Hash>::capacity() const {
+    EpochManager::Guard guard(epochs_);
+    return table_.load()->num_groups * kGroupSize;
+}
+
+template <typename K, typename V, typename Hash>
+nlohmann::json ConcurrentHashMap<K, V, Hash>::get_statistics() const {
+    size_t slots = capacity();
+    nlohmann::json stats;
+    stats["size"] = size();
+    stats["capacity"] = slots;
+    stats["load_factor"] = slots > 0 ? static_cast<double>(size()) / slots : 0.0;
+    stats["tombstones"] = tombstones_.load();
+    stats["resizes"] = resizes_.load();
+    stats["reclamation"] = epochs_.get_statistics();
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,194 @@
+/**
+ * @file diskann_index.h
+ * @brief SSD-resident Vamana graph index (DiskANN) for billion-scale tenants
+ *
+ * Full-precision vectors and graph adjacency live in a file on local
+ * NVMe; only product-quantized codes, the id map and a small cache of
+ * nodes around the entry point stay in RAM. A search walks the graph by
+ * PQ distance, reading the beam_width closest unexpanded nodes of every
+ * hop with one batch of asynchronous reads, and re-ranks every node it
+ * read by exact distance.
+ *
+ * The index is a faiss::Index, so the engine drives it through the same
+ * search/add/remove calls as its other index types. The graph file is
+ * immutable: added vectors are kept in an in-memory staging set that is
+ * scanned exhaustively alongside the graph, and removed graph nodes are
+ * tombstoned and filtered out; rebuild() folds both into a new file.
+ *
+ * The graph is always built and pruned with L2 distances; with
+ * METRIC_INNER_PRODUCT (normalized embeddings) results are ranked by
+ * inner product.
+ *
+ * File layout ("NRDA"): header, PQ centroids, PQ codes, ids, then node
+ * records (vector, degree, max_degree neighbour slots) packed into 4 KiB
+ * sectors, several nodes per sector or several sectors per node.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+#include <faiss/Index.h>
+#include <faiss/impl/ProductQuantizer.h>
+#include <nlohmann/json.hpp>
+
+#include "async_file_reader.h"
+#include "readiness.h"
+
+namespace neurorag {
+
+/**
+ * @brief Graph construction parameters
+ */
+struct DiskAnnBuildParams {
+    int max_degree = 64;          // R: neighbours kept per node
+    int build_list_size = 100;    // L during construction
+    float alpha = 1.2f;           // pruning slack of the second pass
+    int pq_bytes = 32;            // PQ code size per vector in RAM
+    size_t pq_training_size = 100000;
+};
+
+/**
+ * @brief Per-search overrides of the search defaults
+ */
+struct DiskAnnSearchParameters : faiss::SearchParameters {
+    int search_list_size = 0;     // L; 0 keeps the index default
+    int beam_width = 0;           // reads issued per hop; 0 keeps the index default
+};
+
+/**
+ * @brief Vamana graph index with vectors and adjacency on SSD
+ */
+class DiskAnnIndex : public faiss::Index {
+public:
+    /**
+     * @brief Build a graph over vectors held in memory and write it to path
+     * @param n Number of vectors
+     * @param x Vectors (n * d)
+     * @param ids External ids, or nullptr for 0..n-1
+     * @param d Dimension
+     * @param metric faiss::METRIC_L2 or faiss::METRIC_INNER_PRODUCT
+     * @param params Construction parameters
+     * @param path Destination; written to path.tmp and renamed
+     * @return false if the file cannot be written
+     */
+    static bool build(size_t n, const float* x, const faiss::idx_t* ids, int d,
+                      faiss::MetricType metric, const DiskAnnBuildParams& params,
+                      const std::string& path);
+
+    /**
+     * @brief Open an index file
+     * @param path File written by build()
+     * @param reader Reader for node reads (shared)
+     * @param cached_nodes Nodes around the entry point to keep in RAM
+     * @return Index, or nullptr if the file is missing or corrupt
+     */
+    static std::unique_ptr<DiskAnnIndex> load(const std::string& path,
+                                              std::shared_ptr<AsyncFileReader> reader,
+                                              size_t cached_nodes);
+
+    ~DiskAnnIndex() override;
+
+    /**
+     * @brief Default search list size (L) and beam width
+     */
+    void set_search_defaults(int search_list_size, int beam_width);
+
+    // faiss::Index
+    void add(faiss::idx_t n, const float* x) override;
+    void add_with_ids(faiss::idx_t n, const float* x, const faiss::idx_t* xids) override;
+    void search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                const faiss::SearchParameters* params = nullptr) const override;
+    void reset() override;
+    size_t remove_ids(const faiss::IDSelector& sel) override;
+    void reconstruct(faiss::idx_t key, float* recons) const override;
+
+    /**
+     * @brief Write a new graph with staged vectors added and tombstones dropped
+     * @param path Destination of the new file (the current file stays in use)
+     * @param params Construction parameters
+     * @return false if the new file cannot be written
+     */
+    bool rebuild(const std::string& path, const DiskAnnBuildParams& params) const;
+
+    /**
+     * @brief PQ codes, ids and cached nodes, for prefaulting and residency checks
+     */
+    std::vector<MemoryRegion> memory_regions() const;
+
+    /**
+     * @brief Query, hop, SSD read and cache counters
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    struct Header;
+
+    DiskAnnIndex(int d, faiss::MetricType metric);
+
+    std::string path_;
+    int fd_;
+    std::shared_ptr<AsyncFileReader> reader_;
+
+    // Graph geometry
+    size_t num_nodes_;
+    uint32_t max_degree_;
+    uint32_t medoid_;
+    size_t node_bytes_;
+    size_t nodes_per_sector_;   // 0 when a node spans several sectors
+    size_t read_bytes_;         // bytes read per node
+    uint64_t data_offset_;
+
+    // In RAM: PQ navigation codes and the id map
+    faiss::ProductQuantizer pq_;
+    std::vector<uint8_t> pq_codes_;
+    std::vector<faiss::idx_t> ids_;
+    std::unordered_map<faiss::idx_t, uint32_t> node_of_id_;
+
+    // Nodes around the medoid, read once at load
+    std::unordered_map<uint32_t, size_t> cached_slot_;
+    std::vector<uint8_t> cached_nodes_;
+
+    int search_list_size_;
+    int beam_width_;
+
+    // Tombstones for graph nodes, checked without locking during search
+    std::unique_ptr<std::atomic<bool>[]> deleted_;
+    std::atomic<size_t> deleted_count_;
+
+    // Vectors added since the graph was built, scanned exhaustively
+    mutable std::mutex staging_mutex_;
+    std::vector<float> staged_vectors_;
+    std::vector<faiss::idx_t> staged_ids_;
+    faiss::idx_t next_id_;
+
+    mutable std::atomic<uint64_t> queries_;
+    mutable std::atomic<uint64_t> hops_;
+    mutable std::atomic<uint64_t> ssd_reads_;
+    mutable std::atomic<uint64_t> cache_hits_;
+    mutable std::atomic<uint64_t> read_failures_;
+
+    uint64_t node_offset(uint32_t node) const;
+    size_t node_offset_in_read(uint32_t node) const;
+    bool read_nodes_sync(const std::vector<uint32_t>& nodes, std::vector<uint8_t>& out) const;
+    void load_cache(size_t cached_nodes);
+
+    // Single-query search over the graph; returns (distance, label) best first
+    void search_graph(const float* query, size_t k, int search_list_size, int beam_width,
+                      const faiss::IDSelector* sel,
+                      std::vector<std::pair<float, faiss::idx_t>>& results) const;
+    void search_staged(const float* query, const faiss::IDSelector* sel,
+                       std::vector<std::pair<float, faiss::idx_t>>& results) const;
+
+    // Smaller is better for both metrics
+    float distance(const float* a, const float* b) const;
+};
+
+} // namespace neurorag
@@ -0,0 +1,116 @@
+/**
+ * @file embedding_backend.h
+ * @brief Pluggable text embedding models for query text
+ *
+ * QueryEmbedder hands batches of texts that missed the embedding cache to
+ * an EmbeddingBackend. The HTTP backend posts them to an embedding
+ * service (the Python service's /embed route serves the same
+ * sentence-transformers model the corpus was embedded with); the local
+ * backend (text_encoder.h) runs the model in process.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace httplib {
+class Client;
+}
+
+namespace neurorag {
+
+/**
+ * @brief Embedding model interface
+ *
+ * Implementations must be safe to call from one thread at a time;
+ * QueryEmbedder never calls embed concurrently.
+ */
+class EmbeddingBackend {
+public:
+    virtual ~EmbeddingBackend() = default;
+
+    /**
+     * @brief Embed a batch of texts
+     * @param texts Texts, at most max_batch_size()
+     * @param embeddings Receives texts.size() x dimension() floats, row-major
+     * @param error Set when the batch fails
+     * @return false if no embeddings were produced
+     */
+    virtual bool embed(const std::vector<std::string>& texts,
+                       std::vector<float>& embeddings,
+                       std::string& error) = 0;
+
+    /**
+     * @brief Embedding dimension
+     */
+    virtual int dimension() const = 0;
+
+    /**
+     * @brief Largest batch the backend accepts in one call
+     */
+    virtual size_t max_batch_size() const = 0;
+
+    /**
+     * @brief Description for logs and statistics
+     */
+    virtual std::string name() const = 0;
+};
+
+/**
+ * @brief Embeddings from an HTTP service
+ *
+ * POSTs {"texts": [...]} to the URL and expects
+ * {"embeddings": [[...], ...]} with one row per text.
+ */
+class HttpEmbeddingBackend : public EmbeddingBackend {
+public:
+    /**
+     * @brief Constructor
+     * @param url Endpoint, e.g. http://localhost:8000/embed
+     * @param dimension Expected embedding dimension; responses of another size fail
+     * @param max_batch_size Texts per request
+     * @param timeout_ms Connection and read timeout
+     */
+    HttpEmbeddingBackend(const std::string& url, int dimension, size_t max_batch_size, int timeout_ms);
+    ~HttpEmbeddingBackend() override;
+
+    bool embed(const std::vector<std::string>& texts,
+               std::vector<float>& embeddings,
+               std::string& error) override;
+    int dimension() const override { return dimension_; }
+    size_t max_batch_size() const override { return max_batch_size_; }
+    std::string name() const override { return "http " + url_; }
+
+private:
+    std::string url_;
+    std::string path_;
+    int dimension_;
+    size_t max_batch_size_;
+    std::unique_ptr<httplib::Client> client_;
+};
+
+/**
+ * @brief Create a backend from a spec
+ *
+ * "http://host:port/path" posts to an embedding service;
+ * "local:/path/model.nrte" runs the exported model in process with fp32
+ * weights and "local-int8:/path/model.nrte" with int8 weights.
+ * @param spec Backend spec (EMBEDDING_BACKEND)
+ * @param dimension Embedding dimension of the index
+ * @param max_batch_size Texts per backend call
+ * @param num_threads Inference threads of a local backend; 0 uses the OpenMP default
+ * @param error Why the spec was rejected
+ * @return nullptr on an unknown or invalid spec, or a model that does not load
+ */
+std::unique_ptr<EmbeddingBackend> create_embedding_backend(const std::string& spec,
+                                                           int dimension,
+                                                           size_t max_batch_size,
+                                                           int num_threads,
+                                                           std::string& error);
+
+} // namespace neurorag
@@ -0,0 +1,104 @@
+/**
+ * @file embedding_cache.h
+ * @brief Compact in-memory text -> embedding cache
+ *
+ * Repeated query texts skip the embedding model. Entries are keyed by a
+ * 64-bit xxHash of the text (the text itself is not kept; two texts
+ * colliding among 100k entries has a probability around 1e-10) and hold
+ * the embedding as fp16, halving the memory of fp32 with no measurable
+ * change in ranking. A 384-dimensional entry takes 768 bytes of values
+ * plus 25 bytes of key, timestamp, clock bit and table slots.
+ *
+ * The cache is split into shards, each a fixed array of slots indexed by
+ * an open-addressing table and evicted with the CLOCK algorithm, so a
+ * lookup takes one shard lock and allocates nothing.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief Fixed-capacity fp16 embedding cache with CLOCK eviction and a TTL
+ */
+class EmbeddingCache {
+public:
+    /**
+     * @brief Constructor; allocates every slot up front
+     * @param capacity Entries kept (max_embedding_cache_size)
+     * @param dimension Embedding dimension
+     * @param ttl Entries older than this are misses (embedding_cache_ttl); 0 keeps them
+     * @param num_shards Independently locked shards
+     */
+    EmbeddingCache(size_t capacity, int dimension, std::chrono::seconds ttl, size_t num_shards = 16);
+    ~EmbeddingCache();
+
+    EmbeddingCache(const EmbeddingCache&) = delete;
+    EmbeddingCache& operator=(const EmbeddingCache&) = delete;
+
+    /**
+     * @brief Cache key of a text
+     *
+     * Surrounding whitespace is ignored; anything else, including case,
+     * can change the embedding and is part of the key.
+     */
+    static uint64_t key(const std::string& text);
+
+    /**
+     * @brief Copy a cached embedding out as fp32
+     * @param embedding Receives dimension() floats on a hit
+     * @return false on a miss or an expired entry
+     */
+    bool lookup(uint64_t key, float* embedding);
+
+    /**
+     * @brief Insert or refresh an entry, evicting one if the shard is full
+     */
+    void insert(uint64_t key, const float* embedding);
+
+    void clear();
+
+    int dimension() const { return dimension_; }
+    size_t capacity() const;
+    size_t size() const;
+
+    /**
+     * @brief Bytes allocated for slots and tables
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * @brief Size, hit rate, evictions and expirations
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    struct Shard;
+
+    int dimension_;
+    uint32_t ttl_seconds_;
+    std::chrono::steady_clock::time_point epoch_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> expired_{0};
+    std::atomic<uint64_t> insertions_{0};
+    std::atomic<uint64_t> evictions_{0};
+
+    Shard& shard_for(uint64_t key) const;
+    uint32_t now_seconds() const;
+};
+
+} // namespace neurorag
@@ -0,0 +1,168 @@
+/**
+ * @file epoch_reclaimer.h
+ * @brief Epoch-based reclamation for lock-free readers of shared structures
+ *
+ * A reader pins the manager for the duration of one operation: it stamps
+ * a reader slot with the global epoch before loading any shared pointer.
+ * A writer that unlinks an object retires it instead of deleting it; the
+ * object is stamped with the epoch at retirement and freed once every
+ * pinned slot carries a later epoch, i.e. once no reader that could have
+ * loaded it is still running.
+ *
+ * Pinning costs one compare-and-swap on a slot the thread rarely shares
+ * (threads start their slot search at different places) and one store to
+ * unpin, with no reference count on the object itself, so concurrent
+ * readers of the same object do not contend the way they do on a
+ * shared_ptr's count.
+ *
+ * Retired objects go to a list picked by the retiring thread, so threads
+ * retiring concurrently rarely share one. A list that grows past a
+ * threshold triggers collect() on the retiring thread; readers never free
+ * anything. A reader that stays pinned holds back every retirement after
+ * it, so pins should cover one operation, not a session.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief Epoch-based reclamation domain
+ */
+class EpochManager {
+public:
+    /**
+     * @brief Constructor
+     * @param reader_slots Concurrently pinned readers before pin() spins
+     * @param collect_threshold Retirements per list that trigger a collect
+     */
+    explicit EpochManager(size_t reader_slots = 1024, size_t collect_threshold = 64);
+
+    /**
+     * @brief Frees everything still retired; no reader may be pinned
+     */
+    ~EpochManager();
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    /**
+     * @brief Reader pin held for one operation
+     */
+    class Guard {
+    public:
+        explicit Guard(const EpochManager& manager) : manager_(&manager), slot_(manager.enter()) {}
+        ~Guard() { reset(); }
+
+        Guard(Guard&& other) noexcept : manager_(other.manager_), slot_(other.slot_) { other.manager_ = nullptr; }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard& operator=(Guard&&) = delete;
+
+        void reset() {
+            if (manager_) {
+                manager_->exit(slot_);
+                manager_ = nullptr;
+            }
+        }
+
+    private:
+        const EpochManager* manager_;
+        size_t slot_;
+    };
+
+    Guard pin() const { return Guard(*this); }
+
+    /**
+     * @brief Pin without a Guard, for pins that outlive a scope
+     * @return Slot to pass to exit()
+     */
+    size_t enter() const;
+    void exit(size_t slot) const;
+
+    /**
+     * @brief Free an unlinked object once no pinned reader can reach it
+     * @param reclaim Frees the object; runs on whichever thread collects
+     */
+    void retire(std::function<void()> reclaim);
+
+    template <typename T>
+    void retire(T* object) {
+        retire([object]() { delete object; });
+    }
+
+    /**
+     * @brief Advance the epoch and free retirements no reader can reach
+     * @return Objects freed
+     */
+    size_t collect();
+
+    /**
+     * @brief Collect until nothing is retired
+     * @return false if readers still pinned a retirement when the timeout expired
+     */
+    bool drain(std::chrono::milliseconds timeout);
+
+    uint64_t epoch() const { return global_epoch_.load(std::memory_order_acquire); }
+
+    size_t reader_slots() const { return num_slots_; }
+
+    /**
+     * @brief Objects retired and not yet freed
+     */
+    size_t pending() const { return pending_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Readers pinned right now
+     */
+    size_t active_readers() const;
+
+    /**
+     * @brief Epoch, pinned readers and retirement counters
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    static constexpr size_t kRetireLists = 64;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0};  // 0: free
+    };
+
+    struct Retired {
+        std::function<void()> reclaim;
+        uint64_t epoch;
+    };
+
+    struct alignas(64) RetireList {
+        std::mutex mutex;
+        std::vector<Retired> entries;
+        size_t collect_at = 0;        // entries that trigger the next collect
+    };
+
+    size_t num_slots_;
+    size_t collect_threshold_;
+    std::unique_ptr<ReaderSlot[]> slots_;
+    std::atomic<uint64_t> global_epoch_;
+    std::unique_ptr<RetireList[]> lists_;
+
+    std::atomic<size_t> pending_;
+    std::atomic<uint64_t> retired_;
+    std::atomic<uint64_t> reclaimed_;
+    std::atomic<uint64_t> collections_;
+
+    uint64_t oldest_pinned_epoch() const;
+};
+
+} // namespace neurorag
@@ -0,0 +1,137 @@
+/**
+ * @file filtered_hnsw_index.h
+ * @brief Filter-aware HNSW search for restrictive metadata predicates
+ *
+ * faiss's HNSW search applies an IDSelector by leaving filtered-out nodes
+ * out of the results while still walking through them. Once only a few
+ * percent of documents pass, the beam fills with nodes that can never be
+ * returned and recall collapses; scanning every passing document instead
+ * is exact but grows with the collection.
+ *
+ * FilteredHnswIndex picks the strategy per search from the filter's
+ * selectivity, estimated on a sample of documents:
+ *
+ *  - above native_selectivity, faiss's own search (filtered-out nodes are
+ *    rare enough not to matter);
+ *  - between the two thresholds, an ACORN-style traversal of level 0:
+ *    only passing nodes are scored and kept, and a filtered-out neighbour
+ *    is expanded to its own neighbours instead (two hops), so the search
+ *    moves through the predicate's holes without computing a distance
+ *    for them;
+ *  - below exact_selectivity, or when fewer documents pass than the
+ *    traversal would score, an exact scan of the filter's bitmap, which
+ *    touches only the passing vectors.
+ *
+ * A traversal that finds fewer than k passing documents (the predicate's
+ * documents are cut off from the entry point) falls back to the exact
+ * scan for that query. The index wraps an IndexHNSWFlat and is itself a
+ * faiss::Index; the HNSW index remains the base (saved, snapshotted and
+ * merged as usual).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <faiss/Index.h>
+#include <faiss/IndexHNSW.h>
+#include <nlohmann/json.hpp>
+
+#include "lsm_index.h"
+
+namespace neurorag {
+
+/**
+ * @brief How a filtered search is run
+ */
+enum class FilteredHnswStrategy {
+    kNative,      // faiss HNSW search with the selector
+    kTraversal,   // filter-aware level-0 traversal
+    kExact,       // exact scan of the documents that pass
+};
+
+/**
+ * @brief HNSW index searched with the filter applied during traversal
+ */
+class FilteredHnswIndex : public faiss::Index, public LayeredIndex {
+public:
+    // Documents sampled to estimate a filter's selectivity
+    static constexpr size_t kSelectivitySample = 512;
+
+    /**
+     * @brief Constructor
+     * @param hnsw HNSW index over flat vectors; owned from now on
+     * @param exact_selectivity Below this fraction of passing documents, scan them exactly
+     * @param native_selectivity At or above it, use faiss's own filtered search
+     */
+    FilteredHnswIndex(std::shared_ptr<faiss::IndexHNSWFlat> hnsw, double exact_selectivity,
+                      double native_selectivity);
+
+    /**
+     * @brief Whether an index can be wrapped
+     * @param reason Why not, when it cannot
+     */
+    static bool can_wrap(const faiss::Index& index, std::string& reason);
+
+    /**
+     * @brief Deep copy, for delta merges
+     */
+    FilteredHnswIndex* clone() const;
+
+    double exact_selectivity() const { return exact_selectivity_; }
+    double native_selectivity() const { return native_selectivity_; }
+
+    /**
+     * @brief Strategy a search with this selector would use
+     *
+     * The exact scan is also chosen when fewer documents pass than a
+     * traversal would score (ef_search times the level-0 degree).
+     * @param sel Filter, or nullptr
+     * @param ef_search Traversal beam width
+     * @param selectivity Receives the estimated fraction of documents that pass
+     */
+    FilteredHnswStrategy choose_strategy(const faiss::IDSelector* sel, int ef_search, double& selectivity) const;
+
+    /**
+     * @brief Thresholds and per-strategy counters
+     */
+    nlohmann::json get_statistics() const;
+
+    std::shared_ptr<const faiss::Index> base_index() const override;
+
+    // faiss::Index
+    void add(faiss::idx_t n, const float* x) override;
+    void search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                const faiss::SearchParameters* params = nullptr) const override;
+    void reset() override;
+    size_t remove_ids(const faiss::IDSelector& sel) override;
+    void reconstruct(faiss::idx_t key, float* recons) const override;
+
+private:
+    std::shared_ptr<faiss::IndexHNSWFlat> hnsw_;
+    double exact_selectivity_;
+    double native_selectivity_;
+
+    mutable std::atomic<uint64_t> searches_{0};
+    mutable std::atomic<uint64_t> native_searches_{0};
+    mutable std::atomic<uint64_t> traversals_{0};
+    mutable std::atomic<uint64_t> exact_scans_{0};
+    mutable std::atomic<uint64_t> exact_fallbacks_{0};
+    mutable std::atomic<uint64_t> distances_computed_{0};
+    mutable std::atomic<uint64_t> nodes_skipped_{0};
+
+    // Level-0 traversal for one query; false if it found fewer than k documents
+    bool traverse_one(const float* query, size_t k, int ef, const faiss::IDSelector& sel,
+                      float* distances, faiss::idx_t* labels) const;
+
+    // Exact scan over the documents that pass; a single query fans out over the rows
+    void scan_one(const float* query, size_t k, const faiss::IDSelector& sel, bool parallel,
+                  float* distances, faiss::idx_t* labels) const;
+};
+
+} // namespace neurorag
@@ -0,0 +1,150 @@
+/**
+ * @file freshness.h
+ * @brief Time-decayed scoring inside the top-k search
+ *
+ * For news-like corpora a document's score is its similarity times
+ * exp(-lambda * age in days), lambda chosen per request. Re-ranking the
+ * index's top-k by that score afterwards loses every fresh document just
+ * outside the undecayed top-k; FreshnessSearcher applies the decay while
+ * it scans, so the heap holds the k best decayed scores of everything
+ * scanned. For L2 indexes the distance is divided by the same factor.
+ * Documents without a timestamp decay to 0 (they rank after dated ones).
+ *
+ * Timestamps come from the metadata columns: a numeric or date field
+ * (dates are stored as epoch seconds), read without locking per row.
+ *
+ * The scan is split into segments it can skip. A flat index is cut into
+ * blocks of kBlockRows consecutive rows; documents are appended as they
+ * arrive, so each block covers a time range. An IVF-flat index scans its
+ * probed lists. Every segment keeps a summary (centroid, radius, oldest
+ * and newest timestamp) that bounds the best decayed score any of its
+ * documents can reach. Segments are scanned best bound first, and the
+ * scan stops at the first one whose bound cannot beat the current k-th
+ * score; old segments fall away as soon as the heap holds fresh matches.
+ * LSM delta segments (the newest documents) are scanned exactly, first.
+ *
+ * Other index types (HNSW, PQ, DiskANN) are searched for
+ * k * candidate_multiplier undecayed candidates, which are re-scored.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <faiss/Index.h>
+#include <faiss/impl/IDSelector.h>
+#include <nlohmann/json.hpp>
+
+#include "index_version.h"
+#include "metadata_filter.h"
+
+namespace neurorag {
+
+class LsmIndex;
+
+/**
+ * @brief Per-search decay: score x exp(-lambda x age in days)
+ */
+struct TimeDecay {
+    double lambda = 0.0;                                 // Per day of age
+    double now = 0.0;                                    // Epoch seconds ages are measured from
+    const ChunkedColumn<double>* timestamps = nullptr;   // Epoch seconds by internal id
+
+    /**
+     * @brief Decay of a timestamp; future ones count as age 0, NaN (undated) as 0
+     */
+    float factor_at(double timestamp) const;
+
+    float factor(faiss::idx_t row) const { return factor_at(timestamps->get(row)); }
+};
+
+/**
+ * @brief Decayed top-k over flat, IVF-flat and LSM delta segments
+ *
+ * Segment summaries are built on first use and refreshed when a block
+ * fills up or an IVF list changes; they are reset when the index or the
+ * timestamp column is replaced.
+ */
+class FreshnessSearcher {
+public:
+    static constexpr size_t kBlockRows = 4096;
+
+    /**
+     * @brief Constructor
+     * @param field Metadata field holding the document timestamp
+     * @param candidate_multiplier Undecayed candidates per result for indexes that cannot be scanned
+     */
+    FreshnessSearcher(std::string field, int candidate_multiplier);
+
+    const std::string& field() const { return field_; }
+
+    /**
+     * @brief Search with time-decayed scores
+     * @param serving Serving index (an LsmIndex is searched with its delta segments)
+     * @param versions List versions of an IVF index updated in place, or nullptr
+     * @param n Number of queries
+     * @param x n x d index-space queries
+     * @param k Results per query
+     * @param decay Lambda, reference time and timestamps
+     * @param sel Filter, or nullptr
+     * @param distances n x k decayed scores (IP) or distances (L2), best first
+     * @param labels n x k internal ids, -1 where fewer than k documents pass
+     */
+    void search(const std::shared_ptr<const faiss::Index>& serving, const IndexVersionTracker* versions,
+                faiss::idx_t n, const float* x, faiss::idx_t k, const TimeDecay& decay,
+                const faiss::IDSelector* sel, float* distances, faiss::idx_t* labels);
+
+    /**
+     * @brief Segments scanned and skipped, fallbacks
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    // Bounds the decayed score of the documents of one block or list
+    struct Summary {
+        std::vector<float> centroid;
+        float radius = 0.0f;
+        double oldest = 0.0;
+        double newest = 0.0;
+        bool undated = false;      // Some rows had no timestamp when summarized
+        size_t rows = 0;           // Rows summarized; a list whose size changed is stale
+        uint64_t version = 0;      // IVF list version when summarized
+        bool valid = false;
+    };
+
+    std::string field_;
+    int candidate_multiplier_;
+
+    mutable std::mutex summaries_mutex_;
+    std::weak_ptr<const faiss::Index> summarized_;   // Index the summaries describe
+    const void* summarized_timestamps_ = nullptr;
+    size_t flat_rows_ = 0;                            // Rows of the flat index when last seen
+    std::vector<Summary> summaries_;
+
+    std::atomic<uint64_t> searches_{0};
+    std::atomic<uint64_t> fallback_searches_{0};
+    std::atomic<uint64_t> segments_scanned_{0};
+    std::atomic<uint64_t> segments_skipped_{0};
+    std::atomic<uint64_t> vectors_scored_{0};
+    std::atomic<uint64_t> delta_vectors_scored_{0};
+
+    // Drops the summaries when the index or the timestamp column was
+    // replaced, or a flat index shrank. Call under summaries_mutex_
+    void track(const std::shared_ptr<const faiss::Index>& base, const TimeDecay& decay);
+
+    // Best decayed score per segment for one query (higher is better);
+    // summaries are refreshed first. Call under summaries_mutex_
+    void segment_bounds(const faiss::Index& base, const IndexVersionTracker* versions, const float* query,
+                        const TimeDecay& decay, const std::vector<int64_t>& segments, std::vector<float>& bounds);
+
+    // Recomputes one block's or list's summary. Call under summaries_mutex_
+    void summarize(const faiss::Index& base, int64_t segment, const TimeDecay& decay, uint64_t version);
+};
+
+} // namespace neurorag
@@ -0,0 +1,90 @@
+/**
+ * @file id_map.h
+ * @brief Mapping between external document ids and internal vector ids
+ *
+ * Upserts look up the internal id of an external document id on every
+ * insert, and result decoding looks up the other direction, so both are
+ * ConcurrentHashMaps: lookups never lock, and writers of different ids
+ * rarely share a lock stripe. Each direction is updated on its own, so a
+ * reader racing an assign may briefly see only one of them; the engine
+ * serializes assigns for the same document under index_mutex_.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "concurrent_hash_map.h"
+
+namespace neurorag {
+
+/**
+ * @brief External document id <-> internal vector id
+ */
+class DocumentIdMap {
+public:
+    /**
+     * @brief Constructor
+     * @param expected Documents to size the maps for
+     */
+    explicit DocumentIdMap(size_t expected = 0);
+
+    /**
+     * @brief Internal id of a document
+     * @return -1 if unknown
+     */
+    int64_t find(const std::string& external_id) const;
+
+    /**
+     * @brief External id of an internal id
+     * @return false if the vector has no document id
+     */
+    bool external_id(int64_t internal_id, std::string& external_id) const;
+
+    /**
+     * @brief Point a document at a (new) internal id
+     * @return Internal id it replaced, or -1 if the document is new
+     */
+    int64_t assign(const std::string& external_id, int64_t internal_id);
+
+    /**
+     * @brief Forget a document
+     * @return Internal id it had, or -1 if unknown
+     */
+    int64_t erase(const std::string& external_id);
+
+    /**
+     * @brief Forget whichever document an internal id belongs to
+     * @return false if it had none
+     */
+    bool erase_internal(int64_t internal_id);
+
+    void clear();
+
+    size_t size() const { return forward_.size(); }
+
+    /**
+     * @brief Table statistics of both directions
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    ConcurrentHashMap<std::string, int64_t> forward_;
+    ConcurrentHashMap<int64_t, std::string> reverse_;
+};
+
+/**
+ * @brief Document id stored in a metadata entry
+ *
+ * Metadata is the document JSON written by ingestion; its "id" field
+ * (string or number) is the external id.
+ * @return false if the entry is not a JSON object with an id
+ */
+bool metadata_document_id(const std::string& metadata, std::string& external_id);
+
+} // namespace neurorag
@@ -0,0 +1,184 @@
+/**
+ * @file index_builder.h
+ * @brief Parallel offline index construction (IVF training, HNSW, DiskANN)
+ *
+ * Replaces the single-process Python build in scripts/ingest_data.py for
+ * large corpora. IVF centroids are trained with mini-batch or two-level
+ * (hierarchical) k-means on a sample, and vectors are assigned to lists
+ * in parallel with blocked GEMM (BLAS sgemm) rather than one brute-force
+ * search per vector. HNSW graphs are built with FAISS's concurrent
+ * insertion, and DiskANN graphs with DiskAnnIndex::build.
+ *
+ * IVF indexes are written with their lists in an OnDiskInvertedLists
+ * data file (<output>.ivfdata) next to the index, so the service can map
+ * the lists with faiss::IO_FLAG_MMAP instead of reading them into memory.
+ * The index itself is written as a plain faiss file, which start-up
+ * loading reads, or on request as a checksummed index file (index_file.h),
+ * which only read_index_file (reloads, snapshots) accepts.
+ * Input vectors are memory-mapped from .npy (float32, C order) or .fbin
+ * (uint32 n, uint32 d, then n * d float32) files.
+ *
+ * With preprocessing options (normalize, center, PCA/OPQ), the transform
+ * is trained on a sample first, every vector is transformed into an
+ * in-memory copy the index is built from, and the transform is written to
+ * <output>.transform for the service to apply to inserts and queries. The
+ * report estimates the top-10 recall kept by the reduced space.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include <faiss/Index.h>
+#include <nlohmann/json.hpp>
+
+#include "diskann_index.h"
+#include "vector_preprocessor.h"
+
+namespace neurorag {
+
+/**
+ * @brief Build settings, mirroring the ingest script's options
+ */
+struct IndexBuildOptions {
+    std::string index_type = "IVF_FLAT";   // FLAT, IVF_FLAT, HNSW or DISKANN
+    faiss::MetricType metric = faiss::METRIC_INNER_PRODUCT;
+    int nlist = 1024;
+    std::string kmeans = "minibatch";     // minibatch or hierarchical
+    size_t training_size = 0;             // 0: 256 points per centroid
+    size_t kmeans_batch_size = 65536;
+    int kmeans_epochs = 20;               // passes over the training sample
+    int hnsw_m = 32;
+    int ef_construction = 200;
+    DiskAnnBuildParams diskann;
+    size_t chunk_size = 1 << 20;          // vectors assigned/added per step
+    int num_threads = 0;                  // 0: all cores
+    bool checksummed = false;             // index_file.h container; false: plain faiss file
+    VectorPreprocessorOptions preprocess; // trained first; written to <output>.transform
+    size_t recall_queries = 100;          // preprocess: sample queries for the recall estimate
+};
+
+/**
+ * @brief Read-only memory map of an input vector file
+ */
+class VectorFile {
+public:
+    VectorFile();
+    ~VectorFile();
+    VectorFile(const VectorFile&) = delete;
+    VectorFile& operator=(const VectorFile&) = delete;
+
+    /**
+     * @brief Map a .npy or .fbin file
+     * @return false if the file is missing or not a 2-D float32 matrix
+     */
+    bool open(const std::string& path);
+
+    const float* data() const { return data_; }
+    size_t count() const { return count_; }
+    int dimension() const { return dimension_; }
+
+private:
+    void* mapping_;
+    size_t mapping_size_;
+    const float* data_;
+    size_t count_;
+    int dimension_;
+};
+
+/**
+ * @brief Throttled progress and throughput lines for one build stage
+ */
+class BuildProgress {
+public:
+    /**
+     * @param stage Stage name shown on every line
+     * @param total Units of work in the stage
+     * @param unit Name of a unit (e.g. "vectors")
+     */
+    BuildProgress(std::string stage, size_t total, std::string unit = "vectors");
+
+    /**
+     * @brief Record completed work; prints at most every two seconds
+     * @param done Units completed since the last call (thread-safe)
+     */
+    void advance(size_t done);
+
+    /**
+     * @brief Print the stage total, elapsed time and average rate
+     * @return Seconds spent in the stage
+     */
+    double finish();
+
+private:
+    std::string stage_;
+    std::string unit_;
+    size_t total_;
+    std::atomic<size_t> done_;
+    std::chrono::steady_clock::time_point start_;
+    std::mutex print_mutex_;
+    std::chrono::steady_clock::time_point last_print_;
+};
+
+/**
+ * @brief Nearest centroid of every vector, by blocked GEMM
+ *
+ * Vectors and centroids are processed in tiles; each tile's inner
+ * products come from one sgemm call and the argmin/argmax is taken over
+ * the tile. Tiles of vectors are spread over OpenMP threads.
+ * @param n Number of vectors
+ * @param x Vectors (n * d)
+ * @param d Dimension
+ * @param centroids Centroids (k * d)
+ * @param k Number of centroids
+ * @param metric L2 picks the closest, inner product the largest
+ * @param labels Output: centroid per vector (n)
+ * @param distances Optional output: distance or similarity to it (n)
+ */
+void assign_to_centroids(size_t n, const float* x, int d, const float* centroids, size_t k,
+                         faiss::MetricType metric, faiss::idx_t* labels, float* distances = nullptr);
+
+/**
+ * @brief Train k centroids on a sample
+ * @param n Number of training vectors
+ * @param x Training vectors (n * d)
+ * @param d Dimension
+ * @param k Number of centroids
+ * @param options kmeans, kmeans_batch_size, kmeans_epochs and metric are used
+ * @return Centroids (k * d); unit length for inner product
+ */
+std::vector<float> train_kmeans(size_t n, const float* x, int d, size_t k, const IndexBuildOptions& options);
+
+/**
+ * @brief Share of the exact top-k neighbours still found in index space
+ *
+ * Compares brute-force top-k in the embedding space (cosine when the
+ * transform normalizes) with top-k after the transform, for sample
+ * queries against a sample of the corpus; the query's own row is skipped.
+ * @param vectors Input vectors
+ * @param preprocessor Transform under test
+ * @param metric Index metric
+ * @param num_queries Sample queries
+ * @param k Neighbours compared per query
+ * @return Mean recall in [0, 1]
+ */
+double measure_transform_recall(const VectorFile& vectors, const VectorPreprocessor& preprocessor,
+                                faiss::MetricType metric, size_t num_queries, size_t k = 10);
+
+/**
+ * @brief Build an index over a vector file and write it
+ * @param vectors Input vectors; ids are row numbers
+ * @param output_path Index file (written to output_path.tmp and renamed)
+ * @param options Build settings
+ * @return Build report (stage timings and throughput), or null on failure
+ */
+nlohmann::json build_index_file(const VectorFile& vectors, const std::string& output_path,
+                                const IndexBuildOptions& options);
+
+} // namespace neurorag
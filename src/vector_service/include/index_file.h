@@ -0,0 +1,164 @@
+/**
+ * @file index_file.h
+ * @brief Checksummed, versioned container for single-file faiss indexes
+ *
+ * An index file is laid out as
+ *
+ *   [0, 4096)            IndexFileHeader (format version, dimension,
+ *                        metric, index type, vector count, layout)
+ *   [4096, +payload)     the faiss serialization, unchanged
+ *   [table_offset, ...)  one 64-bit checksum per payload block
+ *
+ * The payload is cut into fixed-size blocks (4 MiB by default), each
+ * checksummed with CRC32C or xxHash64 while it is written. The header
+ * and the block table carry checksums of their own and the header is
+ * written last, so a crash or a truncated download is detected from the
+ * first 4 KiB and the file size alone (inspect_index_file), without
+ * reading the payload.
+ *
+ * Full verification (verify_index_file) reads and checks blocks in
+ * parallel; with CRC32C at several GB/s per core, a 20 GB index is
+ * verified in a few seconds on a machine whose disk keeps up. Lazy
+ * verification checks each block as the loader first reads it, so a
+ * corrupt block fails the load without a separate pass over the file.
+ *
+ * Files without the header (plain faiss::write_index output) are still
+ * read, with a warning, so existing deployments keep loading.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <faiss/Index.h>
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+constexpr uint32_t kIndexFileMagic = 0x5849524E;  // "NRIX"
+constexpr uint32_t kIndexFileVersion = 1;
+constexpr size_t kIndexFileHeaderBytes = 4096;
+
+/**
+ * @brief Block checksum algorithm
+ */
+enum class IndexChecksum : uint32_t {
+    CRC32C = 1,
+    XXHASH64 = 2
+};
+
+/**
+ * @brief When payload blocks are checked on load
+ */
+enum class IndexVerification {
+    NONE,    // header and table only
+    LAZY,    // each block as the loader first reads it
+    FULL     // every block, in parallel, before the index is parsed
+};
+
+#pragma pack(push, 1)
+/**
+ * @brief Fixed header at the start of an index file
+ */
+struct IndexFileHeader {
+    uint32_t magic;              // kIndexFileMagic
+    uint32_t version;            // kIndexFileVersion
+    uint32_t header_bytes;       // payload offset
+    uint32_t dimension;
+    uint32_t metric;             // faiss::MetricType
+    uint32_t checksum;           // IndexChecksum
+    char index_type[32];         // FLAT, IVF_FLAT, HNSW_FLAT or FAISS; NUL padded
+    uint64_t ntotal;
+    uint64_t payload_bytes;
+    uint64_t block_bytes;
+    uint64_t num_blocks;
+    uint64_t table_offset;       // num_blocks 64-bit checksums
+    int64_t created_at;          // unix seconds
+    uint32_t table_crc;          // CRC32C of the block table
+    uint32_t header_crc;         // CRC32C of the fields above
+};
+#pragma pack(pop)
+
+/**
+ * @brief Outcome of checking an index file
+ */
+enum class IndexFileStatus {
+    OK,
+    LEGACY,        // plain faiss file without a header; nothing to check
+    TRUNCATED,     // shorter than its header says, or header never written
+    CORRUPT,       // header, table or payload checksum mismatch
+    UNREADABLE     // missing, or an I/O error
+};
+
+const char* index_file_status_name(IndexFileStatus status);
+
+/**
+ * @brief Result of inspect_index_file or verify_index_file
+ */
+struct IndexFileCheck {
+    IndexFileStatus status = IndexFileStatus::UNREADABLE;
+    IndexFileHeader header{};
+    std::vector<uint64_t> bad_blocks;   // verify_index_file only
+    uint64_t file_bytes = 0;
+    double seconds = 0.0;
+    std::string message;
+
+    bool ok() const { return status == IndexFileStatus::OK || status == IndexFileStatus::LEGACY; }
+    nlohmann::json to_json() const;
+};
+
+/**
+ * @brief Index file write and load settings
+ */
+struct IndexFileOptions {
+    size_t block_bytes = size_t{4} << 20;
+    IndexChecksum checksum = IndexChecksum::CRC32C;
+    IndexVerification verify = IndexVerification::LAZY;
+    bool mmap = false;            // load: faiss::IO_FLAG_MMAP (IVF lists stay on disk)
+    int num_threads = 0;          // 0: all cores
+};
+
+/**
+ * @brief Parse "none", "lazy" or "full"
+ * @return false for anything else
+ */
+bool parse_index_verification(const std::string& name, IndexVerification& verification);
+
+/**
+ * @brief Write an index as a checksummed index file
+ *
+ * Written to <path>.tmp, synced and renamed, so readers never see a
+ * partial file.
+ * @return false on any I/O or serialization error
+ */
+bool write_index_file(const faiss::Index& index, const std::string& path,
+                      const IndexFileOptions& options = IndexFileOptions());
+
+/**
+ * @brief Check the header, block table and file size without reading the payload
+ */
+IndexFileCheck inspect_index_file(const std::string& path);
+
+/**
+ * @brief Check every payload block against its checksum, in parallel
+ * @param num_threads Readers; 0 for all cores
+ */
+IndexFileCheck verify_index_file(const std::string& path, int num_threads = 0);
+
+/**
+ * @brief Load an index file, verifying it as configured
+ *
+ * Plain faiss files are loaded unchecked. With mmap, blocks are verified
+ * up front in parallel when verification is not NONE, since a mapped
+ * load does not read the lists it maps.
+ * @return The index, or nullptr if the file is missing, truncated,
+ *         corrupt or cannot be parsed
+ */
+std::unique_ptr<faiss::Index> read_index_file(const std::string& path,
+                                              const IndexFileOptions& options = IndexFileOptions());
+
+} // namespace neurorag
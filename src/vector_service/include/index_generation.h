@@ -0,0 +1,139 @@
+/**
+ * @file index_generation.h
+ * @brief Hot index swap: serve one index generation, load the next beside it
+ *
+ * GenerationIndex is installed as the engine's index once at startup and
+ * forwards every call to the current generation. A reload builds the next
+ * generation in the background (read or memory-mapped, segment by
+ * segment), prefaults it, and publishes it with a single pointer
+ * exchange; searches never wait for a reload and never see a partly
+ * loaded index.
+ *
+ * The previous generation is retired, not freed: searches that started
+ * on it finish on it. Readers pin the generation's EpochManager
+ * (epoch-based reclamation, see epoch_reclaimer.h), and a retired
+ * generation is freed once no pinned reader predates its retirement.
+ * Reclamation runs on the reloading thread, never on the search path.
+ *
+ * Memory: a memory-mapped generation adds little beyond its quantizer,
+ * and successive snapshot generations map the same content-addressed
+ * segment files, so unchanged lists share page cache. A generation that
+ * is read into DRAM needs room for both generations until the old one
+ * drains.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include <faiss/Index.h>
+#include <nlohmann/json.hpp>
+
+#include "epoch_reclaimer.h"
+#include "lsm_index.h"
+
+namespace neurorag {
+
+/**
+ * @brief Index whose serving generation can be replaced while it is searched
+ */
+class GenerationIndex : public faiss::Index, public LayeredIndex {
+public:
+    /**
+     * @brief Constructor
+     * @param initial First generation
+     */
+    explicit GenerationIndex(std::unique_ptr<faiss::Index> initial);
+    ~GenerationIndex() override;
+
+    GenerationIndex(const GenerationIndex&) = delete;
+    GenerationIndex& operator=(const GenerationIndex&) = delete;
+
+    /**
+     * @brief Handle to the current generation
+     *
+     * Keeps the generation alive until released; hold it only as long as
+     * needed, since it also holds back reclamation of later retirements.
+     */
+    std::shared_ptr<faiss::Index> current() const;
+
+    /**
+     * @brief Serve a new generation
+     *
+     * Calls already running finish on the previous generation, which is
+     * freed by reclaim() once they have.
+     * @param index New generation; must have the same dimension and metric
+     * @return Number of the published generation
+     */
+    uint64_t publish(std::unique_ptr<faiss::Index> index);
+
+    /**
+     * @brief Free retired generations no reader can still be using
+     * @return Generations freed
+     */
+    size_t reclaim();
+
+    /**
+     * @brief Reclaim until every retired generation is freed
+     * @return false if readers still held one when the timeout expired
+     */
+    bool drain(std::chrono::milliseconds timeout);
+
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Generation numbers, retired generations and reader slots in use
+     */
+    nlohmann::json get_statistics() const;
+
+    std::shared_ptr<const faiss::Index> base_index() const override;
+
+    // faiss::Index
+    void add(faiss::idx_t n, const float* x) override;
+    void add_with_ids(faiss::idx_t n, const float* x, const faiss::idx_t* xids) override;
+    void search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                const faiss::SearchParameters* params = nullptr) const override;
+    void reset() override;
+    size_t remove_ids(const faiss::IDSelector& sel) override;
+    void reconstruct(faiss::idx_t key, float* recons) const override;
+
+private:
+    static constexpr size_t kReaderSlots = 1024;
+
+    /**
+     * @brief Generation pinned for the duration of one call
+     */
+    class Pin {
+    public:
+        explicit Pin(const GenerationIndex& owner)
+            : guard_(owner.epochs_), index_(owner.current_.load()) {}
+
+        faiss::Index* index() const { return index_; }
+
+    private:
+        EpochManager::Guard guard_;
+        faiss::Index* index_;
+    };
+
+    std::atomic<faiss::Index*> current_;
+    std::atomic<uint64_t> generation_;
+    std::atomic<int64_t> published_at_;
+
+    // Generations retired and not yet freed, for statistics
+    mutable std::mutex retired_mutex_;
+    std::vector<uint64_t> retired_;
+    std::atomic<uint64_t> reclaimed_;
+
+    // Last: destroyed first, while the bookkeeping its reclaims touch is alive
+    EpochManager epochs_;
+};
+
+} // namespace neurorag
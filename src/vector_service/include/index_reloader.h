@@ -0,0 +1,99 @@
+/**
+ * @file index_reloader.h
+ * @brief Background index reloads, on request or when the source changes
+ *
+ * A reload loads the next index generation beside the serving one and
+ * hands it to the engine's GenerationIndex (see index_generation.h).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+class VectorSearchEngine;
+class ReadinessGate;
+
+/**
+ * @brief Runs index reloads in the background, on request or on file change
+ *
+ * One reload runs at a time. The watcher polls the source: a snapshot
+ * directory reloads when its manifest version changes, an index file when
+ * its size or modification time does (replace it by rename, not in place).
+ */
+class IndexReloader {
+public:
+    /**
+     * @brief Constructor
+     * @param engine Engine to reload (not owned)
+     * @param readiness Gate whose residency tracking follows the new
+     *        generation, or nullptr (not owned)
+     * @param prefault_threads Threads prefaulting a new generation
+     * @param lock_memory mlock new generations, as at startup
+     */
+    IndexReloader(VectorSearchEngine* engine, ReadinessGate* readiness,
+                  int prefault_threads, bool lock_memory);
+    ~IndexReloader();
+
+    IndexReloader(const IndexReloader&) = delete;
+    IndexReloader& operator=(const IndexReloader&) = delete;
+
+    /**
+     * @brief Start a reload in the background
+     * @param path Snapshot directory or faiss index file
+     * @param mmap Map the new generation instead of reading it
+     * @return false if a reload is already running
+     */
+    bool request(const std::string& path, bool mmap);
+
+    /**
+     * @brief Reload whenever the source changes
+     * @param path Snapshot directory or faiss index file
+     * @param mmap Map new generations instead of reading them
+     * @param interval Time between checks
+     */
+    void watch(const std::string& path, bool mmap, std::chrono::seconds interval);
+
+    /**
+     * @brief Stop watching and wait for a running reload
+     */
+    void stop();
+
+    /**
+     * @brief State of the running or last reload
+     */
+    nlohmann::json get_status() const;
+
+private:
+    VectorSearchEngine* engine_;
+    ReadinessGate* readiness_;
+    int prefault_threads_;
+    bool lock_memory_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable stop_condition_;
+    bool stopping_;
+    bool running_;
+    std::thread reload_thread_;
+    std::thread watch_thread_;
+
+    std::string last_path_;
+    bool last_succeeded_;
+    double last_seconds_;
+    int64_t last_finished_at_;
+    uint64_t reloads_;
+    uint64_t failures_;
+
+    void run(const std::string& path, bool mmap);
+    void watch_loop(std::string path, bool mmap, std::chrono::seconds interval);
+};
+
+} // namespace neurorag
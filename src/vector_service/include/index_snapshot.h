@@ -0,0 +1,235 @@
+/**
+ * @file index_snapshot.h
+ * @brief Index snapshots as immutable segment files described by a manifest
+ *
+ * A snapshot directory holds:
+ *
+ *   manifest.json               the current snapshot (replaced atomically)
+ *   manifests/<version>.json    the last few snapshots, for rollback
+ *   segments/<kind>-<crc>-<bytes>.seg
+ *
+ * Segments are content-addressed and never modified. The index is split
+ * along the lines updates follow: IVF lists are grouped into a fixed set
+ * of "codes" and "ids" segments, so an insert rewrites only the groups of
+ * the lists it touched; flat vectors, HNSW graph arrays, metadata and any
+ * other faiss index are cut into fixed-size chunks, so appends rewrite
+ * only the tail. A new snapshot writes the segments that do not exist yet
+ * and reuses the rest.
+ *
+ * The same layout makes incremental deployment a file sync: a pod that
+ * already holds the previous snapshot downloads the new manifest and the
+ * segments it lacks (scripts/sync_index_snapshot.py), never the whole
+ * index.
+ *
+ * Segments load in parallel, each verified against its CRC32C. In lazy
+ * mode IVF list segments are memory-mapped instead of read, so start-up
+ * costs only the quantizer and pages fault in on first probe (or when the
+ * readiness gate prefaults them); lists modified afterwards are copied to
+ * DRAM. A mapped segment pair is verified the first time one of its
+ * lists is accessed; the lists of a pair that fails are served empty.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include <faiss/Index.h>
+#include <faiss/invlists/InvertedLists.h>
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief One immutable segment file
+ */
+struct SnapshotSegment {
+    std::string kind;          // quantizer, codes, ids, vectors, graph, metadata, transform or faiss
+    std::string array;         // graph array (levels, offsets, neighbors); empty otherwise
+    std::string file;          // relative to the snapshot directory
+    uint64_t offset = 0;       // byte offset of a chunk within its array
+    uint64_t bytes = 0;
+    uint32_t crc32c = 0;
+    int64_t first_list = 0;    // codes and ids segments
+    int64_t num_lists = 0;
+};
+
+/**
+ * @brief Versioned description of a snapshot
+ */
+struct SnapshotManifest {
+    static constexpr int kFormatVersion = 1;
+
+    int format_version = kFormatVersion;
+    uint64_t version = 0;          // increases with every snapshot written to a directory
+    int64_t created_at = 0;        // unix seconds
+    std::string index_type;        // FLAT, IVF_FLAT, HNSW_FLAT or FAISS (opaque faiss serialization)
+    int dimension = 0;
+    faiss::MetricType metric = faiss::METRIC_L2;
+    int64_t ntotal = 0;
+    nlohmann::json params;         // type-specific: nlist, nprobe, HNSW levels and entry point
+    std::vector<SnapshotSegment> segments;
+
+    nlohmann::json to_json() const;
+
+    /**
+     * @brief Parse a manifest
+     * @return false if fields are missing or the format version is unknown
+     */
+    static bool from_json(const nlohmann::json& value, SnapshotManifest& manifest);
+
+    /**
+     * @brief Read <directory>/manifest.json
+     * @return false if the directory holds no readable snapshot
+     */
+    static bool read(const std::string& directory, SnapshotManifest& manifest);
+
+    /**
+     * @brief Bytes in the segments of one kind (and graph array)
+     */
+    uint64_t total_bytes(const std::string& kind, const std::string& array = "") const;
+};
+
+/**
+ * @brief Snapshot write and load settings
+ */
+struct SnapshotOptions {
+    size_t chunk_bytes = size_t{64} << 20;   // chunked kinds
+    size_t list_groups = 256;                // codes/ids segments per IVF index
+    int keep_versions = 2;                   // manifests whose segments survive pruning
+    int num_threads = 0;                     // 0: all cores
+    bool lazy = false;                       // load: map IVF lists instead of reading them
+    bool verify_checksums = true;            // load: check segments (mapped ones on first access)
+};
+
+/**
+ * @brief An index and its metadata loaded from a snapshot
+ */
+struct IndexSnapshot {
+    SnapshotManifest manifest;
+    std::unique_ptr<faiss::Index> index;
+    std::vector<std::string> metadata;
+    std::vector<uint8_t> transform;   // serialized VectorPreprocessor; empty if none
+};
+
+/**
+ * @brief Write a new snapshot of an index
+ *
+ * Segments already present in the directory are reused. The manifest is
+ * written last, so a crash leaves the previous snapshot current. Segments
+ * referenced by none of the last keep_versions manifests are deleted.
+ * @param index Index to write; must not be modified during the call
+ * @param metadata Per-vector metadata, or nullptr
+ * @param transform Serialized VectorPreprocessor the index was built with, or nullptr
+ * @param directory Snapshot directory (created if missing)
+ * @return Report with version and segments/bytes written and reused;
+ *         null on failure
+ */
+nlohmann::json write_index_snapshot(const faiss::Index& index,
+                                    const std::vector<std::string>* metadata,
+                                    const std::vector<uint8_t>* transform,
+                                    const std::string& directory,
+                                    const SnapshotOptions& options = SnapshotOptions());
+
+/**
+ * @brief Load the current snapshot of a directory
+ * @param snapshot Receives the manifest, index and metadata
+ * @return false if the manifest or a segment is missing, truncated or
+ *         fails its checksum
+ */
+bool read_index_snapshot(const std::string& directory, IndexSnapshot& snapshot,
+                         const SnapshotOptions& options = SnapshotOptions());
+
+/**
+ * @brief IVF lists served from memory-mapped snapshot segments
+ *
+ * Lists point into read-only mappings of the codes and ids segments until
+ * they are modified; the first add, update or resize copies a list into
+ * DRAM. Modifications must be serialized by the caller, as with
+ * faiss::ArrayInvertedLists.
+ */
+class MappedInvertedLists : public faiss::InvertedLists {
+public:
+    MappedInvertedLists(size_t nlist, size_t code_size);
+    ~MappedInvertedLists() override;
+
+    /**
+     * @brief Map a codes segment and its matching ids segment
+     * @param checksums Expected CRC32C of the codes and ids files, checked
+     *        the first time one of their lists is accessed; nullptr skips
+     *        the check
+     * @return false if either file cannot be mapped or they disagree
+     */
+    bool map_segments(const std::string& codes_path, const std::string& ids_path,
+                      size_t first_list, size_t num_lists, const uint32_t* checksums = nullptr);
+
+    size_t list_size(size_t list_no) const override;
+    const uint8_t* get_codes(size_t list_no) const override;
+    const faiss::idx_t* get_ids(size_t list_no) const override;
+    size_t add_entries(size_t list_no, size_t n_entry, const faiss::idx_t* ids,
+                       const uint8_t* code) override;
+    void update_entries(size_t list_no, size_t offset, size_t n_entry, const faiss::idx_t* ids,
+                        const uint8_t* code) override;
+    void resize(size_t list_no, size_t new_size) override;
+
+    /**
+     * @brief Entries across all lists, without verifying mapped segments
+     */
+    size_t total_entries() const;
+
+    /**
+     * @brief Lists copied to DRAM since loading
+     */
+    size_t owned_lists() const;
+
+    /**
+     * @brief Segment pairs that failed verification on first access
+     */
+    size_t corrupt_segments() const { return corrupt_segments_.load(); }
+
+private:
+    struct Mapping {
+        void* address = nullptr;
+        size_t length = 0;
+    };
+
+    // A codes/ids segment pair, verified once on first access
+    struct SegmentGroup {
+        std::string name;
+        const uint8_t* data[2] = {nullptr, nullptr};
+        size_t length[2] = {0, 0};
+        uint32_t crc[2] = {0, 0};
+        std::once_flag verified;
+        std::atomic<bool> corrupt{false};
+    };
+
+    struct List {
+        const uint8_t* codes = nullptr;
+        const faiss::idx_t* ids = nullptr;
+        size_t size = 0;
+        bool owned = false;
+        SegmentGroup* group = nullptr;   // unverified mapped segments
+        std::vector<uint8_t> own_codes;
+        std::vector<faiss::idx_t> own_ids;
+    };
+
+    std::vector<Mapping> mappings_;
+    std::vector<std::unique_ptr<SegmentGroup>> groups_;
+    std::vector<List> lists_;
+    mutable std::atomic<size_t> corrupt_segments_;
+
+    /**
+     * @brief Verify a mapped list's segments on first use
+     * @return false if they are corrupt
+     */
+    bool check_list(const List& list) const;
+
+    void make_owned(size_t list_no);
+};
+
+} // namespace neurorag
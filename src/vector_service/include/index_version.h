@@ -0,0 +1,126 @@
+/**
+ * @file index_version.h
+ * @brief Index versioning for dependency-tracked result cache invalidation
+ *
+ * The engine keeps a monotonic version per IVF inverted list plus a global
+ * version and a structural epoch. A cached SearchResult stores the versions
+ * it depended on: the probed lists for IVF indexes, the global version for
+ * flat and HNSW indexes. A lookup compares those few counters against the
+ * live ones, so entries stay valid under long TTLs and only results whose
+ * probed lists changed are invalidated. With a delta index enabled every
+ * search also scans the whole delta, so entries additionally record the
+ * LsmIndex version, which any add, remove or merge advances.
+ *
+ * Dependencies must be captured before the search runs; an update racing
+ * with the search then leaves the entry stale rather than wrongly current.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief Versions a cached result depends on
+ */
+struct CacheDependency {
+    uint64_t epoch = 0;
+    uint64_t global_version = 0;
+    // LsmIndex::version() at capture time, 0 without a delta index
+    uint64_t delta_version = 0;
+    // (list id, version) for every inverted list the search probed; empty
+    // for non-IVF indexes, which are validated by global_version instead
+    std::vector<std::pair<int64_t, uint64_t>> list_versions;
+};
+
+/**
+ * @brief Monotonic per-list and global index versions
+ */
+class IndexVersionTracker {
+public:
+    IndexVersionTracker();
+
+    /**
+     * @brief Start a new epoch for a freshly loaded or rebuilt index
+     * @param num_lists Number of IVF lists, 0 for non-IVF indexes
+     *
+     * Must not run concurrently with capture() or is_current(); the engine
+     * calls it while holding the index lock exclusively.
+     */
+    void reset(size_t num_lists);
+
+    /**
+     * @brief Start a new epoch for an index swapped in while searches run
+     * @param num_lists Number of IVF lists of the new index
+     *
+     * Safe alongside capture() and is_current(): the list versions are
+     * kept, not reallocated. An index with more lists than were allocated
+     * by reset() is tracked by the global version only.
+     */
+    void advance(size_t num_lists);
+
+    /**
+     * @brief Record an update whose affected lists are known
+     * @param list_ids Lists that gained or lost vectors (duplicates allowed)
+     */
+    void bump_lists(const std::vector<int64_t>& list_ids);
+
+    /**
+     * @brief Record an update whose affected lists are unknown
+     *
+     * Invalidates every cached entry by advancing the epoch.
+     */
+    void bump_all();
+
+    /**
+     * @brief Snapshot the versions a search over the given lists depends on
+     * @param probed_lists Lists the search will scan (empty for non-IVF)
+     * @param delta_version Current delta index version (0 without one)
+     */
+    CacheDependency capture(const std::vector<int64_t>& probed_lists, uint64_t delta_version = 0) const;
+
+    /**
+     * @brief Check whether a cached dependency is still current
+     * @param delta_version Current delta index version (0 without one)
+     */
+    bool is_current(const CacheDependency& dependency, uint64_t delta_version = 0) const;
+
+    uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+    uint64_t global_version() const { return global_version_.load(std::memory_order_acquire); }
+    size_t num_lists() const { return num_lists_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Version counters and invalidation statistics
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    std::atomic<uint64_t> epoch_;
+    std::atomic<uint64_t> global_version_;
+    std::unique_ptr<std::atomic<uint64_t>[]> list_versions_;
+    size_t list_capacity_;
+    std::atomic<size_t> num_lists_;
+
+    mutable std::atomic<uint64_t> validations_;
+    mutable std::atomic<uint64_t> stale_detected_;
+};
+
+/**
+ * @brief JSON form stored alongside a cached result
+ */
+nlohmann::json cache_dependency_to_json(const CacheDependency& dependency);
+
+/**
+ * @brief Parse the JSON form; a missing or malformed field yields epoch 0,
+ *        which never validates
+ */
+CacheDependency cache_dependency_from_json(const nlohmann::json& value);
+
+} // namespace neurorag
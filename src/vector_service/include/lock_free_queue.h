@@ -0,0 +1,157 @@
+/**
+ * @file lock_free_queue.h
+ * @brief Lock-free multi-producer, multi-consumer queue
+ *
+ * Michael-Scott queue: a linked list with a dummy head node, producers
+ * swing the tail and consumers the head with compare-and-swap. A node
+ * unlinked by dequeue may still be read by a consumer or producer that
+ * loaded it just before, so it is retired to the queue's EpochManager and
+ * freed once no operation that could have seen it is running; every
+ * operation pins the manager for its duration.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "epoch_reclaimer.h"
+
+namespace neurorag {
+
+/**
+ * @brief Lock-free queue for high-performance request processing
+ */
+template<typename T>
+class LockFreeQueue {
+public:
+    LockFreeQueue();
+    ~LockFreeQueue();
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    bool enqueue(const T& item);
+    bool enqueue(T&& item);
+    bool dequeue(T& item);
+    size_t size() const;
+    bool empty() const;
+
+    /**
+     * @brief Reclamation statistics of the queue's nodes
+     */
+    nlohmann::json get_statistics() const { return epochs_.get_statistics(); }
+
+private:
+    struct Node {
+        std::atomic<T*> data{nullptr};     // nullptr in the dummy head
+        std::atomic<Node*> next{nullptr};
+    };
+
+    std::atomic<Node*> head_;
+    std::atomic<Node*> tail_;
+    std::atomic<size_t> size_;
+    EpochManager epochs_;
+
+    bool push(std::unique_ptr<T> item);
+};
+
+template<typename T>
+LockFreeQueue<T>::LockFreeQueue()
+    : size_(0), epochs_(256) {
+    Node* dummy = new Node();
+    head_.store(dummy);
+    tail_.store(dummy);
+}
+
+template<typename T>
+LockFreeQueue<T>::~LockFreeQueue() {
+    // No operation may still be running; retired nodes go with epochs_
+    Node* node = head_.load();
+    while (node) {
+        Node* next = node->next.load();
+        delete node->data.load();
+        delete node;
+        node = next;
+    }
+}
+
+template<typename T>
+bool LockFreeQueue<T>::enqueue(const T& item) {
+    return push(std::make_unique<T>(item));
+}
+
+template<typename T>
+bool LockFreeQueue<T>::enqueue(T&& item) {
+    return push(std::make_unique<T>(std::move(item)));
+}
+
+template<typename T>
+bool LockFreeQueue<T>::push(std::unique_ptr<T> item) {
+    Node* node = new Node();
+    node->data.store(item.release(), std::memory_order_relaxed);
+    // Counted before it can be dequeued, so size() never wraps
+    size_.fetch_add(1, std::memory_order_relaxed);
+
+    EpochManager::Guard guard(epochs_);
+    for (;;) {
+        Node* tail = tail_.load();
+        Node* next = tail->next.load();
+        if (tail != tail_.load()) {
+            continue;
+        }
+        if (next) {
+            // Another producer linked a node but has not swung the tail yet
+            tail_.compare_exchange_weak(tail, next);
+            continue;
+        }
+        if (tail->next.compare_exchange_weak(next, node)) {
+            tail_.compare_exchange_strong(tail, node);
+            return true;
+        }
+    }
+}
+
+template<typename T>
+bool LockFreeQueue<T>::dequeue(T& item) {
+    EpochManager::Guard guard(epochs_);
+    for (;;) {
+        Node* head = head_.load();
+        Node* tail = tail_.load();
+        Node* next = head->next.load();
+        if (head != head_.load()) {
+            continue;
+        }
+        if (!next) {
+            return false;
+        }
+        if (head == tail) {
+            // Tail lags behind a linked node; help it along before unlinking
+            tail_.compare_exchange_weak(tail, next);
+            continue;
+        }
+        if (head_.compare_exchange_weak(head, next)) {
+            // next is the new dummy; only the consumer that unlinked head takes its item
+            std::unique_ptr<T> data(next->data.exchange(nullptr));
+            item = std::move(*data);
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            epochs_.retire(head);
+            return true;
+        }
+    }
+}
+
+template<typename T>
+size_t LockFreeQueue<T>::size() const {
+    return size_.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+bool LockFreeQueue<T>::empty() const {
+    EpochManager::Guard guard(epochs_);
+    return head_.load()->next.load() == nullptr;
+}
+
+} // namespace neurorag
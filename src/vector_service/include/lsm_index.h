@@ -0,0 +1,217 @@
+/**
+ * @file lsm_index.h
+ * @brief Main index plus in-memory delta segments, merged in the background
+ *
+ * Inserting into a trained IVF index assigns new vectors against stale
+ * centroids, and inserting into HNSW takes graph locks on the serving
+ * path. LsmIndex keeps the main index immutable instead: new vectors go
+ * into a small mutable delta segment (flat or HNSW) that is searched
+ * alongside it, and a background merge folds the delta into a fresh copy
+ * of the main index, which is swapped in atomically.
+ *
+ * Deletes set a bit in a tombstone bitmap. Both searches apply it through
+ * the faiss IDSelector hook, so deleted ids never take up result slots.
+ * IVF mains drop tombstoned vectors when they are merged. Flat and HNSW
+ * mains cannot remove vectors without renumbering them, so their deleted
+ * ids stay tombstoned.
+ *
+ * Searches snapshot the segment pointers and never wait for a merge; a
+ * merge holds a second copy of the main index while it builds.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <faiss/Index.h>
+#include <faiss/impl/IDSelector.h>
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief An index that wraps another one the engine can inspect
+ *
+ * Engine code that needs the concrete index (IVF list versions, page
+ * touching, residency regions) unwraps it through this interface.
+ */
+class LayeredIndex {
+public:
+    virtual ~LayeredIndex() = default;
+
+    /**
+     * @brief Current base index; stays valid while the pointer is held
+     */
+    virtual std::shared_ptr<const faiss::Index> base_index() const = 0;
+};
+
+/**
+ * @brief Concurrent bitmap of deleted ids
+ *
+ * Ids are covered by lazily allocated 128 KiB pages, so tests never take
+ * a lock. Negative ids and ids past the paged range go to a locked set.
+ */
+class TombstoneBitmap {
+public:
+    TombstoneBitmap();
+    ~TombstoneBitmap();
+
+    /**
+     * @brief Mark an id deleted
+     * @return true if it was not deleted before
+     */
+    bool set(faiss::idx_t id);
+
+    /**
+     * @brief Whether an id is deleted (lock-free for paged ids)
+     */
+    bool test(faiss::idx_t id) const;
+
+    size_t count() const { return count_.load(); }
+    size_t memory_bytes() const;
+
+private:
+    static constexpr size_t kPageBits = size_t{1} << 20;
+    static constexpr size_t kPageWords = kPageBits / 64;
+    static constexpr size_t kMaxPages = size_t{1} << 13;  // ids below 2^33
+
+    std::unique_ptr<std::atomic<std::atomic<uint64_t>*>[]> pages_;
+    std::atomic<size_t> allocated_pages_;
+    std::atomic<size_t> count_;
+
+    mutable std::mutex overflow_mutex_;
+    std::unordered_set<faiss::idx_t> overflow_;
+    std::atomic<bool> has_overflow_;
+};
+
+/**
+ * @brief Immutable main index plus delta segments and tombstones
+ */
+class LsmIndex : public faiss::Index, public LayeredIndex {
+public:
+    /**
+     * @brief Constructor
+     * @param main Trained main index; not modified after this call
+     * @param delta_type "flat" (exact scan) or "hnsw" for the delta segments
+     * @param next_id First id handed out by add()
+     */
+    LsmIndex(std::shared_ptr<faiss::Index> main, const std::string& delta_type, faiss::idx_t next_id);
+    ~LsmIndex() override;
+
+    /**
+     * @brief Whether an index can be used as the main index
+     * @param reason Why not, when it cannot
+     */
+    static bool can_wrap(const faiss::Index& main, std::string& reason);
+
+    /**
+     * @brief Merge in the background
+     * @param merge_threshold Delta size that triggers a merge right away
+     * @param interval Longest time between merges while anything is pending
+     */
+    void start_merging(size_t merge_threshold, std::chrono::milliseconds interval);
+
+    /**
+     * @brief Stop background merging (waits for a running merge)
+     */
+    void stop();
+
+    /**
+     * @brief Fold the current delta and pending deletes into a new main index
+     * @return false if the main index could not be copied or extended
+     */
+    bool merge();
+
+    std::shared_ptr<const faiss::Index> base_index() const override;
+
+    /**
+     * @brief The main index and the delta vectors that go with it
+     *
+     * For searches that score vectors themselves (time decay). visit is
+     * called once per delta segment, under the segment's lock, with its
+     * ids and raw vectors; tombstoned ids are included (see is_removed).
+     * @param visit Receives ids, n x d vectors and n
+     * @return The main index as of the same instant
+     */
+    std::shared_ptr<const faiss::Index> visit_delta(
+        const std::function<void(const faiss::idx_t*, const float*, size_t)>& visit) const;
+
+    /**
+     * @brief Whether an id was deleted or replaced
+     */
+    bool is_removed(faiss::idx_t id) const { return tombstones_.test(id); }
+
+    /**
+     * @brief Advances on every add, remove and merge, once searches see it
+     *
+     * Delta segments are scanned in full, so a cached result over this
+     * index depends on the whole delta; see CacheDependency::delta_version.
+     */
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    // faiss::Index
+    void add(faiss::idx_t n, const float* x) override;
+    void add_with_ids(faiss::idx_t n, const float* x, const faiss::idx_t* xids) override;
+    void search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                const faiss::SearchParameters* params = nullptr) const override;
+    void reset() override;
+    size_t remove_ids(const faiss::IDSelector& sel) override;
+    void reconstruct(faiss::idx_t key, float* recons) const override;
+
+    /**
+     * @brief Segment sizes, tombstones and merge counters
+     */
+    nlohmann::json get_statistics() const;
+
+    /**
+     * @brief DRAM held by delta segments and tombstones (estimated)
+     */
+    size_t memory_bytes() const;
+
+private:
+    struct DeltaSegment;
+
+    std::string delta_type_;
+
+    // Segment pointers; searches copy them and release the lock
+    mutable std::mutex state_mutex_;
+    std::shared_ptr<faiss::Index> main_;
+    std::vector<std::shared_ptr<DeltaSegment>> frozen_;  // being or waiting to be merged
+    std::shared_ptr<DeltaSegment> active_;
+    std::vector<faiss::idx_t> pending_deletes_;          // not yet purged from main_
+
+    TombstoneBitmap tombstones_;
+    std::atomic<faiss::idx_t> next_id_;
+    std::atomic<uint64_t> version_;
+
+    std::mutex merge_mutex_;
+    std::thread merge_thread_;
+    std::mutex merge_wait_mutex_;
+    std::condition_variable merge_condition_;
+    bool merging_;
+    size_t merge_threshold_;
+
+    std::atomic<uint64_t> merges_;
+    std::atomic<uint64_t> merge_failures_;
+    std::atomic<uint64_t> merged_vectors_;
+    std::atomic<uint64_t> purged_vectors_;
+    std::atomic<double> last_merge_seconds_;
+
+    std::shared_ptr<DeltaSegment> make_segment() const;
+    void merge_loop(std::chrono::milliseconds interval);
+};
+
+} // namespace neurorag
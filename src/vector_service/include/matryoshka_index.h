@@ -0,0 +1,113 @@
+/**
+ * @file matryoshka_index.h
+ * @brief Coarse-to-fine search over truncated (Matryoshka) embeddings
+ *
+ * Matryoshka-trained embedding models put the most information in the
+ * leading dimensions, so the first 256 of 1536 dimensions already rank
+ * documents well. MatryoshkaIndex keeps those prefixes in a compact
+ * array beside a flat index of the full vectors: a search scans the
+ * prefixes for k * candidate_multiplier candidates (a sixth of the memory
+ * traffic of a full scan at 256 of 1536 dimensions), then re-scores only
+ * the candidates with their full vectors.
+ *
+ * With inner product, prefixes are stored unit length, so the first pass
+ * ranks by cosine similarity of the truncated vectors as the models are
+ * trained to. A PCA transform (vector_preprocessor.h) orders dimensions
+ * by variance, which gives non-Matryoshka models usable prefixes too.
+ *
+ * The index wraps a flat index and is itself a faiss::Index; the flat
+ * index remains the base (saved, snapshotted and merged as usual) and
+ * the prefix array is rebuilt from it whenever the wrapper is created.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <faiss/Index.h>
+#include <faiss/IndexFlat.h>
+#include <nlohmann/json.hpp>
+
+#include "lsm_index.h"
+
+namespace neurorag {
+
+/**
+ * @brief Per-search overrides of the coarse-to-fine defaults
+ */
+struct MatryoshkaSearchParameters : faiss::SearchParameters {
+    int prefix_dimension = 0;       // first-pass dimensions; 0 keeps the index default, >= d searches exactly
+    int candidate_multiplier = 0;   // first-pass candidates per result; 0 keeps the index default
+};
+
+/**
+ * @brief Flat index searched through a compact prefix array first
+ */
+class MatryoshkaIndex : public faiss::Index, public LayeredIndex {
+public:
+    /**
+     * @brief Constructor; copies the prefixes of every vector in full
+     * @param full Flat index of full vectors; owned from now on
+     * @param prefix_dimension Dimensions kept in the prefix array
+     * @param candidate_multiplier Default first-pass candidates per result
+     */
+    MatryoshkaIndex(std::shared_ptr<faiss::IndexFlat> full, int prefix_dimension, int candidate_multiplier);
+
+    /**
+     * @brief Whether an index can be wrapped with this prefix length
+     * @param reason Why not, when it cannot
+     */
+    static bool can_wrap(const faiss::Index& index, int prefix_dimension, std::string& reason);
+
+    /**
+     * @brief Deep copy, for delta merges
+     */
+    MatryoshkaIndex* clone() const;
+
+    int prefix_dimension() const { return prefix_dimension_; }
+    int candidate_multiplier() const { return candidate_multiplier_; }
+
+    /**
+     * @brief Heap bytes of the prefix array (the flat index is not included)
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * @brief Prefix length, defaults and first-pass counters
+     */
+    nlohmann::json get_statistics() const;
+
+    std::shared_ptr<const faiss::Index> base_index() const override;
+
+    // faiss::Index
+    void add(faiss::idx_t n, const float* x) override;
+    void search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                const faiss::SearchParameters* params = nullptr) const override;
+    void reset() override;
+    size_t remove_ids(const faiss::IDSelector& sel) override;
+    void reconstruct(faiss::idx_t key, float* recons) const override;
+
+private:
+    std::shared_ptr<faiss::IndexFlat> full_;
+    int prefix_dimension_;
+    int candidate_multiplier_;
+    bool unit_prefixes_;                // inner product: prefixes normalized
+    std::vector<float> prefixes_;       // ntotal x prefix_dimension_, row-major
+
+    mutable std::atomic<uint64_t> searches_{0};
+    mutable std::atomic<uint64_t> exact_searches_{0};
+    mutable std::atomic<uint64_t> candidates_rescored_{0};
+
+    void append_prefixes(size_t n, const float* x);
+
+    // First pass and re-scoring for one query; results best first
+    void search_one(const float* query, size_t k, int prefix, size_t candidates,
+                    const faiss::IDSelector* sel, bool parallel,
+                    float* distances, faiss::idx_t* labels) const;
+};
+
+} // namespace neurorag
@@ -0,0 +1,246 @@
+/**
+ * @file memory_accountant.h
+ * @brief Per-component memory accounting against a hard process budget
+ *
+ * The accountant keeps one figure per component. Long-lived structures
+ * (index, metadata, delta segments, list and node caches, transport
+ * arenas) are sampled periodically by the engine; short-lived buffers
+ * (queued requests, insert batches) are charged and released as they
+ * come and go. Usage is the larger of the accounted total and the
+ * process's anonymous resident memory, so allocations nobody accounts
+ * for still count against the budget.
+ *
+ * Above the soft limit (90% of the budget by default) registered
+ * reclaimers shrink caches on every sample, in registration order, until
+ * usage is back under it.
+ * Inserts reserve their estimated footprint before they allocate: a
+ * reservation that does not fit first reclaims cache memory, then waits
+ * for memory to be released, and is rejected once its wait expires, so
+ * a burst of add_vectors slows down or fails instead of driving the pod
+ * into the OOM killer.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief Components memory is accounted to
+ */
+enum class MemoryComponent : int {
+    INDEX,          // serving index (codes, ids, graph, quantizer)
+    METADATA,       // per-vector metadata strings
+    DELTA,          // LSM delta segments and tombstones
+    LIST_CACHE,     // tiered IVF lists (hot tier and pool)
+    NODE_CACHE,     // DiskANN navigation data and cached nodes
+    ARENAS,         // shared-memory transport segments
+    REQUESTS,       // queued search requests
+    INSERTS,        // add_vectors batches being inserted
+    EMBEDDINGS,     // query text embedding cache
+    kCount
+};
+
+const char* memory_component_name(MemoryComponent component);
+
+class MemoryAccountant;
+
+/**
+ * @brief Memory reserved against the budget, released when destroyed
+ */
+class MemoryReservation {
+public:
+    MemoryReservation() = default;
+    ~MemoryReservation();
+    MemoryReservation(MemoryReservation&& other) noexcept;
+    MemoryReservation& operator=(MemoryReservation&& other) noexcept;
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+    size_t bytes() const { return bytes_; }
+
+    /**
+     * @brief Hand the memory over to a sampled component
+     *
+     * For allocations that outlive the reservation (vectors now in the
+     * index): the target is charged until its next sample measures them.
+     */
+    void commit(MemoryComponent target);
+
+    void release();
+
+private:
+    friend class MemoryAccountant;
+
+    MemoryAccountant* owner_ = nullptr;
+    MemoryComponent component_ = MemoryComponent::INSERTS;
+    size_t bytes_ = 0;
+};
+
+/**
+ * @brief Central memory accountant with a hard budget
+ */
+class MemoryAccountant {
+public:
+    using Sampler = std::function<void(MemoryAccountant&)>;
+    using Reclaimer = std::function<size_t(size_t bytes)>;
+
+    /**
+     * @brief Constructor
+     * @param budget_bytes Hard budget; 0 accounts without enforcing
+     * @param soft_limit Fraction of the budget above which caches shrink
+     */
+    explicit MemoryAccountant(size_t budget_bytes, double soft_limit = 0.9);
+    ~MemoryAccountant();
+
+    MemoryAccountant(const MemoryAccountant&) = delete;
+    MemoryAccountant& operator=(const MemoryAccountant&) = delete;
+
+    /**
+     * @brief Budget from the container's cgroup memory limit
+     * @param headroom Fraction of the limit kept free for allocator
+     *        overhead, thread stacks and the page cache
+     * @return 0 if no limit is set
+     */
+    static size_t detect_budget(double headroom = 0.1);
+
+    /**
+     * @brief Cap one component below the budget
+     * @param bytes 0 removes the cap
+     */
+    void set_limit(MemoryComponent component, size_t bytes);
+
+    /**
+     * @brief Record a sampled component's current size
+     */
+    void set_usage(MemoryComponent component, size_t bytes);
+
+    /**
+     * @brief Track memory that is never refused (e.g. queued requests)
+     */
+    void charge(MemoryComponent component, size_t bytes);
+    void discharge(MemoryComponent component, size_t bytes);
+
+    /**
+     * @brief Reserve memory, reclaiming cache memory if needed; never waits
+     * @return false if the reservation does not fit
+     */
+    bool try_reserve(MemoryComponent component, size_t bytes, MemoryReservation& reservation);
+
+    /**
+     * @brief Reserve memory, waiting up to wait for it to become available
+     * @return false if it still does not fit when the wait expires, or
+     *         could never fit the budget
+     */
+    bool reserve(MemoryComponent component, size_t bytes, std::chrono::milliseconds wait,
+                 MemoryReservation& reservation);
+
+    /**
+     * @brief Register a cache that can give memory back
+     * @param component Component the reclaimed memory is accounted to
+     * @param reclaimer Frees up to the requested bytes, returns bytes freed
+     */
+    void add_reclaimer(MemoryComponent component, Reclaimer reclaimer);
+
+    /**
+     * @brief Set the function that refreshes sampled components
+     */
+    void set_sampler(Sampler sampler);
+
+    /**
+     * @brief Sample (and reclaim under pressure) periodically in the background
+     */
+    void start(std::chrono::milliseconds interval);
+
+    /**
+     * @brief Stop background sampling
+     */
+    void stop();
+
+    /**
+     * @brief Refresh sampled components and process memory; shrink caches above the soft limit
+     */
+    void sample();
+
+    size_t budget() const { return budget_bytes_; }
+    size_t usage(MemoryComponent component) const;
+    size_t accounted() const;
+
+    /**
+     * @brief Larger of the accounted total and process anonymous memory
+     *        plus outstanding reservations
+     */
+    size_t used() const;
+
+    bool under_pressure() const;
+
+    /**
+     * @brief Budget, usage, per-component breakdown and reservation counters
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    static constexpr size_t kComponents = static_cast<size_t>(MemoryComponent::kCount);
+
+    struct Component {
+        std::atomic<size_t> sampled{0};
+        std::atomic<size_t> charged{0};
+        std::atomic<size_t> reserved{0};
+        std::atomic<size_t> limit{0};
+    };
+
+    struct ReclaimerEntry {
+        MemoryComponent component;
+        Reclaimer reclaim;
+    };
+
+    size_t budget_bytes_;
+    size_t soft_limit_bytes_;
+    Component components_[kComponents];
+    std::atomic<size_t> process_bytes_;
+
+    // Serializes admission decisions; charge/discharge stay lock-free
+    mutable std::mutex reserve_mutex_;
+    std::condition_variable released_;
+
+    std::mutex reclaim_mutex_;
+    std::vector<ReclaimerEntry> reclaimers_;
+    Sampler sampler_;
+
+    std::thread sampler_thread_;
+    std::mutex sampler_wait_mutex_;
+    std::condition_variable sampler_condition_;
+    bool sampling_;
+
+    std::atomic<uint64_t> reservations_granted_;
+    std::atomic<uint64_t> reservations_waited_;
+    std::atomic<uint64_t> reservations_rejected_;
+    std::atomic<uint64_t> reclaimed_bytes_;
+    std::atomic<uint64_t> reclaim_runs_;
+
+    Component& component(MemoryComponent component) { return components_[static_cast<size_t>(component)]; }
+    const Component& component(MemoryComponent component) const {
+        return components_[static_cast<size_t>(component)];
+    }
+
+    bool fits_locked(MemoryComponent component, size_t bytes) const;
+    size_t reclaim(size_t bytes);
+    void release(MemoryComponent component, size_t bytes);
+    void transfer(MemoryComponent from, MemoryComponent to, size_t bytes);
+
+    friend class MemoryReservation;
+};
+
+} // namespace neurorag
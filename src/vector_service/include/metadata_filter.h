@@ -0,0 +1,324 @@
+/**
+ * @file metadata_filter.h
+ * @brief Typed metadata filters compiled to bytecode over columnar metadata
+ *
+ * A request's filter is an expression over metadata fields:
+ *
+ *   category = "news" AND published >= "2024-01-01"
+ *   (score BETWEEN 0.5 AND 1 OR pinned = true) AND NOT lang IN ("de", "fr")
+ *   path PREFIX "docs/api/" AND author EXISTS
+ *
+ * Comparisons are =, !=, <, <=, > and >=; numbers compare numerically and
+ * strings by equality, IN-sets and prefix. An ISO-8601 date or date-time
+ * ("2024-01-01", "2024-01-01T12:00:00Z") compares in time with date
+ * strings in the metadata (and with numeric epoch seconds). Keywords are
+ * case-insensitive; nested objects are addressed as "parent.child".
+ * A comparison is false for a document without the field, so
+ * `NOT x = 1` matches documents without x and `x != 1` does not.
+ *
+ * MetadataColumns keeps the scalar fields of every document in columns:
+ * strings dictionary-encoded to 32-bit codes, numbers, booleans and dates
+ * as doubles. Compiling a filter resolves every literal once (strings to
+ * codes, prefixes and IN-lists to code sets, dates to epoch seconds) into
+ * a short postfix program, so evaluating a candidate is a few column
+ * loads and compares instead of parsing its JSON. MetadataFilter is a
+ * faiss::IDSelector, so IVF, HNSW and flat searches apply it while they
+ * traverse; evaluate() runs the program one instruction at a time over a
+ * batch of candidates.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <faiss/impl/IDSelector.h>
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief Append-mostly array readable without locks while it grows
+ *
+ * Rows live in fixed chunks allocated on first write, so an element never
+ * moves; the chunk directory doubles by publishing a copy and keeps the
+ * old ones until destruction, so a reader's directory stays valid.
+ * Writers must be serialized by the caller.
+ */
+template <typename T>
+class ChunkedColumn {
+public:
+    static constexpr int kChunkBits = 14;
+    static constexpr size_t kChunkRows = size_t{1} << kChunkBits;
+
+    struct Directory {
+        size_t capacity;
+        std::unique_ptr<std::atomic<std::atomic<T>*>[]> chunks;
+    };
+
+    explicit ChunkedColumn(T missing) : missing_(missing) {}
+    ChunkedColumn(const ChunkedColumn&) = delete;
+    ChunkedColumn& operator=(const ChunkedColumn&) = delete;
+
+    const Directory* directory() const { return directory_.load(std::memory_order_acquire); }
+
+    static T get(const Directory* directory, int64_t row, T missing) {
+        size_t chunk = static_cast<size_t>(row) >> kChunkBits;
+        if (!directory || row < 0 || chunk >= directory->capacity) {
+            return missing;
+        }
+        std::atomic<T>* values = directory->chunks[chunk].load(std::memory_order_acquire);
+        return values ? values[row & (kChunkRows - 1)].load(std::memory_order_relaxed) : missing;
+    }
+
+    T get(int64_t row) const { return get(directory(), row, missing_); }
+
+    void set(int64_t row, T value);
+
+    /**
+     * @brief Reset a row to the missing value, without allocating
+     */
+    void clear(int64_t row);
+
+    /**
+     * @brief Allocated chunk bytes
+     */
+    size_t memory_bytes() const { return allocated_.size() * kChunkRows * sizeof(T); }
+
+private:
+    T missing_;
+    std::atomic<const Directory*> directory_{nullptr};
+    std::vector<std::unique_ptr<Directory>> directories_;
+    std::vector<std::unique_ptr<std::atomic<T>[]>> allocated_;
+};
+
+/**
+ * @brief One metadata field in column form
+ */
+struct MetadataColumn {
+    static constexpr uint32_t kNoString = 0;
+
+    explicit MetadataColumn(std::string field_name)
+        : name(std::move(field_name)), codes(kNoString), numbers(std::numeric_limits<double>::quiet_NaN()) {}
+
+    std::string name;
+    ChunkedColumn<uint32_t> codes;   // String values; kNoString when absent
+    ChunkedColumn<double> numbers;   // Numbers, booleans (0/1) and dates (epoch seconds); NaN when absent
+    std::map<std::string, uint32_t> dictionary;   // Ordered, so a prefix is a key range
+    std::vector<const std::string*> strings;      // Dictionary keys by code - 1
+    size_t string_bytes = 0;
+    bool long_strings = false;       // A value exceeded kMaxStringBytes; strings are not indexed
+    bool arrays = false;             // Some documents hold arrays, which are not indexed
+};
+
+/**
+ * @brief Columnar copy of the filterable metadata fields
+ *
+ * Writers (set, under the engine's metadata_mutex_) and filter compilation
+ * take the column mutex; evaluating a compiled filter does not lock.
+ */
+class MetadataColumns {
+public:
+    static constexpr size_t kMaxFields = 64;
+    static constexpr size_t kMaxStringBytes = 256;
+
+    /**
+     * @brief Constructor
+     * @param fields Fields to index; empty indexes every scalar field, up to kMaxFields
+     */
+    explicit MetadataColumns(const std::vector<std::string>& fields = {});
+
+    /**
+     * @brief Index one document's metadata, replacing the row's previous values
+     * @param row Internal id
+     * @param metadata JSON object; anything else leaves the row empty
+     */
+    void set(int64_t row, const std::string& metadata);
+
+    /**
+     * @brief Index documents with consecutive internal ids
+     */
+    void set(int64_t first_row, const std::vector<std::string>& metadata);
+
+    /**
+     * @brief One past the highest row indexed
+     */
+    size_t rows() const { return rows_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief A field's string values for a set of rows
+     * @param field Field name
+     * @param rows Internal ids
+     * @param n Number of ids
+     * @param values Receives one value per row, empty where the row has no string value
+     * @return false if the field has no string column
+     */
+    bool string_values(const std::string& field, const int64_t* rows, size_t n,
+                       std::vector<std::string>& values) const;
+
+    /**
+     * @brief A field's numeric column (numbers, booleans, dates as epoch seconds)
+     *
+     * The column lives as long as this MetadataColumns and is read without
+     * locking; rows without a number read NaN.
+     * @return nullptr if no document has had the field
+     */
+    const ChunkedColumn<double>* numbers(const std::string& field) const;
+
+    /**
+     * @brief Column chunks and dictionaries
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * @brief Per-field dictionary sizes and memory, and filter counters
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    friend class MetadataFilter;
+
+    // Column of a field; nullptr when the field is not indexed. Call under mutex_
+    MetadataColumn* column(const std::string& field, bool create);
+    void set_locked(int64_t row, const std::string& metadata);
+    void set_value(int64_t row, const std::string& field, const nlohmann::json& value, int depth);
+
+    std::unordered_set<std::string> fields_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<MetadataColumn>> columns_;
+    std::unordered_map<std::string, MetadataColumn*> by_name_;
+    std::atomic<size_t> rows_{0};
+    mutable std::atomic<uint64_t> filters_compiled_{0};
+    mutable std::atomic<uint64_t> filters_rejected_{0};
+};
+
+/**
+ * @brief Filter instruction
+ */
+enum class FilterOp : uint8_t {
+    kTrue,
+    kFalse,
+    kNumberRange,       // low <= number <= high
+    kNumberNotEqual,    // number present and != low
+    kStringEqual,       // code == code
+    kStringNotEqual,    // code present and != code
+    kStringIn,          // code in sets_[set]
+    kExists,            // string or number present
+    kAnd,
+    kOr,
+    kNot,
+};
+
+struct FilterInstruction {
+    FilterOp op;
+    const MetadataColumn* column = nullptr;
+    uint32_t code = 0;
+    uint32_t set = 0;
+    double low = 0.0;
+    double high = 0.0;
+};
+
+/**
+ * @brief A compiled filter expression
+ *
+ * Keeps the columns it was compiled against alive, so it stays valid
+ * across a metadata rebuild; documents indexed after compilation are
+ * seen, strings first seen after it never match its literals.
+ */
+class MetadataFilter : public faiss::IDSelector {
+public:
+    static constexpr size_t kMaxDepth = 64;
+    static constexpr size_t kBatchSize = 256;
+
+    /**
+     * @brief Compile an expression and equality filters into one program
+     * @param expression Filter expression, or empty
+     * @param equalities field -> value filters ANDed with the expression; a
+     *        value matches the field's string, or its number or boolean
+     * @param columns Columns to evaluate against
+     * @param error Syntax or field error, with the offset in the expression
+     * @return nullptr if the filter does not compile
+     */
+    static std::unique_ptr<MetadataFilter> compile(const std::string& expression,
+                                                   const std::unordered_map<std::string, std::string>& equalities,
+                                                   std::shared_ptr<const MetadataColumns> columns,
+                                                   std::string& error);
+
+    /**
+     * @brief Whether one document passes
+     */
+    bool is_member(faiss::idx_t id) const override;
+
+    /**
+     * @brief Evaluate a batch of candidates
+     * @param ids Internal ids
+     * @param n Number of ids
+     * @param keep Receives 1 for each id that passes, else 0
+     * @return Ids that pass
+     */
+    size_t evaluate(const int64_t* ids, size_t n, uint8_t* keep) const;
+
+    /**
+     * @brief Evaluate consecutive ids into a bitmap
+     * @param first First id
+     * @param count Number of ids
+     * @param bitmap Receives bit (id - first) per id that passes; (count + 63) / 64 words
+     * @return Ids that pass
+     */
+    size_t evaluate_range(int64_t first, size_t count, uint64_t* bitmap) const;
+
+    /**
+     * @brief The strings a field must equal for a document to pass
+     *
+     * Set when a top-level conjunct is an equality or IN-list of strings
+     * on the field (the basis for routing to per-value partitions).
+     * @param field Field name
+     * @param values Receives the strings; empty when no document can pass
+     * @param exact Receives whether that conjunct is the whole filter
+     * @return false if the filter does not restrict the field to a set of strings
+     */
+    bool required_strings(const std::string& field, std::vector<std::string>& values, bool& exact) const;
+
+    /**
+     * @brief Whether the program is constant (e.g. a string literal no document has)
+     * @param value Receives the constant
+     */
+    bool is_constant(bool& value) const;
+
+    size_t size() const { return program_.size(); }
+
+    /**
+     * @brief The program, one instruction per line, for /admin/metadata/filter
+     */
+    nlohmann::json describe() const;
+
+private:
+    MetadataFilter() = default;
+
+    // Runs the program over up to kBatchSize ids; the result is in stack[0, n)
+    void evaluate_batch(const int64_t* ids, size_t n, uint8_t* stack) const;
+
+    std::shared_ptr<const MetadataColumns> columns_;
+    std::vector<FilterInstruction> program_;
+    std::vector<std::vector<uint64_t>> sets_;   // Code bitmaps of IN and PREFIX
+    size_t depth_ = 0;
+};
+
+/**
+ * @brief Parse an ISO-8601 date or date-time
+ * @param text "YYYY-MM-DD", optionally followed by "THH:MM[:SS[.fff]]" and "Z" or "+HH:MM"
+ * @param seconds Receives seconds since the Unix epoch (UTC when no offset is given)
+ * @return false if text is not a date
+ */
+bool parse_iso8601(const std::string& text, double& seconds);
+
+} // namespace neurorag
@@ -0,0 +1,127 @@
+/**
+ * @file micro_batcher.h
+ * @brief Request micro-batching in front of VectorSearchEngine::batch_search
+ *
+ * Individual search requests arriving from many connections are coalesced
+ * into batches of up to max_batch_size (or whatever has arrived within
+ * max_wait) and executed with a single batch_search call. Completions are
+ * delivered through per-request callbacks, so callers see results out of
+ * order as batches finish.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+#include <nlohmann/json.hpp>
+#include "vector_search.h"
+
+namespace neurorag {
+
+/**
+ * @brief Micro-batcher feeding VectorSearchEngine::batch_search
+ */
+class MicroBatcher {
+public:
+    /**
+     * @brief Completion callback
+     *
+     * Invoked exactly once per submitted request, on a batcher thread.
+     * error is empty on success.
+     */
+    using Completion = std::function<void(const SearchResult& result, const std::string& error)>;
+
+    /**
+     * @brief Constructor
+     * @param engine Search engine (not owned, must outlive the batcher)
+     * @param max_batch_size Upper bound on requests per batch_search call
+     * @param max_wait Longest time the first request of a batch may wait
+     * @param num_dispatchers Number of batches that may execute concurrently
+     */
+    MicroBatcher(VectorSearchEngine* engine,
+                 size_t max_batch_size,
+                 std::chrono::microseconds max_wait,
+                 int num_dispatchers = 1);
+
+    /**
+     * @brief Destructor, fails pending requests and joins dispatchers
+     */
+    ~MicroBatcher();
+
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    /**
+     * @brief Start dispatcher threads
+     */
+    void start();
+
+    /**
+     * @brief Stop dispatcher threads; pending requests complete with an error
+     */
+    void stop();
+
+    /**
+     * @brief Queue a request for the next batch
+     * @param request Search request (moved into the queue)
+     * @param done Completion callback
+     * @return false if the batcher is stopped (done is not invoked)
+     */
+    bool submit(SearchRequest request, Completion done);
+
+    /**
+     * @brief Number of queued, not yet dispatched requests
+     */
+    size_t queue_depth() const;
+
+    /**
+     * @brief Charge queued requests to MemoryComponent::REQUESTS
+     * @param accountant Accountant owned by the caller, or nullptr to stop charging
+     */
+    void set_memory_accountant(MemoryAccountant* accountant);
+
+    /**
+     * @brief Batching statistics
+     * @return JSON object with batch counts and average batch size
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    struct Pending {
+        SearchRequest request;
+        Completion done;
+        std::chrono::steady_clock::time_point enqueued_at;
+        size_t charged_bytes;
+    };
+
+    VectorSearchEngine* engine_;
+    size_t max_batch_size_;
+    std::chrono::microseconds max_wait_;
+    int num_dispatchers_;
+
+    std::deque<Pending> queue_;
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_condition_;
+    std::atomic<bool> running_;
+    std::vector<std::thread> dispatchers_;
+
+    std::atomic<uint64_t> batches_dispatched_;
+    std::atomic<uint64_t> requests_dispatched_;
+    std::atomic<uint64_t> full_batches_;
+
+    std::atomic<MemoryAccountant*> memory_accountant_{nullptr};
+    void discharge(size_t bytes);
+
+    void dispatcher_loop();
+    void execute_batch(std::vector<Pending>& batch);
+};
+
+} // namespace neurorag
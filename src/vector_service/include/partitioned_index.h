@@ -0,0 +1,138 @@
+/**
+ * @file partitioned_index.h
+ * @brief Per-value sub-indexes for a high-cardinality filter field
+ *
+ * Most filtered searches restrict one field (a tenant, a department) to a
+ * single value or a few. Searching the global index with such a filter
+ * either walks mostly non-matching documents or scans the matching ones
+ * through a selector. PartitionedIndex keeps a small sub-index per value
+ * of the designated field instead: a flat index while the partition is
+ * small, rebuilt as HNSW once it outgrows hnsw_threshold.
+ *
+ * A filter that requires the field to equal one string searches that
+ * partition alone, with no selector when the equality is the whole
+ * filter; an IN-list fans out over its partitions and merges their top-k.
+ * Other filters, and unfiltered searches, go to the global index, which
+ * is unchanged. Partitions hold their own copy of their vectors (in
+ * index space, after preprocessing) and map local ids to internal ids.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <faiss/Index.h>
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+class MetadataFilter;
+
+/**
+ * @brief One value's sub-index
+ */
+struct IndexPartition {
+    std::string value;
+    std::unique_ptr<faiss::Index> index;   // IndexFlat, or IndexHNSWFlat above the threshold
+    std::vector<faiss::idx_t> rows;        // Local id -> internal id, -1 once removed from an HNSW partition
+    size_t removed = 0;                    // Tombstoned local ids, compacted past a quarter of rows
+};
+
+/**
+ * @brief Sub-indexes per value of one metadata field
+ *
+ * Searches take a shared lock, add and remove an exclusive one.
+ */
+class PartitionedIndex {
+public:
+    /**
+     * @brief Constructor
+     * @param field Metadata field partitioned on (string values)
+     * @param d Vector dimension
+     * @param metric METRIC_L2 or METRIC_INNER_PRODUCT
+     * @param hnsw_threshold Partitions above this many vectors are HNSW, smaller ones flat
+     */
+    PartitionedIndex(std::string field, int d, faiss::MetricType metric, size_t hnsw_threshold);
+
+    const std::string& field() const { return field_; }
+
+    /**
+     * @brief Add vectors to the partitions of their values
+     * @param rows Internal ids
+     * @param n Number of vectors
+     * @param x n x d index-space vectors
+     * @param values Partition value per vector; empty values are not partitioned
+     */
+    void add(const faiss::idx_t* rows, size_t n, const float* x, const std::vector<std::string>& values);
+
+    /**
+     * @brief Drop internal ids from their partitions
+     * @return Vectors removed
+     */
+    size_t remove(const std::vector<faiss::idx_t>& rows);
+
+    /**
+     * @brief Search the partitions a filter restricts the field to
+     * @param n Number of queries
+     * @param x n x d index-space queries
+     * @param k Results per query
+     * @param filter Compiled filter; applied inside the partitions unless it is only the field's restriction
+     * @param ef_search efSearch of HNSW partitions; 0 keeps their default
+     * @param distances n x k, best first as the global index returns them
+     * @param labels n x k internal ids, -1 where fewer than k documents pass
+     * @return false if the filter does not restrict the field; search the global index
+     */
+    bool search(faiss::idx_t n, const float* x, faiss::idx_t k, const MetadataFilter& filter, int ef_search,
+                float* distances, faiss::idx_t* labels) const;
+
+    size_t partition_count() const;
+
+    /**
+     * @brief Vectors, graphs and id maps of all partitions
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * @brief Partition counts and sizes, routing counters
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    static constexpr uint32_t kNoPartition = UINT32_MAX;
+
+    std::string field_;
+    int d_;
+    faiss::MetricType metric_;
+    size_t hnsw_threshold_;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<std::unique_ptr<IndexPartition>> partitions_;
+    std::unordered_map<std::string, uint32_t> by_value_;
+    std::vector<uint32_t> row_partition_;   // Internal id -> partition, kNoPartition if none
+    size_t vectors_ = 0;
+
+    mutable std::atomic<uint64_t> routed_searches_{0};
+    mutable std::atomic<uint64_t> filtered_searches_{0};
+    mutable std::atomic<uint64_t> partitions_searched_{0};
+    mutable std::atomic<uint64_t> unrouted_searches_{0};
+    std::atomic<uint64_t> hnsw_conversions_{0};
+    std::atomic<uint64_t> compactions_{0};
+
+    // Index of the partition's kind for count vectors
+    std::unique_ptr<faiss::Index> make_index(size_t count) const;
+
+    // Appends to a partition, converting it to HNSW when it outgrows the threshold
+    void append(IndexPartition& partition, size_t n, const float* x, const faiss::idx_t* rows);
+
+    // remove() under the exclusive lock; ids in no partition are skipped
+    size_t remove_locked(const faiss::idx_t* rows, size_t n);
+};
+
+} // namespace neurorag
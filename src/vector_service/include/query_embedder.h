@@ -0,0 +1,124 @@
+/**
+ * @file query_embedder.h
+ * @brief Cached, batched embedding of query text for /search_text
+ *
+ * Each text is looked up in the EmbeddingCache first; only misses reach
+ * the EmbeddingBackend. Misses from concurrent requests are coalesced
+ * into batches of up to max_batch_size (or whatever has arrived within
+ * max_wait), and a text repeated within a batch is embedded once.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "embedding_backend.h"
+#include "embedding_cache.h"
+
+namespace neurorag {
+
+/**
+ * @brief Text -> embedding through a cache and a batching backend caller
+ */
+class QueryEmbedder {
+public:
+    /**
+     * @brief Constructor
+     * @param backend Embedding model
+     * @param cache Embedding cache of the backend's dimension, or nullptr for none
+     * @param max_batch_size Upper bound on texts per backend call (capped by the backend's)
+     * @param max_wait Longest time the first text of a batch may wait
+     */
+    QueryEmbedder(std::unique_ptr<EmbeddingBackend> backend,
+                  std::unique_ptr<EmbeddingCache> cache,
+                  size_t max_batch_size,
+                  std::chrono::microseconds max_wait);
+
+    /**
+     * @brief Destructor, fails pending texts and joins the dispatcher
+     */
+    ~QueryEmbedder();
+
+    QueryEmbedder(const QueryEmbedder&) = delete;
+    QueryEmbedder& operator=(const QueryEmbedder&) = delete;
+
+    /**
+     * @brief Start the dispatcher thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the dispatcher; pending texts fail
+     */
+    void stop();
+
+    /**
+     * @brief Embed texts, blocking until every one is available
+     * @param texts Query texts
+     * @param embeddings Receives texts.size() x dimension() floats, row-major
+     * @param error Set on failure
+     * @return false if any text could not be embedded
+     */
+    bool embed(const std::vector<std::string>& texts, std::vector<float>& embeddings, std::string& error);
+
+    int dimension() const { return dimension_; }
+
+    /**
+     * @brief Cache, batching and backend statistics
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    // Completion shared by the texts of one embed call
+    struct Waiter {
+        std::mutex mutex;
+        std::condition_variable condition;
+        size_t remaining;
+        std::string error;
+    };
+
+    // A cache miss; text and output belong to the blocked caller
+    struct Pending {
+        uint64_t key;
+        const std::string* text;
+        float* output;
+        std::shared_ptr<Waiter> waiter;
+        std::chrono::steady_clock::time_point enqueued_at;
+    };
+
+    std::unique_ptr<EmbeddingBackend> backend_;
+    std::unique_ptr<EmbeddingCache> cache_;
+    int dimension_;
+    size_t max_batch_size_;
+    std::chrono::microseconds max_wait_;
+
+    std::deque<Pending> queue_;
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_condition_;
+    std::atomic<bool> running_{false};
+    std::thread dispatcher_;
+
+    std::atomic<uint64_t> texts_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> batched_texts_{0};
+    std::atomic<uint64_t> duplicates_{0};
+    std::atomic<uint64_t> failed_batches_{0};
+    std::atomic<uint64_t> backend_micros_{0};
+
+    void dispatcher_loop();
+    void execute_batch(std::vector<Pending>& batch);
+    static void complete(Pending& pending, const std::string& error);
+};
+
+} // namespace neurorag
@@ -0,0 +1,146 @@
+/**
+ * @file query_log.h
+ * @brief Sampled, anonymized query log used to warm up from real traffic
+ *
+ * QueryRecorder keeps approximate frequencies of recently seen query
+ * vectors. Only the fp16-quantized vector, k and threshold are kept: no
+ * request ids, filters, timestamps or client information. Queries seen
+ * fewer than min_count times are never written to disk, so one-off
+ * queries cannot be recovered from the file.
+ *
+ * File layout: QueryLogHeader, then entries sorted by descending count
+ * (u32 count, u16 k, u16 reserved, f32 threshold, dimension x fp16), then
+ * a CRC32C of everything before it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief A recorded query and how often it was seen
+ */
+struct RecordedQuery {
+    std::vector<float> vector;
+    int k;
+    float threshold;
+    uint32_t count;
+};
+
+#pragma pack(push, 1)
+struct QueryLogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t dimension;
+    uint32_t num_entries;
+    uint64_t total_recorded;
+};
+#pragma pack(pop)
+
+/**
+ * @brief Thread-safe sampled frequency log of query vectors
+ */
+class QueryRecorder {
+public:
+    static constexpr uint32_t kMagic = 0x4C51524E; // "NRQL"
+    static constexpr uint16_t kVersion = 1;
+
+    /**
+     * @brief Constructor
+     * @param dimension Query vector dimension
+     * @param sample_rate Fraction of queries recorded (0 disables recording)
+     * @param capacity Maximum number of distinct queries tracked
+     * @param min_count Minimum count for a query to be persisted
+     */
+    QueryRecorder(int dimension, double sample_rate, size_t capacity, uint32_t min_count);
+    ~QueryRecorder();
+
+    /**
+     * @brief Record a query, subject to sampling
+     */
+    void record(const float* vector, size_t dimension, int k, float threshold);
+
+    /**
+     * @brief Most frequent queries, most frequent first
+     * @param n Maximum number of queries to return
+     */
+    std::vector<RecordedQuery> top_queries(size_t n) const;
+
+    /**
+     * @brief Persist queries seen at least min_count times
+     *
+     * Writes to a temporary file and renames it into place.
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * @brief Merge a previously saved log into the in-memory counts
+     * @return false if the file is missing, corrupt or of another dimension
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief Save to path every interval until stop() is called
+     */
+    void start_periodic_flush(const std::string& path, std::chrono::seconds interval);
+
+    /**
+     * @brief Stop periodic flushing and write a final snapshot
+     */
+    void stop();
+
+    /**
+     * @brief Recorder statistics
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    struct Entry {
+        std::vector<uint16_t> vector;
+        int k;
+        float threshold;
+        uint32_t count;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+    };
+
+    static constexpr size_t kNumShards = 16;
+
+    int dimension_;
+    double sample_rate_;
+    size_t shard_capacity_;
+    uint32_t min_count_;
+    Shard shards_[kNumShards];
+
+    std::atomic<uint64_t> seen_;
+    std::atomic<uint64_t> recorded_;
+    std::atomic<uint64_t> decays_;
+
+    std::string flush_path_;
+    std::thread flush_thread_;
+    std::mutex flush_mutex_;
+    std::condition_variable flush_condition_;
+    bool flush_running_;
+
+    void insert(uint64_t key, Entry entry);
+    static uint64_t hash_entry(const std::vector<uint16_t>& vector, int k, float threshold);
+};
+
+} // namespace neurorag
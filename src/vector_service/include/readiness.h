@@ -0,0 +1,161 @@
+/**
+ * @file readiness.h
+ * @brief Startup readiness gating: page residency and latency probes
+ *
+ * Liveness (/health) only says the process works. Readiness (/ready) is
+ * withheld until the index pages are resident and searches meet the
+ * latency SLO, so a freshly rolled-out pod does not take traffic while
+ * it is still page-faulting its index in.
+ *
+ * Startup runs through the phases below. Once PROBING, a background
+ * thread periodically times a round of probe searches; the pod is ready
+ * while the round's p99 is within the SLO and drops out of rotation after
+ * failure_threshold consecutive slow rounds.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+#include <nlohmann/json.hpp>
+
+namespace faiss {
+struct Index;
+}
+
+namespace neurorag {
+
+class VectorSearchEngine;
+
+/**
+ * @brief A range of index memory to make resident
+ */
+struct MemoryRegion {
+    const void* data;
+    size_t size;
+};
+
+/**
+ * @brief Memory backing an index: codes, ids, graph and quantizer data
+ *
+ * Only the hot tier of tiered IVF lists and the navigation data of a
+ * DiskANN index are included. Pointers are valid while the index is.
+ */
+std::vector<MemoryRegion> index_memory_regions(const faiss::Index* index);
+
+/**
+ * @brief Tracks startup progress and decides readiness
+ */
+class ReadinessGate {
+public:
+    enum class Phase { STARTING, LOADING_PAGES, WARMING_UP, PROBING, SHUTTING_DOWN };
+
+    /**
+     * @brief Constructor
+     * @param latency_slo_ms p99 search latency a ready pod must meet
+     * @param failure_threshold Consecutive slow probe rounds before un-readying
+     */
+    ReadinessGate(double latency_slo_ms, int failure_threshold);
+    ~ReadinessGate();
+
+    ReadinessGate(const ReadinessGate&) = delete;
+    ReadinessGate& operator=(const ReadinessGate&) = delete;
+
+    void set_phase(Phase phase);
+    Phase phase() const { return phase_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Make the given regions resident
+     *
+     * Regions are merged into page ranges and split into chunks that
+     * num_threads workers advise (MADV_WILLNEED), populate
+     * (MADV_POPULATE_READ, falling back to touching each page) and,
+     * if lock_memory is set, mlock.
+     * @return false if locking was requested but failed (pages are still faulted in)
+     */
+    bool prefault(const std::vector<MemoryRegion>& regions, int num_threads, bool lock_memory);
+
+    /**
+     * @brief Fraction of the prefaulted pages currently resident (mincore)
+     *
+     * Recomputed at most once per second.
+     */
+    double resident_fraction() const;
+
+    /**
+     * @brief Start periodic latency probes
+     * @param engine Engine to probe (not owned)
+     * @param probe_queries Representative queries; jittered per round so
+     *        they miss the result cache
+     * @param k Results per probe search
+     * @param interval Time between probe rounds
+     */
+    void start_latency_probes(VectorSearchEngine* engine,
+                              std::vector<std::vector<float>> probe_queries,
+                              int k,
+                              std::chrono::milliseconds interval);
+
+    /**
+     * @brief Stop probing and report not ready
+     */
+    void stop();
+
+    /**
+     * @brief Record the outcome of the engine health check
+     */
+    void set_engine_healthy(bool healthy) { engine_healthy_.store(healthy); }
+
+    /**
+     * @brief Whether the pod should receive traffic
+     */
+    bool is_ready() const;
+
+    /**
+     * @brief Phase, progress, probe latency and the reason for not being ready
+     */
+    nlohmann::json get_status() const;
+
+private:
+    struct PageRange {
+        uintptr_t begin;
+        uintptr_t end;
+    };
+
+    double latency_slo_ms_;
+    int failure_threshold_;
+
+    std::atomic<Phase> phase_;
+    std::atomic<bool> engine_healthy_;
+    std::atomic<bool> probes_passing_;
+    std::atomic<int> consecutive_failures_;
+    std::atomic<uint64_t> probe_rounds_;
+    std::atomic<double> last_probe_p99_ms_;
+
+    std::vector<PageRange> ranges_;
+    std::atomic<uint64_t> bytes_total_;
+    std::atomic<uint64_t> bytes_prefaulted_;
+    std::atomic<bool> memory_locked_;
+
+    mutable std::mutex residency_mutex_;
+    mutable std::chrono::steady_clock::time_point residency_checked_at_;
+    mutable double resident_fraction_;
+
+    std::thread probe_thread_;
+    std::mutex probe_mutex_;
+    std::condition_variable probe_condition_;
+    bool probing_;
+
+    void run_probe_round(VectorSearchEngine* engine,
+                         const std::vector<std::vector<float>>& probe_queries,
+                         int k, uint64_t round);
+};
+
+} // namespace neurorag
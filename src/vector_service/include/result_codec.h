@@ -0,0 +1,96 @@
+/**
+ * @file result_codec.h
+ * @brief Compact binary encoding of cached SearchResults
+ *
+ * Layout (little endian):
+ *
+ *   u16 magic | u8 version | u8 flags | varint count
+ *   ids      : zigzag varint deltas from the previous id
+ *   scores   : count x fp16 or fp32
+ *   [dependency] varint epoch, varint global version, varint delta version, varint n,
+ *                n x (zigzag varint list delta, varint list version)
+ *   [metadata]   count x (varint length, bytes), only when not referenced
+ *   u32 CRC32C of everything above
+ *
+ * Metadata is normally not copied: it is stored by reference (the result
+ * ids) and rehydrated from the engine's local metadata store on decode.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <functional>
+
+#include "index_version.h"
+
+namespace neurorag {
+
+struct SearchResult;
+
+namespace result_codec {
+
+constexpr uint16_t kMagic = 0x524E; // "NR"
+constexpr uint8_t kVersion = 2;  // 2: dependency carries the delta version
+
+enum Flags : uint8_t {
+    kScoresFp16 = 1u << 0,
+    kHasDependency = 1u << 1,
+    kMetadataReferenced = 1u << 2,
+    kMetadataInline = 1u << 3,
+};
+
+/**
+ * @brief How metadata is written into an encoded result
+ */
+enum class MetadataMode {
+    NONE,        // drop metadata
+    REFERENCE,   // rehydrate from the local metadata store by id
+    INLINE,      // copy the strings (for results whose ids are not in the store)
+};
+
+/**
+ * @brief Resolves a result id to its metadata string
+ * @return false if the id is unknown
+ */
+using MetadataResolver = std::function<bool(int64_t id, std::string& metadata)>;
+
+/**
+ * @brief Encode a search result
+ * @param result Result to encode (latency and from_cache are not stored)
+ * @param dependency Index versions to store with it, or nullptr
+ * @param fp16_scores Store scores as fp16; falls back to fp32 when a
+ *        score is outside the fp16 range
+ * @param metadata_mode How to store result.metadata
+ * @return Encoded bytes
+ */
+std::string encode(const SearchResult& result,
+                   const CacheDependency* dependency,
+                   bool fp16_scores,
+                   MetadataMode metadata_mode);
+
+/**
+ * @brief Decode a result produced by encode()
+ * @param data Encoded bytes
+ * @param size Number of bytes
+ * @param result Output; from_cache is set and latency_ms cleared
+ * @param dependency Output dependency (epoch 0 if none was stored), or nullptr
+ * @param resolver Metadata lookup for referenced metadata; may be empty
+ * @return false on a bad header, unknown version, checksum mismatch,
+ *         truncation, or a referenced id the resolver does not know
+ */
+bool decode(const void* data, size_t size,
+            SearchResult& result,
+            CacheDependency* dependency,
+            const MetadataResolver& resolver);
+
+/**
+ * @brief Convert between fp32 and IEEE fp16 (round to nearest even)
+ */
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t value);
+
+} // namespace result_codec
+
+} // namespace neurorag
@@ -0,0 +1,289 @@
+/**
+ * @file shm_transport.h
+ * @brief Shared-memory request/response transport for co-located clients
+ *
+ * The server creates a POSIX shared memory segment holding a fixed number
+ * of channels. A client claims one channel and owns both of its rings:
+ * it writes query vectors directly into request slots and reads result
+ * ids and scores directly out of response slots, with no socket and no
+ * serialization. Each ring is single-producer/single-consumer; wakeups
+ * use process-shared futexes on sequence words inside the segment.
+ *
+ * Clients keep their channel with a lease: a heartbeat thread stamps the
+ * channel every kHeartbeatIntervalMs with CLOCK_MONOTONIC, which is shared
+ * by all containers on the node. PIDs are not: a sidecar's PID is not
+ * visible in the server's PID namespace, or names an unrelated process,
+ * so liveness is never judged by PID. The server reclaims a channel whose
+ * lease is older than kLeaseTimeoutMs.
+ *
+ * Segment layout:
+ *   ShmSegmentHeader | channel[0] | channel[1] | ...
+ *   channel = ShmChannelControl | request slots | response slots
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+class MicroBatcher;
+
+namespace shm {
+
+constexpr uint32_t kSegmentMagic = 0x4d48534e;  // "NSHM"
+constexpr uint32_t kSegmentVersion = 2;
+constexpr size_t kCacheLine = 64;
+constexpr int64_t kHeartbeatIntervalMs = 1000;
+constexpr int64_t kLeaseTimeoutMs = 10000;        // ten missed heartbeats
+
+enum class ResponseStatus : uint32_t {
+    OK = 0,
+    ERROR = 1,
+};
+
+struct alignas(kCacheLine) ShmSegmentHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t max_k;
+    uint32_t num_channels;
+    uint32_t ring_slots;
+    uint64_t channel_stride;
+    uint64_t request_slot_size;
+    uint64_t response_slot_size;
+    int32_t server_pid;
+    alignas(kCacheLine) std::atomic<uint32_t> doorbell;        // bumped by clients, futex for the server
+    std::atomic<uint32_t> server_waiting;                      // non-zero while the server sleeps
+    std::atomic<uint32_t> server_running;
+};
+
+struct alignas(kCacheLine) ShmRing {
+    alignas(kCacheLine) std::atomic<uint64_t> head;   // next slot the producer writes
+    alignas(kCacheLine) std::atomic<uint64_t> tail;   // next slot the consumer reads
+    alignas(kCacheLine) std::atomic<uint32_t> seq;    // futex word bumped on publish
+    std::atomic<uint32_t> waiters;                    // consumers sleeping on seq
+};
+
+constexpr int32_t kChannelFree = 0;
+constexpr int32_t kChannelDetached = -1;              // client left, server resets once drained
+
+struct alignas(kCacheLine) ShmChannelControl {
+    std::atomic<int32_t> owner_pid;                   // client pid, kChannelFree or kChannelDetached
+    std::atomic<uint32_t> generation;                 // bumped on every reset; a stale client stops using it
+    std::atomic<int64_t> lease_ms;                    // client's last heartbeat, monotonic_ms()
+    ShmRing requests;
+    ShmRing responses;
+};
+
+struct ShmRequestSlot {
+    uint64_t request_id;
+    int32_t k;
+    float threshold;
+    // float query[dimension] follows
+};
+
+struct ShmResponseSlot {
+    uint64_t request_id;
+    uint32_t status;
+    uint32_t count;
+    double latency_ms;
+    // int64_t ids[max_k], float scores[max_k] follow; an ERROR status
+    // carries a NUL-terminated message in the ids area instead
+};
+
+/**
+ * @brief Read-only view of a response slot, valid until release_response()
+ */
+struct ResponseView {
+    uint64_t request_id;
+    ResponseStatus status;
+    uint32_t count;
+    double latency_ms;
+    const int64_t* ids;
+    const float* scores;
+    const char* error;
+};
+
+// Layout and wakeup helpers shared by the server and client
+size_t align_up(size_t value, size_t alignment);
+size_t request_slot_size(int dimension);
+size_t response_slot_size(int max_k);
+void futex_wait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeout_us);
+void futex_wake_all(std::atomic<uint32_t>* word);
+void publish(ShmRing& ring, uint64_t new_head);
+int64_t monotonic_ms();
+
+} // namespace shm
+
+/**
+ * @brief Shared-memory transport server, executing queries via MicroBatcher
+ */
+class ShmTransportServer {
+public:
+    /**
+     * @brief Constructor
+     * @param name POSIX shm object name, e.g. "/neurorag_vector_service"
+     * @param batcher Micro-batcher that executes queries (not owned)
+     * @param dimension Query vector dimension
+     * @param max_k Largest k a client may request
+     * @param num_channels Number of concurrently attached clients
+     * @param ring_slots Slots per ring (power of two), bounds in-flight per client
+     */
+    ShmTransportServer(const std::string& name, MicroBatcher* batcher,
+                       int dimension, int max_k = 100,
+                       int num_channels = 16, int ring_slots = 256);
+
+    ~ShmTransportServer();
+
+    ShmTransportServer(const ShmTransportServer&) = delete;
+    ShmTransportServer& operator=(const ShmTransportServer&) = delete;
+
+    /**
+     * @brief Create the segment and start the polling thread
+     * @return true on success, false otherwise
+     */
+    bool start();
+
+    /**
+     * @brief Stop polling and unlink the segment
+     */
+    void stop();
+
+    /**
+     * @brief Transport statistics
+     */
+    nlohmann::json get_statistics() const;
+
+    /**
+     * @brief Size of the mapped segment, 0 before start()
+     */
+    size_t segment_size() const { return base_ ? segment_size_ : 0; }
+
+private:
+    std::string name_;
+    MicroBatcher* batcher_;
+    int dimension_;
+    int max_k_;
+    int num_channels_;
+    int ring_slots_;
+
+    int shm_fd_;
+    void* base_;
+    size_t segment_size_;
+    shm::ShmSegmentHeader* header_;
+
+    // Completions arrive on batcher threads; serialize them per channel so
+    // each response ring keeps a single producer
+    std::unique_ptr<std::mutex[]> response_mutexes_;
+    std::unique_ptr<std::atomic<uint32_t>[]> channel_in_flight_;
+
+    std::atomic<bool> running_;
+    std::thread poll_thread_;
+
+    std::atomic<uint64_t> requests_received_;
+    std::atomic<uint64_t> responses_sent_;
+    std::atomic<uint64_t> channels_reclaimed_;
+
+    shm::ShmChannelControl* channel(int index) const;
+    uint8_t* request_slot(int index, uint64_t position) const;
+    uint8_t* response_slot(int index, uint64_t position) const;
+
+    void poll_loop();
+    bool drain_channel(int index);
+    void reclaim_channels();
+    void reset_channel(int index);
+    void publish_response(int index, uint64_t request_id, shm::ResponseStatus status,
+                          const std::vector<int64_t>& ids, const std::vector<float>& scores,
+                          double latency_ms, const std::string& error);
+};
+
+/**
+ * @brief Shared-memory transport client
+ *
+ * Not thread-safe: one client object per thread. Typical use:
+ *   float* q = client.begin_request();  fill q[0..dimension)
+ *   uint64_t id = client.commit_request(k, threshold);
+ *   client.wait_response(view);  ...  client.release_response();
+ */
+class ShmTransportClient {
+public:
+    ShmTransportClient();
+    ~ShmTransportClient();
+
+    ShmTransportClient(const ShmTransportClient&) = delete;
+    ShmTransportClient& operator=(const ShmTransportClient&) = delete;
+
+    /**
+     * @brief Map the segment and claim a free channel
+     * @return true if attached, false otherwise
+     */
+    bool attach(const std::string& name);
+
+    /**
+     * @brief Release the channel and unmap the segment
+     */
+    void detach();
+
+    /**
+     * @brief Pointer to the next request slot's query vector
+     * @return nullptr if the ring is full (too many requests in flight) or the channel was reclaimed
+     */
+    float* begin_request();
+
+    /**
+     * @brief Publish the slot returned by begin_request()
+     * @return request_id assigned to the query
+     */
+    uint64_t commit_request(int k, float threshold);
+
+    /**
+     * @brief Wait for the next response
+     * @param view Filled with pointers into the response slot
+     * @param timeout_us Maximum wait, negative waits forever
+     * @return true if a response is available, false on timeout, detach or reclaim
+     */
+    bool wait_response(shm::ResponseView& view, int64_t timeout_us = -1);
+
+    /**
+     * @brief Hand the slot returned by wait_response() back to the server
+     */
+    void release_response();
+
+    int dimension() const { return header_ ? static_cast<int>(header_->dimension) : 0; }
+    int max_k() const { return header_ ? static_cast<int>(header_->max_k) : 0; }
+    uint32_t ring_slots() const { return header_ ? header_->ring_slots : 0; }
+
+private:
+    void* base_;
+    size_t segment_size_;
+    shm::ShmSegmentHeader* header_;
+    shm::ShmChannelControl* channel_;
+    uint8_t* request_base_;
+    uint8_t* response_base_;
+    uint64_t next_request_id_;
+    uint64_t pending_request_position_;
+    uint32_t generation_;
+
+    // Renews the channel lease while attached, however long the client idles
+    std::thread heartbeat_thread_;
+    std::mutex heartbeat_mutex_;
+    std::condition_variable heartbeat_cv_;
+    bool heartbeat_stop_;
+
+    // False once the server reclaimed the channel (the lease lapsed)
+    bool owns_channel() const;
+    void heartbeat_loop();
+};
+
+} // namespace neurorag
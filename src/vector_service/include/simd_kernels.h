@@ -0,0 +1,100 @@
+/**
+ * @file simd_kernels.h
+ * @brief Vectorized float kernels shared by preprocessing and re-scoring
+ *
+ * AVX2/FMA when the build targets it (-march=native, USE_AVX2/USE_FMA),
+ * plain loops the compiler can auto-vectorize otherwise. Inputs need no
+ * particular alignment and any length is handled.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace neurorag {
+namespace simd {
+
+/**
+ * @brief Inner product of two vectors
+ */
+float dot(const float* a, const float* b, size_t d);
+
+/**
+ * @brief Squared L2 distance between two vectors
+ */
+float l2_sqr(const float* a, const float* b, size_t d);
+
+/**
+ * @brief Squared L2 norm of a vector
+ */
+float norm_sqr(const float* x, size_t d);
+
+/**
+ * @brief x *= factor
+ */
+void scale(float* x, float factor, size_t d);
+
+/**
+ * @brief y = factor * x - offset, offset optional
+ */
+void scale_sub(const float* x, float factor, const float* offset, float* y, size_t d);
+
+/**
+ * @brief y = factor * (M x) - offset, for a row-major rows x cols matrix
+ *
+ * Four rows are accumulated per pass so each load of x feeds four FMAs.
+ * @param offset Subtracted from the result (rows), or nullptr
+ */
+void gemv(const float* matrix, size_t rows, size_t cols, const float* x,
+          float factor, const float* offset, float* y);
+
+/**
+ * @brief Inner products of one query with n contiguous vectors of dimension d
+ * @param out Receives n products
+ */
+void dot_many(const float* query, const float* vectors, size_t n, size_t d, float* out);
+
+/**
+ * @brief Squared L2 distances of one query to n contiguous vectors of dimension d
+ * @param out Receives n distances
+ */
+void l2_sqr_many(const float* query, const float* vectors, size_t n, size_t d, float* out);
+
+/**
+ * @brief c = a b^T + bias, for row-major a (m x k) and b (n x k)
+ *
+ * b holds one row per output, as a weight matrix in PyTorch layout.
+ * Two rows of a and four of b are combined per pass, so each load feeds
+ * two or four FMAs.
+ * @param bias Added to every row of c (n values), or nullptr
+ * @param ldc Row stride of c
+ */
+void gemm_nt(const float* a, size_t m, const float* b, size_t n, size_t k,
+             const float* bias, float* c, size_t ldc);
+
+/**
+ * @brief Symmetric int8 quantization of m rows of length k
+ *
+ * q = round(x / scale) with scale = max|x| / 127 per row, so -128 never occurs.
+ * @param scales Receives m scales
+ */
+void quantize_rows_q8(const float* x, size_t m, size_t k, int8_t* q, float* scales);
+
+/**
+ * @brief gemm_nt over rows quantized by quantize_rows_q8
+ *
+ * Products are summed exactly in int32 and scaled once per output:
+ * c = a_scale * b_scale * (a b^T) + bias.
+ */
+void gemm_nt_q8(const int8_t* a, const float* a_scales, size_t m,
+                const int8_t* b, const float* b_scales, size_t n, size_t k,
+                const float* bias, float* c, size_t ldc);
+
+/**
+ * @brief Instruction set the kernels were compiled for ("avx2+fma" or "scalar")
+ */
+const char* instruction_set();
+
+} // namespace simd
+} // namespace neurorag
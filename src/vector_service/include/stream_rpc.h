@@ -0,0 +1,101 @@
+/**
+ * @file stream_rpc.h
+ * @brief Bidirectional streaming binary RPC server for batched vector search
+ *
+ * Clients keep one TCP connection open and push many QUERY frames; the
+ * server answers with RESULT frames tagged by request_id in completion
+ * order. See stream_rpc_protocol.h for the wire format and flow control.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
+#include <nlohmann/json.hpp>
+#include "vector_search.h"
+#include "stream_rpc_protocol.h"
+
+namespace neurorag {
+
+class MicroBatcher;
+
+/**
+ * @brief Streaming RPC server feeding the engine's micro-batcher
+ */
+class StreamRpcServer {
+public:
+    /**
+     * @brief Constructor
+     * @param host Address to bind
+     * @param port TCP port to listen on
+     * @param batcher Micro-batcher that executes queries (not owned)
+     * @param dimension Vector dimension queries must match
+     * @param max_k Largest k a query may request
+     * @param max_window Upper bound on in-flight queries per connection
+     */
+    StreamRpcServer(const std::string& host, int port,
+                    MicroBatcher* batcher, int dimension,
+                    int max_k = 100, uint32_t max_window = 256);
+
+    ~StreamRpcServer();
+
+    StreamRpcServer(const StreamRpcServer&) = delete;
+    StreamRpcServer& operator=(const StreamRpcServer&) = delete;
+
+    /**
+     * @brief Bind, listen and start the accept thread
+     * @return true if the listener is up, false otherwise
+     */
+    bool start();
+
+    /**
+     * @brief Stop accepting, close all connections and join threads
+     */
+    void stop();
+
+    /**
+     * @brief Connection and frame statistics
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    struct Connection;
+
+    std::string host_;
+    int port_;
+    MicroBatcher* batcher_;
+    int dimension_;
+    int max_k_;
+    uint32_t max_window_;
+
+    int listen_fd_;
+    std::atomic<bool> running_;
+    std::thread accept_thread_;
+
+    std::unordered_set<std::shared_ptr<Connection>> connections_;
+    mutable std::mutex connections_mutex_;
+
+    std::atomic<uint64_t> connections_accepted_;
+    std::atomic<uint64_t> queries_received_;
+    std::atomic<uint64_t> results_sent_;
+    std::atomic<uint64_t> window_violations_;
+
+    void accept_loop();
+    void connection_loop(std::shared_ptr<Connection> connection);
+    void handle_query(const std::shared_ptr<Connection>& connection,
+                      const rpc::FrameHeader& header,
+                      const std::vector<uint8_t>& payload);
+    void send_result(const std::shared_ptr<Connection>& connection,
+                     uint64_t request_id, const SearchResult& result);
+    void send_error(const std::shared_ptr<Connection>& connection,
+                    uint64_t request_id, const std::string& message,
+                    bool release_credit = true);
+};
+
+} // namespace neurorag
@@ -0,0 +1,109 @@
+/**
+ * @file stream_rpc_client.h
+ * @brief Client library for the streaming vector search RPC
+ *
+ * Used by benchmarks and co-located C++ callers. A single connection
+ * carries many concurrent queries; submit() blocks only when the server
+ * granted window is exhausted.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "stream_rpc_protocol.h"
+
+namespace neurorag {
+
+/**
+ * @brief Result of one streamed query
+ */
+struct StreamSearchResult {
+    uint64_t request_id;
+    std::vector<int64_t> indices;
+    std::vector<float> scores;
+    double server_latency_ms;
+    bool from_cache;
+    std::string error;
+};
+
+/**
+ * @brief Streaming RPC client
+ */
+class StreamRpcClient {
+public:
+    using Callback = std::function<void(const StreamSearchResult& result)>;
+
+    StreamRpcClient();
+    ~StreamRpcClient();
+
+    StreamRpcClient(const StreamRpcClient&) = delete;
+    StreamRpcClient& operator=(const StreamRpcClient&) = delete;
+
+    /**
+     * @brief Connect and negotiate the in-flight window
+     * @param host Server address
+     * @param port Server port
+     * @param requested_window Desired in-flight limit (0 = server maximum)
+     * @return true if connected, false otherwise
+     */
+    bool connect(const std::string& host, int port, uint32_t requested_window = 0);
+
+    /**
+     * @brief Send GOODBYE, fail outstanding queries and close the socket
+     */
+    void close();
+
+    /**
+     * @brief Submit one query; blocks while no credit is available
+     * @param query_vector Query embedding
+     * @param k Number of neighbours
+     * @param threshold Similarity threshold
+     * @param callback Invoked on the reader thread when the result arrives
+     * @return request_id assigned to the query, or 0 if the connection is closed
+     */
+    uint64_t submit(const std::vector<float>& query_vector, int k, float threshold,
+                    Callback callback);
+
+    /**
+     * @brief Wait until every submitted query has completed
+     */
+    void drain();
+
+    /**
+     * @brief Window granted by the server
+     */
+    uint32_t window() const { return window_; }
+
+    /**
+     * @brief Number of queries awaiting a result
+     */
+    size_t in_flight() const;
+
+    bool is_connected() const { return connected_.load(); }
+
+private:
+    int fd_;
+    uint32_t window_;
+    std::atomic<bool> connected_;
+    std::atomic<uint64_t> next_request_id_;
+
+    std::unordered_map<uint64_t, Callback> pending_;
+    mutable std::mutex pending_mutex_;
+    std::condition_variable credit_condition_;
+    std::mutex write_mutex_;
+    std::thread reader_thread_;
+
+    void reader_loop();
+    void fail_pending(const std::string& error);
+};
+
+} // namespace neurorag
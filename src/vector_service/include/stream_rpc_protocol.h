@@ -0,0 +1,86 @@
+/**
+ * @file stream_rpc_protocol.h
+ * @brief Wire protocol of the streaming vector search RPC
+ *
+ * Flow control is credit based: the server grants a window of in-flight
+ * queries in its WINDOW frame, every RESULT or ERROR frame returns one
+ * credit, and a client exceeding its window is disconnected.
+ *
+ * Wire format (little-endian, no padding):
+ *   FrameHeader (24 bytes) followed by payload_length bytes of payload.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace neurorag {
+namespace rpc {
+
+constexpr uint32_t kFrameMagic = 0x4350524e;  // "NRPC"
+constexpr uint8_t kProtocolVersion = 1;
+constexpr uint32_t kMaxPayloadBytes = 16u << 20;
+
+enum class FrameType : uint8_t {
+    HELLO = 1,    // client -> server, payload: uint32 requested window
+    WINDOW = 2,   // server -> client, payload: uint32 granted window
+    QUERY = 3,    // client -> server, payload: QueryPayload + float[dimension]
+    RESULT = 4,   // server -> client, payload: ResultPayload + int64[count] + float[count]
+    ERROR = 5,    // server -> client, payload: utf-8 message
+    GOODBYE = 6,  // either direction, no payload
+};
+
+#pragma pack(push, 1)
+struct FrameHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint16_t flags;
+    uint32_t payload_length;
+    uint32_t reserved;
+    uint64_t request_id;
+};
+
+struct QueryPayload {
+    int32_t k;
+    float threshold;
+    uint32_t dimension;
+};
+
+struct ResultPayload {
+    uint32_t count;
+    uint8_t from_cache;
+    uint8_t reserved[3];
+    double latency_ms;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FrameHeader) == 24, "FrameHeader must be 24 bytes");
+static_assert(sizeof(QueryPayload) == 12, "QueryPayload must be 12 bytes");
+static_assert(sizeof(ResultPayload) == 16, "ResultPayload must be 16 bytes");
+
+/**
+ * @brief Write one frame, retrying on short writes
+ * @return false on socket error
+ */
+bool write_frame(int fd, FrameType type, uint64_t request_id,
+                 const void* payload, uint32_t payload_length);
+
+/**
+ * @brief Write one frame from two payload parts without concatenating them
+ * @return false on socket error
+ */
+bool write_frame(int fd, FrameType type, uint64_t request_id,
+                 const void* part1, uint32_t length1,
+                 const void* part2, uint32_t length2);
+
+/**
+ * @brief Read one frame header and its payload
+ * @return false on EOF, socket error or malformed header
+ */
+bool read_frame(int fd, FrameHeader& header, std::vector<uint8_t>& payload);
+
+} // namespace rpc
+
+} // namespace neurorag
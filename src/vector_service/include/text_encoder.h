@@ -0,0 +1,183 @@
+/**
+ * @file text_encoder.h
+ * @brief In-process CPU inference of BERT-style sentence encoders
+ *
+ * Runs small sentence-transformers models such as all-MiniLM-L6-v2
+ * (6 layers, 384 dimensions) fully offline: WordPiece tokenization, the
+ * transformer encoder, mean pooling and optional L2 normalization, giving
+ * the same embeddings as the Python service without an HTTP hop.
+ *
+ * The tokens of every text in a batch are packed into one matrix, so each
+ * linear layer is a single GEMM (simd::gemm_nt, or simd::gemm_nt_q8 with
+ * int8 weights) with no padding; only attention runs per text. Work is
+ * spread over OpenMP threads by output tiles and by (text, head).
+ *
+ * Model file (scripts/export_text_encoder.py writes it), little-endian:
+ *   header   TextEncoderHeader below
+ *   vocab    vocab_bytes of tokens, each ending in '\n', in id order
+ *   tensors  fp32 in PyTorch layout: word, position and token type
+ *            embeddings, embedding LayerNorm weight and bias, then per
+ *            layer query, key, value and attention output (weight, bias),
+ *            attention LayerNorm (weight, bias), intermediate and output
+ *            (weight, bias), output LayerNorm (weight, bias)
+ *   crc32c   of everything before it
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "embedding_backend.h"
+#include "wordpiece_tokenizer.h"
+
+namespace neurorag {
+
+/**
+ * @brief Model file header
+ */
+struct TextEncoderHeader {
+    static constexpr uint32_t kMagic = 0x4554524E;    // "NRTE"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kLowercase = 1u << 0;   // uncased vocabulary
+    static constexpr uint32_t kNormalize = 1u << 1;   // L2-normalize pooled embeddings
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t vocab_size;
+    uint32_t hidden_size;
+    uint32_t num_layers;
+    uint32_t num_heads;
+    uint32_t intermediate_size;
+    uint32_t max_positions;
+    uint32_t type_vocab_size;
+    uint32_t max_sequence_length;    // tokens per text, [CLS] and [SEP] included
+    float layer_norm_eps;
+    uint32_t vocab_bytes;
+    uint32_t reserved;
+};
+
+/**
+ * @brief Transformer sentence encoder
+ */
+class TextEncoder {
+public:
+    /**
+     * @brief Read a model file
+     * @param quantize Keep linear layers as int8 (per-row scales) instead of fp32
+     * @param num_threads OpenMP threads per batch; 0 uses the OpenMP default
+     * @param error Why the file was rejected
+     * @return nullptr on error
+     */
+    static std::unique_ptr<TextEncoder> load(const std::string& path, bool quantize, int num_threads,
+                                             std::string& error);
+
+    /**
+     * @brief Parse the bytes of a model file
+     */
+    static std::unique_ptr<TextEncoder> deserialize(const uint8_t* data, size_t size, bool quantize,
+                                                    int num_threads, std::string& error);
+
+    ~TextEncoder();
+
+    /**
+     * @brief Embed a batch of texts
+     * @param embeddings Receives texts.size() x dimension() floats, row-major
+     */
+    void encode(const std::vector<std::string>& texts, std::vector<float>& embeddings) const;
+
+    int dimension() const { return static_cast<int>(header_.hidden_size); }
+    size_t max_sequence_length() const { return header_.max_sequence_length; }
+    bool quantized() const { return quantized_; }
+    const WordPieceTokenizer& tokenizer() const { return *tokenizer_; }
+
+    /**
+     * @brief Bytes of weights held
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * @brief Architecture, precision and threads
+     */
+    nlohmann::json describe() const;
+
+private:
+    // y = x W^T + b, with W as fp32 or int8 rows
+    struct Linear {
+        size_t outputs = 0;
+        size_t inputs = 0;
+        std::vector<float> weight;
+        std::vector<int8_t> quantized_weight;
+        std::vector<float> scales;
+        std::vector<float> bias;
+
+        void quantize();
+        void forward(const float* x, size_t rows, float* y, int threads) const;
+        size_t memory_bytes() const;
+    };
+
+    struct LayerNorm {
+        std::vector<float> weight;
+        std::vector<float> bias;
+    };
+
+    struct Layer {
+        Linear qkv;           // query, key and value fused: 3 x hidden outputs
+        Linear attention_output;
+        LayerNorm attention_norm;
+        Linear intermediate;
+        Linear output;
+        LayerNorm output_norm;
+    };
+
+    TextEncoderHeader header_;
+    bool quantized_;
+    int num_threads_;
+    std::unique_ptr<WordPieceTokenizer> tokenizer_;
+    std::vector<float> word_embeddings_;
+    std::vector<float> position_embeddings_;
+    std::vector<float> token_type_embeddings_;
+    LayerNorm embedding_norm_;
+    std::vector<Layer> layers_;
+
+    TextEncoder() = default;
+
+    void layer_norm(const LayerNorm& norm, float* x, size_t rows) const;
+
+    // Scaled dot-product attention of each text over its own tokens
+    void attention(const float* qkv, const std::vector<size_t>& offsets, float* context) const;
+};
+
+/**
+ * @brief EmbeddingBackend running a TextEncoder in process
+ */
+class LocalEmbeddingBackend : public EmbeddingBackend {
+public:
+    /**
+     * @brief Constructor
+     * @param encoder Loaded model
+     * @param max_batch_size Texts per encode call
+     * @param source Model path, for name()
+     */
+    LocalEmbeddingBackend(std::unique_ptr<TextEncoder> encoder, size_t max_batch_size, std::string source);
+
+    bool embed(const std::vector<std::string>& texts,
+               std::vector<float>& embeddings,
+               std::string& error) override;
+    int dimension() const override { return encoder_->dimension(); }
+    size_t max_batch_size() const override { return max_batch_size_; }
+    std::string name() const override;
+
+private:
+    std::unique_ptr<TextEncoder> encoder_;
+    size_t max_batch_size_;
+    std::string source_;
+};
+
+} // namespace neurorag
@@ -0,0 +1,214 @@
+/**
+ * @file tiered_invlists.h
+ * @brief IVF inverted lists split between DRAM and local NVMe by access frequency
+ *
+ * Query traffic probes a small fraction of the IVF lists, so only those
+ * need to live in memory. Every list is stored in a cold file on local
+ * NVMe; frequently probed lists are kept in a pinned hot tier, and other
+ * lists are read on demand (O_DIRECT, io_uring when available) into an
+ * LRU buffer pool.
+ *
+ * IndexIVF::search hands all probed lists of a batch to prefetch_lists()
+ * before scanning, so reads for every cold list are issued up front and
+ * overlap with each other and with scanning the hot ones. Per-list access
+ * counts are decayed and re-ranked periodically; the highest ranked lists
+ * that fit the hot budget are promoted and the rest demoted to the pool.
+ *
+ * Cold file layout ("NRTL"): a header and per-list table, then each list's
+ * codes followed by its ids, every list starting on a 4 KiB boundary.
+ * Lists modified after loading are held in DRAM and never evicted; the
+ * cold file is the persistent form of the index and faiss::write_index
+ * does not know about this class.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+#include <faiss/invlists/InvertedLists.h>
+#include <nlohmann/json.hpp>
+
+#include "async_file_reader.h"
+#include "readiness.h"
+
+namespace neurorag {
+
+/**
+ * @brief Inverted lists with a DRAM hot tier and an NVMe cold tier
+ */
+class TieredInvertedLists : public faiss::InvertedLists {
+public:
+    /**
+     * @brief Write lists to a cold file
+     * @param lists Source lists (typically the loaded index's ArrayInvertedLists)
+     * @param path Destination; written to path.tmp and renamed
+     * @return true if the file was written completely
+     */
+    static bool write_cold_file(const faiss::InvertedLists& lists, const std::string& path);
+
+    /**
+     * @brief Constructor
+     * @param nlist Number of lists (must match the cold file)
+     * @param code_size Code size in bytes (must match the cold file)
+     * @param hot_budget_bytes DRAM for pinned hot lists
+     * @param pool_budget_bytes DRAM for the LRU pool of cold lists
+     * @param reader Reader used for cold list reads (shared)
+     */
+    TieredInvertedLists(size_t nlist, size_t code_size,
+                        size_t hot_budget_bytes, size_t pool_budget_bytes,
+                        std::shared_ptr<AsyncFileReader> reader);
+    ~TieredInvertedLists() override;
+
+    /**
+     * @brief Open the cold file and load the initial hot set
+     *
+     * With no access history yet, the largest lists are loaded first:
+     * k-means puts more centroids, and more queries, where data is dense.
+     * @return false if the file is missing, corrupt or does not match
+     */
+    bool open(const std::string& path);
+
+    // faiss::InvertedLists
+    size_t list_size(size_t list_no) const override;
+    const uint8_t* get_codes(size_t list_no) const override;
+    const faiss::idx_t* get_ids(size_t list_no) const override;
+    void release_codes(size_t list_no, const uint8_t* codes) const override;
+    void release_ids(size_t list_no, const faiss::idx_t* ids) const override;
+    void prefetch_lists(const faiss::idx_t* list_nos, int nlist) const override;
+    size_t add_entries(size_t list_no, size_t n_entry,
+                       const faiss::idx_t* ids, const uint8_t* code) override;
+    void update_entries(size_t list_no, size_t offset, size_t n_entry,
+                        const faiss::idx_t* ids, const uint8_t* code) override;
+    void resize(size_t list_no, size_t new_size) override;
+
+    /**
+     * @brief Re-rank lists by decayed access count and move them between tiers
+     *
+     * Lists are ranked by score per byte, so the hot budget holds as many
+     * probes as possible. Hot lists are favoured by a hysteresis factor
+     * and win ties, so similar lists do not swap tiers back and forth and
+     * idle periods do not empty the hot tier.
+     * @param decay Weight kept by older access counts (0..1)
+     */
+    void rebalance(double decay = 0.5);
+
+    /**
+     * @brief Rebalance periodically in the background
+     * @param interval Time between rebalances
+     * @param decay Weight kept by older access counts at each rebalance (0..1)
+     */
+    void start_rebalancing(std::chrono::milliseconds interval, double decay);
+
+    /**
+     * @brief Stop background rebalancing
+     */
+    void stop();
+
+    /**
+     * @brief Evict least recently used pool lists
+     *
+     * Used under memory pressure; the pool refills on later misses.
+     * @param bytes Pool memory to free
+     * @return Bytes evicted (buffers still pinned by readers are freed on release)
+     */
+    size_t trim_pool(size_t bytes);
+
+    /**
+     * @brief DRAM held by the hot tier and the pool
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * @brief Memory held by the hot tier, for prefaulting and residency checks
+     */
+    std::vector<MemoryRegion> hot_regions() const;
+
+    /**
+     * @brief Tier sizes, hit rates and read counts
+     */
+    nlohmann::json get_statistics() const;
+
+private:
+    enum class Tier : uint8_t { COLD, POOL, HOT };
+
+    // One list's codes and ids in a single aligned allocation
+    struct ListBuffer {
+        uint8_t* block = nullptr;
+        size_t capacity = 0;  // entries
+        size_t bytes = 0;     // allocation size
+        uint8_t* codes() const { return block; }
+        faiss::idx_t* ids(size_t code_size) const;
+        ~ListBuffer();
+    };
+
+    struct PendingRead;
+
+    // Slot state is guarded by state_mutex_; reads never run under it
+    struct ListSlot {
+        uint64_t file_offset = 0;
+        uint64_t file_bytes = 0;
+        std::atomic<size_t> size{0};
+        std::shared_ptr<ListBuffer> buffer;
+        std::shared_ptr<PendingRead> pending;
+        Tier tier = Tier::COLD;
+        bool dirty = false;
+        std::list<size_t>::iterator lru_position;
+        std::atomic<uint64_t> accesses{0};
+        double score = 0.0;
+    };
+
+    size_t hot_budget_bytes_;
+    size_t pool_budget_bytes_;
+    std::shared_ptr<AsyncFileReader> reader_;
+    int fd_;
+    std::string path_;
+
+    std::unique_ptr<ListSlot[]> slots_;
+    mutable std::mutex state_mutex_;
+    mutable std::list<size_t> lru_;  // pool lists, most recent first
+    mutable size_t pool_bytes_;
+    mutable size_t hot_bytes_;
+
+    std::mutex rebalance_mutex_;
+    std::thread rebalance_thread_;
+    std::mutex rebalance_wait_mutex_;
+    std::condition_variable rebalance_condition_;
+    bool rebalancing_;
+
+    mutable std::atomic<uint64_t> hot_hits_;
+    mutable std::atomic<uint64_t> pool_hits_;
+    mutable std::atomic<uint64_t> sync_reads_;
+    mutable std::atomic<uint64_t> prefetch_reads_;
+    mutable std::atomic<uint64_t> prefetch_waits_;
+    mutable std::atomic<uint64_t> read_failures_;
+    mutable std::atomic<uint64_t> evictions_;
+    std::atomic<uint64_t> promotions_;
+    std::atomic<uint64_t> demotions_;
+
+    size_t list_bytes(size_t entries) const;
+
+    // Resident buffer for the list, reading it if needed
+    std::shared_ptr<ListBuffer> acquire(size_t list_no, bool count_access) const;
+    std::shared_ptr<ListBuffer> read_list(size_t list_no) const;
+    void finish_read(size_t list_no, const std::shared_ptr<PendingRead>& pending,
+                     std::shared_ptr<ListBuffer> buffer) const;
+    std::shared_ptr<ListBuffer> mutable_list(size_t list_no, size_t min_capacity);
+
+    // Called with state_mutex_ held
+    void admit_to_pool_locked(size_t list_no, std::shared_ptr<ListBuffer> buffer) const;
+    void remove_from_pool_locked(size_t list_no) const;
+
+    void rebalance_loop(std::chrono::milliseconds interval, double decay);
+};
+
+} // namespace neurorag
@@ -0,0 +1,132 @@
+/**
+ * @file vector_preprocessor.h
+ * @brief Normalization, centering and PCA/OPQ reduction applied before indexing
+ *
+ * Every vector added to the index and every query goes through the same
+ * preprocessor, trained once on a sample by the index builder and stored
+ * beside the index (<index>.transform, or inside a snapshot):
+ *
+ *   y = s * (A x) - A m      s = 1 / ||x|| when normalizing, else 1
+ *                            m = training mean when centering, else 0
+ *                            A = PCA or OPQ rotation (d_out x d_in), or I
+ *
+ * followed by renormalizing y when the output must stay unit length. The
+ * normalization factor and mean are folded into one matrix-vector pass
+ * (simd::gemv), so a vector is read once for its norm and once for the
+ * product. Reducing 1536 dimensions to 512 with PCA cuts the per-vector
+ * cost of flat scans, IVF list scans and HNSW distance computations
+ * roughly 3x; check the recall cost with the builder's --report.
+ *
+ * When the output is unit length, inner product equals cosine
+ * similarity, so an inner-product index ranks exactly by cosine.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+/**
+ * @brief What to train; mirrors the builder's --normalize/--center/--pca/--opq
+ */
+struct VectorPreprocessorOptions {
+    bool normalize = false;           // L2-normalize inputs (and outputs after reduction)
+    bool center = false;              // subtract the training mean
+    std::string rotation = "none";    // none, pca or opq
+    int output_dimension = 0;         // pca/opq: 0 keeps the input dimension
+    int opq_subquantizers = 0;        // opq: 0 picks 16 (or the largest divisor of the output below it)
+    size_t training_size = 100000;    // sample rows used for training
+};
+
+/**
+ * @brief Fused per-vector transform from embedding space to index space
+ */
+class VectorPreprocessor {
+public:
+    enum class Rotation : uint32_t { NONE = 0, PCA = 1, OPQ = 2 };
+
+    /**
+     * @brief Train on a sample
+     * @param n Sample rows
+     * @param x Sample (n * d); not modified
+     * @param d Input dimension
+     * @param error Why training failed
+     * @return nullptr on failure
+     */
+    static std::unique_ptr<VectorPreprocessor> train(size_t n, const float* x, int d,
+                                                     const VectorPreprocessorOptions& options,
+                                                     std::string& error);
+
+    /**
+     * @brief L2 normalization only (embedding.normalize_embeddings)
+     */
+    static std::unique_ptr<VectorPreprocessor> normalization(int d);
+
+    /**
+     * @brief Read a transform file written by save()
+     * @return nullptr if missing, truncated or failing its checksum
+     */
+    static std::unique_ptr<VectorPreprocessor> load(const std::string& path);
+
+    /**
+     * @brief Parse the bytes of serialize()
+     */
+    static std::unique_ptr<VectorPreprocessor> deserialize(const uint8_t* data, size_t size, std::string& error);
+
+    /**
+     * @brief Write atomically (path.tmp, then rename)
+     */
+    bool save(const std::string& path) const;
+
+    void serialize(std::vector<uint8_t>& buffer) const;
+
+    /**
+     * @brief Transform n vectors (n * input_dimension) into y (n * output_dimension)
+     *
+     * Large batches are split over OpenMP threads. x and y must not overlap
+     * unless the dimensions match and nothing but normalization is applied.
+     */
+    void apply(size_t n, const float* x, float* y) const;
+
+    int input_dimension() const { return input_dimension_; }
+    int output_dimension() const { return output_dimension_; }
+    Rotation rotation() const { return rotation_; }
+
+    /**
+     * @brief Whether outputs are unit length (inner product == cosine)
+     */
+    bool normalizes_output() const;
+
+    /**
+     * @brief Whether apply() changes nothing
+     */
+    bool is_identity() const;
+
+    /**
+     * @brief Dimensions, steps applied and retained variance
+     */
+    nlohmann::json describe() const;
+
+private:
+    VectorPreprocessor() = default;
+
+    int input_dimension_ = 0;
+    int output_dimension_ = 0;
+    bool normalize_input_ = false;
+    bool normalize_output_ = false;
+    Rotation rotation_ = Rotation::NONE;
+    float explained_variance_ = 1.0f;   // PCA: share of the sample variance kept
+    std::vector<float> matrix_;         // output x input, row-major; empty without a rotation
+    std::vector<float> offset_;         // A m (or m without a rotation); empty without centering
+
+    void apply_one(const float* x, float* y) const;
+};
+
+} // namespace neurorag
@@ -18,6 +18,8 @@
 #include <thread>
 #include <queue>
 #include <condition_variable>
+#include <chrono>
+#include <functional>
 
 #include <faiss/IndexFlat.h>
 #include <faiss/IndexIVFFlat.h>
@@ -25,8 +27,25 @@
 #include <faiss/index_io.h>
 #include <nlohmann/json.hpp>
 
+#include "id_map.h"
+#include "index_version.h"
+#include "lock_free_queue.h"
+#include "memory_accountant.h"
+#include "query_log.h"
+#include "readiness.h"
+#include "vector_preprocessor.h"
+
 namespace neurorag {
 
+class FilteredHnswIndex;
+class FreshnessSearcher;
+class LsmIndex;
+class MatryoshkaIndex;
+class MetadataColumns;
+class MetadataFilter;
+class PartitionedIndex;
+class QueryEmbedder;
+
 /**
  * @brief Search result structure
  */
@@ -46,7 +65,11 @@ struct SearchRequest {
     int k;
     float threshold;
     std::unordered_map<std::string, std::string> filters;
+    std::string filter;             // Filter expression (metadata_filter.h), ANDed with filters
     std::string request_id;
+    int prefix_dimension = 0;       // Matryoshka first pass; 0 uses MATRYOSHKA_PREFIX_DIM
+    int candidate_multiplier = 0;   // Matryoshka candidates per result; 0 uses the configured one
+    double decay_lambda = 0.0;      // Freshness decay per day of age; 0 uses FRESHNESS_DECAY_LAMBDA
 };
 
 /**
@@ -54,7 +77,9 @@ struct SearchRequest {
  */
 struct VectorSearchConfig {
     std::string index_path;
+    std::string index_verify;
     std::string metadata_path;
+    std::string metadata_filter_fields;
     int dimension;
     int num_threads;
     bool use_gpu;
@@ -62,12 +87,46 @@ struct VectorSearchConfig {
     bool enable_cache;
     std::string cache_redis_url;
     int cache_ttl_seconds;
+    int cache_redis_pool_size;
+    int cache_lookup_timeout_ms;
+    bool cache_fp16_scores;
+    std::string tiered_lists_path;
+    int hot_lists_memory_mb;
+    int cold_cache_memory_mb;
+    int tier_rebalance_seconds;
+    std::string disk_index_path;
+    int disk_index_cache_nodes;
+    int disk_index_search_list;
+    int disk_index_beam_width;
+    std::string delta_index_type;
+    int delta_merge_threshold;
+    int delta_merge_interval_seconds;
+    std::string index_snapshot_dir;
+    bool index_snapshot_lazy;
+    bool index_hot_swap;
+    bool index_reload_mmap;
+    int index_reload_watch_seconds;
+    int memory_insert_wait_ms;
+    std::string vector_transform_path;
+    bool normalize_vectors;
+    int matryoshka_prefix_dimension;
+    int matryoshka_candidate_multiplier;
+    bool filtered_hnsw_search;
+    double filtered_hnsw_exact_selectivity;
+    double filtered_hnsw_native_selectivity;
+    std::string partition_field;
+    int partition_hnsw_threshold;
+    std::string freshness_field;
+    double freshness_decay_lambda;
+    int freshness_candidate_multiplier;
     bool enable_numa;
     int numa_node;
     bool enable_prefetch;
     int prefetch_size;
     double similarity_threshold;
     int max_results;
+    int max_batch_size;
+    int batch_timeout_us;
 };
 
 /**
@@ -149,6 +208,24 @@ public:
      */
     bool load_index(const std::string& path);
     
+    /**
+     * @brief Write the index and metadata as a segmented snapshot
+     *
+     * Only segments that changed since the previous snapshot in the
+     * directory are written (see index_snapshot.h).
+     * @param directory Snapshot directory; empty uses index_snapshot_dir
+     * @return true if the new manifest was committed
+     */
+    bool save_index_snapshot(const std::string& directory = "");
+    
+    /**
+     * @brief Replace the index and metadata with a snapshot
+     * @param directory Snapshot directory holding manifest.json
+     * @param lazy Map IVF list segments instead of reading them
+     * @return false if the snapshot is missing, corrupt or of another dimension
+     */
+    bool load_index_snapshot(const std::string& directory, bool lazy);
+    
     /**
      * @brief Get index statistics
      * @return JSON object with statistics
@@ -166,6 +243,474 @@ public:
      * @param queries List of query vectors to cache
      */
     void warmup_cache(const std::vector<std::vector<float>>& queries);
+    
+    /**
+     * @brief Capture the index versions a search for this request depends on
+     *
+     * Call before executing the search and store the result with the cached
+     * entry; for IVF indexes this records the versions of the probed lists.
+     * @param request Search request
+     * @return Dependency to store alongside the cached result
+     */
+    CacheDependency capture_cache_dependency(const SearchRequest& request) const;
+    
+    /**
+     * @brief Validate a cached entry against the live index versions
+     * @param dependency Dependency stored with the cached result
+     * @return true if no update touched anything the result depended on
+     */
+    bool is_cache_entry_current(const CacheDependency& dependency) const;
+    
+    /**
+     * @brief Encode a result for the result cache
+     *
+     * Uses the compact binary format from result_codec.h; metadata is stored
+     * by reference when every id is in the local metadata store.
+     * @param result Search result to cache
+     * @param dependency Index versions captured before the search
+     * @return Encoded cache value
+     */
+    std::string encode_cached_result(const SearchResult& result, const CacheDependency& dependency);
+    
+    /**
+     * @brief Decode a cached value and rehydrate its metadata
+     * @param value Encoded cache value
+     * @param result Decoded result
+     * @param dependency Index versions stored with the result
+     * @return false if the value is corrupt or from an incompatible version
+     */
+    bool decode_cached_result(const std::string& value, SearchResult& result, CacheDependency& dependency);
+    
+    /**
+     * @brief Attach a recorder that samples incoming queries
+     * @param recorder Recorder owned by the caller, or nullptr to stop recording
+     */
+    void set_query_recorder(QueryRecorder* recorder);
+    
+    /**
+     * @brief Warm up from recorded production traffic
+     *
+     * Touches the IVF lists the queries probe (or the HNSW upper layers)
+     * so their pages are resident, then replays the queries through
+     * batch_search in parallel batches to populate the result cache.
+     * @param queries Queries to replay, typically QueryRecorder::top_queries()
+     * @return Warmup report (queries replayed, bytes touched, elapsed time)
+     */
+    nlohmann::json warmup_from_traffic(const std::vector<RecordedQuery>& queries);
+    
+    /**
+     * @brief Memory backing the loaded index, for prefaulting and residency checks
+     * @return Regions covering index codes, ids, graph and quantizer data
+     */
+    std::vector<MemoryRegion> get_index_memory_regions();
+    
+    /**
+     * @brief Move IVF lists into a DRAM/NVMe tiered store
+     *
+     * Writes the loaded lists to cold_path and replaces them with a
+     * TieredInvertedLists, freeing the in-memory copy. Lists are promoted
+     * and demoted by access count every rebalance_interval.
+     * @param cold_path Cold file on local NVMe
+     * @param hot_budget_bytes DRAM for pinned hot lists
+     * @param pool_budget_bytes DRAM for the cold-list buffer pool
+     * @param rebalance_interval Time between tier rebalances
+     * @return false if the index is not IVF or the cold file cannot be written
+     */
+    bool enable_tiered_lists(const std::string& cold_path,
+                             size_t hot_budget_bytes,
+                             size_t pool_budget_bytes,
+                             std::chrono::seconds rebalance_interval);
+    
+    /**
+     * @brief Tier sizes and hit rates of the tiered list store
+     * @return Statistics, with "enabled": false when lists are not tiered
+     */
+    nlohmann::json get_tiering_statistics();
+    
+    /**
+     * @brief Serve from an SSD-resident DiskANN graph instead of the in-memory index
+     *
+     * The graph file is built offline with DiskAnnIndex::build. Only PQ
+     * codes, ids and cached_nodes nodes around the entry point are kept
+     * in RAM.
+     * @param path Graph file on local NVMe
+     * @param cached_nodes Nodes to cache in RAM
+     * @param search_list_size Default search list size (L)
+     * @param beam_width Default node reads per hop
+     * @return false if the file cannot be loaded or its dimension differs
+     */
+    bool load_disk_index(const std::string& path, size_t cached_nodes,
+                         int search_list_size, int beam_width);
+    
+    /**
+     * @brief Route inserts and deletes through an LSM-style delta index
+     *
+     * Wraps the loaded index in an LsmIndex: add_vectors goes to an
+     * in-memory delta segment searched alongside the main index, deletes
+     * go to a tombstone bitmap, and a background merge folds both into a
+     * new main index.
+     * @param delta_type "flat" or "hnsw" delta segments
+     * @param merge_threshold Delta size that triggers a merge
+     * @param merge_interval Longest time between merges while changes are pending
+     * @return false if no index is loaded or it is a DiskANN index
+     */
+    bool enable_delta_index(const std::string& delta_type, size_t merge_threshold,
+                            std::chrono::seconds merge_interval);
+    
+    /**
+     * @brief Merge the delta index now
+     *
+     * Without hot swap the merge holds the index lock, so a load cannot free
+     * the delta index under it; with hot swap searches continue meanwhile.
+     * @return false if the delta index is not enabled or the merge failed
+     */
+    bool merge_delta_index();
+    
+    /**
+     * @brief Delta segment sizes, tombstones and merge counters
+     * @return Statistics, with "enabled": false when no delta index is used
+     */
+    nlohmann::json get_delta_statistics();
+    
+    /**
+     * @brief Serve the index through generations that reload_index can replace
+     *
+     * Wraps the loaded index in a GenerationIndex. Call once, after the
+     * other enable_* hooks and before serving traffic; from then on the
+     * engine's index is never replaced, only its generations.
+     * @return false if no index is loaded
+     */
+    bool enable_hot_swap();
+    
+    /**
+     * @brief Load a new index generation and switch searches over to it
+     *
+     * Loads in the calling thread while the current generation keeps
+     * serving, re-applies the delta index if one is configured, lets
+     * prepare make the new memory resident, then publishes it atomically.
+     * Returns once the previous generation has drained (or a bounded wait
+     * expired; it is then freed by a later reload).
+     * @param path Snapshot directory (holding manifest.json) or faiss index
+     *        file; a file is loaded with config metadata_path, when it exists
+     * @param mmap Map IVF lists (lazy snapshot load, IO_FLAG_MMAP) instead of reading them
+     * @param prepare Called with the new generation's memory before it is published
+     * @return false if hot swap is not enabled, the index cannot be loaded, or
+     *         an index file's vector count does not match its documents
+     */
+    bool reload_index(const std::string& path, bool mmap,
+                      const std::function<void(const std::vector<MemoryRegion>&)>& prepare = nullptr);
+    
+    /**
+     * @brief Current generation, retired generations and reader slots
+     * @return Statistics, with "enabled": false when hot swap is off
+     */
+    nlohmann::json get_generation_statistics();
+    
+    /**
+     * @brief Account memory to a budget and admit inserts against it
+     * @param accountant Accountant owned by the caller, or nullptr to stop accounting
+     */
+    void set_memory_accountant(MemoryAccountant* accountant);
+    
+    /**
+     * @brief Measure index, metadata, delta and cache memory into the accountant
+     *
+     * Installed as the accountant's sampler.
+     */
+    void sample_memory_usage(MemoryAccountant& accountant);
+    
+    /**
+     * @brief Give cache memory back under memory pressure
+     *
+     * Evicts cold lists from the tiered list pool; hot lists and the
+     * index itself are never dropped.
+     * @param bytes Bytes wanted
+     * @return Bytes freed
+     */
+    size_t reclaim_cache_memory(size_t bytes);
+    
+    /**
+     * @brief Reserve memory for an insert before it allocates
+     *
+     * add_vectors calls this before taking index_mutex_ (reclaiming takes
+     * it) and commits the reservation to INDEX or DELTA once the vectors
+     * are in. Waits up to memory_insert_wait_ms for memory to be released.
+     * @param count Vectors to insert
+     * @param metadata_bytes Total size of their metadata
+     * @param reservation Holds the memory until committed or destroyed
+     * @return false if the insert does not fit the budget; reject it
+     */
+    bool admit_insert(size_t count, size_t metadata_bytes, MemoryReservation& reservation);
+    
+    /**
+     * @brief Memory budget, per-component usage and admission counters
+     * @return Statistics, with "enabled": false when no accountant is attached
+     */
+    nlohmann::json get_memory_statistics() const;
+    
+    /**
+     * @brief Insert documents by external id, replacing ones already present
+     *
+     * A replaced document keeps its internal id on an IVF index and moves
+     * to a new one behind the delta index (the old id is tombstoned);
+     * flat and HNSW indexes without a delta index only accept new ids.
+     * Metadata gets an "id" field if it lacks one, so the mapping survives
+     * snapshots and reloads.
+     * @param external_ids Document ids, unique within the batch
+     * @param vectors Vector data
+     * @param metadata Associated metadata, or empty
+     * @return false if nothing was inserted (or an index error left a
+     *         replaced document removed but not re-added)
+     */
+    bool upsert_vectors(const std::vector<std::string>& external_ids,
+                        const std::vector<std::vector<float>>& vectors,
+                        const std::vector<std::string>& metadata);
+    
+    /**
+     * @brief Internal id of a document, without locking
+     * @return -1 if unknown
+     */
+    int64_t find_document(const std::string& external_id) const;
+    
+    /**
+     * @brief Rebuild the document id map from the "id" field of the metadata
+     * @return Documents mapped
+     */
+    size_t rebuild_document_ids();
+    
+    /**
+     * @brief Mapped documents and hash table statistics
+     */
+    nlohmann::json get_document_id_statistics() const;
+    
+    /**
+     * @brief Transform applied to added vectors and queries before the index
+     *
+     * Must match the transform the index was built with; the output
+     * dimension is checked against the loaded index.
+     * @param preprocessor Transform, or nullptr to pass vectors through
+     * @return false if its dimensions do not fit the embeddings or the index
+     */
+    bool set_vector_preprocessor(std::shared_ptr<const VectorPreprocessor> preprocessor);
+    
+    std::shared_ptr<const VectorPreprocessor> vector_preprocessor() const;
+    
+    /**
+     * @brief Map n embeddings into index space
+     *
+     * add_vectors, upsert_vectors and search call this before touching
+     * the index.
+     * @param buffer Holds the output when a transform is set
+     * @return vectors itself when no transform is set, else buffer's data
+     */
+    const float* preprocess_vectors(const float* vectors, size_t n, std::vector<float>& buffer) const;
+    
+    /**
+     * @brief Dimension of index vectors (the transform's output dimension)
+     */
+    int index_dimension() const;
+    
+    /**
+     * @brief Whether index vectors and queries are unit length
+     *
+     * When true, inner product ranks exactly by cosine similarity.
+     */
+    bool vectors_normalized() const;
+    
+    /**
+     * @brief Transform dimensions and steps
+     * @return Statistics, with "enabled": false when vectors pass through
+     */
+    nlohmann::json get_preprocessing_statistics() const;
+    
+    /**
+     * @brief Search a flat index through a prefix array of its vectors first
+     *
+     * Wraps the loaded FLAT index in a MatryoshkaIndex: the first
+     * prefix_dimension dimensions of every vector are scanned for
+     * k * candidate_multiplier candidates, which are re-scored with their
+     * full vectors. Call before enable_delta_index and enable_hot_swap.
+     * @param prefix_dimension Dimensions in the first pass (e.g. 256 of 1536)
+     * @param candidate_multiplier Default candidates per requested result
+     * @return false if the index is not flat or the prefix does not fit it
+     */
+    bool enable_matryoshka_search(int prefix_dimension, int candidate_multiplier);
+    
+    /**
+     * @brief Per-request prefix length and candidate multiplier
+     *
+     * search() passes these to the index (with its filter selector set).
+     * @param request Search request
+     * @return nullptr when the request keeps the defaults or Matryoshka search is off
+     */
+    std::unique_ptr<faiss::SearchParameters> matryoshka_search_parameters(const SearchRequest& request);
+    
+    /**
+     * @brief Prefix length, defaults and first-pass counters
+     * @return Statistics, with "enabled": false when Matryoshka search is off
+     */
+    nlohmann::json get_matryoshka_statistics();
+    
+    /**
+     * @brief Apply metadata filters during HNSW traversal
+     *
+     * Wraps the loaded HNSW_FLAT index in a FilteredHnswIndex: filtered
+     * searches estimate the filter's selectivity and below
+     * native_selectivity skip filtered-out nodes during traversal instead
+     * of walking through them, or below exact_selectivity scan the
+     * passing documents exactly. Call before enable_delta_index and
+     * enable_hot_swap.
+     * @param exact_selectivity Fraction of passing documents below which a search is exact
+     * @param native_selectivity Fraction from which faiss's own filtered search is used
+     * @return false if the index is not HNSW_FLAT
+     */
+    bool enable_filtered_hnsw_search(double exact_selectivity, double native_selectivity);
+    
+    /**
+     * @brief Thresholds and searches per strategy
+     * @return Statistics, with "enabled": false when filter-aware HNSW search is off
+     */
+    nlohmann::json get_filtered_hnsw_statistics();
+    
+    /**
+     * @brief Embed query text for search_text
+     * @param embedder Embedder owned by the caller, or nullptr to disable text search
+     * @return false if its dimension does not match the configured dimension
+     */
+    bool set_query_embedder(QueryEmbedder* embedder);
+    
+    /**
+     * @brief Search with raw query text
+     *
+     * The text is embedded through the query embedder (its cache, then a
+     * batched backend call) and searched like any other query.
+     * @param text Query text
+     * @param request Search parameters; query_vector is filled in
+     * @param result Search results
+     * @param error Set when the text cannot be embedded
+     * @return false if text search is disabled or embedding failed
+     */
+    bool search_text(const std::string& text, SearchRequest request, SearchResult& result, std::string& error);
+    
+    /**
+     * @brief Embedding cache and backend batching statistics
+     * @return Statistics, with "enabled": false when text search is off
+     */
+    nlohmann::json get_embedding_statistics() const;
+    
+    /**
+     * @brief Re-index the filterable metadata fields of every document
+     *
+     * initialize() and every metadata replacement (snapshot load, reload)
+     * call this; add_vectors and upsert_vectors index their documents as
+     * they insert them.
+     * @return Documents indexed
+     */
+    size_t rebuild_metadata_columns();
+    
+    /**
+     * @brief Compile a request's filter expression and equality filters
+     *
+     * search() sets the result as the index's IDSelector (in the Matryoshka
+     * parameters when there are some) and rejects a request whose filter
+     * does not compile.
+     * @param request Search request
+     * @param error Why the filter does not compile
+     * @return nullptr when the request has no filter, or (with error set) an invalid one
+     */
+    std::unique_ptr<MetadataFilter> compile_filter(const SearchRequest& request, std::string& error) const;
+    
+    /**
+     * @brief Compile a filter and evaluate it over every document
+     * @param expression Filter expression
+     * @return The program, matches, selectivity and evaluation cost, or the error
+     */
+    nlohmann::json explain_filter(const std::string& expression) const;
+    
+    /**
+     * @brief Indexed fields, dictionary sizes and filter counters
+     * @return Statistics, with "enabled": false before the metadata is indexed
+     */
+    nlohmann::json get_metadata_column_statistics() const;
+    
+    /**
+     * @brief Rebuild the per-value partition indexes of partition_field
+     *
+     * Copies the serving index's vectors of every document with a string
+     * value for the field into that value's partition (IVF-flat lists are
+     * read directly, other indexes through reconstruct). Holds index_mutex_
+     * throughout, so inserts wait for it. Call after rebuild_metadata_columns();
+     * reloads and snapshot loads do.
+     * @return Vectors partitioned; 0 when partition_field is empty or not a string column
+     */
+    size_t rebuild_partitions();
+    
+    /**
+     * @brief Answer a filtered search from the partition indexes
+     *
+     * search() calls this before the global index; it succeeds when the
+     * filter restricts partition_field to one or a few values.
+     * @param queries n x d index-space queries
+     * @param n Number of queries
+     * @param k Results per query
+     * @param filter Compiled request filter, or nullptr
+     * @param distances n x k distances
+     * @param labels n x k internal ids
+     * @return false if the global index must be searched
+     */
+    bool search_partitions(const float* queries, size_t n, int k, const MetadataFilter* filter,
+                           float* distances, faiss::idx_t* labels);
+    
+    /**
+     * @brief Keep the partitions in step with an insert
+     *
+     * add_vectors, upsert_vectors and remove_vectors call this under
+     * index_mutex_, after the documents' metadata columns are set.
+     * @param rows Internal ids added
+     * @param n Number of ids added
+     * @param vectors n x d index-space vectors
+     * @param removed Internal ids removed or replaced
+     */
+    void update_partitions(const faiss::idx_t* rows, size_t n, const float* vectors,
+                           const std::vector<int64_t>& removed);
+    
+    /**
+     * @brief Partition sizes and routing counters
+     * @return Statistics, with "enabled": false when no field is partitioned
+     */
+    nlohmann::json get_partition_statistics() const;
+    
+    /**
+     * @brief Score documents by similarity times exp(-lambda x age in days)
+     * @param field Metadata field holding the timestamp (numeric or date, epoch seconds)
+     * @param candidate_multiplier Undecayed candidates per result for HNSW, PQ and DiskANN indexes
+     * @return false if field is not among metadata_filter_fields
+     */
+    bool enable_freshness_scoring(const std::string& field, int candidate_multiplier);
+    
+    /**
+     * @brief Search with the time decay applied inside the top-k heap
+     *
+     * search() calls this instead of the index when the request or the
+     * configuration sets a decay; decayed results are not cached, as they
+     * change with the clock.
+     * @param queries n x d index-space queries
+     * @param n Number of queries
+     * @param k Results per query
+     * @param decay_lambda Decay per day of age; 0 uses freshness_decay_lambda
+     * @param filter Compiled request filter, or nullptr
+     * @param distances n x k decayed scores (IP) or distances (L2)
+     * @param labels n x k internal ids
+     * @return false if no decay applies; search the index as usual
+     */
+    bool search_with_decay(const float* queries, size_t n, int k, double decay_lambda,
+                           const MetadataFilter* filter, float* distances, faiss::idx_t* labels);
+    
+    /**
+     * @brief Segments scanned and skipped by decayed searches
+     * @return Statistics, with "enabled": false when no freshness field is set
+     */
+    nlohmann::json get_freshness_statistics() const;
 
 private:
     // Configuration
@@ -195,6 +740,62 @@ private:
     // Cache management
     class CacheManager* cache_manager_;
     
+    // Index versions for cache invalidation
+    IndexVersionTracker index_versions_;
+    
+    // Version bookkeeping; record_vectors_removed must run before the ids
+    // are removed so their owning lists can still be resolved
+    void record_vectors_added(const float* vectors, size_t count);
+    void record_vectors_removed(const std::vector<int64_t>& ids);
+    void reset_index_versions();
+    
+    // The concrete index behind any GenerationIndex and LsmIndex wrappers;
+    // hold the pointer while using it, a merge or reload may replace it
+    std::shared_ptr<const faiss::Index> base_index() const;
+    
+    // The index searches go to, looking through any GenerationIndex; the
+    // handle keeps its generation alive across a reload. Call under index_mutex_
+    std::shared_ptr<faiss::Index> serving_index() const;
+    
+    // Sampled query log for traffic-driven warmup; search() calls record_query
+    std::atomic<QueryRecorder*> query_recorder_{nullptr};
+    void record_query(const SearchRequest& request);
+    
+    // Memory budget; add_vectors reserves through admit_insert
+    std::atomic<MemoryAccountant*> memory_accountant_{nullptr};
+    size_t touch_hot_index_pages(const std::vector<SearchRequest>& requests);
+    
+    // External document id <-> internal id; written under index_mutex_,
+    // read without locking
+    DocumentIdMap document_ids_;
+    
+    // Embedding -> index space transform; replaced with std::atomic_store
+    // on load and reload, read with std::atomic_load per batch
+    std::shared_ptr<const VectorPreprocessor> preprocessor_;
+    
+    // The MatryoshkaIndex among the serving index's layers. Call under index_mutex_
+    std::shared_ptr<const MatryoshkaIndex> matryoshka_index() const;
+    
+    // The FilteredHnswIndex among the serving index's layers. Call under index_mutex_
+    std::shared_ptr<const FilteredHnswIndex> filtered_hnsw_index() const;
+    
+    // The LsmIndex among the serving index's layers. Call under index_mutex_
+    std::shared_ptr<const LsmIndex> delta_index() const;
+    
+    // Query text -> embedding for search_text; owned by main
+    std::atomic<QueryEmbedder*> query_embedder_{nullptr};
+    
+    // Filterable metadata fields in column form; written under
+    // metadata_mutex_, replaced with std::atomic_store on a rebuild
+    std::shared_ptr<MetadataColumns> metadata_columns_;
+    
+    // Per-value indexes of partition_field; replaced with std::atomic_store
+    // on a rebuild, cleared when a reload publishes a new generation
+    std::shared_ptr<PartitionedIndex> partitions_;
+    
+    // Decayed top-k search over freshness_field; set once by enable_freshness_scoring
+    std::shared_ptr<FreshnessSearcher> freshness_;
+    
     // NUMA optimization
     void setup_numa_affinity();
     
@@ -279,29 +880,4 @@ private:
     std::mutex allocation_mutex_;
 };
 
-/**
- * @brief Lock-free queue for high-performance request processing
- */
-template<typename T>
-class LockFreeQueue {
-public:
-    LockFreeQueue();
-    ~LockFreeQueue();
-    
-    bool enqueue(const T& item);
-    bool dequeue(T& item);
-    size_t size() const;
-    bool empty() const;
-    
-private:
-    struct Node {
-        std::atomic<T*> data;
-        std::atomic<Node*> next;
-    };
-    
-    std::atomic<Node*> head_;
-    std::atomic<Node*> tail_;
-    std::atomic<size_t> size_;
-};
-
 } // namespace neurorag
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+ * @file wordpiece_tokenizer.h
+ * @brief BERT WordPiece tokenization for the in-process text encoder
+ *
+ * Follows the BERT reference tokenizer: control characters are dropped,
+ * CJK ideographs become words of their own, text is split on whitespace
+ * and punctuation, optionally lowercased with accents stripped, and each
+ * word is split greedily into the longest vocabulary pieces ("##"
+ * continues a word). Case folding and accent stripping cover Latin,
+ * Greek and Cyrillic; other scripts pass through unchanged.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace neurorag {
+
+/**
+ * @brief Text -> WordPiece token ids
+ */
+class WordPieceTokenizer {
+public:
+    /**
+     * @brief Constructor
+     * @param vocab Tokens in id order; must contain [CLS], [SEP] and [UNK]
+     * @param lowercase Lowercase and strip accents (uncased models)
+     */
+    WordPieceTokenizer(const std::vector<std::string>& vocab, bool lowercase);
+
+    /**
+     * @brief Whether the vocabulary has the special tokens
+     */
+    bool valid() const { return cls_id_ >= 0 && sep_id_ >= 0 && unk_id_ >= 0; }
+
+    /**
+     * @brief Token ids of a text, [CLS] first and [SEP] last
+     * @param max_tokens Longer texts are truncated (the [SEP] is kept)
+     * @param ids Replaced with the ids
+     */
+    void encode(const std::string& text, size_t max_tokens, std::vector<int32_t>& ids) const;
+
+    /**
+     * @brief Id of a token, -1 if it is not in the vocabulary
+     */
+    int32_t token_id(const std::string& token) const;
+
+    size_t vocab_size() const { return vocab_.size(); }
+    bool lowercase() const { return lowercase_; }
+
+private:
+    std::unordered_map<std::string, int32_t> vocab_;
+    bool lowercase_;
+    int32_t cls_id_;
+    int32_t sep_id_;
+    int32_t unk_id_;
+
+    // Whitespace/punctuation split after cleaning and folding; UTF-8 words
+    void split_words(const std::string& text, std::vector<std::string>& words) const;
+
+    // Greedy longest-match pieces of one word, appended to ids
+    void append_pieces(const std::string& word, std::vector<int32_t>& ids) const;
+};
+
+} // namespace neurorag
@@ -37,6 +37,9 @@ class SearchResponse(BaseModel):
     latency_ms: float
     total_results: int
 
+class EmbedRequest(BaseModel):
+    texts: List[str]
+
 class Document(BaseModel):
     id: str
     title: str
@@ -174,6 +177,20 @@ class VectorSearchService:
                 logger.error(f"Search error: {e}")
                 raise HTTPException(status_code=500, detail=str(e))
         
+        @self.app.post("/embed")
+        async def embed_texts(request: EmbedRequest):
+            # Embedding backend of the C++ service's text search
+            if not self.embedding_model:
+                raise HTTPException(status_code=503, detail="Embedding model not available")
+            
+            try:
+                embeddings = self.embedding_model.encode(request.texts).astype(np.float32)
+                faiss.normalize_L2(embeddings)
+                return {"embeddings": embeddings.tolist()}
+            except Exception as e:
+                logger.error(f"Embedding error: {e}")
+                raise HTTPException(status_code=500, detail=str(e))
+        
         @self.app.post("/documents")
         async def add_document(document: Document):
             try:
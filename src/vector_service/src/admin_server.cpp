@@ -0,0 +1,189 @@
+/**
+ * @file admin_server.cpp
+ * @brief Operational HTTP endpoints served on a separate port
+ */
+
+#include "admin_server.h"
+#include "index_reloader.h"
+#include "readiness.h"
+#include "vector_search.h"
+
+#include <iostream>
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+
+namespace neurorag {
+
+AdminServer::AdminServer(const std::string& host, int port,
+                         VectorSearchEngine* engine, ReadinessGate* readiness)
+    : host_(host),
+      port_(port),
+      engine_(engine),
+      readiness_(readiness),
+      reloader_(nullptr),
+      server_(std::make_unique<httplib::Server>()),
+      running_(false) {
+    register_routes();
+}
+
+AdminServer::~AdminServer() {
+    stop();
+}
+
+void AdminServer::register_routes() {
+    server_->Get("/health", [this](const httplib::Request&, httplib::Response& res) {
+        bool healthy = engine_->is_healthy();
+        nlohmann::json body = {{"status", healthy ? "healthy" : "unhealthy"}};
+        res.status = healthy ? 200 : 503;
+        res.set_content(body.dump(), "application/json");
+    });
+
+    server_->Get("/ready", [this](const httplib::Request&, httplib::Response& res) {
+        nlohmann::json body = readiness_->get_status();
+        res.status = body["ready"].get<bool>() ? 200 : 503;
+        res.set_content(body.dump(), "application/json");
+    });
+
+    server_->Get("/admin/tiering", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_tiering_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/delta", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_delta_statistics().dump(), "application/json");
+    });
+
+    server_->Post("/admin/delta/merge", [this](const httplib::Request&, httplib::Response& res) {
+        bool merged = engine_->merge_delta_index();
+        nlohmann::json body = {{"merged", merged}};
+        if (merged) {
+            body["delta"] = engine_->get_delta_statistics();
+        }
+        res.status = merged ? 200 : 409;
+        res.set_content(body.dump(), "application/json");
+    });
+
+    server_->Post("/admin/index/snapshot", [this](const httplib::Request&, httplib::Response& res) {
+        bool saved = engine_->save_index_snapshot();
+        nlohmann::json body = {{"saved", saved}};
+        res.status = saved ? 200 : 500;
+        res.set_content(body.dump(), "application/json");
+    });
+
+    server_->Post("/admin/index/reload", [this](const httplib::Request& req, httplib::Response& res) {
+        if (!reloader_) {
+            res.status = 503;
+            res.set_content(R"({"error":"hot index swap is not enabled"})", "application/json");
+            return;
+        }
+        std::string path;
+        bool mmap = false;
+        try {
+            auto request = nlohmann::json::parse(req.body);
+            path = request.at("path").get<std::string>();
+            mmap = request.value("mmap", false);
+        } catch (const nlohmann::json::exception& e) {
+            res.status = 400;
+            res.set_content(nlohmann::json({{"error", e.what()}}).dump(), "application/json");
+            return;
+        }
+        bool started = reloader_->request(path, mmap);
+        nlohmann::json body = {{"started", started}, {"path", path}, {"mmap", mmap}};
+        res.status = started ? 202 : 409;
+        res.set_content(body.dump(), "application/json");
+    });
+
+    server_->Get("/admin/memory", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_memory_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/preprocessing", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_preprocessing_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/matryoshka", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_matryoshka_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/hnsw", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_filtered_hnsw_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/partitions", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_partition_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/freshness", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_freshness_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/embeddings", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_embedding_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/metadata", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(engine_->get_metadata_column_statistics().dump(), "application/json");
+    });
+
+    server_->Post("/admin/metadata/filter", [this](const httplib::Request& req, httplib::Response& res) {
+        std::string filter;
+        try {
+            filter = nlohmann::json::parse(req.body).at("filter").get<std::string>();
+        } catch (const nlohmann::json::exception& e) {
+            res.status = 400;
+            res.set_content(nlohmann::json({{"error", e.what()}}).dump(), "application/json");
+            return;
+        }
+        nlohmann::json body = engine_->explain_filter(filter);
+        res.status = body.value("valid", false) ? 200 : 400;
+        res.set_content(body.dump(), "application/json");
+    });
+
+    server_->Get("/admin/documents", [this](const httplib::Request& req, httplib::Response& res) {
+        if (req.has_param("id")) {
+            std::string external_id = req.get_param_value("id");
+            int64_t internal_id = engine_->find_document(external_id);
+            nlohmann::json body = {{"id", external_id}, {"found", internal_id >= 0}};
+            if (internal_id >= 0) {
+                body["internal_id"] = internal_id;
+            }
+            res.status = internal_id >= 0 ? 200 : 404;
+            res.set_content(body.dump(), "application/json");
+            return;
+        }
+        res.set_content(engine_->get_document_id_statistics().dump(), "application/json");
+    });
+
+    server_->Get("/admin/index/generation", [this](const httplib::Request&, httplib::Response& res) {
+        nlohmann::json body = reloader_ ? reloader_->get_status() : engine_->get_generation_statistics();
+        res.set_content(body.dump(), "application/json");
+    });
+}
+
+bool AdminServer::start() {
+    if (running_.load()) {
+        return true;
+    }
+    if (!server_->bind_to_port(host_, port_)) {
+        std::cerr << "AdminServer: cannot bind " << host_ << ":" << port_ << std::endl;
+        return false;
+    }
+
+    running_.store(true);
+    listener_thread_ = std::thread([this]() {
+        server_->listen_after_bind();
+    });
+    return true;
+}
+
+void AdminServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    server_->stop();
+    if (listener_thread_.joinable()) {
+        listener_thread_.join();
+    }
+}
+
+} // namespace neurorag
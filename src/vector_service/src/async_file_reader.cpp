@@ -0,0 +1,256 @@
+/**
+ * @file async_file_reader.cpp
+ * @brief Batched asynchronous positional reads for SSD-resident index data
+ */
+
+#include "async_file_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+#ifdef NEURORAG_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace neurorag {
+
+void* allocate_direct_io_buffer(size_t size) {
+    size_t rounded = (size + kDirectIoAlignment - 1) / kDirectIoAlignment * kDirectIoAlignment;
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, kDirectIoAlignment, rounded == 0 ? kDirectIoAlignment : rounded) != 0) {
+        return nullptr;
+    }
+    return buffer;
+}
+
+// io_uring state; stays empty (and the thread pool is used) when the build
+// has no liburing or the kernel refuses to create a ring
+struct AsyncFileReader::Ring {
+#ifdef NEURORAG_HAVE_LIBURING
+    io_uring ring;
+    std::mutex submit_mutex;
+    std::mutex flight_mutex;
+    std::condition_variable flight_condition;
+    unsigned in_flight = 0;
+    std::thread completion_thread;
+#endif
+};
+
+AsyncFileReader::AsyncFileReader(unsigned queue_depth, int fallback_threads)
+    : queue_depth_(std::max(1u, queue_depth)),
+      stopping_(false),
+      reads_submitted_(0),
+      reads_completed_(0),
+      bytes_read_(0),
+      read_errors_(0) {
+#ifdef NEURORAG_HAVE_LIBURING
+    auto ring = std::make_unique<Ring>();
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = queue_depth_ * 2;
+    int rc = io_uring_queue_init_params(queue_depth_, &ring->ring, &params);
+    if (rc == 0) {
+        ring_ = std::move(ring);
+        Ring* r = ring_.get();
+        r->completion_thread = std::thread([this, r]() {
+            while (true) {
+                io_uring_cqe* cqe = nullptr;
+                int wait_rc = io_uring_wait_cqe(&r->ring, &cqe);
+                if (wait_rc == -EINTR) {
+                    continue;
+                }
+                if (wait_rc < 0) {
+                    std::cerr << "AsyncFileReader: io_uring_wait_cqe failed: " << std::strerror(-wait_rc) << std::endl;
+                    return;
+                }
+                auto* request = static_cast<Request*>(io_uring_cqe_get_data(cqe));
+                ssize_t result = cqe->res;
+                io_uring_cqe_seen(&r->ring, cqe);
+                if (!request) {
+                    return;  // shutdown marker
+                }
+
+                // Finish a short read synchronously rather than resubmitting
+                if (result >= 0 && static_cast<size_t>(result) < request->length) {
+                    ssize_t rest = read_fully(request->fd, request->offset + result,
+                                              request->length - result,
+                                              static_cast<char*>(request->buffer) + result);
+                    result = rest < 0 ? rest : result + rest;
+                }
+                complete(*request, result);
+                delete request;
+
+                {
+                    std::lock_guard<std::mutex> lock(r->flight_mutex);
+                    --r->in_flight;
+                }
+                r->flight_condition.notify_one();
+            }
+        });
+        return;
+    }
+    std::cerr << "AsyncFileReader: io_uring unavailable (" << std::strerror(-rc)
+              << "), using pread threads" << std::endl;
+#endif
+
+    for (int i = 0; i < std::max(1, fallback_threads); ++i) {
+        workers_.emplace_back(&AsyncFileReader::worker_loop, this);
+    }
+}
+
+AsyncFileReader::~AsyncFileReader() {
+#ifdef NEURORAG_HAVE_LIBURING
+    if (ring_) {
+        Ring* r = ring_.get();
+        {
+            // Reads already queued complete before the marker is reaped
+            std::unique_lock<std::mutex> lock(r->submit_mutex);
+            io_uring_sqe* sqe = io_uring_get_sqe(&r->ring);
+            while (!sqe) {
+                io_uring_submit(&r->ring);
+                sqe = io_uring_get_sqe(&r->ring);
+            }
+            io_uring_prep_nop(sqe);
+            io_uring_sqe_set_flags(sqe, IOSQE_IO_DRAIN);
+            io_uring_sqe_set_data(sqe, nullptr);
+            io_uring_submit(&r->ring);
+        }
+        r->completion_thread.join();
+        io_uring_queue_exit(&r->ring);
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_condition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void AsyncFileReader::submit(std::vector<Request> requests) {
+    if (requests.empty()) {
+        return;
+    }
+    reads_submitted_.fetch_add(requests.size(), std::memory_order_relaxed);
+
+#ifdef NEURORAG_HAVE_LIBURING
+    if (ring_) {
+        Ring* r = ring_.get();
+        std::lock_guard<std::mutex> submit_lock(r->submit_mutex);
+        unsigned prepared = 0;
+        for (auto& request : requests) {
+            // Keep completions within the CQ ring
+            {
+                std::unique_lock<std::mutex> lock(r->flight_mutex);
+                if (r->in_flight >= queue_depth_) {
+                    lock.unlock();
+                    io_uring_submit(&r->ring);
+                    prepared = 0;
+                    lock.lock();
+                    r->flight_condition.wait(lock, [&]() { return r->in_flight < queue_depth_; });
+                }
+                ++r->in_flight;
+            }
+
+            io_uring_sqe* sqe = io_uring_get_sqe(&r->ring);
+            if (!sqe) {
+                io_uring_submit(&r->ring);
+                prepared = 0;
+                sqe = io_uring_get_sqe(&r->ring);
+            }
+            io_uring_prep_read(sqe, request.fd, request.buffer,
+                               static_cast<unsigned>(request.length), request.offset);
+            io_uring_sqe_set_data(sqe, new Request(std::move(request)));
+            ++prepared;
+        }
+        if (prepared > 0) {
+            io_uring_submit(&r->ring);
+        }
+        return;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (auto& request : requests) {
+            queue_.push_back(std::move(request));
+        }
+    }
+    if (requests.size() == 1) {
+        queue_condition_.notify_one();
+    } else {
+        queue_condition_.notify_all();
+    }
+}
+
+ssize_t AsyncFileReader::read_fully(int fd, uint64_t offset, size_t length, void* buffer) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, static_cast<char*>(buffer) + done, length - done,
+                          static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (n == 0) {
+            break;  // end of file
+        }
+        done += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+const char* AsyncFileReader::backend() const {
+    return ring_ ? "io_uring" : "threads";
+}
+
+nlohmann::json AsyncFileReader::get_statistics() const {
+    nlohmann::json stats;
+    stats["backend"] = backend();
+    stats["queue_depth"] = queue_depth_;
+    stats["reads_submitted"] = reads_submitted_.load();
+    stats["reads_completed"] = reads_completed_.load();
+    stats["bytes_read"] = bytes_read_.load();
+    stats["read_errors"] = read_errors_.load();
+    return stats;
+}
+
+void AsyncFileReader::complete(Request& request, ssize_t result) {
+    if (result < 0) {
+        read_errors_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        bytes_read_.fetch_add(static_cast<uint64_t>(result), std::memory_order_relaxed);
+    }
+    reads_completed_.fetch_add(1, std::memory_order_relaxed);
+    if (request.callback) {
+        request.callback(result);
+    }
+}
+
+void AsyncFileReader::worker_loop() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_condition_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            request = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        complete(request, read_fully(request.fd, request.offset, request.length, request.buffer));
+    }
+}
+
+} // namespace neurorag
@@ -0,0 +1,692 @@
+/**
+ * @file async_redis_client.cpp
+ * @brief Non-blocking, pipelined cache store backends for CacheManager
+ */
+
+#include "async_redis_client.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <hiredis/hiredis.h>
+#include <hiredis/async.h>
+
+namespace neurorag {
+
+namespace {
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// CacheStore
+// ---------------------------------------------------------------------------
+
+bool CacheStore::get(const std::string& key, std::string& value, std::chrono::milliseconds timeout) {
+    struct Waiter {
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool done = false;
+        bool hit = false;
+        std::string value;
+    };
+    auto waiter = std::make_shared<Waiter>();
+
+    get_async(key, [waiter](bool hit, std::string result) {
+        std::lock_guard<std::mutex> lock(waiter->mutex);
+        waiter->done = true;
+        waiter->hit = hit;
+        waiter->value = std::move(result);
+        waiter->condition.notify_one();
+    });
+
+    std::unique_lock<std::mutex> lock(waiter->mutex);
+    if (!waiter->condition.wait_for(lock, timeout, [&] { return waiter->done; })) {
+        return false;
+    }
+    if (waiter->hit) {
+        value = std::move(waiter->value);
+    }
+    return waiter->hit;
+}
+
+// ---------------------------------------------------------------------------
+// CircuitBreaker
+// ---------------------------------------------------------------------------
+
+CircuitBreaker::CircuitBreaker(int failure_threshold,
+                               std::chrono::microseconds slow_threshold,
+                               std::chrono::milliseconds cooldown)
+    : failure_threshold_(failure_threshold > 0 ? failure_threshold : 1),
+      slow_threshold_(slow_threshold),
+      cooldown_(cooldown),
+      state_(State::CLOSED),
+      consecutive_failures_(0),
+      opened_at_us_(0),
+      probe_in_flight_(false),
+      times_opened_(0) {}
+
+bool CircuitBreaker::allow_request() {
+    State state = state_.load(std::memory_order_acquire);
+    if (state == State::CLOSED) {
+        return true;
+    }
+    if (state == State::HALF_OPEN) {
+        return false;
+    }
+
+    if (now_us() - opened_at_us_.load() < std::chrono::duration_cast<std::chrono::microseconds>(cooldown_).count()) {
+        return false;
+    }
+
+    // Exactly one caller gets to probe the backend
+    bool expected = false;
+    if (probe_in_flight_.compare_exchange_strong(expected, true)) {
+        state_.store(State::HALF_OPEN, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+void CircuitBreaker::record_success(std::chrono::microseconds latency) {
+    if (latency > slow_threshold_) {
+        record_failure();
+        return;
+    }
+
+    consecutive_failures_.store(0);
+    if (state_.load(std::memory_order_acquire) == State::HALF_OPEN) {
+        probe_in_flight_.store(false);
+        state_.store(State::CLOSED, std::memory_order_release);
+    }
+}
+
+void CircuitBreaker::record_failure() {
+    if (state_.load(std::memory_order_acquire) == State::HALF_OPEN) {
+        open();
+        return;
+    }
+    if (consecutive_failures_.fetch_add(1) + 1 >= failure_threshold_ &&
+        state_.load(std::memory_order_acquire) == State::CLOSED) {
+        open();
+    }
+}
+
+void CircuitBreaker::open() {
+    opened_at_us_.store(now_us());
+    consecutive_failures_.store(0);
+    probe_in_flight_.store(false);
+    state_.store(State::OPEN, std::memory_order_release);
+    times_opened_.fetch_add(1);
+}
+
+// ---------------------------------------------------------------------------
+// AsyncRedisClient
+// ---------------------------------------------------------------------------
+
+struct AsyncRedisClient::Connection {
+    AsyncRedisClient* owner = nullptr;
+    redisAsyncContext* context = nullptr;
+    int wake_fd = -1;
+    // [0] = poll for read, [1] = poll for write; set by the hiredis event hooks
+    bool want[2] = {false, false};
+    int64_t next_connect_us = 0;
+    std::thread thread;
+
+    struct PendingGet {
+        std::string key;
+        GetCallback callback;
+    };
+
+    std::mutex mutex;
+    std::deque<PendingGet> gets;
+    std::deque<std::vector<std::string>> writes;
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+};
+
+namespace {
+
+// One MGET in flight: callbacks in key order plus its send time
+struct MgetBatch {
+    AsyncRedisClient* owner;
+    CircuitBreaker* breaker;
+    std::vector<CacheStore::GetCallback> callbacks;
+    int64_t sent_at_us;
+};
+
+// hiredis event hooks: the I/O loop polls whatever the context asked for
+void hook_add_read(void* privdata) { static_cast<bool*>(privdata)[0] = true; }
+void hook_del_read(void* privdata) { static_cast<bool*>(privdata)[0] = false; }
+void hook_add_write(void* privdata) { static_cast<bool*>(privdata)[1] = true; }
+void hook_del_write(void* privdata) { static_cast<bool*>(privdata)[1] = false; }
+void hook_cleanup(void* privdata) {
+    static_cast<bool*>(privdata)[0] = false;
+    static_cast<bool*>(privdata)[1] = false;
+}
+
+void issue_argv(redisAsyncContext* context, redisCallbackFn* callback, void* privdata,
+                const std::vector<std::string>& args, bool& ok) {
+    std::vector<const char*> argv(args.size());
+    std::vector<size_t> argvlen(args.size());
+    for (size_t i = 0; i < args.size(); ++i) {
+        argv[i] = args[i].data();
+        argvlen[i] = args[i].size();
+    }
+    ok = redisAsyncCommandArgv(context, callback, privdata, static_cast<int>(args.size()),
+                               argv.data(), argvlen.data()) == REDIS_OK;
+}
+
+} // namespace
+
+AsyncRedisClient::AsyncRedisClient(const AsyncRedisConfig& config)
+    : config_(config),
+      port_(6379),
+      database_(0),
+      next_connection_(0),
+      running_(false),
+      breaker_(config.breaker_failure_threshold,
+               std::chrono::microseconds(config.breaker_slow_threshold_us),
+               std::chrono::milliseconds(config.breaker_cooldown_ms)),
+      lookups_(0),
+      hits_(0),
+      bypassed_(0),
+      batches_(0),
+      writes_(0),
+      errors_(0) {}
+
+AsyncRedisClient::~AsyncRedisClient() {
+    stop();
+}
+
+bool AsyncRedisClient::parse_url(const std::string& url) {
+    const std::string scheme = "redis://";
+    if (url.compare(0, scheme.size(), scheme) != 0) {
+        std::cerr << "AsyncRedisClient: unsupported URL " << url << std::endl;
+        return false;
+    }
+
+    std::string rest = url.substr(scheme.size());
+    size_t at = rest.rfind('@');
+    if (at != std::string::npos) {
+        std::string credentials = rest.substr(0, at);
+        size_t colon = credentials.find(':');
+        password_ = colon == std::string::npos ? credentials : credentials.substr(colon + 1);
+        rest = rest.substr(at + 1);
+    }
+
+    size_t slash = rest.find('/');
+    if (slash != std::string::npos) {
+        std::string db = rest.substr(slash + 1);
+        database_ = db.empty() ? 0 : std::stoi(db);
+        rest = rest.substr(0, slash);
+    }
+
+    size_t colon = rest.rfind(':');
+    if (colon != std::string::npos) {
+        port_ = std::stoi(rest.substr(colon + 1));
+        rest = rest.substr(0, colon);
+    }
+    host_ = rest.empty() ? "localhost" : rest;
+    return true;
+}
+
+bool AsyncRedisClient::start() {
+    try {
+        if (!parse_url(config_.url)) {
+            return false;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "AsyncRedisClient: invalid URL " << config_.url << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    running_.store(true);
+    int pool_size = config_.pool_size > 0 ? config_.pool_size : 1;
+    for (int i = 0; i < pool_size; ++i) {
+        auto connection = std::make_unique<Connection>();
+        connection->owner = this;
+        connection->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        connections_.push_back(std::move(connection));
+    }
+    for (auto& connection : connections_) {
+        connection->thread = std::thread(&AsyncRedisClient::io_loop, this, std::ref(*connection));
+    }
+    return true;
+}
+
+void AsyncRedisClient::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& connection : connections_) {
+        connection->wake();
+    }
+    for (auto& connection : connections_) {
+        if (connection->thread.joinable()) {
+            connection->thread.join();
+        }
+        ::close(connection->wake_fd);
+    }
+    connections_.clear();
+}
+
+AsyncRedisClient::Connection& AsyncRedisClient::pick_connection() {
+    return *connections_[next_connection_.fetch_add(1, std::memory_order_relaxed) % connections_.size()];
+}
+
+void AsyncRedisClient::get_async(const std::string& key, GetCallback callback) {
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!running_.load() || !breaker_.allow_request()) {
+        bypassed_.fetch_add(1, std::memory_order_relaxed);
+        callback(false, std::string());
+        return;
+    }
+
+    Connection& connection = pick_connection();
+    bool was_idle;
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        was_idle = connection.gets.empty() && connection.writes.empty();
+        connection.gets.push_back({key, std::move(callback)});
+    }
+    if (was_idle) {
+        connection.wake();
+    }
+}
+
+void AsyncRedisClient::set_async(const std::string& key, std::string value, int ttl_seconds) {
+    if (!running_.load() || breaker_.state() != CircuitBreaker::State::CLOSED) {
+        bypassed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::vector<std::string> command;
+    if (ttl_seconds > 0) {
+        command = {"SET", key, std::move(value), "EX", std::to_string(ttl_seconds)};
+    } else {
+        command = {"SET", key, std::move(value)};
+    }
+
+    Connection& connection = pick_connection();
+    bool was_idle;
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        was_idle = connection.gets.empty() && connection.writes.empty();
+        connection.writes.push_back(std::move(command));
+    }
+    if (was_idle) {
+        connection.wake();
+    }
+}
+
+void AsyncRedisClient::delete_async(const std::vector<std::string>& keys) {
+    if (keys.empty() || !running_.load() || breaker_.state() != CircuitBreaker::State::CLOSED) {
+        return;
+    }
+
+    std::vector<std::string> command;
+    command.reserve(keys.size() + 1);
+    command.push_back("DEL");
+    command.insert(command.end(), keys.begin(), keys.end());
+
+    Connection& connection = pick_connection();
+    bool was_idle;
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        was_idle = connection.gets.empty() && connection.writes.empty();
+        connection.writes.push_back(std::move(command));
+    }
+    if (was_idle) {
+        connection.wake();
+    }
+}
+
+nlohmann::json AsyncRedisClient::get_statistics() const {
+    uint64_t lookups = lookups_.load();
+    uint64_t batches = batches_.load();
+
+    const char* state = "closed";
+    switch (breaker_.state()) {
+        case CircuitBreaker::State::OPEN: state = "open"; break;
+        case CircuitBreaker::State::HALF_OPEN: state = "half_open"; break;
+        default: break;
+    }
+
+    nlohmann::json stats;
+    stats["backend"] = "redis";
+    stats["pool_size"] = connections_.size();
+    stats["lookups"] = lookups;
+    stats["hits"] = hits_.load();
+    stats["hit_rate"] = lookups > 0 ? static_cast<double>(hits_.load()) / lookups : 0.0;
+    stats["bypassed"] = bypassed_.load();
+    stats["mget_batches"] = batches;
+    stats["average_keys_per_batch"] = batches > 0 ? static_cast<double>(lookups - bypassed_.load()) / batches : 0.0;
+    stats["writes"] = writes_.load();
+    stats["errors"] = errors_.load();
+    stats["circuit_breaker"] = state;
+    stats["circuit_breaker_trips"] = breaker_.times_opened();
+    return stats;
+}
+
+bool AsyncRedisClient::connect(Connection& connection) {
+    redisAsyncContext* context = redisAsyncConnect(host_.c_str(), port_);
+    if (!context || context->err) {
+        if (context) {
+            redisAsyncFree(context);
+        }
+        return false;
+    }
+
+    context->data = &connection;
+    context->ev.data = connection.want;
+    context->ev.addRead = hook_add_read;
+    context->ev.delRead = hook_del_read;
+    context->ev.addWrite = hook_add_write;
+    context->ev.delWrite = hook_del_write;
+    context->ev.cleanup = hook_cleanup;
+    redisAsyncSetConnectCallback(context, &AsyncRedisClient::on_connect);
+    redisAsyncSetDisconnectCallback(context, &AsyncRedisClient::on_disconnect);
+    connection.context = context;
+
+    // Commands are buffered until the non-blocking connect completes
+    bool ok = true;
+    if (!password_.empty()) {
+        issue_argv(context, &AsyncRedisClient::on_write_reply, this, {"AUTH", password_}, ok);
+    }
+    if (ok && database_ != 0) {
+        issue_argv(context, &AsyncRedisClient::on_write_reply, this, {"SELECT", std::to_string(database_)}, ok);
+    }
+
+    // hiredis waits for writability to finish connecting
+    connection.want[1] = true;
+    return ok;
+}
+
+void AsyncRedisClient::disconnect(Connection& connection) {
+    if (connection.context) {
+        // Pending replies are completed with a NULL reply, i.e. as misses
+        redisAsyncContext* context = connection.context;
+        connection.context = nullptr;
+        context->data = nullptr;
+        redisAsyncFree(context);
+    }
+    connection.want[0] = false;
+    connection.want[1] = false;
+}
+
+void AsyncRedisClient::on_connect(const redisAsyncContext* context, int status) {
+    if (status == REDIS_OK) {
+        return;
+    }
+    // A failed connect frees the context without a disconnect callback
+    auto* connection = static_cast<Connection*>(context->data);
+    if (connection) {
+        std::cerr << "AsyncRedisClient: connect to " << connection->owner->host_ << ":"
+                  << connection->owner->port_ << " failed: " << context->errstr << std::endl;
+        connection->owner->breaker_.record_failure();
+        on_disconnect(context, status);
+    }
+}
+
+void AsyncRedisClient::on_disconnect(const redisAsyncContext* context, int /*status*/) {
+    auto* connection = static_cast<Connection*>(context->data);
+    if (connection) {
+        // hiredis frees the context after this callback returns
+        connection->context = nullptr;
+        connection->want[0] = false;
+        connection->want[1] = false;
+        connection->next_connect_us = now_us() + connection->owner->config_.reconnect_interval_ms * 1000;
+    }
+}
+
+void AsyncRedisClient::io_loop(Connection& connection) {
+    while (running_.load()) {
+        if (!connection.context && now_us() >= connection.next_connect_us) {
+            if (!connect(connection)) {
+                disconnect(connection);
+                connection.next_connect_us = now_us() + config_.reconnect_interval_ms * 1000;
+                breaker_.record_failure();
+            }
+        }
+
+        struct pollfd fds[2];
+        fds[0] = {connection.wake_fd, POLLIN, 0};
+        nfds_t count = 1;
+        if (connection.context) {
+            short events = (connection.want[0] ? POLLIN : 0) | (connection.want[1] ? POLLOUT : 0);
+            fds[1] = {connection.context->c.fd, events, 0};
+            count = 2;
+        }
+
+        int timeout_ms = connection.context ? 100 : config_.reconnect_interval_ms;
+        int ready = ::poll(fds, count, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t drained;
+            ssize_t ignored = ::read(connection.wake_fd, &drained, sizeof(drained));
+            (void)ignored;
+        }
+
+        if (count == 2 && connection.context) {
+            if (fds[1].revents & (POLLIN | POLLERR | POLLHUP)) {
+                redisAsyncHandleRead(connection.context);
+            }
+            if (connection.context && (fds[1].revents & POLLOUT)) {
+                redisAsyncHandleWrite(connection.context);
+            }
+        }
+
+        flush_submissions(connection);
+    }
+
+    disconnect(connection);
+    flush_submissions(connection);
+}
+
+void AsyncRedisClient::flush_submissions(Connection& connection) {
+    std::deque<Connection::PendingGet> gets;
+    std::deque<std::vector<std::string>> writes;
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        gets.swap(connection.gets);
+        writes.swap(connection.writes);
+    }
+    if (gets.empty() && writes.empty()) {
+        return;
+    }
+
+    if (!connection.context) {
+        // No connection: lookups miss immediately, writes are dropped
+        for (auto& pending : gets) {
+            bypassed_.fetch_add(1, std::memory_order_relaxed);
+            pending.callback(false, std::string());
+        }
+        return;
+    }
+
+    while (!gets.empty()) {
+        size_t take = std::min(gets.size(), config_.max_batch_keys);
+
+        std::vector<std::string> command;
+        command.reserve(take + 1);
+        command.push_back("MGET");
+
+        auto* batch = new MgetBatch{this, &breaker_, {}, now_us()};
+        batch->callbacks.reserve(take);
+        for (size_t i = 0; i < take; ++i) {
+            command.push_back(std::move(gets.front().key));
+            batch->callbacks.push_back(std::move(gets.front().callback));
+            gets.pop_front();
+        }
+
+        bool ok = true;
+        issue_argv(connection.context, &AsyncRedisClient::on_mget_reply, batch, command, ok);
+        if (!ok) {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            for (auto& callback : batch->callbacks) {
+                callback(false, std::string());
+            }
+            delete batch;
+        } else {
+            batches_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    for (const auto& command : writes) {
+        bool ok = true;
+        issue_argv(connection.context, &AsyncRedisClient::on_write_reply, this, command, ok);
+        if (ok) {
+            writes_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncRedisClient::on_mget_reply(redisAsyncContext* /*context*/, void* reply, void* privdata) {
+    std::unique_ptr<MgetBatch> batch(static_cast<MgetBatch*>(privdata));
+    auto* owner = batch->owner;
+    auto* result = static_cast<redisReply*>(reply);
+
+    bool valid = result && result->type == REDIS_REPLY_ARRAY &&
+                 result->elements == batch->callbacks.size();
+    if (!valid) {
+        owner->errors_.fetch_add(1, std::memory_order_relaxed);
+        batch->breaker->record_failure();
+        for (auto& callback : batch->callbacks) {
+            callback(false, std::string());
+        }
+        return;
+    }
+
+    batch->breaker->record_success(std::chrono::microseconds(now_us() - batch->sent_at_us));
+    for (size_t i = 0; i < batch->callbacks.size(); ++i) {
+        const redisReply* element = result->element[i];
+        if (element && element->type == REDIS_REPLY_STRING) {
+            owner->hits_.fetch_add(1, std::memory_order_relaxed);
+            batch->callbacks[i](true, std::string(element->str, element->len));
+        } else {
+            batch->callbacks[i](false, std::string());
+        }
+    }
+}
+
+void AsyncRedisClient::on_write_reply(redisAsyncContext* /*context*/, void* reply, void* privdata) {
+    auto* owner = static_cast<AsyncRedisClient*>(privdata);
+    auto* result = static_cast<redisReply*>(reply);
+    if (!result || result->type == REDIS_REPLY_ERROR) {
+        owner->errors_.fetch_add(1, std::memory_order_relaxed);
+        owner->breaker_.record_failure();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// InMemoryCacheStore
+// ---------------------------------------------------------------------------
+
+InMemoryCacheStore::InMemoryCacheStore(size_t max_entries)
+    : max_entries_(max_entries > 0 ? max_entries : 1),
+      injected_latency_us_(0),
+      lookups_(0),
+      hits_(0),
+      evictions_(0) {}
+
+void InMemoryCacheStore::get_async(const std::string& key, GetCallback callback) {
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t latency_us = injected_latency_us_.load();
+    if (latency_us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(latency_us));
+    }
+
+    bool hit = false;
+    std::string value;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            if (it->second.expires_at > std::chrono::steady_clock::now()) {
+                hit = true;
+                value = it->second.value;
+            } else {
+                entries_.erase(it);
+            }
+        }
+    }
+
+    if (hit) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+    }
+    callback(hit, std::move(value));
+}
+
+void InMemoryCacheStore::set_async(const std::string& key, std::string value, int ttl_seconds) {
+    auto expires_at = ttl_seconds > 0
+        ? std::chrono::steady_clock::now() + std::chrono::seconds(ttl_seconds)
+        : std::chrono::steady_clock::time_point::max();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.size() >= max_entries_ && entries_.find(key) == entries_.end()) {
+        entries_.erase(entries_.begin());
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    entries_[key] = {std::move(value), expires_at};
+}
+
+void InMemoryCacheStore::delete_async(const std::vector<std::string>& keys) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& key : keys) {
+        entries_.erase(key);
+    }
+}
+
+size_t InMemoryCacheStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+nlohmann::json InMemoryCacheStore::get_statistics() const {
+    uint64_t lookups = lookups_.load();
+    nlohmann::json stats;
+    stats["backend"] = "memory";
+    stats["entries"] = size();
+    stats["max_entries"] = max_entries_;
+    stats["lookups"] = lookups;
+    stats["hits"] = hits_.load();
+    stats["hit_rate"] = lookups > 0 ? static_cast<double>(hits_.load()) / lookups : 0.0;
+    stats["evictions"] = evictions_.load();
+    return stats;
+}
+
+std::unique_ptr<CacheStore> create_cache_store(const AsyncRedisConfig& config) {
+    if (config.url.compare(0, 9, "memory://") == 0) {
+        return std::make_unique<InMemoryCacheStore>();
+    }
+
+    auto client = std::make_unique<AsyncRedisClient>(config);
+    if (!client->start()) {
+        return nullptr;
+    }
+    return client;
+}
+
+} // namespace neurorag
@@ -0,0 +1,201 @@
+/**
+ * @file checksum.cpp
+ * @brief CRC32C and xxHash64 checksums for cached and persisted data
+ */
+
+#include "checksum.h"
+
+#include <cstring>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+namespace neurorag {
+
+namespace {
+
+constexpr uint32_t kCrc32cPolynomial = 0x82F63B78u;  // reflected Castagnoli
+
+#ifndef __SSE4_2__
+struct Crc32cTable {
+    uint32_t entries[256];
+
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (kCrc32cPolynomial & (0u - (crc & 1u)));
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+const Crc32cTable& crc32c_table() {
+    static const Crc32cTable table;
+    return table;
+}
+#else
+// Bytes per stream when three streams are interleaved
+constexpr size_t kStreamBytes = 16384;
+
+// a * b modulo the CRC polynomial, both as reflected polynomials
+uint32_t multiply_mod_poly(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t bit = 1u << 31; bit != 0; bit >>= 1) {
+        if (a & bit) {
+            product ^= b;
+        }
+        b = (b & 1u) ? (b >> 1) ^ kCrc32cPolynomial : b >> 1;
+    }
+    return product;
+}
+
+// x^(8 * bytes) modulo the CRC polynomial: appending that many zero
+// bytes multiplies a CRC register by it
+uint32_t zero_bytes_operator(size_t bytes) {
+    uint32_t power = 1u << 30;       // x^1
+    uint32_t result = 1u << 31;      // x^0
+    for (size_t bits = bytes * 8; bits != 0; bits >>= 1) {
+        if (bits & 1) {
+            result = multiply_mod_poly(power, result);
+        }
+        power = multiply_mod_poly(power, power);
+    }
+    return result;
+}
+
+uint64_t crc32c_words(uint64_t crc, const uint8_t* bytes, size_t words) {
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+    }
+    return crc;
+}
+#endif
+
+inline uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t load64(const uint8_t* bytes) {
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+inline uint32_t load32(const uint8_t* bytes) {
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+constexpr uint64_t kXxPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kXxPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kXxPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kXxPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kXxPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t xx_round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * kXxPrime2;
+    return rotl64(accumulator, 31) * kXxPrime1;
+}
+
+inline uint64_t xx_merge_round(uint64_t hash, uint64_t accumulator) {
+    hash ^= xx_round(0, accumulator);
+    return hash * kXxPrime1 + kXxPrime4;
+}
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+
+#ifdef __SSE4_2__
+    uint64_t crc64 = crc;
+    if (size >= 3 * kStreamBytes) {
+        // Three independent dependency chains keep the crc32 unit busy;
+        // the second and third start from zero and are shifted into place
+        static const uint32_t shift = zero_bytes_operator(kStreamBytes);
+        constexpr size_t kStreamWords = kStreamBytes / sizeof(uint64_t);
+        while (size >= 3 * kStreamBytes) {
+            uint64_t crc_a = crc64, crc_b = 0, crc_c = 0;
+            for (size_t i = 0; i < kStreamWords; ++i) {
+                crc_a = _mm_crc32_u64(crc_a, load64(bytes + i * 8));
+                crc_b = _mm_crc32_u64(crc_b, load64(bytes + kStreamBytes + i * 8));
+                crc_c = _mm_crc32_u64(crc_c, load64(bytes + 2 * kStreamBytes + i * 8));
+            }
+            uint32_t combined = multiply_mod_poly(shift, static_cast<uint32_t>(crc_a)) ^ static_cast<uint32_t>(crc_b);
+            combined = multiply_mod_poly(shift, combined) ^ static_cast<uint32_t>(crc_c);
+            crc64 = combined;
+            bytes += 3 * kStreamBytes;
+            size -= 3 * kStreamBytes;
+        }
+    }
+    crc64 = crc32c_words(crc64, bytes, size / sizeof(uint64_t));
+    bytes += size & ~(sizeof(uint64_t) - 1);
+    size &= sizeof(uint64_t) - 1;
+    crc = static_cast<uint32_t>(crc64);
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *bytes++);
+    }
+#else
+    const auto& table = crc32c_table();
+    while (size-- > 0) {
+        crc = table.entries[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+    }
+#endif
+
+    return ~crc;
+}
+
+uint64_t xxhash64(const void* data, size_t size, uint64_t seed) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        uint64_t lanes[4] = {seed + kXxPrime1 + kXxPrime2, seed + kXxPrime2, seed, seed - kXxPrime1};
+        const uint8_t* limit = end - 32;
+        do {
+            for (int lane = 0; lane < 4; ++lane) {
+                lanes[lane] = xx_round(lanes[lane], load64(bytes + lane * 8));
+            }
+            bytes += 32;
+        } while (bytes <= limit);
+        hash = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) + rotl64(lanes[3], 18);
+        for (uint64_t lane : lanes) {
+            hash = xx_merge_round(hash, lane);
+        }
+    } else {
+        hash = seed + kXxPrime5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    while (bytes + 8 <= end) {
+        hash ^= xx_round(0, load64(bytes));
+        hash = rotl64(hash, 27) * kXxPrime1 + kXxPrime4;
+        bytes += 8;
+    }
+    if (bytes + 4 <= end) {
+        hash ^= static_cast<uint64_t>(load32(bytes)) * kXxPrime1;
+        hash = rotl64(hash, 23) * kXxPrime2 + kXxPrime3;
+        bytes += 4;
+    }
+    while (bytes < end) {
+        hash ^= static_cast<uint64_t>(*bytes++) * kXxPrime5;
+        hash = rotl64(hash, 11) * kXxPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kXxPrime2;
+    hash ^= hash >> 29;
+    hash *= kXxPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+} // namespace neurorag
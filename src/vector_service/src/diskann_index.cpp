@@ -0,0 +1,948 @@
+/**
+ * @file diskann_index.cpp
+ * @brief SSD-resident Vamana graph index (DiskANN) for billion-scale tenants
+ */
+
+#include "diskann_index.h"
+#include "checksum.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <omp.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/utils/distances.h>
+
+namespace neurorag {
+
+namespace {
+
+constexpr uint32_t kDiskAnnMagic = 0x4144524E; // "NRDA"
+constexpr uint32_t kDiskAnnVersion = 1;
+constexpr size_t kSectorBytes = kDirectIoAlignment;
+constexpr size_t kPqBits = 8;
+constexpr size_t kMaxReadBatch = 1024;
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Largest code size not above the request that divides the dimension
+size_t choose_pq_subquantizers(int d, int pq_bytes) {
+    for (int m = std::min(pq_bytes, d); m > 1; --m) {
+        if (d % m == 0) {
+            return static_cast<size_t>(m);
+        }
+    }
+    return 1;
+}
+
+// Candidate during graph traversal, kept sorted by distance
+struct Candidate {
+    float distance;
+    uint32_t node;
+    bool expanded;
+};
+
+// Insert into a bounded sorted pool; returns false if it did not make the cut
+bool insert_candidate(std::vector<Candidate>& pool, size_t capacity, Candidate candidate) {
+    if (pool.size() >= capacity && candidate.distance >= pool.back().distance) {
+        return false;
+    }
+    auto position = std::upper_bound(pool.begin(), pool.end(), candidate.distance,
+                                     [](float distance, const Candidate& c) { return distance < c.distance; });
+    pool.insert(position, candidate);
+    if (pool.size() > capacity) {
+        pool.pop_back();
+    }
+    return true;
+}
+
+// Vamana construction over vectors in memory (L2 throughout)
+class VamanaBuilder {
+public:
+    VamanaBuilder(size_t n, const float* x, int d, const DiskAnnBuildParams& params)
+        : n_(n), x_(x), d_(d), params_(params), graph_(n), locks_(kLockStripes) {}
+
+    void build() {
+        medoid_ = find_medoid();
+
+        // Random initial graph so greedy search can reach every region
+        std::mt19937_64 rng(1234);
+        size_t initial_degree = std::min<size_t>(params_.max_degree, n_ - 1);
+        for (size_t node = 0; node < n_; ++node) {
+            std::unordered_set<uint32_t> chosen;
+            while (chosen.size() < initial_degree) {
+                uint32_t neighbor = static_cast<uint32_t>(rng() % n_);
+                if (neighbor != node) {
+                    chosen.insert(neighbor);
+                }
+            }
+            graph_[node].assign(chosen.begin(), chosen.end());
+        }
+
+        // Pass 1 with alpha = 1 gives short edges; pass 2 adds long-range ones
+        std::vector<uint32_t> order(n_);
+        std::iota(order.begin(), order.end(), 0u);
+        for (float alpha : {1.0f, params_.alpha}) {
+            std::shuffle(order.begin(), order.end(), rng);
+            std::atomic<size_t> done{0};
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (size_t i = 0; i < n_; ++i) {
+                insert_node(order[i], alpha);
+                size_t completed = done.fetch_add(1) + 1;
+                if (completed % 100000 == 0) {
+                    #pragma omp critical
+                    std::cout << "DiskANN build: alpha " << alpha << ", " << completed << "/" << n_ << std::endl;
+                }
+            }
+        }
+    }
+
+    uint32_t medoid() const { return medoid_; }
+    const std::vector<uint32_t>& neighbors(size_t node) const { return graph_[node]; }
+
+private:
+    static constexpr size_t kLockStripes = 4096;
+
+    size_t n_;
+    const float* x_;
+    int d_;
+    DiskAnnBuildParams params_;
+    uint32_t medoid_ = 0;
+    std::vector<std::vector<uint32_t>> graph_;
+    std::vector<std::mutex> locks_;
+
+    const float* vector(uint32_t node) const { return x_ + static_cast<size_t>(node) * d_; }
+    std::mutex& lock_of(uint32_t node) { return locks_[node % kLockStripes]; }
+
+    float l2(uint32_t a, const float* b) const { return faiss::fvec_L2sqr(vector(a), b, d_); }
+
+    uint32_t find_medoid() const {
+        std::vector<double> centroid(d_, 0.0);
+        for (size_t node = 0; node < n_; ++node) {
+            for (int j = 0; j < d_; ++j) {
+                centroid[j] += x_[node * d_ + j];
+            }
+        }
+        std::vector<float> mean(d_);
+        for (int j = 0; j < d_; ++j) {
+            mean[j] = static_cast<float>(centroid[j] / n_);
+        }
+        uint32_t best = 0;
+        float best_distance = std::numeric_limits<float>::max();
+        for (size_t node = 0; node < n_; ++node) {
+            float distance = l2(static_cast<uint32_t>(node), mean.data());
+            if (distance < best_distance) {
+                best_distance = distance;
+                best = static_cast<uint32_t>(node);
+            }
+        }
+        return best;
+    }
+
+    // Greedy search from the medoid; returns every expanded node
+    std::vector<Candidate> greedy_search(const float* query) {
+        size_t capacity = static_cast<size_t>(params_.build_list_size);
+        std::vector<Candidate> pool;
+        std::vector<Candidate> expanded;
+        std::unordered_set<uint32_t> visited;
+        pool.push_back({l2(medoid_, query), medoid_, false});
+        visited.insert(medoid_);
+
+        std::vector<uint32_t> adjacency;
+        while (true) {
+            auto next = std::find_if(pool.begin(), pool.end(), [](const Candidate& c) { return !c.expanded; });
+            if (next == pool.end()) {
+                break;
+            }
+            next->expanded = true;
+            Candidate current = *next;
+            expanded.push_back(current);
+            {
+                std::lock_guard<std::mutex> lock(lock_of(current.node));
+                adjacency = graph_[current.node];
+            }
+            for (uint32_t neighbor : adjacency) {
+                if (visited.insert(neighbor).second) {
+                    insert_candidate(pool, capacity, {l2(neighbor, query), neighbor, false});
+                }
+            }
+        }
+        return expanded;
+    }
+
+    // Keep the closest candidates that are not alpha-dominated by one already kept
+    std::vector<uint32_t> robust_prune(uint32_t node, std::vector<Candidate> candidates, float alpha) const {
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+        candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                     [](const Candidate& a, const Candidate& b) { return a.node == b.node; }),
+                         candidates.end());
+
+        std::vector<uint32_t> kept;
+        std::vector<bool> dominated(candidates.size(), false);
+        for (size_t i = 0; i < candidates.size() && kept.size() < static_cast<size_t>(params_.max_degree); ++i) {
+            if (dominated[i] || candidates[i].node == node) {
+                continue;
+            }
+            kept.push_back(candidates[i].node);
+            const float* chosen = vector(candidates[i].node);
+            for (size_t j = i + 1; j < candidates.size(); ++j) {
+                if (!dominated[j] && alpha * l2(candidates[j].node, chosen) <= candidates[j].distance) {
+                    dominated[j] = true;
+                }
+            }
+        }
+        return kept;
+    }
+
+    std::vector<Candidate> with_distances(uint32_t node, const std::vector<uint32_t>& nodes) const {
+        std::vector<Candidate> candidates;
+        candidates.reserve(nodes.size());
+        for (uint32_t other : nodes) {
+            candidates.push_back({l2(other, vector(node)), other, false});
+        }
+        return candidates;
+    }
+
+    void insert_node(uint32_t node, float alpha) {
+        std::vector<Candidate> candidates = greedy_search(vector(node));
+        {
+            std::lock_guard<std::mutex> lock(lock_of(node));
+            for (const Candidate& c : with_distances(node, graph_[node])) {
+                candidates.push_back(c);
+            }
+        }
+        std::vector<uint32_t> pruned = robust_prune(node, std::move(candidates), alpha);
+        {
+            std::lock_guard<std::mutex> lock(lock_of(node));
+            graph_[node] = pruned;
+        }
+
+        // Back edges, pruning neighbours that overflow
+        for (uint32_t neighbor : pruned) {
+            std::lock_guard<std::mutex> lock(lock_of(neighbor));
+            auto& adjacency = graph_[neighbor];
+            if (std::find(adjacency.begin(), adjacency.end(), node) != adjacency.end()) {
+                continue;
+            }
+            if (adjacency.size() < static_cast<size_t>(params_.max_degree)) {
+                adjacency.push_back(node);
+            } else {
+                std::vector<uint32_t> extended = adjacency;
+                extended.push_back(node);
+                adjacency = robust_prune(neighbor, with_distances(neighbor, extended), alpha);
+            }
+        }
+    }
+};
+
+// Completion barrier for one batch of node reads
+struct ReadBatch {
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t remaining = 0;
+    size_t failed = 0;
+};
+
+} // namespace
+
+#pragma pack(push, 1)
+struct DiskAnnIndex::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t metric;
+    uint64_t num_nodes;
+    uint32_t max_degree;
+    uint32_t medoid;
+    uint64_t node_bytes;
+    uint64_t nodes_per_sector;
+    uint64_t read_bytes;
+    uint32_t pq_m;
+    uint32_t pq_nbits;
+    uint64_t pq_offset;
+    uint64_t codes_offset;
+    uint64_t ids_offset;
+    uint64_t data_offset;
+    uint32_t metadata_crc;  // over centroids, codes and ids
+    uint32_t reserved;
+};
+#pragma pack(pop)
+
+bool DiskAnnIndex::build(size_t n, const float* x, const faiss::idx_t* ids, int d,
+                         faiss::MetricType metric, const DiskAnnBuildParams& params,
+                         const std::string& path) {
+    if (n < 2 || d <= 0) {
+        std::cerr << "DiskAnnIndex: need at least two vectors to build" << std::endl;
+        return false;
+    }
+    auto start_time = std::chrono::steady_clock::now();
+
+    // PQ codes for navigation, trained on a sample
+    size_t pq_m = choose_pq_subquantizers(d, params.pq_bytes);
+    faiss::ProductQuantizer pq(d, pq_m, kPqBits);
+    {
+        size_t sample_size = std::min(n, std::max<size_t>(params.pq_training_size, 256 * 39));
+        std::vector<float> sample;
+        const float* training = x;
+        if (sample_size < n) {
+            std::mt19937_64 rng(42);
+            sample.resize(sample_size * d);
+            for (size_t i = 0; i < sample_size; ++i) {
+                size_t source = rng() % n;
+                std::memcpy(&sample[i * d], x + source * d, d * sizeof(float));
+            }
+            training = sample.data();
+        }
+        pq.train(sample_size, training);
+    }
+    std::vector<uint8_t> codes(n * pq.code_size);
+    #pragma omp parallel for schedule(static)
+    for (size_t begin = 0; begin < n; begin += 4096) {
+        size_t count = std::min<size_t>(4096, n - begin);
+        pq.compute_codes(x + begin * d, codes.data() + begin * pq.code_size, count);
+    }
+
+    VamanaBuilder builder(n, x, d, params);
+    builder.build();
+
+    std::vector<faiss::idx_t> labels(n);
+    for (size_t i = 0; i < n; ++i) {
+        labels[i] = ids ? ids[i] : static_cast<faiss::idx_t>(i);
+    }
+
+    // Geometry: several nodes per sector when they fit, else whole sectors per node
+    uint32_t max_degree = static_cast<uint32_t>(params.max_degree);
+    size_t node_bytes = d * sizeof(float) + sizeof(uint32_t) + max_degree * sizeof(uint32_t);
+    size_t nodes_per_sector = node_bytes <= kSectorBytes ? kSectorBytes / node_bytes : 0;
+    size_t read_bytes = nodes_per_sector > 0 ? kSectorBytes : align_up(node_bytes, kSectorBytes);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = kDiskAnnMagic;
+    header.version = kDiskAnnVersion;
+    header.dimension = static_cast<uint32_t>(d);
+    header.metric = static_cast<uint32_t>(metric);
+    header.num_nodes = n;
+    header.max_degree = max_degree;
+    header.medoid = builder.medoid();
+    header.node_bytes = node_bytes;
+    header.nodes_per_sector = nodes_per_sector;
+    header.read_bytes = read_bytes;
+    header.pq_m = static_cast<uint32_t>(pq.M);
+    header.pq_nbits = static_cast<uint32_t>(pq.nbits);
+    header.pq_offset = sizeof(Header);
+    header.codes_offset = header.pq_offset + pq.centroids.size() * sizeof(float);
+    header.ids_offset = header.codes_offset + codes.size();
+    header.data_offset = align_up(header.ids_offset + labels.size() * sizeof(faiss::idx_t), kSectorBytes);
+    uint32_t crc = crc32c(pq.centroids.data(), pq.centroids.size() * sizeof(float));
+    crc = crc32c(codes.data(), codes.size(), crc);
+    header.metadata_crc = crc32c(labels.data(), labels.size() * sizeof(faiss::idx_t), crc);
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "DiskAnnIndex: cannot write " << temp_path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(pq.centroids.data()), pq.centroids.size() * sizeof(float));
+        file.write(reinterpret_cast<const char*>(codes.data()), codes.size());
+        file.write(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(faiss::idx_t));
+        std::vector<char> padding(header.data_offset - (header.ids_offset + labels.size() * sizeof(faiss::idx_t)), 0);
+        file.write(padding.data(), padding.size());
+
+        // One sector (or multi-sector node) at a time
+        std::vector<uint8_t> block(read_bytes);
+        size_t per_block = nodes_per_sector > 0 ? nodes_per_sector : 1;
+        for (size_t first = 0; first < n; first += per_block) {
+            std::fill(block.begin(), block.end(), 0);
+            for (size_t node = first; node < std::min(n, first + per_block); ++node) {
+                uint8_t* record = block.data() + (node - first) * node_bytes;
+                const auto& neighbors = builder.neighbors(node);
+                uint32_t degree = static_cast<uint32_t>(neighbors.size());
+                std::memcpy(record, x + node * d, d * sizeof(float));
+                std::memcpy(record + d * sizeof(float), &degree, sizeof(degree));
+                std::memcpy(record + d * sizeof(float) + sizeof(degree), neighbors.data(),
+                            neighbors.size() * sizeof(uint32_t));
+            }
+            file.write(reinterpret_cast<const char*>(block.data()), block.size());
+        }
+
+        if (!file.flush()) {
+            std::cerr << "DiskAnnIndex: write to " << temp_path << " failed" << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "DiskAnnIndex: cannot rename " << temp_path << " to " << path << std::endl;
+        return false;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "DiskAnnIndex: built " << n << " nodes (R=" << max_degree << ", PQ " << pq.M
+              << " bytes) in " << elapsed << " s" << std::endl;
+    return true;
+}
+
+DiskAnnIndex::DiskAnnIndex(int d, faiss::MetricType metric)
+    : faiss::Index(d, metric),
+      fd_(-1),
+      num_nodes_(0),
+      max_degree_(0),
+      medoid_(0),
+      node_bytes_(0),
+      nodes_per_sector_(0),
+      read_bytes_(0),
+      data_offset_(0),
+      search_list_size_(100),
+      beam_width_(4),
+      deleted_count_(0),
+      next_id_(0),
+      queries_(0),
+      hops_(0),
+      ssd_reads_(0),
+      cache_hits_(0),
+      read_failures_(0) {
+}
+
+DiskAnnIndex::~DiskAnnIndex() {
+    // Drain the reader before closing the descriptor its reads use
+    reader_.reset();
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+std::unique_ptr<DiskAnnIndex> DiskAnnIndex::load(const std::string& path,
+                                                 std::shared_ptr<AsyncFileReader> reader,
+                                                 size_t cached_nodes) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "DiskAnnIndex: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+    }
+
+    // The in-RAM sections sit before data_offset, which is sector aligned
+    Header header;
+    std::unique_ptr<uint8_t, decltype(&free)> first(
+        static_cast<uint8_t*>(allocate_direct_io_buffer(kSectorBytes)), &free);
+    if (!first || AsyncFileReader::read_fully(fd, 0, kSectorBytes, first.get()) != static_cast<ssize_t>(kSectorBytes)) {
+        std::cerr << "DiskAnnIndex: " << path << " is truncated" << std::endl;
+        close(fd);
+        return nullptr;
+    }
+    std::memcpy(&header, first.get(), sizeof(header));
+    if (header.magic != kDiskAnnMagic || header.version != kDiskAnnVersion || header.num_nodes == 0 ||
+        header.data_offset % kSectorBytes != 0) {
+        std::cerr << "DiskAnnIndex: " << path << " is not a DiskANN index" << std::endl;
+        close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<uint8_t, decltype(&free)> head(
+        static_cast<uint8_t*>(allocate_direct_io_buffer(header.data_offset)), &free);
+    if (!head || AsyncFileReader::read_fully(fd, 0, header.data_offset, head.get()) !=
+                     static_cast<ssize_t>(header.data_offset)) {
+        std::cerr << "DiskAnnIndex: " << path << " is truncated" << std::endl;
+        close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<DiskAnnIndex> index(new DiskAnnIndex(static_cast<int>(header.dimension),
+                                                         static_cast<faiss::MetricType>(header.metric)));
+    index->path_ = path;
+    index->fd_ = fd;
+    index->reader_ = std::move(reader);
+    index->num_nodes_ = header.num_nodes;
+    index->max_degree_ = header.max_degree;
+    index->medoid_ = header.medoid;
+    index->node_bytes_ = header.node_bytes;
+    index->nodes_per_sector_ = header.nodes_per_sector;
+    index->read_bytes_ = header.read_bytes;
+    index->data_offset_ = header.data_offset;
+
+    index->pq_ = faiss::ProductQuantizer(header.dimension, header.pq_m, header.pq_nbits);
+    size_t centroid_bytes = index->pq_.centroids.size() * sizeof(float);
+    size_t code_bytes = header.num_nodes * index->pq_.code_size;
+    size_t id_bytes = header.num_nodes * sizeof(faiss::idx_t);
+    if (header.codes_offset != header.pq_offset + centroid_bytes ||
+        header.ids_offset != header.codes_offset + code_bytes ||
+        header.ids_offset + id_bytes > header.data_offset) {
+        std::cerr << "DiskAnnIndex: " << path << " has an inconsistent header" << std::endl;
+        return nullptr;
+    }
+    uint32_t crc = crc32c(head.get() + header.pq_offset, centroid_bytes + code_bytes + id_bytes);
+    if (crc != header.metadata_crc) {
+        std::cerr << "DiskAnnIndex: " << path << " failed its checksum" << std::endl;
+        return nullptr;
+    }
+    std::memcpy(index->pq_.centroids.data(), head.get() + header.pq_offset, centroid_bytes);
+    index->pq_codes_.assign(head.get() + header.codes_offset, head.get() + header.codes_offset + code_bytes);
+    index->ids_.resize(header.num_nodes);
+    std::memcpy(index->ids_.data(), head.get() + header.ids_offset, id_bytes);
+
+    index->deleted_.reset(new std::atomic<bool>[header.num_nodes]);
+    index->node_of_id_.reserve(header.num_nodes);
+    faiss::idx_t max_id = -1;
+    for (size_t node = 0; node < header.num_nodes; ++node) {
+        index->deleted_[node].store(false, std::memory_order_relaxed);
+        index->node_of_id_[index->ids_[node]] = static_cast<uint32_t>(node);
+        max_id = std::max(max_id, index->ids_[node]);
+    }
+    index->next_id_ = max_id + 1;
+    index->ntotal = static_cast<faiss::idx_t>(header.num_nodes);
+    index->is_trained = true;
+
+    index->load_cache(cached_nodes);
+
+    std::cout << "DiskAnnIndex: " << header.num_nodes << " nodes from " << path << ", "
+              << index->cached_slot_.size() << " cached, "
+              << (index->pq_codes_.size() + id_bytes) / (1024 * 1024) << " MB in RAM, "
+              << index->reader_->backend() << " reads" << std::endl;
+    return index;
+}
+
+void DiskAnnIndex::set_search_defaults(int search_list_size, int beam_width) {
+    search_list_size_ = std::max(1, search_list_size);
+    beam_width_ = std::max(1, beam_width);
+}
+
+uint64_t DiskAnnIndex::node_offset(uint32_t node) const {
+    if (nodes_per_sector_ > 0) {
+        return data_offset_ + (node / nodes_per_sector_) * kSectorBytes;
+    }
+    return data_offset_ + static_cast<uint64_t>(node) * read_bytes_;
+}
+
+size_t DiskAnnIndex::node_offset_in_read(uint32_t node) const {
+    return nodes_per_sector_ > 0 ? (node % nodes_per_sector_) * node_bytes_ : 0;
+}
+
+bool DiskAnnIndex::read_nodes_sync(const std::vector<uint32_t>& nodes, std::vector<uint8_t>& out) const {
+    out.resize(nodes.size() * node_bytes_);
+    bool ok = true;
+
+    for (size_t begin = 0; begin < nodes.size(); begin += kMaxReadBatch) {
+        size_t count = std::min(kMaxReadBatch, nodes.size() - begin);
+        std::unique_ptr<uint8_t, decltype(&free)> buffer(
+            static_cast<uint8_t*>(allocate_direct_io_buffer(count * read_bytes_)), &free);
+        if (!buffer) {
+            return false;
+        }
+
+        auto batch = std::make_shared<ReadBatch>();
+        batch->remaining = count;
+        std::vector<AsyncFileReader::Request> requests;
+        requests.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            size_t expected = read_bytes_;
+            requests.push_back({fd_, node_offset(nodes[begin + i]), read_bytes_, buffer.get() + i * read_bytes_,
+                [batch, expected](ssize_t result) {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    if (result != static_cast<ssize_t>(expected)) {
+                        ++batch->failed;
+                    }
+                    if (--batch->remaining == 0) {
+                        batch->condition.notify_one();
+                    }
+                }});
+        }
+        reader_->submit(std::move(requests));
+        ssd_reads_.fetch_add(count, std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->condition.wait(lock, [&batch]() { return batch->remaining == 0; });
+        if (batch->failed > 0) {
+            read_failures_.fetch_add(batch->failed, std::memory_order_relaxed);
+            ok = false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(out.data() + (begin + i) * node_bytes_,
+                        buffer.get() + i * read_bytes_ + node_offset_in_read(nodes[begin + i]),
+                        node_bytes_);
+        }
+    }
+    return ok;
+}
+
+void DiskAnnIndex::load_cache(size_t cached_nodes) {
+    // Breadth-first from the medoid: the first hops of every search
+    cached_nodes = std::min(cached_nodes, num_nodes_);
+    std::unordered_set<uint32_t> seen{medoid_};
+    std::vector<uint32_t> frontier{medoid_};
+    std::vector<uint8_t> records;
+    cached_nodes_.reserve(cached_nodes * node_bytes_);
+
+    while (!frontier.empty() && cached_slot_.size() < cached_nodes) {
+        if (frontier.size() > cached_nodes - cached_slot_.size()) {
+            frontier.resize(cached_nodes - cached_slot_.size());
+        }
+        if (!read_nodes_sync(frontier, records)) {
+            std::cerr << "DiskAnnIndex: node cache load failed" << std::endl;
+            return;
+        }
+
+        std::vector<uint32_t> next;
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            const uint8_t* record = records.data() + i * node_bytes_;
+            cached_slot_[frontier[i]] = cached_nodes_.size();
+            cached_nodes_.insert(cached_nodes_.end(), record, record + node_bytes_);
+
+            uint32_t degree;
+            std::memcpy(&degree, record + d * sizeof(float), sizeof(degree));
+            const uint32_t* neighbors = reinterpret_cast<const uint32_t*>(record + d * sizeof(float) + sizeof(degree));
+            for (uint32_t j = 0; j < std::min(degree, max_degree_); ++j) {
+                if (neighbors[j] < num_nodes_ && seen.insert(neighbors[j]).second) {
+                    next.push_back(neighbors[j]);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+}
+
+float DiskAnnIndex::distance(const float* a, const float* b) const {
+    if (metric_type == faiss::METRIC_INNER_PRODUCT) {
+        return -faiss::fvec_inner_product(a, b, d);
+    }
+    return faiss::fvec_L2sqr(a, b, d);
+}
+
+void DiskAnnIndex::search_graph(const float* query, size_t k, int search_list_size, int beam_width,
+                                const faiss::IDSelector* sel,
+                                std::vector<std::pair<float, faiss::idx_t>>& results) const {
+    // PQ lookup table; inner products are negated so smaller is better
+    size_t ksub = pq_.ksub;
+    std::vector<float> table(pq_.M * ksub);
+    bool inner_product = metric_type == faiss::METRIC_INNER_PRODUCT;
+    if (inner_product) {
+        pq_.compute_inner_prod_table(query, table.data());
+    } else {
+        pq_.compute_distance_table(query, table.data());
+    }
+    auto pq_distance = [&](uint32_t node) {
+        const uint8_t* code = pq_codes_.data() + static_cast<size_t>(node) * pq_.code_size;
+        float sum = 0.0f;
+        for (size_t m = 0; m < pq_.M; ++m) {
+            sum += table[m * ksub + code[m]];
+        }
+        return inner_product ? -sum : sum;
+    };
+
+    size_t capacity = std::max<size_t>(search_list_size, k);
+    std::vector<Candidate> pool;
+    pool.reserve(capacity + 1);
+    std::unordered_set<uint32_t> visited;
+    visited.reserve(capacity * 8);
+    pool.push_back({pq_distance(medoid_), medoid_, false});
+    visited.insert(medoid_);
+
+    std::vector<uint32_t> beam;
+    std::vector<uint32_t> to_read;
+    std::vector<uint8_t> records;
+    uint64_t hops = 0;
+    uint64_t cache_hits = 0;
+
+    while (true) {
+        beam.clear();
+        for (Candidate& candidate : pool) {
+            if (!candidate.expanded) {
+                candidate.expanded = true;
+                beam.push_back(candidate.node);
+                if (beam.size() >= static_cast<size_t>(beam_width)) {
+                    break;
+                }
+            }
+        }
+        if (beam.empty()) {
+            break;
+        }
+        ++hops;
+
+        // One batch of reads for every uncached node of this hop
+        to_read.clear();
+        for (uint32_t node : beam) {
+            if (cached_slot_.count(node) == 0) {
+                to_read.push_back(node);
+            }
+        }
+        cache_hits += beam.size() - to_read.size();
+        if (!to_read.empty() && !read_nodes_sync(to_read, records)) {
+            continue;  // drop this hop's nodes; failures are counted
+        }
+
+        size_t read_index = 0;
+        for (uint32_t node : beam) {
+            const uint8_t* record;
+            auto cached = cached_slot_.find(node);
+            if (cached != cached_slot_.end()) {
+                record = cached_nodes_.data() + cached->second;
+            } else {
+                record = records.data() + (read_index++) * node_bytes_;
+            }
+
+            // Re-rank with the full vector that came with the node
+            const float* vector = reinterpret_cast<const float*>(record);
+            if (!deleted_[node].load(std::memory_order_relaxed) && (!sel || sel->is_member(ids_[node]))) {
+                results.emplace_back(distance(query, vector), ids_[node]);
+            }
+
+            uint32_t degree;
+            std::memcpy(&degree, record + d * sizeof(float), sizeof(degree));
+            const uint32_t* neighbors = reinterpret_cast<const uint32_t*>(record + d * sizeof(float) + sizeof(degree));
+            for (uint32_t j = 0; j < std::min(degree, max_degree_); ++j) {
+                uint32_t neighbor = neighbors[j];
+                if (neighbor < num_nodes_ && visited.insert(neighbor).second) {
+                    insert_candidate(pool, capacity, {pq_distance(neighbor), neighbor, false});
+                }
+            }
+        }
+    }
+
+    hops_.fetch_add(hops, std::memory_order_relaxed);
+    cache_hits_.fetch_add(cache_hits, std::memory_order_relaxed);
+}
+
+void DiskAnnIndex::search_staged(const float* query, const faiss::IDSelector* sel,
+                                 std::vector<std::pair<float, faiss::idx_t>>& results) const {
+    std::lock_guard<std::mutex> lock(staging_mutex_);
+    for (size_t i = 0; i < staged_ids_.size(); ++i) {
+        if (!sel || sel->is_member(staged_ids_[i])) {
+            results.emplace_back(distance(query, staged_vectors_.data() + i * d), staged_ids_[i]);
+        }
+    }
+}
+
+void DiskAnnIndex::search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                          const faiss::SearchParameters* params) const {
+    int search_list_size = search_list_size_;
+    int beam_width = beam_width_;
+    const faiss::IDSelector* sel = params ? params->sel : nullptr;
+    if (auto* disk_params = dynamic_cast<const DiskAnnSearchParameters*>(params)) {
+        search_list_size = disk_params->search_list_size > 0 ? disk_params->search_list_size : search_list_size;
+        beam_width = disk_params->beam_width > 0 ? disk_params->beam_width : beam_width;
+    }
+    bool inner_product = metric_type == faiss::METRIC_INNER_PRODUCT;
+
+    // Each query blocks on its own reads, so queries run concurrently
+    #pragma omp parallel for schedule(dynamic) if (n > 1)
+    for (faiss::idx_t q = 0; q < n; ++q) {
+        const float* query = x + q * d;
+        std::vector<std::pair<float, faiss::idx_t>> results;
+        if (num_nodes_ > 0) {
+            search_graph(query, static_cast<size_t>(k), search_list_size, beam_width, sel, results);
+        }
+        search_staged(query, sel, results);
+
+        size_t found = std::min(results.size(), static_cast<size_t>(k));
+        std::partial_sort(results.begin(), results.begin() + found, results.end());
+        for (faiss::idx_t i = 0; i < k; ++i) {
+            if (static_cast<size_t>(i) < found) {
+                distances[q * k + i] = inner_product ? -results[i].first : results[i].first;
+                labels[q * k + i] = results[i].second;
+            } else {
+                distances[q * k + i] = inner_product ? -std::numeric_limits<float>::max()
+                                                     : std::numeric_limits<float>::max();
+                labels[q * k + i] = -1;
+            }
+        }
+    }
+    queries_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+}
+
+void DiskAnnIndex::add(faiss::idx_t n, const float* x) {
+    std::vector<faiss::idx_t> xids(n);
+    {
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        for (faiss::idx_t i = 0; i < n; ++i) {
+            xids[i] = next_id_ + i;
+        }
+    }
+    add_with_ids(n, x, xids.data());
+}
+
+void DiskAnnIndex::add_with_ids(faiss::idx_t n, const float* x, const faiss::idx_t* xids) {
+    std::lock_guard<std::mutex> lock(staging_mutex_);
+    staged_vectors_.insert(staged_vectors_.end(), x, x + n * d);
+    staged_ids_.insert(staged_ids_.end(), xids, xids + n);
+    for (faiss::idx_t i = 0; i < n; ++i) {
+        next_id_ = std::max(next_id_, xids[i] + 1);
+    }
+    ntotal += n;
+}
+
+void DiskAnnIndex::reset() {
+    std::lock_guard<std::mutex> lock(staging_mutex_);
+    for (size_t node = 0; node < num_nodes_; ++node) {
+        deleted_[node].store(true, std::memory_order_relaxed);
+    }
+    deleted_count_.store(num_nodes_);
+    staged_vectors_.clear();
+    staged_ids_.clear();
+    ntotal = 0;
+}
+
+size_t DiskAnnIndex::remove_ids(const faiss::IDSelector& sel) {
+    std::lock_guard<std::mutex> lock(staging_mutex_);
+    size_t removed = 0;
+    for (size_t node = 0; node < num_nodes_; ++node) {
+        if (!deleted_[node].load(std::memory_order_relaxed) && sel.is_member(ids_[node])) {
+            deleted_[node].store(true, std::memory_order_relaxed);
+            ++removed;
+        }
+    }
+    deleted_count_.fetch_add(removed);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < staged_ids_.size(); ++i) {
+        if (sel.is_member(staged_ids_[i])) {
+            ++removed;
+            continue;
+        }
+        if (kept != i) {
+            staged_ids_[kept] = staged_ids_[i];
+            std::memcpy(&staged_vectors_[kept * d], &staged_vectors_[i * d], d * sizeof(float));
+        }
+        ++kept;
+    }
+    staged_ids_.resize(kept);
+    staged_vectors_.resize(kept * d);
+
+    ntotal -= static_cast<faiss::idx_t>(removed);
+    return removed;
+}
+
+void DiskAnnIndex::reconstruct(faiss::idx_t key, float* recons) const {
+    {
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        auto staged = std::find(staged_ids_.begin(), staged_ids_.end(), key);
+        if (staged != staged_ids_.end()) {
+            size_t i = staged - staged_ids_.begin();
+            std::memcpy(recons, &staged_vectors_[i * d], d * sizeof(float));
+            return;
+        }
+    }
+
+    auto it = node_of_id_.find(key);
+    if (it == node_of_id_.end() || deleted_[it->second].load(std::memory_order_relaxed)) {
+        throw faiss::FaissException("DiskAnnIndex: id " + std::to_string(key) + " not found");
+    }
+    std::vector<uint8_t> record;
+    if (!read_nodes_sync({it->second}, record)) {
+        throw faiss::FaissException("DiskAnnIndex: cannot read node for id " + std::to_string(key));
+    }
+    std::memcpy(recons, record.data(), d * sizeof(float));
+}
+
+bool DiskAnnIndex::rebuild(const std::string& path, const DiskAnnBuildParams& params) const {
+    // Gather live vectors: sequential node reads, then the staged ones
+    std::vector<float> vectors;
+    std::vector<faiss::idx_t> labels;
+    std::vector<uint32_t> nodes;
+    std::vector<uint8_t> records;
+    for (size_t begin = 0; begin < num_nodes_; begin += kMaxReadBatch) {
+        nodes.clear();
+        for (size_t node = begin; node < std::min(num_nodes_, begin + kMaxReadBatch); ++node) {
+            if (!deleted_[node].load(std::memory_order_relaxed)) {
+                nodes.push_back(static_cast<uint32_t>(node));
+            }
+        }
+        if (!read_nodes_sync(nodes, records)) {
+            std::cerr << "DiskAnnIndex: rebuild could not read " << path_ << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const float* vector = reinterpret_cast<const float*>(records.data() + i * node_bytes_);
+            vectors.insert(vectors.end(), vector, vector + d);
+            labels.push_back(ids_[nodes[i]]);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        vectors.insert(vectors.end(), staged_vectors_.begin(), staged_vectors_.end());
+        labels.insert(labels.end(), staged_ids_.begin(), staged_ids_.end());
+    }
+    return build(labels.size(), vectors.data(), labels.data(), d, metric_type, params, path);
+}
+
+std::vector<MemoryRegion> DiskAnnIndex::memory_regions() const {
+    std::vector<MemoryRegion> regions;
+    regions.push_back({pq_.centroids.data(), pq_.centroids.size() * sizeof(float)});
+    regions.push_back({pq_codes_.data(), pq_codes_.size()});
+    regions.push_back({ids_.data(), ids_.size() * sizeof(faiss::idx_t)});
+    if (!cached_nodes_.empty()) {
+        regions.push_back({cached_nodes_.data(), cached_nodes_.size()});
+    }
+    return regions;
+}
+
+nlohmann::json DiskAnnIndex::get_statistics() const {
+    uint64_t queries = queries_.load();
+    nlohmann::json stats;
+    stats["path"] = path_;
+    stats["nodes"] = num_nodes_;
+    stats["deleted_nodes"] = deleted_count_.load();
+    {
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        stats["staged_vectors"] = staged_ids_.size();
+    }
+    stats["max_degree"] = max_degree_;
+    stats["pq_bytes"] = pq_.code_size;
+    stats["cached_nodes"] = cached_slot_.size();
+    stats["search_list_size"] = search_list_size_;
+    stats["beam_width"] = beam_width_;
+    stats["queries"] = queries;
+    stats["ssd_reads"] = ssd_reads_.load();
+    stats["cache_hits"] = cache_hits_.load();
+    stats["read_failures"] = read_failures_.load();
+    stats["hops_per_query"] = queries > 0 ? static_cast<double>(hops_.load()) / queries : 0.0;
+    stats["ssd_reads_per_query"] = queries > 0 ? static_cast<double>(ssd_reads_.load()) / queries : 0.0;
+    stats["reader"] = reader_->get_statistics();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::load_disk_index(const std::string& path, size_t cached_nodes,
+                                         int search_list_size, int beam_width) {
+    auto index = DiskAnnIndex::load(path, std::make_shared<AsyncFileReader>(), cached_nodes);
+    if (!index) {
+        return false;
+    }
+    if (index->d != index_dimension()) {
+        std::cerr << "DiskANN index dimension " << index->d << " does not match "
+                  << index_dimension() << std::endl;
+        return false;
+    }
+    index->set_search_defaults(search_list_size, beam_width);
+
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    index_ = std::move(index);
+    reset_index_versions();
+    return true;
+}
+
+} // namespace neurorag
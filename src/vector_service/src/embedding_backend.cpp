@@ -0,0 +1,113 @@
+/**
+ * @file embedding_backend.cpp
+ * @brief Pluggable text embedding models for query text
+ */
+
+#include "embedding_backend.h"
+#include "text_encoder.h"
+
+#include <iostream>
+
+#include <httplib.h>
+
+namespace neurorag {
+
+HttpEmbeddingBackend::HttpEmbeddingBackend(const std::string& url, int dimension,
+                                           size_t max_batch_size, int timeout_ms)
+    : url_(url),
+      path_("/"),
+      dimension_(dimension),
+      max_batch_size_(std::max<size_t>(1, max_batch_size)) {
+    std::string host = url;
+    size_t scheme_end = url.find("://");
+    size_t path_start = url.find('/', scheme_end == std::string::npos ? 0 : scheme_end + 3);
+    if (path_start != std::string::npos) {
+        host = url.substr(0, path_start);
+        path_ = url.substr(path_start);
+    }
+
+    client_ = std::make_unique<httplib::Client>(host);
+    client_->set_keep_alive(true);
+    time_t seconds = timeout_ms / 1000;
+    time_t microseconds = (timeout_ms % 1000) * 1000;
+    client_->set_connection_timeout(seconds, microseconds);
+    client_->set_read_timeout(seconds, microseconds);
+    client_->set_write_timeout(seconds, microseconds);
+}
+
+HttpEmbeddingBackend::~HttpEmbeddingBackend() = default;
+
+bool HttpEmbeddingBackend::embed(const std::vector<std::string>& texts,
+                                 std::vector<float>& embeddings,
+                                 std::string& error) {
+    nlohmann::json request;
+    request["texts"] = texts;
+
+    auto response = client_->Post(path_, request.dump(), "application/json");
+    if (!response) {
+        error = "embedding service " + url_ + " unreachable";
+        return false;
+    }
+    if (response->status != 200) {
+        error = "embedding service returned HTTP " + std::to_string(response->status);
+        return false;
+    }
+
+    try {
+        auto body = nlohmann::json::parse(response->body);
+        const auto& rows = body.at("embeddings");
+        if (rows.size() != texts.size()) {
+            error = "embedding service returned " + std::to_string(rows.size()) +
+                    " embeddings for " + std::to_string(texts.size()) + " texts";
+            return false;
+        }
+        embeddings.resize(texts.size() * dimension_);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (rows[i].size() != static_cast<size_t>(dimension_)) {
+                error = "embedding service returned dimension " + std::to_string(rows[i].size()) +
+                        ", expected " + std::to_string(dimension_);
+                return false;
+            }
+            for (int j = 0; j < dimension_; ++j) {
+                embeddings[i * dimension_ + j] = rows[i][j].get<float>();
+            }
+        }
+    } catch (const std::exception& e) {
+        error = std::string("invalid embedding response: ") + e.what();
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<EmbeddingBackend> create_embedding_backend(const std::string& spec,
+                                                           int dimension,
+                                                           size_t max_batch_size,
+                                                           int num_threads,
+                                                           std::string& error) {
+    if (dimension <= 0) {
+        error = "embedding dimension must be positive";
+        return nullptr;
+    }
+    if (spec.rfind("http://", 0) == 0 || spec.rfind("https://", 0) == 0) {
+        return std::make_unique<HttpEmbeddingBackend>(spec, dimension, max_batch_size, 5000);
+    }
+    bool quantize = spec.rfind("local-int8:", 0) == 0;
+    if (quantize || spec.rfind("local:", 0) == 0) {
+        std::string path = spec.substr(spec.find(':') + 1);
+        auto encoder = TextEncoder::load(path, quantize, num_threads, error);
+        if (!encoder) {
+            return nullptr;
+        }
+        if (encoder->dimension() != dimension) {
+            error = path + " produces " + std::to_string(encoder->dimension()) +
+                    "-dimensional embeddings, the index has " + std::to_string(dimension);
+            return nullptr;
+        }
+        std::cout << "Loaded text encoder " << path << ": " << encoder->describe().dump() << std::endl;
+        return std::make_unique<LocalEmbeddingBackend>(std::move(encoder), max_batch_size, path);
+    }
+    error = "unknown embedding backend '" + spec + "'";
+    return nullptr;
+}
+
+} // namespace neurorag
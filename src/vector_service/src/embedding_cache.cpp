@@ -0,0 +1,264 @@
+/**
+ * @file embedding_cache.cpp
+ * @brief Compact in-memory text -> embedding cache
+ */
+
+#include "embedding_cache.h"
+#include "checksum.h"
+#include "result_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace neurorag {
+
+namespace {
+
+constexpr uint32_t kEmptySlot = 0;
+constexpr uint64_t kKeySeed = 0x4E52454D42ULL;   // "NREMB"
+
+void to_half(const float* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), half);
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = result_codec::float_to_half(src[i]);
+    }
+}
+
+void from_half(const uint16_t* src, float* dst, size_t count) {
+    size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(half));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = result_codec::half_to_float(src[i]);
+    }
+}
+
+size_t table_size_for(size_t capacity) {
+    // At most half full, so probes stay short
+    size_t size = 16;
+    while (size < capacity * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+} // namespace
+
+struct EmbeddingCache::Shard {
+    std::mutex mutex;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t hand = 0;                   // CLOCK hand over slots
+    size_t mask = 0;                   // table size - 1
+    std::vector<uint64_t> keys;        // per slot
+    std::vector<uint32_t> stamps;      // per slot: insertion time, seconds since epoch_
+    std::vector<uint8_t> referenced;   // per slot: CLOCK bit
+    std::vector<uint16_t> values;      // per slot: dimension fp16 values
+    std::vector<uint32_t> table;       // slot + 1 by key, linear probing; 0 is empty
+
+    // Table position holding key, or table.size()
+    size_t find(uint64_t key) const {
+        for (size_t position = key & mask;; position = (position + 1) & mask) {
+            uint32_t entry = table[position];
+            if (entry == kEmptySlot) {
+                return table.size();
+            }
+            if (keys[entry - 1] == key) {
+                return position;
+            }
+        }
+    }
+
+    void place(uint64_t key, uint32_t slot) {
+        size_t position = key & mask;
+        while (table[position] != kEmptySlot) {
+            position = (position + 1) & mask;
+        }
+        table[position] = slot + 1;
+    }
+
+    // Backward-shift deletion keeps every probe sequence unbroken
+    void erase(size_t position) {
+        size_t hole = position;
+        for (size_t next = (hole + 1) & mask; table[next] != kEmptySlot; next = (next + 1) & mask) {
+            size_t home = keys[table[next] - 1] & mask;
+            bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+            if (movable) {
+                table[hole] = table[next];
+                hole = next;
+            }
+        }
+        table[hole] = kEmptySlot;
+    }
+
+    // A free slot, or the first unreferenced one under the CLOCK hand
+    uint32_t claim_slot(bool& evicted) {
+        evicted = false;
+        if (used < capacity) {
+            return static_cast<uint32_t>(used++);
+        }
+        while (referenced[hand]) {
+            referenced[hand] = 0;
+            hand = (hand + 1) % capacity;
+        }
+        uint32_t slot = static_cast<uint32_t>(hand);
+        hand = (hand + 1) % capacity;
+        erase(find(keys[slot]));
+        evicted = true;
+        return slot;
+    }
+};
+
+EmbeddingCache::EmbeddingCache(size_t capacity, int dimension, std::chrono::seconds ttl, size_t num_shards)
+    : dimension_(dimension),
+      ttl_seconds_(static_cast<uint32_t>(std::max<int64_t>(0, ttl.count()))),
+      epoch_(std::chrono::steady_clock::now()) {
+    num_shards = std::max<size_t>(1, std::min(num_shards, std::max<size_t>(1, capacity)));
+    for (size_t i = 0; i < num_shards; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->capacity = std::max<size_t>(1, (capacity + num_shards - 1) / num_shards);
+        shard->keys.resize(shard->capacity);
+        shard->stamps.resize(shard->capacity);
+        shard->referenced.resize(shard->capacity);
+        shard->values.resize(shard->capacity * dimension_);
+        shard->table.assign(table_size_for(shard->capacity), kEmptySlot);
+        shard->mask = shard->table.size() - 1;
+        shards_.push_back(std::move(shard));
+    }
+}
+
+EmbeddingCache::~EmbeddingCache() = default;
+
+uint64_t EmbeddingCache::key(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return xxhash64(nullptr, 0, kKeySeed);
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return xxhash64(text.data() + begin, end - begin + 1, kKeySeed);
+}
+
+EmbeddingCache::Shard& EmbeddingCache::shard_for(uint64_t key) const {
+    // High bits pick the shard, low bits the table position
+    return *shards_[(key >> 48) % shards_.size()];
+}
+
+uint32_t EmbeddingCache::now_seconds() const {
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - epoch_).count());
+}
+
+bool EmbeddingCache::lookup(uint64_t key, float* embedding) {
+    Shard& shard = shard_for(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t position = shard.find(key);
+        if (position != shard.table.size()) {
+            uint32_t slot = shard.table[position] - 1;
+            if (ttl_seconds_ == 0 || now_seconds() - shard.stamps[slot] < ttl_seconds_) {
+                shard.referenced[slot] = 1;
+                from_half(&shard.values[static_cast<size_t>(slot) * dimension_], embedding, dimension_);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            // Left in place; the next insert of this text refreshes it
+            expired_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void EmbeddingCache::insert(uint64_t key, const float* embedding) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    uint32_t slot;
+    size_t position = shard.find(key);
+    if (position != shard.table.size()) {
+        slot = shard.table[position] - 1;
+    } else {
+        bool evicted;
+        slot = shard.claim_slot(evicted);
+        if (evicted) {
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.keys[slot] = key;
+        shard.place(key, slot);
+    }
+    shard.stamps[slot] = now_seconds();
+    shard.referenced[slot] = 1;
+    to_half(embedding, &shard.values[static_cast<size_t>(slot) * dimension_], dimension_);
+    insertions_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EmbeddingCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        std::fill(shard->table.begin(), shard->table.end(), kEmptySlot);
+        std::fill(shard->referenced.begin(), shard->referenced.end(), 0);
+        shard->used = 0;
+        shard->hand = 0;
+    }
+}
+
+size_t EmbeddingCache::capacity() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->capacity;
+    }
+    return total;
+}
+
+size_t EmbeddingCache::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->used;
+    }
+    return total;
+}
+
+size_t EmbeddingCache::memory_bytes() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->keys.capacity() * sizeof(uint64_t) + shard->stamps.capacity() * sizeof(uint32_t) +
+                 shard->referenced.capacity() + shard->values.capacity() * sizeof(uint16_t) +
+                 shard->table.capacity() * sizeof(uint32_t);
+    }
+    return total;
+}
+
+nlohmann::json EmbeddingCache::get_statistics() const {
+    uint64_t hits = hits_.load();
+    uint64_t misses = misses_.load();
+    nlohmann::json stats;
+    stats["entries"] = size();
+    stats["capacity"] = capacity();
+    stats["dimension"] = dimension_;
+    stats["shards"] = shards_.size();
+    stats["memory_bytes"] = memory_bytes();
+    stats["ttl_seconds"] = ttl_seconds_;
+    stats["hits"] = hits;
+    stats["misses"] = misses;
+    stats["hit_rate"] = hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    stats["expired"] = expired_.load();
+    stats["insertions"] = insertions_.load();
+    stats["evictions"] = evictions_.load();
+    return stats;
+}
+
+} // namespace neurorag
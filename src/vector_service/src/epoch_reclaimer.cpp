@@ -0,0 +1,169 @@
+/**
+ * @file epoch_reclaimer.cpp
+ * @brief Epoch-based reclamation for lock-free readers of shared structures
+ */
+
+#include "epoch_reclaimer.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace neurorag {
+
+namespace {
+
+// Threads start their slot search and pick their retire list by this, so
+// they rarely contend for either
+size_t thread_hash() {
+    thread_local const size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return hash;
+}
+
+} // namespace
+
+EpochManager::EpochManager(size_t reader_slots, size_t collect_threshold)
+    : num_slots_(std::max<size_t>(1, reader_slots)),
+      collect_threshold_(std::max<size_t>(1, collect_threshold)),
+      slots_(new ReaderSlot[num_slots_]),
+      global_epoch_(1),
+      lists_(new RetireList[kRetireLists]),
+      pending_(0),
+      retired_(0),
+      reclaimed_(0),
+      collections_(0) {}
+
+EpochManager::~EpochManager() {
+    for (size_t i = 0; i < kRetireLists; ++i) {
+        for (auto& entry : lists_[i].entries) {
+            entry.reclaim();
+        }
+    }
+}
+
+size_t EpochManager::enter() const {
+    size_t start = thread_hash();
+    for (;;) {
+        for (size_t i = 0; i < num_slots_; ++i) {
+            size_t slot = (start + i) % num_slots_;
+            if (slots_[slot].epoch.load(std::memory_order_relaxed) != 0) {
+                continue;
+            }
+            // The slot is stamped before the caller loads any shared
+            // pointer; collect() relies on that order (both sequentially
+            // consistent)
+            uint64_t expected = 0;
+            if (slots_[slot].epoch.compare_exchange_strong(expected, global_epoch_.load())) {
+                return slot;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void EpochManager::exit(size_t slot) const {
+    slots_[slot].epoch.store(0, std::memory_order_release);
+}
+
+void EpochManager::retire(std::function<void()> reclaim) {
+    RetireList& list = lists_[thread_hash() % kRetireLists];
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(list.mutex);
+        // Unlinked before this load, so readers stamped later cannot reach
+        // it; loaded under the lock so each list stays in epoch order
+        uint64_t epoch = global_epoch_.load();
+        list.entries.push_back({std::move(reclaim), epoch});
+        full = list.entries.size() >= std::max(collect_threshold_, list.collect_at);
+        // Counted before a collect can take the entry out again
+        pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+    retired_.fetch_add(1, std::memory_order_relaxed);
+    if (full) {
+        collect();
+    }
+}
+
+uint64_t EpochManager::oldest_pinned_epoch() const {
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < num_slots_; ++i) {
+        uint64_t epoch = slots_[i].epoch.load();
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    return oldest;
+}
+
+size_t EpochManager::collect() {
+    // Readers pinning from now on get a later epoch than anything retired so far
+    global_epoch_.fetch_add(1);
+    uint64_t oldest = oldest_pinned_epoch();
+    collections_.fetch_add(1, std::memory_order_relaxed);
+
+    size_t freed = 0;
+    std::vector<Retired> expired;
+    for (size_t i = 0; i < kRetireLists; ++i) {
+        RetireList& list = lists_[i];
+        {
+            std::lock_guard<std::mutex> lock(list.mutex);
+            if (list.entries.empty()) {
+                continue;
+            }
+            // Entries are appended in epoch order
+            auto first_kept = std::partition_point(list.entries.begin(), list.entries.end(),
+                [oldest](const Retired& retired) { return retired.epoch < oldest; });
+            std::move(list.entries.begin(), first_kept, std::back_inserter(expired));
+            list.entries.erase(list.entries.begin(), first_kept);
+            // What pinned readers still hold back does not count towards
+            // the next trigger, or every retirement would collect
+            list.collect_at = list.entries.size() + collect_threshold_;
+        }
+        // Destructors may stop threads or unmap files; not under the lock
+        for (auto& entry : expired) {
+            entry.reclaim();
+        }
+        freed += expired.size();
+        expired.clear();
+    }
+
+    pending_.fetch_sub(freed, std::memory_order_relaxed);
+    reclaimed_.fetch_add(freed, std::memory_order_relaxed);
+    return freed;
+}
+
+bool EpochManager::drain(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        collect();
+        if (pending() == 0) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+size_t EpochManager::active_readers() const {
+    size_t active = 0;
+    for (size_t i = 0; i < num_slots_; ++i) {
+        active += slots_[i].epoch.load(std::memory_order_relaxed) != 0;
+    }
+    return active;
+}
+
+nlohmann::json EpochManager::get_statistics() const {
+    nlohmann::json stats;
+    stats["epoch"] = epoch();
+    stats["active_readers"] = active_readers();
+    stats["reader_slots"] = num_slots_;
+    stats["pending"] = pending();
+    stats["retired"] = retired_.load();
+    stats["reclaimed"] = reclaimed_.load();
+    stats["collections"] = collections_.load();
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,496 @@
+/**
+ * @file filtered_hnsw_index.cpp
+ * @brief Filter-aware HNSW search for restrictive metadata predicates
+ */
+
+#include "filtered_hnsw_index.h"
+#include "metadata_filter.h"
+#include "simd_kernels.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include <omp.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/clone_index.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/impl/IDSelector.h>
+
+namespace neurorag {
+
+namespace {
+
+// Below this many rows a single query is scanned by one thread
+constexpr size_t kParallelScanRows = 65536;
+
+// Ids whose filter bits are evaluated together in an exact scan
+constexpr size_t kScanBlock = 4096;
+
+// (distance, id); smaller is better, inner products are negated
+using Candidate = std::pair<float, faiss::idx_t>;
+
+struct CloserFirst {
+    bool operator()(const Candidate& a, const Candidate& b) const { return a.first > b.first; }
+};
+
+struct FartherFirst {
+    bool operator()(const Candidate& a, const Candidate& b) const { return a.first < b.first; }
+};
+
+// Max-heap on distance: the farthest kept candidate is at the front
+void keep_best(std::vector<Candidate>& heap, size_t capacity, float distance, faiss::idx_t id) {
+    if (heap.size() < capacity) {
+        heap.emplace_back(distance, id);
+        std::push_heap(heap.begin(), heap.end(), FartherFirst());
+    } else if (distance < heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end(), FartherFirst());
+        heap.back() = {distance, id};
+        std::push_heap(heap.begin(), heap.end(), FartherFirst());
+    }
+}
+
+/**
+ * @brief Per-thread visited marks; a new epoch per query clears them
+ */
+class VisitedMarks {
+public:
+    void begin(size_t n) {
+        if (marks_.size() < n) {
+            marks_.resize(n, 0);
+        }
+        if (++epoch_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    bool visited(size_t i) const { return marks_[i] == epoch_; }
+
+    // Marks i; false if it was already marked
+    bool visit(size_t i) {
+        if (marks_[i] == epoch_) {
+            return false;
+        }
+        marks_[i] = epoch_;
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> marks_;
+    uint8_t epoch_ = 0;
+};
+
+thread_local VisitedMarks visited_marks;
+
+void write_results(std::vector<Candidate>& results, size_t k, bool inner_product,
+                   float* distances, faiss::idx_t* labels) {
+    std::sort(results.begin(), results.end());
+    for (size_t i = 0; i < k; ++i) {
+        if (i < results.size()) {
+            distances[i] = inner_product ? -results[i].first : results[i].first;
+            labels[i] = results[i].second;
+        } else {
+            distances[i] = inner_product ? -std::numeric_limits<float>::max() : std::numeric_limits<float>::max();
+            labels[i] = -1;
+        }
+    }
+}
+
+} // namespace
+
+FilteredHnswIndex::FilteredHnswIndex(std::shared_ptr<faiss::IndexHNSWFlat> hnsw, double exact_selectivity,
+                                     double native_selectivity)
+    : faiss::Index(hnsw->d, hnsw->metric_type),
+      hnsw_(std::move(hnsw)),
+      exact_selectivity_(std::max(0.0, exact_selectivity)),
+      native_selectivity_(std::max(exact_selectivity_, native_selectivity)) {
+    ntotal = hnsw_->ntotal;
+    is_trained = true;
+}
+
+bool FilteredHnswIndex::can_wrap(const faiss::Index& index, std::string& reason) {
+    auto* hnsw = dynamic_cast<const faiss::IndexHNSWFlat*>(&index);
+    if (!hnsw || !dynamic_cast<const faiss::IndexFlat*>(hnsw->storage)) {
+        reason = "Filter-aware HNSW search needs an HNSW_FLAT index";
+        return false;
+    }
+    if (index.metric_type != faiss::METRIC_INNER_PRODUCT && index.metric_type != faiss::METRIC_L2) {
+        reason = "Filter-aware HNSW search supports inner product and L2 only";
+        return false;
+    }
+    return true;
+}
+
+FilteredHnswIndex* FilteredHnswIndex::clone() const {
+    std::shared_ptr<faiss::IndexHNSWFlat> hnsw(
+        dynamic_cast<faiss::IndexHNSWFlat*>(faiss::clone_index(hnsw_.get())));
+    if (!hnsw) {
+        throw faiss::FaissException("FilteredHnswIndex: cannot clone the HNSW index");
+    }
+    return new FilteredHnswIndex(std::move(hnsw), exact_selectivity_, native_selectivity_);
+}
+
+nlohmann::json FilteredHnswIndex::get_statistics() const {
+    nlohmann::json stats;
+    stats["vectors"] = ntotal;
+    stats["exact_selectivity"] = exact_selectivity_;
+    stats["native_selectivity"] = native_selectivity_;
+    stats["ef_search"] = hnsw_->hnsw.efSearch;
+    stats["searches"] = searches_.load();
+    stats["native_searches"] = native_searches_.load();
+    stats["traversals"] = traversals_.load();
+    stats["exact_scans"] = exact_scans_.load();
+    stats["exact_fallbacks"] = exact_fallbacks_.load();
+    stats["distances_computed"] = distances_computed_.load();
+    stats["filtered_nodes_skipped"] = nodes_skipped_.load();
+    stats["kernels"] = simd::instruction_set();
+    return stats;
+}
+
+std::shared_ptr<const faiss::Index> FilteredHnswIndex::base_index() const {
+    return hnsw_;
+}
+
+void FilteredHnswIndex::add(faiss::idx_t n, const float* x) {
+    hnsw_->add(n, x);
+    ntotal = hnsw_->ntotal;
+}
+
+void FilteredHnswIndex::reset() {
+    hnsw_->reset();
+    ntotal = 0;
+}
+
+size_t FilteredHnswIndex::remove_ids(const faiss::IDSelector& sel) {
+    size_t removed = hnsw_->remove_ids(sel);
+    ntotal = hnsw_->ntotal;
+    return removed;
+}
+
+void FilteredHnswIndex::reconstruct(faiss::idx_t key, float* recons) const {
+    hnsw_->reconstruct(key, recons);
+}
+
+FilteredHnswStrategy FilteredHnswIndex::choose_strategy(const faiss::IDSelector* sel, int ef_search,
+                                                        double& selectivity) const {
+    selectivity = 1.0;
+    if (!sel) {
+        return FilteredHnswStrategy::kNative;
+    }
+    size_t rows = static_cast<size_t>(ntotal);
+    if (rows == 0) {
+        return FilteredHnswStrategy::kExact;
+    }
+
+    // Evenly spaced ids, offset within each stride so runs of ids written
+    // together (one ingestion batch, one tenant) are not sampled in step
+    size_t samples = std::min(rows, kSelectivitySample);
+    std::vector<int64_t> ids(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        size_t stride_begin = rows * i / samples;
+        size_t stride = rows * (i + 1) / samples - stride_begin;
+        ids[i] = static_cast<int64_t>(stride_begin + (i * 2654435761u) % stride);
+    }
+    size_t passed = 0;
+    if (auto* filter = dynamic_cast<const MetadataFilter*>(sel)) {
+        std::vector<uint8_t> keep(samples);
+        passed = filter->evaluate(ids.data(), samples, keep.data());
+    } else {
+        for (int64_t id : ids) {
+            passed += sel->is_member(id);
+        }
+    }
+    selectivity = static_cast<double>(passed) / samples;
+
+    if (selectivity >= native_selectivity_) {
+        return FilteredHnswStrategy::kNative;
+    }
+    double traversal_distances = static_cast<double>(ef_search) * hnsw_->hnsw.nb_neighbors(0);
+    if (selectivity < exact_selectivity_ || selectivity * rows <= traversal_distances) {
+        return FilteredHnswStrategy::kExact;
+    }
+    return FilteredHnswStrategy::kTraversal;
+}
+
+void FilteredHnswIndex::search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances,
+                               faiss::idx_t* labels, const faiss::SearchParameters* params) const {
+    if (k <= 0) {
+        throw faiss::FaissException("FilteredHnswIndex: k must be positive");
+    }
+    auto* hnsw_params = dynamic_cast<const faiss::SearchParametersHNSW*>(params);
+    int ef = hnsw_params && hnsw_params->efSearch > 0 ? hnsw_params->efSearch : hnsw_->hnsw.efSearch;
+    ef = std::max(ef, static_cast<int>(k));
+    const faiss::IDSelector* sel = params ? params->sel : nullptr;
+    searches_.fetch_add(static_cast<uint64_t>(n));
+
+    double selectivity;
+    FilteredHnswStrategy strategy = choose_strategy(sel, ef, selectivity);
+    if (strategy == FilteredHnswStrategy::kNative) {
+        // IndexHNSW accepts only its own parameter type
+        native_searches_.fetch_add(static_cast<uint64_t>(n));
+        faiss::SearchParametersHNSW native;
+        if (hnsw_params) {
+            native = *hnsw_params;
+        }
+        native.sel = params ? params->sel : nullptr;
+        native.efSearch = ef;
+        hnsw_->search(n, x, k, distances, labels, &native);
+        return;
+    }
+
+    if (strategy == FilteredHnswStrategy::kExact) {
+        exact_scans_.fetch_add(static_cast<uint64_t>(n));
+        if (n == 1) {
+            scan_one(x, static_cast<size_t>(k), *sel, true, distances, labels);
+            return;
+        }
+        #pragma omp parallel for schedule(dynamic)
+        for (faiss::idx_t q = 0; q < n; ++q) {
+            scan_one(x + q * d, static_cast<size_t>(k), *sel, false, distances + q * k, labels + q * k);
+        }
+        return;
+    }
+
+    traversals_.fetch_add(static_cast<uint64_t>(n));
+    #pragma omp parallel for schedule(dynamic) if (n > 1)
+    for (faiss::idx_t q = 0; q < n; ++q) {
+        if (!traverse_one(x + q * d, static_cast<size_t>(k), ef, *sel, distances + q * k, labels + q * k)) {
+            exact_fallbacks_.fetch_add(1, std::memory_order_relaxed);
+            scan_one(x + q * d, static_cast<size_t>(k), *sel, n == 1, distances + q * k, labels + q * k);
+        }
+    }
+}
+
+bool FilteredHnswIndex::traverse_one(const float* query, size_t k, int ef, const faiss::IDSelector& sel,
+                                     float* distances, faiss::idx_t* labels) const {
+    const faiss::HNSW& graph = hnsw_->hnsw;
+    if (graph.entry_point < 0) {
+        return false;
+    }
+    bool inner_product = metric_type == faiss::METRIC_INNER_PRODUCT;
+    const float* vectors = static_cast<const faiss::IndexFlat*>(hnsw_->storage)->get_xb();
+    auto distance = [&](faiss::idx_t id) {
+        const float* row = vectors + id * d;
+        return inner_product ? -simd::dot(query, row, d) : simd::l2_sqr(query, row, d);
+    };
+    size_t computed = 0;
+    size_t skipped = 0;
+
+    // Upper levels: greedy descent regardless of the filter, which only
+    // needs to land in the query's neighbourhood
+    faiss::idx_t nearest = graph.entry_point;
+    float nearest_distance = distance(nearest);
+    ++computed;
+    for (int level = graph.max_level; level >= 1; --level) {
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            size_t begin, end;
+            graph.neighbor_range(nearest, level, &begin, &end);
+            for (size_t j = begin; j < end; ++j) {
+                faiss::idx_t neighbor = graph.neighbors[j];
+                if (neighbor < 0) {
+                    break;
+                }
+                float neighbor_distance = distance(neighbor);
+                ++computed;
+                if (neighbor_distance < nearest_distance) {
+                    nearest = neighbor;
+                    nearest_distance = neighbor_distance;
+                    moved = true;
+                }
+            }
+        }
+    }
+
+    // Level 0: best-first over passing nodes only. A filtered-out neighbour
+    // is not scored; its own neighbours that pass are taken instead, up to
+    // one full neighbour list per expanded node
+    VisitedMarks& visited = visited_marks;
+    visited.begin(static_cast<size_t>(ntotal));
+    std::priority_queue<Candidate, std::vector<Candidate>, CloserFirst> candidates;
+    std::vector<Candidate> results;
+    results.reserve(ef + 1);
+    visited.visit(nearest);
+    candidates.emplace(nearest_distance, nearest);
+    if (sel.is_member(nearest)) {
+        keep_best(results, ef, nearest_distance, nearest);
+    }
+
+    size_t degree = static_cast<size_t>(graph.nb_neighbors(0));
+    std::vector<faiss::idx_t> expand;
+    std::vector<faiss::idx_t> filtered;
+    expand.reserve(degree);
+    filtered.reserve(degree);
+    while (!candidates.empty()) {
+        Candidate current = candidates.top();
+        if (results.size() >= static_cast<size_t>(ef) && current.first > results.front().first) {
+            break;
+        }
+        candidates.pop();
+
+        expand.clear();
+        filtered.clear();
+        size_t begin, end;
+        graph.neighbor_range(current.second, 0, &begin, &end);
+        for (size_t j = begin; j < end; ++j) {
+            faiss::idx_t neighbor = graph.neighbors[j];
+            if (neighbor < 0) {
+                break;
+            }
+            if (!visited.visit(neighbor)) {
+                continue;
+            }
+            if (sel.is_member(neighbor)) {
+                expand.push_back(neighbor);
+            } else {
+                filtered.push_back(neighbor);
+            }
+        }
+        // Two hops through filtered-out neighbours; those that fail again
+        // stay unmarked so they can still be expanded from elsewhere
+        skipped += filtered.size();
+        for (size_t f = 0; f < filtered.size() && expand.size() < degree; ++f) {
+            graph.neighbor_range(filtered[f], 0, &begin, &end);
+            for (size_t j = begin; j < end && expand.size() < degree; ++j) {
+                faiss::idx_t neighbor = graph.neighbors[j];
+                if (neighbor < 0) {
+                    break;
+                }
+                if (!visited.visited(neighbor) && sel.is_member(neighbor)) {
+                    visited.visit(neighbor);
+                    expand.push_back(neighbor);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < expand.size(); ++i) {
+            if (i + 1 < expand.size()) {
+                __builtin_prefetch(vectors + expand[i + 1] * d);
+            }
+            float neighbor_distance = distance(expand[i]);
+            if (results.size() < static_cast<size_t>(ef) || neighbor_distance < results.front().first) {
+                candidates.emplace(neighbor_distance, expand[i]);
+                keep_best(results, ef, neighbor_distance, expand[i]);
+            }
+        }
+        computed += expand.size();
+    }
+    distances_computed_.fetch_add(computed, std::memory_order_relaxed);
+    nodes_skipped_.fetch_add(skipped, std::memory_order_relaxed);
+
+    if (results.size() < k) {
+        return false;
+    }
+    write_results(results, k, inner_product, distances, labels);
+    return true;
+}
+
+void FilteredHnswIndex::scan_one(const float* query, size_t k, const faiss::IDSelector& sel, bool parallel,
+                                 float* distances, faiss::idx_t* labels) const {
+    bool inner_product = metric_type == faiss::METRIC_INNER_PRODUCT;
+    const float* vectors = static_cast<const faiss::IndexFlat*>(hnsw_->storage)->get_xb();
+    auto* filter = dynamic_cast<const MetadataFilter*>(&sel);
+    size_t rows = static_cast<size_t>(ntotal);
+
+    // Each thread takes whole blocks: filter bits first, then the vectors that pass
+    size_t blocks = (rows + kScanBlock - 1) / kScanBlock;
+    int threads = parallel && rows >= kParallelScanRows ? omp_get_max_threads() : 1;
+    std::vector<std::vector<Candidate>> heaps(threads);
+    std::vector<size_t> computed(threads, 0);
+    #pragma omp parallel for num_threads(threads) schedule(static) if (threads > 1)
+    for (int t = 0; t < threads; ++t) {
+        std::vector<Candidate>& heap = heaps[t];
+        heap.reserve(k);
+        std::vector<uint64_t> bitmap(kScanBlock / 64);
+        for (size_t block = blocks * t / threads; block < blocks * (t + 1) / threads; ++block) {
+            size_t first = block * kScanBlock;
+            size_t count = std::min(kScanBlock, rows - first);
+            if (filter) {
+                filter->evaluate_range(static_cast<int64_t>(first), count, bitmap.data());
+            } else {
+                std::fill(bitmap.begin(), bitmap.end(), 0);
+                for (size_t i = 0; i < count; ++i) {
+                    if (sel.is_member(static_cast<faiss::idx_t>(first + i))) {
+                        bitmap[i / 64] |= uint64_t{1} << (i % 64);
+                    }
+                }
+            }
+            for (size_t word = 0; word < (count + 63) / 64; ++word) {
+                for (uint64_t bits = bitmap[word]; bits; bits &= bits - 1) {
+                    size_t id = first + word * 64 + __builtin_ctzll(bits);
+                    const float* row = vectors + id * d;
+                    float distance = inner_product ? -simd::dot(query, row, d) : simd::l2_sqr(query, row, d);
+                    keep_best(heap, k, distance, static_cast<faiss::idx_t>(id));
+                    ++computed[t];
+                }
+            }
+        }
+    }
+    std::vector<Candidate>& results = heaps[0];
+    for (int t = 1; t < threads; ++t) {
+        for (const Candidate& candidate : heaps[t]) {
+            keep_best(results, k, candidate.first, candidate.second);
+        }
+        computed[0] += computed[t];
+    }
+    distances_computed_.fetch_add(computed[0], std::memory_order_relaxed);
+    write_results(results, k, inner_product, distances, labels);
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<const FilteredHnswIndex> VectorSearchEngine::filtered_hnsw_index() const {
+    std::shared_ptr<const faiss::Index> layer = serving_index();
+    while (layer) {
+        if (auto filtered = std::dynamic_pointer_cast<const FilteredHnswIndex>(layer)) {
+            return filtered;
+        }
+        auto* layered = dynamic_cast<const LayeredIndex*>(layer.get());
+        if (!layered) {
+            break;
+        }
+        layer = layered->base_index();
+    }
+    return nullptr;
+}
+
+bool VectorSearchEngine::enable_filtered_hnsw_search(double exact_selectivity, double native_selectivity) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (!index_) {
+        return false;
+    }
+    if (dynamic_cast<FilteredHnswIndex*>(index_.get())) {
+        return true;
+    }
+    std::string reason;
+    if (!FilteredHnswIndex::can_wrap(*index_, reason)) {
+        std::cout << reason << "; filter-aware HNSW search not enabled" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<faiss::IndexHNSWFlat> hnsw(static_cast<faiss::IndexHNSWFlat*>(index_.release()));
+    index_ = std::make_unique<FilteredHnswIndex>(std::move(hnsw), exact_selectivity, native_selectivity);
+    std::cout << "Filter-aware HNSW search enabled (exact scan below " << exact_selectivity * 100
+              << "% of documents, native search from " << native_selectivity * 100 << "%)" << std::endl;
+    return true;
+}
+
+nlohmann::json VectorSearchEngine::get_filtered_hnsw_statistics() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto filtered = filtered_hnsw_index();
+    if (!filtered) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = filtered->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
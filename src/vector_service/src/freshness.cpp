@@ -0,0 +1,498 @@
+/**
+ * @file freshness.cpp
+ * @brief Time-decayed scoring inside the top-k search
+ */
+
+#include "freshness.h"
+#include "lsm_index.h"
+#include "simd_kernels.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexIVFFlat.h>
+
+namespace neurorag {
+
+namespace {
+
+constexpr double kSecondsPerDay = 86400.0;
+
+// Higher is better: similarity for IP, negated distance for L2
+using Candidate = std::pair<float, faiss::idx_t>;
+
+void keep_best(std::vector<Candidate>& heap, size_t k, float score, faiss::idx_t id) {
+    auto worse = [](const Candidate& a, const Candidate& b) { return a.first > b.first; };
+    if (heap.size() < k) {
+        heap.emplace_back(score, id);
+        std::push_heap(heap.begin(), heap.end(), worse);
+    } else if (score > heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end(), worse);
+        heap.back() = {score, id};
+        std::push_heap(heap.begin(), heap.end(), worse);
+    }
+}
+
+// Whether a candidate scoring this can still enter the heap
+bool can_enter(const std::vector<Candidate>& heap, size_t k, float score) {
+    return heap.size() < k || score > heap.front().first;
+}
+
+// Decayed score of a raw similarity or distance
+float decayed(float raw, float factor, bool inner_product) {
+    if (inner_product) {
+        return raw * factor;
+    }
+    return factor > 0.0f ? -raw / factor : -FLT_MAX;
+}
+
+// Excludes LSM tombstones, then applies the caller's selector if any
+class LiveSelector : public faiss::IDSelector {
+public:
+    LiveSelector(const LsmIndex* lsm, const faiss::IDSelector* inner) : lsm_(lsm), inner_(inner) {}
+
+    bool is_member(faiss::idx_t id) const override {
+        return (!lsm_ || !lsm_->is_removed(id)) && (!inner_ || inner_->is_member(id));
+    }
+
+private:
+    const LsmIndex* lsm_;
+    const faiss::IDSelector* inner_;
+};
+
+// Parameters for an undecayed candidate search of the serving index
+std::unique_ptr<faiss::SearchParameters> candidate_parameters(const faiss::Index& base,
+                                                              const faiss::IDSelector* sel, faiss::idx_t k) {
+    std::unique_ptr<faiss::SearchParameters> params;
+    if (auto* hnsw = dynamic_cast<const faiss::IndexHNSW*>(&base)) {
+        auto hnsw_params = std::make_unique<faiss::SearchParametersHNSW>();
+        hnsw_params->efSearch = std::max<int>(hnsw->hnsw.efSearch, static_cast<int>(k));
+        params = std::move(hnsw_params);
+    } else if (auto* ivf = dynamic_cast<const faiss::IndexIVF*>(&base)) {
+        auto ivf_params = std::make_unique<faiss::SearchParametersIVF>();
+        ivf_params->nprobe = ivf->nprobe;
+        params = std::move(ivf_params);
+    } else if (sel) {
+        params = std::make_unique<faiss::SearchParameters>();
+    }
+    if (params) {
+        // faiss only reads the selector
+        params->sel = const_cast<faiss::IDSelector*>(sel);
+    }
+    return params;
+}
+
+} // namespace
+
+float TimeDecay::factor_at(double timestamp) const {
+    if (std::isnan(timestamp)) {
+        return 0.0f;
+    }
+    double age_days = std::max(0.0, now - timestamp) / kSecondsPerDay;
+    return static_cast<float>(std::exp(-lambda * age_days));
+}
+
+FreshnessSearcher::FreshnessSearcher(std::string field, int candidate_multiplier)
+    : field_(std::move(field)), candidate_multiplier_(std::max(1, candidate_multiplier)) {}
+
+void FreshnessSearcher::track(const std::shared_ptr<const faiss::Index>& base, const TimeDecay& decay) {
+    auto flat = dynamic_cast<const faiss::IndexFlat*>(base.get());
+    size_t rows = flat ? static_cast<size_t>(flat->ntotal) : 0;
+    // Flat removal renumbers every later row
+    if (summarized_.lock() != base || summarized_timestamps_ != decay.timestamps || rows < flat_rows_) {
+        summaries_.clear();
+        summarized_ = base;
+        summarized_timestamps_ = decay.timestamps;
+    }
+    flat_rows_ = rows;
+    if (auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get())) {
+        summaries_.resize(ivf->nlist);
+    } else {
+        summaries_.resize(rows / kBlockRows);
+    }
+}
+
+void FreshnessSearcher::summarize(const faiss::Index& base, int64_t segment, const TimeDecay& decay,
+                                  uint64_t version) {
+    size_t d = static_cast<size_t>(base.d);
+    Summary& summary = summaries_[segment];
+    summary.centroid.assign(d, 0.0f);
+    summary.radius = 0.0f;
+    summary.oldest = std::numeric_limits<double>::infinity();
+    summary.newest = -std::numeric_limits<double>::infinity();
+    summary.undated = false;
+
+    const faiss::IndexIVF* ivf = dynamic_cast<const faiss::IndexIVF*>(&base);
+    const float* vectors;
+    const faiss::idx_t* ids = nullptr;
+    const uint8_t* codes = nullptr;
+    size_t count;
+    if (ivf) {
+        count = ivf->invlists->list_size(segment);
+        codes = ivf->invlists->get_codes(segment);
+        ids = ivf->invlists->get_ids(segment);
+        vectors = reinterpret_cast<const float*>(codes);
+        ivf->quantizer->reconstruct(segment, summary.centroid.data());
+    } else {
+        count = kBlockRows;
+        vectors = static_cast<const faiss::IndexFlat&>(base).get_xb() + segment * kBlockRows * d;
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < d; ++j) {
+                summary.centroid[j] += vectors[i * d + j];
+            }
+        }
+        for (float& value : summary.centroid) {
+            value /= static_cast<float>(count);
+        }
+    }
+
+    float radius_sqr = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        radius_sqr = std::max(radius_sqr, simd::l2_sqr(vectors + i * d, summary.centroid.data(), d));
+        double timestamp = decay.timestamps->get(ids ? ids[i] : segment * kBlockRows + i);
+        if (std::isnan(timestamp)) {
+            summary.undated = true;
+        } else {
+            summary.oldest = std::min(summary.oldest, timestamp);
+            summary.newest = std::max(summary.newest, timestamp);
+        }
+    }
+    // Slack for rounding between this and the scan's distance kernels
+    summary.radius = std::sqrt(radius_sqr) * 1.0001f + 1e-6f;
+    summary.rows = count;
+    summary.version = version;
+    summary.valid = true;
+    if (ivf) {
+        ivf->invlists->release_codes(segment, codes);
+        ivf->invlists->release_ids(segment, ids);
+    }
+}
+
+void FreshnessSearcher::segment_bounds(const faiss::Index& base, const IndexVersionTracker* versions,
+                                       const float* query, const TimeDecay& decay,
+                                       const std::vector<int64_t>& segments, std::vector<float>& bounds) {
+    size_t d = static_cast<size_t>(base.d);
+    const faiss::IndexIVF* ivf = dynamic_cast<const faiss::IndexIVF*>(&base);
+    std::unordered_map<int64_t, uint64_t> list_versions;
+    if (ivf && versions) {
+        for (const auto& entry : versions->capture(segments).list_versions) {
+            list_versions[entry.first] = entry.second;
+        }
+    }
+
+    bool inner_product = base.metric_type == faiss::METRIC_INNER_PRODUCT;
+    float query_norm = std::sqrt(simd::norm_sqr(query, d));
+    bounds.resize(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        int64_t segment = segments[i];
+        uint64_t version = list_versions.count(segment) ? list_versions[segment] : 0;
+        const Summary& summary = summaries_[segment];
+        bool stale = !summary.valid ||
+                     (ivf && (summary.rows != ivf->invlists->list_size(segment) || summary.version != version));
+        if (stale) {
+            summarize(base, segment, decay, version);
+        }
+
+        // Newest documents decay least, oldest most; undated ones count as
+        // undecayed here, as their timestamp may be set after summarizing
+        float best_factor = summary.undated ? 1.0f : decay.factor_at(summary.newest);
+        float worst_factor = summary.undated ? 0.0f : decay.factor_at(summary.oldest);
+        if (inner_product) {
+            float upper = simd::dot(query, summary.centroid.data(), d) + query_norm * summary.radius;
+            bounds[i] = upper >= 0.0f ? upper * best_factor : upper * worst_factor;
+        } else {
+            float lower = std::max(0.0f, std::sqrt(simd::l2_sqr(query, summary.centroid.data(), d)) - summary.radius);
+            bounds[i] = best_factor > 0.0f ? -(lower * lower) / best_factor : -FLT_MAX;
+        }
+    }
+}
+
+void FreshnessSearcher::search(const std::shared_ptr<const faiss::Index>& serving,
+                               const IndexVersionTracker* versions, faiss::idx_t n, const float* x, faiss::idx_t k,
+                               const TimeDecay& decay, const faiss::IDSelector* sel, float* distances,
+                               faiss::idx_t* labels) {
+    searches_.fetch_add(static_cast<uint64_t>(n));
+    size_t d = static_cast<size_t>(serving->d);
+    size_t top = static_cast<size_t>(k);
+    bool inner_product = serving->metric_type == faiss::METRIC_INNER_PRODUCT;
+    auto* lsm = dynamic_cast<const LsmIndex*>(serving.get());
+
+    // The concrete index under any wrappers; merges keep its type
+    auto unwrap = [](std::shared_ptr<const faiss::Index> layer) {
+        while (auto* layered = dynamic_cast<const LayeredIndex*>(layer.get())) {
+            layer = layered->base_index();
+        }
+        return layer;
+    };
+    auto base = unwrap(serving);
+    auto* flat = dynamic_cast<const faiss::IndexFlat*>(base.get());
+    auto* ivf = dynamic_cast<const faiss::IndexIVFFlat*>(base.get());
+
+    std::vector<std::vector<Candidate>> heaps(n);
+    if (!flat && !ivf) {
+        // Graph and compressed indexes cannot be scanned by segment:
+        // re-score a wider undecayed candidate set
+        fallback_searches_.fetch_add(static_cast<uint64_t>(n));
+        faiss::idx_t fetch = k * candidate_multiplier_;
+        std::vector<float> candidate_distances(n * fetch);
+        std::vector<faiss::idx_t> candidate_labels(n * fetch);
+        auto params = candidate_parameters(*base, sel, fetch);
+        serving->search(n, x, fetch, candidate_distances.data(), candidate_labels.data(), params.get());
+        for (faiss::idx_t q = 0; q < n; ++q) {
+            for (faiss::idx_t i = q * fetch; i < (q + 1) * fetch; ++i) {
+                faiss::idx_t id = candidate_labels[i];
+                if (id >= 0) {
+                    keep_best(heaps[q], top, decayed(candidate_distances[i], decay.factor(id), inner_product), id);
+                }
+            }
+        }
+    } else {
+        // Delta segments first: they hold the newest documents, so the heap
+        // starts with high decayed scores and the main scan skips more
+        std::shared_ptr<const faiss::Index> main = serving;
+        if (lsm) {
+            size_t delta_scored = 0;
+            main = lsm->visit_delta([&](const faiss::idx_t* ids, const float* vectors, size_t count) {
+                std::vector<float> factors(count);
+                for (size_t i = 0; i < count; ++i) {
+                    bool live = !lsm->is_removed(ids[i]) && (!sel || sel->is_member(ids[i]));
+                    factors[i] = live ? decay.factor(ids[i]) : -1.0f;
+                }
+                std::vector<float> raw(count);
+                for (faiss::idx_t q = 0; q < n; ++q) {
+                    if (inner_product) {
+                        simd::dot_many(x + q * d, vectors, count, d, raw.data());
+                    } else {
+                        simd::l2_sqr_many(x + q * d, vectors, count, d, raw.data());
+                    }
+                    for (size_t i = 0; i < count; ++i) {
+                        if (factors[i] >= 0.0f) {
+                            keep_best(heaps[q], top, decayed(raw[i], factors[i], inner_product), ids[i]);
+                        }
+                    }
+                }
+                delta_scored += count;
+            });
+            delta_vectors_scored_.fetch_add(delta_scored * static_cast<uint64_t>(n));
+            base = unwrap(main);
+            flat = dynamic_cast<const faiss::IndexFlat*>(base.get());
+            ivf = dynamic_cast<const faiss::IndexIVFFlat*>(base.get());
+        }
+        LiveSelector live(lsm, sel);
+        const faiss::IDSelector* main_sel = lsm || sel ? &live : nullptr;
+        {
+            std::lock_guard<std::mutex> lock(summaries_mutex_);
+            track(base, decay);
+        }
+
+        #pragma omp parallel for schedule(dynamic) if (n > 1)
+        for (faiss::idx_t q = 0; q < n; ++q) {
+            const float* query = x + q * d;
+            std::vector<Candidate>& heap = heaps[q];
+            std::vector<float> raw(kBlockRows);
+            size_t scored = 0;
+
+            // Scores count contiguous vectors; ids null means rows from first
+            auto scan = [&](const float* vectors, size_t count, faiss::idx_t first, const faiss::idx_t* ids) {
+                for (size_t offset = 0; offset < count; offset += kBlockRows) {
+                    size_t chunk = std::min(kBlockRows, count - offset);
+                    const float* chunk_vectors = vectors + offset * d;
+                    if (inner_product) {
+                        simd::dot_many(query, chunk_vectors, chunk, d, raw.data());
+                    } else {
+                        simd::l2_sqr_many(query, chunk_vectors, chunk, d, raw.data());
+                    }
+                    for (size_t i = 0; i < chunk; ++i) {
+                        // Decay never raises a score above max(similarity, 0)
+                        // or -distance, so most rows stop before the lookup
+                        float ceiling = inner_product ? std::max(raw[i], 0.0f) : -raw[i];
+                        if (!can_enter(heap, top, ceiling)) {
+                            continue;
+                        }
+                        faiss::idx_t id = ids ? ids[offset + i] : first + static_cast<faiss::idx_t>(offset + i);
+                        float score = decayed(raw[i], decay.factor(id), inner_product);
+                        if (can_enter(heap, top, score) && (!main_sel || main_sel->is_member(id))) {
+                            keep_best(heap, top, score, id);
+                        }
+                    }
+                    scored += chunk;
+                }
+            };
+
+            std::vector<int64_t> segments;
+            faiss::idx_t tail_first = 0;
+            if (flat) {
+                size_t complete = static_cast<size_t>(flat->ntotal) / kBlockRows;
+                segments.resize(complete);
+                std::iota(segments.begin(), segments.end(), 0);
+                tail_first = static_cast<faiss::idx_t>(complete * kBlockRows);
+                // The partial last block is the newest; always scanned, first
+                scan(flat->get_xb() + tail_first * d, static_cast<size_t>(flat->ntotal - tail_first), tail_first,
+                     nullptr);
+            } else {
+                size_t nprobe = std::min(ivf->nprobe, ivf->nlist);
+                std::vector<float> coarse_distances(nprobe);
+                std::vector<faiss::idx_t> coarse_lists(nprobe);
+                ivf->quantizer->search(1, query, static_cast<faiss::idx_t>(nprobe), coarse_distances.data(),
+                                       coarse_lists.data());
+                for (faiss::idx_t list_no : coarse_lists) {
+                    if (list_no >= 0 && ivf->invlists->list_size(list_no) > 0) {
+                        segments.push_back(list_no);
+                    }
+                }
+            }
+
+            std::vector<float> bounds;
+            {
+                std::lock_guard<std::mutex> lock(summaries_mutex_);
+                segment_bounds(*base, lsm ? nullptr : versions, query, decay, segments, bounds);
+            }
+            std::vector<size_t> order(segments.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&bounds](size_t a, size_t b) { return bounds[a] > bounds[b]; });
+
+            size_t scanned = 0;
+            for (size_t position : order) {
+                // Best bound first: once one cannot beat the k-th score, none can
+                if (!can_enter(heap, top, bounds[position])) {
+                    break;
+                }
+                int64_t segment = segments[position];
+                if (flat) {
+                    faiss::idx_t first = segment * static_cast<faiss::idx_t>(kBlockRows);
+                    scan(flat->get_xb() + first * d, kBlockRows, first, nullptr);
+                } else {
+                    size_t list_size = ivf->invlists->list_size(segment);
+                    const uint8_t* codes = ivf->invlists->get_codes(segment);
+                    const faiss::idx_t* ids = ivf->invlists->get_ids(segment);
+                    scan(reinterpret_cast<const float*>(codes), list_size, 0, ids);
+                    ivf->invlists->release_codes(segment, codes);
+                    ivf->invlists->release_ids(segment, ids);
+                }
+                ++scanned;
+            }
+            segments_scanned_.fetch_add(scanned, std::memory_order_relaxed);
+            segments_skipped_.fetch_add(segments.size() - scanned, std::memory_order_relaxed);
+            vectors_scored_.fetch_add(scored, std::memory_order_relaxed);
+        }
+    }
+
+    for (faiss::idx_t q = 0; q < n; ++q) {
+        auto& heap = heaps[q];
+        std::sort(heap.begin(), heap.end(), [](const Candidate& a, const Candidate& b) { return a.first > b.first; });
+        for (size_t i = 0; i < top; ++i) {
+            size_t slot = static_cast<size_t>(q) * top + i;
+            if (i < heap.size()) {
+                distances[slot] = inner_product ? heap[i].first : std::min(-heap[i].first, FLT_MAX);
+                labels[slot] = heap[i].second;
+            } else {
+                distances[slot] = inner_product ? -FLT_MAX : FLT_MAX;
+                labels[slot] = -1;
+            }
+        }
+    }
+}
+
+nlohmann::json FreshnessSearcher::get_statistics() const {
+    nlohmann::json stats;
+    stats["field"] = field_;
+    stats["candidate_multiplier"] = candidate_multiplier_;
+    stats["block_rows"] = kBlockRows;
+    {
+        std::lock_guard<std::mutex> lock(summaries_mutex_);
+        stats["summaries"] = std::count_if(summaries_.begin(), summaries_.end(),
+                                           [](const Summary& summary) { return summary.valid; });
+    }
+    uint64_t scanned = segments_scanned_.load();
+    uint64_t skipped = segments_skipped_.load();
+    stats["searches"] = searches_.load();
+    stats["fallback_searches"] = fallback_searches_.load();
+    stats["segments_scanned"] = scanned;
+    stats["segments_skipped"] = skipped;
+    stats["skip_rate"] = scanned + skipped > 0 ? static_cast<double>(skipped) / (scanned + skipped) : 0.0;
+    stats["vectors_scored"] = vectors_scored_.load();
+    stats["delta_vectors_scored"] = delta_vectors_scored_.load();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::enable_freshness_scoring(const std::string& field, int candidate_multiplier) {
+    // The timestamps are read from the metadata columns
+    std::stringstream list(config_.metadata_filter_fields);
+    bool indexed = config_.metadata_filter_fields.empty();
+    for (std::string entry; !indexed && std::getline(list, entry, ',');) {
+        entry.erase(0, entry.find_first_not_of(" \t"));
+        entry.erase(entry.find_last_not_of(" \t") + 1);
+        indexed = entry == field;
+    }
+    if (!indexed) {
+        std::cerr << "Freshness field " << field << " is not in METADATA_FILTER_FIELDS; time decay not enabled"
+                  << std::endl;
+        return false;
+    }
+
+    std::atomic_store(&freshness_, std::make_shared<FreshnessSearcher>(field, candidate_multiplier));
+    std::cout << "Time-decayed search enabled on " << field;
+    if (config_.freshness_decay_lambda > 0) {
+        std::cout << " (default decay " << config_.freshness_decay_lambda << " per day)";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+bool VectorSearchEngine::search_with_decay(const float* queries, size_t n, int k, double decay_lambda,
+                                           const MetadataFilter* filter, float* distances, faiss::idx_t* labels) {
+    auto freshness = std::atomic_load(&freshness_);
+    double lambda = decay_lambda > 0 ? decay_lambda : config_.freshness_decay_lambda;
+    if (!freshness || lambda <= 0) {
+        return false;
+    }
+    auto columns = std::atomic_load(&metadata_columns_);
+    const ChunkedColumn<double>* timestamps = columns ? columns->numbers(freshness->field()) : nullptr;
+    if (!timestamps) {
+        return false;
+    }
+
+    std::shared_ptr<faiss::Index> serving;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        serving = serving_index();
+    }
+    if (!serving) {
+        return false;
+    }
+
+    TimeDecay decay;
+    decay.lambda = lambda;
+    decay.now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    decay.timestamps = timestamps;
+    freshness->search(serving, &index_versions_, static_cast<faiss::idx_t>(n), queries, k, decay, filter,
+                      distances, labels);
+    return true;
+}
+
+nlohmann::json VectorSearchEngine::get_freshness_statistics() const {
+    auto freshness = std::atomic_load(&freshness_);
+    if (!freshness) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = freshness->get_statistics();
+    stats["enabled"] = true;
+    stats["default_lambda"] = config_.freshness_decay_lambda;
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,258 @@
+/**
+ * @file id_map.cpp
+ * @brief Mapping between external document ids and internal vector ids
+ */
+
+#include "id_map.h"
+#include "lsm_index.h"
+#include "metadata_filter.h"
+#include "vector_search.h"
+
+#include <iostream>
+#include <unordered_set>
+
+#include <faiss/IndexIVF.h>
+#include <faiss/impl/IDSelector.h>
+
+namespace neurorag {
+
+DocumentIdMap::DocumentIdMap(size_t expected)
+    : forward_(expected), reverse_(expected) {}
+
+int64_t DocumentIdMap::find(const std::string& external_id) const {
+    int64_t internal_id;
+    return forward_.find(external_id, internal_id) ? internal_id : -1;
+}
+
+bool DocumentIdMap::external_id(int64_t internal_id, std::string& external_id) const {
+    return reverse_.find(internal_id, external_id);
+}
+
+int64_t DocumentIdMap::assign(const std::string& external_id, int64_t internal_id) {
+    int64_t previous = -1;
+    // Reverse first, so a vector found by search already resolves
+    reverse_.upsert(internal_id, external_id);
+    if (forward_.upsert(external_id, internal_id, &previous) && previous != internal_id) {
+        reverse_.erase_if_equal(previous, external_id);
+    }
+    return previous;
+}
+
+int64_t DocumentIdMap::erase(const std::string& external_id) {
+    int64_t internal_id = -1;
+    if (forward_.erase(external_id, &internal_id)) {
+        reverse_.erase_if_equal(internal_id, external_id);
+        return internal_id;
+    }
+    return -1;
+}
+
+bool DocumentIdMap::erase_internal(int64_t internal_id) {
+    std::string external_id;
+    if (!reverse_.erase(internal_id, &external_id)) {
+        return false;
+    }
+    forward_.erase_if_equal(external_id, internal_id);
+    return true;
+}
+
+void DocumentIdMap::clear() {
+    forward_.clear();
+    reverse_.clear();
+}
+
+nlohmann::json DocumentIdMap::get_statistics() const {
+    nlohmann::json stats;
+    stats["documents"] = size();
+    stats["by_external_id"] = forward_.get_statistics();
+    stats["by_internal_id"] = reverse_.get_statistics();
+    return stats;
+}
+
+bool metadata_document_id(const std::string& metadata, std::string& external_id) {
+    if (metadata.empty() || metadata.front() != '{') {
+        return false;
+    }
+    auto document = nlohmann::json::parse(metadata, nullptr, false);
+    if (document.is_discarded() || !document.is_object()) {
+        return false;
+    }
+    auto id = document.find("id");
+    if (id == document.end()) {
+        return false;
+    }
+    if (id->is_string()) {
+        external_id = id->get<std::string>();
+        return true;
+    }
+    if (id->is_number_integer()) {
+        external_id = id->dump();
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::upsert_vectors(const std::vector<std::string>& external_ids,
+                                        const std::vector<std::vector<float>>& vectors,
+                                        const std::vector<std::string>& metadata) {
+    const size_t n = vectors.size();
+    if (external_ids.size() != n || (!metadata.empty() && metadata.size() != n)) {
+        std::cerr << "upsert_vectors: " << n << " vectors with " << external_ids.size() << " ids and "
+                  << metadata.size() << " metadata entries" << std::endl;
+        return false;
+    }
+    if (n == 0) {
+        return true;
+    }
+
+    std::unordered_set<std::string> seen;
+    std::vector<float> data(n * config_.dimension);
+    size_t metadata_bytes = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (external_ids[i].empty() || !seen.insert(external_ids[i]).second) {
+            std::cerr << "upsert_vectors: empty or repeated document id '" << external_ids[i] << "'" << std::endl;
+            return false;
+        }
+        if (vectors[i].size() != static_cast<size_t>(config_.dimension)) {
+            std::cerr << "upsert_vectors: document '" << external_ids[i] << "' has dimension "
+                      << vectors[i].size() << ", expected " << config_.dimension << std::endl;
+            return false;
+        }
+        std::copy(vectors[i].begin(), vectors[i].end(), data.begin() + i * config_.dimension);
+    }
+
+    // Metadata carries the id, so rebuild_document_ids recovers the map
+    // from a snapshot or reload
+    std::vector<std::string> documents(n);
+    for (size_t i = 0; i < n; ++i) {
+        std::string stored_id;
+        const std::string& entry = metadata.empty() ? documents[i] : metadata[i];
+        if (metadata_document_id(entry, stored_id) && stored_id == external_ids[i]) {
+            documents[i] = entry;
+            continue;
+        }
+        auto document = nlohmann::json::parse(entry.empty() ? "{}" : entry, nullptr, false);
+        if (document.is_discarded() || !document.is_object()) {
+            document = {{"text", entry}};
+        }
+        document["id"] = external_ids[i];
+        documents[i] = document.dump();
+    }
+    for (const auto& document : documents) {
+        metadata_bytes += document.size();
+    }
+
+    MemoryReservation reservation;
+    if (!admit_insert(n, metadata_bytes, reservation)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto serving = serving_index();
+    auto lsm = std::dynamic_pointer_cast<LsmIndex>(serving);
+    auto base = base_index();
+    // IVF removes an id from its list and takes it back; the delta index
+    // tombstones it and the document moves to a fresh id. Flat indexes
+    // renumber on remove and HNSW cannot remove at all
+    bool same_id = !lsm && dynamic_cast<const faiss::IndexIVF*>(base.get()) != nullptr;
+
+    std::vector<int64_t> replaced;
+    std::vector<int64_t> previous(n);
+    for (size_t i = 0; i < n; ++i) {
+        previous[i] = document_ids_.find(external_ids[i]);
+        if (previous[i] >= 0) {
+            replaced.push_back(previous[i]);
+        }
+    }
+    if (!replaced.empty() && !lsm && !same_id) {
+        std::cerr << "upsert_vectors: " << replaced.size() << " documents already exist and the "
+                  << base->ntotal << "-vector index cannot replace vectors; enable DELTA_INDEX_TYPE" << std::endl;
+        return false;
+    }
+
+    size_t next_id;
+    {
+        std::lock_guard<std::mutex> metadata_lock(metadata_mutex_);
+        next_id = metadata_.size();
+    }
+    std::vector<faiss::idx_t> ids(n);
+    for (size_t i = 0; i < n; ++i) {
+        ids[i] = same_id && previous[i] >= 0 ? previous[i] : static_cast<faiss::idx_t>(next_id++);
+    }
+
+    std::vector<float> transformed;
+    const float* index_vectors = preprocess_vectors(data.data(), n, transformed);
+    try {
+        if (!replaced.empty()) {
+            record_vectors_removed(replaced);
+            faiss::IDSelectorBatch selector(replaced.size(), replaced.data());
+            serving->remove_ids(selector);
+        }
+        if (replaced.empty() && !lsm && !same_id) {
+            // Flat and HNSW number vectors themselves, in metadata order
+            serving->add(static_cast<faiss::idx_t>(n), index_vectors);
+        } else {
+            serving->add_with_ids(static_cast<faiss::idx_t>(n), index_vectors, ids.data());
+        }
+    } catch (const std::exception& e) {
+        // Replaced documents stay mapped; searches no longer return them
+        std::cerr << "upsert_vectors failed: " << e.what() << std::endl;
+        return false;
+    }
+    record_vectors_added(index_vectors, n);
+
+    {
+        std::lock_guard<std::mutex> metadata_lock(metadata_mutex_);
+        auto columns = std::atomic_load(&metadata_columns_);
+        if (metadata_.size() < next_id) {
+            metadata_.resize(next_id);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            metadata_[ids[i]] = std::move(documents[i]);
+            if (columns) {
+                columns->set(ids[i], metadata_[ids[i]]);
+            }
+            if (previous[i] >= 0 && previous[i] != ids[i]) {
+                // Tombstoned; freed now rather than at the next snapshot
+                std::string().swap(metadata_[previous[i]]);
+                if (columns) {
+                    columns->set(previous[i], metadata_[previous[i]]);
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        document_ids_.assign(external_ids[i], ids[i]);
+    }
+    update_partitions(ids.data(), n, index_vectors, replaced);
+
+    reservation.commit(lsm ? MemoryComponent::DELTA : MemoryComponent::INDEX);
+    return true;
+}
+
+int64_t VectorSearchEngine::find_document(const std::string& external_id) const {
+    return document_ids_.find(external_id);
+}
+
+size_t VectorSearchEngine::rebuild_document_ids() {
+    std::lock_guard<std::mutex> lock(metadata_mutex_);
+    document_ids_.clear();
+    std::string external_id;
+    for (size_t i = 0; i < metadata_.size(); ++i) {
+        // Later entries win, as they do after an upsert moved a document
+        if (metadata_document_id(metadata_[i], external_id)) {
+            document_ids_.assign(external_id, static_cast<int64_t>(i));
+        }
+    }
+    return document_ids_.size();
+}
+
+nlohmann::json VectorSearchEngine::get_document_id_statistics() const {
+    return document_ids_.get_statistics();
+}
+
+} // namespace neurorag
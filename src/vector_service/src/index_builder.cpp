@@ -0,0 +1,839 @@
+/**
+ * @file index_builder.cpp
+ * @brief Parallel offline index construction (IVF training, HNSW, DiskANN)
+ */
+
+#include "index_builder.h"
+#include "index_file.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <omp.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVFFlat.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/index_io.h>
+#include <faiss/invlists/OnDiskInvertedLists.h>
+
+#ifndef FINTEGER
+#define FINTEGER int
+#endif
+
+extern "C" {
+// BLAS (MKL) matrix multiply, column major
+int sgemm_(const char* transa, const char* transb, FINTEGER* m, FINTEGER* n, FINTEGER* k,
+           const float* alpha, const float* a, FINTEGER* lda, const float* b, FINTEGER* ldb,
+           float* beta, float* c, FINTEGER* ldc);
+}
+
+namespace neurorag {
+
+namespace {
+
+// Tile sizes for assignment: a 1024 x 1024 float tile is 4 MB per thread
+constexpr size_t kVectorTile = 1024;
+constexpr size_t kCentroidTile = 1024;
+constexpr size_t kPointsPerCentroid = 256;
+constexpr size_t kRecallCorpusSize = 50000;
+constexpr double kProgressIntervalSeconds = 2.0;
+
+std::string format_count(double value) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (value >= 1e9) {
+        out << value / 1e9 << "G";
+    } else if (value >= 1e6) {
+        out << value / 1e6 << "M";
+    } else if (value >= 1e3) {
+        out << value / 1e3 << "k";
+    } else {
+        out << std::setprecision(0) << value;
+    }
+    return out.str();
+}
+
+void normalize_rows(float* x, size_t n, int d) {
+    for (size_t i = 0; i < n; ++i) {
+        float* row = x + i * d;
+        double norm = 0.0;
+        for (int j = 0; j < d; ++j) {
+            norm += static_cast<double>(row[j]) * row[j];
+        }
+        if (norm > 0.0) {
+            float scale = static_cast<float>(1.0 / std::sqrt(norm));
+            for (int j = 0; j < d; ++j) {
+                row[j] *= scale;
+            }
+        }
+    }
+}
+
+// Fill empty clusters by splitting large ones, as faiss::Clustering does
+size_t split_empty_clusters(std::vector<float>& centroids, std::vector<double>& counts, int d,
+                          faiss::MetricType metric, std::mt19937_64& rng) {
+    constexpr float kEpsilon = 1.0f / 1024;
+    size_t k = counts.size();
+    double total = std::accumulate(counts.begin(), counts.end(), 0.0);
+    if (total == 0.0) {
+        return 0;
+    }
+    size_t split = 0;
+    for (size_t empty = 0; empty < k; ++empty) {
+        if (counts[empty] > 0.0) {
+            continue;
+        }
+        // Pick a donor with probability proportional to its size
+        size_t donor = 0;
+        while (true) {
+            std::uniform_real_distribution<double> pick(0.0, total);
+            double target = pick(rng);
+            double cumulative = 0.0;
+            for (donor = 0; donor + 1 < k; ++donor) {
+                cumulative += counts[donor];
+                if (cumulative > target) {
+                    break;
+                }
+            }
+            if (counts[donor] > 0.0) {
+                break;
+            }
+        }
+        float* donor_centroid = &centroids[donor * d];
+        float* new_centroid = &centroids[empty * d];
+        for (int j = 0; j < d; ++j) {
+            float sign = (j % 2 == 0) ? 1.0f : -1.0f;
+            new_centroid[j] = donor_centroid[j] * (1.0f + sign * kEpsilon);
+            donor_centroid[j] = donor_centroid[j] * (1.0f - sign * kEpsilon);
+        }
+        counts[empty] = counts[donor] / 2;
+        counts[donor] -= counts[empty];
+        if (metric == faiss::METRIC_INNER_PRODUCT) {
+            normalize_rows(new_centroid, 1, d);
+            normalize_rows(donor_centroid, 1, d);
+        }
+        ++split;
+    }
+    return split;
+}
+
+/**
+ * Mini-batch k-means (Sculley, 2010): each step assigns a random batch
+ * and moves every touched centroid towards the batch mean with a
+ * per-centroid rate of batch_count / total_count.
+ */
+std::vector<float> minibatch_kmeans(size_t n, const float* x, int d, size_t k,
+                                    const IndexBuildOptions& options, uint64_t seed,
+                                    BuildProgress* progress) {
+    std::mt19937_64 rng(seed);
+    std::vector<float> centroids(k * d);
+    std::vector<double> counts(k, 0.0);
+
+    // Random distinct training points as initial centroids
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), size_t{0});
+    for (size_t i = 0; i < std::min(n, k); ++i) {
+        std::uniform_int_distribution<size_t> pick(i, n - 1);
+        std::swap(order[i], order[pick(rng)]);
+        std::memcpy(&centroids[i * d], x + order[i] * d, d * sizeof(float));
+    }
+    if (n <= k) {
+        // Fewer points than centroids: the rest are split off below
+        for (size_t i = 0; i < n; ++i) {
+            counts[i] = 1.0;
+        }
+        split_empty_clusters(centroids, counts, d, options.metric, rng);
+        return centroids;
+    }
+    if (options.metric == faiss::METRIC_INNER_PRODUCT) {
+        normalize_rows(centroids.data(), k, d);
+    }
+
+    size_t batch_size = std::min(options.kmeans_batch_size, n);
+    size_t iterations = std::max<size_t>(1, static_cast<size_t>(options.kmeans_epochs) * n / batch_size);
+    std::vector<float> batch(batch_size * d);
+    std::vector<faiss::idx_t> labels(batch_size);
+    std::vector<size_t> members(batch_size);
+    std::vector<size_t> offsets(k + 1);
+    std::vector<size_t> touched;
+
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
+        std::vector<size_t> picks(batch_size);
+        for (auto& pick : picks) {
+            pick = rng() % n;
+        }
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < batch_size; ++i) {
+            std::memcpy(&batch[i * d], x + picks[i] * d, d * sizeof(float));
+        }
+        assign_to_centroids(batch_size, batch.data(), d, centroids.data(), k, options.metric, labels.data());
+
+        // Group the batch by centroid so only touched centroids are visited
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (size_t i = 0; i < batch_size; ++i) {
+            ++offsets[labels[i] + 1];
+        }
+        touched.clear();
+        for (size_t c = 0; c < k; ++c) {
+            if (offsets[c + 1] > 0) {
+                touched.push_back(c);
+            }
+            offsets[c + 1] += offsets[c];
+        }
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < batch_size; ++i) {
+            members[fill[labels[i]]++] = i;
+        }
+
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (size_t t = 0; t < touched.size(); ++t) {
+            size_t c = touched[t];
+            size_t begin = offsets[c];
+            size_t end = offsets[c + 1];
+            double batch_count = static_cast<double>(end - begin);
+            float rate = static_cast<float>(batch_count / (counts[c] + batch_count));
+            std::vector<double> mean(d, 0.0);
+            for (size_t m = begin; m < end; ++m) {
+                const float* point = &batch[members[m] * d];
+                for (int j = 0; j < d; ++j) {
+                    mean[j] += point[j];
+                }
+            }
+            float* centroid = &centroids[c * d];
+            for (int j = 0; j < d; ++j) {
+                centroid[j] += rate * (static_cast<float>(mean[j] / batch_count) - centroid[j]);
+            }
+            if (options.metric == faiss::METRIC_INNER_PRODUCT) {
+                normalize_rows(centroid, 1, d);
+            }
+            counts[c] += batch_count;
+        }
+
+        if (progress) {
+            progress->advance(batch_size);
+        }
+    }
+
+    size_t split = split_empty_clusters(centroids, counts, d, options.metric, rng);
+    if (split > 0 && progress) {
+        std::cout << "k-means: split " << split << " empty clusters" << std::endl;
+    }
+    return centroids;
+}
+
+/**
+ * Two-level k-means: sqrt(k) coarse clusters, then each coarse cluster
+ * is split into a share of the k centroids proportional to its size.
+ * The second level runs one coarse cluster per thread.
+ */
+std::vector<float> hierarchical_kmeans(size_t n, const float* x, int d, size_t k,
+                                       const IndexBuildOptions& options, BuildProgress* progress) {
+    size_t coarse_k = std::min(k, static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(k)))));
+    std::vector<float> coarse = minibatch_kmeans(n, x, d, coarse_k, options, 1234, progress);
+    std::vector<faiss::idx_t> labels(n);
+    assign_to_centroids(n, x, d, coarse.data(), coarse_k, options.metric, labels.data());
+
+    std::vector<std::vector<size_t>> groups(coarse_k);
+    for (size_t i = 0; i < n; ++i) {
+        groups[labels[i]].push_back(i);
+    }
+
+    // Largest-remainder split of k over the coarse clusters
+    std::vector<size_t> shares(coarse_k);
+    std::vector<std::pair<double, size_t>> remainders;
+    size_t assigned = 0;
+    for (size_t g = 0; g < coarse_k; ++g) {
+        double exact = static_cast<double>(k) * groups[g].size() / n;
+        shares[g] = static_cast<size_t>(exact);
+        assigned += shares[g];
+        if (!groups[g].empty()) {
+            remainders.emplace_back(exact - shares[g], g);
+        }
+    }
+    std::sort(remainders.rbegin(), remainders.rend());
+    for (size_t i = 0; assigned < k; i = (i + 1) % remainders.size()) {
+        ++shares[remainders[i].second];
+        ++assigned;
+    }
+
+    std::vector<size_t> first(coarse_k + 1, 0);
+    for (size_t g = 0; g < coarse_k; ++g) {
+        first[g + 1] = first[g] + shares[g];
+    }
+    std::vector<float> centroids(k * d);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t g = 0; g < coarse_k; ++g) {
+        if (shares[g] == 0) {
+            continue;
+        }
+        std::vector<float> points(groups[g].size() * d);
+        for (size_t i = 0; i < groups[g].size(); ++i) {
+            std::memcpy(&points[i * d], x + groups[g][i] * d, d * sizeof(float));
+        }
+        std::vector<float> fine = minibatch_kmeans(groups[g].size(), points.data(), d, shares[g],
+                                                   options, 1234 + g, nullptr);
+        std::memcpy(&centroids[first[g] * d], fine.data(), fine.size() * sizeof(float));
+        if (progress) {
+            progress->advance(static_cast<size_t>(options.kmeans_epochs) * groups[g].size());
+        }
+    }
+    return centroids;
+}
+
+// Random rows, gathered in file order for sequential reads of the map
+std::vector<float> sample_rows(const float* x, size_t n, int d, size_t sample_size) {
+    std::vector<size_t> rows(n);
+    std::iota(rows.begin(), rows.end(), size_t{0});
+    std::mt19937_64 rng(42);
+    for (size_t i = 0; i < sample_size; ++i) {
+        std::uniform_int_distribution<size_t> pick(i, n - 1);
+        std::swap(rows[i], rows[pick(rng)]);
+    }
+    rows.resize(sample_size);
+    std::sort(rows.begin(), rows.end());
+
+    std::vector<float> sample(sample_size * d);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < sample_size; ++i) {
+        std::memcpy(&sample[i * d], x + rows[i] * d, d * sizeof(float));
+    }
+    return sample;
+}
+
+bool write_index_atomically(const faiss::Index* index, const std::string& path, const IndexBuildOptions& options) {
+    if (options.checksummed) {
+        return write_index_file(*index, path);
+    }
+    std::string temp_path = path + ".tmp";
+    try {
+        faiss::write_index(index, temp_path.c_str());
+    } catch (const faiss::FaissException& e) {
+        std::cerr << "Index builder: cannot write " << temp_path << ": " << e.what() << std::endl;
+        return false;
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Index builder: cannot rename " << temp_path << " to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Add one chunk to an IVF index: assign, encode, then fill lists in parallel
+void add_ivf_chunk(faiss::IndexIVF& ivf, const float* centroids, size_t begin, size_t count,
+                   const float* x, faiss::MetricType metric) {
+    int d = static_cast<int>(ivf.d);
+    size_t nlist = ivf.nlist;
+    size_t code_size = ivf.code_size;
+
+    std::vector<faiss::idx_t> labels(count);
+    assign_to_centroids(count, x, d, centroids, nlist, metric, labels.data());
+    std::vector<uint8_t> codes(count * code_size);
+    ivf.encode_vectors(static_cast<faiss::idx_t>(count), x, labels.data(), codes.data());
+
+    std::vector<size_t> offsets(nlist + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++offsets[labels[i] + 1];
+    }
+    for (size_t list_no = 0; list_no < nlist; ++list_no) {
+        offsets[list_no + 1] += offsets[list_no];
+    }
+    std::vector<size_t> members(count);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        members[fill[labels[i]]++] = i;
+    }
+
+    // Lists are independent, so each thread appends to its own lists
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (size_t list_no = 0; list_no < nlist; ++list_no) {
+        size_t list_count = offsets[list_no + 1] - offsets[list_no];
+        if (list_count == 0) {
+            continue;
+        }
+        std::vector<uint8_t> list_codes(list_count * code_size);
+        std::vector<faiss::idx_t> list_ids(list_count);
+        for (size_t i = 0; i < list_count; ++i) {
+            size_t member = members[offsets[list_no] + i];
+            std::memcpy(&list_codes[i * code_size], &codes[member * code_size], code_size);
+            list_ids[i] = static_cast<faiss::idx_t>(begin + member);
+        }
+        ivf.invlists->add_entries(list_no, list_count, list_ids.data(), list_codes.data());
+    }
+    ivf.ntotal += static_cast<faiss::idx_t>(count);
+}
+
+// Row numbers of the k best scores, higher is better
+std::vector<size_t> top_k_rows(const std::vector<float>& scores, size_t k, size_t skip) {
+    std::vector<size_t> rows;
+    rows.reserve(scores.size());
+    for (size_t i = 0; i < scores.size(); ++i) {
+        if (i != skip) {
+            rows.push_back(i);
+        }
+    }
+    k = std::min(k, rows.size());
+    std::partial_sort(rows.begin(), rows.begin() + k, rows.end(),
+                      [&](size_t a, size_t b) { return scores[a] > scores[b]; });
+    rows.resize(k);
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// VectorFile
+// ---------------------------------------------------------------------------
+
+VectorFile::VectorFile()
+    : mapping_(nullptr),
+      mapping_size_(0),
+      data_(nullptr),
+      count_(0),
+      dimension_(0) {
+}
+
+VectorFile::~VectorFile() {
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+}
+
+bool VectorFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 8) {
+        std::cerr << path << " is empty or unreadable" << std::endl;
+        close(fd);
+        return false;
+    }
+    mapping_size_ = static_cast<size_t>(st.st_size);
+    mapping_ = mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        std::cerr << "Cannot map " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    madvise(mapping_, mapping_size_, MADV_SEQUENTIAL);
+    const char* bytes = static_cast<const char*>(mapping_);
+
+    size_t header_size = 0;
+    if (mapping_size_ >= 10 && std::memcmp(bytes, "\x93NUMPY", 6) == 0) {
+        // .npy: magic, version, header length, then a Python dict literal
+        uint8_t major = static_cast<uint8_t>(bytes[6]);
+        size_t dict_length;
+        size_t dict_start;
+        if (major == 1) {
+            uint16_t length;
+            std::memcpy(&length, bytes + 8, sizeof(length));
+            dict_length = length;
+            dict_start = 10;
+        } else {
+            uint32_t length;
+            std::memcpy(&length, bytes + 8, sizeof(length));
+            dict_length = length;
+            dict_start = 12;
+        }
+        if (dict_start + dict_length > mapping_size_) {
+            std::cerr << path << " has a truncated .npy header" << std::endl;
+            return false;
+        }
+        std::string dict(bytes + dict_start, dict_length);
+        size_t shape = dict.find("'shape': (");
+        if (dict.find("'descr': '<f4'") == std::string::npos ||
+            dict.find("'fortran_order': False") == std::string::npos || shape == std::string::npos) {
+            std::cerr << path << " must be a C-order float32 array" << std::endl;
+            return false;
+        }
+        unsigned long long rows = 0;
+        unsigned long long columns = 0;
+        if (std::sscanf(dict.c_str() + shape, "'shape': (%llu, %llu)", &rows, &columns) != 2) {
+            std::cerr << path << " must be a 2-D array" << std::endl;
+            return false;
+        }
+        count_ = static_cast<size_t>(rows);
+        dimension_ = static_cast<int>(columns);
+        header_size = dict_start + dict_length;
+    } else {
+        // .fbin: uint32 count, uint32 dimension
+        uint32_t rows;
+        uint32_t columns;
+        std::memcpy(&rows, bytes, sizeof(rows));
+        std::memcpy(&columns, bytes + 4, sizeof(columns));
+        count_ = rows;
+        dimension_ = static_cast<int>(columns);
+        header_size = 8;
+    }
+
+    if (dimension_ <= 0 || count_ == 0 ||
+        header_size + count_ * dimension_ * sizeof(float) > mapping_size_) {
+        std::cerr << path << ": " << count_ << " x " << dimension_ << " does not match the file size" << std::endl;
+        return false;
+    }
+    data_ = reinterpret_cast<const float*>(bytes + header_size);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// BuildProgress
+// ---------------------------------------------------------------------------
+
+BuildProgress::BuildProgress(std::string stage, size_t total, std::string unit)
+    : stage_(std::move(stage)),
+      unit_(std::move(unit)),
+      total_(total),
+      done_(0),
+      start_(std::chrono::steady_clock::now()),
+      last_print_(start_) {
+}
+
+void BuildProgress::advance(size_t done) {
+    size_t completed = done_.fetch_add(done) + done;
+    auto now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(print_mutex_, std::try_to_lock);
+    if (!lock.owns_lock() ||
+        std::chrono::duration<double>(now - last_print_).count() < kProgressIntervalSeconds) {
+        return;
+    }
+    last_print_ = now;
+    double elapsed = std::chrono::duration<double>(now - start_).count();
+    double rate = completed / std::max(elapsed, 1e-9);
+    double remaining = completed < total_ ? (total_ - completed) / std::max(rate, 1e-9) : 0.0;
+    std::ostringstream line;
+    line << "[" << stage_ << "] " << format_count(completed) << "/" << format_count(total_) << " "
+         << unit_ << " (" << std::fixed << std::setprecision(1)
+         << 100.0 * completed / std::max<size_t>(total_, 1) << "%), "
+         << format_count(rate) << " " << unit_ << "/s, ETA " << std::setprecision(0) << remaining << " s";
+    std::cout << line.str() << std::endl;
+}
+
+double BuildProgress::finish() {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    size_t completed = done_.load();
+    std::ostringstream line;
+    line << "[" << stage_ << "] done: " << format_count(completed) << " " << unit_ << " in "
+         << std::fixed << std::setprecision(1) << elapsed << " s ("
+         << format_count(completed / std::max(elapsed, 1e-9)) << " " << unit_ << "/s)";
+    std::cout << line.str() << std::endl;
+    return elapsed;
+}
+
+// ---------------------------------------------------------------------------
+// Training and assignment
+// ---------------------------------------------------------------------------
+
+void assign_to_centroids(size_t n, const float* x, int d, const float* centroids, size_t k,
+                         faiss::MetricType metric, faiss::idx_t* labels, float* distances) {
+    bool inner_product = metric == faiss::METRIC_INNER_PRODUCT;
+    std::vector<float> centroid_norms(k, 0.0f);
+    if (!inner_product) {
+        for (size_t c = 0; c < k; ++c) {
+            const float* centroid = centroids + c * d;
+            float norm = 0.0f;
+            for (int j = 0; j < d; ++j) {
+                norm += centroid[j] * centroid[j];
+            }
+            centroid_norms[c] = norm;
+        }
+    }
+
+    size_t tiles = (n + kVectorTile - 1) / kVectorTile;
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t tile = 0; tile < tiles; ++tile) {
+        size_t first = tile * kVectorTile;
+        size_t count = std::min(kVectorTile, n - first);
+        std::vector<float> products(count * kCentroidTile);
+        std::vector<float> best(count, inner_product ? -std::numeric_limits<float>::max()
+                                                     : std::numeric_limits<float>::max());
+        std::vector<faiss::idx_t> best_label(count, -1);
+
+        for (size_t c0 = 0; c0 < k; c0 += kCentroidTile) {
+            size_t centroid_count = std::min(kCentroidTile, k - c0);
+            // products[v * centroid_count + c] = <x_v, centroid_c>
+            FINTEGER m = static_cast<FINTEGER>(centroid_count);
+            FINTEGER nn = static_cast<FINTEGER>(count);
+            FINTEGER kk = static_cast<FINTEGER>(d);
+            FINTEGER lda = kk;
+            FINTEGER ldb = kk;
+            FINTEGER ldc = m;
+            float one = 1.0f;
+            float zero = 0.0f;
+            sgemm_("Transpose", "Not transpose", &m, &nn, &kk, &one, centroids + c0 * d, &lda,
+                   x + first * d, &ldb, &zero, products.data(), &ldc);
+
+            for (size_t v = 0; v < count; ++v) {
+                const float* row = products.data() + v * centroid_count;
+                for (size_t c = 0; c < centroid_count; ++c) {
+                    float value = inner_product ? row[c] : centroid_norms[c0 + c] - 2.0f * row[c];
+                    if (inner_product ? value > best[v] : value < best[v]) {
+                        best[v] = value;
+                        best_label[v] = static_cast<faiss::idx_t>(c0 + c);
+                    }
+                }
+            }
+        }
+
+        for (size_t v = 0; v < count; ++v) {
+            labels[first + v] = best_label[v];
+            if (distances) {
+                if (inner_product) {
+                    distances[first + v] = best[v];
+                } else {
+                    const float* vector = x + (first + v) * d;
+                    float norm = 0.0f;
+                    for (int j = 0; j < d; ++j) {
+                        norm += vector[j] * vector[j];
+                    }
+                    distances[first + v] = std::max(0.0f, best[v] + norm);
+                }
+            }
+        }
+    }
+}
+
+std::vector<float> train_kmeans(size_t n, const float* x, int d, size_t k, const IndexBuildOptions& options) {
+    bool hierarchical = options.kmeans == "hierarchical";
+    // Hierarchical runs the whole sample through both levels
+    size_t work = static_cast<size_t>(options.kmeans_epochs) * n * (hierarchical ? 2 : 1);
+    BuildProgress progress("kmeans", work, "points");
+    std::vector<float> centroids = hierarchical
+        ? hierarchical_kmeans(n, x, d, k, options, &progress)
+        : minibatch_kmeans(n, x, d, k, options, 1234, &progress);
+    progress.finish();
+    return centroids;
+}
+
+// ---------------------------------------------------------------------------
+// Index construction
+// ---------------------------------------------------------------------------
+
+double measure_transform_recall(const VectorFile& vectors, const VectorPreprocessor& preprocessor,
+                                faiss::MetricType metric, size_t num_queries, size_t k) {
+    int d = vectors.dimension();
+    int d_out = preprocessor.output_dimension();
+    size_t corpus_size = std::min(vectors.count(), kRecallCorpusSize);
+    num_queries = std::min(num_queries, corpus_size);
+    if (num_queries == 0 || corpus_size < 2) {
+        return 1.0;
+    }
+
+    // The reference is what the embeddings mean: cosine when normalizing
+    std::vector<float> corpus = sample_rows(vectors.data(), vectors.count(), d, corpus_size);
+    if (preprocessor.normalizes_output()) {
+        normalize_rows(corpus.data(), corpus_size, d);
+    }
+    std::vector<float> reduced(corpus_size * d_out);
+    preprocessor.apply(corpus_size, corpus.data(), reduced.data());
+
+    // Sampled rows are in random order, so the first ones are a random sample
+    double total = 0.0;
+    #pragma omp parallel for schedule(dynamic) reduction(+:total)
+    for (size_t q = 0; q < num_queries; ++q) {
+        std::vector<float> scores(corpus_size);
+        std::vector<float> reduced_scores(corpus_size);
+        if (metric == faiss::METRIC_INNER_PRODUCT) {
+            simd::dot_many(&corpus[q * d], corpus.data(), corpus_size, d, scores.data());
+            simd::dot_many(&reduced[q * d_out], reduced.data(), corpus_size, d_out, reduced_scores.data());
+        } else {
+            simd::l2_sqr_many(&corpus[q * d], corpus.data(), corpus_size, d, scores.data());
+            simd::l2_sqr_many(&reduced[q * d_out], reduced.data(), corpus_size, d_out, reduced_scores.data());
+            for (size_t i = 0; i < corpus_size; ++i) {
+                scores[i] = -scores[i];
+                reduced_scores[i] = -reduced_scores[i];
+            }
+        }
+        std::vector<size_t> expected = top_k_rows(scores, k, q);
+        std::vector<size_t> found = top_k_rows(reduced_scores, k, q);
+        std::vector<size_t> common;
+        std::set_intersection(expected.begin(), expected.end(), found.begin(), found.end(),
+                              std::back_inserter(common));
+        total += static_cast<double>(common.size()) / std::max<size_t>(1, expected.size());
+    }
+    return total / num_queries;
+}
+
+nlohmann::json build_index_file(const VectorFile& vectors, const std::string& output_path,
+                                const IndexBuildOptions& options) {
+    if (options.num_threads > 0) {
+        omp_set_num_threads(options.num_threads);
+    }
+    size_t n = vectors.count();
+    int d = vectors.dimension();
+    const float* x = vectors.data();
+    auto start_time = std::chrono::steady_clock::now();
+
+    nlohmann::json report;
+    report["index_type"] = options.index_type;
+    report["metric"] = options.metric == faiss::METRIC_INNER_PRODUCT ? "inner_product" : "l2";
+    report["vectors"] = n;
+    report["dimension"] = d;
+    report["threads"] = omp_get_max_threads();
+
+    // Train the transform and build from transformed copies of the vectors
+    std::string transform_path = output_path + ".transform";
+    std::unique_ptr<VectorPreprocessor> preprocessor;
+    std::vector<float> transformed;
+    const VectorPreprocessorOptions& preprocess = options.preprocess;
+    if (preprocess.normalize || preprocess.center || preprocess.rotation != "none") {
+        auto train_start = std::chrono::steady_clock::now();
+        size_t sample_size = std::min(preprocess.training_size, n);
+        std::vector<float> sample = sample_rows(x, n, d, sample_size);
+        std::string error;
+        preprocessor = VectorPreprocessor::train(sample_size, sample.data(), d, preprocess, error);
+        if (!preprocessor) {
+            std::cerr << "Vector transform training failed: " << error << std::endl;
+            return nlohmann::json();
+        }
+        sample = std::vector<float>();
+        report["preprocessing"] = preprocessor->describe();
+        report["preprocessing"]["training_vectors"] = sample_size;
+        report["preprocessing"]["train_seconds"] =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - train_start).count();
+        report["preprocessing"]["recall_at_10"] =
+            measure_transform_recall(vectors, *preprocessor, options.metric, options.recall_queries);
+
+        int d_out = preprocessor->output_dimension();
+        transformed.resize(n * d_out);
+        BuildProgress progress("preprocess", n);
+        for (size_t begin = 0; begin < n; begin += options.chunk_size) {
+            size_t count = std::min(options.chunk_size, n - begin);
+            preprocessor->apply(count, x + begin * d, transformed.data() + begin * d_out);
+            progress.advance(count);
+        }
+        report["preprocessing"]["apply_seconds"] = progress.finish();
+        x = transformed.data();
+        d = d_out;
+        report["index_dimension"] = d;
+    }
+    std::cout << "Building " << options.index_type << " over " << n << " x " << d << " vectors with "
+              << omp_get_max_threads() << " threads" << std::endl;
+
+    try {
+        if (options.index_type == "FLAT") {
+            faiss::IndexFlat index(d, options.metric);
+            BuildProgress progress("add", n);
+            for (size_t begin = 0; begin < n; begin += options.chunk_size) {
+                size_t count = std::min(options.chunk_size, n - begin);
+                index.add(static_cast<faiss::idx_t>(count), x + begin * d);
+                progress.advance(count);
+            }
+            report["add_seconds"] = progress.finish();
+            if (!write_index_atomically(&index, output_path, options)) {
+                return nlohmann::json();
+            }
+        } else if (options.index_type == "IVF_FLAT") {
+            // Same cap as the ingest script: at least ten vectors per list
+            size_t nlist = std::min<size_t>(options.nlist, std::max<size_t>(1, n / 10));
+            size_t sample_size = options.training_size > 0 ? options.training_size : nlist * kPointsPerCentroid;
+            sample_size = std::min(sample_size, n);
+            std::vector<float> sample = sample_rows(x, n, d, sample_size);
+
+            auto train_start = std::chrono::steady_clock::now();
+            std::vector<float> centroids = train_kmeans(sample_size, sample.data(), d, nlist, options);
+            sample = std::vector<float>();
+            report["nlist"] = nlist;
+            report["training_vectors"] = sample_size;
+            report["kmeans"] = options.kmeans;
+            report["train_seconds"] =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - train_start).count();
+
+            auto* quantizer = new faiss::IndexFlat(d, options.metric);
+            quantizer->add(static_cast<faiss::idx_t>(nlist), centroids.data());
+            faiss::IndexIVFFlat index(quantizer, d, nlist, options.metric);
+            index.own_fields = true;
+
+            BuildProgress progress("assign", n);
+            for (size_t begin = 0; begin < n; begin += options.chunk_size) {
+                size_t count = std::min(options.chunk_size, n - begin);
+                add_ivf_chunk(index, centroids.data(), begin, count, x + begin * d, options.metric);
+                progress.advance(count);
+            }
+            report["assign_seconds"] = progress.finish();
+
+            // Lists go to a flat data file the service can mmap
+            auto write_start = std::chrono::steady_clock::now();
+            std::string data_path = output_path + ".ivfdata";
+            auto* on_disk = new faiss::OnDiskInvertedLists(nlist, index.code_size, data_path.c_str());
+            const faiss::InvertedLists* sources[] = {index.invlists};
+            on_disk->merge_from(sources, 1);
+            index.replace_invlists(on_disk, true);
+            if (!write_index_atomically(&index, output_path, options)) {
+                return nlohmann::json();
+            }
+            report["list_data_path"] = data_path;
+            report["write_seconds"] =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count();
+        } else if (options.index_type == "HNSW") {
+            faiss::IndexHNSWFlat index(d, options.hnsw_m, options.metric);
+            index.hnsw.efConstruction = options.ef_construction;
+            // faiss inserts each chunk concurrently with per-node locks
+            BuildProgress progress("hnsw", n);
+            for (size_t begin = 0; begin < n; begin += options.chunk_size) {
+                size_t count = std::min(options.chunk_size, n - begin);
+                index.add(static_cast<faiss::idx_t>(count), x + begin * d);
+                progress.advance(count);
+            }
+            report["hnsw_m"] = options.hnsw_m;
+            report["ef_construction"] = options.ef_construction;
+            report["insert_seconds"] = progress.finish();
+            if (!write_index_atomically(&index, output_path, options)) {
+                return nlohmann::json();
+            }
+        } else if (options.index_type == "DISKANN") {
+            if (!DiskAnnIndex::build(n, x, nullptr, d, options.metric, options.diskann, output_path)) {
+                return nlohmann::json();
+            }
+            report["max_degree"] = options.diskann.max_degree;
+            report["pq_bytes"] = options.diskann.pq_bytes;
+        } else {
+            std::cerr << "Unsupported index type: " << options.index_type << std::endl;
+            return nlohmann::json();
+        }
+    } catch (const faiss::FaissException& e) {
+        std::cerr << "Index build failed: " << e.what() << std::endl;
+        return nlohmann::json();
+    }
+
+    // A transform left by an earlier build would be applied to this index
+    if (preprocessor) {
+        if (!preprocessor->save(transform_path)) {
+            return nlohmann::json();
+        }
+        report["transform_path"] = transform_path;
+    } else {
+        std::remove(transform_path.c_str());
+    }
+
+    double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    report["output_path"] = output_path;
+    report["checksummed"] = options.checksummed && options.index_type != "DISKANN";
+    report["total_seconds"] = total_seconds;
+    report["vectors_per_second"] = n / std::max(total_seconds, 1e-9);
+    return report;
+}
+
+} // namespace neurorag
@@ -0,0 +1,576 @@
+/**
+ * @file index_file.cpp
+ * @brief Checksummed, versioned container for single-file faiss indexes
+ */
+
+#include "index_file.h"
+#include "checksum.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <omp.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVFFlat.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/impl/io.h>
+#include <faiss/index_io.h>
+
+namespace neurorag {
+
+namespace {
+
+static_assert(sizeof(IndexFileHeader) <= kIndexFileHeaderBytes, "index file header outgrew its block");
+
+constexpr size_t kMinBlockBytes = 4096;
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int thread_count(int requested) {
+    return requested > 0 ? requested : omp_get_max_threads();
+}
+
+uint64_t block_checksum(IndexChecksum type, const void* data, size_t size) {
+    return type == IndexChecksum::XXHASH64 ? xxhash64(data, size) : crc32c(data, size);
+}
+
+uint32_t header_checksum(const IndexFileHeader& header) {
+    return crc32c(&header, offsetof(IndexFileHeader, header_crc));
+}
+
+// Same names as snapshot manifests
+const char* index_type_name(const faiss::Index& index) {
+    if (dynamic_cast<const faiss::IndexIVFFlat*>(&index)) {
+        return "IVF_FLAT";
+    }
+    if (dynamic_cast<const faiss::IndexHNSWFlat*>(&index)) {
+        return "HNSW_FLAT";
+    }
+    if (dynamic_cast<const faiss::IndexFlat*>(&index)) {
+        return "FLAT";
+    }
+    return "FAISS";
+}
+
+bool pwrite_all(int fd, const void* data, size_t size, uint64_t offset) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t result = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        bytes += result;
+        size -= static_cast<size_t>(result);
+        offset += static_cast<uint64_t>(result);
+    }
+    return true;
+}
+
+bool pread_all(int fd, void* data, size_t size, uint64_t offset) {
+    auto* bytes = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        ssize_t result = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        bytes += result;
+        size -= static_cast<size_t>(result);
+        offset += static_cast<uint64_t>(result);
+    }
+    return true;
+}
+
+uint64_t block_size(const IndexFileHeader& header, uint64_t block) {
+    uint64_t begin = block * header.block_bytes;
+    return std::min<uint64_t>(header.block_bytes, header.payload_bytes - begin);
+}
+
+// faiss serializer output, cut into checksummed blocks as it is written
+class BlockChecksumWriter : public faiss::IOWriter {
+public:
+    BlockChecksumWriter(int fd, size_t block_bytes, IndexChecksum checksum)
+        : fd_(fd), checksum_(checksum), buffer_(block_bytes), fill_(0), written_(0), failed_(false) {}
+
+    size_t operator()(const void* ptr, size_t size, size_t nitems) override {
+        const auto* bytes = static_cast<const uint8_t*>(ptr);
+        size_t remaining = size * nitems;
+        while (remaining > 0 && !failed_) {
+            size_t count = std::min(remaining, buffer_.size() - fill_);
+            std::memcpy(buffer_.data() + fill_, bytes, count);
+            fill_ += count;
+            bytes += count;
+            remaining -= count;
+            if (fill_ == buffer_.size()) {
+                flush();
+            }
+        }
+        return failed_ ? 0 : nitems;
+    }
+
+    // Writes the final partial block
+    bool finish() {
+        if (fill_ > 0) {
+            flush();
+        }
+        return !failed_;
+    }
+
+    const std::vector<uint64_t>& checksums() const { return checksums_; }
+    uint64_t bytes() const { return written_; }
+
+private:
+    int fd_;
+    IndexChecksum checksum_;
+    std::vector<uint8_t> buffer_;
+    size_t fill_;
+    uint64_t written_;
+    bool failed_;
+    std::vector<uint64_t> checksums_;
+
+    void flush() {
+        checksums_.push_back(block_checksum(checksum_, buffer_.data(), fill_));
+        if (!pwrite_all(fd_, buffer_.data(), fill_, kIndexFileHeaderBytes + written_)) {
+            failed_ = true;
+            return;
+        }
+        written_ += fill_;
+        fill_ = 0;
+    }
+};
+
+// Payload reader for faiss::read_index. Small reads are served from one
+// buffered block; reads spanning whole blocks (vector and list arrays) go
+// straight into the destination, several blocks in parallel.
+class BlockVerifyingReader : public faiss::IOReader {
+public:
+    BlockVerifyingReader(int fd, const IndexFileHeader& header, const std::vector<uint64_t>& table,
+                         bool verify, int threads)
+        : fd_(fd), header_(header), table_(table), verify_(verify), threads_(threads),
+          position_(0), buffered_block_(std::numeric_limits<uint64_t>::max()) {}
+
+    size_t operator()(void* ptr, size_t size, size_t nitems) override {
+        if (size == 0 || nitems == 0) {
+            return 0;
+        }
+        auto* out = static_cast<uint8_t*>(ptr);
+        uint64_t wanted = std::min<uint64_t>(uint64_t{size} * nitems, header_.payload_bytes - position_);
+        uint64_t done = 0;
+        while (done < wanted) {
+            uint64_t block = position_ / header_.block_bytes;
+            uint64_t within = position_ % header_.block_bytes;
+            uint64_t whole_blocks = within == 0 ? (wanted - done) / header_.block_bytes : 0;
+            if (whole_blocks >= 2) {
+                read_blocks(block, whole_blocks, out + done);
+                uint64_t count = whole_blocks * header_.block_bytes;
+                done += count;
+                position_ += count;
+                continue;
+            }
+            if (block != buffered_block_) {
+                buffer_.resize(block_size(header_, block));
+                read_block(block, buffer_.data());
+                buffered_block_ = block;
+            }
+            uint64_t count = std::min<uint64_t>(wanted - done, buffer_.size() - within);
+            std::memcpy(out + done, buffer_.data() + within, count);
+            done += count;
+            position_ += count;
+        }
+        return static_cast<size_t>(done / size);
+    }
+
+private:
+    int fd_;
+    const IndexFileHeader& header_;
+    const std::vector<uint64_t>& table_;
+    bool verify_;
+    int threads_;
+    uint64_t position_;
+    std::vector<uint8_t> buffer_;
+    uint64_t buffered_block_;
+
+    void read_block(uint64_t block, uint8_t* out) const {
+        uint64_t size = block_size(header_, block);
+        if (!pread_all(fd_, out, size, header_.header_bytes + block * header_.block_bytes)) {
+            throw faiss::FaissException("index file: cannot read block " + std::to_string(block) +
+                                        ": " + std::strerror(errno));
+        }
+        if (verify_ && block_checksum(static_cast<IndexChecksum>(header_.checksum), out, size) != table_[block]) {
+            throw faiss::FaissException("index file: block " + std::to_string(block) + " is corrupt");
+        }
+    }
+
+    void read_blocks(uint64_t first, uint64_t count, uint8_t* out) const {
+        std::atomic<int64_t> failed_block(-1);
+        std::string error;
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(threads_)
+        for (int64_t i = 0; i < static_cast<int64_t>(count); ++i) {
+            if (failed_block.load(std::memory_order_relaxed) >= 0) {
+                continue;
+            }
+            try {
+                read_block(first + i, out + i * header_.block_bytes);
+            } catch (const faiss::FaissException& e) {
+                int64_t expected = -1;
+                if (failed_block.compare_exchange_strong(expected, i)) {
+                    error = e.what();
+                }
+            }
+        }
+        if (failed_block.load() >= 0) {
+            throw faiss::FaissException(error);
+        }
+    }
+};
+
+// Header, table and size checks shared by inspect, verify and read
+IndexFileCheck inspect_open_file(int fd, std::vector<uint64_t>* table) {
+    IndexFileCheck check;
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        check.message = std::strerror(errno);
+        return check;
+    }
+    check.file_bytes = static_cast<uint64_t>(info.st_size);
+
+    IndexFileHeader& header = check.header;
+    if (check.file_bytes < sizeof(header) || !pread_all(fd, &header, sizeof(header), 0)) {
+        check.status = IndexFileStatus::LEGACY;
+        return check;
+    }
+    if (header.magic != kIndexFileMagic) {
+        // faiss files start with a fourcc; zeros mean a header never landed
+        bool zeroed = header.magic == 0 && check.file_bytes >= kIndexFileHeaderBytes;
+        check.status = zeroed ? IndexFileStatus::TRUNCATED : IndexFileStatus::LEGACY;
+        if (zeroed) {
+            check.message = "header was never written";
+        }
+        return check;
+    }
+    if (header.header_crc != header_checksum(header)) {
+        check.status = IndexFileStatus::CORRUPT;
+        check.message = "header checksum mismatch";
+        return check;
+    }
+    if (header.version > kIndexFileVersion) {
+        check.message = "unsupported format version " + std::to_string(header.version);
+        return check;
+    }
+    if (header.header_bytes < sizeof(header) || header.block_bytes < kMinBlockBytes ||
+        header.table_offset != header.header_bytes + header.payload_bytes ||
+        header.num_blocks != (header.payload_bytes + header.block_bytes - 1) / header.block_bytes ||
+        (header.checksum != static_cast<uint32_t>(IndexChecksum::CRC32C) &&
+         header.checksum != static_cast<uint32_t>(IndexChecksum::XXHASH64))) {
+        check.status = IndexFileStatus::CORRUPT;
+        check.message = "inconsistent header";
+        return check;
+    }
+
+    uint64_t expected_bytes = header.table_offset + header.num_blocks * sizeof(uint64_t);
+    if (check.file_bytes != expected_bytes) {
+        check.status = check.file_bytes < expected_bytes ? IndexFileStatus::TRUNCATED : IndexFileStatus::CORRUPT;
+        check.message = std::to_string(check.file_bytes) + " bytes, header describes " +
+                        std::to_string(expected_bytes);
+        return check;
+    }
+
+    std::vector<uint64_t> checksums(header.num_blocks);
+    if (!pread_all(fd, checksums.data(), checksums.size() * sizeof(uint64_t), header.table_offset)) {
+        check.message = std::strerror(errno);
+        return check;
+    }
+    if (crc32c(checksums.data(), checksums.size() * sizeof(uint64_t)) != header.table_crc) {
+        check.status = IndexFileStatus::CORRUPT;
+        check.message = "block table checksum mismatch";
+        return check;
+    }
+    if (table) {
+        *table = std::move(checksums);
+    }
+    check.status = IndexFileStatus::OK;
+    return check;
+}
+
+// Every block, in parallel; fills bad_blocks and status
+void verify_blocks(int fd, const std::vector<uint64_t>& table, int threads, IndexFileCheck& check) {
+    const IndexFileHeader& header = check.header;
+    auto type = static_cast<IndexChecksum>(header.checksum);
+    std::vector<uint8_t> unreadable(header.num_blocks, 0);
+    std::vector<uint8_t> mismatched(header.num_blocks, 0);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        std::vector<uint8_t> buffer(header.block_bytes);
+        #pragma omp for schedule(dynamic, 1)
+        for (int64_t i = 0; i < static_cast<int64_t>(header.num_blocks); ++i) {
+            uint64_t size = block_size(header, i);
+            if (!pread_all(fd, buffer.data(), size, header.header_bytes + i * header.block_bytes)) {
+                unreadable[i] = 1;
+            } else if (block_checksum(type, buffer.data(), size) != table[i]) {
+                mismatched[i] = 1;
+            }
+        }
+    }
+
+    bool io_error = false;
+    for (uint64_t i = 0; i < header.num_blocks; ++i) {
+        if (unreadable[i] || mismatched[i]) {
+            check.bad_blocks.push_back(i);
+        }
+        io_error = io_error || unreadable[i];
+    }
+    if (io_error) {
+        check.status = IndexFileStatus::UNREADABLE;
+        check.message = "read error";
+    } else if (!check.bad_blocks.empty()) {
+        check.status = IndexFileStatus::CORRUPT;
+        check.message = std::to_string(check.bad_blocks.size()) + " corrupt blocks";
+    }
+}
+
+} // namespace
+
+const char* index_file_status_name(IndexFileStatus status) {
+    switch (status) {
+        case IndexFileStatus::OK: return "ok";
+        case IndexFileStatus::LEGACY: return "legacy";
+        case IndexFileStatus::TRUNCATED: return "truncated";
+        case IndexFileStatus::CORRUPT: return "corrupt";
+        case IndexFileStatus::UNREADABLE: return "unreadable";
+    }
+    return "unknown";
+}
+
+nlohmann::json IndexFileCheck::to_json() const {
+    nlohmann::json result;
+    result["status"] = index_file_status_name(status);
+    result["file_bytes"] = file_bytes;
+    if (!message.empty()) {
+        result["message"] = message;
+    }
+    if (header.magic == kIndexFileMagic) {
+        result["format_version"] = header.version;
+        result["index_type"] = std::string(header.index_type, strnlen(header.index_type, sizeof(header.index_type)));
+        result["dimension"] = header.dimension;
+        result["ntotal"] = header.ntotal;
+        result["created_at"] = header.created_at;
+        result["checksum"] = header.checksum == static_cast<uint32_t>(IndexChecksum::XXHASH64) ? "xxhash64" : "crc32c";
+        result["block_bytes"] = header.block_bytes;
+        result["blocks"] = header.num_blocks;
+    }
+    if (seconds > 0.0) {
+        result["bad_blocks"] = bad_blocks;
+        result["seconds"] = seconds;
+        result["gb_per_second"] = header.payload_bytes / seconds / 1e9;
+    }
+    return result;
+}
+
+bool parse_index_verification(const std::string& name, IndexVerification& verification) {
+    if (name == "none") {
+        verification = IndexVerification::NONE;
+    } else if (name == "lazy") {
+        verification = IndexVerification::LAZY;
+    } else if (name == "full") {
+        verification = IndexVerification::FULL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool write_index_file(const faiss::Index& index, const std::string& path, const IndexFileOptions& options) {
+    std::string temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Index file: cannot create " << temp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    auto fail = [&](const std::string& reason) {
+        std::cerr << "Index file: cannot write " << temp_path << ": " << reason << std::endl;
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+        return false;
+    };
+
+    size_t block_bytes = std::max(options.block_bytes, kMinBlockBytes);
+    BlockChecksumWriter writer(fd, block_bytes, options.checksum);
+    try {
+        faiss::write_index(&index, &writer);
+    } catch (const faiss::FaissException& e) {
+        return fail(e.what());
+    }
+    if (!writer.finish()) {
+        return fail(std::strerror(errno));
+    }
+
+    const std::vector<uint64_t>& table = writer.checksums();
+    IndexFileHeader header{};
+    header.magic = kIndexFileMagic;
+    header.version = kIndexFileVersion;
+    header.header_bytes = static_cast<uint32_t>(kIndexFileHeaderBytes);
+    header.dimension = static_cast<uint32_t>(index.d);
+    header.metric = static_cast<uint32_t>(index.metric_type);
+    header.checksum = static_cast<uint32_t>(options.checksum);
+    std::strncpy(header.index_type, index_type_name(index), sizeof(header.index_type) - 1);
+    header.ntotal = static_cast<uint64_t>(index.ntotal);
+    header.payload_bytes = writer.bytes();
+    header.block_bytes = block_bytes;
+    header.num_blocks = table.size();
+    header.table_offset = kIndexFileHeaderBytes + writer.bytes();
+    header.created_at = unix_now();
+    header.table_crc = crc32c(table.data(), table.size() * sizeof(uint64_t));
+    header.header_crc = header_checksum(header);
+
+    if (!pwrite_all(fd, table.data(), table.size() * sizeof(uint64_t), header.table_offset)) {
+        return fail(std::strerror(errno));
+    }
+    // Payload and table are durable before the header that vouches for them
+    if (::fdatasync(fd) != 0) {
+        return fail(std::strerror(errno));
+    }
+    std::vector<uint8_t> header_block(kIndexFileHeaderBytes, 0);
+    std::memcpy(header_block.data(), &header, sizeof(header));
+    if (!pwrite_all(fd, header_block.data(), header_block.size(), 0) || ::fsync(fd) != 0) {
+        return fail(std::strerror(errno));
+    }
+    ::close(fd);
+
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Index file: cannot rename " << temp_path << " to " << path << ": "
+                  << std::strerror(errno) << std::endl;
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+IndexFileCheck inspect_index_file(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        IndexFileCheck check;
+        check.message = std::strerror(errno);
+        return check;
+    }
+    IndexFileCheck check = inspect_open_file(fd, nullptr);
+    ::close(fd);
+    return check;
+}
+
+IndexFileCheck verify_index_file(const std::string& path, int num_threads) {
+    auto start_time = std::chrono::steady_clock::now();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        IndexFileCheck check;
+        check.message = std::strerror(errno);
+        return check;
+    }
+    std::vector<uint64_t> table;
+    IndexFileCheck check = inspect_open_file(fd, &table);
+    if (check.status == IndexFileStatus::OK) {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        verify_blocks(fd, table, thread_count(num_threads), check);
+        check.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    }
+    ::close(fd);
+    return check;
+}
+
+std::unique_ptr<faiss::Index> read_index_file(const std::string& path, const IndexFileOptions& options) {
+    int io_flags = options.mmap ? faiss::IO_FLAG_MMAP : 0;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Index file: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    std::vector<uint64_t> table;
+    IndexFileCheck check = inspect_open_file(fd, &table);
+    if (check.status == IndexFileStatus::LEGACY) {
+        ::close(fd);
+        std::cerr << "Index file: " << path << " has no checksum header; loading unverified" << std::endl;
+        try {
+            return std::unique_ptr<faiss::Index>(faiss::read_index(path.c_str(), io_flags));
+        } catch (const faiss::FaissException& e) {
+            std::cerr << "Index file: cannot load " << path << ": " << e.what() << std::endl;
+            return nullptr;
+        }
+    }
+    if (check.status != IndexFileStatus::OK) {
+        ::close(fd);
+        std::cerr << "Index file: " << path << " is " << index_file_status_name(check.status) << ": "
+                  << check.message << std::endl;
+        return nullptr;
+    }
+
+    int threads = thread_count(options.num_threads);
+    const IndexFileHeader& header = check.header;
+    // A mapped load never reads the lists it maps, so blocks are checked first
+    bool verify_first = options.verify == IndexVerification::FULL ||
+                        (options.mmap && options.verify != IndexVerification::NONE);
+    if (verify_first) {
+        auto start_time = std::chrono::steady_clock::now();
+        verify_blocks(fd, table, threads, check);
+        if (check.status != IndexFileStatus::OK) {
+            ::close(fd);
+            std::cerr << "Index file: " << path << " failed verification: " << check.message << std::endl;
+            return nullptr;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "Index file " << path << ": " << header.num_blocks << " blocks verified in "
+                  << seconds << " s (" << header.payload_bytes / std::max(seconds, 1e-9) / 1e9 << " GB/s)"
+                  << std::endl;
+    }
+
+    std::unique_ptr<faiss::Index> index;
+    try {
+        if (options.mmap) {
+            // Mapped lists record absolute file offsets, so faiss reads the
+            // file itself, positioned at the payload
+            faiss::FileIOReader reader(path.c_str());
+            if (std::fseek(reader.f, static_cast<long>(header.header_bytes), SEEK_SET) != 0) {
+                throw faiss::FaissException(std::string("seek failed: ") + std::strerror(errno));
+            }
+            index.reset(faiss::read_index(&reader, io_flags));
+        } else {
+            bool verify_blocks_on_read = options.verify == IndexVerification::LAZY;
+            BlockVerifyingReader reader(fd, header, table, verify_blocks_on_read, threads);
+            index.reset(faiss::read_index(&reader, io_flags));
+        }
+    } catch (const faiss::FaissException& e) {
+        ::close(fd);
+        std::cerr << "Index file: cannot load " << path << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+    ::close(fd);
+
+    if (static_cast<uint32_t>(index->d) != header.dimension ||
+        static_cast<uint64_t>(index->ntotal) != header.ntotal) {
+        std::cerr << "Index file: " << path << " does not match its header (dimension " << index->d
+                  << ", " << index->ntotal << " vectors)" << std::endl;
+        return nullptr;
+    }
+    return index;
+}
+
+} // namespace neurorag
@@ -0,0 +1,177 @@
+/**
+ * @file index_generation.cpp
+ * @brief Hot index swap: serve one index generation, load the next beside it
+ */
+
+#include "index_generation.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace neurorag {
+
+namespace {
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// GenerationIndex
+// ---------------------------------------------------------------------------
+
+GenerationIndex::GenerationIndex(std::unique_ptr<faiss::Index> initial)
+    : faiss::Index(initial->d, initial->metric_type),
+      current_(nullptr),
+      generation_(1),
+      published_at_(unix_now()),
+      reclaimed_(0),
+      epochs_(kReaderSlots) {
+    ntotal = initial->ntotal;
+    is_trained = initial->is_trained;
+    current_.store(initial.release());
+}
+
+GenerationIndex::~GenerationIndex() {
+    // No reader may outlive the index; epochs_ frees the retired generations
+    delete current_.load();
+}
+
+std::shared_ptr<faiss::Index> GenerationIndex::current() const {
+    size_t slot = epochs_.enter();
+    faiss::Index* index = current_.load();
+    return std::shared_ptr<faiss::Index>(index, [this, slot](faiss::Index*) { epochs_.exit(slot); });
+}
+
+uint64_t GenerationIndex::publish(std::unique_ptr<faiss::Index> index) {
+    // Leftovers from an earlier publish whose readers have finished since
+    reclaim();
+
+    ntotal = index->ntotal;
+    is_trained = index->is_trained;
+    faiss::Index* previous = current_.exchange(index.release());
+    uint64_t generation = generation_.fetch_add(1) + 1;
+    published_at_.store(unix_now());
+
+    // Readers pinned before the exchange may still hold previous
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired_.push_back(generation - 1);
+    }
+    epochs_.retire([this, previous, retired = generation - 1]() {
+        delete previous;
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired_.erase(std::find(retired_.begin(), retired_.end(), retired));
+        reclaimed_.fetch_add(1);
+    });
+    return generation;
+}
+
+size_t GenerationIndex::reclaim() {
+    return epochs_.collect();
+}
+
+bool GenerationIndex::drain(std::chrono::milliseconds timeout) {
+    return epochs_.drain(timeout);
+}
+
+nlohmann::json GenerationIndex::get_statistics() const {
+    nlohmann::json retired;
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired = retired_;
+    }
+
+    nlohmann::json stats;
+    stats["generation"] = generation();
+    stats["published_at"] = published_at_.load();
+    stats["epoch"] = epochs_.epoch();
+    stats["retired_generations"] = retired;
+    stats["reclaimed_generations"] = reclaimed_.load();
+    stats["active_readers"] = epochs_.active_readers();
+    stats["reader_slots"] = epochs_.reader_slots();
+    stats["vectors"] = ntotal;
+    return stats;
+}
+
+std::shared_ptr<const faiss::Index> GenerationIndex::base_index() const {
+    return current();
+}
+
+void GenerationIndex::add(faiss::idx_t n, const float* x) {
+    Pin pin(*this);
+    pin.index()->add(n, x);
+    ntotal = pin.index()->ntotal;
+}
+
+void GenerationIndex::add_with_ids(faiss::idx_t n, const float* x, const faiss::idx_t* xids) {
+    Pin pin(*this);
+    pin.index()->add_with_ids(n, x, xids);
+    ntotal = pin.index()->ntotal;
+}
+
+void GenerationIndex::search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances,
+                             faiss::idx_t* labels, const faiss::SearchParameters* params) const {
+    Pin pin(*this);
+    pin.index()->search(n, x, k, distances, labels, params);
+}
+
+void GenerationIndex::reset() {
+    Pin pin(*this);
+    pin.index()->reset();
+    ntotal = 0;
+}
+
+size_t GenerationIndex::remove_ids(const faiss::IDSelector& sel) {
+    Pin pin(*this);
+    size_t removed = pin.index()->remove_ids(sel);
+    ntotal = pin.index()->ntotal;
+    return removed;
+}
+
+void GenerationIndex::reconstruct(faiss::idx_t key, float* recons) const {
+    Pin pin(*this);
+    pin.index()->reconstruct(key, recons);
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<faiss::Index> VectorSearchEngine::serving_index() const {
+    if (auto* generations = dynamic_cast<GenerationIndex*>(index_.get())) {
+        return generations->current();
+    }
+    // Non-owning; index_ outlives the caller's use under index_mutex_
+    return std::shared_ptr<faiss::Index>(std::shared_ptr<faiss::Index>(), index_.get());
+}
+
+bool VectorSearchEngine::enable_hot_swap() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (!index_) {
+        return false;
+    }
+    if (dynamic_cast<GenerationIndex*>(index_.get())) {
+        return true;
+    }
+    index_ = std::make_unique<GenerationIndex>(std::move(index_));
+    std::cout << "Hot index swap enabled" << std::endl;
+    return true;
+}
+
+nlohmann::json VectorSearchEngine::get_generation_statistics() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto* generations = dynamic_cast<GenerationIndex*>(index_.get());
+    if (!generations) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = generations->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
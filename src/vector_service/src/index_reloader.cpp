@@ -0,0 +1,380 @@
+/**
+ * @file index_reloader.cpp
+ * @brief Background index reloads, on request or when the source changes
+ */
+
+#include "index_reloader.h"
+#include "filtered_hnsw_index.h"
+#include "index_file.h"
+#include "index_generation.h"
+#include "index_snapshot.h"
+#include "lsm_index.h"
+#include "matryoshka_index.h"
+#include "partitioned_index.h"
+#include "readiness.h"
+#include "vector_search.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+#include <faiss/IndexIVF.h>
+
+namespace fs = std::filesystem;
+
+namespace neurorag {
+
+namespace {
+
+constexpr auto kDrainTimeout = std::chrono::seconds(30);
+
+int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Changes whenever a new index is published at path; empty if there is none
+std::string source_signature(const std::string& path) {
+    std::error_code error;
+    if (fs::is_directory(path, error)) {
+        SnapshotManifest manifest;
+        if (!SnapshotManifest::read(path, manifest)) {
+            return "";
+        }
+        return "snapshot:" + std::to_string(manifest.version);
+    }
+    auto size = fs::file_size(path, error);
+    if (error) {
+        return "";
+    }
+    auto modified = fs::last_write_time(path, error);
+    if (error) {
+        return "";
+    }
+    return "file:" + std::to_string(size) + ":" + std::to_string(modified.time_since_epoch().count());
+}
+
+// documents.json as written by scripts/ingest_data.py: one entry per
+// vector, in index order; objects are kept as their JSON text
+bool read_metadata_file(const std::string& path, std::vector<std::string>& metadata) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open metadata file " << path << std::endl;
+        return false;
+    }
+    try {
+        nlohmann::json documents = nlohmann::json::parse(in);
+        if (!documents.is_array()) {
+            std::cerr << "Metadata file " << path << " is not a JSON array" << std::endl;
+            return false;
+        }
+        metadata.clear();
+        metadata.reserve(documents.size());
+        for (const auto& document : documents) {
+            metadata.push_back(document.is_string() ? document.get<std::string>() : document.dump());
+        }
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Cannot parse metadata file " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+IndexReloader::IndexReloader(VectorSearchEngine* engine, ReadinessGate* readiness,
+                             int prefault_threads, bool lock_memory)
+    : engine_(engine),
+      readiness_(readiness),
+      prefault_threads_(prefault_threads),
+      lock_memory_(lock_memory),
+      stopping_(false),
+      running_(false),
+      last_succeeded_(false),
+      last_seconds_(0.0),
+      last_finished_at_(0),
+      reloads_(0),
+      failures_(0) {}
+
+IndexReloader::~IndexReloader() {
+    stop();
+}
+
+bool IndexReloader::request(const std::string& path, bool mmap) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || stopping_) {
+        return false;
+    }
+    if (reload_thread_.joinable()) {
+        reload_thread_.join();
+    }
+    running_ = true;
+    last_path_ = path;
+    reload_thread_ = std::thread(&IndexReloader::run, this, path, mmap);
+    return true;
+}
+
+void IndexReloader::run(const std::string& path, bool mmap) {
+    auto start_time = std::chrono::steady_clock::now();
+    std::function<void(const std::vector<MemoryRegion>&)> prepare;
+    if (readiness_) {
+        // Also moves residency tracking over to the new generation
+        prepare = [this](const std::vector<MemoryRegion>& regions) {
+            readiness_->prefault(regions, prefault_threads_, lock_memory_);
+        };
+    }
+
+    bool reloaded = engine_->reload_index(path, mmap, prepare);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    if (!reloaded) {
+        std::cerr << "Index reload from " << path << " failed; previous generation keeps serving" << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    last_succeeded_ = reloaded;
+    last_seconds_ = seconds;
+    last_finished_at_ = unix_now();
+    (reloaded ? reloads_ : failures_)++;
+}
+
+void IndexReloader::watch(const std::string& path, bool mmap, std::chrono::seconds interval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (watch_thread_.joinable() || stopping_) {
+        return;
+    }
+    watch_thread_ = std::thread(&IndexReloader::watch_loop, this, path, mmap, interval);
+    std::cout << "Watching " << path << " for new index generations every "
+              << interval.count() << " s" << std::endl;
+}
+
+void IndexReloader::watch_loop(std::string path, bool mmap, std::chrono::seconds interval) {
+    // What is serving now counts as seen
+    std::string seen = source_signature(path);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_condition_.wait_for(lock, interval, [this]() { return stopping_; })) {
+        lock.unlock();
+        std::string signature = source_signature(path);
+        // A busy reloader is retried on the next check; a failed reload
+        // is not, until the source changes again
+        if (!signature.empty() && signature != seen && request(path, mmap)) {
+            seen = signature;
+        }
+        lock.lock();
+    }
+}
+
+void IndexReloader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_condition_.notify_all();
+    if (watch_thread_.joinable()) {
+        watch_thread_.join();
+    }
+    // A reload in progress is finished, not abandoned halfway
+    if (reload_thread_.joinable()) {
+        reload_thread_.join();
+    }
+}
+
+nlohmann::json IndexReloader::get_status() const {
+    nlohmann::json status;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status["running"] = running_;
+        status["watching"] = watch_thread_.joinable();
+        status["last_path"] = last_path_;
+        status["last_succeeded"] = last_succeeded_;
+        status["last_seconds"] = last_seconds_;
+        status["last_finished_at"] = last_finished_at_;
+        status["reloads"] = reloads_;
+        status["failures"] = failures_;
+    }
+    status["generations"] = engine_->get_generation_statistics();
+    return status;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::reload_index(const std::string& path, bool mmap,
+                                      const std::function<void(const std::vector<MemoryRegion>&)>& prepare) {
+    GenerationIndex* generations;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        generations = dynamic_cast<GenerationIndex*>(index_.get());
+    }
+    // index_ is never replaced once it is a GenerationIndex
+    if (!generations) {
+        std::cerr << "Hot index swap is not enabled; restart to load " << path << std::endl;
+        return false;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    std::unique_ptr<faiss::Index> index;
+    std::vector<std::string> metadata;
+    bool metadata_replaced = false;
+    std::shared_ptr<const VectorPreprocessor> preprocessor;
+    std::string source;
+    std::error_code error;
+    if (fs::exists(fs::path(path) / "manifest.json", error)) {
+        // Segments stream into the new index one at a time per thread
+        SnapshotOptions options;
+        options.lazy = mmap;
+        options.num_threads = config_.num_threads;
+        options.verify_checksums = config_.index_verify != "none";
+        IndexSnapshot snapshot;
+        if (!read_index_snapshot(path, snapshot, options)) {
+            return false;
+        }
+        index = std::move(snapshot.index);
+        metadata = std::move(snapshot.metadata);
+        metadata_replaced = !metadata.empty();
+        if (!snapshot.transform.empty()) {
+            std::string transform_error;
+            preprocessor = VectorPreprocessor::deserialize(snapshot.transform.data(), snapshot.transform.size(),
+                                                           transform_error);
+            if (!preprocessor) {
+                std::cerr << "Snapshot " << path << " has an unusable vector transform: " << transform_error
+                          << std::endl;
+                return false;
+            }
+        }
+        source = "snapshot " + std::to_string(snapshot.manifest.version);
+    } else {
+        // A corrupt or half-downloaded file fails here; the current
+        // generation keeps serving
+        IndexFileOptions options;
+        options.mmap = mmap;
+        options.num_threads = config_.num_threads;
+        parse_index_verification(config_.index_verify, options.verify);
+        index = read_index_file(path, options);
+        if (!index) {
+            return false;
+        }
+        if (fs::exists(path + ".transform", error)) {
+            preprocessor = VectorPreprocessor::load(path + ".transform");
+            if (!preprocessor) {
+                return false;
+            }
+        }
+        // The documents go with the index file; serving it with the previous
+        // generation's metadata would point results at the wrong documents
+        size_t current_documents;
+        if (!config_.metadata_path.empty() && fs::exists(config_.metadata_path, error)) {
+            if (!read_metadata_file(config_.metadata_path, metadata)) {
+                return false;
+            }
+            metadata_replaced = true;
+            current_documents = metadata.size();
+        } else {
+            std::lock_guard<std::mutex> lock(metadata_mutex_);
+            current_documents = metadata_.size();
+        }
+        if (static_cast<size_t>(index->ntotal) != current_documents) {
+            std::cerr << "Index " << path << " holds " << index->ntotal << " vectors but "
+                      << (!metadata_replaced ? "the current metadata has " : config_.metadata_path + " has ")
+                      << current_documents << " documents" << std::endl;
+            return false;
+        }
+        source = path;
+    }
+    // Without a transform of its own the new index is built like the current one
+    if (!preprocessor) {
+        preprocessor = vector_preprocessor();
+    } else if (preprocessor->input_dimension() != config_.dimension) {
+        std::cerr << "Vector transform of " << path << " takes dimension " << preprocessor->input_dimension()
+                  << ", embeddings have " << config_.dimension << std::endl;
+        return false;
+    }
+    int dimension = preprocessor ? preprocessor->output_dimension() : config_.dimension;
+    if (index->d != dimension) {
+        std::cerr << "Index " << path << " has dimension " << index->d << ", expected "
+                  << dimension << std::endl;
+        return false;
+    }
+
+    if (config_.matryoshka_prefix_dimension > 0) {
+        std::string reason;
+        if (MatryoshkaIndex::can_wrap(*index, config_.matryoshka_prefix_dimension, reason)) {
+            std::shared_ptr<faiss::IndexFlat> full(static_cast<faiss::IndexFlat*>(index.release()));
+            index = std::make_unique<MatryoshkaIndex>(std::move(full), config_.matryoshka_prefix_dimension,
+                                                      config_.matryoshka_candidate_multiplier);
+        } else {
+            std::cerr << reason << "; new generation serves without Matryoshka search" << std::endl;
+        }
+    }
+
+    if (config_.filtered_hnsw_search) {
+        std::string reason;
+        if (FilteredHnswIndex::can_wrap(*index, reason)) {
+            std::shared_ptr<faiss::IndexHNSWFlat> hnsw(static_cast<faiss::IndexHNSWFlat*>(index.release()));
+            index = std::make_unique<FilteredHnswIndex>(std::move(hnsw), config_.filtered_hnsw_exact_selectivity,
+                                                        config_.filtered_hnsw_native_selectivity);
+        }
+    }
+
+    if (!config_.delta_index_type.empty()) {
+        std::string reason;
+        if (LsmIndex::can_wrap(*index, reason)) {
+            std::shared_ptr<faiss::Index> main(index.release());
+            auto lsm = std::make_unique<LsmIndex>(main, config_.delta_index_type, main->ntotal);
+            lsm->start_merging(static_cast<size_t>(config_.delta_merge_threshold),
+                               std::chrono::seconds(config_.delta_merge_interval_seconds));
+            index = std::move(lsm);
+        } else {
+            std::cerr << reason << "; new generation serves without a delta index" << std::endl;
+        }
+    }
+
+    size_t num_lists = 0;
+    {
+        std::shared_ptr<const faiss::Index> base(std::shared_ptr<const faiss::Index>(), index.get());
+        while (auto* layered = dynamic_cast<const LayeredIndex*>(base.get())) {
+            base = layered->base_index();
+        }
+        if (auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get())) {
+            num_lists = ivf->nlist;
+        }
+        // Faulted in while the current generation still serves, so the
+        // first searches after the switch do not page-fault
+        if (prepare) {
+            prepare(index_memory_regions(base.get()));
+        }
+    }
+
+    uint64_t generation;
+    {
+        // Inserts hold index_mutex_, so none straddles the switch; the old
+        // metadata is freed after the locks are released
+        std::scoped_lock lock(index_mutex_, metadata_mutex_);
+        generation = generations->publish(std::move(index));
+        std::atomic_store(&preprocessor_, std::move(preprocessor));
+        index_versions_.advance(num_lists);
+        if (metadata_replaced) {
+            metadata_.swap(metadata);
+        }
+        // Partitions copied the old generation's vectors; filtered searches
+        // go to the new index until they are rebuilt from it
+        std::atomic_store(&partitions_, std::shared_ptr<PartitionedIndex>());
+    }
+    if (metadata_replaced) {
+        rebuild_document_ids();
+        rebuild_metadata_columns();
+    }
+    rebuild_partitions();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    bool drained = generations->drain(kDrainTimeout);
+    std::cout << "Index generation " << generation << " (" << source << (mmap ? ", mapped" : "")
+              << ") serving after " << seconds << " s; previous generation "
+              << (drained ? "freed" : "still in use, freed by a later reload") << std::endl;
+    return true;
+}
+
+} // namespace neurorag
@@ -0,0 +1,1117 @@
+/**
+ * @file index_snapshot.cpp
+ * @brief Index snapshots as immutable segment files described by a manifest
+ */
+
+#include "index_snapshot.h"
+#include "checksum.h"
+#include "lsm_index.h"
+#include "partitioned_index.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <omp.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVFFlat.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/impl/io.h>
+#include <faiss/index_io.h>
+
+namespace fs = std::filesystem;
+
+namespace neurorag {
+
+namespace {
+
+constexpr const char* kManifestFile = "manifest.json";
+constexpr const char* kManifestDirectory = "manifests";
+constexpr const char* kSegmentDirectory = "segments";
+
+// A segment to write: a view of index memory, or a buffer built by fill()
+// on the worker that writes it, so only a few buffers exist at a time
+struct PendingSegment {
+    SnapshotSegment segment;
+    const uint8_t* data = nullptr;
+    std::function<void(std::vector<uint8_t>&)> fill;
+};
+
+std::string segment_file_name(const SnapshotSegment& segment) {
+    char crc[9];
+    std::snprintf(crc, sizeof(crc), "%08" PRIx32, segment.crc32c);
+    std::string name = segment.kind;
+    if (!segment.array.empty()) {
+        name += "." + segment.array;
+    }
+    return std::string(kSegmentDirectory) + "/" + name + "-" + crc + "-" +
+           std::to_string(segment.bytes) + ".seg";
+}
+
+std::string manifest_file_name(uint64_t version) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%012" PRIu64 ".json", version);
+    return std::string(kManifestDirectory) + "/" + name;
+}
+
+int thread_count(const SnapshotOptions& options) {
+    return options.num_threads > 0 ? options.num_threads : omp_get_max_threads();
+}
+
+void add_chunks(std::vector<PendingSegment>& pending, const std::string& kind, const std::string& array,
+                const void* data, size_t bytes, size_t chunk_bytes) {
+    const auto* base = static_cast<const uint8_t*>(data);
+    for (size_t offset = 0; offset < bytes; offset += chunk_bytes) {
+        PendingSegment chunk;
+        chunk.segment.kind = kind;
+        chunk.segment.array = array;
+        chunk.segment.offset = offset;
+        chunk.segment.bytes = std::min(chunk_bytes, bytes - offset);
+        chunk.data = base + offset;
+        pending.push_back(std::move(chunk));
+    }
+}
+
+// Codes or ids of a group of lists: a table of list sizes, then the lists
+void serialize_lists(const faiss::InvertedLists& invlists, size_t first_list, size_t num_lists,
+                     bool ids, std::vector<uint8_t>& buffer) {
+    size_t entry_size = ids ? sizeof(faiss::idx_t) : invlists.code_size;
+    size_t total = num_lists * sizeof(uint64_t);
+    for (size_t i = 0; i < num_lists; ++i) {
+        total += invlists.list_size(first_list + i) * entry_size;
+    }
+    buffer.resize(total);
+
+    size_t offset = num_lists * sizeof(uint64_t);
+    for (size_t i = 0; i < num_lists; ++i) {
+        size_t list_no = first_list + i;
+        uint64_t size = invlists.list_size(list_no);
+        std::memcpy(buffer.data() + i * sizeof(uint64_t), &size, sizeof(size));
+        if (size == 0) {
+            continue;
+        }
+        if (ids) {
+            const faiss::idx_t* list_ids = invlists.get_ids(list_no);
+            std::memcpy(buffer.data() + offset, list_ids, size * entry_size);
+            invlists.release_ids(list_no, list_ids);
+        } else {
+            const uint8_t* codes = invlists.get_codes(list_no);
+            std::memcpy(buffer.data() + offset, codes, size * entry_size);
+            invlists.release_codes(list_no, codes);
+        }
+        offset += size * entry_size;
+    }
+}
+
+// Parse a list group; returns the offset of each list's data, or false
+bool parse_list_table(const uint8_t* data, size_t bytes, size_t num_lists, size_t entry_size,
+                      std::vector<uint64_t>& sizes, std::vector<size_t>& offsets) {
+    if (bytes < num_lists * sizeof(uint64_t)) {
+        return false;
+    }
+    sizes.resize(num_lists);
+    offsets.resize(num_lists);
+    std::memcpy(sizes.data(), data, num_lists * sizeof(uint64_t));
+    size_t offset = num_lists * sizeof(uint64_t);
+    for (size_t i = 0; i < num_lists; ++i) {
+        offsets[i] = offset;
+        if (sizes[i] > (bytes - offset) / std::max<size_t>(entry_size, 1)) {
+            return false;
+        }
+        offset += sizes[i] * entry_size;
+    }
+    return offset == bytes;
+}
+
+void serialize_metadata(const std::vector<std::string>& metadata, std::vector<uint8_t>& buffer) {
+    size_t total = sizeof(uint64_t);
+    for (const auto& entry : metadata) {
+        total += sizeof(uint64_t) + entry.size();
+    }
+    buffer.resize(total);
+    uint64_t count = metadata.size();
+    std::memcpy(buffer.data(), &count, sizeof(count));
+    size_t offset = sizeof(count);
+    for (const auto& entry : metadata) {
+        uint64_t length = entry.size();
+        std::memcpy(buffer.data() + offset, &length, sizeof(length));
+        std::memcpy(buffer.data() + offset + sizeof(length), entry.data(), entry.size());
+        offset += sizeof(length) + entry.size();
+    }
+}
+
+bool parse_metadata(const std::vector<uint8_t>& buffer, std::vector<std::string>& metadata) {
+    uint64_t count = 0;
+    if (buffer.size() < sizeof(count)) {
+        return false;
+    }
+    std::memcpy(&count, buffer.data(), sizeof(count));
+    size_t offset = sizeof(count);
+    metadata.clear();
+    metadata.reserve(std::min<uint64_t>(count, buffer.size() / sizeof(uint64_t)));
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t length = 0;
+        if (buffer.size() - offset < sizeof(length)) {
+            return false;
+        }
+        std::memcpy(&length, buffer.data() + offset, sizeof(length));
+        offset += sizeof(length);
+        if (buffer.size() - offset < length) {
+            return false;
+        }
+        metadata.emplace_back(reinterpret_cast<const char*>(buffer.data()) + offset, length);
+        offset += length;
+    }
+    return offset == buffer.size();
+}
+
+bool write_file_atomically(const fs::path& path, const void* data, size_t size, const std::string& suffix) {
+    fs::path temp_path = path;
+    temp_path += ".tmp" + suffix;
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Index snapshot: cannot create " << temp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = ::write(fd, bytes + written, size - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            std::cerr << "Index snapshot: cannot write " << temp_path << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    // The manifest must never reference a segment that is not on disk
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    if (!synced || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Index snapshot: cannot commit " << path << ": " << std::strerror(errno) << std::endl;
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool read_file(const fs::path& path, uint8_t* destination, size_t size) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Index snapshot: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    size_t done = 0;
+    while (done < size) {
+        ssize_t result = ::pread(fd, destination + done, size - done, static_cast<off_t>(done));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(result);
+    }
+    ::close(fd);
+    if (done != size) {
+        std::cerr << "Index snapshot: short read of " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Read one segment into memory and check it against the manifest
+bool read_segment(const fs::path& directory, const SnapshotSegment& segment, uint8_t* destination,
+                  bool verify) {
+    if (!read_file(directory / segment.file, destination, segment.bytes)) {
+        return false;
+    }
+    if (verify && crc32c(destination, segment.bytes) != segment.crc32c) {
+        std::cerr << "Index snapshot: checksum mismatch in " << segment.file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Run jobs on a thread pool; stops starting new jobs after the first failure
+bool run_parallel(const std::vector<std::function<bool()>>& jobs, int threads) {
+    std::atomic<bool> failed(false);
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (failed.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        bool ok = false;
+        try {
+            ok = jobs[i]();
+        } catch (const std::exception& e) {
+            std::cerr << "Index snapshot: " << e.what() << std::endl;
+        }
+        if (!ok) {
+            failed.store(true);
+        }
+    }
+    return !failed.load();
+}
+
+// Queue reads of every chunk of one array into a contiguous destination
+void add_chunk_reads(std::vector<std::function<bool()>>& jobs, const fs::path& directory,
+                     const SnapshotManifest& manifest, const std::string& kind, const std::string& array,
+                     uint8_t* destination, size_t size, bool verify) {
+    for (const auto& segment : manifest.segments) {
+        if (segment.kind != kind || segment.array != array) {
+            continue;
+        }
+        jobs.push_back([&directory, &segment, destination, size, verify]() {
+            if (segment.offset + segment.bytes > size) {
+                std::cerr << "Index snapshot: " << segment.file << " lies outside its array" << std::endl;
+                return false;
+            }
+            return read_segment(directory, segment, destination + segment.offset, verify);
+        });
+    }
+}
+
+faiss::Index* deserialize_index(std::vector<uint8_t>&& bytes) {
+    faiss::VectorIOReader reader;
+    reader.data = std::move(bytes);
+    return faiss::read_index(&reader);
+}
+
+// Remove manifests beyond keep_versions and segments none of the rest use
+size_t prune_snapshots(const fs::path& directory, int keep_versions) {
+    std::error_code error;
+    std::vector<fs::path> manifests;
+    for (const auto& entry : fs::directory_iterator(directory / kManifestDirectory, error)) {
+        if (entry.path().extension() == ".json") {
+            manifests.push_back(entry.path());
+        }
+    }
+    std::sort(manifests.begin(), manifests.end());
+    size_t keep = static_cast<size_t>(std::max(keep_versions, 1));
+    size_t removed = 0;
+    while (manifests.size() > keep) {
+        fs::remove(manifests.front(), error);
+        manifests.erase(manifests.begin());
+    }
+
+    std::set<std::string> referenced;
+    for (const auto& path : manifests) {
+        SnapshotManifest manifest;
+        std::ifstream file(path);
+        nlohmann::json value = nlohmann::json::parse(file, nullptr, false);
+        if (value.is_discarded() || !SnapshotManifest::from_json(value, manifest)) {
+            // Unreadable history: keep every segment rather than guess
+            return 0;
+        }
+        for (const auto& segment : manifest.segments) {
+            referenced.insert(segment.file);
+        }
+    }
+
+    for (const auto& entry : fs::directory_iterator(directory / kSegmentDirectory, error)) {
+        if (entry.path().extension() != ".seg") {
+            continue;
+        }
+        std::string relative = std::string(kSegmentDirectory) + "/" + entry.path().filename().string();
+        if (!referenced.count(relative) && fs::remove(entry.path(), error)) {
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// SnapshotManifest
+// ---------------------------------------------------------------------------
+
+nlohmann::json SnapshotManifest::to_json() const {
+    nlohmann::json segment_list = nlohmann::json::array();
+    for (const auto& segment : segments) {
+        nlohmann::json entry = {
+            {"kind", segment.kind},
+            {"file", segment.file},
+            {"bytes", segment.bytes},
+            {"crc32c", segment.crc32c}
+        };
+        if (!segment.array.empty()) {
+            entry["array"] = segment.array;
+        }
+        if (segment.kind == "codes" || segment.kind == "ids") {
+            entry["first_list"] = segment.first_list;
+            entry["num_lists"] = segment.num_lists;
+        } else {
+            entry["offset"] = segment.offset;
+        }
+        segment_list.push_back(entry);
+    }
+    return {
+        {"format_version", format_version},
+        {"version", version},
+        {"created_at", created_at},
+        {"index_type", index_type},
+        {"dimension", dimension},
+        {"metric", metric == faiss::METRIC_INNER_PRODUCT ? "ip" : "l2"},
+        {"ntotal", ntotal},
+        {"params", params.is_null() ? nlohmann::json::object() : params},
+        {"segments", segment_list}
+    };
+}
+
+bool SnapshotManifest::from_json(const nlohmann::json& value, SnapshotManifest& manifest) {
+    try {
+        manifest.format_version = value.at("format_version").get<int>();
+        if (manifest.format_version != kFormatVersion) {
+            std::cerr << "Index snapshot: unsupported format version " << manifest.format_version << std::endl;
+            return false;
+        }
+        manifest.version = value.at("version").get<uint64_t>();
+        manifest.created_at = value.value("created_at", int64_t{0});
+        manifest.index_type = value.at("index_type").get<std::string>();
+        manifest.dimension = value.at("dimension").get<int>();
+        manifest.metric = value.at("metric").get<std::string>() == "ip" ? faiss::METRIC_INNER_PRODUCT
+                                                                       : faiss::METRIC_L2;
+        manifest.ntotal = value.at("ntotal").get<int64_t>();
+        manifest.params = value.value("params", nlohmann::json::object());
+        manifest.segments.clear();
+        for (const auto& entry : value.at("segments")) {
+            SnapshotSegment segment;
+            segment.kind = entry.at("kind").get<std::string>();
+            segment.array = entry.value("array", std::string());
+            segment.file = entry.at("file").get<std::string>();
+            segment.bytes = entry.at("bytes").get<uint64_t>();
+            segment.crc32c = entry.at("crc32c").get<uint32_t>();
+            segment.offset = entry.value("offset", uint64_t{0});
+            segment.first_list = entry.value("first_list", int64_t{0});
+            segment.num_lists = entry.value("num_lists", int64_t{0});
+            if (segment.file.find("..") != std::string::npos) {
+                return false;
+            }
+            manifest.segments.push_back(std::move(segment));
+        }
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Index snapshot: malformed manifest: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotManifest::read(const std::string& directory, SnapshotManifest& manifest) {
+    std::ifstream file(fs::path(directory) / kManifestFile);
+    if (!file) {
+        return false;
+    }
+    nlohmann::json value = nlohmann::json::parse(file, nullptr, false);
+    return !value.is_discarded() && from_json(value, manifest);
+}
+
+uint64_t SnapshotManifest::total_bytes(const std::string& kind, const std::string& array) const {
+    uint64_t total = 0;
+    for (const auto& segment : segments) {
+        if (segment.kind == kind && segment.array == array) {
+            total += segment.bytes;
+        }
+    }
+    return total;
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+// ---------------------------------------------------------------------------
+
+nlohmann::json write_index_snapshot(const faiss::Index& index,
+                                    const std::vector<std::string>* metadata,
+                                    const std::vector<uint8_t>* transform,
+                                    const std::string& directory,
+                                    const SnapshotOptions& options) {
+    auto start_time = std::chrono::steady_clock::now();
+    fs::path root(directory);
+    std::error_code error;
+    fs::create_directories(root / kSegmentDirectory, error);
+    fs::create_directories(root / kManifestDirectory, error);
+    if (error) {
+        std::cerr << "Index snapshot: cannot create " << directory << ": " << error.message() << std::endl;
+        return nullptr;
+    }
+
+    SnapshotManifest previous;
+    SnapshotManifest manifest;
+    manifest.version = SnapshotManifest::read(directory, previous) ? previous.version + 1 : 1;
+    manifest.created_at = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    manifest.dimension = index.d;
+    manifest.metric = index.metric_type;
+    manifest.ntotal = index.ntotal;
+    manifest.params = nlohmann::json::object();
+
+    size_t chunk_bytes = std::max<size_t>(options.chunk_bytes, 4096);
+    std::vector<PendingSegment> pending;
+    std::vector<uint8_t> quantizer_bytes;
+    std::vector<uint8_t> index_bytes;
+    std::vector<uint8_t> metadata_bytes;
+
+    try {
+        if (auto* ivf = dynamic_cast<const faiss::IndexIVFFlat*>(&index)) {
+            // The quantizer and a few parameters rebuild the IVF shell; lists
+            // go in fixed groups so an update rewrites only the groups it hit
+            manifest.index_type = "IVF_FLAT";
+            size_t groups = std::max<size_t>(1, std::min(options.list_groups, ivf->nlist));
+            size_t lists_per_group = (ivf->nlist + groups - 1) / groups;
+            manifest.params = {
+                {"nlist", ivf->nlist},
+                {"nprobe", ivf->nprobe},
+                {"code_size", ivf->code_size},
+                {"lists_per_segment", lists_per_group},
+                {"direct_map", static_cast<int>(ivf->direct_map.type)}
+            };
+
+            faiss::VectorIOWriter writer;
+            faiss::write_index(ivf->quantizer, &writer);
+            quantizer_bytes = std::move(writer.data);
+            add_chunks(pending, "quantizer", "", quantizer_bytes.data(), quantizer_bytes.size(), chunk_bytes);
+
+            const faiss::InvertedLists* invlists = ivf->invlists;
+            for (size_t first = 0; first < ivf->nlist; first += lists_per_group) {
+                size_t count = std::min(lists_per_group, ivf->nlist - first);
+                for (bool ids : {false, true}) {
+                    PendingSegment group;
+                    group.segment.kind = ids ? "ids" : "codes";
+                    group.segment.first_list = static_cast<int64_t>(first);
+                    group.segment.num_lists = static_cast<int64_t>(count);
+                    group.fill = [invlists, first, count, ids](std::vector<uint8_t>& buffer) {
+                        serialize_lists(*invlists, first, count, ids, buffer);
+                    };
+                    pending.push_back(std::move(group));
+                }
+            }
+        } else if (auto* hnsw_index = dynamic_cast<const faiss::IndexHNSWFlat*>(&index)) {
+            auto* storage = dynamic_cast<const faiss::IndexFlat*>(hnsw_index->storage);
+            if (!storage) {
+                throw faiss::FaissException("HNSW storage is not a flat index");
+            }
+            const faiss::HNSW& hnsw = hnsw_index->hnsw;
+            manifest.index_type = "HNSW_FLAT";
+            manifest.params = {
+                {"M", hnsw.nb_neighbors(1)},
+                {"entry_point", hnsw.entry_point},
+                {"max_level", hnsw.max_level},
+                {"ef_construction", hnsw.efConstruction},
+                {"ef_search", hnsw.efSearch},
+                {"assign_probas", hnsw.assign_probas},
+                {"cum_nneighbor_per_level", hnsw.cum_nneighbor_per_level}
+            };
+            add_chunks(pending, "graph", "levels", hnsw.levels.data(),
+                       hnsw.levels.size() * sizeof(hnsw.levels[0]), chunk_bytes);
+            add_chunks(pending, "graph", "offsets", hnsw.offsets.data(),
+                       hnsw.offsets.size() * sizeof(hnsw.offsets[0]), chunk_bytes);
+            add_chunks(pending, "graph", "neighbors", hnsw.neighbors.data(),
+                       hnsw.neighbors.size() * sizeof(hnsw.neighbors[0]), chunk_bytes);
+            add_chunks(pending, "vectors", "", storage->codes.data(), storage->codes.size(), chunk_bytes);
+        } else if (auto* flat = dynamic_cast<const faiss::IndexFlat*>(&index)) {
+            manifest.index_type = "FLAT";
+            add_chunks(pending, "vectors", "", flat->codes.data(), flat->codes.size(), chunk_bytes);
+        } else {
+            // Other faiss indexes as their own serialization, chunked so that
+            // appends to the tail still leave the leading chunks unchanged
+            manifest.index_type = "FAISS";
+            faiss::VectorIOWriter writer;
+            faiss::write_index(&index, &writer);
+            index_bytes = std::move(writer.data);
+            add_chunks(pending, "faiss", "", index_bytes.data(), index_bytes.size(), chunk_bytes);
+        }
+    } catch (const faiss::FaissException& e) {
+        std::cerr << "Index snapshot: cannot serialize index: " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    if (metadata && !metadata->empty()) {
+        serialize_metadata(*metadata, metadata_bytes);
+        add_chunks(pending, "metadata", "", metadata_bytes.data(), metadata_bytes.size(), chunk_bytes);
+    }
+    if (transform && !transform->empty()) {
+        add_chunks(pending, "transform", "", transform->data(), transform->size(), chunk_bytes);
+    }
+
+    std::atomic<size_t> segments_written(0);
+    std::atomic<size_t> bytes_written(0);
+    std::atomic<size_t> segments_reused(0);
+    std::atomic<size_t> bytes_reused(0);
+    std::vector<std::function<bool()>> jobs;
+    jobs.reserve(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+        jobs.push_back([&, i]() {
+            PendingSegment& item = pending[i];
+            std::vector<uint8_t> buffer;
+            if (item.fill) {
+                item.fill(buffer);
+                item.data = buffer.data();
+                item.segment.bytes = buffer.size();
+            }
+            item.segment.crc32c = crc32c(item.data, item.segment.bytes);
+            item.segment.file = segment_file_name(item.segment);
+
+            fs::path path = root / item.segment.file;
+            std::error_code exists_error;
+            if (fs::exists(path, exists_error) && fs::file_size(path, exists_error) == item.segment.bytes) {
+                segments_reused.fetch_add(1);
+                bytes_reused.fetch_add(item.segment.bytes);
+                return true;
+            }
+            // Identical groups (e.g. empty ones) share a file; per-job temp names keep them apart
+            if (!write_file_atomically(path, item.data, item.segment.bytes, "." + std::to_string(i))) {
+                return false;
+            }
+            segments_written.fetch_add(1);
+            bytes_written.fetch_add(item.segment.bytes);
+            return true;
+        });
+    }
+    if (!run_parallel(jobs, thread_count(options))) {
+        return nullptr;
+    }
+    for (auto& item : pending) {
+        manifest.segments.push_back(std::move(item.segment));
+    }
+
+    // Versioned copy first, then the pointer every reader follows
+    std::string manifest_text = manifest.to_json().dump(1);
+    if (!write_file_atomically(root / manifest_file_name(manifest.version), manifest_text.data(),
+                               manifest_text.size(), "") ||
+        !write_file_atomically(root / kManifestFile, manifest_text.data(), manifest_text.size(), "")) {
+        return nullptr;
+    }
+    size_t pruned = prune_snapshots(root, options.keep_versions);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return {
+        {"version", manifest.version},
+        {"index_type", manifest.index_type},
+        {"ntotal", manifest.ntotal},
+        {"segments", manifest.segments.size()},
+        {"segments_written", segments_written.load()},
+        {"bytes_written", bytes_written.load()},
+        {"segments_reused", segments_reused.load()},
+        {"bytes_reused", bytes_reused.load()},
+        {"segments_pruned", pruned},
+        {"seconds", seconds}
+    };
+}
+
+// ---------------------------------------------------------------------------
+// Loading
+// ---------------------------------------------------------------------------
+
+bool read_index_snapshot(const std::string& directory, IndexSnapshot& snapshot,
+                         const SnapshotOptions& options) {
+    fs::path root(directory);
+    SnapshotManifest& manifest = snapshot.manifest;
+    if (!SnapshotManifest::read(directory, manifest)) {
+        std::cerr << "Index snapshot: no readable manifest in " << directory << std::endl;
+        return false;
+    }
+
+    // A missing or truncated segment fails here, before anything is allocated
+    for (const auto& segment : manifest.segments) {
+        std::error_code error;
+        auto size = fs::file_size(root / segment.file, error);
+        if (error || size != segment.bytes) {
+            std::cerr << "Index snapshot: " << segment.file << " is missing or truncated" << std::endl;
+            return false;
+        }
+    }
+
+    bool verify = options.verify_checksums;
+    int threads = thread_count(options);
+    std::vector<std::function<bool()>> jobs;
+    std::vector<uint8_t> metadata_bytes(manifest.total_bytes("metadata"));
+    add_chunk_reads(jobs, root, manifest, "metadata", "", metadata_bytes.data(), metadata_bytes.size(), verify);
+    snapshot.transform.resize(manifest.total_bytes("transform"));
+    add_chunk_reads(jobs, root, manifest, "transform", "", snapshot.transform.data(), snapshot.transform.size(),
+                    verify);
+
+    try {
+        if (manifest.index_type == "FLAT") {
+            auto flat = std::make_unique<faiss::IndexFlat>(manifest.dimension, manifest.metric);
+            flat->codes.resize(manifest.total_bytes("vectors"));
+            add_chunk_reads(jobs, root, manifest, "vectors", "", flat->codes.data(), flat->codes.size(), verify);
+            if (!run_parallel(jobs, threads)) {
+                return false;
+            }
+            flat->ntotal = static_cast<faiss::idx_t>(flat->codes.size() / flat->code_size);
+            snapshot.index = std::move(flat);
+        } else if (manifest.index_type == "HNSW_FLAT") {
+            const auto& params = manifest.params;
+            auto hnsw_index = std::make_unique<faiss::IndexHNSWFlat>(
+                manifest.dimension, params.at("M").get<int>(), manifest.metric);
+            faiss::HNSW& hnsw = hnsw_index->hnsw;
+            hnsw.assign_probas = params.at("assign_probas").get<std::vector<double>>();
+            hnsw.cum_nneighbor_per_level = params.at("cum_nneighbor_per_level").get<std::vector<int>>();
+            hnsw.entry_point = params.at("entry_point").get<faiss::HNSW::storage_idx_t>();
+            hnsw.max_level = params.at("max_level").get<int>();
+            hnsw.efConstruction = params.at("ef_construction").get<int>();
+            hnsw.efSearch = params.at("ef_search").get<int>();
+            hnsw.levels.resize(manifest.total_bytes("graph", "levels") / sizeof(hnsw.levels[0]));
+            hnsw.offsets.resize(manifest.total_bytes("graph", "offsets") / sizeof(hnsw.offsets[0]));
+            hnsw.neighbors.resize(manifest.total_bytes("graph", "neighbors") / sizeof(hnsw.neighbors[0]));
+
+            auto* storage = dynamic_cast<faiss::IndexFlat*>(hnsw_index->storage);
+            storage->codes.resize(manifest.total_bytes("vectors"));
+            add_chunk_reads(jobs, root, manifest, "graph", "levels",
+                            reinterpret_cast<uint8_t*>(hnsw.levels.data()),
+                            hnsw.levels.size() * sizeof(hnsw.levels[0]), verify);
+            add_chunk_reads(jobs, root, manifest, "graph", "offsets",
+                            reinterpret_cast<uint8_t*>(hnsw.offsets.data()),
+                            hnsw.offsets.size() * sizeof(hnsw.offsets[0]), verify);
+            add_chunk_reads(jobs, root, manifest, "graph", "neighbors",
+                            reinterpret_cast<uint8_t*>(hnsw.neighbors.data()),
+                            hnsw.neighbors.size() * sizeof(hnsw.neighbors[0]), verify);
+            add_chunk_reads(jobs, root, manifest, "vectors", "", storage->codes.data(),
+                            storage->codes.size(), verify);
+            if (!run_parallel(jobs, threads)) {
+                return false;
+            }
+            storage->ntotal = static_cast<faiss::idx_t>(storage->codes.size() / storage->code_size);
+            hnsw_index->ntotal = storage->ntotal;
+            if (hnsw.levels.size() != static_cast<size_t>(storage->ntotal) ||
+                hnsw.offsets.size() != hnsw.levels.size() + 1) {
+                std::cerr << "Index snapshot: HNSW graph does not match its vectors" << std::endl;
+                return false;
+            }
+            snapshot.index = std::move(hnsw_index);
+        } else if (manifest.index_type == "IVF_FLAT") {
+            const auto& params = manifest.params;
+            size_t nlist = params.at("nlist").get<size_t>();
+            size_t code_size = params.at("code_size").get<size_t>();
+
+            std::vector<uint8_t> quantizer_bytes(manifest.total_bytes("quantizer"));
+            add_chunk_reads(jobs, root, manifest, "quantizer", "", quantizer_bytes.data(),
+                            quantizer_bytes.size(), verify);
+
+            // Pair each codes group with the ids group for the same lists
+            std::map<int64_t, std::pair<const SnapshotSegment*, const SnapshotSegment*>> groups;
+            for (const auto& segment : manifest.segments) {
+                if (segment.kind == "codes") {
+                    groups[segment.first_list].first = &segment;
+                } else if (segment.kind == "ids") {
+                    groups[segment.first_list].second = &segment;
+                }
+            }
+            for (const auto& group : groups) {
+                const SnapshotSegment* codes = group.second.first;
+                const SnapshotSegment* ids = group.second.second;
+                if (!codes || !ids || codes->num_lists != ids->num_lists || codes->first_list < 0 ||
+                    static_cast<size_t>(codes->first_list + codes->num_lists) > nlist) {
+                    std::cerr << "Index snapshot: list group at " << group.first << " is incomplete" << std::endl;
+                    return false;
+                }
+            }
+
+            std::unique_ptr<faiss::InvertedLists> invlists;
+            if (options.lazy) {
+                // Mapping is cheap; pages are read on first access
+                auto mapped = std::make_unique<MappedInvertedLists>(nlist, code_size);
+                for (const auto& group : groups) {
+                    const SnapshotSegment* codes = group.second.first;
+                    const SnapshotSegment* ids = group.second.second;
+                    const uint32_t checksums[2] = {codes->crc32c, ids->crc32c};
+                    if (!mapped->map_segments((root / codes->file).string(), (root / ids->file).string(),
+                                              codes->first_list, codes->num_lists,
+                                              verify ? checksums : nullptr)) {
+                        return false;
+                    }
+                }
+                invlists = std::move(mapped);
+            } else {
+                auto* lists = new faiss::ArrayInvertedLists(nlist, code_size);
+                invlists.reset(lists);
+                for (const auto& group : groups) {
+                    const SnapshotSegment* codes = group.second.first;
+                    const SnapshotSegment* ids = group.second.second;
+                    jobs.push_back([&root, codes, ids, lists, code_size, verify]() {
+                        std::vector<uint8_t> code_bytes(codes->bytes);
+                        std::vector<uint8_t> id_bytes(ids->bytes);
+                        if (!read_segment(root, *codes, code_bytes.data(), verify) ||
+                            !read_segment(root, *ids, id_bytes.data(), verify)) {
+                            return false;
+                        }
+                        size_t num_lists = static_cast<size_t>(codes->num_lists);
+                        std::vector<uint64_t> code_sizes, id_sizes;
+                        std::vector<size_t> code_offsets, id_offsets;
+                        if (!parse_list_table(code_bytes.data(), code_bytes.size(), num_lists, code_size,
+                                              code_sizes, code_offsets) ||
+                            !parse_list_table(id_bytes.data(), id_bytes.size(), num_lists,
+                                              sizeof(faiss::idx_t), id_sizes, id_offsets) ||
+                            code_sizes != id_sizes) {
+                            std::cerr << "Index snapshot: " << codes->file << " and " << ids->file
+                                      << " do not describe the same lists" << std::endl;
+                            return false;
+                        }
+                        // Each group owns its lists, so groups fill in parallel
+                        for (size_t i = 0; i < num_lists; ++i) {
+                            if (code_sizes[i] == 0) {
+                                continue;
+                            }
+                            lists->add_entries(codes->first_list + i, code_sizes[i],
+                                               reinterpret_cast<const faiss::idx_t*>(id_bytes.data() + id_offsets[i]),
+                                               code_bytes.data() + code_offsets[i]);
+                        }
+                        return true;
+                    });
+                }
+            }
+            if (!run_parallel(jobs, threads)) {
+                return false;
+            }
+
+            std::unique_ptr<faiss::Index> quantizer(deserialize_index(std::move(quantizer_bytes)));
+            auto ivf = std::make_unique<faiss::IndexIVFFlat>(quantizer.get(), manifest.dimension, nlist,
+                                                             manifest.metric);
+            quantizer.release();
+            ivf->own_fields = true;
+            ivf->nprobe = params.value("nprobe", size_t{1});
+            ivf->replace_invlists(invlists.release(), true);
+            size_t ntotal = 0;
+            if (auto* mapped = dynamic_cast<const MappedInvertedLists*>(ivf->invlists)) {
+                // list_size() would verify every mapped segment now
+                ntotal = mapped->total_entries();
+            } else {
+                for (size_t list_no = 0; list_no < nlist; ++list_no) {
+                    ntotal += ivf->invlists->list_size(list_no);
+                }
+            }
+            ivf->ntotal = static_cast<faiss::idx_t>(ntotal);
+            auto direct_map = static_cast<faiss::DirectMap::Type>(params.value("direct_map", 0));
+            if (direct_map != faiss::DirectMap::NoMap) {
+                // Rebuilt from the ids; with mapped lists this reads every ids page
+                ivf->set_direct_map_type(direct_map);
+            }
+            snapshot.index = std::move(ivf);
+        } else if (manifest.index_type == "FAISS") {
+            std::vector<uint8_t> index_bytes(manifest.total_bytes("faiss"));
+            add_chunk_reads(jobs, root, manifest, "faiss", "", index_bytes.data(), index_bytes.size(), verify);
+            if (!run_parallel(jobs, threads)) {
+                return false;
+            }
+            snapshot.index.reset(deserialize_index(std::move(index_bytes)));
+        } else {
+            std::cerr << "Index snapshot: unknown index type " << manifest.index_type << std::endl;
+            return false;
+        }
+    } catch (const faiss::FaissException& e) {
+        std::cerr << "Index snapshot: cannot rebuild index: " << e.what() << std::endl;
+        return false;
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Index snapshot: bad index parameters: " << e.what() << std::endl;
+        return false;
+    }
+
+    if (snapshot.index->ntotal != manifest.ntotal) {
+        std::cerr << "Index snapshot: " << snapshot.index->ntotal << " vectors loaded, manifest says "
+                  << manifest.ntotal << std::endl;
+        return false;
+    }
+    if (!metadata_bytes.empty() && !parse_metadata(metadata_bytes, snapshot.metadata)) {
+        std::cerr << "Index snapshot: metadata is corrupt" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// MappedInvertedLists
+// ---------------------------------------------------------------------------
+
+MappedInvertedLists::MappedInvertedLists(size_t nlist, size_t code_size)
+    : faiss::InvertedLists(nlist, code_size),
+      lists_(nlist),
+      corrupt_segments_(0) {
+}
+
+MappedInvertedLists::~MappedInvertedLists() {
+    for (const auto& mapping : mappings_) {
+        ::munmap(mapping.address, mapping.length);
+    }
+}
+
+bool MappedInvertedLists::map_segments(const std::string& codes_path, const std::string& ids_path,
+                                       size_t first_list, size_t num_lists, const uint32_t* checksums) {
+    if (first_list + num_lists > nlist) {
+        return false;
+    }
+
+    std::vector<uint64_t> sizes[2];
+    std::vector<size_t> offsets[2];
+    const uint8_t* bases[2] = {nullptr, nullptr};
+    const std::string* paths[2] = {&codes_path, &ids_path};
+    for (int i = 0; i < 2; ++i) {
+        int fd = ::open(paths[i]->c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "MappedInvertedLists: cannot open " << *paths[i] << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        off_t length = ::lseek(fd, 0, SEEK_END);
+        void* address = length > 0 ? ::mmap(nullptr, static_cast<size_t>(length), PROT_READ, MAP_SHARED, fd, 0)
+                                   : MAP_FAILED;
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            std::cerr << "MappedInvertedLists: cannot map " << *paths[i] << std::endl;
+            return false;
+        }
+        mappings_.push_back({address, static_cast<size_t>(length)});
+        bases[i] = static_cast<const uint8_t*>(address);
+        size_t entry_size = i == 0 ? code_size : sizeof(faiss::idx_t);
+        if (!parse_list_table(bases[i], static_cast<size_t>(length), num_lists, entry_size, sizes[i], offsets[i])) {
+            std::cerr << "MappedInvertedLists: " << *paths[i] << " is corrupt" << std::endl;
+            return false;
+        }
+    }
+    if (sizes[0] != sizes[1]) {
+        std::cerr << "MappedInvertedLists: " << codes_path << " and " << ids_path
+                  << " do not describe the same lists" << std::endl;
+        return false;
+    }
+
+    SegmentGroup* group = nullptr;
+    if (checksums) {
+        groups_.push_back(std::make_unique<SegmentGroup>());
+        group = groups_.back().get();
+        group->name = codes_path;
+        for (int i = 0; i < 2; ++i) {
+            const Mapping& mapping = mappings_[mappings_.size() - 2 + i];
+            group->data[i] = static_cast<const uint8_t*>(mapping.address);
+            group->length[i] = mapping.length;
+            group->crc[i] = checksums[i];
+        }
+    }
+
+    for (size_t i = 0; i < num_lists; ++i) {
+        List& list = lists_[first_list + i];
+        list.codes = bases[0] + offsets[0][i];
+        list.ids = reinterpret_cast<const faiss::idx_t*>(bases[1] + offsets[1][i]);
+        list.size = sizes[0][i];
+        list.group = group;
+    }
+    return true;
+}
+
+bool MappedInvertedLists::check_list(const List& list) const {
+    SegmentGroup* group = list.group;
+    if (!group || list.owned) {
+        return true;
+    }
+    // Concurrent first probes wait for one check instead of each reading the segments
+    std::call_once(group->verified, [this, group]() {
+        for (int i = 0; i < 2; ++i) {
+            if (crc32c(group->data[i], group->length[i]) != group->crc[i]) {
+                group->corrupt.store(true);
+                corrupt_segments_.fetch_add(1);
+                std::cerr << "MappedInvertedLists: " << group->name
+                          << " failed its checksum; its lists are served empty" << std::endl;
+                return;
+            }
+        }
+    });
+    return !group->corrupt.load(std::memory_order_relaxed);
+}
+
+size_t MappedInvertedLists::list_size(size_t list_no) const {
+    const List& list = lists_[list_no];
+    return check_list(list) ? list.size : 0;
+}
+
+const uint8_t* MappedInvertedLists::get_codes(size_t list_no) const {
+    const List& list = lists_[list_no];
+    return list.owned ? list.own_codes.data() : list.codes;
+}
+
+const faiss::idx_t* MappedInvertedLists::get_ids(size_t list_no) const {
+    const List& list = lists_[list_no];
+    return list.owned ? list.own_ids.data() : list.ids;
+}
+
+size_t MappedInvertedLists::add_entries(size_t list_no, size_t n_entry, const faiss::idx_t* ids,
+                                        const uint8_t* code) {
+    make_owned(list_no);
+    List& list = lists_[list_no];
+    size_t offset = list.size;
+    list.own_codes.resize((offset + n_entry) * code_size);
+    list.own_ids.resize(offset + n_entry);
+    std::memcpy(list.own_codes.data() + offset * code_size, code, n_entry * code_size);
+    std::memcpy(list.own_ids.data() + offset, ids, n_entry * sizeof(faiss::idx_t));
+    list.size = offset + n_entry;
+    return offset;
+}
+
+void MappedInvertedLists::update_entries(size_t list_no, size_t offset, size_t n_entry,
+                                         const faiss::idx_t* ids, const uint8_t* code) {
+    make_owned(list_no);
+    List& list = lists_[list_no];
+    if (offset + n_entry > list.size) {
+        throw faiss::FaissException("MappedInvertedLists: update past the end of a list");
+    }
+    std::memcpy(list.own_codes.data() + offset * code_size, code, n_entry * code_size);
+    std::memcpy(list.own_ids.data() + offset, ids, n_entry * sizeof(faiss::idx_t));
+}
+
+void MappedInvertedLists::resize(size_t list_no, size_t new_size) {
+    make_owned(list_no);
+    List& list = lists_[list_no];
+    list.own_codes.resize(new_size * code_size);
+    list.own_ids.resize(new_size);
+    list.size = new_size;
+}
+
+size_t MappedInvertedLists::total_entries() const {
+    size_t total = 0;
+    for (const List& list : lists_) {
+        total += list.size;
+    }
+    return total;
+}
+
+size_t MappedInvertedLists::owned_lists() const {
+    return static_cast<size_t>(std::count_if(lists_.begin(), lists_.end(),
+                                             [](const List& list) { return list.owned; }));
+}
+
+void MappedInvertedLists::make_owned(size_t list_no) {
+    List& list = lists_[list_no];
+    if (list.owned) {
+        return;
+    }
+    if (!check_list(list)) {
+        list.size = 0;
+    }
+    if (list.size > 0) {
+        list.own_codes.assign(list.codes, list.codes + list.size * code_size);
+        list.own_ids.assign(list.ids, list.ids + list.size);
+    }
+    list.owned = true;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::save_index_snapshot(const std::string& directory) {
+    const std::string& target = directory.empty() ? config_.index_snapshot_dir : directory;
+    if (target.empty()) {
+        std::cerr << "No index snapshot directory configured" << std::endl;
+        return false;
+    }
+
+    // Fold any delta segment in first; vectors added after the merge go
+    // into the next snapshot
+    merge_delta_index();
+
+    std::vector<std::string> metadata;
+    {
+        std::lock_guard<std::mutex> metadata_lock(metadata_mutex_);
+        metadata = metadata_;
+    }
+
+    std::unique_lock<std::mutex> lock(index_mutex_);
+    if (!index_) {
+        return false;
+    }
+    auto base = base_index();
+    if (std::dynamic_pointer_cast<LsmIndex>(serving_index())) {
+        // An LsmIndex never modifies its main index in place, so searches
+        // and inserts can continue while it is written
+        lock.unlock();
+    }
+
+    SnapshotOptions options;
+    options.num_threads = config_.num_threads;
+    std::vector<uint8_t> transform;
+    if (auto preprocessor = vector_preprocessor()) {
+        preprocessor->serialize(transform);
+    }
+    nlohmann::json report = write_index_snapshot(*base, &metadata, &transform, target, options);
+    if (report.is_null()) {
+        std::cerr << "Failed to write index snapshot to " << target << std::endl;
+        return false;
+    }
+    std::cout << "Index snapshot " << report["version"] << " written to " << target << ": "
+              << report["segments_written"] << " segments (" << report["bytes_written"] << " bytes) written, "
+              << report["segments_reused"] << " reused" << std::endl;
+    return true;
+}
+
+bool VectorSearchEngine::load_index_snapshot(const std::string& directory, bool lazy) {
+    SnapshotOptions options;
+    options.lazy = lazy;
+    options.num_threads = config_.num_threads;
+    options.verify_checksums = config_.index_verify != "none";
+
+    auto start_time = std::chrono::steady_clock::now();
+    IndexSnapshot snapshot;
+    if (!read_index_snapshot(directory, snapshot, options)) {
+        return false;
+    }
+    // The snapshot's transform replaces whatever the service started with
+    std::shared_ptr<const VectorPreprocessor> preprocessor;
+    if (!snapshot.transform.empty()) {
+        std::string error;
+        preprocessor = VectorPreprocessor::deserialize(snapshot.transform.data(), snapshot.transform.size(), error);
+        if (!preprocessor || preprocessor->input_dimension() != config_.dimension) {
+            std::cerr << "Index snapshot: vector transform is unusable"
+                      << (preprocessor ? " for this embedding dimension" : ": " + error) << std::endl;
+            return false;
+        }
+    } else {
+        preprocessor = vector_preprocessor();
+    }
+    int dimension = preprocessor ? preprocessor->output_dimension() : config_.dimension;
+    if (snapshot.index->d != dimension) {
+        std::cerr << "Index snapshot dimension " << snapshot.index->d << " does not match "
+                  << dimension << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        index_ = std::move(snapshot.index);
+        std::atomic_store(&preprocessor_, std::move(preprocessor));
+        std::atomic_store(&partitions_, std::shared_ptr<PartitionedIndex>());
+        reset_index_versions();
+    }
+    if (!snapshot.metadata.empty()) {
+        {
+            std::lock_guard<std::mutex> metadata_lock(metadata_mutex_);
+            metadata_ = std::move(snapshot.metadata);
+        }
+        rebuild_document_ids();
+        rebuild_metadata_columns();
+    }
+    rebuild_partitions();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Loaded index snapshot " << snapshot.manifest.version << " (" << snapshot.manifest.index_type
+              << ", " << snapshot.manifest.ntotal << " vectors, " << snapshot.manifest.segments.size()
+              << " segments" << (lazy ? ", lists mapped" : "") << ") in " << seconds << " s" << std::endl;
+    return true;
+}
+
+} // namespace neurorag
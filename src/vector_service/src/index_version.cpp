@@ -0,0 +1,232 @@
+/**
+ * @file index_version.cpp
+ * @brief Index versioning for dependency-tracked result cache invalidation
+ */
+
+#include "index_version.h"
+#include "lsm_index.h"
+#include "vector_search.h"
+
+#include <algorithm>
+
+#include <faiss/IndexIVF.h>
+#include <faiss/invlists/DirectMap.h>
+
+namespace neurorag {
+
+IndexVersionTracker::IndexVersionTracker()
+    : epoch_(1),
+      global_version_(0),
+      list_capacity_(0),
+      num_lists_(0),
+      validations_(0),
+      stale_detected_(0) {}
+
+void IndexVersionTracker::reset(size_t num_lists) {
+    num_lists_.store(num_lists, std::memory_order_relaxed);
+    list_capacity_ = num_lists;
+    list_versions_.reset(num_lists > 0 ? new std::atomic<uint64_t>[num_lists] : nullptr);
+    for (size_t i = 0; i < num_lists; ++i) {
+        list_versions_[i].store(0, std::memory_order_relaxed);
+    }
+    global_version_.store(0, std::memory_order_relaxed);
+    epoch_.fetch_add(1, std::memory_order_release);
+}
+
+void IndexVersionTracker::advance(size_t num_lists) {
+    // Published by the epoch increment; readers load the epoch first
+    num_lists_.store(num_lists <= list_capacity_ ? num_lists : 0, std::memory_order_relaxed);
+    global_version_.fetch_add(1, std::memory_order_release);
+    epoch_.fetch_add(1, std::memory_order_release);
+}
+
+void IndexVersionTracker::bump_lists(const std::vector<int64_t>& list_ids) {
+    size_t num_lists = num_lists_.load(std::memory_order_acquire);
+    for (int64_t list_id : list_ids) {
+        if (list_id >= 0 && static_cast<size_t>(list_id) < num_lists) {
+            list_versions_[list_id].fetch_add(1, std::memory_order_release);
+        }
+    }
+    global_version_.fetch_add(1, std::memory_order_release);
+}
+
+void IndexVersionTracker::bump_all() {
+    global_version_.fetch_add(1, std::memory_order_release);
+    epoch_.fetch_add(1, std::memory_order_release);
+}
+
+CacheDependency IndexVersionTracker::capture(const std::vector<int64_t>& probed_lists,
+                                             uint64_t delta_version) const {
+    CacheDependency dependency;
+    dependency.epoch = epoch_.load(std::memory_order_acquire);
+    dependency.global_version = global_version_.load(std::memory_order_acquire);
+    dependency.delta_version = delta_version;
+    size_t num_lists = num_lists_.load(std::memory_order_acquire);
+
+    dependency.list_versions.reserve(probed_lists.size());
+    for (int64_t list_id : probed_lists) {
+        if (list_id >= 0 && static_cast<size_t>(list_id) < num_lists) {
+            dependency.list_versions.emplace_back(
+                list_id, list_versions_[list_id].load(std::memory_order_acquire));
+        }
+    }
+    return dependency;
+}
+
+bool IndexVersionTracker::is_current(const CacheDependency& dependency, uint64_t delta_version) const {
+    validations_.fetch_add(1, std::memory_order_relaxed);
+
+    bool current = dependency.epoch == epoch_.load(std::memory_order_acquire) &&
+                   dependency.delta_version == delta_version;
+    size_t num_lists = num_lists_.load(std::memory_order_acquire);
+    if (current && num_lists == 0) {
+        current = dependency.global_version == global_version_.load(std::memory_order_acquire);
+    }
+    if (current && num_lists > 0) {
+        // Lists the search did not probe cannot change its answer
+        current = !dependency.list_versions.empty();
+        for (const auto& entry : dependency.list_versions) {
+            if (entry.first < 0 || static_cast<size_t>(entry.first) >= num_lists ||
+                list_versions_[entry.first].load(std::memory_order_acquire) != entry.second) {
+                current = false;
+                break;
+            }
+        }
+    }
+
+    if (!current) {
+        stale_detected_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return current;
+}
+
+nlohmann::json IndexVersionTracker::get_statistics() const {
+    nlohmann::json stats;
+    stats["epoch"] = epoch();
+    stats["global_version"] = global_version();
+    stats["tracked_lists"] = num_lists();
+    stats["validations"] = validations_.load();
+    stats["stale_detected"] = stale_detected_.load();
+    return stats;
+}
+
+nlohmann::json cache_dependency_to_json(const CacheDependency& dependency) {
+    nlohmann::json lists = nlohmann::json::array();
+    for (const auto& entry : dependency.list_versions) {
+        lists.push_back({entry.first, entry.second});
+    }
+    return {
+        {"epoch", dependency.epoch},
+        {"global_version", dependency.global_version},
+        {"delta_version", dependency.delta_version},
+        {"lists", lists},
+    };
+}
+
+CacheDependency cache_dependency_from_json(const nlohmann::json& value) {
+    CacheDependency dependency;
+    try {
+        dependency.epoch = value.at("epoch").get<uint64_t>();
+        dependency.global_version = value.at("global_version").get<uint64_t>();
+        dependency.delta_version = value.at("delta_version").get<uint64_t>();
+        for (const auto& entry : value.at("lists")) {
+            dependency.list_versions.emplace_back(entry.at(0).get<int64_t>(), entry.at(1).get<uint64_t>());
+        }
+    } catch (const nlohmann::json::exception&) {
+        return CacheDependency{};
+    }
+    return dependency;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+CacheDependency VectorSearchEngine::capture_cache_dependency(const SearchRequest& request) const {
+    std::vector<int64_t> probed;
+
+    auto base = base_index();
+    auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get());
+    if (ivf && static_cast<int>(request.query_vector.size()) == config_.dimension) {
+        // Lists are probed in index space
+        std::vector<float> buffer;
+        const float* query = preprocess_vectors(request.query_vector.data(), 1, buffer);
+        probed.resize(std::max<size_t>(1, ivf->nprobe));
+        std::vector<float> distances(probed.size());
+        ivf->quantizer->search(1, query,
+                               static_cast<faiss::idx_t>(probed.size()),
+                               distances.data(), probed.data());
+    }
+    auto delta = delta_index();
+    return index_versions_.capture(probed, delta ? delta->version() : 0);
+}
+
+bool VectorSearchEngine::is_cache_entry_current(const CacheDependency& dependency) const {
+    auto delta = delta_index();
+    return index_versions_.is_current(dependency, delta ? delta->version() : 0);
+}
+
+void VectorSearchEngine::record_vectors_added(const float* vectors, size_t count) {
+    auto base = base_index();
+    auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get());
+    if (!ivf || delta_index()) {
+        // Non-IVF indexes are validated by the global version; with a delta
+        // index the vectors went to a segment, which advanced its version
+        index_versions_.bump_lists({});
+        return;
+    }
+
+    std::vector<faiss::idx_t> assignments(count);
+    ivf->quantizer->assign(static_cast<faiss::idx_t>(count), vectors, assignments.data());
+    std::sort(assignments.begin(), assignments.end());
+    assignments.erase(std::unique(assignments.begin(), assignments.end()), assignments.end());
+    index_versions_.bump_lists(assignments);
+}
+
+void VectorSearchEngine::record_vectors_removed(const std::vector<int64_t>& ids) {
+    auto base = base_index();
+    auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get());
+    if (delta_index()) {
+        // Tombstoned, not removed from the lists; the delta version covers it
+        index_versions_.bump_lists({});
+        return;
+    }
+    if (!ivf || ivf->direct_map.no()) {
+        // Without a direct map the owning lists are unknown
+        index_versions_.bump_all();
+        return;
+    }
+
+    std::vector<int64_t> lists;
+    lists.reserve(ids.size());
+    for (int64_t id : ids) {
+        try {
+            lists.push_back(faiss::lo_listno(ivf->direct_map.get(id)));
+        } catch (const std::exception&) {
+            // Unknown id, nothing to invalidate for it
+        }
+    }
+    index_versions_.bump_lists(lists);
+}
+
+std::shared_ptr<const faiss::Index> VectorSearchEngine::base_index() const {
+    if (auto* layered = dynamic_cast<const LayeredIndex*>(index_.get())) {
+        // A generation may itself be an LsmIndex; each layer hands out an
+        // owning pointer, so the outer one can be dropped
+        auto base = layered->base_index();
+        while (auto* inner = dynamic_cast<const LayeredIndex*>(base.get())) {
+            base = inner->base_index();
+        }
+        return base;
+    }
+    // Non-owning; index_ outlives the caller's use under index_mutex_
+    return std::shared_ptr<const faiss::Index>(std::shared_ptr<const faiss::Index>(), index_.get());
+}
+
+void VectorSearchEngine::reset_index_versions() {
+    auto base = base_index();
+    auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get());
+    index_versions_.reset(ivf ? ivf->nlist : 0);
+}
+
+} // namespace neurorag
@@ -0,0 +1,708 @@
+/**
+ * @file lsm_index.cpp
+ * @brief Main index plus in-memory delta segments, merged in the background
+ */
+
+#include "lsm_index.h"
+#include "diskann_index.h"
+#include "filtered_hnsw_index.h"
+#include "index_generation.h"
+#include "matryoshka_index.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIDMap.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/clone_index.h>
+#include <faiss/impl/FaissException.h>
+
+namespace neurorag {
+
+namespace {
+
+// HNSW delta: cheap inserts matter more than graph quality at this size
+constexpr int kDeltaHnswM = 32;
+constexpr int kDeltaHnswEfConstruction = 40;
+constexpr int kDeltaHnswEfSearch = 64;
+
+// Excludes tombstoned ids, then applies the caller's selector if any
+class TombstoneSelector : public faiss::IDSelector {
+public:
+    TombstoneSelector(const TombstoneBitmap& tombstones, const faiss::IDSelector* inner)
+        : tombstones_(tombstones), inner_(inner) {}
+
+    bool is_member(faiss::idx_t id) const override {
+        return !tombstones_.test(id) && (!inner_ || inner_->is_member(id));
+    }
+
+private:
+    const TombstoneBitmap& tombstones_;
+    const faiss::IDSelector* inner_;
+};
+
+// Copy of the caller's parameters with the selector replaced; known
+// subclasses keep their tuning (nprobe, efSearch, search list size).
+// Untyped parameters take the main index's type and tuning: faiss IVF and
+// HNSW indexes reject the base type, and a default SearchParametersIVF
+// would drop nprobe to 1
+std::unique_ptr<faiss::SearchParameters> with_selector(const faiss::SearchParameters* params,
+                                                       faiss::IDSelector* sel, const faiss::Index& main) {
+    const faiss::Index* inner = &main;
+    if (auto* id_map = dynamic_cast<const faiss::IndexIDMap*>(inner)) {
+        inner = id_map->index;
+    }
+    std::unique_ptr<faiss::SearchParameters> copy;
+    if (auto* ivf = dynamic_cast<const faiss::SearchParametersIVF*>(params)) {
+        copy = std::make_unique<faiss::SearchParametersIVF>(*ivf);
+    } else if (auto* hnsw = dynamic_cast<const faiss::SearchParametersHNSW*>(params)) {
+        copy = std::make_unique<faiss::SearchParametersHNSW>(*hnsw);
+    } else if (auto* disk = dynamic_cast<const DiskAnnSearchParameters*>(params)) {
+        copy = std::make_unique<DiskAnnSearchParameters>(*disk);
+    } else if (auto* matryoshka = dynamic_cast<const MatryoshkaSearchParameters*>(params)) {
+        copy = std::make_unique<MatryoshkaSearchParameters>(*matryoshka);
+    } else if (auto* ivf_index = dynamic_cast<const faiss::IndexIVF*>(inner)) {
+        auto ivf_params = std::make_unique<faiss::SearchParametersIVF>();
+        ivf_params->nprobe = ivf_index->nprobe;
+        copy = std::move(ivf_params);
+    } else if (auto* hnsw_index = dynamic_cast<const faiss::IndexHNSW*>(inner)) {
+        auto hnsw_params = std::make_unique<faiss::SearchParametersHNSW>();
+        hnsw_params->efSearch = hnsw_index->hnsw.efSearch;
+        copy = std::move(hnsw_params);
+    } else {
+        copy = std::make_unique<faiss::SearchParameters>();
+    }
+    copy->sel = sel;
+    return copy;
+}
+
+// Merge k results from a segment into the running top-k, best first
+void merge_results(faiss::idx_t n, faiss::idx_t k, bool inner_product,
+                   float* distances, faiss::idx_t* labels,
+                   const float* segment_distances, const faiss::idx_t* segment_labels) {
+    auto better = [inner_product](float a, float b) { return inner_product ? a > b : a < b; };
+    std::vector<float> merged_distances(k);
+    std::vector<faiss::idx_t> merged_labels(k);
+    for (faiss::idx_t q = 0; q < n; ++q) {
+        float* d1 = distances + q * k;
+        faiss::idx_t* l1 = labels + q * k;
+        const float* d2 = segment_distances + q * k;
+        const faiss::idx_t* l2 = segment_labels + q * k;
+        faiss::idx_t i = 0;
+        faiss::idx_t j = 0;
+        for (faiss::idx_t out = 0; out < k; ++out) {
+            bool has_first = i < k && l1[i] >= 0;
+            bool has_second = j < k && l2[j] >= 0;
+            if (has_first && (!has_second || !better(d2[j], d1[i]))) {
+                merged_distances[out] = d1[i];
+                merged_labels[out] = l1[i++];
+            } else if (has_second) {
+                merged_distances[out] = d2[j];
+                merged_labels[out] = l2[j++];
+            } else {
+                merged_distances[out] = inner_product ? -std::numeric_limits<float>::max()
+                                                      : std::numeric_limits<float>::max();
+                merged_labels[out] = -1;
+            }
+        }
+        std::copy(merged_distances.begin(), merged_distances.end(), d1);
+        std::copy(merged_labels.begin(), merged_labels.end(), l1);
+    }
+}
+
+// Append vectors to a copy of the main index under their ids
+void extend_main(faiss::Index& index, size_t n, const float* x, const faiss::idx_t* ids) {
+    if (n == 0) {
+        return;
+    }
+    if (dynamic_cast<faiss::IndexIVF*>(&index)) {
+        index.add_with_ids(static_cast<faiss::idx_t>(n), x, ids);
+        return;
+    }
+    // Flat and HNSW label vectors by position, so ids (sorted by the
+    // caller) must continue the sequence
+    for (size_t i = 0; i < n; ++i) {
+        if (ids[i] != index.ntotal + static_cast<faiss::idx_t>(i)) {
+            throw faiss::FaissException("delta ids do not continue the main index's sequential ids");
+        }
+    }
+    index.add(static_cast<faiss::idx_t>(n), x);
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// TombstoneBitmap
+// ---------------------------------------------------------------------------
+
+TombstoneBitmap::TombstoneBitmap()
+    : pages_(new std::atomic<std::atomic<uint64_t>*>[kMaxPages]),
+      allocated_pages_(0),
+      count_(0),
+      has_overflow_(false) {
+    for (size_t page = 0; page < kMaxPages; ++page) {
+        pages_[page].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TombstoneBitmap::~TombstoneBitmap() {
+    for (size_t page = 0; page < kMaxPages; ++page) {
+        delete[] pages_[page].load();
+    }
+}
+
+bool TombstoneBitmap::set(faiss::idx_t id) {
+    if (id < 0 || static_cast<uint64_t>(id) >= kPageBits * kMaxPages) {
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        bool inserted = overflow_.insert(id).second;
+        has_overflow_.store(true);
+        if (inserted) {
+            count_.fetch_add(1);
+        }
+        return inserted;
+    }
+
+    size_t bit = static_cast<size_t>(id);
+    auto& slot = pages_[bit / kPageBits];
+    std::atomic<uint64_t>* page = slot.load(std::memory_order_acquire);
+    if (!page) {
+        auto* fresh = new std::atomic<uint64_t>[kPageWords]();
+        if (slot.compare_exchange_strong(page, fresh, std::memory_order_acq_rel)) {
+            page = fresh;
+            allocated_pages_.fetch_add(1);
+        } else {
+            delete[] fresh;  // another thread allocated it; page now holds theirs
+        }
+    }
+    size_t offset = bit % kPageBits;
+    uint64_t mask = uint64_t{1} << (offset % 64);
+    bool inserted = (page[offset / 64].fetch_or(mask, std::memory_order_acq_rel) & mask) == 0;
+    if (inserted) {
+        count_.fetch_add(1);
+    }
+    return inserted;
+}
+
+bool TombstoneBitmap::test(faiss::idx_t id) const {
+    if (id < 0 || static_cast<uint64_t>(id) >= kPageBits * kMaxPages) {
+        if (!has_overflow_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        return overflow_.count(id) > 0;
+    }
+    size_t bit = static_cast<size_t>(id);
+    const std::atomic<uint64_t>* page = pages_[bit / kPageBits].load(std::memory_order_acquire);
+    if (!page) {
+        return false;
+    }
+    size_t offset = bit % kPageBits;
+    return (page[offset / 64].load(std::memory_order_acquire) >> (offset % 64)) & 1;
+}
+
+size_t TombstoneBitmap::memory_bytes() const {
+    std::lock_guard<std::mutex> lock(overflow_mutex_);
+    return allocated_pages_.load() * kPageWords * sizeof(uint64_t) +
+           kMaxPages * sizeof(void*) + overflow_.size() * sizeof(faiss::idx_t);
+}
+
+// ---------------------------------------------------------------------------
+// LsmIndex
+// ---------------------------------------------------------------------------
+
+// A segment is written only while it is active; freezing it under the
+// exclusive lock makes writers retry on the new active segment
+struct LsmIndex::DeltaSegment {
+    std::unique_ptr<faiss::Index> index;   // IndexIDMap over flat or HNSW storage
+    std::vector<float> vectors;            // raw copies, for merging and reconstruct
+    std::vector<faiss::idx_t> ids;
+    std::unordered_map<faiss::idx_t, size_t> position;
+    std::atomic<size_t> size{0};
+    bool frozen = false;
+    mutable std::shared_mutex mutex;
+};
+
+LsmIndex::LsmIndex(std::shared_ptr<faiss::Index> main, const std::string& delta_type, faiss::idx_t next_id)
+    : faiss::Index(main->d, main->metric_type),
+      delta_type_(delta_type == "hnsw" ? "hnsw" : "flat"),
+      main_(std::move(main)),
+      next_id_(next_id),
+      version_(0),
+      merging_(false),
+      merge_threshold_(0),
+      merges_(0),
+      merge_failures_(0),
+      merged_vectors_(0),
+      purged_vectors_(0),
+      last_merge_seconds_(0.0) {
+    ntotal = main_->ntotal;
+    is_trained = true;
+    active_ = make_segment();
+}
+
+LsmIndex::~LsmIndex() {
+    stop();
+}
+
+bool LsmIndex::can_wrap(const faiss::Index& main, std::string& reason) {
+    if (dynamic_cast<const DiskAnnIndex*>(&main)) {
+        reason = "DiskANN indexes stage their own inserts";
+        return false;
+    }
+    if (auto* ivf = dynamic_cast<const faiss::IndexIVF*>(&main)) {
+        if (!dynamic_cast<const faiss::ArrayInvertedLists*>(ivf->invlists)) {
+            // Merges copy the main index, which faiss can only do for
+            // in-memory lists (not tiered, on-disk or mapped ones)
+            reason = "IVF lists are not in memory";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<LsmIndex::DeltaSegment> LsmIndex::make_segment() const {
+    auto segment = std::make_shared<DeltaSegment>();
+    faiss::Index* storage;
+    if (delta_type_ == "hnsw") {
+        auto* hnsw = new faiss::IndexHNSWFlat(d, kDeltaHnswM, metric_type);
+        hnsw->hnsw.efConstruction = kDeltaHnswEfConstruction;
+        hnsw->hnsw.efSearch = kDeltaHnswEfSearch;
+        storage = hnsw;
+    } else {
+        storage = new faiss::IndexFlat(d, metric_type);
+    }
+    auto* id_map = new faiss::IndexIDMap(storage);
+    id_map->own_fields = true;
+    segment->index.reset(id_map);
+    return segment;
+}
+
+void LsmIndex::start_merging(size_t merge_threshold, std::chrono::milliseconds interval) {
+    stop();
+    merge_threshold_ = merge_threshold;
+    {
+        std::lock_guard<std::mutex> lock(merge_wait_mutex_);
+        merging_ = true;
+    }
+    merge_thread_ = std::thread(&LsmIndex::merge_loop, this, interval);
+}
+
+void LsmIndex::stop() {
+    {
+        std::lock_guard<std::mutex> lock(merge_wait_mutex_);
+        merging_ = false;
+    }
+    merge_condition_.notify_all();
+    if (merge_thread_.joinable()) {
+        merge_thread_.join();
+    }
+}
+
+void LsmIndex::merge_loop(std::chrono::milliseconds interval) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(merge_wait_mutex_);
+            merge_condition_.wait_for(lock, interval, [this]() {
+                std::lock_guard<std::mutex> state_lock(state_mutex_);
+                return !merging_ || active_->size.load() >= merge_threshold_;
+            });
+            if (!merging_) {
+                return;
+            }
+        }
+        merge();
+    }
+}
+
+std::shared_ptr<const faiss::Index> LsmIndex::base_index() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return main_;
+}
+
+std::shared_ptr<const faiss::Index> LsmIndex::visit_delta(
+    const std::function<void(const faiss::idx_t*, const float*, size_t)>& visit) const {
+    std::shared_ptr<faiss::Index> main;
+    std::vector<std::shared_ptr<DeltaSegment>> segments;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        main = main_;
+        segments = frozen_;
+        segments.push_back(active_);
+    }
+    for (const auto& segment : segments) {
+        std::shared_lock<std::shared_mutex> segment_lock(segment->mutex);
+        if (!segment->ids.empty()) {
+            visit(segment->ids.data(), segment->vectors.data(), segment->ids.size());
+        }
+    }
+    return main;
+}
+
+bool LsmIndex::merge() {
+    std::lock_guard<std::mutex> merge_lock(merge_mutex_);
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Freeze the active segment; new writes go to a fresh one
+    std::shared_ptr<faiss::Index> main;
+    std::vector<std::shared_ptr<DeltaSegment>> segments;
+    std::vector<faiss::idx_t> deletes;
+    std::shared_ptr<DeltaSegment> retired;
+    {
+        auto fresh = make_segment();
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (active_->size.load() > 0) {
+            retired = active_;
+            frozen_.push_back(active_);
+            active_ = fresh;
+        }
+        if (frozen_.empty() && pending_deletes_.empty()) {
+            return true;
+        }
+        main = main_;
+        segments = frozen_;
+        deletes.swap(pending_deletes_);
+    }
+    if (retired) {
+        // Writers that took the old segment before the swap finish first;
+        // later ones see the flag and move to the new segment
+        std::unique_lock<std::shared_mutex> segment_lock(retired->mutex);
+        retired->frozen = true;
+    }
+
+    std::shared_ptr<faiss::Index> merged;
+    size_t added = 0;
+    size_t purged = 0;
+    try {
+        if (auto* matryoshka = dynamic_cast<const MatryoshkaIndex*>(main.get())) {
+            merged.reset(matryoshka->clone());
+        } else if (auto* filtered = dynamic_cast<const FilteredHnswIndex*>(main.get())) {
+            merged.reset(filtered->clone());
+        } else {
+            merged.reset(faiss::clone_index(main.get()));
+        }
+        bool is_ivf = dynamic_cast<faiss::IndexIVF*>(merged.get()) != nullptr;
+
+        // IVF mains skip deleted vectors; positional mains keep them, tombstoned
+        std::vector<std::pair<faiss::idx_t, const float*>> entries;
+        std::vector<std::shared_lock<std::shared_mutex>> segment_locks;
+        for (const auto& segment : segments) {
+            segment_locks.emplace_back(segment->mutex);
+            for (size_t i = 0; i < segment->ids.size(); ++i) {
+                if (!is_ivf || !tombstones_.test(segment->ids[i])) {
+                    entries.emplace_back(segment->ids[i], &segment->vectors[i * d]);
+                }
+            }
+        }
+        if (!is_ivf) {
+            // Concurrent adds may have landed out of id order
+            std::sort(entries.begin(), entries.end(),
+                      [](const auto& a, const auto& b) { return a.first < b.first; });
+        }
+        std::vector<float> vectors(entries.size() * d);
+        std::vector<faiss::idx_t> ids(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) {
+            ids[i] = entries[i].first;
+            std::memcpy(&vectors[i * d], entries[i].second, d * sizeof(float));
+        }
+        segment_locks.clear();
+        extend_main(*merged, ids.size(), vectors.data(), ids.data());
+        added = ids.size();
+
+        if (!deletes.empty() && is_ivf) {
+            faiss::IDSelectorBatch selector(deletes.size(), deletes.data());
+            purged = merged->remove_ids(selector);
+        }
+    } catch (const faiss::FaissException& e) {
+        // Segments stay frozen and searched; the next merge retries them
+        std::cerr << "LsmIndex: merge failed: " << e.what() << std::endl;
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        pending_deletes_.insert(pending_deletes_.end(), deletes.begin(), deletes.end());
+        merge_failures_.fetch_add(1);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        main_ = std::move(merged);
+        frozen_.erase(std::remove_if(frozen_.begin(), frozen_.end(), [&segments](const auto& segment) {
+            return std::find(segments.begin(), segments.end(), segment) != segments.end();
+        }), frozen_.end());
+    }
+    // Merged vectors are now found through the main index's own search
+    version_.fetch_add(1, std::memory_order_release);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    merges_.fetch_add(1);
+    merged_vectors_.fetch_add(added);
+    purged_vectors_.fetch_add(purged);
+    last_merge_seconds_.store(elapsed);
+    std::cout << "LsmIndex: merged " << added << " vectors and purged " << purged
+              << " deletes in " << elapsed << " s" << std::endl;
+    return true;
+}
+
+void LsmIndex::add(faiss::idx_t n, const float* x) {
+    faiss::idx_t first = next_id_.fetch_add(n);
+    std::vector<faiss::idx_t> xids(n);
+    for (faiss::idx_t i = 0; i < n; ++i) {
+        xids[i] = first + i;
+    }
+    add_with_ids(n, x, xids.data());
+}
+
+void LsmIndex::add_with_ids(faiss::idx_t n, const float* x, const faiss::idx_t* xids) {
+    if (n <= 0) {
+        return;
+    }
+    while (true) {
+        std::shared_ptr<DeltaSegment> segment;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            segment = active_;
+        }
+        std::unique_lock<std::shared_mutex> segment_lock(segment->mutex);
+        if (segment->frozen) {
+            continue;  // a merge froze it after the snapshot
+        }
+        segment->index->add_with_ids(n, x, xids);
+        size_t base = segment->ids.size();
+        segment->vectors.insert(segment->vectors.end(), x, x + n * d);
+        segment->ids.insert(segment->ids.end(), xids, xids + n);
+        for (faiss::idx_t i = 0; i < n; ++i) {
+            segment->position[xids[i]] = base + i;
+        }
+        segment->size.store(segment->ids.size());
+        break;
+    }
+    version_.fetch_add(1, std::memory_order_release);
+
+    faiss::idx_t last = *std::max_element(xids, xids + n);
+    faiss::idx_t expected = next_id_.load();
+    while (last >= expected && !next_id_.compare_exchange_weak(expected, last + 1)) {
+    }
+
+    size_t active_size;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        ntotal += n;
+        active_size = active_->size.load();
+    }
+    if (merge_threshold_ > 0 && active_size >= merge_threshold_) {
+        merge_condition_.notify_one();
+    }
+}
+
+void LsmIndex::search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                      const faiss::SearchParameters* params) const {
+    std::shared_ptr<faiss::Index> main;
+    std::vector<std::shared_ptr<DeltaSegment>> segments;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        main = main_;
+        segments = frozen_;
+        segments.push_back(active_);
+    }
+
+    TombstoneSelector selector(tombstones_, params ? params->sel : nullptr);
+    auto main_params = with_selector(params, &selector, *main);
+    main->search(n, x, k, distances, labels, main_params.get());
+
+    bool inner_product = metric_type == faiss::METRIC_INNER_PRODUCT;
+    faiss::SearchParameters segment_params;
+    segment_params.sel = &selector;
+    std::vector<float> segment_distances;
+    std::vector<faiss::idx_t> segment_labels;
+    for (const auto& segment : segments) {
+        if (segment->size.load() == 0) {
+            continue;
+        }
+        segment_distances.resize(n * k);
+        segment_labels.resize(n * k);
+        {
+            std::shared_lock<std::shared_mutex> segment_lock(segment->mutex);
+            segment->index->search(n, x, k, segment_distances.data(), segment_labels.data(), &segment_params);
+        }
+        merge_results(n, k, inner_product, distances, labels, segment_distances.data(), segment_labels.data());
+    }
+}
+
+void LsmIndex::reset() {
+    throw faiss::FaissException("LsmIndex: reset is not supported; load a new index instead");
+}
+
+size_t LsmIndex::remove_ids(const faiss::IDSelector& sel) {
+    // The bitmap needs the ids themselves, so only enumerable selectors work
+    std::vector<faiss::idx_t> ids;
+    if (auto* batch = dynamic_cast<const faiss::IDSelectorBatch*>(&sel)) {
+        ids.assign(batch->set.begin(), batch->set.end());
+    } else if (auto* array = dynamic_cast<const faiss::IDSelectorArray*>(&sel)) {
+        ids.assign(array->ids, array->ids + array->n);
+    } else if (auto* range = dynamic_cast<const faiss::IDSelectorRange*>(&sel)) {
+        for (faiss::idx_t id = range->imin; id < range->imax; ++id) {
+            ids.push_back(id);
+        }
+    } else {
+        throw faiss::FaissException("LsmIndex: remove_ids needs a batch, array or range selector");
+    }
+
+    std::vector<faiss::idx_t> removed;
+    for (faiss::idx_t id : ids) {
+        if (tombstones_.set(id)) {
+            removed.push_back(id);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        pending_deletes_.insert(pending_deletes_.end(), removed.begin(), removed.end());
+        ntotal -= static_cast<faiss::idx_t>(removed.size());
+    }
+    if (!removed.empty()) {
+        version_.fetch_add(1, std::memory_order_release);
+    }
+    return removed.size();
+}
+
+void LsmIndex::reconstruct(faiss::idx_t key, float* recons) const {
+    if (tombstones_.test(key)) {
+        throw faiss::FaissException("LsmIndex: id " + std::to_string(key) + " was removed");
+    }
+    std::shared_ptr<faiss::Index> main;
+    std::vector<std::shared_ptr<DeltaSegment>> segments;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        main = main_;
+        segments = frozen_;
+        segments.push_back(active_);
+    }
+    for (const auto& segment : segments) {
+        std::shared_lock<std::shared_mutex> segment_lock(segment->mutex);
+        auto it = segment->position.find(key);
+        if (it != segment->position.end()) {
+            std::memcpy(recons, &segment->vectors[it->second * d], d * sizeof(float));
+            return;
+        }
+    }
+    main->reconstruct(key, recons);
+}
+
+size_t LsmIndex::memory_bytes() const {
+    std::vector<std::shared_ptr<DeltaSegment>> segments;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        segments = frozen_;
+        segments.push_back(active_);
+    }
+    // Each vector is held twice (raw copy and segment index), plus its id,
+    // position entry and, for HNSW, level-0 links
+    size_t per_vector = 2 * d * sizeof(float) + 2 * sizeof(faiss::idx_t) + 32;
+    if (delta_type_ == "hnsw") {
+        per_vector += 2 * kDeltaHnswM * sizeof(faiss::HNSW::storage_idx_t);
+    }
+    size_t bytes = tombstones_.memory_bytes();
+    for (const auto& segment : segments) {
+        bytes += segment->size.load() * per_vector;
+    }
+    return bytes;
+}
+
+nlohmann::json LsmIndex::get_statistics() const {
+    nlohmann::json stats;
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    size_t frozen_vectors = 0;
+    for (const auto& segment : frozen_) {
+        frozen_vectors += segment->size.load();
+    }
+    stats["delta_type"] = delta_type_;
+    stats["main_vectors"] = main_->ntotal;
+    stats["delta_vectors"] = active_->size.load();
+    stats["frozen_segments"] = frozen_.size();
+    stats["frozen_vectors"] = frozen_vectors;
+    stats["live_vectors"] = ntotal;
+    stats["tombstones"] = tombstones_.count();
+    stats["tombstone_memory_bytes"] = tombstones_.memory_bytes();
+    stats["pending_deletes"] = pending_deletes_.size();
+    stats["merge_threshold"] = merge_threshold_;
+    stats["merges"] = merges_.load();
+    stats["merge_failures"] = merge_failures_.load();
+    stats["merged_vectors"] = merged_vectors_.load();
+    stats["purged_vectors"] = purged_vectors_.load();
+    stats["last_merge_seconds"] = last_merge_seconds_.load();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::enable_delta_index(const std::string& delta_type, size_t merge_threshold,
+                                            std::chrono::seconds merge_interval) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (!index_) {
+        return false;
+    }
+    if (dynamic_cast<LsmIndex*>(index_.get())) {
+        return true;
+    }
+    std::string reason;
+    if (!LsmIndex::can_wrap(*index_, reason)) {
+        std::cerr << reason << "; delta index not enabled" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<faiss::Index> main(index_.release());
+    auto lsm = std::make_unique<LsmIndex>(main, delta_type, main->ntotal);
+    lsm->start_merging(merge_threshold, merge_interval);
+    index_ = std::move(lsm);
+    std::cout << "Delta index enabled (" << delta_type << ", merge at " << merge_threshold
+              << " vectors or every " << merge_interval.count() << " s)" << std::endl;
+    return true;
+}
+
+bool VectorSearchEngine::merge_delta_index() {
+    std::unique_lock<std::mutex> lock(index_mutex_);
+    auto lsm = std::dynamic_pointer_cast<LsmIndex>(serving_index());
+    if (!lsm) {
+        return false;
+    }
+    if (dynamic_cast<GenerationIndex*>(index_.get())) {
+        // The generation handle owns the LsmIndex across a reload, so the
+        // merge can run without blocking searches
+        lock.unlock();
+    }
+    // Otherwise index_ is the only owner and a load would free the LsmIndex
+    // mid-merge; the merge holds index_mutex_ like any index replacement
+    return lsm->merge();
+}
+
+std::shared_ptr<const LsmIndex> VectorSearchEngine::delta_index() const {
+    std::shared_ptr<const faiss::Index> layer = serving_index();
+    while (layer) {
+        if (auto lsm = std::dynamic_pointer_cast<const LsmIndex>(layer)) {
+            return lsm;
+        }
+        auto* layered = dynamic_cast<const LayeredIndex*>(layer.get());
+        if (!layered) {
+            break;
+        }
+        layer = layered->base_index();
+    }
+    return nullptr;
+}
+
+nlohmann::json VectorSearchEngine::get_delta_statistics() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto lsm = std::dynamic_pointer_cast<LsmIndex>(serving_index());
+    if (!lsm) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = lsm->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
@@ -13,12 +13,25 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <random>
+#include <fstream>
 
 #include <nlohmann/json.hpp>
 #include "vector_search.h"
 #include "cache_manager.h"
 #include "http_server.h"
 #include "metrics_collector.h"
+#include "micro_batcher.h"
+#include "stream_rpc.h"
+#include "shm_transport.h"
+#include "query_log.h"
+#include "readiness.h"
+#include "admin_server.h"
+#include "index_file.h"
+#include "index_reloader.h"
+#include "memory_accountant.h"
+#include "query_embedder.h"
 #include "utils.h"
 
 using json = nlohmann::json;
@@ -28,22 +41,25 @@ using namespace neurorag;
 std::atomic<bool> shutdown_requested{false};
 std::unique_ptr<VectorSearchEngine> search_engine;
 std::unique_ptr<HttpServer> http_server;
+std::unique_ptr<MicroBatcher> micro_batcher;
+std::unique_ptr<QueryEmbedder> query_embedder;
+std::unique_ptr<StreamRpcServer> stream_rpc_server;
+std::unique_ptr<ShmTransportServer> shm_transport_server;
+std::unique_ptr<QueryRecorder> query_recorder;
+std::unique_ptr<ReadinessGate> readiness_gate;
+std::unique_ptr<AdminServer> admin_server;
+std::unique_ptr<IndexReloader> index_reloader;
+std::unique_ptr<MemoryAccountant> memory_accountant;
 std::unique_ptr<MetricsCollector> metrics_collector;
 
 /**
  * @brief Signal handler for graceful shutdown
  */
 void signal_handler(int signal) {
-    std::cout << "\nReceived signal " << signal << ", initiating graceful shutdown..." << std::endl;
+    // Only async-signal-safe work here: the stops join threads and take
+    // locks, so main runs them once it sees the flag
+    (void)signal;
     shutdown_requested.store(true);
-    
-    if (http_server) {
-        http_server->stop();
-    }
-    
-    if (search_engine) {
-        search_engine->shutdown();
-    }
 }
 
 /**
@@ -54,7 +70,9 @@ VectorSearchConfig load_configuration() {
     
     // Default values
     config.index_path = "/data/faiss_index.bin";
+    config.index_verify = "lazy";  // none, lazy or full
     config.metadata_path = "/data/documents.json";
+    config.metadata_filter_fields = "";  // empty makes every scalar field filterable
     config.dimension = 1536;
     config.num_threads = std::thread::hardware_concurrency();
     config.use_gpu = false;
@@ -62,22 +80,69 @@ VectorSearchConfig load_configuration() {
     config.enable_cache = true;
     config.cache_redis_url = "redis://localhost:6379";
     config.cache_ttl_seconds = 3600;
+    config.cache_redis_pool_size = 4;
+    config.cache_lookup_timeout_ms = 5;
+    config.cache_fp16_scores = true;
+    config.tiered_lists_path = "";  // empty keeps every IVF list in memory
+    config.hot_lists_memory_mb = 4096;
+    config.cold_cache_memory_mb = 1024;
+    config.tier_rebalance_seconds = 30;
+    config.disk_index_path = "";  // empty serves the in-memory index
+    config.disk_index_cache_nodes = 100000;
+    config.disk_index_search_list = 100;
+    config.disk_index_beam_width = 4;
+    config.delta_index_type = "";  // empty inserts into the main index directly
+    config.delta_merge_threshold = 50000;
+    config.delta_merge_interval_seconds = 300;
+    config.index_snapshot_dir = "";  // empty loads index_path only
+    config.index_snapshot_lazy = false;
+    config.index_hot_swap = true;
+    config.index_reload_mmap = false;
+    config.index_reload_watch_seconds = 0;  // 0 reloads only on POST /admin/index/reload
+    config.memory_insert_wait_ms = 2000;
+    config.vector_transform_path = "";  // empty: <index_path>.transform when present
+    config.normalize_vectors = false;
+    config.matryoshka_prefix_dimension = 0;  // 0 disables the coarse-to-fine search
+    config.matryoshka_candidate_multiplier = 4;
+    config.filtered_hnsw_search = true;
+    config.filtered_hnsw_exact_selectivity = 0.01;  // fewer passing documents: exact scan
+    config.filtered_hnsw_native_selectivity = 0.5;  // more: faiss's own filtered search
+    config.partition_field = "";  // empty disables per-value partition indexes
+    config.partition_hnsw_threshold = 50000;  // larger partitions are HNSW, smaller ones flat
+    config.freshness_field = "";  // empty disables time-decayed search
+    config.freshness_decay_lambda = 0.0;  // per day; 0 decays only requests that set decay_lambda
+    config.freshness_candidate_multiplier = 10;  // over-fetch for indexes that cannot be scanned
     config.enable_numa = true;
     config.numa_node = -1; // Auto-detect
     config.enable_prefetch = true;
     config.prefetch_size = 1000;
     config.similarity_threshold = 0.7;
     config.max_results = 100;
+    config.max_batch_size = 64;
+    config.batch_timeout_us = 500;
     
     // Override with environment variables
     if (const char* env_index_path = std::getenv("FAISS_INDEX_PATH")) {
         config.index_path = env_index_path;
     }
     
+    if (const char* env_index_verify = std::getenv("INDEX_VERIFY")) {
+        IndexVerification verification;
+        if (parse_index_verification(env_index_verify, verification)) {
+            config.index_verify = env_index_verify;
+        } else {
+            std::cerr << "Ignoring INDEX_VERIFY=" << env_index_verify << " (expected none, lazy or full)" << std::endl;
+        }
+    }
+    
     if (const char* env_metadata_path = std::getenv("METADATA_PATH")) {
         config.metadata_path = env_metadata_path;
     }
     
+    if (const char* env_filter_fields = std::getenv("METADATA_FILTER_FIELDS")) {
+        config.metadata_filter_fields = env_filter_fields;
+    }
+    
     if (const char* env_dimension = std::getenv("VECTOR_DIMENSION")) {
         config.dimension = std::stoi(env_dimension);
     }
@@ -90,6 +155,138 @@ VectorSearchConfig load_configuration() {
         config.cache_redis_url = env_redis_url;
     }
     
+    if (const char* env_cache_ttl = std::getenv("CACHE_TTL_SECONDS")) {
+        config.cache_ttl_seconds = std::stoi(env_cache_ttl);
+    }
+    
+    if (const char* env_pool_size = std::getenv("REDIS_POOL_SIZE")) {
+        config.cache_redis_pool_size = std::stoi(env_pool_size);
+    }
+    
+    if (const char* env_lookup_timeout = std::getenv("CACHE_LOOKUP_TIMEOUT_MS")) {
+        config.cache_lookup_timeout_ms = std::stoi(env_lookup_timeout);
+    }
+    
+    if (const char* env_fp16_scores = std::getenv("CACHE_FP16_SCORES")) {
+        config.cache_fp16_scores = (std::string(env_fp16_scores) == "true");
+    }
+    
+    if (const char* env_tiered_path = std::getenv("TIERED_LISTS_PATH")) {
+        config.tiered_lists_path = env_tiered_path;
+    }
+    
+    if (const char* env_hot_memory = std::getenv("HOT_LISTS_MEMORY_MB")) {
+        config.hot_lists_memory_mb = std::stoi(env_hot_memory);
+    }
+    
+    if (const char* env_cold_cache = std::getenv("COLD_CACHE_MEMORY_MB")) {
+        config.cold_cache_memory_mb = std::stoi(env_cold_cache);
+    }
+    
+    if (const char* env_rebalance = std::getenv("TIER_REBALANCE_SECONDS")) {
+        config.tier_rebalance_seconds = std::stoi(env_rebalance);
+    }
+    
+    if (const char* env_disk_index = std::getenv("DISKANN_INDEX_PATH")) {
+        config.disk_index_path = env_disk_index;
+    }
+    
+    if (const char* env_cached_nodes = std::getenv("DISKANN_CACHED_NODES")) {
+        config.disk_index_cache_nodes = std::stoi(env_cached_nodes);
+    }
+    
+    if (const char* env_search_list = std::getenv("DISKANN_SEARCH_LIST")) {
+        config.disk_index_search_list = std::stoi(env_search_list);
+    }
+    
+    if (const char* env_beam_width = std::getenv("DISKANN_BEAM_WIDTH")) {
+        config.disk_index_beam_width = std::stoi(env_beam_width);
+    }
+    
+    if (const char* env_delta_type = std::getenv("DELTA_INDEX_TYPE")) {
+        config.delta_index_type = env_delta_type;
+    }
+    
+    if (const char* env_merge_threshold = std::getenv("DELTA_MERGE_THRESHOLD")) {
+        config.delta_merge_threshold = std::stoi(env_merge_threshold);
+    }
+    
+    if (const char* env_merge_interval = std::getenv("DELTA_MERGE_INTERVAL_SECONDS")) {
+        config.delta_merge_interval_seconds = std::stoi(env_merge_interval);
+    }
+    
+    if (const char* env_snapshot_dir = std::getenv("INDEX_SNAPSHOT_DIR")) {
+        config.index_snapshot_dir = env_snapshot_dir;
+    }
+    
+    if (const char* env_snapshot_lazy = std::getenv("INDEX_SNAPSHOT_LAZY")) {
+        config.index_snapshot_lazy = (std::string(env_snapshot_lazy) == "true");
+    }
+    
+    if (const char* env_hot_swap = std::getenv("INDEX_HOT_SWAP")) {
+        config.index_hot_swap = (std::string(env_hot_swap) == "true");
+    }
+    
+    if (const char* env_reload_mmap = std::getenv("INDEX_RELOAD_MMAP")) {
+        config.index_reload_mmap = (std::string(env_reload_mmap) == "true");
+    }
+    
+    if (const char* env_reload_watch = std::getenv("INDEX_RELOAD_WATCH_SECONDS")) {
+        config.index_reload_watch_seconds = std::stoi(env_reload_watch);
+    }
+    
+    if (const char* env_insert_wait = std::getenv("MEMORY_INSERT_WAIT_MS")) {
+        config.memory_insert_wait_ms = std::stoi(env_insert_wait);
+    }
+    
+    if (const char* env_transform_path = std::getenv("VECTOR_TRANSFORM_PATH")) {
+        config.vector_transform_path = env_transform_path;
+    }
+    
+    if (const char* env_normalize = std::getenv("NORMALIZE_VECTORS")) {
+        config.normalize_vectors = (std::string(env_normalize) == "true");
+    }
+    
+    if (const char* env_prefix_dim = std::getenv("MATRYOSHKA_PREFIX_DIM")) {
+        config.matryoshka_prefix_dimension = std::stoi(env_prefix_dim);
+    }
+    
+    if (const char* env_multiplier = std::getenv("MATRYOSHKA_CANDIDATE_MULTIPLIER")) {
+        config.matryoshka_candidate_multiplier = std::stoi(env_multiplier);
+    }
+    
+    if (const char* env_filtered_hnsw = std::getenv("FILTERED_HNSW_SEARCH")) {
+        config.filtered_hnsw_search = (std::string(env_filtered_hnsw) == "true");
+    }
+    
+    if (const char* env_exact = std::getenv("FILTERED_HNSW_EXACT_SELECTIVITY")) {
+        config.filtered_hnsw_exact_selectivity = std::stod(env_exact);
+    }
+    
+    if (const char* env_native = std::getenv("FILTERED_HNSW_NATIVE_SELECTIVITY")) {
+        config.filtered_hnsw_native_selectivity = std::stod(env_native);
+    }
+    
+    if (const char* env_partition_field = std::getenv("PARTITION_FIELD")) {
+        config.partition_field = env_partition_field;
+    }
+    
+    if (const char* env_partition_threshold = std::getenv("PARTITION_HNSW_THRESHOLD")) {
+        config.partition_hnsw_threshold = std::stoi(env_partition_threshold);
+    }
+    
+    if (const char* env_freshness_field = std::getenv("FRESHNESS_FIELD")) {
+        config.freshness_field = env_freshness_field;
+    }
+    
+    if (const char* env_freshness_lambda = std::getenv("FRESHNESS_DECAY_LAMBDA")) {
+        config.freshness_decay_lambda = std::stod(env_freshness_lambda);
+    }
+    
+    if (const char* env_freshness_multiplier = std::getenv("FRESHNESS_CANDIDATE_MULTIPLIER")) {
+        config.freshness_candidate_multiplier = std::stoi(env_freshness_multiplier);
+    }
+    
     if (const char* env_use_gpu = std::getenv("USE_GPU")) {
         config.use_gpu = (std::string(env_use_gpu) == "true");
     }
@@ -98,6 +295,14 @@ VectorSearchConfig load_configuration() {
         config.gpu_device = std::stoi(env_gpu_device);
     }
     
+    if (const char* env_batch_size = std::getenv("MAX_BATCH_SIZE")) {
+        config.max_batch_size = std::stoi(env_batch_size);
+    }
+    
+    if (const char* env_batch_timeout = std::getenv("BATCH_TIMEOUT_US")) {
+        config.batch_timeout_us = std::stoi(env_batch_timeout);
+    }
+    
     return config;
 }
 
@@ -148,11 +353,18 @@ void print_system_info() {
  */
 void health_check_thread() {
     while (!shutdown_requested.load()) {
-        if (search_engine && !search_engine->is_healthy()) {
-            std::cerr << "WARNING: Search engine health check failed!" << std::endl;
+        if (search_engine) {
+            bool healthy = search_engine->is_healthy();
+            if (!healthy) {
+                std::cerr << "WARNING: Search engine health check failed!" << std::endl;
+            }
+            if (readiness_gate) {
+                readiness_gate->set_engine_healthy(healthy);
+            }
         }
         
-        std::this_thread::sleep_for(std::chrono::seconds(30));
+        // Matches the readiness probe period so an unhealthy engine un-readies promptly
+        std::this_thread::sleep_for(std::chrono::seconds(5));
     }
 }
 
@@ -191,6 +403,8 @@ int main(int argc, char* argv[]) {
         // Set up signal handlers
         std::signal(SIGINT, signal_handler);
         std::signal(SIGTERM, signal_handler);
+        // A client that disconnects mid-response must not kill the service
+        std::signal(SIGPIPE, SIG_IGN);
         
         // Load configuration
         auto config = load_configuration();
@@ -207,6 +421,24 @@ int main(int argc, char* argv[]) {
         // Initialize metrics collector
         metrics_collector = std::make_unique<MetricsCollector>();
         
+        // A truncated or corrupt index file is reported before anything is
+        // loaded; the header and file size are checked in O(1), every block
+        // only with INDEX_VERIFY=full
+        if (std::ifstream(config.index_path)) {
+            IndexFileCheck check = config.index_verify == "full"
+                ? verify_index_file(config.index_path, config.num_threads)
+                : inspect_index_file(config.index_path);
+            std::cout << "  Index file: " << index_file_status_name(check.status);
+            if (check.seconds > 0.0) {
+                std::cout << " (" << check.header.num_blocks << " blocks verified in " << check.seconds << " s)";
+            }
+            std::cout << std::endl;
+            if (!check.ok()) {
+                std::cerr << "Index file " << config.index_path << " is unusable: " << check.message << std::endl;
+                return 1;
+            }
+        }
+        
         // Initialize vector search engine
         std::cout << "\nInitializing vector search engine..." << std::endl;
         search_engine = std::make_unique<VectorSearchEngine>(config);
@@ -218,6 +450,47 @@ int main(int argc, char* argv[]) {
         
         std::cout << "Vector search engine initialized successfully" << std::endl;
         
+        // Vectors and queries go through the transform the index was built
+        // with (a snapshot carries its own and replaces this one)
+        std::string transform_path = config.vector_transform_path.empty()
+            ? config.index_path + ".transform" : config.vector_transform_path;
+        if (std::ifstream(transform_path)) {
+            std::shared_ptr<const VectorPreprocessor> transform = VectorPreprocessor::load(transform_path);
+            if (!transform || !search_engine->set_vector_preprocessor(transform)) {
+                std::cerr << "Vector transform " << transform_path << " is unusable" << std::endl;
+                return 1;
+            }
+            std::cout << "  Vector transform: " << transform->describe().dump() << std::endl;
+        } else if (!config.vector_transform_path.empty()) {
+            std::cerr << "Vector transform " << transform_path << " not found" << std::endl;
+            return 1;
+        } else if (config.normalize_vectors) {
+            search_engine->set_vector_preprocessor(VectorPreprocessor::normalization(config.dimension));
+        }
+        
+        // A segmented snapshot, when present, supersedes the monolithic index file
+        if (!config.index_snapshot_dir.empty()) {
+            if (!std::ifstream(config.index_snapshot_dir + "/manifest.json")) {
+                std::cout << "No index snapshot in " << config.index_snapshot_dir
+                          << " yet, serving " << config.index_path << std::endl;
+            } else if (!search_engine->load_index_snapshot(config.index_snapshot_dir,
+                                                           config.index_snapshot_lazy)) {
+                std::cerr << "Failed to load index snapshot " << config.index_snapshot_dir << std::endl;
+                return 1;
+            }
+        }
+        
+        // Tenants too large for DRAM are served from an SSD-resident graph
+        if (!config.disk_index_path.empty()) {
+            if (!search_engine->load_disk_index(config.disk_index_path,
+                                                static_cast<size_t>(config.disk_index_cache_nodes),
+                                                config.disk_index_search_list,
+                                                config.disk_index_beam_width)) {
+                std::cerr << "Failed to load DiskANN index " << config.disk_index_path << std::endl;
+                return 1;
+            }
+        }
+        
         // Print index statistics
         auto stats = search_engine->get_statistics();
         std::cout << "Index statistics:" << std::endl;
@@ -225,6 +498,142 @@ int main(int argc, char* argv[]) {
         std::cout << "  Index type: " << stats["index_type"] << std::endl;
         std::cout << "  Memory usage: " << stats["memory_usage_mb"] << " MB" << std::endl;
         
+        // Move IVF lists to the DRAM/NVMe tiered store before anything is prefaulted
+        if (!config.tiered_lists_path.empty()) {
+            size_t hot_bytes = static_cast<size_t>(config.hot_lists_memory_mb) * 1024 * 1024;
+            size_t cold_cache_bytes = static_cast<size_t>(config.cold_cache_memory_mb) * 1024 * 1024;
+            if (!search_engine->enable_tiered_lists(config.tiered_lists_path, hot_bytes, cold_cache_bytes,
+                                                    std::chrono::seconds(config.tier_rebalance_seconds))) {
+                std::cerr << "Failed to enable tiered lists, keeping the index in memory" << std::endl;
+            }
+        }
+        
+        // Flat indexes scan a compact prefix array first, then re-score with
+        // full vectors; wrapped before the delta index so merges keep it
+        if (config.matryoshka_prefix_dimension > 0) {
+            if (!search_engine->enable_matryoshka_search(config.matryoshka_prefix_dimension,
+                                                         config.matryoshka_candidate_multiplier)) {
+                std::cerr << "Failed to enable Matryoshka search, searching full vectors" << std::endl;
+            }
+        }
+        
+        // Restrictive filters on HNSW: skip filtered-out nodes while
+        // traversing, or scan the few passing documents exactly (other
+        // index types keep their own filtered search)
+        if (config.filtered_hnsw_search) {
+            search_engine->enable_filtered_hnsw_search(config.filtered_hnsw_exact_selectivity,
+                                                       config.filtered_hnsw_native_selectivity);
+        }
+        
+        // Filters on one tenant-like field search that value's own index
+        if (!config.partition_field.empty()) {
+            search_engine->rebuild_partitions();
+        }
+        
+        // Newer documents rank higher: scores decay with the timestamp's age
+        if (!config.freshness_field.empty()) {
+            search_engine->enable_freshness_scoring(config.freshness_field, config.freshness_candidate_multiplier);
+        }
+        
+        // Fresh inserts go to a delta segment that is merged in the background
+        if (!config.delta_index_type.empty()) {
+            if (!search_engine->enable_delta_index(config.delta_index_type,
+                                                   static_cast<size_t>(config.delta_merge_threshold),
+                                                   std::chrono::seconds(config.delta_merge_interval_seconds))) {
+                std::cerr << "Failed to enable delta index, inserting into the main index" << std::endl;
+            }
+        }
+        
+        // From here on new indexes are swapped in as generations, never by restarting
+        if (config.index_hot_swap && !search_engine->enable_hot_swap()) {
+            std::cerr << "Failed to enable hot index swap" << std::endl;
+            config.index_hot_swap = false;
+        }
+        
+        // Hard memory budget: caches shrink above the soft limit, inserts that
+        // would exceed it wait for memory or are rejected. 0 derives it from
+        // the container's cgroup limit (no limit found: account only)
+        size_t memory_budget_bytes = std::stoul(std::getenv("MEMORY_BUDGET_MB") ?: "0") * 1024 * 1024;
+        if (memory_budget_bytes == 0) {
+            memory_budget_bytes = MemoryAccountant::detect_budget();
+        }
+        memory_accountant = std::make_unique<MemoryAccountant>(
+            memory_budget_bytes, std::stod(std::getenv("MEMORY_SOFT_LIMIT") ?: "0.9"));
+        if (size_t insert_limit_mb = std::stoul(std::getenv("MEMORY_INSERT_LIMIT_MB") ?: "0")) {
+            memory_accountant->set_limit(MemoryComponent::INSERTS, insert_limit_mb * 1024 * 1024);
+        }
+        memory_accountant->set_sampler([](MemoryAccountant& accountant) {
+            search_engine->sample_memory_usage(accountant);
+        });
+        memory_accountant->add_reclaimer(MemoryComponent::LIST_CACHE, [](size_t bytes) {
+            return search_engine->reclaim_cache_memory(bytes);
+        });
+        memory_accountant->start(std::chrono::milliseconds(
+            std::stoi(std::getenv("MEMORY_SAMPLE_INTERVAL_MS") ?: "1000")));
+        search_engine->set_memory_accountant(memory_accountant.get());
+        if (memory_budget_bytes > 0) {
+            std::cout << "Memory budget: " << memory_budget_bytes / (1024 * 1024) << " MB" << std::endl;
+        } else {
+            std::cout << "No memory budget configured, accounting only" << std::endl;
+        }
+        
+        // Readiness is reported on the admin port from here on; /ready stays
+        // 503 until the index is resident and latency probes meet the SLO
+        readiness_gate = std::make_unique<ReadinessGate>(
+            std::stod(std::getenv("READINESS_LATENCY_SLO_MS") ?: "50"),
+            std::stoi(std::getenv("READINESS_FAILURE_THRESHOLD") ?: "3"));
+        
+        bool prefault_index = std::string(std::getenv("INDEX_PREFAULT") ?: "true") == "true";
+        bool lock_index_memory = std::string(std::getenv("INDEX_MLOCK") ?: "false") == "true";
+        if (config.index_hot_swap) {
+            // New generations are prefaulted like the startup index
+            index_reloader = std::make_unique<IndexReloader>(
+                search_engine.get(), prefault_index ? readiness_gate.get() : nullptr,
+                config.num_threads, lock_index_memory);
+        }
+        
+        int admin_port = std::stoi(std::getenv("ADMIN_PORT") ?: "8003");
+        admin_server = std::make_unique<AdminServer>(
+            std::getenv("VECTOR_SERVICE_HOST") ?: "0.0.0.0", admin_port,
+            search_engine.get(), readiness_gate.get());
+        admin_server->set_index_reloader(index_reloader.get());
+        
+        if (!admin_server->start()) {
+            std::cerr << "Failed to start admin server" << std::endl;
+            return 1;
+        }
+        
+        // Raw query text for /search_text: cached embeddings, misses batched to
+        // the embedding backend (empty EMBEDDING_BACKEND disables text search)
+        std::string embedding_backend_spec = std::getenv("EMBEDDING_BACKEND") ?: "";
+        if (!embedding_backend_spec.empty()) {
+            size_t embedding_batch_size = std::stoul(std::getenv("EMBEDDING_BATCH_SIZE") ?: "32");
+            std::string backend_error;
+            auto backend = create_embedding_backend(
+                embedding_backend_spec, config.dimension, embedding_batch_size,
+                std::stoi(std::getenv("EMBEDDING_THREADS") ?: "0"), backend_error);
+            if (!backend) {
+                std::cerr << "Failed to create embedding backend: " << backend_error << std::endl;
+                return 1;
+            }
+            std::unique_ptr<EmbeddingCache> embedding_cache;
+            if (size_t cache_entries = std::stoul(std::getenv("EMBEDDING_CACHE_SIZE") ?: "100000")) {
+                embedding_cache = std::make_unique<EmbeddingCache>(
+                    cache_entries, config.dimension,
+                    std::chrono::seconds(std::stoi(std::getenv("EMBEDDING_CACHE_TTL_SECONDS") ?: "86400")));
+                memory_accountant->set_usage(MemoryComponent::EMBEDDINGS, embedding_cache->memory_bytes());
+            }
+            query_embedder = std::make_unique<QueryEmbedder>(
+                std::move(backend), std::move(embedding_cache), embedding_batch_size,
+                std::chrono::microseconds(std::stoi(std::getenv("EMBEDDING_BATCH_WAIT_US") ?: "2000")));
+            query_embedder->start();
+            if (!search_engine->set_query_embedder(query_embedder.get())) {
+                query_embedder.reset();
+            } else {
+                std::cout << "Text search embeds with " << embedding_backend_spec << std::endl;
+            }
+        }
+        
         // Initialize HTTP server
         std::cout << "\nStarting HTTP server..." << std::endl;
         
@@ -240,30 +649,125 @@ int main(int argc, char* argv[]) {
         
         std::cout << "HTTP server started on " << host << ":" << port << std::endl;
         
+        // Streaming RPC shares one micro-batcher across all connections
+        micro_batcher = std::make_unique<MicroBatcher>(
+            search_engine.get(),
+            static_cast<size_t>(config.max_batch_size),
+            std::chrono::microseconds(config.batch_timeout_us));
+        micro_batcher->set_memory_accountant(memory_accountant.get());
+        micro_batcher->start();
+        
+        int rpc_port = std::stoi(std::getenv("STREAM_RPC_PORT") ?: "8002");
+        stream_rpc_server = std::make_unique<StreamRpcServer>(
+            host, rpc_port, micro_batcher.get(), config.dimension, config.max_results);
+        
+        if (!stream_rpc_server->start()) {
+            std::cerr << "Failed to start streaming RPC server" << std::endl;
+            return 1;
+        }
+        
+        std::cout << "Streaming RPC server started on " << host << ":" << rpc_port << std::endl;
+        
+        // Shared-memory transport for co-located clients (empty name disables it)
+        std::string shm_name = std::getenv("SHM_TRANSPORT_NAME") ?: "/neurorag_vector_service";
+        if (!shm_name.empty()) {
+            shm_transport_server = std::make_unique<ShmTransportServer>(
+                shm_name, micro_batcher.get(), config.dimension, config.max_results);
+            
+            if (!shm_transport_server->start()) {
+                std::cerr << "WARNING: Shared-memory transport unavailable, continuing without it" << std::endl;
+                shm_transport_server.reset();
+            } else {
+                std::cout << "Shared-memory transport listening on " << shm_name << std::endl;
+                memory_accountant->set_usage(MemoryComponent::ARENAS, shm_transport_server->segment_size());
+            }
+        }
+        
         // Start background threads
         std::thread health_thread(health_check_thread);
         std::thread metrics_thread(metrics_reporting_thread);
         
+        // Make the index resident before taking traffic
+        if (prefault_index) {
+            readiness_gate->set_phase(ReadinessGate::Phase::LOADING_PAGES);
+            readiness_gate->prefault(search_engine->get_index_memory_regions(), config.num_threads, lock_index_memory);
+            std::cout << "Index memory resident: " << readiness_gate->resident_fraction() * 100 << "%" << std::endl;
+        }
+        
+        readiness_gate->set_phase(ReadinessGate::Phase::WARMING_UP);
+        
+        // Sampled query log: replayed for warmup here, refreshed from live traffic below
+        std::string query_log_path = std::getenv("QUERY_LOG_PATH") ?: "/data/query_log.bin";
+        double query_log_sample_rate = std::stod(std::getenv("QUERY_LOG_SAMPLE_RATE") ?: "0.01");
+        size_t query_log_capacity = std::stoul(std::getenv("QUERY_LOG_CAPACITY") ?: "4096");
+        uint32_t query_log_min_count = std::stoul(std::getenv("QUERY_LOG_MIN_COUNT") ?: "2");
+        size_t warmup_top_n = std::stoul(std::getenv("WARMUP_TOP_N") ?: "1000");
+        
+        query_recorder = std::make_unique<QueryRecorder>(
+            config.dimension, query_log_sample_rate, query_log_capacity, query_log_min_count);
+        bool have_query_log = query_recorder->load(query_log_path);
+        
         // Cache warmup if enabled
-        if (config.enable_cache) {
-            std::cout << "\nWarming up cache..." << std::endl;
-            // Load popular queries from file or generate synthetic ones
-            std::vector<std::vector<float>> warmup_queries;
-            for (int i = 0; i < 100; ++i) {
-                std::vector<float> query(config.dimension);
-                for (int j = 0; j < config.dimension; ++j) {
-                    query[j] = static_cast<float>(rand()) / RAND_MAX;
-                }
-                warmup_queries.push_back(query);
+        if (config.enable_cache && have_query_log && warmup_top_n > 0) {
+            std::cout << "\nWarming up from recorded traffic..." << std::endl;
+            auto report = search_engine->warmup_from_traffic(query_recorder->top_queries(warmup_top_n));
+            std::cout << "Cache warmup completed: " << report["queries_replayed"] << " queries replayed, "
+                      << report["bytes_touched"] << " index bytes touched in "
+                      << report["elapsed_ms"] << " ms" << std::endl;
+        } else if (config.enable_cache) {
+            std::cout << "\nNo recorded traffic at " << query_log_path << ", skipping cache warmup" << std::endl;
+        }
+        
+        // Record only after warmup so replayed queries are not counted twice
+        if (query_log_sample_rate > 0.0) {
+            search_engine->set_query_recorder(query_recorder.get());
+            query_recorder->start_periodic_flush(query_log_path, std::chrono::seconds(
+                std::stoi(std::getenv("QUERY_LOG_FLUSH_SECONDS") ?: "300")));
+        }
+        
+        // Latency probes use recorded traffic when available, random unit vectors otherwise
+        std::vector<std::vector<float>> probe_queries;
+        for (auto& recorded : query_recorder->top_queries(32)) {
+            probe_queries.push_back(std::move(recorded.vector));
+        }
+        std::mt19937 probe_rng(42);
+        std::normal_distribution<float> probe_dist(0.0f, 1.0f);
+        while (probe_queries.size() < 32) {
+            std::vector<float> query(config.dimension);
+            float norm = 0.0f;
+            for (float& value : query) {
+                value = probe_dist(probe_rng);
+                norm += value * value;
+            }
+            for (float& value : query) {
+                value /= std::sqrt(norm);
+            }
+            probe_queries.push_back(std::move(query));
+        }
+        
+        readiness_gate->set_phase(ReadinessGate::Phase::PROBING);
+        readiness_gate->start_latency_probes(
+            search_engine.get(), std::move(probe_queries), 10,
+            std::chrono::milliseconds(std::stoi(std::getenv("READINESS_PROBE_INTERVAL_MS") ?: "5000")));
+        
+        // Pick up indexes published to the snapshot directory (or index file) while serving
+        if (index_reloader && config.index_reload_watch_seconds > 0) {
+            if (!config.disk_index_path.empty()) {
+                std::cout << "Serving a DiskANN index, not watching for new generations" << std::endl;
+            } else {
+                const std::string& source = config.index_snapshot_dir.empty()
+                    ? config.index_path : config.index_snapshot_dir;
+                index_reloader->watch(source, config.index_reload_mmap,
+                                      std::chrono::seconds(config.index_reload_watch_seconds));
             }
-            search_engine->warmup_cache(warmup_queries);
-            std::cout << "Cache warmup completed" << std::endl;
         }
         
         std::cout << "\n🚀 NeuroRAG Vector Search Service is ready!" << std::endl;
         std::cout << "📊 Metrics endpoint: http://" << host << ":" << port << "/metrics" << std::endl;
         std::cout << "🏥 Health endpoint: http://" << host << ":" << port << "/health" << std::endl;
         std::cout << "🔍 Search endpoint: http://" << host << ":" << port << "/search" << std::endl;
+        std::cout << "⚡ Streaming RPC: tcp://" << host << ":" << rpc_port << std::endl;
+        std::cout << "🚦 Readiness endpoint: http://" << host << ":" << admin_port << "/ready" << std::endl;
         std::cout << "\nPress Ctrl+C to shutdown gracefully..." << std::endl;
         
         // Main event loop
@@ -271,7 +775,20 @@ int main(int argc, char* argv[]) {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
         
-        std::cout << "\nShutting down..." << std::endl;
+        std::cout << "\nReceived shutdown signal, initiating graceful shutdown..." << std::endl;
+        
+        // Fail readiness first so the pod is taken out of rotation while draining
+        readiness_gate->set_phase(ReadinessGate::Phase::SHUTTING_DOWN);
+        http_server->stop();
+        stream_rpc_server->stop();
+        if (shm_transport_server) {
+            shm_transport_server->stop();
+        }
+        micro_batcher->stop();
+        if (query_embedder) {
+            query_embedder->stop();
+        }
+        search_engine->shutdown();
         
         // Stop background threads
         if (health_thread.joinable()) {
@@ -282,8 +799,21 @@ int main(int argc, char* argv[]) {
         }
         
         // Cleanup
+        readiness_gate->stop();
+        memory_accountant->stop();
+        search_engine->set_memory_accountant(nullptr);
+        admin_server.reset();
+        index_reloader.reset();
         http_server.reset();
+        stream_rpc_server.reset();
+        shm_transport_server.reset();
+        micro_batcher.reset();
+        search_engine->set_query_embedder(nullptr);
+        query_embedder.reset();
         search_engine.reset();
+        query_recorder.reset();
+        readiness_gate.reset();
+        memory_accountant.reset();
         metrics_collector.reset();
         
         std::cout << "Shutdown completed successfully" << std::endl;
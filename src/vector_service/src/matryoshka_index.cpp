@@ -0,0 +1,327 @@
+/**
+ * @file matryoshka_index.cpp
+ * @brief Coarse-to-fine search over truncated (Matryoshka) embeddings
+ */
+
+#include "matryoshka_index.h"
+#include "simd_kernels.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include <omp.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/impl/IDSelector.h>
+
+namespace neurorag {
+
+namespace {
+
+// Below this many rows a single query is scanned by one thread
+constexpr size_t kParallelScanRows = 65536;
+
+// (score, id); higher scores are better, L2 distances are negated
+using Candidate = std::pair<float, faiss::idx_t>;
+
+// Min-heap on score: the weakest kept candidate is at the front
+struct WorseFirst {
+    bool operator()(const Candidate& a, const Candidate& b) const { return a.first > b.first; }
+};
+
+void keep_best(std::vector<Candidate>& heap, size_t capacity, float score, faiss::idx_t id) {
+    if (heap.size() < capacity) {
+        heap.emplace_back(score, id);
+        std::push_heap(heap.begin(), heap.end(), WorseFirst());
+    } else if (score > heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end(), WorseFirst());
+        heap.back() = {score, id};
+        std::push_heap(heap.begin(), heap.end(), WorseFirst());
+    }
+}
+
+} // namespace
+
+MatryoshkaIndex::MatryoshkaIndex(std::shared_ptr<faiss::IndexFlat> full, int prefix_dimension,
+                                 int candidate_multiplier)
+    : faiss::Index(full->d, full->metric_type),
+      full_(std::move(full)),
+      prefix_dimension_(prefix_dimension),
+      candidate_multiplier_(std::max(1, candidate_multiplier)),
+      unit_prefixes_(metric_type == faiss::METRIC_INNER_PRODUCT) {
+    ntotal = full_->ntotal;
+    is_trained = true;
+    append_prefixes(static_cast<size_t>(ntotal), full_->get_xb());
+}
+
+bool MatryoshkaIndex::can_wrap(const faiss::Index& index, int prefix_dimension, std::string& reason) {
+    if (!dynamic_cast<const faiss::IndexFlat*>(&index)) {
+        reason = "Matryoshka search needs a FLAT index of the full vectors";
+        return false;
+    }
+    if (index.metric_type != faiss::METRIC_INNER_PRODUCT && index.metric_type != faiss::METRIC_L2) {
+        reason = "Matryoshka search supports inner product and L2 only";
+        return false;
+    }
+    if (prefix_dimension <= 0 || prefix_dimension >= index.d) {
+        reason = "Matryoshka prefix of " + std::to_string(prefix_dimension) +
+                 " dimensions does not fit a " + std::to_string(index.d) + "-dimensional index";
+        return false;
+    }
+    return true;
+}
+
+MatryoshkaIndex* MatryoshkaIndex::clone() const {
+    auto full = std::make_shared<faiss::IndexFlat>(*full_);
+    return new MatryoshkaIndex(std::move(full), prefix_dimension_, candidate_multiplier_);
+}
+
+size_t MatryoshkaIndex::memory_bytes() const {
+    return prefixes_.capacity() * sizeof(float);
+}
+
+nlohmann::json MatryoshkaIndex::get_statistics() const {
+    nlohmann::json stats;
+    stats["dimension"] = d;
+    stats["prefix_dimension"] = prefix_dimension_;
+    stats["candidate_multiplier"] = candidate_multiplier_;
+    stats["unit_prefixes"] = unit_prefixes_;
+    stats["vectors"] = ntotal;
+    stats["prefix_memory_bytes"] = memory_bytes();
+    stats["searches"] = searches_.load();
+    stats["exact_searches"] = exact_searches_.load();
+    stats["candidates_rescored"] = candidates_rescored_.load();
+    stats["kernels"] = simd::instruction_set();
+    return stats;
+}
+
+std::shared_ptr<const faiss::Index> MatryoshkaIndex::base_index() const {
+    return full_;
+}
+
+void MatryoshkaIndex::append_prefixes(size_t n, const float* x) {
+    size_t first = prefixes_.size() / prefix_dimension_;
+    prefixes_.resize((first + n) * prefix_dimension_);
+    #pragma omp parallel for schedule(static) if (n > kParallelScanRows)
+    for (size_t i = 0; i < n; ++i) {
+        float* prefix = &prefixes_[(first + i) * prefix_dimension_];
+        std::memcpy(prefix, x + i * d, prefix_dimension_ * sizeof(float));
+        if (unit_prefixes_) {
+            float norm = simd::norm_sqr(prefix, prefix_dimension_);
+            if (norm > 0.0f) {
+                simd::scale(prefix, 1.0f / std::sqrt(norm), prefix_dimension_);
+            }
+        }
+    }
+}
+
+void MatryoshkaIndex::add(faiss::idx_t n, const float* x) {
+    full_->add(n, x);
+    append_prefixes(static_cast<size_t>(n), x);
+    ntotal = full_->ntotal;
+}
+
+void MatryoshkaIndex::reset() {
+    full_->reset();
+    prefixes_.clear();
+    ntotal = 0;
+}
+
+size_t MatryoshkaIndex::remove_ids(const faiss::IDSelector& sel) {
+    // IndexFlat compacts in order, so the prefixes are compacted the same way
+    size_t kept = 0;
+    for (faiss::idx_t i = 0; i < ntotal; ++i) {
+        if (!sel.is_member(i)) {
+            if (kept != static_cast<size_t>(i)) {
+                std::memcpy(&prefixes_[kept * prefix_dimension_], &prefixes_[i * prefix_dimension_],
+                            prefix_dimension_ * sizeof(float));
+            }
+            ++kept;
+        }
+    }
+    size_t removed = full_->remove_ids(sel);
+    prefixes_.resize(kept * prefix_dimension_);
+    ntotal = full_->ntotal;
+    return removed;
+}
+
+void MatryoshkaIndex::reconstruct(faiss::idx_t key, float* recons) const {
+    full_->reconstruct(key, recons);
+}
+
+void MatryoshkaIndex::search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances,
+                             faiss::idx_t* labels, const faiss::SearchParameters* params) const {
+    if (k <= 0) {
+        throw faiss::FaissException("MatryoshkaIndex: k must be positive");
+    }
+    int prefix = prefix_dimension_;
+    int multiplier = candidate_multiplier_;
+    if (auto* overrides = dynamic_cast<const MatryoshkaSearchParameters*>(params)) {
+        if (overrides->prefix_dimension > 0) {
+            prefix = overrides->prefix_dimension;
+        }
+        if (overrides->candidate_multiplier > 0) {
+            multiplier = overrides->candidate_multiplier;
+        }
+    }
+    searches_.fetch_add(static_cast<uint64_t>(n));
+
+    // A prefix as long as the vector is a plain exact search
+    if (prefix >= d) {
+        exact_searches_.fetch_add(static_cast<uint64_t>(n));
+        faiss::SearchParameters exact;
+        exact.sel = params ? params->sel : nullptr;
+        full_->search(n, x, k, distances, labels, &exact);
+        return;
+    }
+    // Only the stored prefix can be scanned; shorter ones read part of it
+    prefix = std::min(prefix, prefix_dimension_);
+    size_t candidates = std::min(static_cast<size_t>(k) * static_cast<size_t>(multiplier),
+                                 static_cast<size_t>(ntotal));
+    candidates = std::max(candidates, std::min(static_cast<size_t>(k), static_cast<size_t>(ntotal)));
+    const faiss::IDSelector* sel = params ? params->sel : nullptr;
+
+    // One query fans out over the rows; a batch fans out over queries
+    if (n == 1) {
+        search_one(x, static_cast<size_t>(k), prefix, candidates, sel, true, distances, labels);
+        return;
+    }
+    #pragma omp parallel for schedule(dynamic)
+    for (faiss::idx_t q = 0; q < n; ++q) {
+        search_one(x + q * d, static_cast<size_t>(k), prefix, candidates, sel, false,
+                   distances + q * k, labels + q * k);
+    }
+}
+
+void MatryoshkaIndex::search_one(const float* query, size_t k, int prefix, size_t candidates,
+                                 const faiss::IDSelector* sel, bool parallel,
+                                 float* distances, faiss::idx_t* labels) const {
+    bool inner_product = metric_type == faiss::METRIC_INNER_PRODUCT;
+    size_t rows = static_cast<size_t>(ntotal);
+
+    // First pass: best candidates by prefix, each thread over its own rows
+    int threads = parallel && rows >= kParallelScanRows ? omp_get_max_threads() : 1;
+    std::vector<std::vector<Candidate>> heaps(threads);
+    #pragma omp parallel for num_threads(threads) schedule(static) if (threads > 1)
+    for (int t = 0; t < threads; ++t) {
+        std::vector<Candidate>& heap = heaps[t];
+        heap.reserve(candidates);
+        size_t begin = rows * t / threads;
+        size_t end = rows * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i) {
+            if (sel && !sel->is_member(static_cast<faiss::idx_t>(i))) {
+                continue;
+            }
+            const float* row = &prefixes_[i * prefix_dimension_];
+            float score = inner_product ? simd::dot(query, row, prefix) : -simd::l2_sqr(query, row, prefix);
+            keep_best(heap, candidates, score, static_cast<faiss::idx_t>(i));
+        }
+    }
+    std::vector<Candidate>& shortlist = heaps[0];
+    for (int t = 1; t < threads; ++t) {
+        for (const Candidate& candidate : heaps[t]) {
+            keep_best(shortlist, candidates, candidate.first, candidate.second);
+        }
+    }
+
+    // Second pass: full vectors of the shortlist, visited in row order
+    std::sort(shortlist.begin(), shortlist.end(),
+              [](const Candidate& a, const Candidate& b) { return a.second < b.second; });
+    const float* vectors = full_->get_xb();
+    for (size_t i = 0; i < shortlist.size(); ++i) {
+        if (i + 1 < shortlist.size()) {
+            __builtin_prefetch(vectors + shortlist[i + 1].second * d);
+        }
+        const float* row = vectors + shortlist[i].second * d;
+        shortlist[i].first = inner_product ? simd::dot(query, row, d) : -simd::l2_sqr(query, row, d);
+    }
+    candidates_rescored_.fetch_add(shortlist.size(), std::memory_order_relaxed);
+
+    size_t found = std::min(k, shortlist.size());
+    std::partial_sort(shortlist.begin(), shortlist.begin() + found, shortlist.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.first > b.first; });
+    for (size_t i = 0; i < k; ++i) {
+        if (i < found) {
+            distances[i] = inner_product ? shortlist[i].first : -shortlist[i].first;
+            labels[i] = shortlist[i].second;
+        } else {
+            distances[i] = inner_product ? -std::numeric_limits<float>::max() : std::numeric_limits<float>::max();
+            labels[i] = -1;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<const MatryoshkaIndex> VectorSearchEngine::matryoshka_index() const {
+    std::shared_ptr<const faiss::Index> layer = serving_index();
+    while (layer) {
+        if (auto matryoshka = std::dynamic_pointer_cast<const MatryoshkaIndex>(layer)) {
+            return matryoshka;
+        }
+        auto* layered = dynamic_cast<const LayeredIndex*>(layer.get());
+        if (!layered) {
+            break;
+        }
+        layer = layered->base_index();
+    }
+    return nullptr;
+}
+
+bool VectorSearchEngine::enable_matryoshka_search(int prefix_dimension, int candidate_multiplier) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (!index_) {
+        return false;
+    }
+    if (dynamic_cast<MatryoshkaIndex*>(index_.get())) {
+        return true;
+    }
+    std::string reason;
+    if (!MatryoshkaIndex::can_wrap(*index_, prefix_dimension, reason)) {
+        std::cerr << reason << "; Matryoshka search not enabled" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<faiss::IndexFlat> full(static_cast<faiss::IndexFlat*>(index_.release()));
+    index_ = std::make_unique<MatryoshkaIndex>(std::move(full), prefix_dimension, candidate_multiplier);
+    std::cout << "Matryoshka search enabled (" << prefix_dimension << " of " << index_->d
+              << " dimensions, " << candidate_multiplier << "x candidates)" << std::endl;
+    return true;
+}
+
+std::unique_ptr<faiss::SearchParameters> VectorSearchEngine::matryoshka_search_parameters(
+        const SearchRequest& request) {
+    if (request.prefix_dimension <= 0 && request.candidate_multiplier <= 0) {
+        return nullptr;
+    }
+    {
+        // Other index types reject parameters of a foreign type
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        if (!matryoshka_index()) {
+            return nullptr;
+        }
+    }
+    auto params = std::make_unique<MatryoshkaSearchParameters>();
+    params->prefix_dimension = std::max(0, request.prefix_dimension);
+    params->candidate_multiplier = std::max(0, request.candidate_multiplier);
+    return params;
+}
+
+nlohmann::json VectorSearchEngine::get_matryoshka_statistics() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto matryoshka = matryoshka_index();
+    if (!matryoshka) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = matryoshka->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,524 @@
+/**
+ * @file memory_accountant.cpp
+ * @brief Per-component memory accounting and insert admission
+ */
+
+#include "memory_accountant.h"
+#include "diskann_index.h"
+#include "lsm_index.h"
+#include "matryoshka_index.h"
+#include "metadata_filter.h"
+#include "partitioned_index.h"
+#include "readiness.h"
+#include "tiered_invlists.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/invlists/InvertedLists.h>
+
+namespace neurorag {
+
+namespace {
+
+// cgroup files report "max" (v2) or a page-rounded 2^63 (v1) when unlimited
+constexpr size_t kUnlimitedBytes = size_t{1} << 60;
+
+size_t read_limit_file(const char* path) {
+    std::ifstream file(path);
+    std::string value;
+    if (!(file >> value) || value == "max") {
+        return 0;
+    }
+    try {
+        size_t bytes = std::stoull(value);
+        return bytes >= kUnlimitedBytes ? 0 : bytes;
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+// Resident pages not backed by a file: heap, stacks, anonymous mappings.
+// Mapped index files are page cache the kernel can drop, so they do not count
+size_t anonymous_resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t size_pages = 0, resident_pages = 0, shared_pages = 0;
+    if (!(statm >> size_pages >> resident_pages >> shared_pages)) {
+        return 0;
+    }
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (resident_pages - std::min(resident_pages, shared_pages)) * page_size;
+}
+
+void subtract_saturating(std::atomic<size_t>& value, size_t bytes) {
+    size_t current = value.load();
+    while (!value.compare_exchange_weak(current, current - std::min(current, bytes))) {
+    }
+}
+
+// Heap memory of the index proper; tiered lists, DiskANN caches and mapped
+// lists are accounted elsewhere or not at all
+size_t resident_index_bytes(const faiss::Index* index) {
+    if (!index || dynamic_cast<const DiskAnnIndex*>(index)) {
+        return 0;
+    }
+    if (auto* ivf = dynamic_cast<const faiss::IndexIVF*>(index)) {
+        size_t bytes = resident_index_bytes(ivf->quantizer);
+        if (auto* lists = dynamic_cast<const faiss::ArrayInvertedLists*>(ivf->invlists)) {
+            for (size_t list_no = 0; list_no < lists->nlist; ++list_no) {
+                bytes += lists->codes[list_no].capacity() + lists->ids[list_no].capacity() * sizeof(faiss::idx_t);
+            }
+        }
+        return bytes;
+    }
+    size_t bytes = 0;
+    for (const auto& region : index_memory_regions(index)) {
+        bytes += region.size;
+    }
+    return bytes;
+}
+
+} // namespace
+
+const char* memory_component_name(MemoryComponent component) {
+    switch (component) {
+        case MemoryComponent::INDEX: return "index";
+        case MemoryComponent::METADATA: return "metadata";
+        case MemoryComponent::DELTA: return "delta";
+        case MemoryComponent::LIST_CACHE: return "list_cache";
+        case MemoryComponent::NODE_CACHE: return "node_cache";
+        case MemoryComponent::ARENAS: return "arenas";
+        case MemoryComponent::REQUESTS: return "requests";
+        case MemoryComponent::INSERTS: return "inserts";
+        case MemoryComponent::EMBEDDINGS: return "embeddings";
+        default: return "unknown";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// MemoryReservation
+// ---------------------------------------------------------------------------
+
+MemoryReservation::~MemoryReservation() {
+    release();
+}
+
+MemoryReservation::MemoryReservation(MemoryReservation&& other) noexcept
+    : owner_(other.owner_), component_(other.component_), bytes_(other.bytes_) {
+    other.owner_ = nullptr;
+    other.bytes_ = 0;
+}
+
+MemoryReservation& MemoryReservation::operator=(MemoryReservation&& other) noexcept {
+    if (this != &other) {
+        release();
+        owner_ = other.owner_;
+        component_ = other.component_;
+        bytes_ = other.bytes_;
+        other.owner_ = nullptr;
+        other.bytes_ = 0;
+    }
+    return *this;
+}
+
+void MemoryReservation::commit(MemoryComponent target) {
+    if (owner_ && bytes_ > 0) {
+        owner_->transfer(component_, target, bytes_);
+    }
+    owner_ = nullptr;
+    bytes_ = 0;
+}
+
+void MemoryReservation::release() {
+    if (owner_ && bytes_ > 0) {
+        owner_->release(component_, bytes_);
+    }
+    owner_ = nullptr;
+    bytes_ = 0;
+}
+
+// ---------------------------------------------------------------------------
+// MemoryAccountant
+// ---------------------------------------------------------------------------
+
+MemoryAccountant::MemoryAccountant(size_t budget_bytes, double soft_limit)
+    : budget_bytes_(budget_bytes),
+      soft_limit_bytes_(static_cast<size_t>(budget_bytes * std::clamp(soft_limit, 0.0, 1.0))),
+      process_bytes_(0),
+      sampling_(false),
+      reservations_granted_(0),
+      reservations_waited_(0),
+      reservations_rejected_(0),
+      reclaimed_bytes_(0),
+      reclaim_runs_(0) {}
+
+MemoryAccountant::~MemoryAccountant() {
+    stop();
+}
+
+size_t MemoryAccountant::detect_budget(double headroom) {
+    size_t limit = read_limit_file("/sys/fs/cgroup/memory.max");
+    if (limit == 0) {
+        limit = read_limit_file("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    }
+    return static_cast<size_t>(limit * (1.0 - std::clamp(headroom, 0.0, 0.9)));
+}
+
+void MemoryAccountant::set_limit(MemoryComponent c, size_t bytes) {
+    component(c).limit.store(bytes);
+    released_.notify_all();
+}
+
+void MemoryAccountant::set_usage(MemoryComponent c, size_t bytes) {
+    size_t previous = component(c).sampled.exchange(bytes);
+    if (bytes < previous) {
+        released_.notify_all();
+    }
+}
+
+void MemoryAccountant::charge(MemoryComponent c, size_t bytes) {
+    component(c).charged.fetch_add(bytes);
+}
+
+void MemoryAccountant::discharge(MemoryComponent c, size_t bytes) {
+    subtract_saturating(component(c).charged, bytes);
+    released_.notify_all();
+}
+
+size_t MemoryAccountant::usage(MemoryComponent c) const {
+    const Component& entry = component(c);
+    return entry.sampled.load() + entry.charged.load() + entry.reserved.load();
+}
+
+size_t MemoryAccountant::accounted() const {
+    size_t total = 0;
+    for (size_t i = 0; i < kComponents; ++i) {
+        total += usage(static_cast<MemoryComponent>(i));
+    }
+    return total;
+}
+
+size_t MemoryAccountant::used() const {
+    // Reserved memory is not allocated yet, so it is not in the process figure
+    size_t reserved = 0;
+    for (const auto& entry : components_) {
+        reserved += entry.reserved.load();
+    }
+    return std::max(accounted(), process_bytes_.load() + reserved);
+}
+
+bool MemoryAccountant::under_pressure() const {
+    return budget_bytes_ > 0 && used() > soft_limit_bytes_;
+}
+
+bool MemoryAccountant::fits_locked(MemoryComponent c, size_t bytes) const {
+    size_t limit = component(c).limit.load();
+    if (limit > 0 && usage(c) + bytes > limit) {
+        return false;
+    }
+    return budget_bytes_ == 0 || used() + bytes <= budget_bytes_;
+}
+
+bool MemoryAccountant::try_reserve(MemoryComponent c, size_t bytes, MemoryReservation& reservation) {
+    reservation.release();
+    auto grant = [&]() {
+        component(c).reserved.fetch_add(bytes);
+        reservation.owner_ = this;
+        reservation.component_ = c;
+        reservation.bytes_ = bytes;
+        reservations_granted_.fetch_add(1);
+    };
+
+    size_t shortfall = 0;
+    {
+        std::lock_guard<std::mutex> lock(reserve_mutex_);
+        if (fits_locked(c, bytes)) {
+            grant();
+            return true;
+        }
+        if (budget_bytes_ > 0) {
+            size_t needed = used() + bytes;
+            shortfall = needed > budget_bytes_ ? needed - budget_bytes_ : 0;
+        }
+    }
+
+    // Caches give way to inserts; reclaimers take their own locks, so not under ours
+    if (shortfall == 0 || reclaim(shortfall) == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(reserve_mutex_);
+    if (fits_locked(c, bytes)) {
+        grant();
+        return true;
+    }
+    return false;
+}
+
+bool MemoryAccountant::reserve(MemoryComponent c, size_t bytes, std::chrono::milliseconds wait,
+                               MemoryReservation& reservation) {
+    size_t limit = component(c).limit.load();
+    if ((budget_bytes_ > 0 && bytes > budget_bytes_) || (limit > 0 && bytes > limit)) {
+        reservations_rejected_.fetch_add(1);
+        return false;
+    }
+
+    if (try_reserve(c, bytes, reservation)) {
+        return true;
+    }
+
+    reservations_waited_.fetch_add(1);
+    auto deadline = std::chrono::steady_clock::now() + wait;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(reserve_mutex_);
+            if (released_.wait_until(lock, deadline) == std::cv_status::timeout &&
+                !fits_locked(c, bytes)) {
+                break;
+            }
+        }
+        if (try_reserve(c, bytes, reservation)) {
+            return true;
+        }
+    }
+    reservations_rejected_.fetch_add(1);
+    return false;
+}
+
+void MemoryAccountant::release(MemoryComponent c, size_t bytes) {
+    subtract_saturating(component(c).reserved, bytes);
+    released_.notify_all();
+}
+
+void MemoryAccountant::transfer(MemoryComponent from, MemoryComponent to, size_t bytes) {
+    // Sampled, not charged: the next sample of the target replaces it with
+    // a measurement that includes these bytes
+    component(to).sampled.fetch_add(bytes);
+    release(from, bytes);
+}
+
+void MemoryAccountant::add_reclaimer(MemoryComponent c, Reclaimer reclaimer) {
+    std::lock_guard<std::mutex> lock(reclaim_mutex_);
+    reclaimers_.push_back({c, std::move(reclaimer)});
+}
+
+void MemoryAccountant::set_sampler(Sampler sampler) {
+    std::lock_guard<std::mutex> lock(reclaim_mutex_);
+    sampler_ = std::move(sampler);
+}
+
+size_t MemoryAccountant::reclaim(size_t bytes) {
+    std::lock_guard<std::mutex> lock(reclaim_mutex_);
+    size_t freed = 0;
+    for (const auto& entry : reclaimers_) {
+        if (freed >= bytes) {
+            break;
+        }
+        size_t got = entry.reclaim(bytes - freed);
+        subtract_saturating(component(entry.component).sampled, got);
+        freed += got;
+    }
+    if (freed > 0) {
+        // The allocator may keep some of it, but most cache buffers are
+        // large enough to be unmapped; the next sample corrects the estimate
+        subtract_saturating(process_bytes_, freed);
+        reclaimed_bytes_.fetch_add(freed);
+        released_.notify_all();
+    }
+    reclaim_runs_.fetch_add(1);
+    return freed;
+}
+
+void MemoryAccountant::sample() {
+    Sampler sampler;
+    {
+        std::lock_guard<std::mutex> lock(reclaim_mutex_);
+        sampler = sampler_;
+    }
+    if (sampler) {
+        sampler(*this);
+    }
+    process_bytes_.store(anonymous_resident_bytes());
+
+    if (under_pressure()) {
+        reclaim(used() - soft_limit_bytes_);
+    }
+    released_.notify_all();
+}
+
+void MemoryAccountant::start(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(sampler_wait_mutex_);
+    if (sampling_) {
+        return;
+    }
+    sampling_ = true;
+    sampler_thread_ = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> wait_lock(sampler_wait_mutex_);
+        do {
+            wait_lock.unlock();
+            sample();
+            wait_lock.lock();
+        } while (!sampler_condition_.wait_for(wait_lock, interval, [this]() { return !sampling_; }));
+    });
+}
+
+void MemoryAccountant::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sampler_wait_mutex_);
+        sampling_ = false;
+    }
+    sampler_condition_.notify_all();
+    if (sampler_thread_.joinable()) {
+        sampler_thread_.join();
+    }
+}
+
+nlohmann::json MemoryAccountant::get_statistics() const {
+    size_t used_bytes = used();
+    nlohmann::json components;
+    for (size_t i = 0; i < kComponents; ++i) {
+        const Component& entry = components_[i];
+        nlohmann::json component_stats;
+        component_stats["bytes"] = entry.sampled.load() + entry.charged.load() + entry.reserved.load();
+        component_stats["reserved_bytes"] = entry.reserved.load();
+        component_stats["limit_bytes"] = entry.limit.load();
+        components[memory_component_name(static_cast<MemoryComponent>(i))] = component_stats;
+    }
+
+    nlohmann::json stats;
+    stats["budget_bytes"] = budget_bytes_;
+    stats["soft_limit_bytes"] = soft_limit_bytes_;
+    stats["used_bytes"] = used_bytes;
+    stats["accounted_bytes"] = accounted();
+    stats["process_bytes"] = process_bytes_.load();
+    stats["available_bytes"] = budget_bytes_ > used_bytes ? budget_bytes_ - used_bytes : 0;
+    stats["under_pressure"] = under_pressure();
+    stats["components"] = components;
+    stats["reservations_granted"] = reservations_granted_.load();
+    stats["reservations_waited"] = reservations_waited_.load();
+    stats["reservations_rejected"] = reservations_rejected_.load();
+    stats["reclaimed_bytes"] = reclaimed_bytes_.load();
+    stats["reclaim_runs"] = reclaim_runs_.load();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+void VectorSearchEngine::set_memory_accountant(MemoryAccountant* accountant) {
+    memory_accountant_.store(accountant, std::memory_order_release);
+}
+
+void VectorSearchEngine::sample_memory_usage(MemoryAccountant& accountant) {
+    size_t index_bytes = 0;
+    size_t delta_bytes = 0;
+    size_t list_cache_bytes = 0;
+    size_t node_cache_bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        if (auto lsm = std::dynamic_pointer_cast<LsmIndex>(serving_index())) {
+            delta_bytes = lsm->memory_bytes();
+        }
+        auto base = base_index();
+        index_bytes = resident_index_bytes(base.get());
+        if (auto matryoshka = matryoshka_index()) {
+            index_bytes += matryoshka->memory_bytes();
+        }
+        if (auto* disk = dynamic_cast<const DiskAnnIndex*>(base.get())) {
+            for (const auto& region : disk->memory_regions()) {
+                node_cache_bytes += region.size;
+            }
+        } else if (auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get())) {
+            if (auto* tiered = dynamic_cast<TieredInvertedLists*>(ivf->invlists)) {
+                list_cache_bytes = tiered->memory_bytes();
+            }
+        }
+    }
+
+    size_t metadata_bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(metadata_mutex_);
+        metadata_bytes = metadata_.capacity() * sizeof(std::string);
+        for (const auto& entry : metadata_) {
+            // Short strings live inside the std::string itself
+            if (entry.capacity() > 15) {
+                metadata_bytes += entry.capacity() + 1;
+            }
+        }
+    }
+    if (auto columns = std::atomic_load(&metadata_columns_)) {
+        metadata_bytes += columns->memory_bytes();
+    }
+    if (auto partitions = std::atomic_load(&partitions_)) {
+        // Partitions hold a second copy of their vectors
+        index_bytes += partitions->memory_bytes();
+    }
+
+    accountant.set_usage(MemoryComponent::INDEX, index_bytes);
+    accountant.set_usage(MemoryComponent::DELTA, delta_bytes);
+    accountant.set_usage(MemoryComponent::LIST_CACHE, list_cache_bytes);
+    accountant.set_usage(MemoryComponent::NODE_CACHE, node_cache_bytes);
+    accountant.set_usage(MemoryComponent::METADATA, metadata_bytes);
+}
+
+size_t VectorSearchEngine::reclaim_cache_memory(size_t bytes) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto base = base_index();
+    auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base.get());
+    auto* tiered = ivf ? dynamic_cast<TieredInvertedLists*>(ivf->invlists) : nullptr;
+    return tiered ? tiered->trim_pool(bytes) : 0;
+}
+
+bool VectorSearchEngine::admit_insert(size_t count, size_t metadata_bytes, MemoryReservation& reservation) {
+    MemoryAccountant* accountant = memory_accountant_.load(std::memory_order_acquire);
+    if (!accountant || count == 0) {
+        return true;
+    }
+
+    // Vector codes and id in the index, plus the metadata slot
+    size_t dimension = static_cast<size_t>(index_dimension());
+    size_t per_vector = dimension * sizeof(float) + sizeof(faiss::idx_t) + sizeof(std::string);
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        auto serving = serving_index();
+        if (std::dynamic_pointer_cast<LsmIndex>(serving)) {
+            // Delta segments keep a raw copy for merging and a position entry
+            per_vector += dimension * sizeof(float) + sizeof(faiss::idx_t) + 32;
+        }
+        auto base = base_index();
+        if (auto* hnsw = dynamic_cast<const faiss::IndexHNSW*>(base.get())) {
+            per_vector += 2 * hnsw->hnsw.nb_neighbors(0) * sizeof(faiss::HNSW::storage_idx_t);
+        }
+    }
+    if (std::atomic_load(&partitions_)) {
+        per_vector += dimension * sizeof(float) + sizeof(faiss::idx_t);
+    }
+
+    // Reserved outside index_mutex_: reclaiming cache memory takes it
+    size_t bytes = count * per_vector + metadata_bytes;
+    if (accountant->reserve(MemoryComponent::INSERTS, bytes,
+                            std::chrono::milliseconds(config_.memory_insert_wait_ms), reservation)) {
+        return true;
+    }
+    std::cerr << "Rejecting insert of " << count << " vectors: " << bytes << " bytes do not fit the "
+              << accountant->budget() << " byte memory budget (" << accountant->used() << " used)" << std::endl;
+    return false;
+}
+
+nlohmann::json VectorSearchEngine::get_memory_statistics() const {
+    MemoryAccountant* accountant = memory_accountant_.load(std::memory_order_acquire);
+    if (!accountant) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = accountant->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,1336 @@
+/**
+ * @file metadata_filter.cpp
+ * @brief Typed metadata filters compiled to bytecode over columnar metadata
+ */
+
+#include "metadata_filter.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace neurorag {
+
+namespace {
+
+constexpr double kMissing = std::numeric_limits<double>::quiet_NaN();
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+constexpr int kMaxNesting = 3;   // parent.child.grandchild
+
+bool read_digits(const std::string& text, size_t pos, size_t count, int& value) {
+    if (pos + count > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + count; ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+bool in_set(const std::vector<uint64_t>& bits, uint32_t code) {
+    size_t word = code >> 6;
+    return word < bits.size() && ((bits[word] >> (code & 63)) & 1);
+}
+
+// ---------------------------------------------------------------------------
+// Parser
+// ---------------------------------------------------------------------------
+
+struct FilterSyntaxError {
+    size_t offset;
+    std::string message;
+};
+
+struct Literal {
+    enum class Type { kString, kNumber, kBool } type;
+    std::string text;
+    double number = 0.0;
+    size_t offset = 0;
+};
+
+// Expression tree; leaves carry their instruction, inner nodes are
+// kAnd, kOr and kNot, and kTrue / kFalse are constants
+struct FilterNode {
+    FilterOp op = FilterOp::kTrue;
+    FilterInstruction leaf;
+    std::vector<FilterNode> children;
+};
+
+FilterNode constant_node(bool value) {
+    FilterNode node;
+    node.op = value ? FilterOp::kTrue : FilterOp::kFalse;
+    return node;
+}
+
+FilterNode leaf_node(const FilterInstruction& instruction) {
+    FilterNode node;
+    node.op = instruction.op;
+    node.leaf = instruction;
+    return node;
+}
+
+FilterNode inner_node(FilterOp op, std::vector<FilterNode> children) {
+    FilterNode node;
+    node.op = op;
+    node.children = std::move(children);
+    return node;
+}
+
+bool is_constant(const FilterNode& node) {
+    return node.op == FilterOp::kTrue || node.op == FilterOp::kFalse;
+}
+
+struct ColumnsView {
+    const std::unordered_map<std::string, MetadataColumn*>& by_name;
+    const std::unordered_set<std::string>& fields;
+    size_t count;
+};
+
+/**
+ * Recursive descent over
+ *
+ *   or        := and (OR and)*
+ *   and       := unary (AND unary)*
+ *   unary     := NOT unary | '(' or ')' | predicate
+ *   predicate := field EXISTS
+ *              | field [NOT] IN '(' literal (',' literal)* ')'
+ *              | field [NOT] PREFIX string
+ *              | field [NOT] BETWEEN literal AND literal
+ *              | field op literal
+ *
+ * resolving fields and literals against the columns as it goes.
+ */
+class FilterParser {
+public:
+    FilterParser(const std::string& text, const ColumnsView& columns, std::vector<std::vector<uint64_t>>& sets)
+        : text_(text), columns_(columns), sets_(sets) {}
+
+    FilterNode parse() {
+        FilterNode node = parse_or(0);
+        skip_space();
+        if (pos_ < text_.size()) {
+            fail("unexpected '" + text_.substr(pos_, 16) + "'");
+        }
+        return node;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& message) const { throw FilterSyntaxError{pos_, message}; }
+
+    void skip_space() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            ++pos_;
+        }
+    }
+
+    static bool identifier_char(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+    }
+
+    bool keyword(const char* word) {
+        skip_space();
+        size_t length = std::strlen(word);
+        if (pos_ + length > text_.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (std::toupper(static_cast<unsigned char>(text_[pos_ + i])) != word[i]) {
+                return false;
+            }
+        }
+        if (pos_ + length < text_.size() && identifier_char(text_[pos_ + length])) {
+            return false;
+        }
+        pos_ += length;
+        return true;
+    }
+
+    bool symbol(const char* token) {
+        skip_space();
+        size_t length = std::strlen(token);
+        if (text_.compare(pos_, length, token) != 0) {
+            return false;
+        }
+        pos_ += length;
+        return true;
+    }
+
+    void expect(const char* token) {
+        if (!symbol(token)) {
+            fail(std::string("expected '") + token + "'");
+        }
+    }
+
+    std::string field_name() {
+        skip_space();
+        std::string name;
+        if (pos_ < text_.size() && text_[pos_] == '`') {
+            size_t end = text_.find('`', pos_ + 1);
+            if (end == std::string::npos) {
+                fail("unterminated field name");
+            }
+            name = text_.substr(pos_ + 1, end - pos_ - 1);
+            pos_ = end + 1;
+        } else {
+            size_t start = pos_;
+            while (pos_ < text_.size() && identifier_char(text_[pos_])) {
+                ++pos_;
+            }
+            name = text_.substr(start, pos_ - start);
+        }
+        if (name.empty()) {
+            fail("expected a field name");
+        }
+        return name;
+    }
+
+    Literal literal() {
+        skip_space();
+        Literal value;
+        value.offset = pos_;
+        if (pos_ >= text_.size()) {
+            fail("expected a value");
+        }
+        char quote = text_[pos_];
+        if (quote == '"' || quote == '\'') {
+            value.type = Literal::Type::kString;
+            for (++pos_; pos_ < text_.size() && text_[pos_] != quote; ++pos_) {
+                if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) {
+                    ++pos_;
+                }
+                value.text += text_[pos_];
+            }
+            if (pos_ >= text_.size()) {
+                pos_ = value.offset;
+                fail("unterminated string");
+            }
+            ++pos_;
+            return value;
+        }
+        if (keyword("TRUE") || keyword("FALSE")) {
+            value.type = Literal::Type::kBool;
+            value.number = std::toupper(static_cast<unsigned char>(text_[value.offset])) == 'T' ? 1.0 : 0.0;
+            return value;
+        }
+        const char* start = text_.c_str() + pos_;
+        char* end = nullptr;
+        value.number = std::strtod(start, &end);
+        if (end == start || !std::isfinite(value.number) ||
+            (static_cast<size_t>(end - text_.c_str()) < text_.size() && identifier_char(*end))) {
+            fail("expected a number, string, true or false");
+        }
+        value.type = Literal::Type::kNumber;
+        pos_ = end - text_.c_str();
+        return value;
+    }
+
+    // Number, boolean or date value of a literal in an ordered comparison
+    double ordered_value(const Literal& value) {
+        double number = value.number;
+        if (value.type == Literal::Type::kString && !parse_iso8601(value.text, number)) {
+            pos_ = value.offset;
+            fail("'" + value.text + "' is not a number or ISO-8601 date");
+        }
+        return number;
+    }
+
+    // nullptr when no document has the field yet
+    const MetadataColumn* column(const std::string& field, size_t offset, bool strings) {
+        auto it = columns_.by_name.find(field);
+        const MetadataColumn* found = it == columns_.by_name.end() ? nullptr : it->second;
+        if (!found && !columns_.fields.empty() && !columns_.fields.count(field)) {
+            pos_ = offset;
+            fail("field '" + field + "' is not filterable (see METADATA_FILTER_FIELDS)");
+        }
+        if (!found && columns_.count >= MetadataColumns::kMaxFields) {
+            pos_ = offset;
+            fail("field '" + field + "' is not indexed; only the first " +
+                 std::to_string(MetadataColumns::kMaxFields) + " fields are filterable");
+        }
+        if (found && strings && found->long_strings) {
+            pos_ = offset;
+            fail("field '" + field + "' holds values over " + std::to_string(MetadataColumns::kMaxStringBytes) +
+                 " bytes and cannot be matched as a string");
+        }
+        return found;
+    }
+
+    FilterNode number_range(const MetadataColumn* column, double low, double high) {
+        if (!column || low > high) {
+            return constant_node(false);
+        }
+        FilterInstruction instruction;
+        instruction.op = FilterOp::kNumberRange;
+        instruction.column = column;
+        instruction.low = low;
+        instruction.high = high;
+        return leaf_node(instruction);
+    }
+
+    FilterNode code_set(const MetadataColumn* column, std::vector<uint32_t> codes) {
+        if (!column || codes.empty()) {
+            return constant_node(false);
+        }
+        FilterInstruction instruction;
+        instruction.column = column;
+        if (codes.size() == 1) {
+            instruction.op = FilterOp::kStringEqual;
+            instruction.code = codes[0];
+            return leaf_node(instruction);
+        }
+        uint32_t max_code = *std::max_element(codes.begin(), codes.end());
+        std::vector<uint64_t> bits(max_code / 64 + 1);
+        for (uint32_t code : codes) {
+            bits[code >> 6] |= uint64_t{1} << (code & 63);
+        }
+        instruction.op = FilterOp::kStringIn;
+        instruction.set = static_cast<uint32_t>(sets_.size());
+        sets_.push_back(std::move(bits));
+        return leaf_node(instruction);
+    }
+
+    // A field's value equals the literal: strings by code, others as numbers
+    FilterNode equals(const MetadataColumn* column, const Literal& value) {
+        if (value.type != Literal::Type::kString) {
+            return number_range(column, value.number, value.number);
+        }
+        if (!column) {
+            return constant_node(false);
+        }
+        auto it = column->dictionary.find(value.text);
+        if (it == column->dictionary.end()) {
+            return constant_node(false);
+        }
+        return code_set(column, {it->second});
+    }
+
+    FilterNode exists(const MetadataColumn* column) {
+        if (!column) {
+            return constant_node(false);
+        }
+        FilterInstruction instruction;
+        instruction.op = FilterOp::kExists;
+        instruction.column = column;
+        return leaf_node(instruction);
+    }
+
+    // field present and the predicate false, for NOT IN / PREFIX / BETWEEN
+    FilterNode present_and_not(const MetadataColumn* column, FilterNode predicate) {
+        std::vector<FilterNode> children;
+        children.push_back(exists(column));
+        children.push_back(inner_node(FilterOp::kNot, {std::move(predicate)}));
+        return inner_node(FilterOp::kAnd, std::move(children));
+    }
+
+    FilterNode parse_or(size_t depth) {
+        std::vector<FilterNode> children;
+        children.push_back(parse_and(depth));
+        while (keyword("OR")) {
+            children.push_back(parse_and(depth));
+        }
+        return children.size() == 1 ? std::move(children[0]) : inner_node(FilterOp::kOr, std::move(children));
+    }
+
+    FilterNode parse_and(size_t depth) {
+        std::vector<FilterNode> children;
+        children.push_back(parse_unary(depth));
+        while (keyword("AND")) {
+            children.push_back(parse_unary(depth));
+        }
+        return children.size() == 1 ? std::move(children[0]) : inner_node(FilterOp::kAnd, std::move(children));
+    }
+
+    FilterNode parse_unary(size_t depth) {
+        if (depth >= MetadataFilter::kMaxDepth) {
+            fail("filter nests too deeply");
+        }
+        if (keyword("NOT")) {
+            return inner_node(FilterOp::kNot, {parse_unary(depth + 1)});
+        }
+        if (symbol("(")) {
+            FilterNode node = parse_or(depth + 1);
+            expect(")");
+            return node;
+        }
+        return parse_predicate();
+    }
+
+    FilterNode parse_predicate() {
+        skip_space();
+        size_t offset = pos_;
+        std::string field = field_name();
+
+        if (keyword("EXISTS")) {
+            return exists(column(field, offset, false));
+        }
+        bool negate = keyword("NOT");
+        if (keyword("IN")) {
+            expect("(");
+            std::vector<Literal> values;
+            do {
+                values.push_back(literal());
+            } while (symbol(","));
+            expect(")");
+            bool strings = std::any_of(values.begin(), values.end(),
+                                       [](const Literal& v) { return v.type == Literal::Type::kString; });
+            const MetadataColumn* col = column(field, offset, strings);
+            std::vector<uint32_t> codes;
+            std::vector<FilterNode> alternatives;
+            for (const auto& value : values) {
+                if (value.type != Literal::Type::kString) {
+                    alternatives.push_back(number_range(col, value.number, value.number));
+                } else if (col) {
+                    auto it = col->dictionary.find(value.text);
+                    if (it != col->dictionary.end()) {
+                        codes.push_back(it->second);
+                    }
+                }
+            }
+            alternatives.push_back(code_set(col, std::move(codes)));
+            FilterNode node = inner_node(FilterOp::kOr, std::move(alternatives));
+            return negate ? present_and_not(col, std::move(node)) : node;
+        }
+        if (keyword("PREFIX")) {
+            Literal prefix = literal();
+            if (prefix.type != Literal::Type::kString) {
+                pos_ = prefix.offset;
+                fail("PREFIX takes a string");
+            }
+            const MetadataColumn* col = column(field, offset, true);
+            FilterNode node = constant_node(false);
+            if (col && prefix.text.empty()) {
+                FilterInstruction instruction;
+                instruction.op = FilterOp::kStringNotEqual;
+                instruction.column = col;
+                instruction.code = MetadataColumn::kNoString;
+                node = leaf_node(instruction);
+            } else if (col) {
+                std::vector<uint32_t> codes;
+                for (auto it = col->dictionary.lower_bound(prefix.text);
+                     it != col->dictionary.end() && it->first.compare(0, prefix.text.size(), prefix.text) == 0; ++it) {
+                    codes.push_back(it->second);
+                }
+                node = code_set(col, std::move(codes));
+            }
+            return negate ? present_and_not(col, std::move(node)) : node;
+        }
+        if (keyword("BETWEEN")) {
+            const MetadataColumn* col = column(field, offset, false);
+            double low = ordered_value(literal());
+            if (!keyword("AND")) {
+                fail("expected AND");
+            }
+            double high = ordered_value(literal());
+            FilterNode node = number_range(col, low, high);
+            return negate ? present_and_not(col, std::move(node)) : node;
+        }
+        if (negate) {
+            fail("expected IN, PREFIX or BETWEEN after NOT");
+        }
+
+        static const char* const kOperators[] = {"==", "!=", "<>", "<=", ">=", "=", "<", ">"};
+        std::string op;
+        for (const char* candidate : kOperators) {
+            if (symbol(candidate)) {
+                op = candidate;
+                break;
+            }
+        }
+        if (op.empty()) {
+            fail("expected a comparison, IN, PREFIX, BETWEEN or EXISTS after '" + field + "'");
+        }
+        Literal value = literal();
+
+        if (op == "=" || op == "==") {
+            return equals(column(field, offset, value.type == Literal::Type::kString), value);
+        }
+        if (op == "!=" || op == "<>") {
+            const MetadataColumn* col = column(field, offset, value.type == Literal::Type::kString);
+            if (!col) {
+                return constant_node(false);
+            }
+            FilterInstruction instruction;
+            instruction.column = col;
+            if (value.type == Literal::Type::kString) {
+                // A string no document has leaves "any string"
+                auto it = col->dictionary.find(value.text);
+                instruction.op = FilterOp::kStringNotEqual;
+                instruction.code = it == col->dictionary.end() ? MetadataColumn::kNoString : it->second;
+            } else {
+                instruction.op = FilterOp::kNumberNotEqual;
+                instruction.low = value.number;
+            }
+            return leaf_node(instruction);
+        }
+
+        const MetadataColumn* col = column(field, offset, false);
+        double number = ordered_value(value);
+        if (op == "<") {
+            return number_range(col, -kInfinity, std::nextafter(number, -kInfinity));
+        }
+        if (op == "<=") {
+            return number_range(col, -kInfinity, number);
+        }
+        if (op == ">") {
+            return number_range(col, std::nextafter(number, kInfinity), kInfinity);
+        }
+        return number_range(col, number, kInfinity);
+    }
+
+    const std::string& text_;
+    const ColumnsView& columns_;
+    std::vector<std::vector<uint64_t>>& sets_;
+    size_t pos_ = 0;
+};
+
+// Fold constants, flatten nested AND / OR and cancel double negation
+void fold(FilterNode& node) {
+    if (node.op == FilterOp::kNot) {
+        fold(node.children[0]);
+        FilterNode child = std::move(node.children[0]);
+        if (is_constant(child)) {
+            node = constant_node(child.op == FilterOp::kFalse);
+        } else if (child.op == FilterOp::kNot) {
+            node = std::move(child.children[0]);
+        } else {
+            node.children[0] = std::move(child);
+        }
+        return;
+    }
+    if (node.op != FilterOp::kAnd && node.op != FilterOp::kOr) {
+        return;
+    }
+    bool is_and = node.op == FilterOp::kAnd;
+    std::vector<FilterNode> children;
+    for (auto& child : node.children) {
+        fold(child);
+        if (is_constant(child)) {
+            if ((child.op == FilterOp::kTrue) != is_and) {
+                node = constant_node(!is_and);   // false AND x, true OR x
+                return;
+            }
+            continue;                            // true AND x, false OR x
+        }
+        if (child.op == node.op) {
+            for (auto& grandchild : child.children) {
+                children.push_back(std::move(grandchild));
+            }
+        } else {
+            children.push_back(std::move(child));
+        }
+    }
+    if (is_and) {
+        // Ranges on one field intersect into one instruction (a date window)
+        for (size_t i = 0; i < children.size(); ++i) {
+            FilterInstruction& range = children[i].leaf;
+            if (children[i].op != FilterOp::kNumberRange) {
+                continue;
+            }
+            for (size_t j = i + 1; j < children.size();) {
+                const FilterInstruction& other = children[j].leaf;
+                if (children[j].op == FilterOp::kNumberRange && other.column == range.column) {
+                    range.low = std::max(range.low, other.low);
+                    range.high = std::min(range.high, other.high);
+                    children.erase(children.begin() + j);
+                } else {
+                    ++j;
+                }
+            }
+            if (range.low > range.high) {
+                node = constant_node(false);
+                return;
+            }
+        }
+    }
+    if (children.empty()) {
+        node = constant_node(is_and);
+    } else if (children.size() == 1) {
+        FilterNode only = std::move(children[0]);
+        node = std::move(only);
+    } else {
+        node.children = std::move(children);
+    }
+}
+
+void emit(const FilterNode& node, std::vector<FilterInstruction>& program, size_t depth, size_t& max_depth) {
+    max_depth = std::max(max_depth, depth + 1);
+    if (node.op == FilterOp::kNot) {
+        emit(node.children[0], program, depth, max_depth);
+        FilterInstruction instruction;
+        instruction.op = FilterOp::kNot;
+        program.push_back(instruction);
+        return;
+    }
+    if (node.op == FilterOp::kAnd || node.op == FilterOp::kOr) {
+        emit(node.children[0], program, depth, max_depth);
+        for (size_t i = 1; i < node.children.size(); ++i) {
+            emit(node.children[i], program, depth + 1, max_depth);
+            FilterInstruction instruction;
+            instruction.op = node.op;
+            program.push_back(instruction);
+        }
+        return;
+    }
+    if (is_constant(node)) {
+        FilterInstruction instruction;
+        instruction.op = node.op;
+        program.push_back(instruction);
+        return;
+    }
+    program.push_back(node.leaf);
+}
+
+std::string format_number(double value) {
+    if (std::isinf(value)) {
+        return value > 0 ? "inf" : "-inf";
+    }
+    std::ostringstream out;
+    out.precision(17);
+    out << value;
+    return out.str();
+}
+
+} // namespace
+
+bool parse_iso8601(const std::string& text, double& seconds) {
+    int year, month, day;
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-' ||
+        !read_digits(text, 0, 4, year) || !read_digits(text, 5, 2, month) || !read_digits(text, 8, 2, day) ||
+        month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    int hour = 0, minute = 0, second = 0;
+    double fraction = 0.0;
+    int offset_minutes = 0;
+    size_t pos = 10;
+    if (pos < text.size()) {
+        if ((text[pos] != 'T' && text[pos] != 't' && text[pos] != ' ') ||
+            !read_digits(text, pos + 1, 2, hour) || text.size() < pos + 6 || text[pos + 3] != ':' ||
+            !read_digits(text, pos + 4, 2, minute) || hour > 23 || minute > 59) {
+            return false;
+        }
+        pos += 6;
+        if (pos < text.size() && text[pos] == ':') {
+            if (!read_digits(text, pos + 1, 2, second) || second > 60) {
+                return false;
+            }
+            pos += 3;
+            if (pos < text.size() && (text[pos] == '.' || text[pos] == ',')) {
+                double scale = 0.1;
+                for (++pos; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos) {
+                    fraction += (text[pos] - '0') * scale;
+                    scale *= 0.1;
+                }
+            }
+        }
+        if (pos < text.size() && (text[pos] == 'Z' || text[pos] == 'z')) {
+            ++pos;
+        } else if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            int offset_hours, offset_mins = 0;
+            if (!read_digits(text, pos + 1, 2, offset_hours)) {
+                return false;
+            }
+            size_t minutes_at = pos + 3 < text.size() && text[pos + 3] == ':' ? pos + 4 : pos + 3;
+            if (minutes_at < text.size() && !read_digits(text, minutes_at, 2, offset_mins)) {
+                return false;
+            }
+            offset_minutes = (offset_hours * 60 + offset_mins) * (text[pos] == '-' ? -1 : 1);
+            pos = minutes_at < text.size() ? minutes_at + 2 : text.size();
+        }
+        if (pos != text.size()) {
+            return false;
+        }
+    }
+    int64_t days = days_from_civil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+    seconds = static_cast<double>(days * 86400 + hour * 3600 + minute * 60 + second - offset_minutes * 60) + fraction;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ChunkedColumn
+// ---------------------------------------------------------------------------
+
+template <typename T>
+void ChunkedColumn<T>::set(int64_t row, T value) {
+    size_t chunk = static_cast<size_t>(row) >> kChunkBits;
+    const Directory* current = directory_.load(std::memory_order_relaxed);
+    if (!current || chunk >= current->capacity) {
+        size_t capacity = current ? current->capacity : 16;
+        while (capacity <= chunk) {
+            capacity *= 2;
+        }
+        auto grown = std::make_unique<Directory>();
+        grown->capacity = capacity;
+        grown->chunks.reset(new std::atomic<std::atomic<T>*>[capacity]);
+        for (size_t i = 0; i < capacity; ++i) {
+            std::atomic<T>* values = current && i < current->capacity
+                ? current->chunks[i].load(std::memory_order_relaxed) : nullptr;
+            grown->chunks[i].store(values, std::memory_order_relaxed);
+        }
+        current = grown.get();
+        // Readers may still hold the previous directory; it is kept
+        directories_.push_back(std::move(grown));
+        directory_.store(current, std::memory_order_release);
+    }
+    std::atomic<T>* values = current->chunks[chunk].load(std::memory_order_relaxed);
+    if (!values) {
+        allocated_.emplace_back(new std::atomic<T>[kChunkRows]);
+        values = allocated_.back().get();
+        for (size_t i = 0; i < kChunkRows; ++i) {
+            values[i].store(missing_, std::memory_order_relaxed);
+        }
+        current->chunks[chunk].store(values, std::memory_order_release);
+    }
+    values[row & (kChunkRows - 1)].store(value, std::memory_order_relaxed);
+}
+
+template <typename T>
+void ChunkedColumn<T>::clear(int64_t row) {
+    const Directory* current = directory_.load(std::memory_order_relaxed);
+    size_t chunk = static_cast<size_t>(row) >> kChunkBits;
+    if (current && chunk < current->capacity) {
+        if (std::atomic<T>* values = current->chunks[chunk].load(std::memory_order_relaxed)) {
+            values[row & (kChunkRows - 1)].store(missing_, std::memory_order_relaxed);
+        }
+    }
+}
+
+template class ChunkedColumn<uint32_t>;
+template class ChunkedColumn<double>;
+
+// ---------------------------------------------------------------------------
+// MetadataColumns
+// ---------------------------------------------------------------------------
+
+MetadataColumns::MetadataColumns(const std::vector<std::string>& fields)
+    : fields_(fields.begin(), fields.end()) {}
+
+MetadataColumn* MetadataColumns::column(const std::string& field, bool create) {
+    auto it = by_name_.find(field);
+    if (it != by_name_.end()) {
+        return it->second;
+    }
+    if (!create || (!fields_.empty() && !fields_.count(field)) || columns_.size() >= kMaxFields) {
+        return nullptr;
+    }
+    columns_.push_back(std::make_unique<MetadataColumn>(field));
+    by_name_.emplace(field, columns_.back().get());
+    return columns_.back().get();
+}
+
+void MetadataColumns::set(int64_t row, const std::string& metadata) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    set_locked(row, metadata);
+}
+
+void MetadataColumns::set(int64_t first_row, const std::vector<std::string>& metadata) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < metadata.size(); ++i) {
+        set_locked(first_row + static_cast<int64_t>(i), metadata[i]);
+    }
+}
+
+void MetadataColumns::set_locked(int64_t row, const std::string& metadata) {
+    if (row < 0) {
+        return;
+    }
+    if (static_cast<size_t>(row) < rows_.load(std::memory_order_relaxed)) {
+        for (auto& column : columns_) {
+            column->codes.clear(row);
+            column->numbers.clear(row);
+        }
+    }
+    if (!metadata.empty() && metadata[0] == '{') {
+        auto document = nlohmann::json::parse(metadata, nullptr, false);
+        if (document.is_object()) {
+            for (auto it = document.begin(); it != document.end(); ++it) {
+                set_value(row, it.key(), it.value(), 0);
+            }
+        }
+    }
+    if (static_cast<size_t>(row) >= rows_.load(std::memory_order_relaxed)) {
+        rows_.store(static_cast<size_t>(row) + 1, std::memory_order_release);
+    }
+}
+
+void MetadataColumns::set_value(int64_t row, const std::string& field, const nlohmann::json& value, int depth) {
+    if (value.is_object()) {
+        if (depth < kMaxNesting - 1) {
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                set_value(row, field + "." + it.key(), it.value(), depth + 1);
+            }
+        }
+        return;
+    }
+    if (value.is_null()) {
+        return;
+    }
+    MetadataColumn* target = column(field, true);
+    if (!target) {
+        return;
+    }
+    if (value.is_array()) {
+        target->arrays = true;
+    } else if (value.is_boolean()) {
+        target->numbers.set(row, value.get<bool>() ? 1.0 : 0.0);
+    } else if (value.is_number()) {
+        target->numbers.set(row, value.get<double>());
+    } else if (value.is_string()) {
+        const auto& text = value.get_ref<const std::string&>();
+        double seconds;
+        if (parse_iso8601(text, seconds)) {
+            target->numbers.set(row, seconds);
+        }
+        if (target->long_strings) {
+            return;
+        }
+        if (text.size() > kMaxStringBytes) {
+            // Free text (a chunk's content); a dictionary of it would
+            // duplicate the metadata
+            target->long_strings = true;
+            std::map<std::string, uint32_t>().swap(target->dictionary);
+            std::vector<const std::string*>().swap(target->strings);
+            target->string_bytes = 0;
+            return;
+        }
+        auto inserted = target->dictionary.emplace(text, static_cast<uint32_t>(target->dictionary.size() + 1));
+        if (inserted.second) {
+            target->string_bytes += text.size();
+            target->strings.push_back(&inserted.first->first);
+        }
+        target->codes.set(row, inserted.first->second);
+    }
+}
+
+size_t MetadataColumns::memory_bytes() const {
+    // A std::map node holds the string, the code and three pointers
+    constexpr size_t kNodeBytes = sizeof(std::string) + 4 * sizeof(void*) + sizeof(uint32_t);
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = 0;
+    for (const auto& column : columns_) {
+        bytes += column->codes.memory_bytes() + column->numbers.memory_bytes();
+        bytes += column->dictionary.size() * kNodeBytes + column->string_bytes;
+        bytes += column->strings.capacity() * sizeof(const std::string*);
+    }
+    return bytes;
+}
+
+bool MetadataColumns::string_values(const std::string& field, const int64_t* rows, size_t n,
+                                    std::vector<std::string>& values) const {
+    values.assign(n, std::string());
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_name_.find(field);
+    if (it == by_name_.end() || it->second->long_strings) {
+        return false;
+    }
+    const MetadataColumn& column = *it->second;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t code = column.codes.get(rows[i]);
+        if (code != MetadataColumn::kNoString && code <= column.strings.size()) {
+            values[i] = *column.strings[code - 1];
+        }
+    }
+    return true;
+}
+
+const ChunkedColumn<double>* MetadataColumns::numbers(const std::string& field) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_name_.find(field);
+    return it == by_name_.end() ? nullptr : &it->second->numbers;
+}
+
+nlohmann::json MetadataColumns::get_statistics() const {
+    nlohmann::json fields = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& column : columns_) {
+            nlohmann::json field;
+            field["name"] = column->name;
+            field["strings"] = column->dictionary.size();
+            field["column_bytes"] = column->codes.memory_bytes() + column->numbers.memory_bytes();
+            if (column->long_strings) {
+                field["long_strings"] = true;
+            }
+            if (column->arrays) {
+                field["arrays"] = true;
+            }
+            fields.push_back(std::move(field));
+        }
+    }
+    nlohmann::json stats;
+    stats["rows"] = rows();
+    stats["fields"] = std::move(fields);
+    stats["max_fields"] = kMaxFields;
+    stats["restricted"] = !fields_.empty();
+    stats["memory_bytes"] = memory_bytes();
+    stats["filters_compiled"] = filters_compiled_.load();
+    stats["filters_rejected"] = filters_rejected_.load();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// MetadataFilter
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<MetadataFilter> MetadataFilter::compile(
+        const std::string& expression,
+        const std::unordered_map<std::string, std::string>& equalities,
+        std::shared_ptr<const MetadataColumns> columns,
+        std::string& error) {
+    std::unique_ptr<MetadataFilter> filter(new MetadataFilter());
+    FilterNode root;
+    {
+        std::lock_guard<std::mutex> lock(columns->mutex_);
+        ColumnsView view{columns->by_name_, columns->fields_, columns->columns_.size()};
+        std::vector<FilterNode> conjuncts;
+        if (!expression.empty()) {
+            try {
+                conjuncts.push_back(FilterParser(expression, view, filter->sets_).parse());
+            } catch (const FilterSyntaxError& e) {
+                error = "filter offset " + std::to_string(e.offset) + ": " + e.message;
+                columns->filters_rejected_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        for (const auto& [field, value] : equalities) {
+            // The old map syntax has untyped values: "2020" matches the
+            // string or the number, "true" the string or the boolean
+            std::string alternatives = "`" + field + "` = \"";
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    alternatives += '\\';
+                }
+                alternatives += c;
+            }
+            alternatives += '"';
+            char* end = nullptr;
+            double number = std::strtod(value.c_str(), &end);
+            if (!value.empty() && end == value.c_str() + value.size() && std::isfinite(number)) {
+                alternatives += " OR `" + field + "` = " + value;
+            } else if (value == "true" || value == "false") {
+                alternatives += " OR `" + field + "` = " + value;
+            }
+            try {
+                conjuncts.push_back(FilterParser(alternatives, view, filter->sets_).parse());
+            } catch (const FilterSyntaxError& e) {
+                error = "filter on '" + field + "': " + e.message;
+                columns->filters_rejected_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        root = conjuncts.size() == 1 ? std::move(conjuncts[0]) : inner_node(FilterOp::kAnd, std::move(conjuncts));
+    }
+
+    fold(root);
+    emit(root, filter->program_, 0, filter->depth_);
+    if (filter->depth_ > kMaxDepth) {
+        error = "filter needs " + std::to_string(filter->depth_) + " stack slots, at most " +
+                std::to_string(kMaxDepth) + " are supported";
+        columns->filters_rejected_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    columns->filters_compiled_.fetch_add(1, std::memory_order_relaxed);
+    filter->columns_ = std::move(columns);
+    return filter;
+}
+
+bool MetadataFilter::is_member(faiss::idx_t id) const {
+    // The operand stack is the bits of one word, top in bit 0
+    uint64_t stack = 0;
+    for (const auto& instruction : program_) {
+        uint64_t value = 0;
+        switch (instruction.op) {
+            case FilterOp::kTrue:
+                value = 1;
+                break;
+            case FilterOp::kFalse:
+                break;
+            case FilterOp::kNumberRange: {
+                double number = instruction.column->numbers.get(id);
+                value = number >= instruction.low && number <= instruction.high;
+                break;
+            }
+            case FilterOp::kNumberNotEqual: {
+                double number = instruction.column->numbers.get(id);
+                value = number == number && number != instruction.low;
+                break;
+            }
+            case FilterOp::kStringEqual:
+                value = instruction.column->codes.get(id) == instruction.code;
+                break;
+            case FilterOp::kStringNotEqual: {
+                uint32_t code = instruction.column->codes.get(id);
+                value = code != MetadataColumn::kNoString && code != instruction.code;
+                break;
+            }
+            case FilterOp::kStringIn:
+                value = in_set(sets_[instruction.set], instruction.column->codes.get(id));
+                break;
+            case FilterOp::kExists: {
+                double number = instruction.column->numbers.get(id);
+                value = instruction.column->codes.get(id) != MetadataColumn::kNoString || number == number;
+                break;
+            }
+            case FilterOp::kAnd:
+                stack = (stack >> 1) & (~uint64_t{1} | stack);
+                continue;
+            case FilterOp::kOr:
+                stack = (stack >> 1) | (stack & 1);
+                continue;
+            case FilterOp::kNot:
+                stack ^= 1;
+                continue;
+        }
+        stack = (stack << 1) | value;
+    }
+    return stack & 1;
+}
+
+void MetadataFilter::evaluate_batch(const int64_t* ids, size_t n, uint8_t* stack) const {
+    // One row of kBatchSize flags per stack slot
+    size_t depth = 0;
+    for (const auto& instruction : program_) {
+        if (instruction.op == FilterOp::kAnd || instruction.op == FilterOp::kOr) {
+            uint8_t* lhs = stack + (depth - 2) * kBatchSize;
+            const uint8_t* rhs = lhs + kBatchSize;
+            if (instruction.op == FilterOp::kAnd) {
+                for (size_t i = 0; i < n; ++i) {
+                    lhs[i] &= rhs[i];
+                }
+            } else {
+                for (size_t i = 0; i < n; ++i) {
+                    lhs[i] |= rhs[i];
+                }
+            }
+            --depth;
+            continue;
+        }
+        if (instruction.op == FilterOp::kNot) {
+            uint8_t* top = stack + (depth - 1) * kBatchSize;
+            for (size_t i = 0; i < n; ++i) {
+                top[i] ^= 1;
+            }
+            continue;
+        }
+
+        uint8_t* top = stack + depth * kBatchSize;
+        ++depth;
+        const MetadataColumn* column = instruction.column;
+        auto* numbers = column ? column->numbers.directory() : nullptr;
+        auto* codes = column ? column->codes.directory() : nullptr;
+        switch (instruction.op) {
+            case FilterOp::kTrue:
+            case FilterOp::kFalse:
+                std::memset(top, instruction.op == FilterOp::kTrue, n);
+                break;
+            case FilterOp::kNumberRange:
+                for (size_t i = 0; i < n; ++i) {
+                    double number = ChunkedColumn<double>::get(numbers, ids[i], kMissing);
+                    top[i] = number >= instruction.low && number <= instruction.high;
+                }
+                break;
+            case FilterOp::kNumberNotEqual:
+                for (size_t i = 0; i < n; ++i) {
+                    double number = ChunkedColumn<double>::get(numbers, ids[i], kMissing);
+                    top[i] = number == number && number != instruction.low;
+                }
+                break;
+            case FilterOp::kStringEqual:
+                for (size_t i = 0; i < n; ++i) {
+                    top[i] = ChunkedColumn<uint32_t>::get(codes, ids[i], MetadataColumn::kNoString) == instruction.code;
+                }
+                break;
+            case FilterOp::kStringNotEqual:
+                for (size_t i = 0; i < n; ++i) {
+                    uint32_t code = ChunkedColumn<uint32_t>::get(codes, ids[i], MetadataColumn::kNoString);
+                    top[i] = code != MetadataColumn::kNoString && code != instruction.code;
+                }
+                break;
+            case FilterOp::kStringIn: {
+                const auto& set = sets_[instruction.set];
+                for (size_t i = 0; i < n; ++i) {
+                    top[i] = in_set(set, ChunkedColumn<uint32_t>::get(codes, ids[i], MetadataColumn::kNoString));
+                }
+                break;
+            }
+            case FilterOp::kExists:
+                for (size_t i = 0; i < n; ++i) {
+                    double number = ChunkedColumn<double>::get(numbers, ids[i], kMissing);
+                    uint32_t code = ChunkedColumn<uint32_t>::get(codes, ids[i], MetadataColumn::kNoString);
+                    top[i] = code != MetadataColumn::kNoString || number == number;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+size_t MetadataFilter::evaluate(const int64_t* ids, size_t n, uint8_t* keep) const {
+    std::vector<uint8_t> stack(depth_ * kBatchSize);
+    size_t passed = 0;
+    for (size_t first = 0; first < n; first += kBatchSize) {
+        size_t count = std::min(kBatchSize, n - first);
+        evaluate_batch(ids + first, count, stack.data());
+        for (size_t i = 0; i < count; ++i) {
+            keep[first + i] = stack[i];
+            passed += stack[i];
+        }
+    }
+    return passed;
+}
+
+size_t MetadataFilter::evaluate_range(int64_t first, size_t count, uint64_t* bitmap) const {
+    std::fill(bitmap, bitmap + (count + 63) / 64, 0);
+    std::vector<uint8_t> stack(depth_ * kBatchSize);
+    int64_t ids[kBatchSize];
+    size_t passed = 0;
+    for (size_t start = 0; start < count; start += kBatchSize) {
+        size_t n = std::min(kBatchSize, count - start);
+        for (size_t i = 0; i < n; ++i) {
+            ids[i] = first + static_cast<int64_t>(start + i);
+        }
+        evaluate_batch(ids, n, stack.data());
+        for (size_t i = 0; i < n; ++i) {
+            bitmap[(start + i) >> 6] |= uint64_t{stack[i]} << ((start + i) & 63);
+            passed += stack[i];
+        }
+    }
+    return passed;
+}
+
+bool MetadataFilter::required_strings(const std::string& field, std::vector<std::string>& values,
+                                      bool& exact) const {
+    values.clear();
+    exact = false;
+    if (program_.empty()) {
+        return false;
+    }
+    bool constant;
+    if (is_constant(constant)) {
+        exact = !constant;
+        return !constant;
+    }
+
+    // Start of the subtree that ends at each instruction
+    std::vector<size_t> begin(program_.size());
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < program_.size(); ++i) {
+        FilterOp op = program_[i].op;
+        if (op == FilterOp::kAnd || op == FilterOp::kOr) {
+            starts.pop_back();
+            begin[i] = starts.back();
+        } else if (op == FilterOp::kNot) {
+            begin[i] = starts.back();
+        } else {
+            begin[i] = i;
+            starts.push_back(i);
+        }
+    }
+
+    // AND chains are emitted left-deep: left subtree, right subtree, kAnd
+    std::vector<size_t> conjuncts;
+    std::vector<size_t> pending = {program_.size() - 1};
+    while (!pending.empty()) {
+        size_t end = pending.back();
+        pending.pop_back();
+        if (program_[end].op == FilterOp::kAnd) {
+            size_t right = end - 1;
+            pending.push_back(right);
+            pending.push_back(begin[right] - 1);
+        } else {
+            conjuncts.push_back(end);
+        }
+    }
+
+    std::vector<uint64_t> codes;   // Bitmap of the codes every restriction allows
+    bool restricted = false;
+    const MetadataColumn* column = nullptr;
+    size_t others = 0;
+    for (size_t end : conjuncts) {
+        const FilterInstruction& instruction = program_[end];
+        bool leaf = begin[end] == end;
+        if (!leaf || !instruction.column || instruction.column->name != field ||
+            (instruction.op != FilterOp::kStringEqual && instruction.op != FilterOp::kStringIn)) {
+            ++others;
+            continue;
+        }
+        std::vector<uint64_t> allowed;
+        if (instruction.op == FilterOp::kStringEqual) {
+            allowed.resize(instruction.code / 64 + 1);
+            allowed[instruction.code >> 6] |= uint64_t{1} << (instruction.code & 63);
+        } else {
+            allowed = sets_[instruction.set];
+        }
+        if (!restricted) {
+            codes = std::move(allowed);
+            restricted = true;
+        } else {
+            codes.resize(std::min(codes.size(), allowed.size()));
+            for (size_t w = 0; w < codes.size(); ++w) {
+                codes[w] &= allowed[w];
+            }
+        }
+        column = instruction.column;
+    }
+    if (!restricted) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(columns_->mutex_);
+    for (size_t w = 0; w < codes.size(); ++w) {
+        for (uint64_t bits = codes[w]; bits; bits &= bits - 1) {
+            size_t code = w * 64 + __builtin_ctzll(bits);
+            if (code != MetadataColumn::kNoString && code <= column->strings.size()) {
+                values.push_back(*column->strings[code - 1]);
+            }
+        }
+    }
+    exact = others == 0;
+    return true;
+}
+
+bool MetadataFilter::is_constant(bool& value) const {
+    if (program_.size() == 1 && (program_[0].op == FilterOp::kTrue || program_[0].op == FilterOp::kFalse)) {
+        value = program_[0].op == FilterOp::kTrue;
+        return true;
+    }
+    return false;
+}
+
+nlohmann::json MetadataFilter::describe() const {
+    nlohmann::json program = nlohmann::json::array();
+    for (const auto& instruction : program_) {
+        std::string field = instruction.column ? " " + instruction.column->name : "";
+        switch (instruction.op) {
+            case FilterOp::kTrue: program.push_back("true"); break;
+            case FilterOp::kFalse: program.push_back("false"); break;
+            case FilterOp::kNumberRange:
+                program.push_back("number_range" + field + " [" + format_number(instruction.low) + ", " +
+                                  format_number(instruction.high) + "]");
+                break;
+            case FilterOp::kNumberNotEqual:
+                program.push_back("number_not_equal" + field + " " + format_number(instruction.low));
+                break;
+            case FilterOp::kStringEqual:
+                program.push_back("string_equal" + field + " #" + std::to_string(instruction.code));
+                break;
+            case FilterOp::kStringNotEqual:
+                program.push_back("string_not_equal" + field + " #" + std::to_string(instruction.code));
+                break;
+            case FilterOp::kStringIn: {
+                size_t codes = 0;
+                for (uint64_t word : sets_[instruction.set]) {
+                    codes += std::bitset<64>(word).count();
+                }
+                program.push_back("string_in" + field + " {" + std::to_string(codes) + " codes}");
+                break;
+            }
+            case FilterOp::kExists: program.push_back("exists" + field); break;
+            case FilterOp::kAnd: program.push_back("and"); break;
+            case FilterOp::kOr: program.push_back("or"); break;
+            case FilterOp::kNot: program.push_back("not"); break;
+        }
+    }
+    return program;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+size_t VectorSearchEngine::rebuild_metadata_columns() {
+    std::vector<std::string> fields;
+    std::stringstream list(config_.metadata_filter_fields);
+    for (std::string field; std::getline(list, field, ',');) {
+        field.erase(0, field.find_first_not_of(" \t"));
+        field.erase(field.find_last_not_of(" \t") + 1);
+        if (!field.empty()) {
+            fields.push_back(field);
+        }
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    auto columns = std::make_shared<MetadataColumns>(fields);
+    {
+        // Inserts index their documents under metadata_mutex_, so none is
+        // lost between the copy and the switch
+        std::lock_guard<std::mutex> lock(metadata_mutex_);
+        columns->set(0, metadata_);
+        std::atomic_store(&metadata_columns_, columns);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Indexed metadata of " << columns->rows() << " documents for filtering in "
+              << seconds << " s (" << columns->memory_bytes() / (1024 * 1024) << " MB)" << std::endl;
+    return columns->rows();
+}
+
+std::unique_ptr<MetadataFilter> VectorSearchEngine::compile_filter(const SearchRequest& request,
+                                                                   std::string& error) const {
+    if (request.filter.empty() && request.filters.empty()) {
+        return nullptr;
+    }
+    std::shared_ptr<const MetadataColumns> columns = std::atomic_load(&metadata_columns_);
+    if (!columns) {
+        error = "metadata filters are not available until the metadata is indexed";
+        return nullptr;
+    }
+    return MetadataFilter::compile(request.filter, request.filters, std::move(columns), error);
+}
+
+nlohmann::json VectorSearchEngine::explain_filter(const std::string& expression) const {
+    SearchRequest request;
+    request.filter = expression;
+    std::string error;
+    auto filter = compile_filter(request, error);
+    if (!filter) {
+        return {{"valid", false}, {"error", error.empty() ? "empty filter" : error}};
+    }
+
+    size_t rows = std::atomic_load(&metadata_columns_)->rows();
+    std::vector<uint64_t> bitmap((rows + 63) / 64);
+    auto start_time = std::chrono::steady_clock::now();
+    size_t matches = filter->evaluate_range(0, rows, bitmap.data());
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+
+    nlohmann::json result;
+    result["valid"] = true;
+    result["program"] = filter->describe();
+    result["rows"] = rows;
+    result["matches"] = matches;
+    result["selectivity"] = rows > 0 ? static_cast<double>(matches) / rows : 0.0;
+    result["ns_per_row"] = rows > 0 ? ns / rows : 0.0;
+    return result;
+}
+
+nlohmann::json VectorSearchEngine::get_metadata_column_statistics() const {
+    auto columns = std::atomic_load(&metadata_columns_);
+    if (!columns) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = columns->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,197 @@
+/**
+ * @file micro_batcher.cpp
+ * @brief Request micro-batching in front of VectorSearchEngine::batch_search
+ */
+
+#include "micro_batcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace neurorag {
+
+MicroBatcher::MicroBatcher(VectorSearchEngine* engine,
+                           size_t max_batch_size,
+                           std::chrono::microseconds max_wait,
+                           int num_dispatchers)
+    : engine_(engine),
+      max_batch_size_(std::max<size_t>(1, max_batch_size)),
+      max_wait_(max_wait),
+      num_dispatchers_(std::max(1, num_dispatchers)),
+      running_(false),
+      batches_dispatched_(0),
+      requests_dispatched_(0),
+      full_batches_(0) {}
+
+MicroBatcher::~MicroBatcher() {
+    stop();
+}
+
+void MicroBatcher::start() {
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+
+    for (int i = 0; i < num_dispatchers_; ++i) {
+        dispatchers_.emplace_back(&MicroBatcher::dispatcher_loop, this);
+    }
+}
+
+void MicroBatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    }
+    queue_condition_.notify_all();
+
+    for (auto& thread : dispatchers_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    dispatchers_.clear();
+
+    // Fail whatever was still queued so no caller waits forever
+    std::deque<Pending> leftovers;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        leftovers.swap(queue_);
+    }
+    SearchResult empty{};
+    for (auto& pending : leftovers) {
+        pending.done(empty, "batcher stopped");
+        discharge(pending.charged_bytes);
+    }
+}
+
+bool MicroBatcher::submit(SearchRequest request, Completion done) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!running_.load()) {
+            return false;
+        }
+        size_t bytes = 0;
+        if (MemoryAccountant* accountant = memory_accountant_.load(std::memory_order_acquire)) {
+            bytes = sizeof(Pending) + request.query_vector.capacity() * sizeof(float);
+            accountant->charge(MemoryComponent::REQUESTS, bytes);
+        }
+        queue_.push_back({std::move(request), std::move(done), std::chrono::steady_clock::now(), bytes});
+    }
+    queue_condition_.notify_one();
+    return true;
+}
+
+size_t MicroBatcher::queue_depth() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return queue_.size();
+}
+
+void MicroBatcher::set_memory_accountant(MemoryAccountant* accountant) {
+    memory_accountant_.store(accountant, std::memory_order_release);
+}
+
+void MicroBatcher::discharge(size_t bytes) {
+    MemoryAccountant* accountant = memory_accountant_.load(std::memory_order_acquire);
+    if (accountant && bytes > 0) {
+        accountant->discharge(MemoryComponent::REQUESTS, bytes);
+    }
+}
+
+nlohmann::json MicroBatcher::get_statistics() const {
+    uint64_t batches = batches_dispatched_.load();
+    uint64_t requests = requests_dispatched_.load();
+
+    nlohmann::json stats;
+    stats["batches_dispatched"] = batches;
+    stats["requests_dispatched"] = requests;
+    stats["full_batches"] = full_batches_.load();
+    stats["average_batch_size"] = batches > 0 ? static_cast<double>(requests) / batches : 0.0;
+    stats["queue_depth"] = queue_depth();
+    stats["max_batch_size"] = max_batch_size_;
+    stats["max_wait_us"] = max_wait_.count();
+    return stats;
+}
+
+void MicroBatcher::dispatcher_loop() {
+    std::vector<Pending> batch;
+    batch.reserve(max_batch_size_);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_condition_.wait(lock, [this] { return !running_.load() || !queue_.empty(); });
+
+            if (!running_.load()) {
+                return;
+            }
+
+            // The oldest request bounds how long we may keep collecting
+            auto deadline = queue_.front().enqueued_at + max_wait_;
+            while (queue_.size() < max_batch_size_ && running_.load()) {
+                if (queue_condition_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                    break;
+                }
+                if (queue_.empty()) {
+                    // Another dispatcher took the batch while we waited
+                    break;
+                }
+            }
+
+            size_t take = std::min(queue_.size(), max_batch_size_);
+            for (size_t i = 0; i < take; ++i) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+
+        if (!batch.empty()) {
+            execute_batch(batch);
+            batch.clear();
+        }
+    }
+}
+
+void MicroBatcher::execute_batch(std::vector<Pending>& batch) {
+    std::vector<SearchRequest> requests;
+    requests.reserve(batch.size());
+    for (auto& pending : batch) {
+        requests.push_back(std::move(pending.request));
+    }
+
+    batches_dispatched_.fetch_add(1, std::memory_order_relaxed);
+    requests_dispatched_.fetch_add(batch.size(), std::memory_order_relaxed);
+    if (batch.size() == max_batch_size_) {
+        full_batches_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<SearchResult> results;
+    std::string error;
+    try {
+        results = engine_->batch_search(requests);
+        if (results.size() != batch.size()) {
+            error = "batch_search returned " + std::to_string(results.size()) +
+                    " results for " + std::to_string(batch.size()) + " requests";
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+
+    SearchResult empty{};
+    for (size_t i = 0; i < batch.size(); ++i) {
+        try {
+            if (error.empty()) {
+                batch[i].done(results[i], error);
+            } else {
+                batch[i].done(empty, error);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "MicroBatcher completion threw: " << e.what() << std::endl;
+        }
+        discharge(batch[i].charged_bytes);
+    }
+}
+
+} // namespace neurorag
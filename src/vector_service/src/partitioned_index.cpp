@@ -0,0 +1,521 @@
+/**
+ * @file partitioned_index.cpp
+ * @brief Per-value sub-indexes for a high-cardinality filter field
+ */
+
+#include "partitioned_index.h"
+#include "metadata_filter.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <unordered_set>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/impl/IDSelector.h>
+
+namespace neurorag {
+
+namespace {
+
+constexpr int kHnswM = 32;
+constexpr int kHnswEfConstruction = 100;
+constexpr int kHnswEfSearch = 64;
+constexpr size_t kLargestReported = 10;
+// Rows gathered per pass when partitions are rebuilt from the serving index
+constexpr size_t kRebuildBatch = 1 << 20;
+
+// A partition's stored vectors, flat or under its HNSW graph
+const float* partition_vectors(const faiss::Index& index) {
+    if (auto* hnsw = dynamic_cast<const faiss::IndexHNSW*>(&index)) {
+        return static_cast<const faiss::IndexFlat*>(hnsw->storage)->get_xb();
+    }
+    return static_cast<const faiss::IndexFlat&>(index).get_xb();
+}
+
+// Live local ids of a partition, optionally also passing the filter
+class LocalFilter : public faiss::IDSelector {
+public:
+    LocalFilter(const MetadataFilter* filter, const std::vector<faiss::idx_t>& rows)
+        : filter_(filter), rows_(rows) {}
+
+    bool is_member(faiss::idx_t id) const override {
+        return rows_[id] >= 0 && (!filter_ || filter_->is_member(rows_[id]));
+    }
+
+private:
+    const MetadataFilter* filter_;
+    const std::vector<faiss::idx_t>& rows_;
+};
+
+// Higher is better; keeps the k best of a query's merged partition results
+using Candidate = std::pair<float, faiss::idx_t>;
+
+void keep_best(std::vector<Candidate>& heap, size_t k, float score, faiss::idx_t id) {
+    auto worse = [](const Candidate& a, const Candidate& b) { return a.first > b.first; };
+    if (heap.size() < k) {
+        heap.emplace_back(score, id);
+        std::push_heap(heap.begin(), heap.end(), worse);
+    } else if (score > heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end(), worse);
+        heap.back() = {score, id};
+        std::push_heap(heap.begin(), heap.end(), worse);
+    }
+}
+
+} // namespace
+
+PartitionedIndex::PartitionedIndex(std::string field, int d, faiss::MetricType metric, size_t hnsw_threshold)
+    : field_(std::move(field)), d_(d), metric_(metric), hnsw_threshold_(hnsw_threshold) {}
+
+std::unique_ptr<faiss::Index> PartitionedIndex::make_index(size_t count) const {
+    if (count > hnsw_threshold_) {
+        auto hnsw = std::make_unique<faiss::IndexHNSWFlat>(d_, kHnswM, metric_);
+        hnsw->hnsw.efConstruction = kHnswEfConstruction;
+        hnsw->hnsw.efSearch = kHnswEfSearch;
+        return hnsw;
+    }
+    return std::make_unique<faiss::IndexFlat>(d_, metric_);
+}
+
+void PartitionedIndex::append(IndexPartition& partition, size_t n, const float* x, const faiss::idx_t* rows) {
+    size_t count = partition.rows.size() + n;
+    bool flat = dynamic_cast<const faiss::IndexHNSW*>(partition.index.get()) == nullptr;
+    if (flat && count > hnsw_threshold_) {
+        // The graph is built once over everything the partition holds; a
+        // flat partition is brute force, which no longer pays off
+        auto hnsw = make_index(count);
+        if (!partition.rows.empty()) {
+            hnsw->add(static_cast<faiss::idx_t>(partition.rows.size()), partition_vectors(*partition.index));
+        }
+        hnsw->add(static_cast<faiss::idx_t>(n), x);
+        partition.index = std::move(hnsw);
+        hnsw_conversions_++;
+    } else {
+        partition.index->add(static_cast<faiss::idx_t>(n), x);
+    }
+    partition.rows.insert(partition.rows.end(), rows, rows + n);
+}
+
+void PartitionedIndex::add(const faiss::idx_t* rows, size_t n, const float* x,
+                           const std::vector<std::string>& values) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // A row added again (IVF upserts keep the id) leaves its old partition
+    remove_locked(rows, n);
+
+    std::unordered_map<uint32_t, std::vector<size_t>> groups;
+    for (size_t i = 0; i < n; ++i) {
+        if (values[i].empty() || rows[i] < 0) {
+            continue;
+        }
+        auto inserted = by_value_.emplace(values[i], static_cast<uint32_t>(partitions_.size()));
+        if (inserted.second) {
+            auto partition = std::make_unique<IndexPartition>();
+            partition->value = values[i];
+            partition->index = make_index(0);
+            partitions_.push_back(std::move(partition));
+        }
+        groups[inserted.first->second].push_back(i);
+    }
+
+    std::vector<float> gathered;
+    std::vector<faiss::idx_t> group_rows;
+    for (const auto& group : groups) {
+        gathered.resize(group.second.size() * d_);
+        group_rows.resize(group.second.size());
+        for (size_t j = 0; j < group.second.size(); ++j) {
+            size_t i = group.second[j];
+            std::memcpy(&gathered[j * d_], x + i * d_, d_ * sizeof(float));
+            group_rows[j] = rows[i];
+            if (static_cast<size_t>(rows[i]) >= row_partition_.size()) {
+                row_partition_.resize(rows[i] + 1, kNoPartition);
+            }
+            row_partition_[rows[i]] = group.first;
+        }
+        append(*partitions_[group.first], group.second.size(), gathered.data(), group_rows.data());
+        vectors_ += group.second.size();
+    }
+}
+
+size_t PartitionedIndex::remove(const std::vector<faiss::idx_t>& rows) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return remove_locked(rows.data(), rows.size());
+}
+
+size_t PartitionedIndex::remove_locked(const faiss::idx_t* rows, size_t n) {
+    std::unordered_map<uint32_t, std::unordered_set<faiss::idx_t>> by_partition;
+    for (size_t i = 0; i < n; ++i) {
+        faiss::idx_t row = rows[i];
+        if (row >= 0 && static_cast<size_t>(row) < row_partition_.size() && row_partition_[row] != kNoPartition) {
+            by_partition[row_partition_[row]].insert(row);
+            row_partition_[row] = kNoPartition;
+        }
+    }
+
+    size_t removed = 0;
+    for (const auto& entry : by_partition) {
+        IndexPartition& partition = *partitions_[entry.first];
+        const auto& gone = entry.second;
+        bool hnsw = dynamic_cast<const faiss::IndexHNSW*>(partition.index.get()) != nullptr;
+        std::vector<faiss::idx_t> local_ids;
+        for (size_t local = 0; local < partition.rows.size(); ++local) {
+            if (partition.rows[local] >= 0 && gone.count(partition.rows[local])) {
+                local_ids.push_back(static_cast<faiss::idx_t>(local));
+                if (hnsw) {
+                    partition.rows[local] = -1;
+                }
+            }
+        }
+        removed += local_ids.size();
+        if (!hnsw) {
+            // Flat removal compacts in order
+            faiss::IDSelectorBatch selector(local_ids.size(), local_ids.data());
+            partition.index->remove_ids(selector);
+            partition.rows.erase(std::remove_if(partition.rows.begin(), partition.rows.end(),
+                                                [&gone](faiss::idx_t row) { return gone.count(row) > 0; }),
+                                 partition.rows.end());
+            continue;
+        }
+
+        // HNSW cannot remove: ids are tombstoned, and the graph rebuilt from
+        // the partition's own vectors once a quarter of them are
+        partition.removed += local_ids.size();
+        if (partition.removed * 4 <= partition.rows.size()) {
+            continue;
+        }
+        const float* xb = partition_vectors(*partition.index);
+        std::vector<float> kept;
+        std::vector<faiss::idx_t> kept_rows;
+        kept_rows.reserve(partition.rows.size() - partition.removed);
+        kept.reserve(kept_rows.capacity() * d_);
+        for (size_t local = 0; local < partition.rows.size(); ++local) {
+            if (partition.rows[local] >= 0) {
+                kept.insert(kept.end(), xb + local * d_, xb + (local + 1) * d_);
+                kept_rows.push_back(partition.rows[local]);
+            }
+        }
+        auto index = make_index(kept_rows.size());
+        if (!kept_rows.empty()) {
+            index->add(static_cast<faiss::idx_t>(kept_rows.size()), kept.data());
+        }
+        partition.index = std::move(index);
+        partition.rows.swap(kept_rows);
+        partition.removed = 0;
+        compactions_++;
+    }
+    vectors_ -= removed;
+    return removed;
+}
+
+bool PartitionedIndex::search(faiss::idx_t n, const float* x, faiss::idx_t k, const MetadataFilter& filter,
+                              int ef_search, float* distances, faiss::idx_t* labels) const {
+    std::vector<std::string> values;
+    bool exact;
+    if (!filter.required_strings(field_, values, exact)) {
+        unrouted_searches_++;
+        return false;
+    }
+    routed_searches_++;
+    if (!exact) {
+        filtered_searches_++;
+    }
+
+    bool inner_product = metric_ == faiss::METRIC_INNER_PRODUCT;
+    float empty_distance = inner_product ? -FLT_MAX : FLT_MAX;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::vector<const IndexPartition*> targets;
+    for (const auto& value : values) {
+        auto it = by_value_.find(value);
+        if (it == by_value_.end()) {
+            continue;
+        }
+        const IndexPartition* partition = partitions_[it->second].get();
+        if (partition->rows.size() > partition->removed) {
+            targets.push_back(partition);
+        }
+    }
+    partitions_searched_ += targets.size();
+
+    // Searches one partition into (distances, labels), as internal ids
+    auto search_partition = [&](const IndexPartition& partition, float* out_distances, faiss::idx_t* out_labels) {
+        // The equality alone needs no selector, unless there are tombstones
+        LocalFilter local(exact ? nullptr : &filter, partition.rows);
+        faiss::IDSelector* sel = exact && partition.removed == 0 ? nullptr : &local;
+        if (dynamic_cast<const faiss::IndexHNSW*>(partition.index.get())) {
+            faiss::SearchParametersHNSW params;
+            params.efSearch = ef_search > 0 ? ef_search : kHnswEfSearch;
+            params.sel = sel;
+            partition.index->search(n, x, k, out_distances, out_labels, &params);
+        } else {
+            faiss::SearchParameters params;
+            params.sel = sel;
+            partition.index->search(n, x, k, out_distances, out_labels, sel ? &params : nullptr);
+        }
+        for (faiss::idx_t i = 0; i < n * k; ++i) {
+            if (out_labels[i] >= 0) {
+                out_labels[i] = partition.rows[out_labels[i]];
+            } else {
+                out_distances[i] = empty_distance;
+            }
+        }
+    };
+
+    if (targets.size() == 1) {
+        search_partition(*targets[0], distances, labels);
+        return true;
+    }
+
+    std::vector<std::vector<Candidate>> heaps(n);
+    std::vector<float> partition_distances(n * k);
+    std::vector<faiss::idx_t> partition_labels(n * k);
+    for (const IndexPartition* partition : targets) {
+        search_partition(*partition, partition_distances.data(), partition_labels.data());
+        for (faiss::idx_t i = 0; i < n * k; ++i) {
+            if (partition_labels[i] >= 0) {
+                float score = inner_product ? partition_distances[i] : -partition_distances[i];
+                keep_best(heaps[i / k], static_cast<size_t>(k), score, partition_labels[i]);
+            }
+        }
+    }
+    for (faiss::idx_t q = 0; q < n; ++q) {
+        auto& heap = heaps[q];
+        std::sort(heap.begin(), heap.end(), [](const Candidate& a, const Candidate& b) { return a.first > b.first; });
+        for (faiss::idx_t i = 0; i < k; ++i) {
+            if (static_cast<size_t>(i) < heap.size()) {
+                distances[q * k + i] = inner_product ? heap[i].first : -heap[i].first;
+                labels[q * k + i] = heap[i].second;
+            } else {
+                distances[q * k + i] = empty_distance;
+                labels[q * k + i] = -1;
+            }
+        }
+    }
+    return true;
+}
+
+size_t PartitionedIndex::partition_count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return partitions_.size();
+}
+
+size_t PartitionedIndex::memory_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    size_t bytes = row_partition_.capacity() * sizeof(uint32_t);
+    for (const auto& partition : partitions_) {
+        bytes += sizeof(IndexPartition) + partition->value.capacity();
+        bytes += partition->rows.capacity() * sizeof(faiss::idx_t);
+        bytes += partition->rows.size() * d_ * sizeof(float);   // Tombstoned vectors too
+        if (auto* hnsw = dynamic_cast<const faiss::IndexHNSW*>(partition->index.get())) {
+            bytes += hnsw->hnsw.neighbors.capacity() * sizeof(faiss::HNSW::storage_idx_t);
+            bytes += hnsw->hnsw.offsets.capacity() * sizeof(size_t);
+            bytes += hnsw->hnsw.levels.capacity() * sizeof(int);
+        }
+    }
+    return bytes;
+}
+
+nlohmann::json PartitionedIndex::get_statistics() const {
+    nlohmann::json stats;
+    stats["field"] = field_;
+    stats["hnsw_threshold"] = hnsw_threshold_;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        std::vector<const IndexPartition*> largest;
+        size_t hnsw_partitions = 0;
+        for (const auto& partition : partitions_) {
+            largest.push_back(partition.get());
+            if (dynamic_cast<const faiss::IndexHNSW*>(partition->index.get())) {
+                hnsw_partitions++;
+            }
+        }
+        size_t reported = std::min(largest.size(), kLargestReported);
+        std::partial_sort(largest.begin(), largest.begin() + reported, largest.end(),
+                          [](const IndexPartition* a, const IndexPartition* b) {
+                              return a->rows.size() - a->removed > b->rows.size() - b->removed;
+                          });
+        nlohmann::json top = nlohmann::json::array();
+        for (size_t i = 0; i < reported; ++i) {
+            size_t vectors = largest[i]->rows.size() - largest[i]->removed;
+            top.push_back({{"value", largest[i]->value}, {"vectors", vectors}});
+        }
+        stats["partitions"] = partitions_.size();
+        stats["hnsw_partitions"] = hnsw_partitions;
+        stats["vectors"] = vectors_;
+        stats["largest"] = top;
+    }
+    stats["memory_bytes"] = memory_bytes();
+    stats["routed_searches"] = routed_searches_.load();
+    stats["filtered_searches"] = filtered_searches_.load();
+    stats["partitions_searched"] = partitions_searched_.load();
+    stats["unrouted_searches"] = unrouted_searches_.load();
+    stats["hnsw_conversions"] = hnsw_conversions_.load();
+    stats["compactions"] = compactions_.load();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Index-space vectors of rows [first, first + count) whose wanted flag is
+// set; found is cleared where the serving index has no vector for the row
+void collect_vectors(const faiss::Index& serving, const faiss::Index* base, int64_t first, size_t count,
+                     const std::vector<uint8_t>& wanted, float* out, std::vector<uint8_t>& found) {
+    int d = serving.d;
+    found.assign(count, 0);
+    auto* ivf = dynamic_cast<const faiss::IndexIVF*>(base);
+    if (ivf && ivf->invlists && ivf->invlists->code_size == d * sizeof(float)) {
+        // IVF-flat lists hold the vectors as they are; no direct map needed
+        for (size_t list_no = 0; list_no < ivf->nlist; ++list_no) {
+            size_t list_size = ivf->invlists->list_size(list_no);
+            if (list_size == 0) {
+                continue;
+            }
+            const faiss::idx_t* ids = ivf->invlists->get_ids(list_no);
+            const uint8_t* codes = ivf->invlists->get_codes(list_no);
+            for (size_t j = 0; j < list_size; ++j) {
+                int64_t row = ids[j] - first;
+                if (row >= 0 && static_cast<size_t>(row) < count && wanted[row]) {
+                    std::memcpy(out + row * d, codes + j * ivf->invlists->code_size, d * sizeof(float));
+                    found[row] = 1;
+                }
+            }
+            ivf->invlists->release_codes(list_no, codes);
+            ivf->invlists->release_ids(list_no, ids);
+        }
+    }
+    // The rest (delta segments, non-IVF indexes) through reconstruct
+    for (size_t i = 0; i < count; ++i) {
+        if (wanted[i] && !found[i]) {
+            try {
+                serving.reconstruct(first + static_cast<int64_t>(i), out + i * d);
+                found[i] = 1;
+            } catch (const std::exception&) {
+                // Removed, or the index cannot reconstruct
+            }
+        }
+    }
+}
+
+} // namespace
+
+size_t VectorSearchEngine::rebuild_partitions() {
+    if (config_.partition_field.empty()) {
+        return 0;
+    }
+    auto start_time = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto serving = serving_index();
+    auto columns = std::atomic_load(&metadata_columns_);
+    if (!serving || !columns) {
+        return 0;
+    }
+    std::shared_ptr<const faiss::Index> base = base_index();
+
+    auto partitions = std::make_shared<PartitionedIndex>(config_.partition_field, serving->d,
+                                                         serving->metric_type,
+                                                         static_cast<size_t>(config_.partition_hnsw_threshold));
+    size_t rows = columns->rows();
+    size_t missing = 0;
+    std::vector<int64_t> ids;
+    std::vector<std::string> values;
+    std::vector<uint8_t> wanted;
+    std::vector<uint8_t> found;
+    std::vector<float> vectors;
+    for (size_t first = 0; first < rows; first += kRebuildBatch) {
+        size_t count = std::min(kRebuildBatch, rows - first);
+        ids.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            ids[i] = static_cast<int64_t>(first + i);
+        }
+        if (!columns->string_values(config_.partition_field, ids.data(), count, values)) {
+            std::cerr << "Partition field " << config_.partition_field
+                      << " has no string column (check METADATA_FILTER_FIELDS); partitions disabled" << std::endl;
+            std::atomic_store(&partitions_, std::shared_ptr<PartitionedIndex>());
+            return 0;
+        }
+        wanted.assign(count, 0);
+        for (size_t i = 0; i < count; ++i) {
+            wanted[i] = !values[i].empty();
+        }
+        vectors.resize(count * serving->d);
+        collect_vectors(*serving, base.get(), static_cast<int64_t>(first), count, wanted, vectors.data(), found);
+
+        // Compacted to the rows that have both a value and a vector
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (!wanted[i]) {
+                continue;
+            }
+            if (!found[i]) {
+                missing++;
+                continue;
+            }
+            if (kept != i) {
+                std::memcpy(&vectors[kept * serving->d], &vectors[i * serving->d], serving->d * sizeof(float));
+                values[kept] = std::move(values[i]);
+            }
+            ids[kept++] = static_cast<int64_t>(first + i);
+        }
+        values.resize(kept);
+        partitions->add(ids.data(), kept, vectors.data(), values);
+    }
+    std::atomic_store(&partitions_, partitions);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    auto stats = partitions->get_statistics();
+    std::cout << "Partitioned " << stats["vectors"].get<size_t>() << " vectors by " << config_.partition_field
+              << " into " << stats["partitions"].get<size_t>() << " indexes ("
+              << stats["hnsw_partitions"].get<size_t>() << " HNSW) in " << seconds << " s";
+    if (missing > 0) {
+        std::cout << "; " << missing << " documents have no vector to copy";
+    }
+    std::cout << std::endl;
+    return stats["vectors"].get<size_t>();
+}
+
+bool VectorSearchEngine::search_partitions(const float* queries, size_t n, int k, const MetadataFilter* filter,
+                                           float* distances, faiss::idx_t* labels) {
+    auto partitions = std::atomic_load(&partitions_);
+    if (!partitions || !filter) {
+        return false;
+    }
+    return partitions->search(static_cast<faiss::idx_t>(n), queries, k, *filter, 0, distances, labels);
+}
+
+void VectorSearchEngine::update_partitions(const faiss::idx_t* rows, size_t n, const float* vectors,
+                                           const std::vector<int64_t>& removed) {
+    auto partitions = std::atomic_load(&partitions_);
+    auto columns = std::atomic_load(&metadata_columns_);
+    if (!partitions || !columns) {
+        return;
+    }
+    if (!removed.empty()) {
+        partitions->remove(removed);
+    }
+    std::vector<std::string> values;
+    if (n > 0 && columns->string_values(partitions->field(), rows, n, values)) {
+        partitions->add(rows, n, vectors, values);
+    }
+}
+
+nlohmann::json VectorSearchEngine::get_partition_statistics() const {
+    auto partitions = std::atomic_load(&partitions_);
+    if (!partitions) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = partitions->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,277 @@
+/**
+ * @file query_embedder.cpp
+ * @brief Cached, batched embedding of query text for /search_text
+ */
+
+#include "query_embedder.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+namespace neurorag {
+
+QueryEmbedder::QueryEmbedder(std::unique_ptr<EmbeddingBackend> backend,
+                             std::unique_ptr<EmbeddingCache> cache,
+                             size_t max_batch_size,
+                             std::chrono::microseconds max_wait)
+    : backend_(std::move(backend)),
+      cache_(std::move(cache)),
+      dimension_(backend_->dimension()),
+      max_batch_size_(std::max<size_t>(1, std::min(max_batch_size, backend_->max_batch_size()))),
+      max_wait_(max_wait) {
+    if (cache_ && cache_->dimension() != dimension_) {
+        std::cerr << "Embedding cache dimension " << cache_->dimension() << " does not match backend dimension "
+                  << dimension_ << "; cache disabled" << std::endl;
+        cache_.reset();
+    }
+}
+
+QueryEmbedder::~QueryEmbedder() {
+    stop();
+}
+
+void QueryEmbedder::start() {
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+    dispatcher_ = std::thread(&QueryEmbedder::dispatcher_loop, this);
+}
+
+void QueryEmbedder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    }
+    queue_condition_.notify_all();
+    if (dispatcher_.joinable()) {
+        dispatcher_.join();
+    }
+
+    // Fail whatever was still queued so no caller waits forever
+    std::deque<Pending> leftovers;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        leftovers.swap(queue_);
+    }
+    for (auto& pending : leftovers) {
+        complete(pending, "query embedder stopped");
+    }
+}
+
+bool QueryEmbedder::embed(const std::vector<std::string>& texts,
+                          std::vector<float>& embeddings,
+                          std::string& error) {
+    embeddings.resize(texts.size() * dimension_);
+    texts_.fetch_add(texts.size(), std::memory_order_relaxed);
+
+    auto waiter = std::make_shared<Waiter>();
+    std::vector<Pending> misses;
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < texts.size(); ++i) {
+        uint64_t key = EmbeddingCache::key(texts[i]);
+        float* output = &embeddings[i * dimension_];
+        if (cache_ && cache_->lookup(key, output)) {
+            continue;
+        }
+        misses.push_back({key, &texts[i], output, waiter, now});
+    }
+    if (misses.empty()) {
+        return true;
+    }
+
+    waiter->remaining = misses.size();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!running_.load()) {
+            error = "query embedder is not running";
+            return false;
+        }
+        for (auto& pending : misses) {
+            queue_.push_back(std::move(pending));
+        }
+    }
+    queue_condition_.notify_one();
+
+    std::unique_lock<std::mutex> lock(waiter->mutex);
+    waiter->condition.wait(lock, [&waiter] { return waiter->remaining == 0; });
+    if (!waiter->error.empty()) {
+        error = waiter->error;
+        return false;
+    }
+    return true;
+}
+
+void QueryEmbedder::complete(Pending& pending, const std::string& error) {
+    Waiter& waiter = *pending.waiter;
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(waiter.mutex);
+        if (!error.empty() && waiter.error.empty()) {
+            waiter.error = error;
+        }
+        last = --waiter.remaining == 0;
+    }
+    if (last) {
+        waiter.condition.notify_all();
+    }
+}
+
+void QueryEmbedder::dispatcher_loop() {
+    std::vector<Pending> batch;
+    batch.reserve(max_batch_size_);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_condition_.wait(lock, [this] { return !running_.load() || !queue_.empty(); });
+
+            if (!running_.load()) {
+                return;
+            }
+
+            // The oldest text bounds how long we may keep collecting
+            auto deadline = queue_.front().enqueued_at + max_wait_;
+            while (queue_.size() < max_batch_size_ && running_.load()) {
+                if (queue_condition_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                    break;
+                }
+            }
+
+            size_t take = std::min(queue_.size(), max_batch_size_);
+            for (size_t i = 0; i < take; ++i) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+
+        if (!batch.empty()) {
+            execute_batch(batch);
+            batch.clear();
+        }
+    }
+}
+
+void QueryEmbedder::execute_batch(std::vector<Pending>& batch) {
+    // Identical texts from concurrent requests are embedded once
+    std::unordered_map<uint64_t, size_t> unique_rows;
+    std::vector<std::string> texts;
+    std::vector<size_t> rows(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        auto inserted = unique_rows.emplace(batch[i].key, texts.size());
+        if (inserted.second) {
+            texts.push_back(*batch[i].text);
+        }
+        rows[i] = inserted.first->second;
+    }
+    duplicates_.fetch_add(batch.size() - texts.size(), std::memory_order_relaxed);
+
+    std::vector<float> embeddings;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        if (!backend_->embed(texts, embeddings, error) && error.empty()) {
+            error = "embedding backend failed";
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    batched_texts_.fetch_add(texts.size(), std::memory_order_relaxed);
+    backend_micros_.fetch_add(micros.count(), std::memory_order_relaxed);
+
+    if (error.empty()) {
+        if (cache_) {
+            for (const auto& entry : unique_rows) {
+                cache_->insert(entry.first, &embeddings[entry.second * dimension_]);
+            }
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            std::memcpy(batch[i].output, &embeddings[rows[i] * dimension_], dimension_ * sizeof(float));
+        }
+    } else {
+        failed_batches_.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Embedding batch of " << texts.size() << " texts failed: " << error << std::endl;
+    }
+
+    for (auto& pending : batch) {
+        complete(pending, error);
+    }
+}
+
+nlohmann::json QueryEmbedder::get_statistics() const {
+    uint64_t batches = batches_.load();
+    uint64_t batched = batched_texts_.load();
+
+    nlohmann::json stats;
+    stats["backend"] = backend_->name();
+    stats["dimension"] = dimension_;
+    stats["texts"] = texts_.load();
+    stats["backend_batches"] = batches;
+    stats["backend_texts"] = batched;
+    stats["duplicate_texts"] = duplicates_.load();
+    stats["failed_batches"] = failed_batches_.load();
+    stats["average_batch_size"] = batches > 0 ? static_cast<double>(batched) / batches : 0.0;
+    stats["average_batch_ms"] = batches > 0 ? backend_micros_.load() / 1000.0 / batches : 0.0;
+    stats["max_batch_size"] = max_batch_size_;
+    stats["max_wait_us"] = max_wait_.count();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stats["queue_depth"] = queue_.size();
+    }
+    if (cache_) {
+        stats["cache"] = cache_->get_statistics();
+    } else {
+        stats["cache"] = {{"enabled", false}};
+    }
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::set_query_embedder(QueryEmbedder* embedder) {
+    if (embedder && embedder->dimension() != config_.dimension) {
+        std::cerr << "Query embedding dimension " << embedder->dimension() << " does not match "
+                  << config_.dimension << "; text search not enabled" << std::endl;
+        return false;
+    }
+    query_embedder_.store(embedder, std::memory_order_release);
+    return true;
+}
+
+bool VectorSearchEngine::search_text(const std::string& text,
+                                     SearchRequest request,
+                                     SearchResult& result,
+                                     std::string& error) {
+    QueryEmbedder* embedder = query_embedder_.load(std::memory_order_acquire);
+    if (!embedder) {
+        error = "text search is not enabled (set EMBEDDING_BACKEND)";
+        return false;
+    }
+    if (!embedder->embed({text}, request.query_vector, error)) {
+        return false;
+    }
+    result = search(request);
+    return true;
+}
+
+nlohmann::json VectorSearchEngine::get_embedding_statistics() const {
+    QueryEmbedder* embedder = query_embedder_.load(std::memory_order_acquire);
+    if (!embedder) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = embedder->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
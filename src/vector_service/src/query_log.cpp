@@ -0,0 +1,462 @@
+/**
+ * @file query_log.cpp
+ * @brief Sampled, anonymized query log used to warm up from real traffic
+ */
+
+#include "query_log.h"
+#include "checksum.h"
+#include "result_codec.h"
+#include "tiered_invlists.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexHNSW.h>
+
+namespace neurorag {
+
+namespace {
+
+#pragma pack(push, 1)
+struct EntryHeader {
+    uint32_t count;
+    uint16_t k;
+    uint16_t reserved;
+    float threshold;
+};
+#pragma pack(pop)
+
+// Read one byte per page so the kernel maps the whole range
+size_t touch_pages(const void* data, size_t size) {
+    if (!data || size == 0) {
+        return 0;
+    }
+    const auto* bytes = static_cast<const volatile uint8_t*>(data);
+    uint8_t sink = 0;
+    for (size_t offset = 0; offset < size; offset += 4096) {
+        sink ^= bytes[offset];
+    }
+    sink ^= bytes[size - 1];
+    (void)sink;
+    return size;
+}
+
+} // namespace
+
+QueryRecorder::QueryRecorder(int dimension, double sample_rate, size_t capacity, uint32_t min_count)
+    : dimension_(dimension),
+      sample_rate_(sample_rate),
+      shard_capacity_(std::max<size_t>(1, capacity / kNumShards)),
+      min_count_(std::max<uint32_t>(1, min_count)),
+      seen_(0),
+      recorded_(0),
+      decays_(0),
+      flush_running_(false) {}
+
+QueryRecorder::~QueryRecorder() {
+    stop();
+}
+
+uint64_t QueryRecorder::hash_entry(const std::vector<uint16_t>& vector, int k, float threshold) {
+    // FNV-1a over the quantized vector and the parameters that shape the result
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    mix(vector.data(), vector.size() * sizeof(uint16_t));
+    mix(&k, sizeof(k));
+    mix(&threshold, sizeof(threshold));
+    return hash;
+}
+
+void QueryRecorder::record(const float* vector, size_t dimension, int k, float threshold) {
+    seen_.fetch_add(1, std::memory_order_relaxed);
+    if (sample_rate_ <= 0.0 || static_cast<int>(dimension) != dimension_) {
+        return;
+    }
+
+    thread_local std::minstd_rand rng(std::random_device{}());
+    if (sample_rate_ < 1.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng) >= sample_rate_) {
+        return;
+    }
+
+    Entry entry;
+    entry.vector.resize(dimension);
+    for (size_t i = 0; i < dimension; ++i) {
+        entry.vector[i] = result_codec::float_to_half(vector[i]);
+    }
+    entry.k = k;
+    entry.threshold = threshold;
+    entry.count = 1;
+
+    uint64_t key = hash_entry(entry.vector, k, threshold);
+    insert(key, std::move(entry));
+    recorded_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QueryRecorder::insert(uint64_t key, Entry entry) {
+    Shard& shard = shards_[key % kNumShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        it->second.count += entry.count;
+        return;
+    }
+
+    if (shard.entries.size() >= shard_capacity_) {
+        // Halve every count and forget queries that drop to zero, so the
+        // log tracks recent traffic rather than all-time totals
+        for (auto entry_it = shard.entries.begin(); entry_it != shard.entries.end();) {
+            entry_it->second.count /= 2;
+            if (entry_it->second.count == 0) {
+                entry_it = shard.entries.erase(entry_it);
+            } else {
+                ++entry_it;
+            }
+        }
+        decays_.fetch_add(1, std::memory_order_relaxed);
+        if (shard.entries.size() >= shard_capacity_) {
+            return;
+        }
+    }
+    shard.entries.emplace(key, std::move(entry));
+}
+
+std::vector<RecordedQuery> QueryRecorder::top_queries(size_t n) const {
+    std::vector<RecordedQuery> queries;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& item : shard.entries) {
+            RecordedQuery query;
+            query.vector.resize(item.second.vector.size());
+            for (size_t i = 0; i < item.second.vector.size(); ++i) {
+                query.vector[i] = result_codec::half_to_float(item.second.vector[i]);
+            }
+            query.k = item.second.k;
+            query.threshold = item.second.threshold;
+            query.count = item.second.count;
+            queries.push_back(std::move(query));
+        }
+    }
+
+    auto by_count = [](const RecordedQuery& a, const RecordedQuery& b) { return a.count > b.count; };
+    if (queries.size() > n) {
+        std::partial_sort(queries.begin(), queries.begin() + n, queries.end(), by_count);
+        queries.resize(n);
+    } else {
+        std::sort(queries.begin(), queries.end(), by_count);
+    }
+    return queries;
+}
+
+bool QueryRecorder::save(const std::string& path) const {
+    std::string body;
+    uint32_t num_entries = 0;
+    {
+        // Snapshot under all shard locks so the file is self-consistent
+        std::vector<std::unique_lock<std::mutex>> locks;
+        std::vector<const Entry*> entries;
+        for (const auto& shard : shards_) {
+            locks.emplace_back(shard.mutex);
+            for (const auto& item : shard.entries) {
+                if (item.second.count >= min_count_) {
+                    entries.push_back(&item.second);
+                }
+            }
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry* a, const Entry* b) { return a->count > b->count; });
+
+        size_t entry_size = sizeof(EntryHeader) + static_cast<size_t>(dimension_) * sizeof(uint16_t);
+        body.reserve(entries.size() * entry_size);
+        for (const Entry* entry : entries) {
+            EntryHeader header{entry->count, static_cast<uint16_t>(entry->k), 0, entry->threshold};
+            body.append(reinterpret_cast<const char*>(&header), sizeof(header));
+            body.append(reinterpret_cast<const char*>(entry->vector.data()),
+                        entry->vector.size() * sizeof(uint16_t));
+        }
+        num_entries = static_cast<uint32_t>(entries.size());
+    }
+
+    QueryLogHeader header{kMagic, kVersion, 0, static_cast<uint32_t>(dimension_), num_entries,
+                          recorded_.load()};
+    uint32_t checksum = crc32c(&header, sizeof(header));
+    checksum = crc32c(body.data(), body.size(), checksum);
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "QueryRecorder: cannot write " << temp_path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(body.data(), static_cast<std::streamsize>(body.size()));
+        file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        if (!file) {
+            std::cerr << "QueryRecorder: short write to " << temp_path << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "QueryRecorder: cannot rename " << temp_path << " to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool QueryRecorder::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(QueryLogHeader) + sizeof(uint32_t)) {
+        std::cerr << "QueryRecorder: " << path << " is truncated" << std::endl;
+        return false;
+    }
+
+    QueryLogHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion) {
+        std::cerr << "QueryRecorder: " << path << " is not a query log" << std::endl;
+        return false;
+    }
+    if (static_cast<int>(header.dimension) != dimension_) {
+        std::cerr << "QueryRecorder: " << path << " has dimension " << header.dimension
+                  << ", expected " << dimension_ << std::endl;
+        return false;
+    }
+
+    size_t entry_size = sizeof(EntryHeader) + static_cast<size_t>(dimension_) * sizeof(uint16_t);
+    size_t expected_size = sizeof(header) + header.num_entries * entry_size + sizeof(uint32_t);
+    uint32_t stored_checksum;
+    std::memcpy(&stored_checksum, data.data() + data.size() - sizeof(uint32_t), sizeof(stored_checksum));
+    if (data.size() != expected_size ||
+        crc32c(data.data(), data.size() - sizeof(uint32_t)) != stored_checksum) {
+        std::cerr << "QueryRecorder: " << path << " failed checksum validation" << std::endl;
+        return false;
+    }
+
+    const char* position = data.data() + sizeof(header);
+    for (uint32_t i = 0; i < header.num_entries; ++i) {
+        EntryHeader entry_header;
+        std::memcpy(&entry_header, position, sizeof(entry_header));
+
+        Entry entry;
+        entry.vector.resize(dimension_);
+        std::memcpy(entry.vector.data(), position + sizeof(entry_header),
+                    entry.vector.size() * sizeof(uint16_t));
+        entry.k = entry_header.k;
+        entry.threshold = entry_header.threshold;
+        entry.count = entry_header.count;
+        position += entry_size;
+
+        uint64_t key = hash_entry(entry.vector, entry.k, entry.threshold);
+        insert(key, std::move(entry));
+    }
+
+    std::cout << "Loaded " << header.num_entries << " recorded queries from " << path << std::endl;
+    return true;
+}
+
+void QueryRecorder::start_periodic_flush(const std::string& path, std::chrono::seconds interval) {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    if (flush_running_) {
+        return;
+    }
+    flush_path_ = path;
+    flush_running_ = true;
+    flush_thread_ = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(flush_mutex_);
+        while (!flush_condition_.wait_for(lock, interval, [this] { return !flush_running_; })) {
+            lock.unlock();
+            save(flush_path_);
+            lock.lock();
+        }
+    });
+}
+
+void QueryRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+        if (!flush_running_) {
+            return;
+        }
+        flush_running_ = false;
+    }
+    flush_condition_.notify_all();
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+    save(flush_path_);
+}
+
+nlohmann::json QueryRecorder::get_statistics() const {
+    size_t tracked = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        tracked += shard.entries.size();
+    }
+
+    nlohmann::json stats;
+    stats["sample_rate"] = sample_rate_;
+    stats["queries_seen"] = seen_.load();
+    stats["queries_recorded"] = recorded_.load();
+    stats["distinct_tracked"] = tracked;
+    stats["capacity"] = shard_capacity_ * kNumShards;
+    stats["decays"] = decays_.load();
+    stats["min_persist_count"] = min_count_;
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+void VectorSearchEngine::set_query_recorder(QueryRecorder* recorder) {
+    query_recorder_.store(recorder, std::memory_order_release);
+}
+
+void VectorSearchEngine::record_query(const SearchRequest& request) {
+    QueryRecorder* recorder = query_recorder_.load(std::memory_order_acquire);
+    if (recorder) {
+        recorder->record(request.query_vector.data(), request.query_vector.size(),
+                         request.k, request.threshold);
+    }
+}
+
+nlohmann::json VectorSearchEngine::warmup_from_traffic(const std::vector<RecordedQuery>& queries) {
+    auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<SearchRequest> requests;
+    requests.reserve(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (static_cast<int>(queries[i].vector.size()) != config_.dimension) {
+            continue;
+        }
+        SearchRequest request;
+        request.query_vector = queries[i].vector;
+        request.k = queries[i].k;
+        request.threshold = queries[i].threshold;
+        request.request_id = "warmup-" + std::to_string(i);
+        requests.push_back(std::move(request));
+    }
+
+    // Touch the pages the replay will need before timing-sensitive traffic arrives
+    size_t bytes_touched = touch_hot_index_pages(requests);
+
+    // Replay through batch_search in parallel so the result cache is populated
+    size_t batch_size = std::max(1, config_.max_batch_size);
+    size_t num_batches = (requests.size() + batch_size - 1) / batch_size;
+    size_t num_workers = std::min<size_t>(std::max(1, config_.num_threads), num_batches);
+
+    std::atomic<size_t> next_batch{0};
+    std::atomic<size_t> replayed{0};
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < num_workers; ++w) {
+        workers.emplace_back([&]() {
+            for (size_t b = next_batch.fetch_add(1); b < num_batches; b = next_batch.fetch_add(1)) {
+                size_t begin = b * batch_size;
+                size_t end = std::min(requests.size(), begin + batch_size);
+                std::vector<SearchRequest> batch(requests.begin() + begin, requests.begin() + end);
+                replayed.fetch_add(batch_search(batch).size());
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start_time).count();
+
+    nlohmann::json report;
+    report["queries_replayed"] = replayed.load();
+    report["batches"] = num_batches;
+    report["bytes_touched"] = bytes_touched;
+    report["elapsed_ms"] = elapsed_ms;
+    return report;
+}
+
+size_t VectorSearchEngine::touch_hot_index_pages(const std::vector<SearchRequest>& requests) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    size_t touched = 0;
+    auto base = base_index();
+    auto* index = const_cast<faiss::Index*>(base.get());
+
+    if (auto* ivf = dynamic_cast<faiss::IndexIVF*>(index)) {
+        // Lists probed by the recorded queries, each touched once
+        size_t nprobe = std::max<size_t>(1, ivf->nprobe);
+        std::vector<faiss::idx_t> probed(requests.size() * nprobe);
+        std::vector<float> distances(probed.size());
+        std::vector<float> queries(requests.size() * static_cast<size_t>(ivf->d));
+        for (size_t i = 0; i < requests.size(); ++i) {
+            std::copy(requests[i].query_vector.begin(), requests[i].query_vector.end(),
+                      queries.begin() + i * ivf->d);
+        }
+        if (!requests.empty()) {
+            ivf->quantizer->search(static_cast<faiss::idx_t>(requests.size()), queries.data(),
+                                   static_cast<faiss::idx_t>(nprobe), distances.data(), probed.data());
+        }
+        std::sort(probed.begin(), probed.end());
+        probed.erase(std::unique(probed.begin(), probed.end()), probed.end());
+        probed.erase(std::remove_if(probed.begin(), probed.end(), [ivf](faiss::idx_t list_no) {
+            return list_no < 0 || static_cast<size_t>(list_no) >= ivf->nlist;
+        }), probed.end());
+        ivf->invlists->prefetch_lists(probed.data(), static_cast<int>(probed.size()));
+
+        for (faiss::idx_t list_no : probed) {
+            size_t list_size = ivf->invlists->list_size(list_no);
+            if (list_size == 0) {
+                continue;
+            }
+            const uint8_t* codes = ivf->invlists->get_codes(list_no);
+            const faiss::idx_t* ids = ivf->invlists->get_ids(list_no);
+            touched += touch_pages(codes, list_size * ivf->invlists->code_size);
+            touched += touch_pages(ids, list_size * sizeof(faiss::idx_t));
+            ivf->invlists->release_codes(list_no, codes);
+            ivf->invlists->release_ids(list_no, ids);
+        }
+
+        // The touches above are the recorded traffic's probes; rank tiers on them now
+        if (auto* tiered = dynamic_cast<TieredInvertedLists*>(ivf->invlists)) {
+            tiered->rebalance();
+        }
+    } else if (auto* hnsw_index = dynamic_cast<faiss::IndexHNSW*>(index)) {
+        // Every search descends through the upper layers, so their adjacency
+        // and the vectors of their nodes are hot regardless of the query
+        const faiss::HNSW& hnsw = hnsw_index->hnsw;
+        auto* storage = dynamic_cast<const faiss::IndexFlatCodes*>(hnsw_index->storage);
+        for (size_t node = 0; node < hnsw.levels.size(); ++node) {
+            if (hnsw.levels[node] <= 1) {
+                continue;
+            }
+            // Layers 1..levels-1 of a node are contiguous in the neighbor array
+            size_t first, last, unused;
+            hnsw.neighbor_range(static_cast<faiss::idx_t>(node), 1, &first, &unused);
+            hnsw.neighbor_range(static_cast<faiss::idx_t>(node), hnsw.levels[node] - 1, &unused, &last);
+            touched += touch_pages(hnsw.neighbors.data() + first,
+                                   (last - first) * sizeof(faiss::HNSW::storage_idx_t));
+            if (storage) {
+                touched += touch_pages(storage->codes.data() + node * storage->code_size,
+                                       storage->code_size);
+            }
+        }
+    }
+
+    return touched;
+}
+
+} // namespace neurorag
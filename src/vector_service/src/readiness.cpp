@@ -0,0 +1,388 @@
+/**
+ * @file readiness.cpp
+ * @brief Startup readiness gating: page residency and latency probes
+ */
+
+#include "readiness.h"
+#include "diskann_index.h"
+#include "tiered_invlists.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexHNSW.h>
+
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22
+#endif
+
+namespace neurorag {
+
+namespace {
+
+constexpr size_t kPrefaultChunkBytes = 64ULL << 20;
+
+size_t page_size() {
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+const char* phase_name(ReadinessGate::Phase phase) {
+    switch (phase) {
+        case ReadinessGate::Phase::STARTING: return "starting";
+        case ReadinessGate::Phase::LOADING_PAGES: return "loading_pages";
+        case ReadinessGate::Phase::WARMING_UP: return "warming_up";
+        case ReadinessGate::Phase::PROBING: return "probing";
+        case ReadinessGate::Phase::SHUTTING_DOWN: return "shutting_down";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+ReadinessGate::ReadinessGate(double latency_slo_ms, int failure_threshold)
+    : latency_slo_ms_(latency_slo_ms),
+      failure_threshold_(std::max(1, failure_threshold)),
+      phase_(Phase::STARTING),
+      engine_healthy_(true),
+      probes_passing_(false),
+      consecutive_failures_(0),
+      probe_rounds_(0),
+      last_probe_p99_ms_(0.0),
+      bytes_total_(0),
+      bytes_prefaulted_(0),
+      memory_locked_(false),
+      resident_fraction_(0.0),
+      probing_(false) {}
+
+ReadinessGate::~ReadinessGate() {
+    stop();
+}
+
+void ReadinessGate::set_phase(Phase phase) {
+    phase_.store(phase, std::memory_order_release);
+    std::cout << "Readiness phase: " << phase_name(phase) << std::endl;
+}
+
+bool ReadinessGate::prefault(const std::vector<MemoryRegion>& regions, int num_threads, bool lock_memory) {
+    const uintptr_t page = page_size();
+
+    // Page-align and merge so shared pages are handled (and counted) once
+    std::vector<PageRange> ranges;
+    ranges.reserve(regions.size());
+    for (const auto& region : regions) {
+        if (!region.data || region.size == 0) {
+            continue;
+        }
+        uintptr_t begin = reinterpret_cast<uintptr_t>(region.data) & ~(page - 1);
+        uintptr_t end = (reinterpret_cast<uintptr_t>(region.data) + region.size + page - 1) & ~(page - 1);
+        ranges.push_back({begin, end});
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const PageRange& a, const PageRange& b) { return a.begin < b.begin; });
+
+    std::vector<PageRange> merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.begin <= merged.back().end) {
+            merged.back().end = std::max(merged.back().end, range.end);
+        } else {
+            merged.push_back(range);
+        }
+    }
+
+    // Split into chunks so a single huge region is still faulted in parallel
+    std::vector<PageRange> chunks;
+    uint64_t total = 0;
+    for (const auto& range : merged) {
+        total += range.end - range.begin;
+        for (uintptr_t begin = range.begin; begin < range.end; begin += kPrefaultChunkBytes) {
+            chunks.push_back({begin, std::min<uintptr_t>(range.end, begin + kPrefaultChunkBytes)});
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(residency_mutex_);
+        ranges_ = merged;
+        residency_checked_at_ = std::chrono::steady_clock::time_point();
+    }
+    bytes_total_.store(total);
+    bytes_prefaulted_.store(0);
+
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<bool> lock_failed{false};
+    std::atomic<int> lock_errno{0};
+    auto worker = [&]() {
+        for (size_t i = next_chunk.fetch_add(1); i < chunks.size(); i = next_chunk.fetch_add(1)) {
+            auto* begin = reinterpret_cast<void*>(chunks[i].begin);
+            size_t length = chunks[i].end - chunks[i].begin;
+
+            // Starts readahead for file-backed (mmap-loaded) index data
+            ::madvise(begin, length, MADV_WILLNEED);
+
+            // Equivalent of MAP_POPULATE for an existing mapping (Linux 5.14+)
+            if (::madvise(begin, length, MADV_POPULATE_READ) != 0) {
+                const volatile uint8_t* bytes = static_cast<const volatile uint8_t*>(begin);
+                uint8_t sink = 0;
+                for (size_t offset = 0; offset < length; offset += page) {
+                    sink ^= bytes[offset];
+                }
+                (void)sink;
+            }
+
+            if (lock_memory && ::mlock(begin, length) != 0) {
+                lock_errno.store(errno);
+                lock_failed.store(true);
+            }
+            bytes_prefaulted_.fetch_add(length);
+        }
+    };
+
+    size_t workers = std::min<size_t>(std::max(1, num_threads), std::max<size_t>(1, chunks.size()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (lock_memory) {
+        if (lock_failed.load()) {
+            std::cerr << "WARNING: mlock of index memory failed (" << std::strerror(lock_errno.load())
+                      << "); check RLIMIT_MEMLOCK / CAP_IPC_LOCK" << std::endl;
+        }
+        memory_locked_.store(!lock_failed.load());
+    }
+
+    std::cout << "Prefaulted " << (total >> 20) << " MB of index memory in "
+              << chunks.size() << " chunks" << std::endl;
+    return !(lock_memory && lock_failed.load());
+}
+
+double ReadinessGate::resident_fraction() const {
+    std::lock_guard<std::mutex> lock(residency_mutex_);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - residency_checked_at_ < std::chrono::seconds(1)) {
+        return resident_fraction_;
+    }
+    residency_checked_at_ = now;
+
+    const size_t page = page_size();
+    uint64_t total_pages = 0;
+    uint64_t resident_pages = 0;
+    std::vector<unsigned char> vec;
+    for (const auto& range : ranges_) {
+        for (uintptr_t begin = range.begin; begin < range.end; begin += kPrefaultChunkBytes) {
+            size_t length = std::min<uintptr_t>(range.end - begin, kPrefaultChunkBytes);
+            size_t pages = length / page;
+            vec.resize(pages);
+            total_pages += pages;
+            if (::mincore(reinterpret_cast<void*>(begin), length, vec.data()) == 0) {
+                for (unsigned char status : vec) {
+                    resident_pages += status & 1;
+                }
+            }
+        }
+    }
+
+    resident_fraction_ = total_pages > 0 ? static_cast<double>(resident_pages) / total_pages : 1.0;
+    return resident_fraction_;
+}
+
+void ReadinessGate::start_latency_probes(VectorSearchEngine* engine,
+                                         std::vector<std::vector<float>> probe_queries,
+                                         int k,
+                                         std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(probe_mutex_);
+    if (probing_ || probe_queries.empty()) {
+        return;
+    }
+    probing_ = true;
+
+    probe_thread_ = std::thread([this, engine, queries = std::move(probe_queries), k, interval]() {
+        uint64_t round = 0;
+        std::unique_lock<std::mutex> lock(probe_mutex_);
+        while (probing_) {
+            lock.unlock();
+            run_probe_round(engine, queries, k, round++);
+            lock.lock();
+            probe_condition_.wait_for(lock, interval, [this] { return !probing_; });
+        }
+    });
+}
+
+void ReadinessGate::run_probe_round(VectorSearchEngine* engine,
+                                    const std::vector<std::vector<float>>& probe_queries,
+                                    int k, uint64_t round) {
+    std::mt19937 rng(static_cast<uint32_t>(round));
+    std::uniform_real_distribution<float> jitter(-1e-3f, 1e-3f);
+
+    std::vector<double> latencies;
+    latencies.reserve(probe_queries.size());
+    bool failed = false;
+
+    for (const auto& query : probe_queries) {
+        SearchRequest request;
+        request.query_vector = query;
+        for (float& value : request.query_vector) {
+            value *= 1.0f + jitter(rng);
+        }
+        request.k = k;
+        request.threshold = 0.0f;
+        request.request_id = "readiness-probe";
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            engine->search(request);
+        } catch (const std::exception& e) {
+            std::cerr << "Readiness probe failed: " << e.what() << std::endl;
+            failed = true;
+            break;
+        }
+        latencies.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    double p99 = 0.0;
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        p99 = latencies[std::min(latencies.size() - 1, static_cast<size_t>(0.99 * latencies.size()))];
+    }
+    last_probe_p99_ms_.store(p99);
+    probe_rounds_.fetch_add(1);
+
+    if (!failed && p99 <= latency_slo_ms_) {
+        consecutive_failures_.store(0);
+        if (!probes_passing_.exchange(true)) {
+            std::cout << "Readiness probes passing (p99 " << p99 << " ms, SLO "
+                      << latency_slo_ms_ << " ms)" << std::endl;
+        }
+    } else if (consecutive_failures_.fetch_add(1) + 1 >= failure_threshold_) {
+        if (probes_passing_.exchange(false)) {
+            std::cerr << "WARNING: readiness probes over SLO (p99 " << p99 << " ms, SLO "
+                      << latency_slo_ms_ << " ms), reporting not ready" << std::endl;
+        }
+    }
+}
+
+void ReadinessGate::stop() {
+    {
+        std::lock_guard<std::mutex> lock(probe_mutex_);
+        probing_ = false;
+    }
+    phase_.store(Phase::SHUTTING_DOWN, std::memory_order_release);
+    probe_condition_.notify_all();
+    if (probe_thread_.joinable()) {
+        probe_thread_.join();
+    }
+}
+
+bool ReadinessGate::is_ready() const {
+    return phase() == Phase::PROBING && engine_healthy_.load() && probes_passing_.load();
+}
+
+nlohmann::json ReadinessGate::get_status() const {
+    Phase current = phase();
+    bool ready = is_ready();
+
+    std::string reason;
+    if (!ready) {
+        if (current != Phase::PROBING) {
+            reason = std::string("startup phase ") + phase_name(current);
+        } else if (!engine_healthy_.load()) {
+            reason = "search engine unhealthy";
+        } else if (probe_rounds_.load() == 0) {
+            reason = "waiting for first latency probe";
+        } else {
+            reason = "probe p99 " + std::to_string(last_probe_p99_ms_.load()) +
+                     " ms exceeds SLO " + std::to_string(latency_slo_ms_) + " ms";
+        }
+    }
+
+    uint64_t total = bytes_total_.load();
+    nlohmann::json status;
+    status["ready"] = ready;
+    status["phase"] = phase_name(current);
+    status["reason"] = reason;
+    status["bytes_total"] = total;
+    status["bytes_prefaulted"] = bytes_prefaulted_.load();
+    status["prefault_percent"] = total > 0 ? 100.0 * bytes_prefaulted_.load() / total : 0.0;
+    status["resident_percent"] = 100.0 * resident_fraction();
+    status["memory_locked"] = memory_locked_.load();
+    status["probe_p99_ms"] = last_probe_p99_ms_.load();
+    status["latency_slo_ms"] = latency_slo_ms_;
+    status["probe_rounds"] = probe_rounds_.load();
+    status["consecutive_slow_rounds"] = consecutive_failures_.load();
+    return status;
+}
+
+std::vector<MemoryRegion> index_memory_regions(const faiss::Index* index) {
+    std::vector<MemoryRegion> regions;
+    auto add_flat = [&regions](const faiss::Index* storage) {
+        if (auto* flat = dynamic_cast<const faiss::IndexFlatCodes*>(storage)) {
+            regions.push_back({flat->codes.data(), flat->codes.size()});
+        }
+    };
+
+    if (auto* disk = dynamic_cast<const DiskAnnIndex*>(index)) {
+        // Graph and full vectors stay on SSD; only the navigation data is resident
+        return disk->memory_regions();
+    }
+
+    if (auto* ivf = dynamic_cast<const faiss::IndexIVF*>(index)) {
+        add_flat(ivf->quantizer);
+        if (auto* tiered = dynamic_cast<TieredInvertedLists*>(ivf->invlists)) {
+            // Only the hot tier is meant to be resident; cold lists stay on disk
+            auto hot = tiered->hot_regions();
+            regions.insert(regions.end(), hot.begin(), hot.end());
+            return regions;
+        }
+        for (size_t list_no = 0; list_no < ivf->nlist; ++list_no) {
+            size_t list_size = ivf->invlists->list_size(list_no);
+            if (list_size == 0) {
+                continue;
+            }
+            // Pointers stay valid for in-memory and mmap-backed lists alike
+            const uint8_t* codes = ivf->invlists->get_codes(list_no);
+            const faiss::idx_t* ids = ivf->invlists->get_ids(list_no);
+            regions.push_back({codes, list_size * ivf->invlists->code_size});
+            regions.push_back({ids, list_size * sizeof(faiss::idx_t)});
+            ivf->invlists->release_codes(list_no, codes);
+            ivf->invlists->release_ids(list_no, ids);
+        }
+    } else if (auto* hnsw_index = dynamic_cast<const faiss::IndexHNSW*>(index)) {
+        const faiss::HNSW& hnsw = hnsw_index->hnsw;
+        regions.push_back({hnsw.neighbors.data(), hnsw.neighbors.size() * sizeof(faiss::HNSW::storage_idx_t)});
+        regions.push_back({hnsw.offsets.data(), hnsw.offsets.size() * sizeof(size_t)});
+        regions.push_back({hnsw.levels.data(), hnsw.levels.size() * sizeof(int)});
+        add_flat(hnsw_index->storage);
+    } else {
+        add_flat(index);
+    }
+
+    return regions;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+std::vector<MemoryRegion> VectorSearchEngine::get_index_memory_regions() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    // With a delta index these describe the current main index only; a
+    // merge or reload replaces it, so callers re-query rather than cache regions
+    auto base = base_index();
+    return index_memory_regions(base.get());
+}
+
+} // namespace neurorag
@@ -0,0 +1,385 @@
+/**
+ * @file result_codec.cpp
+ * @brief Compact binary encoding of cached SearchResults
+ */
+
+#include "result_codec.h"
+#include "checksum.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace neurorag {
+
+namespace result_codec {
+
+namespace {
+
+constexpr size_t kHeaderSize = 4;
+constexpr size_t kChecksumSize = 4;
+constexpr float kMaxHalf = 65504.0f;
+
+uint32_t float_bits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bits_float(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint64_t zigzag_encode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzag_decode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void put_varint(std::string& out, uint64_t value) {
+    char buffer[10];
+    size_t length = 0;
+    while (value >= 0x80) {
+        buffer[length++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = static_cast<char>(value);
+    out.append(buffer, length);
+}
+
+void put_bytes(std::string& out, const void* data, size_t size) {
+    out.append(static_cast<const char*>(data), size);
+}
+
+/**
+ * Bounds-checked cursor over an encoded value
+ */
+struct Reader {
+    const uint8_t* position;
+    const uint8_t* end;
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < end; shift += 7) {
+            uint8_t byte = *position++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool bytes(void* out, size_t size) {
+        if (static_cast<size_t>(end - position) < size) {
+            return false;
+        }
+        std::memcpy(out, position, size);
+        position += size;
+        return true;
+    }
+
+    size_t remaining() const { return static_cast<size_t>(end - position); }
+};
+
+void encode_fp16(const float* scores, size_t count, std::string& out) {
+    size_t offset = out.size();
+    out.resize(offset + count * sizeof(uint16_t));
+    auto* dst = reinterpret_cast<uint8_t*>(&out[offset]);
+
+    size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(scores + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * sizeof(uint16_t)), halves);
+    }
+#endif
+    for (; i < count; ++i) {
+        uint16_t half = float_to_half(scores[i]);
+        std::memcpy(dst + i * sizeof(uint16_t), &half, sizeof(half));
+    }
+}
+
+void decode_fp16(const uint8_t* src, size_t count, float* scores) {
+    size_t i = 0;
+#ifdef __F16C__
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(uint16_t)));
+        _mm256_storeu_ps(scores + i, _mm256_cvtph_ps(halves));
+    }
+#endif
+    for (; i < count; ++i) {
+        uint16_t half;
+        std::memcpy(&half, src + i * sizeof(uint16_t), sizeof(half));
+        scores[i] = half_to_float(half);
+    }
+}
+
+} // namespace
+
+uint16_t float_to_half(float value) {
+    const uint32_t f32_infinity = 255u << 23;
+    const uint32_t f16_overflow = (127u + 16u) << 23;
+    const uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t bits = float_bits(value);
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= f16_overflow) {
+        half = bits > f32_infinity ? 0x7E00 : 0x7C00;
+    } else if (bits < (113u << 23)) {
+        // Result is subnormal or zero; let the FPU do the rounding
+        half = static_cast<uint16_t>(float_bits(bits_float(bits) + bits_float(denorm_magic)) - denorm_magic);
+    } else {
+        uint32_t mantissa_odd = (bits >> 13) & 1u;
+        bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFu;
+        bits += mantissa_odd;
+        half = static_cast<uint16_t>(bits >> 13);
+    }
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+float half_to_float(uint16_t value) {
+    const uint32_t shifted_exponent = 0x7C00u << 13;
+
+    uint32_t bits = (value & 0x7FFFu) << 13;
+    uint32_t exponent = shifted_exponent & bits;
+    bits += (127u - 15u) << 23;
+
+    if (exponent == shifted_exponent) {
+        bits += (128u - 16u) << 23;
+    } else if (exponent == 0) {
+        bits += 1u << 23;
+        bits = float_bits(bits_float(bits) - bits_float(113u << 23));
+    }
+    bits |= static_cast<uint32_t>(value & 0x8000u) << 16;
+    return bits_float(bits);
+}
+
+std::string encode(const SearchResult& result,
+                   const CacheDependency* dependency,
+                   bool fp16_scores,
+                   MetadataMode metadata_mode) {
+    const size_t count = std::min(result.indices.size(), result.scores.size());
+
+    if (fp16_scores) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!std::isfinite(result.scores[i]) || std::fabs(result.scores[i]) > kMaxHalf) {
+                fp16_scores = false;
+                break;
+            }
+        }
+    }
+    if (metadata_mode == MetadataMode::INLINE && result.metadata.size() < count) {
+        metadata_mode = MetadataMode::NONE;
+    }
+
+    uint8_t flags = 0;
+    if (fp16_scores) flags |= kScoresFp16;
+    if (dependency) flags |= kHasDependency;
+    if (metadata_mode == MetadataMode::REFERENCE) flags |= kMetadataReferenced;
+    if (metadata_mode == MetadataMode::INLINE) flags |= kMetadataInline;
+
+    std::string out;
+    out.reserve(kHeaderSize + 10 + count * (3 + (fp16_scores ? 2 : 4)) + kChecksumSize +
+                (dependency ? 16 + dependency->list_versions.size() * 4 : 0));
+
+    uint16_t magic = kMagic;
+    put_bytes(out, &magic, sizeof(magic));
+    out.push_back(static_cast<char>(kVersion));
+    out.push_back(static_cast<char>(flags));
+    put_varint(out, count);
+
+    int64_t previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+        put_varint(out, zigzag_encode(result.indices[i] - previous));
+        previous = result.indices[i];
+    }
+
+    if (fp16_scores) {
+        encode_fp16(result.scores.data(), count, out);
+    } else {
+        put_bytes(out, result.scores.data(), count * sizeof(float));
+    }
+
+    if (dependency) {
+        put_varint(out, dependency->epoch);
+        put_varint(out, dependency->global_version);
+        put_varint(out, dependency->delta_version);
+        put_varint(out, dependency->list_versions.size());
+        int64_t previous_list = 0;
+        for (const auto& entry : dependency->list_versions) {
+            put_varint(out, zigzag_encode(entry.first - previous_list));
+            put_varint(out, entry.second);
+            previous_list = entry.first;
+        }
+    }
+
+    if (metadata_mode == MetadataMode::INLINE) {
+        for (size_t i = 0; i < count; ++i) {
+            put_varint(out, result.metadata[i].size());
+            out.append(result.metadata[i]);
+        }
+    }
+
+    uint32_t checksum = crc32c(out.data(), out.size());
+    put_bytes(out, &checksum, sizeof(checksum));
+    return out;
+}
+
+bool decode(const void* data, size_t size,
+            SearchResult& result,
+            CacheDependency* dependency,
+            const MetadataResolver& resolver) {
+    if (size < kHeaderSize + 1 + kChecksumSize) {
+        return false;
+    }
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    const size_t body_size = size - kChecksumSize;
+
+    uint16_t magic;
+    std::memcpy(&magic, bytes, sizeof(magic));
+    if (magic != kMagic || bytes[2] != kVersion) {
+        return false;
+    }
+    const uint8_t flags = bytes[3];
+
+    uint32_t stored_checksum;
+    std::memcpy(&stored_checksum, bytes + body_size, sizeof(stored_checksum));
+    if (crc32c(bytes, body_size) != stored_checksum) {
+        return false;
+    }
+
+    Reader reader{bytes + kHeaderSize, bytes + body_size};
+
+    uint64_t count;
+    // Every id takes at least one byte, which bounds a corrupt count
+    if (!reader.varint(count) || count > reader.remaining()) {
+        return false;
+    }
+
+    result.indices.resize(count);
+    result.scores.resize(count);
+    result.metadata.clear();
+    result.latency_ms = 0.0;
+    result.from_cache = true;
+
+    int64_t previous = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t delta;
+        if (!reader.varint(delta)) {
+            return false;
+        }
+        previous += zigzag_decode(delta);
+        result.indices[i] = previous;
+    }
+
+    if (flags & kScoresFp16) {
+        if (reader.remaining() < count * sizeof(uint16_t)) {
+            return false;
+        }
+        decode_fp16(reader.position, count, result.scores.data());
+        reader.position += count * sizeof(uint16_t);
+    } else if (!reader.bytes(result.scores.data(), count * sizeof(float))) {
+        return false;
+    }
+
+    if (dependency) {
+        *dependency = CacheDependency{};
+    }
+    if (flags & kHasDependency) {
+        CacheDependency parsed;
+        uint64_t num_lists;
+        if (!reader.varint(parsed.epoch) || !reader.varint(parsed.global_version) ||
+            !reader.varint(parsed.delta_version) || !reader.varint(num_lists) || num_lists > reader.remaining()) {
+            return false;
+        }
+        parsed.list_versions.resize(num_lists);
+        int64_t previous_list = 0;
+        for (auto& entry : parsed.list_versions) {
+            uint64_t delta;
+            if (!reader.varint(delta) || !reader.varint(entry.second)) {
+                return false;
+            }
+            previous_list += zigzag_decode(delta);
+            entry.first = previous_list;
+        }
+        if (dependency) {
+            *dependency = std::move(parsed);
+        }
+    }
+
+    if (flags & kMetadataInline) {
+        result.metadata.resize(count);
+        for (auto& metadata : result.metadata) {
+            uint64_t length;
+            if (!reader.varint(length) || length > reader.remaining()) {
+                return false;
+            }
+            metadata.assign(reinterpret_cast<const char*>(reader.position), length);
+            reader.position += length;
+        }
+    } else if (flags & kMetadataReferenced) {
+        if (!resolver) {
+            return false;
+        }
+        result.metadata.resize(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            if (!resolver(result.indices[i], result.metadata[i])) {
+                return false;
+            }
+        }
+    }
+
+    return reader.remaining() == 0;
+}
+
+} // namespace result_codec
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+std::string VectorSearchEngine::encode_cached_result(const SearchResult& result,
+                                                     const CacheDependency& dependency) {
+    auto mode = result_codec::MetadataMode::NONE;
+    if (!result.metadata.empty()) {
+        mode = result_codec::MetadataMode::REFERENCE;
+        std::lock_guard<std::mutex> lock(metadata_mutex_);
+        for (int64_t id : result.indices) {
+            if (id < 0 || static_cast<size_t>(id) >= metadata_.size()) {
+                mode = result_codec::MetadataMode::INLINE;
+                break;
+            }
+        }
+    }
+    return result_codec::encode(result, &dependency, config_.cache_fp16_scores, mode);
+}
+
+bool VectorSearchEngine::decode_cached_result(const std::string& value,
+                                              SearchResult& result,
+                                              CacheDependency& dependency) {
+    std::lock_guard<std::mutex> lock(metadata_mutex_);
+    return result_codec::decode(value.data(), value.size(), result, &dependency,
+        [this](int64_t id, std::string& metadata) {
+            if (id < 0 || static_cast<size_t>(id) >= metadata_.size()) {
+                return false;
+            }
+            metadata = metadata_[id];
+            return true;
+        });
+}
+
+} // namespace neurorag
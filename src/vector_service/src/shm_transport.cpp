@@ -0,0 +1,309 @@
+/**
+ * @file shm_transport.cpp
+ * @brief Shared-memory request/response transport for co-located clients
+ */
+
+#include "shm_transport.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NEURORAG_CPU_RELAX() _mm_pause()
+#else
+#define NEURORAG_CPU_RELAX() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+namespace neurorag {
+
+namespace shm {
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Futexes live in shared memory, so the process-private variants must not be used
+void futex_wait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeout_us) {
+    struct timespec timeout;
+    struct timespec* timeout_ptr = nullptr;
+    if (timeout_us >= 0) {
+        timeout.tv_sec = timeout_us / 1000000;
+        timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+        timeout_ptr = &timeout;
+    }
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+              timeout_ptr, nullptr, 0);
+}
+
+void futex_wake_all(std::atomic<uint32_t>* word) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX,
+              nullptr, nullptr, 0);
+}
+
+void publish(ShmRing& ring, uint64_t new_head) {
+    ring.head.store(new_head, std::memory_order_release);
+    ring.seq.fetch_add(1, std::memory_order_seq_cst);
+    if (ring.waiters.load(std::memory_order_seq_cst) != 0) {
+        futex_wake_all(&ring.seq);
+    }
+}
+
+// CLOCK_MONOTONIC is per node, not per PID or mount namespace, so the
+// server and clients in other containers read the same clock
+int64_t monotonic_ms() {
+    struct timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+size_t request_slot_size(int dimension) {
+    return align_up(sizeof(ShmRequestSlot) + static_cast<size_t>(dimension) * sizeof(float),
+                    kCacheLine);
+}
+
+size_t response_slot_size(int max_k) {
+    return align_up(sizeof(ShmResponseSlot) +
+                    static_cast<size_t>(max_k) * (sizeof(int64_t) + sizeof(float)),
+                    kCacheLine);
+}
+
+} // namespace shm
+
+namespace {
+
+constexpr int kSpinIterations = 2000;
+
+} // namespace
+
+ShmTransportClient::ShmTransportClient()
+    : base_(nullptr),
+      segment_size_(0),
+      header_(nullptr),
+      channel_(nullptr),
+      request_base_(nullptr),
+      response_base_(nullptr),
+      next_request_id_(1),
+      pending_request_position_(UINT64_MAX),
+      generation_(0),
+      heartbeat_stop_(false) {}
+
+ShmTransportClient::~ShmTransportClient() {
+    detach();
+}
+
+bool ShmTransportClient::attach(const std::string& name) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "ShmTransportClient: shm_open(" << name << ") failed: "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(shm::ShmSegmentHeader)) {
+        ::close(fd);
+        return false;
+    }
+    segment_size_ = static_cast<size_t>(st.st_size);
+    base_ = ::mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base_ == MAP_FAILED) {
+        base_ = nullptr;
+        return false;
+    }
+
+    header_ = static_cast<shm::ShmSegmentHeader*>(base_);
+    if (header_->magic != shm::kSegmentMagic || header_->version != shm::kSegmentVersion ||
+        header_->server_running.load(std::memory_order_acquire) == 0) {
+        std::cerr << "ShmTransportClient: segment " << name << " is not a live transport" << std::endl;
+        detach();
+        return false;
+    }
+
+    auto* channels = static_cast<uint8_t*>(base_) + shm::align_up(sizeof(shm::ShmSegmentHeader), 4096);
+    int32_t pid = static_cast<int32_t>(::getpid());
+    for (uint32_t i = 0; i < header_->num_channels; ++i) {
+        auto* control = reinterpret_cast<shm::ShmChannelControl*>(channels + header_->channel_stride * i);
+        int32_t expected = shm::kChannelFree;
+        if (control->owner_pid.load(std::memory_order_acquire) != expected) {
+            continue;
+        }
+        // Stamp the lease before claiming so the server never sees a claimed channel without one
+        control->lease_ms.store(shm::monotonic_ms(), std::memory_order_release);
+        if (control->owner_pid.compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) {
+            channel_ = control;
+            generation_ = control->generation.load(std::memory_order_acquire);
+            break;
+        }
+    }
+    if (!channel_) {
+        std::cerr << "ShmTransportClient: no free channel in " << name << std::endl;
+        detach();
+        return false;
+    }
+
+    request_base_ = reinterpret_cast<uint8_t*>(channel_) +
+                    shm::align_up(sizeof(shm::ShmChannelControl), shm::kCacheLine);
+    response_base_ = request_base_ + header_->ring_slots * header_->request_slot_size;
+
+    heartbeat_stop_ = false;
+    heartbeat_thread_ = std::thread(&ShmTransportClient::heartbeat_loop, this);
+    return true;
+}
+
+void ShmTransportClient::detach() {
+    if (heartbeat_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(heartbeat_mutex_);
+            heartbeat_stop_ = true;
+        }
+        heartbeat_cv_.notify_all();
+        heartbeat_thread_.join();
+    }
+    if (channel_) {
+        // The server resets the rings once its in-flight completions drain;
+        // a channel already reclaimed may belong to another client by now
+        if (owns_channel()) {
+            channel_->owner_pid.store(shm::kChannelDetached, std::memory_order_release);
+        }
+        channel_ = nullptr;
+    }
+    if (base_) {
+        ::munmap(base_, segment_size_);
+        base_ = nullptr;
+    }
+    header_ = nullptr;
+}
+
+bool ShmTransportClient::owns_channel() const {
+    return channel_->generation.load(std::memory_order_acquire) == generation_;
+}
+
+void ShmTransportClient::heartbeat_loop() {
+    std::unique_lock<std::mutex> lock(heartbeat_mutex_);
+    while (!heartbeat_cv_.wait_for(lock, std::chrono::milliseconds(shm::kHeartbeatIntervalMs),
+                                   [this] { return heartbeat_stop_; })) {
+        if (!owns_channel()) {
+            std::cerr << "ShmTransportClient: channel lease lapsed and was reclaimed" << std::endl;
+            return;
+        }
+        channel_->lease_ms.store(shm::monotonic_ms(), std::memory_order_release);
+    }
+}
+
+float* ShmTransportClient::begin_request() {
+    if (!channel_ || !owns_channel()) {
+        return nullptr;
+    }
+
+    // Bounding requests by free response slots guarantees the server never
+    // has to wait for response space
+    uint64_t head = channel_->requests.head.load(std::memory_order_relaxed);
+    uint64_t response_tail = channel_->responses.tail.load(std::memory_order_relaxed);
+    if (head - response_tail >= header_->ring_slots) {
+        return nullptr;
+    }
+
+    pending_request_position_ = head;
+    uint8_t* slot = request_base_ + (head & (header_->ring_slots - 1)) * header_->request_slot_size;
+    return reinterpret_cast<float*>(slot + sizeof(shm::ShmRequestSlot));
+}
+
+uint64_t ShmTransportClient::commit_request(int k, float threshold) {
+    if (!channel_ || pending_request_position_ == UINT64_MAX) {
+        return 0;
+    }
+
+    uint64_t position = pending_request_position_;
+    pending_request_position_ = UINT64_MAX;
+    if (!owns_channel()) {
+        return 0;
+    }
+
+    shm::ShmRequestSlot meta{};
+    meta.request_id = next_request_id_++;
+    meta.k = k;
+    meta.threshold = threshold;
+    std::memcpy(request_base_ + (position & (header_->ring_slots - 1)) * header_->request_slot_size,
+                &meta, sizeof(meta));
+
+    shm::publish(channel_->requests, position + 1);
+
+    header_->doorbell.fetch_add(1, std::memory_order_seq_cst);
+    if (header_->server_waiting.load(std::memory_order_seq_cst) != 0) {
+        shm::futex_wake_all(&header_->doorbell);
+    }
+    return meta.request_id;
+}
+
+bool ShmTransportClient::wait_response(shm::ResponseView& view, int64_t timeout_us) {
+    if (!channel_) {
+        return false;
+    }
+
+    auto& ring = channel_->responses;
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+
+    int spins = 0;
+    while (ring.head.load(std::memory_order_acquire) == tail) {
+        if (header_->server_running.load(std::memory_order_acquire) == 0 || !owns_channel()) {
+            return false;
+        }
+        if (++spins < kSpinIterations) {
+            NEURORAG_CPU_RELAX();
+            continue;
+        }
+
+        int64_t remaining_us = -1;
+        if (timeout_us >= 0) {
+            remaining_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remaining_us <= 0) {
+                return false;
+            }
+        }
+
+        uint32_t seq = ring.seq.load(std::memory_order_seq_cst);
+        ring.waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (ring.head.load(std::memory_order_seq_cst) == tail) {
+            shm::futex_wait(&ring.seq, seq, remaining_us);
+        }
+        ring.waiters.fetch_sub(1, std::memory_order_seq_cst);
+        spins = 0;
+    }
+
+    const uint8_t* slot = response_base_ + (tail & (header_->ring_slots - 1)) * header_->response_slot_size;
+    shm::ShmResponseSlot meta;
+    std::memcpy(&meta, slot, sizeof(meta));
+
+    const auto* ids = reinterpret_cast<const int64_t*>(slot + sizeof(shm::ShmResponseSlot));
+    view.request_id = meta.request_id;
+    view.status = static_cast<shm::ResponseStatus>(meta.status);
+    view.count = meta.count;
+    view.latency_ms = meta.latency_ms;
+    view.ids = ids;
+    view.scores = reinterpret_cast<const float*>(ids + header_->max_k);
+    view.error = view.status == shm::ResponseStatus::OK ? nullptr : reinterpret_cast<const char*>(ids);
+    return true;
+}
+
+void ShmTransportClient::release_response() {
+    if (!channel_) {
+        return;
+    }
+    auto& ring = channel_->responses;
+    ring.tail.store(ring.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+} // namespace neurorag
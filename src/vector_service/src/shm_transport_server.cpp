@@ -0,0 +1,359 @@
+/**
+ * @file shm_transport_server.cpp
+ * @brief Shared-memory transport server executing queries via MicroBatcher
+ */
+
+#include "shm_transport.h"
+#include "micro_batcher.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NEURORAG_CPU_RELAX() _mm_pause()
+#else
+#define NEURORAG_CPU_RELAX() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+namespace neurorag {
+
+namespace {
+
+constexpr int kSpinIterations = 2000;
+constexpr int64_t kServerIdleWaitUs = 10000;
+
+} // namespace
+
+ShmTransportServer::ShmTransportServer(const std::string& name, MicroBatcher* batcher,
+                                       int dimension, int max_k,
+                                       int num_channels, int ring_slots)
+    : name_(name),
+      batcher_(batcher),
+      dimension_(dimension),
+      max_k_(std::max(1, max_k)),
+      num_channels_(std::max(1, num_channels)),
+      ring_slots_(std::max(2, ring_slots)),
+      shm_fd_(-1),
+      base_(nullptr),
+      segment_size_(0),
+      header_(nullptr),
+      response_mutexes_(new std::mutex[std::max(1, num_channels)]),
+      channel_in_flight_(new std::atomic<uint32_t>[std::max(1, num_channels)]),
+      running_(false),
+      requests_received_(0),
+      responses_sent_(0),
+      channels_reclaimed_(0) {
+    // Positions are reduced modulo ring_slots with a mask
+    while ((ring_slots_ & (ring_slots_ - 1)) != 0) {
+        ++ring_slots_;
+    }
+    for (int i = 0; i < num_channels_; ++i) {
+        channel_in_flight_[i].store(0);
+    }
+}
+
+ShmTransportServer::~ShmTransportServer() {
+    stop();
+}
+
+bool ShmTransportServer::start() {
+    size_t control_size = shm::align_up(sizeof(shm::ShmChannelControl), shm::kCacheLine);
+    size_t request_size = shm::request_slot_size(dimension_);
+    size_t response_size = shm::response_slot_size(max_k_);
+    size_t stride = shm::align_up(control_size + ring_slots_ * (request_size + response_size), 4096);
+    size_t header_size = shm::align_up(sizeof(shm::ShmSegmentHeader), 4096);
+    segment_size_ = header_size + stride * num_channels_;
+
+    // A segment left behind by a crashed server is replaced, not reused
+    ::shm_unlink(name_.c_str());
+    shm_fd_ = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (shm_fd_ < 0) {
+        std::cerr << "ShmTransportServer: shm_open(" << name_ << ") failed: "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (::ftruncate(shm_fd_, static_cast<off_t>(segment_size_)) != 0) {
+        std::cerr << "ShmTransportServer: ftruncate failed: " << std::strerror(errno) << std::endl;
+        ::close(shm_fd_);
+        ::shm_unlink(name_.c_str());
+        shm_fd_ = -1;
+        return false;
+    }
+
+    base_ = ::mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, shm_fd_, 0);
+    if (base_ == MAP_FAILED) {
+        std::cerr << "ShmTransportServer: mmap failed: " << std::strerror(errno) << std::endl;
+        base_ = nullptr;
+        ::close(shm_fd_);
+        ::shm_unlink(name_.c_str());
+        shm_fd_ = -1;
+        return false;
+    }
+
+    header_ = new (base_) shm::ShmSegmentHeader();
+    header_->magic = shm::kSegmentMagic;
+    header_->version = shm::kSegmentVersion;
+    header_->dimension = static_cast<uint32_t>(dimension_);
+    header_->max_k = static_cast<uint32_t>(max_k_);
+    header_->num_channels = static_cast<uint32_t>(num_channels_);
+    header_->ring_slots = static_cast<uint32_t>(ring_slots_);
+    header_->channel_stride = stride;
+    header_->request_slot_size = request_size;
+    header_->response_slot_size = response_size;
+    header_->server_pid = static_cast<int32_t>(::getpid());
+    header_->doorbell.store(0);
+    header_->server_waiting.store(0);
+
+    for (int i = 0; i < num_channels_; ++i) {
+        new (channel(i)) shm::ShmChannelControl();
+        reset_channel(i);
+    }
+
+    running_.store(true);
+    header_->server_running.store(1, std::memory_order_release);
+    poll_thread_ = std::thread(&ShmTransportServer::poll_loop, this);
+    return true;
+}
+
+void ShmTransportServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    header_->server_running.store(0, std::memory_order_release);
+    header_->doorbell.fetch_add(1);
+    shm::futex_wake_all(&header_->doorbell);
+    if (poll_thread_.joinable()) {
+        poll_thread_.join();
+    }
+
+    // Wait for completions still writing into the segment before unmapping it
+    for (int i = 0; i < num_channels_; ++i) {
+        while (channel_in_flight_[i].load() != 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        shm::futex_wake_all(&channel(i)->responses.seq);
+    }
+
+    ::munmap(base_, segment_size_);
+    ::close(shm_fd_);
+    ::shm_unlink(name_.c_str());
+    base_ = nullptr;
+    header_ = nullptr;
+    shm_fd_ = -1;
+}
+
+nlohmann::json ShmTransportServer::get_statistics() const {
+    nlohmann::json stats;
+    int attached = 0;
+    if (header_) {
+        for (int i = 0; i < num_channels_; ++i) {
+            if (channel(i)->owner_pid.load() > 0) {
+                ++attached;
+            }
+        }
+    }
+    stats["segment_name"] = name_;
+    stats["segment_size_bytes"] = segment_size_;
+    stats["channels"] = num_channels_;
+    stats["attached_clients"] = attached;
+    stats["ring_slots"] = ring_slots_;
+    stats["requests_received"] = requests_received_.load();
+    stats["responses_sent"] = responses_sent_.load();
+    stats["channels_reclaimed"] = channels_reclaimed_.load();
+    return stats;
+}
+
+shm::ShmChannelControl* ShmTransportServer::channel(int index) const {
+    auto* base = static_cast<uint8_t*>(base_) + shm::align_up(sizeof(shm::ShmSegmentHeader), 4096);
+    return reinterpret_cast<shm::ShmChannelControl*>(base + header_->channel_stride * index);
+}
+
+uint8_t* ShmTransportServer::request_slot(int index, uint64_t position) const {
+    auto* base = reinterpret_cast<uint8_t*>(channel(index)) +
+                 shm::align_up(sizeof(shm::ShmChannelControl), shm::kCacheLine);
+    return base + (position & (ring_slots_ - 1)) * header_->request_slot_size;
+}
+
+uint8_t* ShmTransportServer::response_slot(int index, uint64_t position) const {
+    auto* base = reinterpret_cast<uint8_t*>(channel(index)) +
+                 shm::align_up(sizeof(shm::ShmChannelControl), shm::kCacheLine) +
+                 ring_slots_ * header_->request_slot_size;
+    return base + (position & (ring_slots_ - 1)) * header_->response_slot_size;
+}
+
+void ShmTransportServer::reset_channel(int index) {
+    auto* control = channel(index);
+    control->requests.head.store(0);
+    control->requests.tail.store(0);
+    control->requests.seq.store(0);
+    control->requests.waiters.store(0);
+    control->responses.head.store(0);
+    control->responses.tail.store(0);
+    control->responses.seq.store(0);
+    control->responses.waiters.store(0);
+    control->lease_ms.store(0);
+    // A client still holding the channel sees the new generation and stops using it
+    control->generation.fetch_add(1, std::memory_order_acq_rel);
+    control->owner_pid.store(shm::kChannelFree, std::memory_order_release);
+}
+
+void ShmTransportServer::poll_loop() {
+    int idle_spins = 0;
+    auto last_reclaim = std::chrono::steady_clock::now();
+
+    while (running_.load()) {
+        uint32_t doorbell = header_->doorbell.load(std::memory_order_seq_cst);
+
+        bool did_work = false;
+        for (int i = 0; i < num_channels_; ++i) {
+            did_work |= drain_channel(i);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_reclaim > std::chrono::seconds(1)) {
+            reclaim_channels();
+            last_reclaim = now;
+        }
+
+        if (did_work) {
+            idle_spins = 0;
+            continue;
+        }
+        if (++idle_spins < kSpinIterations) {
+            NEURORAG_CPU_RELAX();
+            continue;
+        }
+
+        // Announce the sleep, then re-check so a concurrent commit is not missed
+        header_->server_waiting.store(1, std::memory_order_seq_cst);
+        bool pending = false;
+        for (int i = 0; i < num_channels_ && !pending; ++i) {
+            auto* control = channel(i);
+            pending = control->requests.head.load(std::memory_order_acquire) !=
+                      control->requests.tail.load(std::memory_order_relaxed);
+        }
+        if (!pending) {
+            shm::futex_wait(&header_->doorbell, doorbell, kServerIdleWaitUs);
+        }
+        header_->server_waiting.store(0, std::memory_order_relaxed);
+        idle_spins = 0;
+    }
+}
+
+bool ShmTransportServer::drain_channel(int index) {
+    auto* control = channel(index);
+    if (control->owner_pid.load(std::memory_order_acquire) <= 0) {
+        return false;
+    }
+
+    uint64_t tail = control->requests.tail.load(std::memory_order_relaxed);
+    uint64_t head = control->requests.head.load(std::memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+
+    for (; tail != head; ++tail) {
+        const uint8_t* slot = request_slot(index, tail);
+        shm::ShmRequestSlot meta;
+        std::memcpy(&meta, slot, sizeof(meta));
+
+        // The engine API takes owned vectors, so this is the one copy per query
+        SearchRequest request;
+        const auto* query = reinterpret_cast<const float*>(slot + sizeof(shm::ShmRequestSlot));
+        request.query_vector.assign(query, query + dimension_);
+        request.k = std::min(std::max(meta.k, 1), max_k_);
+        request.threshold = meta.threshold;
+        request.request_id = std::to_string(meta.request_id);
+
+        requests_received_.fetch_add(1, std::memory_order_relaxed);
+        channel_in_flight_[index].fetch_add(1);
+
+        uint64_t request_id = meta.request_id;
+        bool accepted = batcher_->submit(std::move(request),
+            [this, index, request_id](const SearchResult& result, const std::string& error) {
+                if (error.empty()) {
+                    publish_response(index, request_id, shm::ResponseStatus::OK,
+                                     result.indices, result.scores, result.latency_ms, error);
+                } else {
+                    publish_response(index, request_id, shm::ResponseStatus::ERROR,
+                                     {}, {}, 0.0, error);
+                }
+                channel_in_flight_[index].fetch_sub(1);
+            });
+
+        if (!accepted) {
+            publish_response(index, request_id, shm::ResponseStatus::ERROR,
+                             {}, {}, 0.0, "server shutting down");
+            channel_in_flight_[index].fetch_sub(1);
+        }
+    }
+
+    // Request slots are free as soon as their contents are copied out
+    control->requests.tail.store(tail, std::memory_order_release);
+    return true;
+}
+
+void ShmTransportServer::reclaim_channels() {
+    int64_t now_ms = shm::monotonic_ms();
+    for (int i = 0; i < num_channels_; ++i) {
+        auto* control = channel(i);
+        int32_t owner = control->owner_pid.load(std::memory_order_acquire);
+
+        // A client that stopped heartbeating crashed or hung; its PID says
+        // nothing from another container's PID namespace
+        bool expired = now_ms - control->lease_ms.load(std::memory_order_acquire) > shm::kLeaseTimeoutMs;
+        bool abandoned = owner == shm::kChannelDetached || (owner > 0 && expired);
+        if (abandoned && channel_in_flight_[i].load() == 0) {
+            reset_channel(i);
+            channels_reclaimed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ShmTransportServer::publish_response(int index, uint64_t request_id, shm::ResponseStatus status,
+                                          const std::vector<int64_t>& ids,
+                                          const std::vector<float>& scores,
+                                          double latency_ms, const std::string& error) {
+    std::lock_guard<std::mutex> lock(response_mutexes_[index]);
+    auto* control = channel(index);
+    if (control->owner_pid.load(std::memory_order_acquire) <= 0) {
+        return;
+    }
+
+    uint64_t head = control->responses.head.load(std::memory_order_relaxed);
+    uint8_t* slot = response_slot(index, head);
+
+    shm::ShmResponseSlot meta{};
+    meta.request_id = request_id;
+    meta.status = static_cast<uint32_t>(status);
+    meta.latency_ms = latency_ms;
+
+    auto* ids_out = reinterpret_cast<int64_t*>(slot + sizeof(shm::ShmResponseSlot));
+    auto* scores_out = reinterpret_cast<float*>(ids_out + max_k_);
+    if (status == shm::ResponseStatus::OK) {
+        meta.count = static_cast<uint32_t>(std::min({ids.size(), scores.size(),
+                                                     static_cast<size_t>(max_k_)}));
+        std::memcpy(ids_out, ids.data(), meta.count * sizeof(int64_t));
+        std::memcpy(scores_out, scores.data(), meta.count * sizeof(float));
+    } else {
+        size_t length = std::min(error.size(), static_cast<size_t>(max_k_) * sizeof(int64_t) - 1);
+        std::memcpy(ids_out, error.data(), length);
+        reinterpret_cast<char*>(ids_out)[length] = '\0';
+    }
+    std::memcpy(slot, &meta, sizeof(meta));
+
+    shm::publish(control->responses, head + 1);
+    responses_sent_.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace neurorag
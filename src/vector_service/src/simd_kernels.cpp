@@ -0,0 +1,401 @@
+/**
+ * @file simd_kernels.cpp
+ * @brief Vectorized float kernels shared by preprocessing and re-scoring
+ */
+
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define NEURORAG_SIMD_AVX2 1
+#endif
+
+namespace neurorag {
+namespace simd {
+
+#ifdef NEURORAG_SIMD_AVX2
+
+namespace {
+
+inline float horizontal_sum(__m256 v) {
+    __m128 low = _mm256_castps256_ps128(v);
+    __m128 high = _mm256_extractf128_ps(v, 1);
+    low = _mm_add_ps(low, high);
+    low = _mm_add_ps(low, _mm_movehl_ps(low, low));
+    low = _mm_add_ss(low, _mm_shuffle_ps(low, low, 0x55));
+    return _mm_cvtss_f32(low);
+}
+
+inline int32_t horizontal_sum(__m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+// 32 int8 products of x and w summed into eight int32 lanes; abs_x is |x|.
+// maddubs multiplies unsigned by signed bytes, so the sign of x moves to w
+inline __m256i dot_q8_step(__m256i abs_x, __m256i x, __m256i w, __m256i acc) {
+    __m256i pairs = _mm256_maddubs_epi16(abs_x, _mm256_sign_epi8(w, x));
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+}
+
+int32_t dot_q8(const int8_t* a, const int8_t* b, size_t k) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t p = 0;
+    for (; p + 32 <= k; p += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + p));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + p));
+        acc = dot_q8_step(_mm256_sign_epi8(x, x), x, w, acc);
+    }
+    int32_t sum = horizontal_sum(acc);
+    for (; p < k; ++p) {
+        sum += int32_t{a[p]} * b[p];
+    }
+    return sum;
+}
+
+} // namespace
+
+float dot(const float* a, const float* b, size_t d) {
+    // Independent accumulators hide the FMA latency
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    if (i + 8 <= d) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        i += 8;
+    }
+    float sum = horizontal_sum(_mm256_add_ps(sum0, sum1));
+    for (; i < d; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+float l2_sqr(const float* a, const float* b, size_t d) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= d; i += 16) {
+        __m256 diff0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 diff1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        sum0 = _mm256_fmadd_ps(diff0, diff0, sum0);
+        sum1 = _mm256_fmadd_ps(diff1, diff1, sum1);
+    }
+    if (i + 8 <= d) {
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        sum0 = _mm256_fmadd_ps(diff, diff, sum0);
+        i += 8;
+    }
+    float sum = horizontal_sum(_mm256_add_ps(sum0, sum1));
+    for (; i < d; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void scale_sub(const float* x, float factor, const float* offset, float* y, size_t d) {
+    __m256 f = _mm256_set1_ps(factor);
+    size_t i = 0;
+    if (offset) {
+        for (; i + 8 <= d; i += 8) {
+            _mm256_storeu_ps(y + i, _mm256_fmsub_ps(_mm256_loadu_ps(x + i), f, _mm256_loadu_ps(offset + i)));
+        }
+        for (; i < d; ++i) {
+            y[i] = x[i] * factor - offset[i];
+        }
+        return;
+    }
+    for (; i + 8 <= d; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), f));
+    }
+    for (; i < d; ++i) {
+        y[i] = x[i] * factor;
+    }
+}
+
+void gemv(const float* matrix, size_t rows, size_t cols, const float* x,
+          float factor, const float* offset, float* y) {
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const float* m0 = matrix + r * cols;
+        const float* m1 = m0 + cols;
+        const float* m2 = m1 + cols;
+        const float* m3 = m2 + cols;
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        __m256 sum2 = _mm256_setzero_ps();
+        __m256 sum3 = _mm256_setzero_ps();
+        size_t c = 0;
+        for (; c + 8 <= cols; c += 8) {
+            __m256 v = _mm256_loadu_ps(x + c);
+            sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(m0 + c), v, sum0);
+            sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(m1 + c), v, sum1);
+            sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(m2 + c), v, sum2);
+            sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(m3 + c), v, sum3);
+        }
+        float out[4] = {horizontal_sum(sum0), horizontal_sum(sum1), horizontal_sum(sum2), horizontal_sum(sum3)};
+        for (; c < cols; ++c) {
+            out[0] += m0[c] * x[c];
+            out[1] += m1[c] * x[c];
+            out[2] += m2[c] * x[c];
+            out[3] += m3[c] * x[c];
+        }
+        for (size_t k = 0; k < 4; ++k) {
+            y[r + k] = out[k] * factor - (offset ? offset[r + k] : 0.0f);
+        }
+    }
+    for (; r < rows; ++r) {
+        y[r] = dot(matrix + r * cols, x, cols) * factor - (offset ? offset[r] : 0.0f);
+    }
+}
+
+void gemm_nt(const float* a, size_t m, const float* b, size_t n, size_t k,
+             const float* bias, float* c, size_t ldc) {
+    size_t i = 0;
+    for (; i + 2 <= m; i += 2) {
+        const float* a0 = a + i * k;
+        const float* a1 = a0 + k;
+        size_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            const float* b0 = b + j * k;
+            const float* b1 = b0 + k;
+            const float* b2 = b1 + k;
+            const float* b3 = b2 + k;
+            __m256 s00 = _mm256_setzero_ps(), s01 = _mm256_setzero_ps();
+            __m256 s02 = _mm256_setzero_ps(), s03 = _mm256_setzero_ps();
+            __m256 s10 = _mm256_setzero_ps(), s11 = _mm256_setzero_ps();
+            __m256 s12 = _mm256_setzero_ps(), s13 = _mm256_setzero_ps();
+            size_t p = 0;
+            for (; p + 8 <= k; p += 8) {
+                __m256 x0 = _mm256_loadu_ps(a0 + p);
+                __m256 x1 = _mm256_loadu_ps(a1 + p);
+                __m256 w = _mm256_loadu_ps(b0 + p);
+                s00 = _mm256_fmadd_ps(x0, w, s00);
+                s10 = _mm256_fmadd_ps(x1, w, s10);
+                w = _mm256_loadu_ps(b1 + p);
+                s01 = _mm256_fmadd_ps(x0, w, s01);
+                s11 = _mm256_fmadd_ps(x1, w, s11);
+                w = _mm256_loadu_ps(b2 + p);
+                s02 = _mm256_fmadd_ps(x0, w, s02);
+                s12 = _mm256_fmadd_ps(x1, w, s12);
+                w = _mm256_loadu_ps(b3 + p);
+                s03 = _mm256_fmadd_ps(x0, w, s03);
+                s13 = _mm256_fmadd_ps(x1, w, s13);
+            }
+            float out[2][4] = {
+                {horizontal_sum(s00), horizontal_sum(s01), horizontal_sum(s02), horizontal_sum(s03)},
+                {horizontal_sum(s10), horizontal_sum(s11), horizontal_sum(s12), horizontal_sum(s13)}};
+            for (; p < k; ++p) {
+                out[0][0] += a0[p] * b0[p];
+                out[0][1] += a0[p] * b1[p];
+                out[0][2] += a0[p] * b2[p];
+                out[0][3] += a0[p] * b3[p];
+                out[1][0] += a1[p] * b0[p];
+                out[1][1] += a1[p] * b1[p];
+                out[1][2] += a1[p] * b2[p];
+                out[1][3] += a1[p] * b3[p];
+            }
+            for (size_t r = 0; r < 2; ++r) {
+                for (size_t q = 0; q < 4; ++q) {
+                    c[(i + r) * ldc + j + q] = out[r][q] + (bias ? bias[j + q] : 0.0f);
+                }
+            }
+        }
+        for (; j < n; ++j) {
+            float add = bias ? bias[j] : 0.0f;
+            c[i * ldc + j] = dot(a0, b + j * k, k) + add;
+            c[(i + 1) * ldc + j] = dot(a1, b + j * k, k) + add;
+        }
+    }
+    for (; i < m; ++i) {
+        // A single row is a matrix-vector product
+        float* row = c + i * ldc;
+        gemv(b, n, k, a + i * k, 1.0f, nullptr, row);
+        if (bias) {
+            for (size_t j = 0; j < n; ++j) {
+                row[j] += bias[j];
+            }
+        }
+    }
+}
+
+void gemm_nt_q8(const int8_t* a, const float* a_scales, size_t m,
+                const int8_t* b, const float* b_scales, size_t n, size_t k,
+                const float* bias, float* c, size_t ldc) {
+    size_t i = 0;
+    for (; i + 2 <= m; i += 2) {
+        const int8_t* a0 = a + i * k;
+        const int8_t* a1 = a0 + k;
+        size_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            const int8_t* b0 = b + j * k;
+            const int8_t* b1 = b0 + k;
+            const int8_t* b2 = b1 + k;
+            const int8_t* b3 = b2 + k;
+            __m256i s00 = _mm256_setzero_si256(), s01 = _mm256_setzero_si256();
+            __m256i s02 = _mm256_setzero_si256(), s03 = _mm256_setzero_si256();
+            __m256i s10 = _mm256_setzero_si256(), s11 = _mm256_setzero_si256();
+            __m256i s12 = _mm256_setzero_si256(), s13 = _mm256_setzero_si256();
+            size_t p = 0;
+            for (; p + 32 <= k; p += 32) {
+                __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a0 + p));
+                __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a1 + p));
+                __m256i abs0 = _mm256_sign_epi8(x0, x0);
+                __m256i abs1 = _mm256_sign_epi8(x1, x1);
+                __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b0 + p));
+                s00 = dot_q8_step(abs0, x0, w, s00);
+                s10 = dot_q8_step(abs1, x1, w, s10);
+                w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b1 + p));
+                s01 = dot_q8_step(abs0, x0, w, s01);
+                s11 = dot_q8_step(abs1, x1, w, s11);
+                w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b2 + p));
+                s02 = dot_q8_step(abs0, x0, w, s02);
+                s12 = dot_q8_step(abs1, x1, w, s12);
+                w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b3 + p));
+                s03 = dot_q8_step(abs0, x0, w, s03);
+                s13 = dot_q8_step(abs1, x1, w, s13);
+            }
+            int32_t out[2][4] = {
+                {horizontal_sum(s00), horizontal_sum(s01), horizontal_sum(s02), horizontal_sum(s03)},
+                {horizontal_sum(s10), horizontal_sum(s11), horizontal_sum(s12), horizontal_sum(s13)}};
+            for (; p < k; ++p) {
+                for (size_t q = 0; q < 4; ++q) {
+                    out[0][q] += int32_t{a0[p]} * b[(j + q) * k + p];
+                    out[1][q] += int32_t{a1[p]} * b[(j + q) * k + p];
+                }
+            }
+            for (size_t r = 0; r < 2; ++r) {
+                for (size_t q = 0; q < 4; ++q) {
+                    c[(i + r) * ldc + j + q] = out[r][q] * (a_scales[i + r] * b_scales[j + q]) +
+                                               (bias ? bias[j + q] : 0.0f);
+                }
+            }
+        }
+        for (; j < n; ++j) {
+            float add = bias ? bias[j] : 0.0f;
+            c[i * ldc + j] = dot_q8(a0, b + j * k, k) * (a_scales[i] * b_scales[j]) + add;
+            c[(i + 1) * ldc + j] = dot_q8(a1, b + j * k, k) * (a_scales[i + 1] * b_scales[j]) + add;
+        }
+    }
+    for (; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            c[i * ldc + j] = dot_q8(a + i * k, b + j * k, k) * (a_scales[i] * b_scales[j]) +
+                             (bias ? bias[j] : 0.0f);
+        }
+    }
+}
+
+const char* instruction_set() {
+    return "avx2+fma";
+}
+
+#else
+
+float dot(const float* a, const float* b, size_t d) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < d; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+float l2_sqr(const float* a, const float* b, size_t d) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < d; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void scale_sub(const float* x, float factor, const float* offset, float* y, size_t d) {
+    for (size_t i = 0; i < d; ++i) {
+        y[i] = x[i] * factor - (offset ? offset[i] : 0.0f);
+    }
+}
+
+void gemv(const float* matrix, size_t rows, size_t cols, const float* x,
+          float factor, const float* offset, float* y) {
+    for (size_t r = 0; r < rows; ++r) {
+        y[r] = dot(matrix + r * cols, x, cols) * factor - (offset ? offset[r] : 0.0f);
+    }
+}
+
+void gemm_nt(const float* a, size_t m, const float* b, size_t n, size_t k,
+             const float* bias, float* c, size_t ldc) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            c[i * ldc + j] = dot(a + i * k, b + j * k, k) + (bias ? bias[j] : 0.0f);
+        }
+    }
+}
+
+void gemm_nt_q8(const int8_t* a, const float* a_scales, size_t m,
+                const int8_t* b, const float* b_scales, size_t n, size_t k,
+                const float* bias, float* c, size_t ldc) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            int32_t sum = 0;
+            for (size_t p = 0; p < k; ++p) {
+                sum += int32_t{a[i * k + p]} * b[j * k + p];
+            }
+            c[i * ldc + j] = sum * (a_scales[i] * b_scales[j]) + (bias ? bias[j] : 0.0f);
+        }
+    }
+}
+
+const char* instruction_set() {
+    return "scalar";
+}
+
+#endif
+
+float norm_sqr(const float* x, size_t d) {
+    return dot(x, x, d);
+}
+
+void scale(float* x, float factor, size_t d) {
+    scale_sub(x, factor, nullptr, x, d);
+}
+
+void quantize_rows_q8(const float* x, size_t m, size_t k, int8_t* q, float* scales) {
+    for (size_t i = 0; i < m; ++i) {
+        const float* row = x + i * k;
+        float max_abs = 0.0f;
+        for (size_t p = 0; p < k; ++p) {
+            max_abs = std::max(max_abs, std::fabs(row[p]));
+        }
+        float scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+        float inverse = 1.0f / scale;
+        for (size_t p = 0; p < k; ++p) {
+            long value = std::lrintf(row[p] * inverse);
+            q[i * k + p] = static_cast<int8_t>(std::min(127L, std::max(-127L, value)));
+        }
+        scales[i] = scale;
+    }
+}
+
+void dot_many(const float* query, const float* vectors, size_t n, size_t d, float* out) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = dot(query, vectors + i * d, d);
+    }
+}
+
+void l2_sqr_many(const float* query, const float* vectors, size_t n, size_t d, float* out) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = l2_sqr(query, vectors + i * d, d);
+    }
+}
+
+} // namespace simd
+} // namespace neurorag
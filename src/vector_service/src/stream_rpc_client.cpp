@@ -0,0 +1,210 @@
+/**
+ * @file stream_rpc_client.cpp
+ * @brief Client library for the streaming vector search RPC
+ */
+
+#include "stream_rpc_client.h"
+
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace neurorag {
+
+StreamRpcClient::StreamRpcClient()
+    : fd_(-1), window_(0), connected_(false), next_request_id_(1) {}
+
+StreamRpcClient::~StreamRpcClient() {
+    close();
+}
+
+bool StreamRpcClient::connect(const std::string& host, int port, uint32_t requested_window) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* resolved = nullptr;
+    if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &resolved) != 0) {
+        std::cerr << "StreamRpcClient: cannot resolve " << host << std::endl;
+        return false;
+    }
+
+    fd_ = ::socket(resolved->ai_family, resolved->ai_socktype, resolved->ai_protocol);
+    bool ok = fd_ >= 0 && ::connect(fd_, resolved->ai_addr, resolved->ai_addrlen) == 0;
+    ::freeaddrinfo(resolved);
+    if (!ok) {
+        std::cerr << "StreamRpcClient: connect to " << host << ":" << port
+                  << " failed: " << std::strerror(errno) << std::endl;
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        return false;
+    }
+
+    int enable = 1;
+    ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    rpc::FrameHeader header{};
+    std::vector<uint8_t> payload;
+    if (!rpc::write_frame(fd_, rpc::FrameType::HELLO, 0, &requested_window, sizeof(requested_window)) ||
+        !rpc::read_frame(fd_, header, payload) ||
+        header.type != static_cast<uint8_t>(rpc::FrameType::WINDOW) ||
+        payload.size() != sizeof(uint32_t)) {
+        std::cerr << "StreamRpcClient: handshake failed" << std::endl;
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    std::memcpy(&window_, payload.data(), sizeof(window_));
+
+    connected_.store(true);
+    reader_thread_ = std::thread(&StreamRpcClient::reader_loop, this);
+    return true;
+}
+
+void StreamRpcClient::close() {
+    if (connected_.exchange(false)) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        rpc::write_frame(fd_, rpc::FrameType::GOODBYE, 0, nullptr, 0);
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+    credit_condition_.notify_all();
+
+    if (reader_thread_.joinable()) {
+        reader_thread_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+uint64_t StreamRpcClient::submit(const std::vector<float>& query_vector, int k, float threshold,
+                                 Callback callback) {
+    uint64_t request_id = next_request_id_.fetch_add(1);
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        credit_condition_.wait(lock, [this] {
+            return !connected_.load() || pending_.size() < window_;
+        });
+        if (!connected_.load()) {
+            return 0;
+        }
+        pending_.emplace(request_id, std::move(callback));
+    }
+
+    rpc::QueryPayload query{};
+    query.k = k;
+    query.threshold = threshold;
+    query.dimension = static_cast<uint32_t>(query_vector.size());
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!rpc::write_frame(fd_, rpc::FrameType::QUERY, request_id,
+                          &query, sizeof(query),
+                          query_vector.data(),
+                          static_cast<uint32_t>(query_vector.size() * sizeof(float)))) {
+        // The reader thread observes the broken socket and fails the query
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+    return request_id;
+}
+
+void StreamRpcClient::drain() {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    credit_condition_.wait(lock, [this] { return pending_.empty(); });
+}
+
+size_t StreamRpcClient::in_flight() const {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    return pending_.size();
+}
+
+void StreamRpcClient::reader_loop() {
+    rpc::FrameHeader header{};
+    std::vector<uint8_t> payload;
+
+    while (rpc::read_frame(fd_, header, payload)) {
+        auto type = static_cast<rpc::FrameType>(header.type);
+        if (type == rpc::FrameType::GOODBYE) {
+            break;
+        }
+        if (type != rpc::FrameType::RESULT && type != rpc::FrameType::ERROR) {
+            continue;
+        }
+
+        StreamSearchResult result{};
+        result.request_id = header.request_id;
+
+        if (type == rpc::FrameType::RESULT && payload.size() >= sizeof(rpc::ResultPayload)) {
+            rpc::ResultPayload head{};
+            std::memcpy(&head, payload.data(), sizeof(head));
+            size_t expected = sizeof(head) + head.count * (sizeof(int64_t) + sizeof(float));
+            if (payload.size() == expected) {
+                result.indices.resize(head.count);
+                result.scores.resize(head.count);
+                std::memcpy(result.indices.data(), payload.data() + sizeof(head),
+                            head.count * sizeof(int64_t));
+                std::memcpy(result.scores.data(),
+                            payload.data() + sizeof(head) + head.count * sizeof(int64_t),
+                            head.count * sizeof(float));
+                result.server_latency_ms = head.latency_ms;
+                result.from_cache = head.from_cache != 0;
+            } else {
+                result.error = "malformed result frame";
+            }
+        } else {
+            result.error.assign(payload.begin(), payload.end());
+            if (result.error.empty()) {
+                result.error = "malformed result frame";
+            }
+        }
+
+        Callback callback;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto it = pending_.find(header.request_id);
+            if (it == pending_.end()) {
+                continue;
+            }
+            callback = std::move(it->second);
+        }
+
+        // The entry is erased only after the callback ran so drain() covers it
+        if (callback) {
+            callback(result);
+        }
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.erase(header.request_id);
+        }
+        credit_condition_.notify_all();
+    }
+
+    connected_.store(false);
+    fail_pending("connection closed");
+}
+
+void StreamRpcClient::fail_pending(const std::string& error) {
+    std::unordered_map<uint64_t, Callback> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_);
+    }
+    credit_condition_.notify_all();
+
+    for (auto& entry : pending) {
+        StreamSearchResult result{};
+        result.request_id = entry.first;
+        result.error = error;
+        if (entry.second) {
+            entry.second(result);
+        }
+    }
+}
+
+} // namespace neurorag
@@ -0,0 +1,110 @@
+/**
+ * @file stream_rpc_protocol.cpp
+ * @brief Frame encoding shared by the streaming RPC server and client
+ */
+
+#include "stream_rpc_protocol.h"
+
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace neurorag {
+namespace rpc {
+
+namespace {
+
+bool read_exact(int fd, void* buffer, size_t length) {
+    auto* out = static_cast<uint8_t*>(buffer);
+    while (length > 0) {
+        ssize_t n = ::recv(fd, out, length, 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        out += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// sendmsg rather than writev: a peer that disconnected mid-frame fails
+// the write with EPIPE instead of raising SIGPIPE in the whole process
+bool writev_exact(int fd, struct iovec* iov, int iovcnt) {
+    while (iovcnt > 0) {
+        struct msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = static_cast<size_t>(iovcnt);
+        ssize_t n = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        // Advance past fully written vectors, then trim the partial one
+        size_t written = static_cast<size_t>(n);
+        while (iovcnt > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool write_frame(int fd, FrameType type, uint64_t request_id,
+                 const void* payload, uint32_t payload_length) {
+    return write_frame(fd, type, request_id, payload, payload_length, nullptr, 0);
+}
+
+bool write_frame(int fd, FrameType type, uint64_t request_id,
+                 const void* part1, uint32_t length1,
+                 const void* part2, uint32_t length2) {
+    FrameHeader header{};
+    header.magic = kFrameMagic;
+    header.version = kProtocolVersion;
+    header.type = static_cast<uint8_t>(type);
+    header.payload_length = length1 + length2;
+    header.request_id = request_id;
+
+    struct iovec iov[3];
+    int iovcnt = 0;
+    iov[iovcnt++] = {&header, sizeof(header)};
+    if (length1 > 0) {
+        iov[iovcnt++] = {const_cast<void*>(part1), length1};
+    }
+    if (length2 > 0) {
+        iov[iovcnt++] = {const_cast<void*>(part2), length2};
+    }
+    return writev_exact(fd, iov, iovcnt);
+}
+
+bool read_frame(int fd, FrameHeader& header, std::vector<uint8_t>& payload) {
+    if (!read_exact(fd, &header, sizeof(header))) {
+        return false;
+    }
+    if (header.magic != kFrameMagic || header.version != kProtocolVersion ||
+        header.payload_length > kMaxPayloadBytes) {
+        return false;
+    }
+
+    payload.resize(header.payload_length);
+    return header.payload_length == 0 || read_exact(fd, payload.data(), payload.size());
+}
+
+} // namespace rpc
+} // namespace neurorag
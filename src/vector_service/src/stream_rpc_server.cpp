@@ -0,0 +1,315 @@
+/**
+ * @file stream_rpc_server.cpp
+ * @brief Streaming RPC server feeding the engine's micro-batcher
+ */
+
+#include "stream_rpc.h"
+#include "micro_batcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace neurorag {
+
+struct StreamRpcServer::Connection {
+    int fd = -1;
+    uint32_t window = 0;
+    std::atomic<uint32_t> in_flight{0};
+    std::atomic<bool> open{true};
+    std::atomic<bool> finished{false};
+    std::mutex write_mutex;
+    std::thread thread;
+
+    // Completions keep the connection alive, so the fd is released last
+    ~Connection() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    void close() {
+        if (open.exchange(false)) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+    }
+};
+
+StreamRpcServer::StreamRpcServer(const std::string& host, int port,
+                                 MicroBatcher* batcher, int dimension,
+                                 int max_k, uint32_t max_window)
+    : host_(host),
+      port_(port),
+      batcher_(batcher),
+      dimension_(dimension),
+      max_k_(std::max(1, max_k)),
+      max_window_(max_window == 0 ? 1 : max_window),
+      listen_fd_(-1),
+      running_(false),
+      connections_accepted_(0),
+      queries_received_(0),
+      results_sent_(0),
+      window_violations_(0) {}
+
+StreamRpcServer::~StreamRpcServer() {
+    stop();
+}
+
+bool StreamRpcServer::start() {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "StreamRpcServer: socket() failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    int enable = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port_));
+    if (::inet_pton(AF_INET, host_.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "StreamRpcServer: invalid bind address " << host_ << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd_, 128) < 0) {
+        std::cerr << "StreamRpcServer: bind/listen on " << host_ << ":" << port_
+                  << " failed: " << std::strerror(errno) << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    running_.store(true);
+    accept_thread_ = std::thread(&StreamRpcServer::accept_loop, this);
+    return true;
+}
+
+void StreamRpcServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+
+    std::unordered_set<std::shared_ptr<Connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.swap(connections_);
+    }
+    for (auto& connection : connections) {
+        connection->close();
+    }
+    for (auto& connection : connections) {
+        if (connection->thread.joinable()) {
+            connection->thread.join();
+        }
+    }
+}
+
+nlohmann::json StreamRpcServer::get_statistics() const {
+    nlohmann::json stats;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        stats["active_connections"] = connections_.size();
+    }
+    stats["connections_accepted"] = connections_accepted_.load();
+    stats["queries_received"] = queries_received_.load();
+    stats["results_sent"] = results_sent_.load();
+    stats["window_violations"] = window_violations_.load();
+    stats["max_window"] = max_window_;
+    return stats;
+}
+
+void StreamRpcServer::accept_loop() {
+    while (running_.load()) {
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (running_.load()) {
+                std::cerr << "StreamRpcServer: accept() failed: " << std::strerror(errno) << std::endl;
+            }
+            break;
+        }
+
+        int enable = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        connections_accepted_.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+
+        // Reap connections whose reader thread has exited
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            if ((*it)->finished.load()) {
+                (*it)->thread.join();
+                it = connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        connection->thread = std::thread(&StreamRpcServer::connection_loop, this, connection);
+        connections_.insert(connection);
+    }
+}
+
+void StreamRpcServer::connection_loop(std::shared_ptr<Connection> connection) {
+    rpc::FrameHeader header{};
+    std::vector<uint8_t> payload;
+
+    // The first frame must be HELLO carrying the requested window
+    if (rpc::read_frame(connection->fd, header, payload) &&
+        header.type == static_cast<uint8_t>(rpc::FrameType::HELLO) &&
+        payload.size() == sizeof(uint32_t)) {
+        uint32_t requested = 0;
+        std::memcpy(&requested, payload.data(), sizeof(requested));
+        connection->window = (requested == 0 || requested > max_window_) ? max_window_ : requested;
+
+        std::lock_guard<std::mutex> lock(connection->write_mutex);
+        if (!rpc::write_frame(connection->fd, rpc::FrameType::WINDOW, 0,
+                              &connection->window, sizeof(connection->window))) {
+            connection->close();
+        }
+    } else {
+        connection->close();
+    }
+
+    while (connection->open.load() && rpc::read_frame(connection->fd, header, payload)) {
+        auto type = static_cast<rpc::FrameType>(header.type);
+        if (type == rpc::FrameType::QUERY) {
+            handle_query(connection, header, payload);
+        } else if (type == rpc::FrameType::GOODBYE) {
+            break;
+        } else {
+            send_error(connection, header.request_id, "unexpected frame type", false);
+            break;
+        }
+    }
+
+    // In-flight completions hold their own reference and drop writes once closed
+    connection->close();
+    connection->finished.store(true);
+}
+
+void StreamRpcServer::handle_query(const std::shared_ptr<Connection>& connection,
+                                   const rpc::FrameHeader& header,
+                                   const std::vector<uint8_t>& payload) {
+    queries_received_.fetch_add(1, std::memory_order_relaxed);
+
+    if (connection->in_flight.fetch_add(1) >= connection->window) {
+        window_violations_.fetch_add(1, std::memory_order_relaxed);
+        send_error(connection, header.request_id, "flow control window exceeded");
+        connection->close();
+        return;
+    }
+
+    rpc::QueryPayload query{};
+    if (payload.size() < sizeof(query)) {
+        send_error(connection, header.request_id, "truncated query payload");
+        return;
+    }
+    std::memcpy(&query, payload.data(), sizeof(query));
+
+    size_t vector_bytes = static_cast<size_t>(query.dimension) * sizeof(float);
+    if (payload.size() != sizeof(query) + vector_bytes) {
+        send_error(connection, header.request_id, "query payload length mismatch");
+        return;
+    }
+    if (static_cast<int>(query.dimension) != dimension_) {
+        send_error(connection, header.request_id, "query dimension mismatch");
+        return;
+    }
+    // k sizes the engine's result buffers; never take it unchecked from the wire
+    if (query.k < 1 || query.k > max_k_) {
+        send_error(connection, header.request_id, "k out of range");
+        return;
+    }
+
+    SearchRequest request;
+    request.query_vector.resize(query.dimension);
+    std::memcpy(request.query_vector.data(), payload.data() + sizeof(query), vector_bytes);
+    request.k = query.k;
+    request.threshold = query.threshold;
+    request.request_id = std::to_string(header.request_id);
+
+    uint64_t request_id = header.request_id;
+    bool accepted = batcher_->submit(std::move(request),
+        [this, connection, request_id](const SearchResult& result, const std::string& error) {
+            if (error.empty()) {
+                send_result(connection, request_id, result);
+            } else {
+                send_error(connection, request_id, error);
+            }
+        });
+
+    if (!accepted) {
+        send_error(connection, request_id, "server shutting down");
+    }
+}
+
+void StreamRpcServer::send_result(const std::shared_ptr<Connection>& connection,
+                                  uint64_t request_id, const SearchResult& result) {
+    rpc::ResultPayload head{};
+    head.count = static_cast<uint32_t>(std::min(result.indices.size(), result.scores.size()));
+    head.from_cache = result.from_cache ? 1 : 0;
+    head.latency_ms = result.latency_ms;
+
+    // ids and scores are sent back to back after the fixed header
+    std::vector<uint8_t> body(sizeof(head) + head.count * (sizeof(int64_t) + sizeof(float)));
+    std::memcpy(body.data(), &head, sizeof(head));
+    std::memcpy(body.data() + sizeof(head), result.indices.data(), head.count * sizeof(int64_t));
+    std::memcpy(body.data() + sizeof(head) + head.count * sizeof(int64_t),
+                result.scores.data(), head.count * sizeof(float));
+
+    connection->in_flight.fetch_sub(1);
+    if (!connection->open.load()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(connection->write_mutex);
+    if (rpc::write_frame(connection->fd, rpc::FrameType::RESULT, request_id,
+                         body.data(), static_cast<uint32_t>(body.size()))) {
+        results_sent_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        connection->close();
+    }
+}
+
+void StreamRpcServer::send_error(const std::shared_ptr<Connection>& connection,
+                                 uint64_t request_id, const std::string& message,
+                                 bool release_credit) {
+    if (release_credit) {
+        connection->in_flight.fetch_sub(1);
+    }
+    if (!connection->open.load()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(connection->write_mutex);
+    if (!rpc::write_frame(connection->fd, rpc::FrameType::ERROR, request_id,
+                          message.data(), static_cast<uint32_t>(message.size()))) {
+        connection->close();
+    }
+}
+
+} // namespace neurorag
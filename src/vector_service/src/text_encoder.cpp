@@ -0,0 +1,422 @@
+/**
+ * @file text_encoder.cpp
+ * @brief In-process CPU inference of BERT-style sentence encoders
+ */
+
+#include "text_encoder.h"
+#include "checksum.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <omp.h>
+
+namespace neurorag {
+
+namespace {
+
+constexpr size_t kRowTile = 32;      // tokens per GEMM tile
+constexpr size_t kColumnTile = 64;   // outputs per GEMM tile; 64 x 1536 fp32 weights fit in L2
+constexpr size_t kParallelRows = 16;
+
+size_t tensor_floats(const TextEncoderHeader& h) {
+    size_t hidden = h.hidden_size;
+    size_t intermediate = h.intermediate_size;
+    size_t embeddings = (size_t{h.vocab_size} + h.max_positions + h.type_vocab_size) * hidden + 2 * hidden;
+    size_t layer = 4 * (hidden * hidden + hidden) + 2 * hidden * intermediate + intermediate + hidden + 4 * hidden;
+    return embeddings + h.num_layers * layer;
+}
+
+float gelu(float x) {
+    return 0.5f * x * (1.0f + std::erf(x * 0.70710678f));
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Linear layers
+// ---------------------------------------------------------------------------
+
+void TextEncoder::Linear::quantize() {
+    quantized_weight.resize(weight.size());
+    scales.resize(outputs);
+    simd::quantize_rows_q8(weight.data(), outputs, inputs, quantized_weight.data(), scales.data());
+    std::vector<float>().swap(weight);
+}
+
+void TextEncoder::Linear::forward(const float* x, size_t rows, float* y, int threads) const {
+    size_t row_tiles = (rows + kRowTile - 1) / kRowTile;
+    size_t column_tiles = (outputs + kColumnTile - 1) / kColumnTile;
+    size_t tiles = row_tiles * column_tiles;
+
+    // int8 weights take int8 activations, quantized per token
+    std::vector<int8_t> quantized_x;
+    std::vector<float> x_scales;
+    if (!quantized_weight.empty()) {
+        quantized_x.resize(rows * inputs);
+        x_scales.resize(rows);
+        #pragma omp parallel for num_threads(threads) schedule(static) if (row_tiles > 1)
+        for (size_t t = 0; t < row_tiles; ++t) {
+            size_t first = t * kRowTile;
+            size_t count = std::min(kRowTile, rows - first);
+            simd::quantize_rows_q8(x + first * inputs, count, inputs,
+                                   &quantized_x[first * inputs], &x_scales[first]);
+        }
+    }
+
+    #pragma omp parallel for num_threads(threads) schedule(static) if (tiles > 1)
+    for (size_t t = 0; t < tiles; ++t) {
+        size_t first_row = (t / column_tiles) * kRowTile;
+        size_t first_column = (t % column_tiles) * kColumnTile;
+        size_t row_count = std::min(kRowTile, rows - first_row);
+        size_t column_count = std::min(kColumnTile, outputs - first_column);
+        float* out = y + first_row * outputs + first_column;
+        if (quantized_weight.empty()) {
+            simd::gemm_nt(x + first_row * inputs, row_count, &weight[first_column * inputs], column_count,
+                          inputs, &bias[first_column], out, outputs);
+        } else {
+            simd::gemm_nt_q8(&quantized_x[first_row * inputs], &x_scales[first_row], row_count,
+                             &quantized_weight[first_column * inputs], &scales[first_column], column_count,
+                             inputs, &bias[first_column], out, outputs);
+        }
+    }
+}
+
+size_t TextEncoder::Linear::memory_bytes() const {
+    return weight.size() * sizeof(float) + quantized_weight.size() + (scales.size() + bias.size()) * sizeof(float);
+}
+
+// ---------------------------------------------------------------------------
+// Loading
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<TextEncoder> TextEncoder::load(const std::string& path, bool quantize, int num_threads,
+                                               std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path;
+        return nullptr;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto encoder = deserialize(data.data(), data.size(), quantize, num_threads, error);
+    if (!encoder) {
+        error = path + ": " + error;
+    }
+    return encoder;
+}
+
+std::unique_ptr<TextEncoder> TextEncoder::deserialize(const uint8_t* data, size_t size, bool quantize,
+                                                      int num_threads, std::string& error) {
+    TextEncoderHeader header;
+    if (size < sizeof(header) + sizeof(uint32_t)) {
+        error = "truncated";
+        return nullptr;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != TextEncoderHeader::kMagic || header.version != TextEncoderHeader::kVersion) {
+        error = "not a text encoder model";
+        return nullptr;
+    }
+    if (header.vocab_size == 0 || header.hidden_size == 0 || header.num_layers == 0 || header.num_heads == 0 ||
+        header.hidden_size % header.num_heads != 0 || header.intermediate_size == 0 ||
+        header.type_vocab_size == 0 || header.max_sequence_length < 2 ||
+        header.max_sequence_length > header.max_positions) {
+        error = "bad architecture";
+        return nullptr;
+    }
+
+    size_t floats = tensor_floats(header);
+    size_t expected = sizeof(header) + header.vocab_bytes + floats * sizeof(float) + sizeof(uint32_t);
+    if (size != expected) {
+        error = "truncated";
+        return nullptr;
+    }
+    uint32_t stored_checksum;
+    std::memcpy(&stored_checksum, data + size - sizeof(uint32_t), sizeof(stored_checksum));
+    if (crc32c(data, size - sizeof(uint32_t)) != stored_checksum) {
+        error = "checksum mismatch";
+        return nullptr;
+    }
+
+    std::vector<std::string> vocab;
+    vocab.reserve(header.vocab_size);
+    const char* text = reinterpret_cast<const char*>(data + sizeof(header));
+    const char* text_end = text + header.vocab_bytes;
+    while (text < text_end) {
+        const char* line_end = std::find(text, text_end, '\n');
+        vocab.emplace_back(text, line_end);
+        text = line_end + 1;
+    }
+    if (vocab.size() != header.vocab_size) {
+        error = "vocabulary has " + std::to_string(vocab.size()) + " tokens, header says " +
+                std::to_string(header.vocab_size);
+        return nullptr;
+    }
+
+    std::unique_ptr<TextEncoder> encoder(new TextEncoder());
+    encoder->header_ = header;
+    encoder->quantized_ = quantize;
+    encoder->num_threads_ = num_threads > 0 ? num_threads : omp_get_max_threads();
+    encoder->tokenizer_ = std::make_unique<WordPieceTokenizer>(vocab, (header.flags & TextEncoderHeader::kLowercase) != 0);
+    if (!encoder->tokenizer_->valid()) {
+        error = "vocabulary lacks [CLS], [SEP] or [UNK]";
+        return nullptr;
+    }
+
+    const uint8_t* position = data + sizeof(header) + header.vocab_bytes;
+    auto take = [&position](std::vector<float>& out, size_t count) {
+        size_t offset = out.size();
+        out.resize(offset + count);
+        std::memcpy(&out[offset], position, count * sizeof(float));
+        position += count * sizeof(float);
+    };
+    auto take_linear = [&take](Linear& linear, size_t outputs, size_t inputs) {
+        linear.outputs = outputs;
+        linear.inputs = inputs;
+        take(linear.weight, outputs * inputs);
+        take(linear.bias, outputs);
+    };
+    auto take_norm = [&take](LayerNorm& norm, size_t dimension) {
+        take(norm.weight, dimension);
+        take(norm.bias, dimension);
+    };
+
+    size_t hidden = header.hidden_size;
+    take(encoder->word_embeddings_, size_t{header.vocab_size} * hidden);
+    take(encoder->position_embeddings_, size_t{header.max_positions} * hidden);
+    take(encoder->token_type_embeddings_, size_t{header.type_vocab_size} * hidden);
+    take_norm(encoder->embedding_norm_, hidden);
+
+    encoder->layers_.resize(header.num_layers);
+    for (Layer& layer : encoder->layers_) {
+        // Query, key and value are stored one after another; read them as one 3h x h projection
+        Linear& qkv = layer.qkv;
+        qkv.outputs = 3 * hidden;
+        qkv.inputs = hidden;
+        for (int part = 0; part < 3; ++part) {
+            std::vector<float> weight;
+            std::vector<float> bias;
+            take(weight, hidden * hidden);
+            take(bias, hidden);
+            qkv.weight.insert(qkv.weight.end(), weight.begin(), weight.end());
+            qkv.bias.insert(qkv.bias.end(), bias.begin(), bias.end());
+        }
+        take_linear(layer.attention_output, hidden, hidden);
+        take_norm(layer.attention_norm, hidden);
+        take_linear(layer.intermediate, header.intermediate_size, hidden);
+        take_linear(layer.output, hidden, header.intermediate_size);
+        take_norm(layer.output_norm, hidden);
+
+        if (quantize) {
+            layer.qkv.quantize();
+            layer.attention_output.quantize();
+            layer.intermediate.quantize();
+            layer.output.quantize();
+        }
+    }
+    return encoder;
+}
+
+TextEncoder::~TextEncoder() = default;
+
+// ---------------------------------------------------------------------------
+// Inference
+// ---------------------------------------------------------------------------
+
+void TextEncoder::layer_norm(const LayerNorm& norm, float* x, size_t rows) const {
+    size_t hidden = header_.hidden_size;
+    #pragma omp parallel for num_threads(num_threads_) schedule(static) if (rows >= kParallelRows)
+    for (size_t r = 0; r < rows; ++r) {
+        float* row = x + r * hidden;
+        float mean = 0.0f;
+        for (size_t i = 0; i < hidden; ++i) {
+            mean += row[i];
+        }
+        mean /= hidden;
+        float variance = 0.0f;
+        for (size_t i = 0; i < hidden; ++i) {
+            float centered = row[i] - mean;
+            variance += centered * centered;
+        }
+        float inverse = 1.0f / std::sqrt(variance / hidden + header_.layer_norm_eps);
+        for (size_t i = 0; i < hidden; ++i) {
+            row[i] = (row[i] - mean) * inverse * norm.weight[i] + norm.bias[i];
+        }
+    }
+}
+
+void TextEncoder::attention(const float* qkv, const std::vector<size_t>& offsets, float* context) const {
+    size_t hidden = header_.hidden_size;
+    size_t heads = header_.num_heads;
+    size_t head_dimension = hidden / heads;
+    size_t stride = 3 * hidden;
+    float scale = 1.0f / std::sqrt(static_cast<float>(head_dimension));
+    size_t tasks = (offsets.size() - 1) * heads;
+
+    #pragma omp parallel for num_threads(num_threads_) schedule(dynamic) if (tasks > 1)
+    for (size_t task = 0; task < tasks; ++task) {
+        size_t first = offsets[task / heads];
+        size_t length = offsets[task / heads + 1] - first;
+        size_t head_offset = (task % heads) * head_dimension;
+
+        // This head's keys row-major and values transposed, so both products are contiguous
+        std::vector<float> keys(length * head_dimension);
+        std::vector<float> values_t(head_dimension * length);
+        for (size_t j = 0; j < length; ++j) {
+            const float* row = qkv + (first + j) * stride + head_offset;
+            std::memcpy(&keys[j * head_dimension], row + hidden, head_dimension * sizeof(float));
+            for (size_t c = 0; c < head_dimension; ++c) {
+                values_t[c * length + j] = row[2 * hidden + c];
+            }
+        }
+
+        std::vector<float> weights(length);
+        for (size_t i = 0; i < length; ++i) {
+            simd::dot_many(qkv + (first + i) * stride + head_offset, keys.data(), length, head_dimension,
+                           weights.data());
+            float max_score = *std::max_element(weights.begin(), weights.end()) * scale;
+            float sum = 0.0f;
+            for (float& w : weights) {
+                w = std::exp(w * scale - max_score);
+                sum += w;
+            }
+            simd::gemv(values_t.data(), head_dimension, length, weights.data(), 1.0f / sum, nullptr,
+                       context + (first + i) * hidden + head_offset);
+        }
+    }
+}
+
+void TextEncoder::encode(const std::vector<std::string>& texts, std::vector<float>& embeddings) const {
+    size_t hidden = header_.hidden_size;
+    size_t intermediate = header_.intermediate_size;
+
+    // All tokens of the batch packed back to back; no padding
+    std::vector<std::vector<int32_t>> ids(texts.size());
+    std::vector<size_t> offsets(texts.size() + 1, 0);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        tokenizer_->encode(texts[i], header_.max_sequence_length, ids[i]);
+        offsets[i + 1] = offsets[i] + ids[i].size();
+    }
+    size_t tokens = offsets.back();
+
+    std::vector<float> states(tokens * hidden);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        for (size_t p = 0; p < ids[i].size(); ++p) {
+            float* row = &states[(offsets[i] + p) * hidden];
+            const float* word = &word_embeddings_[static_cast<size_t>(ids[i][p]) * hidden];
+            const float* position = &position_embeddings_[p * hidden];
+            for (size_t c = 0; c < hidden; ++c) {
+                row[c] = word[c] + position[c] + token_type_embeddings_[c];
+            }
+        }
+    }
+    layer_norm(embedding_norm_, states.data(), tokens);
+
+    std::vector<float> qkv(tokens * 3 * hidden);
+    std::vector<float> context(tokens * hidden);
+    std::vector<float> projected(tokens * hidden);
+    std::vector<float> activations(tokens * intermediate);
+    auto add_residual = [&states, &projected] {
+        for (size_t i = 0; i < states.size(); ++i) {
+            states[i] += projected[i];
+        }
+    };
+
+    for (const Layer& layer : layers_) {
+        layer.qkv.forward(states.data(), tokens, qkv.data(), num_threads_);
+        attention(qkv.data(), offsets, context.data());
+        layer.attention_output.forward(context.data(), tokens, projected.data(), num_threads_);
+        add_residual();
+        layer_norm(layer.attention_norm, states.data(), tokens);
+
+        layer.intermediate.forward(states.data(), tokens, activations.data(), num_threads_);
+        #pragma omp parallel for num_threads(num_threads_) schedule(static) if (tokens >= kParallelRows)
+        for (size_t r = 0; r < tokens; ++r) {
+            float* row = &activations[r * intermediate];
+            for (size_t c = 0; c < intermediate; ++c) {
+                row[c] = gelu(row[c]);
+            }
+        }
+        layer.output.forward(activations.data(), tokens, projected.data(), num_threads_);
+        add_residual();
+        layer_norm(layer.output_norm, states.data(), tokens);
+    }
+
+    // Mean over every token of a text ([CLS] and [SEP] included, as sentence-transformers pools)
+    embeddings.assign(texts.size() * hidden, 0.0f);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        float* out = &embeddings[i * hidden];
+        for (size_t r = offsets[i]; r < offsets[i + 1]; ++r) {
+            for (size_t c = 0; c < hidden; ++c) {
+                out[c] += states[r * hidden + c];
+            }
+        }
+        float factor = 1.0f / (offsets[i + 1] - offsets[i]);
+        if (header_.flags & TextEncoderHeader::kNormalize) {
+            float norm = std::sqrt(simd::norm_sqr(out, hidden)) * factor;
+            factor = norm > 0.0f ? factor / norm : factor;
+        }
+        simd::scale(out, factor, hidden);
+    }
+}
+
+size_t TextEncoder::memory_bytes() const {
+    size_t total = (word_embeddings_.size() + position_embeddings_.size() + token_type_embeddings_.size() +
+                    embedding_norm_.weight.size() + embedding_norm_.bias.size()) * sizeof(float);
+    for (const Layer& layer : layers_) {
+        total += layer.qkv.memory_bytes() + layer.attention_output.memory_bytes() +
+                 layer.intermediate.memory_bytes() + layer.output.memory_bytes() +
+                 (layer.attention_norm.weight.size() + layer.attention_norm.bias.size() +
+                  layer.output_norm.weight.size() + layer.output_norm.bias.size()) * sizeof(float);
+    }
+    return total;
+}
+
+nlohmann::json TextEncoder::describe() const {
+    nlohmann::json info;
+    info["layers"] = header_.num_layers;
+    info["hidden_size"] = header_.hidden_size;
+    info["heads"] = header_.num_heads;
+    info["intermediate_size"] = header_.intermediate_size;
+    info["vocab_size"] = header_.vocab_size;
+    info["max_sequence_length"] = header_.max_sequence_length;
+    info["lowercase"] = tokenizer_->lowercase();
+    info["normalize"] = (header_.flags & TextEncoderHeader::kNormalize) != 0;
+    info["precision"] = quantized_ ? "int8" : "fp32";
+    info["threads"] = num_threads_;
+    info["kernels"] = simd::instruction_set();
+    info["memory_bytes"] = memory_bytes();
+    return info;
+}
+
+// ---------------------------------------------------------------------------
+// LocalEmbeddingBackend
+// ---------------------------------------------------------------------------
+
+LocalEmbeddingBackend::LocalEmbeddingBackend(std::unique_ptr<TextEncoder> encoder, size_t max_batch_size,
+                                             std::string source)
+    : encoder_(std::move(encoder)),
+      max_batch_size_(std::max<size_t>(1, max_batch_size)),
+      source_(std::move(source)) {}
+
+bool LocalEmbeddingBackend::embed(const std::vector<std::string>& texts,
+                                  std::vector<float>& embeddings,
+                                  std::string& error) {
+    try {
+        encoder_->encode(texts, embeddings);
+    } catch (const std::exception& e) {
+        error = std::string("text encoder failed: ") + e.what();
+        return false;
+    }
+    return true;
+}
+
+std::string LocalEmbeddingBackend::name() const {
+    return std::string("local ") + (encoder_->quantized() ? "int8 " : "fp32 ") + source_;
+}
+
+} // namespace neurorag
@@ -0,0 +1,785 @@
+/**
+ * @file tiered_invlists.cpp
+ * @brief IVF inverted lists split between DRAM and local NVMe by access frequency
+ */
+
+#include "tiered_invlists.h"
+#include "checksum.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <faiss/IndexIVF.h>
+
+namespace neurorag {
+
+namespace {
+
+constexpr uint32_t kTieredMagic = 0x4C54524E; // "NRTL"
+constexpr uint32_t kTieredVersion = 1;
+
+// A cold list must be this much hotter than a hot one, and by a few
+// accesses, to displace it, so lists with similar or sparse traffic do
+// not swap tiers on every rebalance
+constexpr double kPromotionHysteresis = 1.5;
+constexpr double kPromotionMinAccesses = 4.0;
+
+#pragma pack(push, 1)
+struct TieredFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t nlist;
+    uint64_t code_size;
+    uint64_t data_offset;
+    uint32_t table_crc;
+    uint32_t reserved;
+};
+
+struct TieredListEntry {
+    uint64_t offset;
+    uint64_t size;
+};
+#pragma pack(pop)
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Codes padded to 8 bytes so the ids that follow are aligned
+size_t ids_offset(size_t entries, size_t code_size) {
+    return align_up(entries * code_size, sizeof(faiss::idx_t));
+}
+
+// Buffers handed out by get_codes/get_ids stay alive until released; faiss
+// releases on the thread that acquired, so the pins are thread-local
+struct Pin {
+    std::shared_ptr<void> buffer;
+    int count;
+};
+thread_local std::unordered_map<const void*, Pin> tls_pins;
+
+void pin(const void* pointer, std::shared_ptr<void> buffer) {
+    auto it = tls_pins.find(pointer);
+    if (it != tls_pins.end()) {
+        ++it->second.count;
+    } else {
+        tls_pins.emplace(pointer, Pin{std::move(buffer), 1});
+    }
+}
+
+void unpin(const void* pointer) {
+    auto it = tls_pins.find(pointer);
+    if (it != tls_pins.end() && --it->second.count == 0) {
+        tls_pins.erase(it);
+    }
+}
+
+} // namespace
+
+struct TieredInvertedLists::PendingRead {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    std::shared_ptr<ListBuffer> buffer;
+};
+
+faiss::idx_t* TieredInvertedLists::ListBuffer::ids(size_t code_size) const {
+    return reinterpret_cast<faiss::idx_t*>(block + ids_offset(capacity, code_size));
+}
+
+TieredInvertedLists::ListBuffer::~ListBuffer() {
+    free(block);
+}
+
+bool TieredInvertedLists::write_cold_file(const faiss::InvertedLists& lists, const std::string& path) {
+    size_t code_size = lists.code_size;
+    std::vector<TieredListEntry> table(lists.nlist);
+
+    size_t data_offset = align_up(sizeof(TieredFileHeader) + table.size() * sizeof(TieredListEntry),
+                                  kDirectIoAlignment);
+    size_t offset = data_offset;
+    for (size_t list_no = 0; list_no < lists.nlist; ++list_no) {
+        size_t entries = lists.list_size(list_no);
+        table[list_no].offset = offset;
+        table[list_no].size = entries;
+        if (entries > 0) {
+            offset += align_up(ids_offset(entries, code_size) + entries * sizeof(faiss::idx_t),
+                               kDirectIoAlignment);
+        }
+    }
+
+    TieredFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = kTieredMagic;
+    header.version = kTieredVersion;
+    header.nlist = lists.nlist;
+    header.code_size = code_size;
+    header.data_offset = data_offset;
+    header.table_crc = crc32c(table.data(), table.size() * sizeof(TieredListEntry));
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "TieredInvertedLists: cannot write " << temp_path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(TieredListEntry));
+
+        std::vector<char> padding(kDirectIoAlignment, 0);
+        size_t written = sizeof(header) + table.size() * sizeof(TieredListEntry);
+        auto pad_to = [&](size_t target) {
+            while (written < target) {
+                size_t n = std::min(padding.size(), target - written);
+                file.write(padding.data(), n);
+                written += n;
+            }
+        };
+
+        for (size_t list_no = 0; list_no < lists.nlist; ++list_no) {
+            size_t entries = table[list_no].size;
+            if (entries == 0) {
+                continue;
+            }
+            pad_to(table[list_no].offset);
+            const uint8_t* codes = lists.get_codes(list_no);
+            const faiss::idx_t* ids = lists.get_ids(list_no);
+            file.write(reinterpret_cast<const char*>(codes), entries * code_size);
+            written += entries * code_size;
+            pad_to(table[list_no].offset + ids_offset(entries, code_size));
+            file.write(reinterpret_cast<const char*>(ids), entries * sizeof(faiss::idx_t));
+            written += entries * sizeof(faiss::idx_t);
+            lists.release_codes(list_no, codes);
+            lists.release_ids(list_no, ids);
+        }
+        pad_to(offset);
+
+        if (!file.flush()) {
+            std::cerr << "TieredInvertedLists: write to " << temp_path << " failed" << std::endl;
+            return false;
+        }
+    }
+
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "TieredInvertedLists: cannot rename " << temp_path << " to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+TieredInvertedLists::TieredInvertedLists(size_t nlist, size_t code_size,
+                                         size_t hot_budget_bytes, size_t pool_budget_bytes,
+                                         std::shared_ptr<AsyncFileReader> reader)
+    : faiss::InvertedLists(nlist, code_size),
+      hot_budget_bytes_(hot_budget_bytes),
+      pool_budget_bytes_(pool_budget_bytes),
+      reader_(std::move(reader)),
+      fd_(-1),
+      slots_(new ListSlot[nlist]),
+      pool_bytes_(0),
+      hot_bytes_(0),
+      rebalancing_(false),
+      hot_hits_(0),
+      pool_hits_(0),
+      sync_reads_(0),
+      prefetch_reads_(0),
+      prefetch_waits_(0),
+      read_failures_(0),
+      evictions_(0),
+      promotions_(0),
+      demotions_(0) {
+}
+
+TieredInvertedLists::~TieredInvertedLists() {
+    stop();
+    // Outstanding prefetches hold a pointer to this object
+    reader_.reset();
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool TieredInvertedLists::open(const std::string& path) {
+    path_ = path;
+    fd_ = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    if (fd_ < 0) {
+        // tmpfs and some overlay filesystems reject O_DIRECT
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            std::cerr << "TieredInvertedLists: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_RANDOM);
+    }
+
+    size_t table_bytes = nlist * sizeof(TieredListEntry);
+    size_t head_bytes = align_up(sizeof(TieredFileHeader) + table_bytes, kDirectIoAlignment);
+    std::unique_ptr<uint8_t, decltype(&free)> head(
+        static_cast<uint8_t*>(allocate_direct_io_buffer(head_bytes)), &free);
+    if (!head || AsyncFileReader::read_fully(fd_, 0, head_bytes, head.get()) != static_cast<ssize_t>(head_bytes)) {
+        std::cerr << "TieredInvertedLists: " << path << " is truncated" << std::endl;
+        return false;
+    }
+
+    TieredFileHeader header;
+    std::memcpy(&header, head.get(), sizeof(header));
+    const uint8_t* table = head.get() + sizeof(header);
+    if (header.magic != kTieredMagic || header.version != kTieredVersion ||
+        header.nlist != nlist || header.code_size != code_size ||
+        header.table_crc != crc32c(table, table_bytes)) {
+        std::cerr << "TieredInvertedLists: " << path << " does not match the index" << std::endl;
+        return false;
+    }
+
+    std::vector<size_t> by_size;
+    for (size_t list_no = 0; list_no < nlist; ++list_no) {
+        TieredListEntry entry;
+        std::memcpy(&entry, table + list_no * sizeof(entry), sizeof(entry));
+        ListSlot& slot = slots_[list_no];
+        slot.file_offset = entry.offset;
+        slot.file_bytes = entry.size > 0 ? align_up(list_bytes(entry.size), kDirectIoAlignment) : 0;
+        slot.size.store(entry.size, std::memory_order_relaxed);
+        if (entry.size > 0) {
+            by_size.push_back(list_no);
+        }
+    }
+
+    // Seed the hot tier until access counts are available
+    std::sort(by_size.begin(), by_size.end(), [this](size_t a, size_t b) {
+        return slots_[a].size.load() > slots_[b].size.load();
+    });
+    for (size_t list_no : by_size) {
+        ListSlot& slot = slots_[list_no];
+        if (hot_bytes_ + slot.file_bytes > hot_budget_bytes_) {
+            continue;
+        }
+        std::shared_ptr<ListBuffer> buffer = read_list(list_no);
+        if (!buffer) {
+            return false;
+        }
+        slot.buffer = std::move(buffer);
+        slot.tier = Tier::HOT;
+        hot_bytes_ += slot.file_bytes;
+    }
+
+    std::cout << "TieredInvertedLists: " << nlist << " lists from " << path << ", "
+              << hot_bytes_ / (1024 * 1024) << " MB hot, "
+              << pool_budget_bytes_ / (1024 * 1024) << " MB pool, "
+              << reader_->backend() << " reads" << std::endl;
+    return true;
+}
+
+size_t TieredInvertedLists::list_bytes(size_t entries) const {
+    return ids_offset(entries, code_size) + entries * sizeof(faiss::idx_t);
+}
+
+size_t TieredInvertedLists::list_size(size_t list_no) const {
+    return slots_[list_no].size.load(std::memory_order_acquire);
+}
+
+const uint8_t* TieredInvertedLists::get_codes(size_t list_no) const {
+    if (list_size(list_no) == 0) {
+        return nullptr;
+    }
+    std::shared_ptr<ListBuffer> buffer = acquire(list_no, true);
+    const uint8_t* codes = buffer->codes();
+    pin(codes, std::move(buffer));
+    return codes;
+}
+
+const faiss::idx_t* TieredInvertedLists::get_ids(size_t list_no) const {
+    if (list_size(list_no) == 0) {
+        return nullptr;
+    }
+    std::shared_ptr<ListBuffer> buffer = acquire(list_no, false);
+    const faiss::idx_t* ids = buffer->ids(code_size);
+    pin(ids, std::move(buffer));
+    return ids;
+}
+
+void TieredInvertedLists::release_codes(size_t, const uint8_t* codes) const {
+    if (codes) {
+        unpin(codes);
+    }
+}
+
+void TieredInvertedLists::release_ids(size_t, const faiss::idx_t* ids) const {
+    if (ids) {
+        unpin(ids);
+    }
+}
+
+void TieredInvertedLists::prefetch_lists(const faiss::idx_t* list_nos, int count) const {
+    std::vector<AsyncFileReader::Request> requests;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (int i = 0; i < count; ++i) {
+            faiss::idx_t list_no = list_nos[i];
+            if (list_no < 0 || static_cast<size_t>(list_no) >= nlist) {
+                continue;
+            }
+            ListSlot& slot = slots_[list_no];
+            if (slot.buffer || slot.pending || slot.size.load() == 0) {
+                continue;  // resident, in flight (also dedups repeats) or empty
+            }
+
+            auto buffer = std::make_shared<ListBuffer>();
+            buffer->block = static_cast<uint8_t*>(allocate_direct_io_buffer(slot.file_bytes));
+            if (!buffer->block) {
+                continue;  // get_codes falls back to a synchronous read
+            }
+            buffer->capacity = slot.size.load();
+            buffer->bytes = slot.file_bytes;
+
+            auto pending = std::make_shared<PendingRead>();
+            slot.pending = pending;
+
+            size_t expected = slot.file_bytes;
+            requests.push_back({fd_, slot.file_offset, slot.file_bytes, buffer->block,
+                [this, list_no, pending, buffer, expected](ssize_t result) {
+                    if (result != static_cast<ssize_t>(expected)) {
+                        read_failures_.fetch_add(1, std::memory_order_relaxed);
+                        finish_read(list_no, pending, nullptr);
+                    } else {
+                        finish_read(list_no, pending, buffer);
+                    }
+                }});
+        }
+    }
+
+    if (!requests.empty()) {
+        prefetch_reads_.fetch_add(requests.size(), std::memory_order_relaxed);
+        reader_->submit(std::move(requests));
+    }
+}
+
+std::shared_ptr<TieredInvertedLists::ListBuffer> TieredInvertedLists::acquire(size_t list_no, bool count_access) const {
+    ListSlot& slot = slots_[list_no];
+    if (count_access) {
+        slot.accesses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<PendingRead> pending;
+    bool reader = false;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (slot.buffer) {
+            if (slot.tier == Tier::HOT) {
+                hot_hits_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                pool_hits_.fetch_add(1, std::memory_order_relaxed);
+                lru_.splice(lru_.begin(), lru_, slot.lru_position);
+            }
+            return slot.buffer;
+        }
+        if (slot.pending) {
+            pending = slot.pending;
+        } else {
+            pending = std::make_shared<PendingRead>();
+            slot.pending = pending;
+            reader = true;
+        }
+    }
+
+    if (reader) {
+        // Not prefetched: read on this thread rather than queueing behind others
+        sync_reads_.fetch_add(1, std::memory_order_relaxed);
+        std::shared_ptr<ListBuffer> buffer = read_list(list_no);
+        finish_read(list_no, pending, buffer);
+    } else {
+        prefetch_waits_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::unique_lock<std::mutex> lock(pending->mutex);
+    pending->condition.wait(lock, [&pending]() { return pending->done; });
+    if (!pending->buffer) {
+        throw std::runtime_error("TieredInvertedLists: cannot read list " + std::to_string(list_no) +
+                                 " from " + path_);
+    }
+    return pending->buffer;
+}
+
+std::shared_ptr<TieredInvertedLists::ListBuffer> TieredInvertedLists::read_list(size_t list_no) const {
+    const ListSlot& slot = slots_[list_no];
+    auto buffer = std::make_shared<ListBuffer>();
+    buffer->block = static_cast<uint8_t*>(allocate_direct_io_buffer(slot.file_bytes));
+    if (!buffer->block) {
+        return nullptr;
+    }
+    buffer->capacity = slot.size.load();
+    buffer->bytes = slot.file_bytes;
+
+    ssize_t result = AsyncFileReader::read_fully(fd_, slot.file_offset, slot.file_bytes, buffer->block);
+    if (result != static_cast<ssize_t>(slot.file_bytes)) {
+        read_failures_.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "TieredInvertedLists: read of list " << list_no << " failed: "
+                  << (result < 0 ? std::strerror(-result) : "short read") << std::endl;
+        return nullptr;
+    }
+    return buffer;
+}
+
+void TieredInvertedLists::finish_read(size_t list_no, const std::shared_ptr<PendingRead>& pending,
+                                      std::shared_ptr<ListBuffer> buffer) const {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        ListSlot& slot = slots_[list_no];
+        if (slot.pending == pending) {
+            slot.pending.reset();
+        }
+        if (buffer && !slot.buffer) {
+            admit_to_pool_locked(list_no, buffer);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        pending->buffer = std::move(buffer);
+        pending->done = true;
+    }
+    pending->condition.notify_all();
+}
+
+void TieredInvertedLists::admit_to_pool_locked(size_t list_no, std::shared_ptr<ListBuffer> buffer) const {
+    ListSlot& slot = slots_[list_no];
+    pool_bytes_ += buffer->bytes;
+    slot.buffer = std::move(buffer);
+    slot.tier = Tier::POOL;
+    lru_.push_front(list_no);
+    slot.lru_position = lru_.begin();
+
+    // Readers still holding an evicted buffer keep it alive until release
+    while (pool_bytes_ > pool_budget_bytes_ && lru_.size() > 1) {
+        size_t victim = lru_.back();
+        ListSlot& victim_slot = slots_[victim];
+        remove_from_pool_locked(victim);
+        victim_slot.buffer.reset();
+        victim_slot.tier = Tier::COLD;
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t TieredInvertedLists::trim_pool(size_t bytes) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    size_t freed = 0;
+    while (freed < bytes && !lru_.empty()) {
+        size_t victim = lru_.back();
+        ListSlot& victim_slot = slots_[victim];
+        freed += victim_slot.buffer->bytes;
+        remove_from_pool_locked(victim);
+        victim_slot.buffer.reset();
+        victim_slot.tier = Tier::COLD;
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return freed;
+}
+
+size_t TieredInvertedLists::memory_bytes() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return hot_bytes_ + pool_bytes_;
+}
+
+void TieredInvertedLists::remove_from_pool_locked(size_t list_no) const {
+    ListSlot& slot = slots_[list_no];
+    lru_.erase(slot.lru_position);
+    pool_bytes_ -= slot.buffer->bytes;
+}
+
+std::shared_ptr<TieredInvertedLists::ListBuffer> TieredInvertedLists::mutable_list(size_t list_no, size_t min_capacity) {
+    ListSlot& slot = slots_[list_no];
+    std::shared_ptr<ListBuffer> current;
+    if (slot.size.load() > 0) {
+        current = acquire(list_no, false);
+    }
+
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (slot.dirty && slot.buffer && slot.buffer->capacity >= min_capacity) {
+        return slot.buffer;
+    }
+
+    // Copy on first write or growth; readers keep the buffer they pinned
+    size_t size = slot.size.load();
+    size_t capacity = current ? current->capacity : 0;
+    if (capacity < min_capacity) {
+        capacity = std::max(min_capacity, capacity * 2);
+    }
+    capacity = std::max<size_t>(capacity, 1);
+    auto buffer = std::make_shared<ListBuffer>();
+    buffer->bytes = align_up(list_bytes(capacity), kDirectIoAlignment);
+    buffer->block = static_cast<uint8_t*>(allocate_direct_io_buffer(buffer->bytes));
+    if (!buffer->block) {
+        throw std::bad_alloc();
+    }
+    buffer->capacity = capacity;
+    if (current && size > 0) {
+        std::memcpy(buffer->codes(), current->codes(), size * code_size);
+        std::memcpy(buffer->ids(code_size), current->ids(code_size), size * sizeof(faiss::idx_t));
+    }
+
+    if (slot.buffer && slot.tier == Tier::POOL) {
+        remove_from_pool_locked(list_no);
+    } else if (slot.buffer && slot.tier == Tier::HOT) {
+        hot_bytes_ -= slot.buffer->bytes;
+    }
+    slot.buffer = buffer;
+    slot.tier = Tier::HOT;
+    slot.dirty = true;
+    hot_bytes_ += buffer->bytes;
+    return buffer;
+}
+
+size_t TieredInvertedLists::add_entries(size_t list_no, size_t n_entry,
+                                        const faiss::idx_t* ids, const uint8_t* code) {
+    if (n_entry == 0) {
+        return 0;
+    }
+    size_t offset = slots_[list_no].size.load();
+    std::shared_ptr<ListBuffer> buffer = mutable_list(list_no, offset + n_entry);
+    std::memcpy(buffer->codes() + offset * code_size, code, n_entry * code_size);
+    std::memcpy(buffer->ids(code_size) + offset, ids, n_entry * sizeof(faiss::idx_t));
+    slots_[list_no].size.store(offset + n_entry, std::memory_order_release);
+    return offset;
+}
+
+void TieredInvertedLists::update_entries(size_t list_no, size_t offset, size_t n_entry,
+                                         const faiss::idx_t* ids, const uint8_t* code) {
+    std::shared_ptr<ListBuffer> buffer = mutable_list(list_no, slots_[list_no].size.load());
+    std::memcpy(buffer->codes() + offset * code_size, code, n_entry * code_size);
+    std::memcpy(buffer->ids(code_size) + offset, ids, n_entry * sizeof(faiss::idx_t));
+}
+
+void TieredInvertedLists::resize(size_t list_no, size_t new_size) {
+    mutable_list(list_no, new_size);
+    slots_[list_no].size.store(new_size, std::memory_order_release);
+}
+
+void TieredInvertedLists::rebalance(double decay) {
+    std::lock_guard<std::mutex> rebalance_lock(rebalance_mutex_);
+
+    struct Candidate {
+        size_t list_no;
+        double density;
+        bool hot;
+        size_t bytes;
+    };
+    std::vector<Candidate> candidates;
+    size_t budget = hot_budget_bytes_;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (size_t list_no = 0; list_no < nlist; ++list_no) {
+            ListSlot& slot = slots_[list_no];
+            slot.score = slot.score * decay + static_cast<double>(slot.accesses.exchange(0));
+            if (slot.dirty) {
+                budget -= std::min(budget, slot.buffer->bytes);
+            } else if (slot.file_bytes > 0) {
+                bool hot = slot.tier == Tier::HOT;
+                double score = hot ? slot.score * kPromotionHysteresis + kPromotionMinAccesses : slot.score;
+                double density = score / slot.file_bytes;
+                candidates.push_back({list_no, density, hot, slot.file_bytes});
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.density != b.density) {
+            return a.density > b.density;
+        }
+        return a.hot > b.hot;
+    });
+
+    std::vector<size_t> promote;
+    std::vector<size_t> demote;
+    for (const Candidate& candidate : candidates) {
+        bool fits = candidate.bytes <= budget;
+        if (fits) {
+            budget -= candidate.bytes;
+        }
+        if (fits && !candidate.hot) {
+            promote.push_back(candidate.list_no);
+        } else if (!fits && candidate.hot) {
+            demote.push_back(candidate.list_no);
+        }
+    }
+
+    // Demote first so the hot tier never exceeds its budget
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (size_t list_no : demote) {
+            ListSlot& slot = slots_[list_no];
+            if (slot.tier != Tier::HOT || slot.dirty) {
+                continue;
+            }
+            hot_bytes_ -= slot.buffer->bytes;
+            std::shared_ptr<ListBuffer> buffer = std::move(slot.buffer);
+            admit_to_pool_locked(list_no, std::move(buffer));
+            demotions_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    for (size_t list_no : promote) {
+        // Reads here go through acquire so concurrent searches share them
+        std::shared_ptr<ListBuffer> buffer;
+        try {
+            buffer = acquire(list_no, false);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        ListSlot& slot = slots_[list_no];
+        if (slot.tier == Tier::HOT) {
+            continue;
+        }
+        if (slot.tier == Tier::POOL) {
+            remove_from_pool_locked(list_no);
+        }
+        slot.buffer = std::move(buffer);
+        slot.tier = Tier::HOT;
+        hot_bytes_ += slot.buffer->bytes;
+        promotions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TieredInvertedLists::start_rebalancing(std::chrono::milliseconds interval, double decay) {
+    std::lock_guard<std::mutex> lock(rebalance_wait_mutex_);
+    if (rebalancing_) {
+        return;
+    }
+    rebalancing_ = true;
+    rebalance_thread_ = std::thread(&TieredInvertedLists::rebalance_loop, this, interval, decay);
+}
+
+void TieredInvertedLists::stop() {
+    {
+        std::lock_guard<std::mutex> lock(rebalance_wait_mutex_);
+        rebalancing_ = false;
+    }
+    rebalance_condition_.notify_all();
+    if (rebalance_thread_.joinable()) {
+        rebalance_thread_.join();
+    }
+}
+
+void TieredInvertedLists::rebalance_loop(std::chrono::milliseconds interval, double decay) {
+    std::unique_lock<std::mutex> lock(rebalance_wait_mutex_);
+    while (!rebalance_condition_.wait_for(lock, interval, [this]() { return !rebalancing_; })) {
+        lock.unlock();
+        rebalance(decay);
+        lock.lock();
+    }
+}
+
+std::vector<MemoryRegion> TieredInvertedLists::hot_regions() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    std::vector<MemoryRegion> regions;
+    for (size_t list_no = 0; list_no < nlist; ++list_no) {
+        const ListSlot& slot = slots_[list_no];
+        if (slot.tier == Tier::HOT && slot.buffer) {
+            regions.push_back({slot.buffer->block, slot.buffer->bytes});
+        }
+    }
+    return regions;
+}
+
+nlohmann::json TieredInvertedLists::get_statistics() const {
+    nlohmann::json stats;
+    size_t hot_lists = 0;
+    size_t pool_lists = 0;
+    size_t dirty_lists = 0;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (size_t list_no = 0; list_no < nlist; ++list_no) {
+            const ListSlot& slot = slots_[list_no];
+            hot_lists += slot.tier == Tier::HOT;
+            pool_lists += slot.tier == Tier::POOL;
+            dirty_lists += slot.dirty;
+        }
+        stats["hot_bytes"] = hot_bytes_;
+        stats["pool_bytes"] = pool_bytes_;
+    }
+
+    uint64_t hot_hits = hot_hits_.load();
+    uint64_t pool_hits = pool_hits_.load();
+    uint64_t reads = sync_reads_.load() + prefetch_waits_.load();
+    uint64_t total = hot_hits + pool_hits + reads;
+
+    stats["path"] = path_;
+    stats["nlist"] = nlist;
+    stats["hot_lists"] = hot_lists;
+    stats["pool_lists"] = pool_lists;
+    stats["dirty_lists"] = dirty_lists;
+    stats["hot_budget_bytes"] = hot_budget_bytes_;
+    stats["pool_budget_bytes"] = pool_budget_bytes_;
+    stats["hot_hits"] = hot_hits;
+    stats["pool_hits"] = pool_hits;
+    stats["sync_reads"] = sync_reads_.load();
+    stats["prefetch_reads"] = prefetch_reads_.load();
+    stats["prefetch_waits"] = prefetch_waits_.load();
+    stats["read_failures"] = read_failures_.load();
+    stats["evictions"] = evictions_.load();
+    stats["promotions"] = promotions_.load();
+    stats["demotions"] = demotions_.load();
+    stats["memory_hit_rate"] = total > 0 ? static_cast<double>(hot_hits + pool_hits) / total : 0.0;
+    stats["reader"] = reader_->get_statistics();
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::enable_tiered_lists(const std::string& cold_path,
+                                             size_t hot_budget_bytes,
+                                             size_t pool_budget_bytes,
+                                             std::chrono::seconds rebalance_interval) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto* ivf = dynamic_cast<faiss::IndexIVF*>(index_.get());
+    if (!ivf) {
+        std::cerr << "Tiered lists require an IVF index" << std::endl;
+        return false;
+    }
+    if (dynamic_cast<TieredInvertedLists*>(ivf->invlists)) {
+        return true;
+    }
+
+    // The loaded index is the source of truth; rewrite the cold file from it
+    if (!TieredInvertedLists::write_cold_file(*ivf->invlists, cold_path)) {
+        return false;
+    }
+
+    auto reader = std::make_shared<AsyncFileReader>();
+    auto tiered = std::make_unique<TieredInvertedLists>(
+        ivf->nlist, ivf->invlists->code_size, hot_budget_bytes, pool_budget_bytes, reader);
+    if (!tiered->open(cold_path)) {
+        return false;
+    }
+    tiered->start_rebalancing(rebalance_interval, 0.5);
+
+    // Frees the in-memory lists; the index owns the tiered lists from here on
+    ivf->replace_invlists(tiered.release(), true);
+    return true;
+}
+
+nlohmann::json VectorSearchEngine::get_tiering_statistics() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto serving = serving_index();
+    auto* ivf = dynamic_cast<faiss::IndexIVF*>(serving.get());
+    auto* tiered = ivf ? dynamic_cast<TieredInvertedLists*>(ivf->invlists) : nullptr;
+    if (!tiered) {
+        return {{"enabled", false}};
+    }
+    nlohmann::json stats = tiered->get_statistics();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
@@ -0,0 +1,381 @@
+/**
+ * @file vector_preprocessor.cpp
+ * @brief Normalization, centering and PCA/OPQ reduction applied before indexing
+ */
+
+#include "vector_preprocessor.h"
+#include "checksum.h"
+#include "simd_kernels.h"
+#include "vector_search.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+
+#include <omp.h>
+#include <faiss/VectorTransform.h>
+#include <faiss/impl/FaissException.h>
+
+namespace neurorag {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x5456524E;    // "NRVT"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kNormalizeInput = 1u << 0;
+constexpr uint32_t kNormalizeOutput = 1u << 1;
+constexpr uint32_t kCentered = 1u << 2;
+constexpr size_t kParallelRows = 256;
+
+struct TransformHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t rotation;
+    uint32_t input_dimension;
+    uint32_t output_dimension;
+    float explained_variance;
+    uint32_t reserved;
+};
+
+float inverse_norm(const float* x, size_t d) {
+    float norm = simd::norm_sqr(x, d);
+    return norm > 0.0f ? 1.0f / std::sqrt(norm) : 1.0f;
+}
+
+const char* rotation_name(VectorPreprocessor::Rotation rotation) {
+    switch (rotation) {
+        case VectorPreprocessor::Rotation::PCA: return "pca";
+        case VectorPreprocessor::Rotation::OPQ: return "opq";
+        default: return "none";
+    }
+}
+
+} // namespace
+
+std::unique_ptr<VectorPreprocessor> VectorPreprocessor::train(size_t n, const float* x, int d,
+                                                              const VectorPreprocessorOptions& options,
+                                                              std::string& error) {
+    int output = options.output_dimension > 0 ? options.output_dimension : d;
+    if (d <= 0 || n == 0) {
+        error = "no training vectors";
+        return nullptr;
+    }
+    if (output > d) {
+        error = "output dimension " + std::to_string(output) + " exceeds the input dimension " + std::to_string(d);
+        return nullptr;
+    }
+    if (options.rotation != "none" && options.rotation != "pca" && options.rotation != "opq") {
+        error = "unknown rotation '" + options.rotation + "' (none, pca or opq)";
+        return nullptr;
+    }
+    if (options.rotation == "none" && output != d) {
+        error = "reducing dimensions needs --pca or --opq";
+        return nullptr;
+    }
+
+    std::unique_ptr<VectorPreprocessor> preprocessor(new VectorPreprocessor());
+    preprocessor->input_dimension_ = d;
+    preprocessor->output_dimension_ = output;
+    preprocessor->normalize_input_ = options.normalize;
+
+    // Trained on what the rotation will see: normalized inputs
+    size_t rows = std::min(n, std::max<size_t>(options.training_size, 1));
+    std::vector<float> sample(x, x + rows * d);
+    if (options.normalize) {
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < rows; ++i) {
+            simd::scale(&sample[i * d], inverse_norm(&sample[i * d], d), d);
+        }
+    }
+
+    std::vector<float> mean;
+    try {
+        if (options.rotation == "pca") {
+            faiss::PCAMatrix pca(d, output, 0, false);
+            pca.train(static_cast<faiss::idx_t>(rows), sample.data());
+            preprocessor->rotation_ = Rotation::PCA;
+            preprocessor->matrix_.assign(pca.A.begin(), pca.A.begin() + static_cast<size_t>(output) * d);
+            mean = pca.mean;
+            double total = std::accumulate(pca.eigenvalues.begin(), pca.eigenvalues.end(), 0.0);
+            double kept = std::accumulate(pca.eigenvalues.begin(), pca.eigenvalues.begin() + output, 0.0);
+            preprocessor->explained_variance_ = total > 0.0 ? static_cast<float>(kept / total) : 1.0f;
+        } else if (options.rotation == "opq") {
+            int subquantizers = options.opq_subquantizers;
+            if (subquantizers <= 0) {
+                subquantizers = std::min(16, output);
+                while (output % subquantizers != 0) {
+                    --subquantizers;
+                }
+            }
+            if (output % subquantizers != 0) {
+                error = "OPQ sub-quantizers must divide the output dimension";
+                return nullptr;
+            }
+            faiss::OPQMatrix opq(d, subquantizers, output);
+            opq.train(static_cast<faiss::idx_t>(rows), sample.data());
+            preprocessor->rotation_ = Rotation::OPQ;
+            preprocessor->matrix_.assign(opq.A.begin(), opq.A.begin() + static_cast<size_t>(output) * d);
+        }
+    } catch (const faiss::FaissException& e) {
+        error = std::string("training failed: ") + e.what();
+        return nullptr;
+    }
+
+    if (options.center) {
+        if (mean.empty()) {
+            mean.assign(d, 0.0f);
+            for (size_t i = 0; i < rows; ++i) {
+                for (int j = 0; j < d; ++j) {
+                    mean[j] += sample[i * d + j];
+                }
+            }
+            for (float& value : mean) {
+                value /= static_cast<float>(rows);
+            }
+        }
+        if (preprocessor->matrix_.empty()) {
+            preprocessor->offset_ = mean;
+        } else {
+            preprocessor->offset_.resize(output);
+            simd::gemv(preprocessor->matrix_.data(), output, d, mean.data(), 1.0f, nullptr,
+                       preprocessor->offset_.data());
+        }
+    }
+
+    // A rotation keeps unit length; centering or dropping dimensions does not
+    preprocessor->normalize_output_ = options.normalize && (options.center || output != d);
+    return preprocessor;
+}
+
+std::unique_ptr<VectorPreprocessor> VectorPreprocessor::normalization(int d) {
+    std::unique_ptr<VectorPreprocessor> preprocessor(new VectorPreprocessor());
+    preprocessor->input_dimension_ = d;
+    preprocessor->output_dimension_ = d;
+    preprocessor->normalize_input_ = true;
+    return preprocessor;
+}
+
+void VectorPreprocessor::serialize(std::vector<uint8_t>& buffer) const {
+    TransformHeader header{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.flags = (normalize_input_ ? kNormalizeInput : 0) | (normalize_output_ ? kNormalizeOutput : 0) |
+                   (offset_.empty() ? 0 : kCentered);
+    header.rotation = static_cast<uint32_t>(rotation_);
+    header.input_dimension = static_cast<uint32_t>(input_dimension_);
+    header.output_dimension = static_cast<uint32_t>(output_dimension_);
+    header.explained_variance = explained_variance_;
+
+    size_t floats = matrix_.size() + offset_.size();
+    buffer.resize(sizeof(header) + floats * sizeof(float) + sizeof(uint32_t));
+    uint8_t* position = buffer.data();
+    std::memcpy(position, &header, sizeof(header));
+    position += sizeof(header);
+    std::memcpy(position, matrix_.data(), matrix_.size() * sizeof(float));
+    position += matrix_.size() * sizeof(float);
+    std::memcpy(position, offset_.data(), offset_.size() * sizeof(float));
+    position += offset_.size() * sizeof(float);
+    uint32_t checksum = crc32c(buffer.data(), static_cast<size_t>(position - buffer.data()));
+    std::memcpy(position, &checksum, sizeof(checksum));
+}
+
+std::unique_ptr<VectorPreprocessor> VectorPreprocessor::deserialize(const uint8_t* data, size_t size,
+                                                                    std::string& error) {
+    TransformHeader header;
+    if (size < sizeof(header) + sizeof(uint32_t)) {
+        error = "truncated";
+        return nullptr;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion) {
+        error = "not a vector transform";
+        return nullptr;
+    }
+    if (header.input_dimension == 0 || header.output_dimension == 0 ||
+        header.output_dimension > header.input_dimension || header.rotation > 2 ||
+        (header.rotation == 0 && header.output_dimension != header.input_dimension)) {
+        error = "bad dimensions or rotation";
+        return nullptr;
+    }
+
+    size_t matrix_size = header.rotation != 0 ? size_t{header.output_dimension} * header.input_dimension : 0;
+    size_t offset_size = (header.flags & kCentered) ? header.output_dimension : 0;
+    size_t expected = sizeof(header) + (matrix_size + offset_size) * sizeof(float) + sizeof(uint32_t);
+    uint32_t stored_checksum;
+    if (size != expected) {
+        error = "truncated";
+        return nullptr;
+    }
+    std::memcpy(&stored_checksum, data + size - sizeof(uint32_t), sizeof(stored_checksum));
+    if (crc32c(data, size - sizeof(uint32_t)) != stored_checksum) {
+        error = "checksum mismatch";
+        return nullptr;
+    }
+
+    std::unique_ptr<VectorPreprocessor> preprocessor(new VectorPreprocessor());
+    preprocessor->input_dimension_ = static_cast<int>(header.input_dimension);
+    preprocessor->output_dimension_ = static_cast<int>(header.output_dimension);
+    preprocessor->normalize_input_ = (header.flags & kNormalizeInput) != 0;
+    preprocessor->normalize_output_ = (header.flags & kNormalizeOutput) != 0;
+    preprocessor->rotation_ = static_cast<Rotation>(header.rotation);
+    preprocessor->explained_variance_ = header.explained_variance;
+    const float* floats = reinterpret_cast<const float*>(data + sizeof(header));
+    preprocessor->matrix_.assign(floats, floats + matrix_size);
+    preprocessor->offset_.assign(floats + matrix_size, floats + matrix_size + offset_size);
+    return preprocessor;
+}
+
+bool VectorPreprocessor::save(const std::string& path) const {
+    std::vector<uint8_t> buffer;
+    serialize(buffer);
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "VectorPreprocessor: cannot write " << temp_path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        if (!file) {
+            std::cerr << "VectorPreprocessor: short write to " << temp_path << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "VectorPreprocessor: cannot rename " << temp_path << " to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<VectorPreprocessor> VectorPreprocessor::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string error;
+    auto preprocessor = deserialize(data.data(), data.size(), error);
+    if (!preprocessor) {
+        std::cerr << "VectorPreprocessor: " << path << ": " << error << std::endl;
+    }
+    return preprocessor;
+}
+
+void VectorPreprocessor::apply_one(const float* x, float* y) const {
+    float factor = normalize_input_ ? inverse_norm(x, input_dimension_) : 1.0f;
+    const float* offset = offset_.empty() ? nullptr : offset_.data();
+    if (!matrix_.empty()) {
+        simd::gemv(matrix_.data(), output_dimension_, input_dimension_, x, factor, offset, y);
+    } else {
+        simd::scale_sub(x, factor, offset, y, input_dimension_);
+    }
+    if (normalize_output_) {
+        simd::scale(y, inverse_norm(y, output_dimension_), output_dimension_);
+    }
+}
+
+void VectorPreprocessor::apply(size_t n, const float* x, float* y) const {
+    size_t in = static_cast<size_t>(input_dimension_);
+    size_t out = static_cast<size_t>(output_dimension_);
+    if (n < kParallelRows || omp_in_parallel()) {
+        for (size_t i = 0; i < n; ++i) {
+            apply_one(x + i * in, y + i * out);
+        }
+        return;
+    }
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+        apply_one(x + i * in, y + i * out);
+    }
+}
+
+bool VectorPreprocessor::normalizes_output() const {
+    // Normalizing alone, or a rotation of normalized vectors, keeps unit length
+    return normalize_output_ || (normalize_input_ && offset_.empty() && output_dimension_ == input_dimension_);
+}
+
+bool VectorPreprocessor::is_identity() const {
+    return !normalize_input_ && !normalize_output_ && matrix_.empty() && offset_.empty();
+}
+
+nlohmann::json VectorPreprocessor::describe() const {
+    nlohmann::json info;
+    info["input_dimension"] = input_dimension_;
+    info["output_dimension"] = output_dimension_;
+    info["normalize"] = normalize_input_;
+    info["center"] = !offset_.empty();
+    info["rotation"] = rotation_name(rotation_);
+    info["unit_length_output"] = normalizes_output();
+    if (rotation_ == Rotation::PCA) {
+        info["explained_variance"] = explained_variance_;
+    }
+    info["kernels"] = simd::instruction_set();
+    return info;
+}
+
+// ---------------------------------------------------------------------------
+// VectorSearchEngine hooks
+// ---------------------------------------------------------------------------
+
+bool VectorSearchEngine::set_vector_preprocessor(std::shared_ptr<const VectorPreprocessor> preprocessor) {
+    if (preprocessor && preprocessor->input_dimension() != config_.dimension) {
+        std::cerr << "Vector transform takes dimension " << preprocessor->input_dimension()
+                  << ", embeddings have " << config_.dimension << std::endl;
+        return false;
+    }
+    if (preprocessor && preprocessor->is_identity()) {
+        preprocessor.reset();
+    }
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    int output = preprocessor ? preprocessor->output_dimension() : config_.dimension;
+    if (index_ && index_->d != output) {
+        std::cerr << "Vector transform produces dimension " << output << ", the index has "
+                  << index_->d << std::endl;
+        return false;
+    }
+    std::atomic_store(&preprocessor_, std::move(preprocessor));
+    return true;
+}
+
+std::shared_ptr<const VectorPreprocessor> VectorSearchEngine::vector_preprocessor() const {
+    return std::atomic_load(&preprocessor_);
+}
+
+const float* VectorSearchEngine::preprocess_vectors(const float* vectors, size_t n,
+                                                    std::vector<float>& buffer) const {
+    auto preprocessor = vector_preprocessor();
+    if (!preprocessor) {
+        return vectors;
+    }
+    buffer.resize(n * preprocessor->output_dimension());
+    preprocessor->apply(n, vectors, buffer.data());
+    return buffer.data();
+}
+
+int VectorSearchEngine::index_dimension() const {
+    auto preprocessor = vector_preprocessor();
+    return preprocessor ? preprocessor->output_dimension() : config_.dimension;
+}
+
+bool VectorSearchEngine::vectors_normalized() const {
+    auto preprocessor = vector_preprocessor();
+    return preprocessor && preprocessor->normalizes_output();
+}
+
+nlohmann::json VectorSearchEngine::get_preprocessing_statistics() const {
+    auto preprocessor = vector_preprocessor();
+    if (!preprocessor) {
+        return {{"enabled", false}, {"dimension", config_.dimension}};
+    }
+    nlohmann::json stats = preprocessor->describe();
+    stats["enabled"] = true;
+    return stats;
+}
+
+} // namespace neurorag
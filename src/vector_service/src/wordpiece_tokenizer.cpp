@@ -0,0 +1,266 @@
+/**
+ * @file wordpiece_tokenizer.cpp
+ * @brief BERT WordPiece tokenization for the in-process text encoder
+ */
+
+#include "wordpiece_tokenizer.h"
+
+#include <algorithm>
+
+namespace neurorag {
+
+namespace {
+
+constexpr size_t kMaxWordCodepoints = 100;   // longer words become [UNK], as in BERT
+
+// Lowercased, accent-stripped form of U+00C0..U+017F and U+0370..U+04FF
+// (Python: NFD of str.lower() without combining marks, where that is one
+// code point)
+const char16_t kFoldLatin[] = {
+    0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x00E6, 0x0063, 0x0065, 0x0065, 0x0065, 0x0065,
+    0x0069, 0x0069, 0x0069, 0x0069, 0x00F0, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x00D7,
+    0x00F8, 0x0075, 0x0075, 0x0075, 0x0075, 0x0079, 0x00FE, 0x00DF, 0x0061, 0x0061, 0x0061, 0x0061,
+    0x0061, 0x0061, 0x00E6, 0x0063, 0x0065, 0x0065, 0x0065, 0x0065, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x00F0, 0x006E, 0x006F, 0x006F, 0x006F, 0x006F, 0x006F, 0x00F7, 0x00F8, 0x0075, 0x0075, 0x0075,
+    0x0075, 0x0079, 0x00FE, 0x0079, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0061, 0x0063, 0x0063,
+    0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0063, 0x0064, 0x0064, 0x0111, 0x0111, 0x0065, 0x0065,
+    0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0065, 0x0067, 0x0067, 0x0067, 0x0067,
+    0x0067, 0x0067, 0x0067, 0x0067, 0x0068, 0x0068, 0x0127, 0x0127, 0x0069, 0x0069, 0x0069, 0x0069,
+    0x0069, 0x0069, 0x0069, 0x0069, 0x0069, 0x0131, 0x0133, 0x0133, 0x006A, 0x006A, 0x006B, 0x006B,
+    0x0138, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x006C, 0x0140, 0x0140, 0x0142, 0x0142, 0x006E,
+    0x006E, 0x006E, 0x006E, 0x006E, 0x006E, 0x0149, 0x014B, 0x014B, 0x006F, 0x006F, 0x006F, 0x006F,
+    0x006F, 0x006F, 0x0153, 0x0153, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0072, 0x0073, 0x0073,
+    0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0073, 0x0074, 0x0074, 0x0074, 0x0074, 0x0167, 0x0167,
+    0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075, 0x0075,
+    0x0077, 0x0077, 0x0079, 0x0079, 0x0079, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x007A, 0x017F,
+};
+
+const char16_t kFoldGreekCyrillic[] = {
+    0x0371, 0x0371, 0x0373, 0x0373, 0x02B9, 0x0375, 0x0377, 0x0377, 0x0378, 0x0379, 0x037A, 0x037B,
+    0x037C, 0x037D, 0x003B, 0x03F3, 0x0380, 0x0381, 0x0382, 0x0383, 0x0384, 0x00A8, 0x03B1, 0x00B7,
+    0x03B5, 0x03B7, 0x03B9, 0x038B, 0x03BF, 0x038D, 0x03C5, 0x03C9, 0x03B9, 0x03B1, 0x03B2, 0x03B3,
+    0x03B4, 0x03B5, 0x03B6, 0x03B7, 0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF,
+    0x03C0, 0x03C1, 0x03A2, 0x03C3, 0x03C4, 0x03C5, 0x03C6, 0x03C7, 0x03C8, 0x03C9, 0x03B9, 0x03C5,
+    0x03B1, 0x03B5, 0x03B7, 0x03B9, 0x03C5, 0x03B1, 0x03B2, 0x03B3, 0x03B4, 0x03B5, 0x03B6, 0x03B7,
+    0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF, 0x03C0, 0x03C1, 0x03C2, 0x03C3,
+    0x03C4, 0x03C5, 0x03C6, 0x03C7, 0x03C8, 0x03C9, 0x03B9, 0x03C5, 0x03BF, 0x03C5, 0x03C9, 0x03D7,
+    0x03D0, 0x03D1, 0x03D2, 0x03D2, 0x03D2, 0x03D5, 0x03D6, 0x03D7, 0x03D9, 0x03D9, 0x03DB, 0x03DB,
+    0x03DD, 0x03DD, 0x03DF, 0x03DF, 0x03E1, 0x03E1, 0x03E3, 0x03E3, 0x03E5, 0x03E5, 0x03E7, 0x03E7,
+    0x03E9, 0x03E9, 0x03EB, 0x03EB, 0x03ED, 0x03ED, 0x03EF, 0x03EF, 0x03F0, 0x03F1, 0x03F2, 0x03F3,
+    0x03B8, 0x03F5, 0x03F6, 0x03F8, 0x03F8, 0x03F2, 0x03FB, 0x03FB, 0x03FC, 0x037B, 0x037C, 0x037D,
+    0x0435, 0x0435, 0x0452, 0x0433, 0x0454, 0x0455, 0x0456, 0x0456, 0x0458, 0x0459, 0x045A, 0x045B,
+    0x043A, 0x0438, 0x0443, 0x045F, 0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0438, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F, 0x0440, 0x0441, 0x0442, 0x0443,
+    0x0444, 0x0445, 0x0446, 0x0447, 0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437, 0x0438, 0x0438, 0x043A, 0x043B,
+    0x043C, 0x043D, 0x043E, 0x043F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F, 0x0435, 0x0435, 0x0452, 0x0433,
+    0x0454, 0x0455, 0x0456, 0x0456, 0x0458, 0x0459, 0x045A, 0x045B, 0x043A, 0x0438, 0x0443, 0x045F,
+    0x0461, 0x0461, 0x0463, 0x0463, 0x0465, 0x0465, 0x0467, 0x0467, 0x0469, 0x0469, 0x046B, 0x046B,
+    0x046D, 0x046D, 0x046F, 0x046F, 0x0471, 0x0471, 0x0473, 0x0473, 0x0475, 0x0475, 0x0475, 0x0475,
+    0x0479, 0x0479, 0x047B, 0x047B, 0x047D, 0x047D, 0x047F, 0x047F, 0x0481, 0x0481, 0x0482, 0x0483,
+    0x0484, 0x0485, 0x0486, 0x0487, 0x0488, 0x0489, 0x048B, 0x048B, 0x048D, 0x048D, 0x048F, 0x048F,
+    0x0491, 0x0491, 0x0493, 0x0493, 0x0495, 0x0495, 0x0497, 0x0497, 0x0499, 0x0499, 0x049B, 0x049B,
+    0x049D, 0x049D, 0x049F, 0x049F, 0x04A1, 0x04A1, 0x04A3, 0x04A3, 0x04A5, 0x04A5, 0x04A7, 0x04A7,
+    0x04A9, 0x04A9, 0x04AB, 0x04AB, 0x04AD, 0x04AD, 0x04AF, 0x04AF, 0x04B1, 0x04B1, 0x04B3, 0x04B3,
+    0x04B5, 0x04B5, 0x04B7, 0x04B7, 0x04B9, 0x04B9, 0x04BB, 0x04BB, 0x04BD, 0x04BD, 0x04BF, 0x04BF,
+    0x04CF, 0x0436, 0x0436, 0x04C4, 0x04C4, 0x04C6, 0x04C6, 0x04C8, 0x04C8, 0x04CA, 0x04CA, 0x04CC,
+    0x04CC, 0x04CE, 0x04CE, 0x04CF, 0x0430, 0x0430, 0x0430, 0x0430, 0x04D5, 0x04D5, 0x0435, 0x0435,
+    0x04D9, 0x04D9, 0x04D9, 0x04D9, 0x0436, 0x0436, 0x0437, 0x0437, 0x04E1, 0x04E1, 0x0438, 0x0438,
+    0x0438, 0x0438, 0x043E, 0x043E, 0x04E9, 0x04E9, 0x04E9, 0x04E9, 0x044D, 0x044D, 0x0443, 0x0443,
+    0x0443, 0x0443, 0x0443, 0x0443, 0x0447, 0x0447, 0x04F7, 0x04F7, 0x044B, 0x044B, 0x04FB, 0x04FB,
+    0x04FD, 0x04FD, 0x04FF, 0x04FF,
+};
+
+char32_t next_codepoint(const std::string& text, size_t& i) {
+    unsigned char lead = static_cast<unsigned char>(text[i++]);
+    if (lead < 0x80) {
+        return lead;
+    }
+    int length = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+    if (length < 0 || lead >= 0xF8) {
+        return 0xFFFD;
+    }
+    char32_t cp = lead & (0x3F >> length);
+    for (int k = 0; k < length; ++k) {
+        if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+    }
+    return cp;
+}
+
+void append_utf8(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool is_whitespace(char32_t cp) {
+    return cp == ' ' || cp == '\t' || cp == '\n' || cp == '\r' || cp == 0xA0 || cp == 0x1680 ||
+           (cp >= 0x2000 && cp <= 0x200A) || cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
+
+bool is_control(char32_t cp) {
+    return cp < 0x20 || (cp >= 0x7F && cp <= 0x9F) || cp == 0xAD || (cp >= 0x200B && cp <= 0x200F) ||
+           (cp >= 0x2060 && cp <= 0x2064) || cp == 0xFEFF || cp == 0xFFFD;
+}
+
+bool is_punctuation(char32_t cp) {
+    // All non-alphanumeric ASCII counts, as in BERT, plus the common Unicode punctuation blocks
+    return (cp >= 33 && cp <= 47) || (cp >= 58 && cp <= 64) || (cp >= 91 && cp <= 96) ||
+           (cp >= 123 && cp <= 126) || cp == 0xA1 || cp == 0xA7 || cp == 0xAB || cp == 0xB6 ||
+           cp == 0xB7 || cp == 0xBB || cp == 0xBF || (cp >= 0x2010 && cp <= 0x2027) ||
+           (cp >= 0x2030 && cp <= 0x205E) || (cp >= 0x3001 && cp <= 0x3003) ||
+           (cp >= 0x3008 && cp <= 0x3011) || (cp >= 0x3014 && cp <= 0x301F) ||
+           (cp >= 0xFF01 && cp <= 0xFF0F) || (cp >= 0xFF1A && cp <= 0xFF20) ||
+           (cp >= 0xFF3B && cp <= 0xFF40) || (cp >= 0xFF5B && cp <= 0xFF65);
+}
+
+bool is_cjk(char32_t cp) {
+    return (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF) ||
+           (cp >= 0x20000 && cp <= 0x2A6DF) || (cp >= 0x2A700 && cp <= 0x2CEAF) ||
+           (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0x2F800 && cp <= 0x2FA1F);
+}
+
+bool is_combining_mark(char32_t cp) {
+    return (cp >= 0x300 && cp <= 0x36F) || (cp >= 0x483 && cp <= 0x489);
+}
+
+// Lowercase and strip accents; 0 drops the code point
+char32_t fold(char32_t cp) {
+    if (cp < 0x80) {
+        return cp >= 'A' && cp <= 'Z' ? cp + ('a' - 'A') : cp;
+    }
+    if (is_combining_mark(cp)) {
+        return 0;
+    }
+    if (cp >= 0xC0 && cp < 0x180) {
+        return kFoldLatin[cp - 0xC0];
+    }
+    if (cp >= 0x370 && cp < 0x500) {
+        return kFoldGreekCyrillic[cp - 0x370];
+    }
+    return cp;
+}
+
+} // namespace
+
+WordPieceTokenizer::WordPieceTokenizer(const std::vector<std::string>& vocab, bool lowercase)
+    : lowercase_(lowercase) {
+    vocab_.reserve(vocab.size());
+    for (size_t i = 0; i < vocab.size(); ++i) {
+        vocab_.emplace(vocab[i], static_cast<int32_t>(i));
+    }
+    cls_id_ = token_id("[CLS]");
+    sep_id_ = token_id("[SEP]");
+    unk_id_ = token_id("[UNK]");
+}
+
+int32_t WordPieceTokenizer::token_id(const std::string& token) const {
+    auto it = vocab_.find(token);
+    return it != vocab_.end() ? it->second : -1;
+}
+
+void WordPieceTokenizer::split_words(const std::string& text, std::vector<std::string>& words) const {
+    std::string word;
+    auto flush = [&] {
+        if (!word.empty()) {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    };
+
+    for (size_t i = 0; i < text.size();) {
+        char32_t cp = next_codepoint(text, i);
+        if (is_whitespace(cp)) {
+            flush();
+            continue;
+        }
+        if (cp == 0 || is_control(cp)) {
+            continue;
+        }
+        if (lowercase_ && (cp = fold(cp)) == 0) {
+            continue;
+        }
+        if (is_punctuation(cp) || is_cjk(cp)) {
+            flush();
+            append_utf8(word, cp);
+            flush();
+            continue;
+        }
+        append_utf8(word, cp);
+    }
+    flush();
+}
+
+void WordPieceTokenizer::append_pieces(const std::string& word, std::vector<int32_t>& ids) const {
+    // Byte offset of every code point boundary
+    std::vector<size_t> boundaries;
+    for (size_t i = 0; i < word.size(); ++i) {
+        if ((static_cast<unsigned char>(word[i]) & 0xC0) != 0x80) {
+            boundaries.push_back(i);
+        }
+    }
+    boundaries.push_back(word.size());
+    if (boundaries.size() - 1 > kMaxWordCodepoints) {
+        ids.push_back(unk_id_);
+        return;
+    }
+
+    size_t first_piece = ids.size();
+    std::string piece;
+    for (size_t start = 0; start + 1 < boundaries.size();) {
+        int32_t id = -1;
+        size_t end = boundaries.size() - 1;
+        for (; end > start; --end) {
+            piece.assign(start > 0 ? "##" : "");
+            piece.append(word, boundaries[start], boundaries[end] - boundaries[start]);
+            if ((id = token_id(piece)) >= 0) {
+                break;
+            }
+        }
+        if (id < 0) {
+            // A word with any unknown part is a single [UNK]
+            ids.resize(first_piece);
+            ids.push_back(unk_id_);
+            return;
+        }
+        ids.push_back(id);
+        start = end;
+    }
+}
+
+void WordPieceTokenizer::encode(const std::string& text, size_t max_tokens, std::vector<int32_t>& ids) const {
+    max_tokens = std::max<size_t>(2, max_tokens);
+    ids.clear();
+    ids.push_back(cls_id_);
+
+    std::vector<std::string> words;
+    split_words(text, words);
+    for (const auto& word : words) {
+        if (ids.size() >= max_tokens - 1) {
+            break;
+        }
+        append_pieces(word, ids);
+    }
+    if (ids.size() > max_tokens - 1) {
+        ids.resize(max_tokens - 1);
+    }
+    ids.push_back(sep_id_);
+}
+
+} // namespace neurorag
@@ -0,0 +1,483 @@
+/**
+ * @file test_async_redis_client.cpp
+ * @brief CacheStore backends against an in-process fake Redis, no server needed
+ *
+ * FakeRedis speaks enough RESP on a loopback socket for AsyncRedisClient
+ * (MGET, SET with EX, DEL, AUTH, SELECT) and records every command, so the
+ * tests can check how lookups were batched. Its replies can be delayed to
+ * make the backend slow, which drives the timeouts and the circuit breaker.
+ */
+
+#include <gtest/gtest.h>
+
+#include "async_redis_client.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace neurorag;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+class FakeRedis {
+public:
+    FakeRedis() {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        ::listen(listen_fd_, 16);
+        socklen_t length = sizeof(address);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+        accept_thread_ = std::thread(&FakeRedis::accept_loop, this);
+    }
+
+    ~FakeRedis() {
+        running_.store(false);
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        ::close(listen_fd_);
+        accept_thread_.join();
+        // Connection threads take mutex_ per command, so join them without it
+        for (int fd : client_fds_) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        for (auto& thread : client_threads_) {
+            thread.join();
+        }
+        for (int fd : client_fds_) {
+            ::close(fd);
+        }
+    }
+
+    std::string url() const { return "redis://127.0.0.1:" + std::to_string(port_); }
+
+    void put(const std::string& key, const std::string& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        data_[key] = value;
+    }
+
+    bool contains(const std::string& key) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return data_.count(key) != 0;
+    }
+
+    // Every command received, in order
+    std::vector<std::vector<std::string>> commands() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return commands_;
+    }
+
+    std::vector<size_t> mget_sizes() const {
+        std::vector<size_t> sizes;
+        for (const auto& command : commands()) {
+            if (command[0] == "MGET") {
+                sizes.push_back(command.size() - 1);
+            }
+        }
+        return sizes;
+    }
+
+    // Delay before each reply
+    void set_reply_delay(std::chrono::milliseconds delay) { reply_delay_ms_.store(delay.count()); }
+
+private:
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> running_{true};
+    std::atomic<int64_t> reply_delay_ms_{0};
+    std::thread accept_thread_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::string> data_;
+    std::vector<std::vector<std::string>> commands_;
+    std::vector<int> client_fds_;
+    std::vector<std::thread> client_threads_;
+
+    void accept_loop() {
+        while (running_.load()) {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            client_fds_.push_back(fd);
+            client_threads_.emplace_back(&FakeRedis::serve, this, fd);
+        }
+    }
+
+    // Reads one RESP array of bulk strings from buffer; false if incomplete
+    static bool parse(std::string& buffer, std::vector<std::string>& command) {
+        size_t position = 0;
+        auto read_line = [&](std::string& line) {
+            size_t end = buffer.find("\r\n", position);
+            if (end == std::string::npos) {
+                return false;
+            }
+            line = buffer.substr(position, end - position);
+            position = end + 2;
+            return true;
+        };
+
+        std::string line;
+        if (!read_line(line) || line.empty() || line[0] != '*') {
+            return false;
+        }
+        size_t count = std::stoul(line.substr(1));
+        command.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (!read_line(line) || line.empty() || line[0] != '$') {
+                return false;
+            }
+            size_t length = std::stoul(line.substr(1));
+            if (buffer.size() < position + length + 2) {
+                return false;
+            }
+            command.push_back(buffer.substr(position, length));
+            position += length + 2;
+        }
+        buffer.erase(0, position);
+        return true;
+    }
+
+    std::string execute(const std::vector<std::string>& command) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        commands_.push_back(command);
+        const std::string& name = command[0];
+        if (name == "MGET") {
+            std::string reply = "*" + std::to_string(command.size() - 1) + "\r\n";
+            for (size_t i = 1; i < command.size(); ++i) {
+                auto it = data_.find(command[i]);
+                if (it == data_.end()) {
+                    reply += "$-1\r\n";
+                } else {
+                    reply += "$" + std::to_string(it->second.size()) + "\r\n" + it->second + "\r\n";
+                }
+            }
+            return reply;
+        }
+        if (name == "SET") {
+            data_[command[1]] = command[2];
+            return "+OK\r\n";
+        }
+        if (name == "DEL") {
+            size_t removed = 0;
+            for (size_t i = 1; i < command.size(); ++i) {
+                removed += data_.erase(command[i]);
+            }
+            return ":" + std::to_string(removed) + "\r\n";
+        }
+        if (name == "AUTH" || name == "SELECT") {
+            return "+OK\r\n";
+        }
+        return "-ERR unknown command\r\n";
+    }
+
+    void serve(int fd) {
+        std::string buffer;
+        char chunk[4096];
+        while (running_.load()) {
+            ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                break;
+            }
+            buffer.append(chunk, static_cast<size_t>(received));
+            std::vector<std::string> command;
+            while (parse(buffer, command)) {
+                std::string reply = execute(command);
+                int64_t delay_ms = reply_delay_ms_.load();
+                if (delay_ms > 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+                }
+                ::send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+            }
+        }
+    }
+};
+
+// Collects async lookup results
+struct Lookups {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::map<std::string, std::string> hits;
+    size_t misses = 0;
+    size_t completed = 0;
+
+    CacheStore::GetCallback callback(const std::string& key) {
+        return [this, key](bool hit, std::string value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (hit) {
+                hits[key] = std::move(value);
+            } else {
+                ++misses;
+            }
+            ++completed;
+            condition.notify_all();
+        };
+    }
+
+    bool wait_for(size_t count, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, timeout, [&] { return completed >= count; });
+    }
+};
+
+template <typename Predicate>
+bool eventually(Predicate predicate, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+    auto deadline = Clock::now() + timeout;
+    while (Clock::now() < deadline) {
+        if (predicate()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return predicate();
+}
+
+AsyncRedisConfig client_config(const FakeRedis& server) {
+    AsyncRedisConfig config;
+    config.url = server.url();
+    config.pool_size = 1;
+    config.breaker_slow_threshold_us = 1000000;
+    config.reconnect_interval_ms = 50;
+    return config;
+}
+
+// Waits until the client is connected by round-tripping one lookup
+void wait_connected(AsyncRedisClient& client) {
+    ASSERT_TRUE(eventually([&] {
+        std::string value;
+        client.get("__warmup__", value, std::chrono::milliseconds(100));
+        return client.get_statistics()["mget_batches"].get<uint64_t>() > 0;
+    }));
+}
+
+} // namespace
+
+TEST(CircuitBreakerTest, OpensAfterConsecutiveFailuresAndRecoversThroughProbe) {
+    CircuitBreaker breaker(3, std::chrono::microseconds(1000), std::chrono::milliseconds(50));
+    EXPECT_TRUE(breaker.allow_request());
+
+    breaker.record_failure();
+    breaker.record_success(std::chrono::microseconds(10));   // resets the count
+    breaker.record_failure();
+    breaker.record_failure();
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::CLOSED);
+
+    // A slow reply is a failure
+    breaker.record_success(std::chrono::microseconds(5000));
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::OPEN);
+    EXPECT_EQ(breaker.times_opened(), 1u);
+    EXPECT_FALSE(breaker.allow_request());
+
+    // After the cooldown exactly one probe goes through
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_TRUE(breaker.allow_request());
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::HALF_OPEN);
+    EXPECT_FALSE(breaker.allow_request());
+
+    // A failed probe re-opens, a successful one closes
+    breaker.record_failure();
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::OPEN);
+    EXPECT_EQ(breaker.times_opened(), 2u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_TRUE(breaker.allow_request());
+    breaker.record_success(std::chrono::microseconds(10));
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::CLOSED);
+    EXPECT_TRUE(breaker.allow_request());
+}
+
+TEST(InMemoryCacheStoreTest, ExpiresAndEvictsEntries) {
+    InMemoryCacheStore store(2);
+    store.set_async("a", "1", 0);
+    store.set_async("b", "2", 1);
+    std::string value;
+    EXPECT_TRUE(store.get("a", value, std::chrono::milliseconds(100)));
+    EXPECT_EQ(value, "1");
+
+    // Full: a new key evicts one entry
+    store.set_async("c", "3", 0);
+    EXPECT_EQ(store.size(), 2u);
+    EXPECT_EQ(store.get_statistics()["evictions"].get<uint64_t>(), 1u);
+
+    store.set_async("d", "4", 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_FALSE(store.get("d", value, std::chrono::milliseconds(100)));
+
+    store.delete_async({"a", "c"});
+    EXPECT_FALSE(store.get("a", value, std::chrono::milliseconds(100)));
+    EXPECT_FALSE(store.get("c", value, std::chrono::milliseconds(100)));
+}
+
+TEST(CreateCacheStoreTest, MemoryUrlSelectsInMemoryStore) {
+    AsyncRedisConfig config;
+    config.url = "memory://";
+    auto store = create_cache_store(config);
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->get_statistics()["backend"], "memory");
+
+    config.url = "http://localhost";
+    EXPECT_EQ(create_cache_store(config), nullptr);
+}
+
+TEST(AsyncRedisClientTest, ConcurrentLookupsAreCoalescedIntoMget) {
+    FakeRedis server;
+    for (int i = 0; i < 100; i += 2) {
+        server.put("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    auto config = client_config(server);
+    config.max_batch_keys = 16;
+    AsyncRedisClient client(config);
+    ASSERT_TRUE(client.start());
+    wait_connected(client);
+
+    // Replies are slow, so lookups submitted meanwhile queue up behind the first MGET
+    server.set_reply_delay(std::chrono::milliseconds(20));
+    Lookups lookups;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = t; i < 100; i += 4) {
+                std::string key = "key" + std::to_string(i);
+                client.get_async(key, lookups.callback(key));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_TRUE(lookups.wait_for(100));
+
+    EXPECT_EQ(lookups.hits.size(), 50u);
+    EXPECT_EQ(lookups.misses, 50u);
+    EXPECT_EQ(lookups.hits["key42"], "value42");
+
+    // Only MGET is used for lookups, never more keys than the cap, far fewer round trips than keys
+    size_t keys = 0;
+    auto sizes = server.mget_sizes();
+    for (size_t size : sizes) {
+        EXPECT_LE(size, 16u);
+        keys += size;
+    }
+    EXPECT_EQ(keys, 101u);   // the warmup lookup plus 100
+    EXPECT_LT(sizes.size(), 100u);
+    for (const auto& command : server.commands()) {
+        EXPECT_NE(command[0], "GET");
+    }
+}
+
+TEST(AsyncRedisClientTest, WritesAreFireAndForget) {
+    FakeRedis server;
+    AsyncRedisClient client(client_config(server));
+    ASSERT_TRUE(client.start());
+    wait_connected(client);
+
+    server.set_reply_delay(std::chrono::milliseconds(200));
+    auto start = Clock::now();
+    client.set_async("fresh", "payload", 60);
+    client.set_async("forever", "payload", 0);
+    client.delete_async({"stale"});
+    EXPECT_LT(Clock::now() - start, std::chrono::milliseconds(50));
+
+    ASSERT_TRUE(eventually([&] { return server.contains("fresh") && server.contains("forever"); }));
+    auto find = [&](const std::string& name, const std::string& key) {
+        for (const auto& command : server.commands()) {
+            if (command[0] == name && command[1] == key) {
+                return command;
+            }
+        }
+        return std::vector<std::string>();
+    };
+    EXPECT_EQ(find("SET", "fresh"), (std::vector<std::string>{"SET", "fresh", "payload", "EX", "60"}));
+    EXPECT_EQ(find("SET", "forever"), (std::vector<std::string>{"SET", "forever", "payload"}));
+    EXPECT_TRUE(eventually([&] { return !find("DEL", "stale").empty(); }));
+}
+
+TEST(AsyncRedisClientTest, SlowBackendLookupMissesWithinTimeout) {
+    FakeRedis server;
+    server.put("slow", "value");
+    AsyncRedisClient client(client_config(server));
+    ASSERT_TRUE(client.start());
+    wait_connected(client);
+
+    server.set_reply_delay(std::chrono::milliseconds(500));
+    std::string value;
+    auto start = Clock::now();
+    EXPECT_FALSE(client.get("slow", value, std::chrono::milliseconds(20)));
+    EXPECT_LT(Clock::now() - start, std::chrono::milliseconds(200));
+    EXPECT_TRUE(value.empty());
+}
+
+TEST(AsyncRedisClientTest, UnreachableServerMissesImmediately) {
+    AsyncRedisConfig config;
+    {
+        FakeRedis server;   // a port nothing listens on once it is gone
+        config = client_config(server);
+    }
+    config.breaker_failure_threshold = 2;
+    AsyncRedisClient client(config);
+    ASSERT_TRUE(client.start());
+
+    Lookups lookups;
+    for (int i = 0; i < 10; ++i) {
+        client.get_async("key", lookups.callback("key"));
+    }
+    ASSERT_TRUE(lookups.wait_for(10, std::chrono::seconds(1)));
+    EXPECT_EQ(lookups.misses, 10u);
+    EXPECT_TRUE(eventually([&] { return client.get_statistics()["circuit_breaker_trips"].get<uint64_t>() > 0; }));
+}
+
+TEST(AsyncRedisClientTest, BreakerTripsOnSlowRepliesAndRecovers) {
+    FakeRedis server;
+    server.put("key", "value");
+    auto config = client_config(server);
+    config.breaker_failure_threshold = 3;
+    config.breaker_slow_threshold_us = 5000;
+    config.breaker_cooldown_ms = 200;
+    AsyncRedisClient client(config);
+    ASSERT_TRUE(client.start());
+    wait_connected(client);
+
+    // Three slow MGETs in a row open the breaker
+    server.set_reply_delay(std::chrono::milliseconds(20));
+    std::string value;
+    for (int i = 0; i < 3; ++i) {
+        client.get("key", value, std::chrono::milliseconds(500));
+    }
+    ASSERT_TRUE(eventually([&] { return client.get_statistics()["circuit_breaker"] == "open"; }));
+    EXPECT_EQ(client.get_statistics()["circuit_breaker_trips"].get<uint64_t>(), 1u);
+
+    // While open, lookups complete on the calling thread without touching Redis
+    size_t commands_before = server.commands().size();
+    bool completed_inline = false;
+    client.get_async("key", [&](bool hit, std::string) { completed_inline = !hit; });
+    EXPECT_TRUE(completed_inline);
+    client.set_async("dropped", "value", 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(server.commands().size(), commands_before);
+    EXPECT_FALSE(server.contains("dropped"));
+
+    // Backend healthy again: after the cooldown a probe closes the breaker
+    server.set_reply_delay(std::chrono::milliseconds(0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    EXPECT_TRUE(client.get("key", value, std::chrono::milliseconds(500)));
+    EXPECT_EQ(value, "value");
+    EXPECT_EQ(client.get_statistics()["circuit_breaker"], "closed");
+}
@@ -0,0 +1,127 @@
+/**
+ * @file test_index_file.cpp
+ * @brief Checksummed index files: round trip, corruption and truncation
+ */
+
+#include <gtest/gtest.h>
+
+#include "index_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/index_io.h>
+
+using namespace neurorag;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int kDimension = 32;
+constexpr size_t kBlockBytes = 64 * 1024;
+
+class IndexFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = (fs::temp_directory_path() /
+                 ("neurorag_index_file_test_" + std::to_string(::getpid()) + ".nrix")).string();
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        std::vector<float> vectors(4000 * kDimension);
+        for (float& value : vectors) {
+            value = uniform(rng);
+        }
+        index_.add(4000, vectors.data());
+        options_.block_bytes = kBlockBytes;
+    }
+
+    void TearDown() override {
+        std::error_code error;
+        fs::remove(path_, error);
+    }
+
+    // Flips one payload byte inside the given block
+    void corrupt_block(uint64_t block) {
+        int fd = ::open(path_.c_str(), O_RDWR);
+        ASSERT_GE(fd, 0);
+        off_t offset = static_cast<off_t>(kIndexFileHeaderBytes + block * kBlockBytes + 17);
+        char byte = 0;
+        ASSERT_EQ(::pread(fd, &byte, 1, offset), 1);
+        byte ^= 0x01;
+        ASSERT_EQ(::pwrite(fd, &byte, 1, offset), 1);
+        ::close(fd);
+    }
+
+    std::string path_;
+    faiss::IndexFlat index_{kDimension};
+    IndexFileOptions options_;
+};
+
+} // namespace
+
+TEST_F(IndexFileTest, RoundTripKeepsHeaderAndVectors) {
+    ASSERT_TRUE(write_index_file(index_, path_, options_));
+
+    IndexFileCheck check = inspect_index_file(path_);
+    ASSERT_EQ(check.status, IndexFileStatus::OK) << check.message;
+    EXPECT_EQ(check.header.magic, kIndexFileMagic);
+    EXPECT_EQ(check.header.dimension, static_cast<uint32_t>(kDimension));
+    EXPECT_EQ(check.header.ntotal, 4000u);
+    EXPECT_GT(check.header.num_blocks, 3u);
+    EXPECT_EQ(verify_index_file(path_, 2).status, IndexFileStatus::OK);
+
+    options_.verify = IndexVerification::FULL;
+    auto loaded = read_index_file(path_, options_);
+    ASSERT_TRUE(loaded);
+    auto* flat = dynamic_cast<faiss::IndexFlat*>(loaded.get());
+    ASSERT_NE(flat, nullptr);
+    ASSERT_EQ(flat->ntotal, index_.ntotal);
+    EXPECT_EQ(std::memcmp(flat->codes.data(), index_.codes.data(), index_.codes.size()), 0);
+}
+
+TEST_F(IndexFileTest, CorruptBlockIsDetected) {
+    ASSERT_TRUE(write_index_file(index_, path_, options_));
+    corrupt_block(2);
+
+    // The header and table are intact; only a payload pass finds the block
+    EXPECT_EQ(inspect_index_file(path_).status, IndexFileStatus::OK);
+    IndexFileCheck check = verify_index_file(path_, 2);
+    EXPECT_EQ(check.status, IndexFileStatus::CORRUPT);
+    EXPECT_EQ(check.bad_blocks, std::vector<uint64_t>{2});
+
+    options_.verify = IndexVerification::FULL;
+    EXPECT_FALSE(read_index_file(path_, options_));
+    options_.verify = IndexVerification::LAZY;
+    EXPECT_FALSE(read_index_file(path_, options_));
+}
+
+TEST_F(IndexFileTest, TruncatedFileIsRejected) {
+    ASSERT_TRUE(write_index_file(index_, path_, options_));
+    fs::resize_file(path_, kIndexFileHeaderBytes + kBlockBytes);
+
+    EXPECT_EQ(inspect_index_file(path_).status, IndexFileStatus::TRUNCATED);
+    options_.verify = IndexVerification::NONE;
+    EXPECT_FALSE(read_index_file(path_, options_));
+}
+
+TEST_F(IndexFileTest, PlainFaissFileIsLegacy) {
+    faiss::write_index(&index_, path_.c_str());
+
+    IndexFileCheck check = inspect_index_file(path_);
+    EXPECT_EQ(check.status, IndexFileStatus::LEGACY);
+    EXPECT_TRUE(check.ok());
+    auto loaded = read_index_file(path_, options_);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(loaded->ntotal, index_.ntotal);
+}
+
+TEST(IndexFileStatusTest, MissingFileIsUnreadable) {
+    EXPECT_EQ(inspect_index_file("/nonexistent/neurorag/index.bin").status, IndexFileStatus::UNREADABLE);
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_lsm_index.cpp
+ * @brief LsmIndex: what searches see across adds, deletes and merges
+ */
+
+#include <gtest/gtest.h>
+
+#include "lsm_index.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/impl/IDSelector.h>
+
+using namespace neurorag;
+
+namespace {
+
+constexpr int kDimension = 8;
+
+class LsmIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        vectors_.resize(400 * kDimension);
+        for (float& value : vectors_) {
+            value = uniform(rng);
+        }
+        main_ = std::make_shared<faiss::IndexFlat>(kDimension, faiss::METRIC_L2);
+        main_->add(100, vectors_.data());
+    }
+
+    const float* vector(faiss::idx_t id) const { return &vectors_[id * kDimension]; }
+
+    // Id of the nearest neighbour of vector(id), which is id itself while it is searchable
+    faiss::idx_t nearest(const LsmIndex& index, faiss::idx_t id) const {
+        float distances[4];
+        faiss::idx_t labels[4];
+        index.search(1, vector(id), 4, distances, labels);
+        return labels[0];
+    }
+
+    std::vector<float> vectors_;
+    std::shared_ptr<faiss::IndexFlat> main_;
+};
+
+} // namespace
+
+TEST_F(LsmIndexTest, AddedVectorsAreSearchableBeforeAndAfterMerge) {
+    LsmIndex index(main_, "flat", 100);
+    index.add(50, vector(100));
+    EXPECT_EQ(index.ntotal, 150);
+    EXPECT_EQ(index.base_index()->ntotal, 100);
+    EXPECT_EQ(nearest(index, 120), 120);
+    EXPECT_EQ(nearest(index, 5), 5);
+
+    // Served from the delta segment's raw copy
+    std::vector<float> reconstructed(kDimension);
+    index.reconstruct(130, reconstructed.data());
+    EXPECT_EQ(std::vector<float>(vector(130), vector(130) + kDimension), reconstructed);
+
+    ASSERT_TRUE(index.merge());
+    EXPECT_EQ(index.base_index()->ntotal, 150);
+    EXPECT_EQ(index.get_statistics()["delta_vectors"].get<size_t>(), 0u);
+    EXPECT_EQ(nearest(index, 120), 120);
+}
+
+TEST_F(LsmIndexTest, DeletedVectorsStayHiddenAcrossMerge) {
+    LsmIndex index(main_, "flat", 100);
+    index.add(50, vector(100));
+
+    faiss::idx_t removed[2] = {5, 120};  // one in the main index, one in the delta
+    faiss::IDSelectorArray selector(2, removed);
+    EXPECT_EQ(index.remove_ids(selector), 2u);
+    EXPECT_EQ(index.remove_ids(selector), 0u);
+    EXPECT_EQ(index.ntotal, 148);
+    EXPECT_TRUE(index.is_removed(5));
+    EXPECT_NE(nearest(index, 5), 5);
+    EXPECT_NE(nearest(index, 120), 120);
+
+    ASSERT_TRUE(index.merge());
+    EXPECT_NE(nearest(index, 5), 5);
+    EXPECT_NE(nearest(index, 120), 120);
+    EXPECT_EQ(nearest(index, 121), 121);
+}
+
+TEST_F(LsmIndexTest, VersionAdvancesOnEveryVisibleChange) {
+    LsmIndex index(main_, "flat", 100);
+    EXPECT_EQ(index.version(), 0u);
+
+    index.add(10, vector(100));
+    uint64_t after_add = index.version();
+    EXPECT_GT(after_add, 0u);
+    index.add(0, vector(110));
+    EXPECT_EQ(index.version(), after_add);
+
+    faiss::idx_t removed = 3;
+    faiss::IDSelectorArray selector(1, &removed);
+    index.remove_ids(selector);
+    uint64_t after_remove = index.version();
+    EXPECT_GT(after_remove, after_add);
+    index.remove_ids(selector);
+    EXPECT_EQ(index.version(), after_remove);
+
+    ASSERT_TRUE(index.merge());
+    EXPECT_GT(index.version(), after_remove);
+}
+
+TEST_F(LsmIndexTest, BackgroundMergesKeepConcurrentAddsSearchable) {
+    LsmIndex index(main_, "flat", 100);
+    index.start_merging(20, std::chrono::milliseconds(5));
+
+    std::atomic<bool> writing(true);
+    std::thread writer([&]() {
+        for (faiss::idx_t id = 100; id < 400; ++id) {
+            index.add_with_ids(1, vector(id), &id);
+        }
+        writing.store(false);
+    });
+    std::atomic<bool> lost(false);
+    std::thread reader([&]() {
+        while (writing.load()) {
+            // Ids below 100 are in the main index from the start
+            for (faiss::idx_t id = 0; id < 100; id += 7) {
+                if (nearest(index, id) != id) {
+                    lost.store(true);
+                }
+            }
+        }
+    });
+    writer.join();
+    reader.join();
+    index.stop();
+    ASSERT_TRUE(index.merge());
+
+    EXPECT_FALSE(lost.load());
+    EXPECT_EQ(index.ntotal, 400);
+    EXPECT_EQ(index.base_index()->ntotal, 400);
+    for (faiss::idx_t id = 100; id < 400; id += 13) {
+        EXPECT_EQ(nearest(index, id), id);
+    }
+    EXPECT_GE(index.get_statistics()["merges"].get<uint64_t>(), 1u);
+}
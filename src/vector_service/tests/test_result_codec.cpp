@@ -0,0 +1,95 @@
+/**
+ * @file test_result_codec.cpp
+ * @brief Round trips of cached results and their index dependencies
+ */
+
+#include <gtest/gtest.h>
+
+#include "result_codec.h"
+#include "vector_search.h"
+
+#include <string>
+#include <vector>
+
+using namespace neurorag;
+
+namespace {
+
+SearchResult make_result() {
+    SearchResult result;
+    result.indices = {42, 7, 1000000, -1};
+    result.scores = {0.91f, 0.5f, -0.25f, 0.0f};
+    result.metadata = {"{\"a\": 1}", "", "{\"b\": \"x\"}", "{}"};
+    result.latency_ms = 3.5;
+    result.from_cache = false;
+    return result;
+}
+
+CacheDependency make_dependency() {
+    CacheDependency dependency;
+    dependency.epoch = 17;
+    dependency.global_version = 123456789;
+    dependency.delta_version = 99;
+    dependency.list_versions = {{3, 1}, {0, 40}, {1023, 7}};
+    return dependency;
+}
+
+} // namespace
+
+TEST(ResultCodecTest, DependencySurvivesRoundTrip) {
+    SearchResult result = make_result();
+    CacheDependency dependency = make_dependency();
+    std::string encoded = result_codec::encode(result, &dependency, false, result_codec::MetadataMode::INLINE);
+
+    SearchResult decoded;
+    CacheDependency decoded_dependency;
+    ASSERT_TRUE(result_codec::decode(encoded.data(), encoded.size(), decoded, &decoded_dependency, {}));
+    EXPECT_EQ(decoded.indices, result.indices);
+    EXPECT_EQ(decoded.scores, result.scores);
+    EXPECT_EQ(decoded.metadata, result.metadata);
+    EXPECT_TRUE(decoded.from_cache);
+    EXPECT_EQ(decoded.latency_ms, 0.0);
+
+    EXPECT_EQ(decoded_dependency.epoch, dependency.epoch);
+    EXPECT_EQ(decoded_dependency.global_version, dependency.global_version);
+    EXPECT_EQ(decoded_dependency.delta_version, dependency.delta_version);
+    EXPECT_EQ(decoded_dependency.list_versions, dependency.list_versions);
+}
+
+TEST(ResultCodecTest, ReferencedMetadataIsRehydrated) {
+    SearchResult result = make_result();
+    result.indices = {0, 2};
+    result.scores = {1.0f, 0.5f};
+    result.metadata = {"zero", "two"};
+    std::vector<std::string> store = {"zero", "one", "two"};
+    std::string encoded = result_codec::encode(result, nullptr, true, result_codec::MetadataMode::REFERENCE);
+
+    SearchResult decoded;
+    CacheDependency dependency = make_dependency();
+    ASSERT_TRUE(result_codec::decode(encoded.data(), encoded.size(), decoded, &dependency,
+        [&store](int64_t id, std::string& metadata) {
+            if (id < 0 || static_cast<size_t>(id) >= store.size()) {
+                return false;
+            }
+            metadata = store[id];
+            return true;
+        }));
+    EXPECT_EQ(decoded.metadata, result.metadata);
+    EXPECT_EQ(dependency.epoch, 0u);  // none stored
+}
+
+TEST(ResultCodecTest, RejectsOldVersionAndCorruption) {
+    CacheDependency dependency = make_dependency();
+    std::string encoded = result_codec::encode(make_result(), &dependency, false, result_codec::MetadataMode::NONE);
+    SearchResult decoded;
+
+    std::string old_version = encoded;
+    old_version[2] = 1;
+    EXPECT_FALSE(result_codec::decode(old_version.data(), old_version.size(), decoded, nullptr, {}));
+
+    std::string corrupt = encoded;
+    corrupt[6] ^= 0x40;
+    EXPECT_FALSE(result_codec::decode(corrupt.data(), corrupt.size(), decoded, nullptr, {}));
+
+    EXPECT_FALSE(result_codec::decode(encoded.data(), encoded.size() - 1, decoded, nullptr, {}));
+}
@@ -0,0 +1,187 @@
+/**
+ * @file build_index.cpp
+ * @brief Command-line index builder for precomputed embeddings
+ *
+ * Usage: neurorag_index_builder --input embeddings.npy --output faiss_index.bin
+ *        [--type FLAT|IVF_FLAT|HNSW|DISKANN] [--metric ip|l2] [--nlist N]
+ *        [--kmeans minibatch|hierarchical] [--train-size N] [--epochs N]
+ *        [--batch-size N] [--hnsw-m N] [--ef-construction N]
+ *        [--diskann-degree N] [--diskann-list-size N] [--diskann-pq-bytes N]
+ *        [--threads N] [--format checksummed|plain] [--report report.json]
+ *        [--snapshot DIR] [--normalize] [--center] [--pca N | --opq N]
+ *        [--transform-train-size N]
+ *
+ * scripts/ingest_data.py --native-builder runs this after writing the
+ * embeddings, instead of building the index in Python. --snapshot also
+ * writes the built index into a segmented snapshot directory (see
+ * index_snapshot.h); pointed at the previous build's directory, only the
+ * changed segments are added.
+ *
+ * --normalize, --center, --pca and --opq train a vector transform first
+ * and build the index in the transformed space; the transform is written
+ * to <output>.transform (and into the snapshot) and applied by the service
+ * to every insert and query.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "index_builder.h"
+#include "index_file.h"
+#include "index_snapshot.h"
+
+
+using namespace neurorag;
+
+namespace {
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " --input <vectors.npy|.fbin> --output <index>\n"
+              << "  --type FLAT|IVF_FLAT|HNSW|DISKANN   (default IVF_FLAT)\n"
+              << "  --metric ip|l2                      (default ip)\n"
+              << "  --nlist N                           IVF lists (default 1024)\n"
+              << "  --kmeans minibatch|hierarchical     (default minibatch)\n"
+              << "  --train-size N                      k-means sample (default 256 * nlist)\n"
+              << "  --epochs N                          k-means passes over the sample (default 20)\n"
+              << "  --batch-size N                      k-means mini-batch (default 65536)\n"
+              << "  --hnsw-m N --ef-construction N      HNSW graph (default 32, 200)\n"
+              << "  --diskann-degree N --diskann-list-size N --diskann-pq-bytes N\n"
+              << "  --threads N                         (default all cores)\n"
+              << "  --format checksummed|plain          index file format (default plain)\n"
+              << "  --report <file.json>                write the build report\n"
+              << "  --snapshot <dir>                    also write a segmented snapshot\n"
+              << "  --normalize                         L2-normalize vectors (cosine via inner product)\n"
+              << "  --center                            subtract the training mean\n"
+              << "  --pca N | --opq N                   reduce to N dimensions with a PCA or OPQ rotation\n"
+              << "  --transform-train-size N            transform training sample (default 100000)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::map<std::string, std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string key = argv[i];
+        if (key == "--help" || key == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (key == "--normalize" || key == "--center") {
+            args[key.substr(2)] = "1";
+            continue;
+        }
+        if (key.rfind("--", 0) != 0 || i + 1 >= argc) {
+            std::cerr << "Unexpected argument: " << key << std::endl;
+            print_usage(argv[0]);
+            return 2;
+        }
+        args[key.substr(2)] = argv[++i];
+    }
+    if (!args.count("input") || !args.count("output")) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    IndexBuildOptions options;
+    try {
+        if (args.count("type")) options.index_type = args["type"];
+        if (args.count("metric")) {
+            options.metric = args["metric"] == "l2" ? faiss::METRIC_L2 : faiss::METRIC_INNER_PRODUCT;
+        }
+        if (args.count("nlist")) options.nlist = std::stoi(args["nlist"]);
+        if (args.count("kmeans")) options.kmeans = args["kmeans"];
+        if (args.count("train-size")) options.training_size = std::stoull(args["train-size"]);
+        if (args.count("epochs")) options.kmeans_epochs = std::stoi(args["epochs"]);
+        if (args.count("batch-size")) options.kmeans_batch_size = std::stoull(args["batch-size"]);
+        if (args.count("hnsw-m")) options.hnsw_m = std::stoi(args["hnsw-m"]);
+        if (args.count("ef-construction")) options.ef_construction = std::stoi(args["ef-construction"]);
+        if (args.count("diskann-degree")) options.diskann.max_degree = std::stoi(args["diskann-degree"]);
+        if (args.count("diskann-list-size")) options.diskann.build_list_size = std::stoi(args["diskann-list-size"]);
+        if (args.count("diskann-pq-bytes")) options.diskann.pq_bytes = std::stoi(args["diskann-pq-bytes"]);
+        if (args.count("threads")) options.num_threads = std::stoi(args["threads"]);
+        if (args.count("format")) {
+            if (args["format"] != "checksummed" && args["format"] != "plain") {
+                std::cerr << "Unknown index format: " << args["format"] << std::endl;
+                return 2;
+            }
+            options.checksummed = args["format"] == "checksummed";
+        }
+        options.preprocess.normalize = args.count("normalize") > 0;
+        options.preprocess.center = args.count("center") > 0;
+        if (args.count("pca")) {
+            options.preprocess.rotation = "pca";
+            options.preprocess.output_dimension = std::stoi(args["pca"]);
+        }
+        if (args.count("opq")) {
+            options.preprocess.rotation = "opq";
+            options.preprocess.output_dimension = std::stoi(args["opq"]);
+        }
+        if (args.count("transform-train-size")) {
+            options.preprocess.training_size = std::stoull(args["transform-train-size"]);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 2;
+    }
+    if (args.count("pca") && args.count("opq")) {
+        std::cerr << "--pca and --opq are alternatives" << std::endl;
+        return 2;
+    }
+    if (options.kmeans != "minibatch" && options.kmeans != "hierarchical") {
+        std::cerr << "Unknown k-means variant: " << options.kmeans << std::endl;
+        return 2;
+    }
+    if (args.count("snapshot") && options.index_type == "DISKANN") {
+        std::cerr << "DiskANN indexes have their own file format; --snapshot is not supported" << std::endl;
+        return 2;
+    }
+
+    VectorFile vectors;
+    if (!vectors.open(args["input"])) {
+        return 1;
+    }
+
+    nlohmann::json report = build_index_file(vectors, args["output"], options);
+    if (report.is_null()) {
+        std::cerr << "Index build failed" << std::endl;
+        return 1;
+    }
+
+    if (args.count("snapshot")) {
+        // IVF lists stay in the mapped .ivfdata file while they are copied out
+        IndexFileOptions file_options;
+        file_options.mmap = options.index_type == "IVF_FLAT";
+        file_options.verify = IndexVerification::NONE;
+        file_options.num_threads = options.num_threads;
+        std::unique_ptr<faiss::Index> index = read_index_file(args["output"], file_options);
+        std::vector<uint8_t> transform;
+        if (report.contains("transform_path")) {
+            auto preprocessor = VectorPreprocessor::load(report["transform_path"].get<std::string>());
+            if (preprocessor) {
+                preprocessor->serialize(transform);
+            } else {
+                index.reset();
+            }
+        }
+        if (index) {
+            SnapshotOptions snapshot_options;
+            snapshot_options.num_threads = options.num_threads;
+            report["snapshot"] = write_index_snapshot(*index, nullptr, transform.empty() ? nullptr : &transform,
+                                                      args["snapshot"], snapshot_options);
+        }
+        if (report["snapshot"].is_null()) {
+            std::cerr << "Snapshot failed" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << report.dump(2) << std::endl;
+    if (args.count("report")) {
+        std::ofstream(args["report"]) << report.dump(2) << std::endl;
+    }
+    return 0;
+}